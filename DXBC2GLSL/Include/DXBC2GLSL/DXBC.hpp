@@ -174,7 +174,7 @@ struct DXBCContainer
 struct DXBCContainerHeader
 {
 	uint32_t fourcc;
-	uint32_t unk[4];
+	uint32_t checksum[4];	// MD5 of the rest of the container
 	uint32_t one;
 	uint32_t total_size;
 	uint32_t chunk_count;
@@ -54,6 +54,12 @@ namespace DXBC2GLSL
 		void FeedDXBC(void const * dxbc_data, bool has_gs, GLSLVersion version);
 		void FeedDXBC(void const * dxbc_data, bool has_gs, GLSLVersion version, uint32_t glsl_rules);
 
+		// Translations are cached by the checksum of the DXBC container, feeding the same DXBC again reuses the
+		//  parsed program and the GLSL. The cache keeps a copy of the DXBC, so the results don't depend on the
+		//  lifetime of dxbc_data. It's bounded, the least recently used translations are dropped first, and
+		//  should be cleared once no more shaders are coming, such as when the render engine is destroyed.
+		static void ClearCache();
+
 		std::string const & GLSLString() const;
 
 		uint32_t NumInputParams() const;
@@ -80,9 +86,10 @@ namespace DXBC2GLSL
 		uint32_t GSInstanceCount() const;
 
 	private:
+		KlayGE::shared_ptr<std::vector<uint8_t> > dxbc_data_;
 		KlayGE::shared_ptr<DXBCContainer> dxbc_;
 		KlayGE::shared_ptr<ShaderProgram> shader_;
-		std::string glsl_;
+		KlayGE::shared_ptr<std::string> glsl_;
 	};
 }
 
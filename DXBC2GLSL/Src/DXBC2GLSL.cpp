@@ -31,7 +31,125 @@
 #include <DXBC2GLSL/DXBC2GLSL.hpp>
 #include <DXBC2GLSL/DXBC.hpp>
 #include <DXBC2GLSL/GLSLGen.hpp>
-#include <sstream>
+#include <KFL/Thread.hpp>
+#include <ostream>
+#include <streambuf>
+#include <cstring>
+#include <map>
+
+namespace
+{
+	using namespace KlayGE;
+
+	// Appends to a std::string reserved up front, instead of growing a stringstream and copying its content out
+	class StringAppendBuf : public std::streambuf
+	{
+	public:
+		explicit StringAppendBuf(std::string& str)
+			: str_(str)
+		{
+		}
+
+	protected:
+		virtual int_type overflow(int_type ch)
+		{
+			if (!traits_type::eq_int_type(ch, traits_type::eof()))
+			{
+				str_.push_back(traits_type::to_char_type(ch));
+			}
+			return traits_type::not_eof(ch);
+		}
+
+		virtual std::streamsize xsputn(char const * s, std::streamsize n)
+		{
+			str_.append(s, static_cast<size_t>(n));
+			return n;
+		}
+
+	private:
+		StringAppendBuf& operator=(StringAppendBuf const & rhs);
+
+	private:
+		std::string& str_;
+	};
+
+	struct TranslationKey
+	{
+		uint32_t checksum[4];
+		uint32_t total_size;
+		bool has_gs;
+		GLSLVersion version;
+		uint32_t glsl_rules;
+
+		bool operator<(TranslationKey const & rhs) const
+		{
+			int c = memcmp(checksum, rhs.checksum, sizeof(checksum));
+			if (c != 0)
+			{
+				return c < 0;
+			}
+			if (total_size != rhs.total_size)
+			{
+				return total_size < rhs.total_size;
+			}
+			if (has_gs != rhs.has_gs)
+			{
+				return has_gs < rhs.has_gs;
+			}
+			if (version != rhs.version)
+			{
+				return version < rhs.version;
+			}
+			return glsl_rules < rhs.glsl_rules;
+		}
+	};
+
+	struct Translation
+	{
+		shared_ptr<std::vector<uint8_t> > dxbc_data;
+		shared_ptr<DXBCContainer> dxbc;
+		shared_ptr<ShaderProgram> shader;
+		shared_ptr<std::string> glsl;
+
+		size_t size;
+		uint64_t last_use;
+	};
+
+	// The DXBC and GLSL kept by the cache. The least recently used translations are dropped beyond that.
+	size_t const MAX_TRANSLATION_CACHE_SIZE = 16 * 1024 * 1024;
+
+	mutex translation_cache_mutex;
+	std::map<TranslationKey, Translation> translation_cache;
+	size_t translation_cache_size = 0;
+	uint64_t translation_cache_tick = 0;
+
+	void InsertTranslation(TranslationKey const & key, Translation const & translation)
+	{
+		KLAYGE_AUTO(iter, translation_cache.find(key));
+		if (iter != translation_cache.end())
+		{
+			translation_cache_size -= iter->second.size;
+			translation_cache.erase(iter);
+		}
+
+		while (!translation_cache.empty() && (translation_cache_size + translation.size > MAX_TRANSLATION_CACHE_SIZE))
+		{
+			KLAYGE_AUTO(lru_iter, translation_cache.begin());
+			for (KLAYGE_AUTO(iter, translation_cache.begin()); iter != translation_cache.end(); ++ iter)
+			{
+				if (iter->second.last_use < lru_iter->second.last_use)
+				{
+					lru_iter = iter;
+				}
+			}
+			translation_cache_size -= lru_iter->second.size;
+			translation_cache.erase(lru_iter);
+		}
+
+		translation_cache.insert(std::make_pair(key, translation));
+		translation_cache_size += translation.size;
+	}
+}
 
 namespace DXBC2GLSL
 {
@@ -47,27 +165,85 @@ namespace DXBC2GLSL
 
 	void DXBC2GLSL::FeedDXBC(void const * dxbc_data, bool has_gs, GLSLVersion version, uint32_t glsl_rules)
 	{
-		dxbc_ = DXBCParse(dxbc_data);
+		dxbc_data_.reset();
+		dxbc_.reset();
+		shader_.reset();
+		glsl_.reset();
+
+		DXBCContainerHeader const * header = static_cast<DXBCContainerHeader const *>(dxbc_data);
+		if (KlayGE::LE2Native(header->fourcc) != FOURCC_DXBC)
+		{
+			return;
+		}
+
+		TranslationKey key;
+		memcpy(key.checksum, header->checksum, sizeof(key.checksum));
+		key.total_size = KlayGE::LE2Native(header->total_size);
+		key.has_gs = has_gs;
+		key.version = version;
+		key.glsl_rules = glsl_rules;
+
+		{
+			KlayGE::lock_guard<KlayGE::mutex> lock(translation_cache_mutex);
+			KLAYGE_AUTO(iter, translation_cache.find(key));
+			// The checksum isn't trusted alone, a DXBC compiled without signing has a zero one
+			if ((iter != translation_cache.end())
+				&& (0 == memcmp(&(*iter->second.dxbc_data)[0], dxbc_data, key.total_size)))
+			{
+				iter->second.last_use = ++ translation_cache_tick;
+				dxbc_data_ = iter->second.dxbc_data;
+				dxbc_ = iter->second.dxbc;
+				shader_ = iter->second.shader;
+				glsl_ = iter->second.glsl;
+				return;
+			}
+		}
+
+		// The parsed program points into the DXBC, so it's parsed from the copy kept by the cache
+		uint8_t const * p = static_cast<uint8_t const *>(dxbc_data);
+		dxbc_data_ = KlayGE::MakeSharedPtr<std::vector<uint8_t> >(p, p + key.total_size);
+		dxbc_ = DXBCParse(&(*dxbc_data_)[0]);
 		if (dxbc_)
 		{
 			if (dxbc_->shader_chunk)
 			{
 				shader_ = ShaderParse(*dxbc_);
 
-				std::stringstream ss;
+				glsl_ = KlayGE::MakeSharedPtr<std::string>();
+				glsl_->reserve(KlayGE::LE2Native(dxbc_->shader_chunk->size) * 4);
+
+				StringAppendBuf buf(*glsl_);
+				std::ostream os(&buf);
 
 				GLSLGen converter;
 				converter.FeedDXBC(shader_, has_gs, version, glsl_rules);
-				converter.ToGLSL(ss);
+				converter.ToGLSL(os);
+
+				Translation translation;
+				translation.dxbc_data = dxbc_data_;
+				translation.dxbc = dxbc_;
+				translation.shader = shader_;
+				translation.glsl = glsl_;
+				translation.size = dxbc_data_->size() + glsl_->size();
 
-				glsl_ = ss.str();
+				KlayGE::lock_guard<KlayGE::mutex> lock(translation_cache_mutex);
+				translation.last_use = ++ translation_cache_tick;
+				InsertTranslation(key, translation);
 			}
 		}
 	}
 
+	void DXBC2GLSL::ClearCache()
+	{
+		KlayGE::lock_guard<KlayGE::mutex> lock(translation_cache_mutex);
+		translation_cache.clear();
+		translation_cache_size = 0;
+	}
+
 	std::string const & DXBC2GLSL::GLSLString() const
 	{
-		return glsl_;
+		static std::string const empty;
+		return glsl_ ? *glsl_ : empty;
 	}
 
 	uint32_t DXBC2GLSL::NumInputParams() const
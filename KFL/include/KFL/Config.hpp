@@ -541,6 +541,19 @@
 #elif defined KLAYGE_CPU_ARM64
 #endif
 
+#if defined(KLAYGE_CPU_X86) || defined(KLAYGE_CPU_X64)
+	#if defined(KLAYGE_COMPILER_MSVC)
+		// Every CPU with AVX2 has F16C
+		#ifdef __AVX2__
+			#define KLAYGE_F16C_SUPPORT
+		#endif
+	#elif defined(KLAYGE_COMPILER_GCC) || defined(KLAYGE_COMPILER_CLANG)
+		#ifdef __F16C__
+			#define KLAYGE_F16C_SUPPORT
+		#endif
+	#endif
+#endif
+
 #if defined(KLAYGE_COMPILER_MSVC) || defined(KLAYGE_COMPILER_GCC) || defined(KLAYGE_COMPILER_CLANG)
 	#define KLAYGE_HAS_STRUCT_PACK
 #endif
@@ -0,0 +1,123 @@
+/**
+ * @file MathSIMD.hpp
+ * @author Minmin Gong
+ *
+ * @section DESCRIPTION
+ *
+ * This source file is part of KFL, a subproject of KlayGE
+ * For the latest info, see http://www.klayge.org
+ *
+ * @section LICENSE
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published
+ * by the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+ *
+ * You may alternatively use this source under the terms of
+ * the KlayGE Proprietary License (KPL). You can obtained such a license
+ * from http://www.klayge.org/licensing/.
+ */
+
+#ifndef _KFL_MATHSIMD_HPP
+#define _KFL_MATHSIMD_HPP
+
+#pragma once
+
+#include <KFL/PreDeclare.hpp>
+#include <KFL/Detail/MathHelper.hpp>
+
+#if defined(KLAYGE_SSE_SUPPORT) || defined(KLAYGE_NEON_SUPPORT)
+	#define KLAYGE_MATH_SIMD_SUPPORT
+#endif
+
+namespace KlayGE
+{
+	namespace detail
+	{
+		// Scalar reference implementations
+		template <typename T>
+		Matrix4_T<T> mul_scalar(Matrix4_T<T> const & lhs, Matrix4_T<T> const & rhs);
+		template <typename T>
+		Quaternion_T<T> mul_scalar(Quaternion_T<T> const & lhs, Quaternion_T<T> const & rhs);
+		template <typename T>
+		Matrix4_T<T> inverse_scalar(Matrix4_T<T> const & rhs);
+		template <typename T>
+		Quaternion_T<T> slerp_scalar(Quaternion_T<T> const & lhs, Quaternion_T<T> const & rhs, T s);
+		template <typename T>
+		void decompose_scalar(Vector_T<T, 3>& scale, Quaternion_T<T>& rot, Vector_T<T, 3>& trans, Matrix4_T<T> const & rhs);
+		template <typename T>
+		T perspective_area_scalar(Vector_T<T, 3> const & view_pos, Matrix4_T<T> const & view_proj, AABBox_T<T> const & aabbox);
+
+		template <typename T>
+		Vector_T<typename T::value_type, 4> transform_scalar(T const & v, Matrix4_T<typename T::value_type> const & mat)
+		{
+			return transform_helper<typename T::value_type, T::elem_num>::Do(v, mat);
+		}
+		template <typename T>
+		T transform_normal_scalar(T const & v, Matrix4_T<typename T::value_type> const & mat)
+		{
+			return transform_normal_helper<typename T::value_type, T::elem_num>::Do(v, mat);
+		}
+
+		// SIMD implementations. The templates are the fallbacks for types and platforms without a SIMD path,
+		// the non-template overloads win the overload resolution for float.
+		template <typename T>
+		Matrix4_T<T> mul_simd(Matrix4_T<T> const & lhs, Matrix4_T<T> const & rhs)
+		{
+			return mul_scalar(lhs, rhs);
+		}
+		template <typename T>
+		Quaternion_T<T> mul_simd(Quaternion_T<T> const & lhs, Quaternion_T<T> const & rhs)
+		{
+			return mul_scalar(lhs, rhs);
+		}
+		template <typename T>
+		Vector_T<typename T::value_type, 4> transform_simd(T const & v, Matrix4_T<typename T::value_type> const & mat)
+		{
+			return transform_scalar(v, mat);
+		}
+		template <typename T>
+		T transform_normal_simd(T const & v, Matrix4_T<typename T::value_type> const & mat)
+		{
+			return transform_normal_scalar(v, mat);
+		}
+		template <typename T>
+		Matrix4_T<T> inverse_simd(Matrix4_T<T> const & rhs)
+		{
+			return inverse_scalar(rhs);
+		}
+		template <typename T>
+		Quaternion_T<T> slerp_simd(Quaternion_T<T> const & lhs, Quaternion_T<T> const & rhs, T s)
+		{
+			return slerp_scalar(lhs, rhs, s);
+		}
+		template <typename T>
+		void decompose_simd(Vector_T<T, 3>& scale, Quaternion_T<T>& rot, Vector_T<T, 3>& trans, Matrix4_T<T> const & rhs)
+		{
+			decompose_scalar(scale, rot, trans, rhs);
+		}
+
+#ifdef KLAYGE_MATH_SIMD_SUPPORT
+		float4x4 mul_simd(float4x4 const & lhs, float4x4 const & rhs);
+		Quaternion mul_simd(Quaternion const & lhs, Quaternion const & rhs);
+		float4 transform_simd(float4 const & v, float4x4 const & mat);
+		float4 transform_simd(float3 const & v, float4x4 const & mat);
+		float3 transform_normal_simd(float3 const & v, float4x4 const & mat);
+		float4x4 inverse_simd(float4x4 const & rhs);
+		Quaternion slerp_simd(Quaternion const & lhs, Quaternion const & rhs, float s);
+		void decompose_simd(float3& scale, Quaternion& rot, float3& trans, float4x4 const & rhs);
+#endif
+	}
+}
+
+#endif			// _KFL_MATHSIMD_HPP
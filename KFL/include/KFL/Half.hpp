@@ -89,6 +89,10 @@ namespace KlayGE
 
 		operator float() const;
 
+		// The raw 1s5e10m bit pattern
+		static half from_bits(uint16_t bits);
+		uint16_t bits() const;
+
 		// ֵ
 
 		// returns +infinity
@@ -121,6 +125,10 @@ namespace KlayGE
 	private:
 		uint16_t value_;
 	};
+
+	// Batch conversions with the same results as half(float) and half::operator float(). Use F16C, SSE2 or NEON if available.
+	void float_to_half_n(half* out, float const * in, size_t num);
+	void half_to_float_n(float* out, half const * in, size_t num);
 }
 
 namespace std
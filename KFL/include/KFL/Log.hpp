@@ -33,11 +33,111 @@
 
 #pragma once
 
+#include <iosfwd>
+#include <string>
+#include <vector>
+
 namespace KlayGE
 {
+	enum LogLevel
+	{
+		LL_Info = 0,
+		LL_Warn,
+		LL_Error,
+		LL_None
+	};
+
+	// Sinks are only called from one thread at a time, either the draining thread or a flushing one. A sink
+	// can log, that message bypasses the sinks and goes to stderr, but it can't add or remove sinks.
+	class LogSink
+	{
+	public:
+		virtual ~LogSink()
+		{
+		}
+
+		virtual void Write(LogLevel level, char const * msg) = 0;
+		virtual void Flush()
+		{
+		}
+	};
+	typedef shared_ptr<LogSink> LogSinkPtr;
+
+	class StreamLogSink : public LogSink
+	{
+	public:
+		explicit StreamLogSink(std::ostream& os);
+
+		virtual void Write(LogLevel level, char const * msg) KLAYGE_OVERRIDE;
+		virtual void Flush() KLAYGE_OVERRIDE;
+
+	private:
+		std::ostream& os_;
+	};
+
+	class FileLogSink : public LogSink
+	{
+	public:
+		explicit FileLogSink(std::string const & file_name);
+
+		virtual void Write(LogLevel level, char const * msg) KLAYGE_OVERRIDE;
+		virtual void Flush() KLAYGE_OVERRIDE;
+
+	private:
+		shared_ptr<std::ostream> os_;
+	};
+
+	// Keeps the last messages in memory
+	class MemoryLogSink : public LogSink
+	{
+	public:
+		explicit MemoryLogSink(uint32_t max_lines);
+
+		virtual void Write(LogLevel level, char const * msg) KLAYGE_OVERRIDE;
+
+		void Lines(std::vector<std::string>& lines) const;
+		void Clear();
+
+	private:
+		struct Impl;
+		shared_ptr<Impl> impl_;
+	};
+
+	// Creates the log backend before the statics of every translation unit including this header, and
+	// destroys it after them, like std::ios_base::Init. Messages logged outside of that go to stderr.
+	class LogInitializer
+	{
+	public:
+		LogInitializer();
+		~LogInitializer();
+	};
+	static LogInitializer log_initializer;
+
 	void LogInfo(char const * fmt, ...);
 	void LogWarn(char const * fmt, ...);
 	void LogError(char const * fmt, ...);
+
+	// Messages under the level are discarded
+	void SetLogLevel(LogLevel level);
+	LogLevel GetLogLevel();
+	// Max number of info and warning messages per second, 0 for no limit. Errors are never limited.
+	void SetLogRateLimit(uint32_t max_msgs_per_second);
+
+	// In async mode, messages are formatted into per-thread lock-free buffers and written to sinks by
+	// a background thread. Turning it off joins that thread, which must be done before the module unloads.
+	void AsyncLog(bool async);
+	bool AsyncLog();
+
+	// The default sinks are stderr (logcat on Android) and KlayGE.log in debug builds
+	void AddLogSink(LogSinkPtr const & sink);
+	void RemoveLogSink(LogSinkPtr const & sink);
+	void ClearLogSinks();
+
+	// Writes out all pending messages before returning
+	void FlushLog();
+	// Flushes pending messages on fatal signals and std::terminate, then passes them on to the handlers
+	// installed before
+	void InstallLogCrashHandler();
 }
 
 #endif		// _KFL_LOG_HPP
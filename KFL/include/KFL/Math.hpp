@@ -333,6 +333,12 @@ namespace KlayGE
 		template <typename T>
 		T transform_normal(T const & v, Matrix4_T<typename T::value_type> const & mat);
 
+		// Batch versions. out can be the same array as in.
+		void transform_array(float4* out, float4 const * in, size_t num, float4x4 const & mat);
+		void transform_array(float4* out, float3 const * in, size_t num, float4x4 const & mat);
+		void transform_coord_array(float3* out, float3 const * in, size_t num, float4x4 const & mat);
+		void transform_normal_array(float3* out, float3 const * in, size_t num, float4x4 const & mat);
+
 		template <typename T>
 		T bary_centric(T const & v1, T const & v2, T const & v3,
 			typename T::value_type const & f, typename T::value_type const & g);
@@ -414,6 +420,11 @@ namespace KlayGE
 		template <typename T>
 		Matrix4_T<T> mul(Matrix4_T<T> const & lhs, Matrix4_T<T> const & rhs);
 
+		// out[i] = lhs[i] * rhs[i]
+		void mul_array(float4x4* out, float4x4 const * lhs, float4x4 const * rhs, size_t num);
+		// out[i] = lhs[i] * rhs
+		void mul_array(float4x4* out, float4x4 const * lhs, float4x4 const & rhs, size_t num);
+
 		template <typename T>
 		T determinant(Matrix4_T<T> const & rhs);
 
@@ -539,6 +550,9 @@ namespace KlayGE
 		template <typename T>
 		Quaternion_T<T> mul(Quaternion_T<T> const & lhs, Quaternion_T<T> const & rhs);
 
+		// out[i] = lhs[i] * rhs[i]
+		void mul_array(Quaternion* out, Quaternion const * lhs, Quaternion const * rhs, size_t num);
+
 		template <typename T>
 		Quaternion_T<T> rotation_quat_yaw_pitch_roll(T const & yaw, T const & pitch, T const & roll);
 
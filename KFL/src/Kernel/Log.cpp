@@ -29,67 +29,709 @@
  */
 
 #include <KFL/KFL.hpp>
+#include <KFL/Thread.hpp>
+#include <KFL/Timer.hpp>
 
+#include <algorithm>
+#include <csignal>
 #include <cstdarg>
 #include <cstdio>
+#include <cstdlib>
+#include <deque>
+#include <exception>
+#include <iostream>
+#include <fstream>
 
-#ifdef KLAYGE_PLATFORM_ANDROID
+#if defined KLAYGE_PLATFORM_WINDOWS
+#include <windows.h>
+#elif defined KLAYGE_PLATFORM_ANDROID
 #include <android/log.h>
+#include <pthread.h>
 #else
-#include <iostream>
-#include <fstream>
+#include <pthread.h>
 #endif
 
 #include <KFL/Log.hpp>
 
-#ifdef KLAYGE_DEBUG
-#ifndef KLAYGE_PLATFORM_ANDROID
-namespace
-{
-	std::ofstream log_file("KlayGE.log");
-}
-#endif
+#if defined(KLAYGE_COMPILER_MSVC)
+	#define KLAYGE_LOG_THREAD_LOCAL __declspec(thread)
+#else
+	#define KLAYGE_LOG_THREAD_LOCAL __thread
 #endif
 
-namespace KlayGE
+namespace
 {
-	void LogInfo(char const * fmt, ...)
+	using namespace KlayGE;
+
+	char const * log_level_prefixes[] =
 	{
-		va_list args;
-		va_start(args, fmt);
+		"(INFO) KlayGE: ",
+		"(WARN) KlayGE: ",
+		"(ERROR) KlayGE: "
+	};
+
+	void FormatLogText(char* buffer, size_t size, char const * fmt, va_list args)
+	{
+#ifdef KLAYGE_COMPILER_MSVC
+		_vsnprintf(buffer, size - 1, fmt, args);
+#else
+		vsnprintf(buffer, size, fmt, args);
+#endif
+		buffer[size - 1] = '\0';
+	}
 
+	// Bypasses the backend and the sinks. Used before the backend is created, after it's destroyed, and
+	// for messages logged from inside a sink.
+	void WriteDirect(LogLevel level, char const * msg)
+	{
 #ifdef KLAYGE_PLATFORM_ANDROID
-		__android_log_vprint(ANDROID_LOG_INFO, "KlayGE", fmt, args);
+		static int const priorities[] = { ANDROID_LOG_INFO, ANDROID_LOG_WARN, ANDROID_LOG_ERROR };
+		__android_log_write(priorities[level], "KlayGE", msg);
 #else
-		char buffer[1024];
-		vsprintf(buffer, fmt, args);
+		fprintf(stderr, "%s%s\n", log_level_prefixes[level], msg);
+#endif
+	}
 
-		std::clog << "(INFO) KlayGE: " << buffer << std::endl;
-#ifdef KLAYGE_DEBUG
-		log_file << "(INFO) KlayGE: " << buffer << std::endl;
+#ifdef KLAYGE_PLATFORM_ANDROID
+	class AndroidLogSink : public LogSink
+	{
+	public:
+		virtual void Write(LogLevel level, char const * msg) KLAYGE_OVERRIDE
+		{
+			WriteDirect(level, msg);
+		}
+	};
 #endif
+
+	struct LogRecord
+	{
+		static uint32_t const MAX_TEXT_LENGTH = 1024;
+
+		uint64_t seq;
+		LogLevel level;
+		char text[MAX_TEXT_LENGTH];
+	};
+
+	// Single producer (the owning thread), single consumer (whoever holds the drain lock) ring of records
+	struct LogThreadBuffer
+	{
+		static uint32_t const CAPACITY = 64;
+
+		LogThreadBuffer()
+			: write_pos(0), read_pos(0), retired(false)
+		{
+			records.resize(CAPACITY);
+		}
+
+		std::vector<LogRecord> records;
+		atomic<uint32_t> write_pos;
+		atomic<uint32_t> read_pos;
+		// Set when the owning thread exits. The buffer is freed by the next drain that empties it.
+		atomic<bool> retired;
+	};
+
+	KLAYGE_LOG_THREAD_LOCAL LogThreadBuffer* tls_log_buffer = nullptr;
+	// The backend the buffer above is registered to. A buffer left from a destroyed backend is not reused.
+	KLAYGE_LOG_THREAD_LOCAL uint32_t tls_log_generation = 0;
+	// Set while this thread is calling into the sinks
+	KLAYGE_LOG_THREAD_LOCAL bool tls_in_sink = false;
+
+	// Thread exit hook of the per-thread buffers
+#ifdef KLAYGE_PLATFORM_WINDOWS
+	typedef DWORD LogThreadKey;
+
+	void WINAPI RetireThreadBuffer(void* buffer)
+#else
+	typedef pthread_key_t LogThreadKey;
+
+	void RetireThreadBuffer(void* buffer)
 #endif
+	{
+		if (buffer)
+		{
+			static_cast<LogThreadBuffer*>(buffer)->retired.store(true, memory_order_release);
+		}
+		tls_log_buffer = nullptr;
+	}
 
-		va_end(args);
+	bool LessBySeq(LogRecord const * lhs, LogRecord const * rhs)
+	{
+		return lhs->seq < rhs->seq;
 	}
 
-	void LogWarn(char const * fmt, ...)
+	class LogBackend
 	{
-		va_list args;
-		va_start(args, fmt);
+	public:
+		explicit LogBackend(uint32_t generation)
+			: level_(LL_Info), rate_limit_(0), rate_window_(0), rate_count_(0),
+				num_suppressed_(0), num_dropped_(0), seq_(0), generation_(generation), async_(false), quit_(false)
+		{
+#ifdef KLAYGE_PLATFORM_WINDOWS
+			thread_key_ = ::FlsAlloc(RetireThreadBuffer);
+			thread_key_valid_ = (thread_key_ != FLS_OUT_OF_INDEXES);
+#else
+			thread_key_valid_ = (0 == pthread_key_create(&thread_key_, RetireThreadBuffer));
+#endif
 
 #ifdef KLAYGE_PLATFORM_ANDROID
-		__android_log_vprint(ANDROID_LOG_WARN, "KlayGE", fmt, args);
+			sinks_.push_back(MakeSharedPtr<AndroidLogSink>());
 #else
-		char buffer[1024];
-		vsprintf(buffer, fmt, args);
-
-		std::clog << "(WARN) KlayGE: " << buffer << std::endl;
+			sinks_.push_back(MakeSharedPtr<StreamLogSink>(std::clog));
 #ifdef KLAYGE_DEBUG
-		log_file << "(WARN) KlayGE: " << buffer << std::endl;
+			sinks_.push_back(MakeSharedPtr<FileLogSink>("KlayGE.log"));
 #endif
 #endif
+		}
+
+		~LogBackend()
+		{
+			this->Async(false);
+			this->Flush();
+
+			// No exit hook can run after this, so the buffers can go with the backend
+			if (thread_key_valid_)
+			{
+#ifdef KLAYGE_PLATFORM_WINDOWS
+				::FlsFree(thread_key_);
+#else
+				pthread_key_delete(thread_key_);
+#endif
+			}
+			tls_log_buffer = nullptr;
+		}
+
+		void Log(LogLevel level, char const * fmt, va_list args)
+		{
+			if (level < static_cast<LogLevel>(level_.load(memory_order_relaxed)))
+			{
+				return;
+			}
+			if (tls_in_sink)
+			{
+				// A sink is logging. Going through the drain lock again would deadlock.
+				char text[LogRecord::MAX_TEXT_LENGTH];
+				FormatLogText(text, sizeof(text), fmt, args);
+				WriteDirect(level, text);
+				return;
+			}
+			if ((level < LL_Error) && !this->PassRateLimit())
+			{
+				num_suppressed_.fetch_add(1, memory_order_relaxed);
+				return;
+			}
+
+			if (async_.load(memory_order_acquire))
+			{
+				LogThreadBuffer* buffer = this->ThreadBuffer();
+				uint32_t const w = buffer->write_pos.load(memory_order_relaxed);
+				if (w - buffer->read_pos.load(memory_order_acquire) < LogThreadBuffer::CAPACITY)
+				{
+					LogRecord& record = buffer->records[w & (LogThreadBuffer::CAPACITY - 1)];
+					record.seq = seq_.fetch_add(1, memory_order_relaxed);
+					record.level = level;
+					FormatLogText(record.text, sizeof(record.text), fmt, args);
+					buffer->write_pos.store(w + 1, memory_order_release);
+					return;
+				}
+				else if (level < LL_Error)
+				{
+					num_dropped_.fetch_add(1, memory_order_relaxed);
+					return;
+				}
+
+				// Errors are never dropped. Write it out synchronously, after everything pending.
+			}
+
+			char text[LogRecord::MAX_TEXT_LENGTH];
+			FormatLogText(text, sizeof(text), fmt, args);
+
+			lock_guard<mutex> lock(drain_mutex_);
+			this->Drain();
+			this->Dispatch(level, text);
+			// Nothing is buffered in sync mode, a crash right after this call still has the message
+			this->FlushSinks();
+		}
+
+		void Level(LogLevel level)
+		{
+			level_.store(level, memory_order_relaxed);
+		}
+		LogLevel Level() const
+		{
+			return static_cast<LogLevel>(level_.load(memory_order_relaxed));
+		}
+
+		void RateLimit(uint32_t max_msgs_per_second)
+		{
+			rate_limit_.store(max_msgs_per_second, memory_order_relaxed);
+		}
+
+		void Async(bool async)
+		{
+			lock_guard<mutex> lock(thread_mutex_);
+			if (async)
+			{
+				if (!drain_thread_)
+				{
+					quit_ = false;
+					async_.store(true, memory_order_release);
+					drain_thread_ = MakeSharedPtr<joiner<void> >(create_thread(bind(&LogBackend::DrainThreadFunc, this)));
+				}
+			}
+			else
+			{
+				if (drain_thread_)
+				{
+					async_.store(false, memory_order_release);
+					quit_ = true;
+					(*drain_thread_)();
+					drain_thread_.reset();
+
+					this->Flush();
+				}
+			}
+		}
+		bool Async() const
+		{
+			return async_.load(memory_order_acquire);
+		}
+
+		// Sinks can't be changed from inside a sink
+		void AddSink(LogSinkPtr const & sink)
+		{
+			BOOST_ASSERT(!tls_in_sink);
+
+			lock_guard<mutex> lock(drain_mutex_);
+			sinks_.push_back(sink);
+		}
+		void RemoveSink(LogSinkPtr const & sink)
+		{
+			BOOST_ASSERT(!tls_in_sink);
+
+			lock_guard<mutex> lock(drain_mutex_);
+			this->Drain();
+			sinks_.erase(std::remove(sinks_.begin(), sinks_.end(), sink), sinks_.end());
+		}
+		void ClearSinks()
+		{
+			BOOST_ASSERT(!tls_in_sink);
+
+			lock_guard<mutex> lock(drain_mutex_);
+			this->Drain();
+			sinks_.clear();
+		}
+
+		void Flush()
+		{
+			if (tls_in_sink)
+			{
+				// The thread draining right now flushes when it's done
+				return;
+			}
+
+			lock_guard<mutex> lock(drain_mutex_);
+			this->Drain();
+			this->FlushSinks();
+		}
+
+		// Called from a signal handler when the process is going down. Whoever owns a lock may never
+		// release it, so nothing here blocks or allocates.
+		void EmergencyFlush()
+		{
+			bool const drain_locked = drain_mutex_.try_lock();
+			if (buffers_mutex_.try_lock())
+			{
+				this->EmergencyDrain();
+				buffers_mutex_.unlock();
+			}
+			this->FlushSinks();
+			if (drain_locked)
+			{
+				drain_mutex_.unlock();
+			}
+		}
+
+	private:
+		bool PassRateLimit()
+		{
+			uint32_t const limit = rate_limit_.load(memory_order_relaxed);
+			if (0 == limit)
+			{
+				return true;
+			}
+
+			uint32_t const window = static_cast<uint32_t>(timer_.elapsed());
+			if (rate_window_.load(memory_order_relaxed) != window)
+			{
+				rate_window_.store(window, memory_order_relaxed);
+				rate_count_.store(0, memory_order_relaxed);
+			}
+			return rate_count_.fetch_add(1, memory_order_relaxed) < limit;
+		}
+
+		LogThreadBuffer* ThreadBuffer()
+		{
+			if (!tls_log_buffer || (tls_log_generation != generation_))
+			{
+				lock_guard<mutex> lock(buffers_mutex_);
+				shared_ptr<LogThreadBuffer> buffer = MakeSharedPtr<LogThreadBuffer>();
+				buffers_.push_back(buffer);
+				tls_log_buffer = buffer.get();
+				tls_log_generation = generation_;
+
+				if (thread_key_valid_)
+				{
+#ifdef KLAYGE_PLATFORM_WINDOWS
+					::FlsSetValue(thread_key_, tls_log_buffer);
+#else
+					pthread_setspecific(thread_key_, tls_log_buffer);
+#endif
+				}
+			}
+			return tls_log_buffer;
+		}
+
+		void DrainThreadFunc()
+		{
+			while (!quit_)
+			{
+				{
+					lock_guard<mutex> lock(drain_mutex_);
+					if (this->Drain())
+					{
+						this->FlushSinks();
+					}
+				}
+
+				KlayGE::Sleep(10);
+			}
+		}
+
+		// Must be called with drain_mutex_ locked. Returns true if anything is written.
+		bool Drain()
+		{
+			pending_.clear();
+			{
+				lock_guard<mutex> lock(buffers_mutex_);
+				for (size_t i = 0; i < buffers_.size(); ++ i)
+				{
+					LogThreadBuffer& buffer = *buffers_[i];
+					uint32_t const w = buffer.write_pos.load(memory_order_acquire);
+					for (uint32_t r = buffer.read_pos.load(memory_order_relaxed); r != w; ++ r)
+					{
+						pending_.push_back(&buffer.records[r & (LogThreadBuffer::CAPACITY - 1)]);
+					}
+				}
+			}
+
+			// Messages from different threads are written in the order they are logged
+			std::sort(pending_.begin(), pending_.end(), LessBySeq);
+			for (size_t i = 0; i < pending_.size(); ++ i)
+			{
+				this->Dispatch(pending_[i]->level, pending_[i]->text);
+			}
+
+			{
+				lock_guard<mutex> lock(buffers_mutex_);
+				for (size_t i = 0; i < buffers_.size();)
+				{
+					LogThreadBuffer& buffer = *buffers_[i];
+					uint32_t r = buffer.read_pos.load(memory_order_relaxed);
+					for (size_t j = 0; j < pending_.size(); ++ j)
+					{
+						LogRecord const * begin = &buffer.records[0];
+						if ((pending_[j] >= begin) && (pending_[j] < begin + LogThreadBuffer::CAPACITY))
+						{
+							++ r;
+						}
+					}
+					buffer.read_pos.store(r, memory_order_release);
+
+					// The owner has exited and everything it logged is written
+					if (buffer.retired.load(memory_order_acquire) && (buffer.write_pos.load(memory_order_acquire) == r))
+					{
+						buffers_.erase(buffers_.begin() + i);
+					}
+					else
+					{
+						++ i;
+					}
+				}
+			}
+
+			bool written = !pending_.empty();
+
+			uint32_t const num_dropped = num_dropped_.exchange(0, memory_order_relaxed);
+			if (num_dropped > 0)
+			{
+				char text[64];
+				sprintf(text, "%u messages dropped", num_dropped);
+				this->Dispatch(LL_Warn, text);
+				written = true;
+			}
+			uint32_t const num_suppressed = num_suppressed_.exchange(0, memory_order_relaxed);
+			if (num_suppressed > 0)
+			{
+				char text[64];
+				sprintf(text, "%u messages rate limited", num_suppressed);
+				this->Dispatch(LL_Warn, text);
+				written = true;
+			}
+
+			return written;
+		}
+
+		// Writes the pending records in logging order by merging the rings in place, without the sorting
+		// buffer of Drain. Must be called with buffers_mutex_ locked.
+		void EmergencyDrain()
+		{
+			for (;;)
+			{
+				LogThreadBuffer* next_buffer = nullptr;
+				LogRecord const * next_record = nullptr;
+				for (size_t i = 0; i < buffers_.size(); ++ i)
+				{
+					LogThreadBuffer& buffer = *buffers_[i];
+					uint32_t const r = buffer.read_pos.load(memory_order_relaxed);
+					if (r != buffer.write_pos.load(memory_order_acquire))
+					{
+						LogRecord const & record = buffer.records[r & (LogThreadBuffer::CAPACITY - 1)];
+						if (!next_record || (record.seq < next_record->seq))
+						{
+							next_buffer = &buffer;
+							next_record = &record;
+						}
+					}
+				}
+
+				if (!next_record)
+				{
+					break;
+				}
+
+				this->Dispatch(next_record->level, next_record->text);
+				next_buffer->read_pos.store(next_buffer->read_pos.load(memory_order_relaxed) + 1, memory_order_release);
+			}
+		}
+
+		void Dispatch(LogLevel level, char const * text)
+		{
+			tls_in_sink = true;
+			for (size_t i = 0; i < sinks_.size(); ++ i)
+			{
+				sinks_[i]->Write(level, text);
+			}
+			tls_in_sink = false;
+		}
+
+		void FlushSinks()
+		{
+			tls_in_sink = true;
+			for (size_t i = 0; i < sinks_.size(); ++ i)
+			{
+				sinks_[i]->Flush();
+			}
+			tls_in_sink = false;
+		}
+
+	private:
+		atomic<int> level_;
+		atomic<uint32_t> rate_limit_;
+		atomic<uint32_t> rate_window_;
+		atomic<uint32_t> rate_count_;
+		atomic<uint32_t> num_suppressed_;
+		atomic<uint32_t> num_dropped_;
+		atomic<uint64_t> seq_;
+		Timer timer_;
+
+		uint32_t const generation_;
+		LogThreadKey thread_key_;
+		bool thread_key_valid_;
+
+		atomic<bool> async_;
+		mutex thread_mutex_;
+		shared_ptr<joiner<void> > drain_thread_;
+		volatile bool quit_;
+
+		mutex buffers_mutex_;
+		std::vector<shared_ptr<LogThreadBuffer> > buffers_;
+
+		mutex drain_mutex_;
+		std::vector<LogSinkPtr> sinks_;
+		std::vector<LogRecord*> pending_;
+	};
+
+	// Plain data, so they are set before any dynamic initializer runs. The backend is created by the first
+	// LogInitializer and destroyed by the last one.
+	LogBackend* log_backend = nullptr;
+	uint32_t log_init_count = 0;
+	uint32_t log_generation = 0;
+
+	void LogMessage(LogLevel level, char const * fmt, va_list args)
+	{
+		if (log_backend)
+		{
+			log_backend->Log(level, fmt, args);
+		}
+		else
+		{
+			char text[LogRecord::MAX_TEXT_LENGTH];
+			FormatLogText(text, sizeof(text), fmt, args);
+			WriteDirect(level, text);
+		}
+	}
+
+	int const crash_signals[] = { SIGSEGV, SIGABRT, SIGFPE, SIGILL };
+	typedef void (*SignalHandler)(int);
+	SignalHandler prev_signal_handlers[sizeof(crash_signals) / sizeof(crash_signals[0])];
+	std::terminate_handler prev_terminate_handler = nullptr;
+	bool crash_handler_installed = false;
 
+	void CrashSignalHandler(int sig)
+	{
+		if (log_backend)
+		{
+			log_backend->EmergencyFlush();
+		}
+
+		// Hands the signal over to whatever was installed before, or to the default action
+		SignalHandler prev = SIG_DFL;
+		for (size_t i = 0; i < sizeof(crash_signals) / sizeof(crash_signals[0]); ++ i)
+		{
+			if (crash_signals[i] == sig)
+			{
+				prev = prev_signal_handlers[i];
+				break;
+			}
+		}
+		if ((SIG_ERR == prev) || (SIG_IGN == prev))
+		{
+			prev = SIG_DFL;
+		}
+
+		signal(sig, prev);
+		raise(sig);
+	}
+
+	void CrashTerminateHandler()
+	{
+		if (log_backend)
+		{
+			log_backend->EmergencyFlush();
+		}
+
+		if (prev_terminate_handler)
+		{
+			prev_terminate_handler();
+		}
+		abort();
+	}
+}
+
+namespace KlayGE
+{
+	StreamLogSink::StreamLogSink(std::ostream& os)
+		: os_(os)
+	{
+	}
+
+	void StreamLogSink::Write(LogLevel level, char const * msg)
+	{
+		os_ << log_level_prefixes[level] << msg << '\n';
+	}
+
+	void StreamLogSink::Flush()
+	{
+		os_.flush();
+	}
+
+
+	FileLogSink::FileLogSink(std::string const & file_name)
+		: os_(MakeSharedPtr<std::ofstream>(file_name.c_str()))
+	{
+	}
+
+	void FileLogSink::Write(LogLevel level, char const * msg)
+	{
+		*os_ << log_level_prefixes[level] << msg << '\n';
+	}
+
+	void FileLogSink::Flush()
+	{
+		os_->flush();
+	}
+
+
+	struct MemoryLogSink::Impl
+	{
+		uint32_t max_lines;
+		std::deque<std::string> lines;
+		mutex lines_mutex;
+	};
+
+	MemoryLogSink::MemoryLogSink(uint32_t max_lines)
+		: impl_(MakeSharedPtr<Impl>())
+	{
+		impl_->max_lines = max_lines;
+	}
+
+	void MemoryLogSink::Write(LogLevel level, char const * msg)
+	{
+		lock_guard<mutex> lock(impl_->lines_mutex);
+		impl_->lines.push_back(std::string(log_level_prefixes[level]) + msg);
+		while (impl_->lines.size() > impl_->max_lines)
+		{
+			impl_->lines.pop_front();
+		}
+	}
+
+	void MemoryLogSink::Lines(std::vector<std::string>& lines) const
+	{
+		lock_guard<mutex> lock(impl_->lines_mutex);
+		lines.assign(impl_->lines.begin(), impl_->lines.end());
+	}
+
+	void MemoryLogSink::Clear()
+	{
+		lock_guard<mutex> lock(impl_->lines_mutex);
+		impl_->lines.clear();
+	}
+
+
+	LogInitializer::LogInitializer()
+	{
+		if (0 == log_init_count ++)
+		{
+			++ log_generation;
+			log_backend = new LogBackend(log_generation);
+		}
+	}
+
+	LogInitializer::~LogInitializer()
+	{
+		if (0 == -- log_init_count)
+		{
+			// Anything logged from now on, including by the sinks going away, is written directly
+			LogBackend* backend = log_backend;
+			log_backend = nullptr;
+			delete backend;
+		}
+	}
+
+
+	void LogInfo(char const * fmt, ...)
+	{
+		va_list args;
+		va_start(args, fmt);
+		LogMessage(LL_Info, fmt, args);
+		va_end(args);
+	}
+
+	void LogWarn(char const * fmt, ...)
+	{
+		va_list args;
+		va_start(args, fmt);
+		LogMessage(LL_Warn, fmt, args);
 		va_end(args);
 	}
 
@@ -97,19 +739,88 @@ namespace KlayGE
 	{
 		va_list args;
 		va_start(args, fmt);
+		LogMessage(LL_Error, fmt, args);
+		va_end(args);
+	}
 
-#ifdef KLAYGE_PLATFORM_ANDROID
-		__android_log_vprint(ANDROID_LOG_ERROR, "KlayGE", fmt, args);
-#else
-		char buffer[1024];
-		vsprintf(buffer, fmt, args);
+	void SetLogLevel(LogLevel level)
+	{
+		if (log_backend)
+		{
+			log_backend->Level(level);
+		}
+	}
 
-		std::clog << "(ERROR) KlayGE: " << buffer << std::endl;
-#ifdef KLAYGE_DEBUG
-		log_file << "(ERROR) KlayGE: " << buffer << std::endl;
-#endif
-#endif
+	LogLevel GetLogLevel()
+	{
+		return log_backend ? log_backend->Level() : LL_Info;
+	}
 
-		va_end(args);
+	void SetLogRateLimit(uint32_t max_msgs_per_second)
+	{
+		if (log_backend)
+		{
+			log_backend->RateLimit(max_msgs_per_second);
+		}
+	}
+
+	void AsyncLog(bool async)
+	{
+		if (log_backend)
+		{
+			log_backend->Async(async);
+		}
+	}
+
+	bool AsyncLog()
+	{
+		return log_backend ? log_backend->Async() : false;
+	}
+
+	void AddLogSink(LogSinkPtr const & sink)
+	{
+		if (log_backend)
+		{
+			log_backend->AddSink(sink);
+		}
+	}
+
+	void RemoveLogSink(LogSinkPtr const & sink)
+	{
+		if (log_backend)
+		{
+			log_backend->RemoveSink(sink);
+		}
+	}
+
+	void ClearLogSinks()
+	{
+		if (log_backend)
+		{
+			log_backend->ClearSinks();
+		}
+	}
+
+	void FlushLog()
+	{
+		if (log_backend)
+		{
+			log_backend->Flush();
+		}
+	}
+
+	void InstallLogCrashHandler()
+	{
+		// Installing twice would make the handlers chain to themselves
+		if (!crash_handler_installed)
+		{
+			crash_handler_installed = true;
+
+			for (size_t i = 0; i < sizeof(crash_signals) / sizeof(crash_signals[0]); ++ i)
+			{
+				prev_signal_handlers[i] = signal(crash_signals[i], CrashSignalHandler);
+			}
+			prev_terminate_handler = std::set_terminate(CrashTerminateHandler);
+		}
 	}
 }
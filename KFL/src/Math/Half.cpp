@@ -32,75 +32,91 @@
 
 #include <KFL/Half.hpp>
 
-namespace KlayGE
+#if defined(KLAYGE_F16C_SUPPORT)
+#include <immintrin.h>
+#elif defined(KLAYGE_SSE2_SUPPORT)
+#include <emmintrin.h>
+#elif defined(KLAYGE_NEON_SUPPORT) && defined(__ARM_FP) && (__ARM_FP & 2)
+#include <arm_neon.h>
+#define KLAYGE_NEON_FP16_SUPPORT
+#endif
+
+namespace
 {
-	half::half(float f)
+	using namespace KlayGE;
+
+	// Round to nearest even. Overflow goes to infinity, NaN keeps its sign and the top of its payload, and becomes quiet.
+	// This is exactly what F16C and NEON do, so the batch versions can use them.
+	uint16_t FloatToHalfBits(float f)
 	{
 		union FNI
 		{
 			float f;
-			int32_t i;
+			uint32_t i;
 		} fni;
 		fni.f = f;
-		int32_t i = fni.i;
 
-		int32_t s = (i >> 16) & 0x00008000;
-		int32_t e = ((i >> 23) & 0x000000FF) - (127 - 15);
-		int32_t m = i & 0x007FFFFF;
+		uint32_t const s = (fni.i >> 16) & 0x00008000;
+		uint32_t const abs_i = fni.i & 0x7FFFFFFF;
 
-		if (e <= 0)
+		uint32_t ret;
+		if (abs_i >= ((127 + 16) << 23))
 		{
-			if (e < -10)
+			if (abs_i > 0x7F800000)
 			{
-				value_ = 0;
+				ret = 0x7E00 | ((abs_i >> 13) & 0x03FF);
 			}
 			else
 			{
-				m = (m | 0x00800000) >> (1 - e);
-
-				if (m &  0x00001000)
-				{
-					m += 0x00002000;
-				}
-
-				value_ = static_cast<uint16_t>(s | (m >> 13));
+				ret = 0x7C00;
 			}
 		}
-		else
+		else if (abs_i < ((127 - 14) << 23))
 		{
-			if (0xFF - (127 - 15) == e)
+			// Denormalized or zero
+			uint32_t const e = abs_i >> 23;
+			if (e < 127 - 25)
 			{
-				e = 31;
+				ret = 0;
 			}
 			else
 			{
-				if (m & 0x00001000)
+				uint32_t const m = (abs_i & 0x007FFFFF) | 0x00800000;
+				uint32_t const shift = 126 - e;
+				uint32_t const rem = m & ((1UL << shift) - 1);
+				uint32_t const halfway = 1UL << (shift - 1);
+				ret = m >> shift;
+				if ((rem > halfway) || ((rem == halfway) && (ret & 1)))
 				{
-					m += 0x00002000;
-
-					if (m & 0x00800000)
-					{
-						m = 0;		// overflow in significand,
-						e += 1;		// adjust exponent
-					}
+					++ ret;
 				}
 			}
-
-			value_ = static_cast<uint16_t>(s | (e << 10) | (m >> 13));
 		}
+		else
+		{
+			// Rebias the exponent. A carry out of the significand goes into the exponent, up to infinity.
+			ret = (abs_i - ((127 - 15) << 23) + 0x0FFF + ((abs_i >> 13) & 1)) >> 13;
+		}
+
+		return static_cast<uint16_t>(s | ret);
 	}
 
-	half::operator float() const
+	float HalfBitsToFloat(uint16_t h)
 	{
 		int32_t ret;
 
-		int32_t s = ((value_ & 0x8000) >> 15) << 31;
-		int32_t e = (value_ & 0x7C00) >> 10;
-		int32_t m = value_ & 0x03FF;
+		int32_t s = ((h & 0x8000) >> 15) << 31;
+		int32_t e = (h & 0x7C00) >> 10;
+		int32_t m = h & 0x03FF;
 
 		if (0 == e)
 		{
-			if (m != 0)
+			if (0 == m)
+			{
+				// Plus or minus zero
+				e = -(127 - 15);
+			}
+			else
 			{
 				// Denormalized number -- renormalize it
 
@@ -118,11 +134,8 @@ namespace KlayGE
 		{
 			if (31 == e)
 			{
-				if (m != 0)
-				{
-					// Nan -- preserve sign and significand bits
-					e = 0xFF - (127 - 15);
-				}
+				// Infinity or Nan -- preserve sign and significand bits
+				e = 0xFF - (127 - 15);
 			}
 		}
 
@@ -141,32 +154,101 @@ namespace KlayGE
 		return inf.f;
 	}
 
-	half half::pos_inf()
+#if defined(KLAYGE_SSE2_SUPPORT) && !defined(KLAYGE_F16C_SUPPORT)
+	// 4 floats to 4 halves in the low 16 bits of each lane, same results as FloatToHalfBits
+	__m128i FloatToHalfSSE2(__m128 f)
+	{
+		__m128i const sign_mask = _mm_set1_epi32(0x80000000);
+		__m128i const f16_max = _mm_set1_epi32((127 + 16) << 23);
+		__m128i const min_normal = _mm_set1_epi32((127 - 14) << 23);
+		__m128i const denorm_magic = _mm_set1_epi32(((127 - 15) + (23 - 10) + 1) << 23);
+		__m128i const normal_bias = _mm_set1_epi32(0x0FFF - ((127 - 15) << 23));
+
+		__m128 const just_sign = _mm_and_ps(f, _mm_castsi128_ps(sign_mask));
+		__m128 const abs_f = _mm_xor_ps(f, just_sign);
+		__m128i const abs_i = _mm_castps_si128(abs_f);
+
+		// Infinity and NaN
+		__m128i const is_nan = _mm_castps_si128(_mm_cmpunord_ps(abs_f, abs_f));
+		__m128i const nan_bits = _mm_and_si128(is_nan,
+			_mm_or_si128(_mm_set1_epi32(0x0200), _mm_and_si128(_mm_srli_epi32(abs_i, 13), _mm_set1_epi32(0x03FF))));
+		__m128i const inf_or_nan = _mm_or_si128(nan_bits, _mm_set1_epi32(0x7C00));
+
+		// Denormalized, the float addition does the round to nearest even
+		__m128i const denorm = _mm_sub_epi32(_mm_castps_si128(_mm_add_ps(abs_f, _mm_castsi128_ps(denorm_magic))), denorm_magic);
+
+		// Normalized
+		__m128i const mant_odd = _mm_srai_epi32(_mm_slli_epi32(abs_i, 31 - 13), 31);
+		__m128i const normal = _mm_srli_epi32(_mm_sub_epi32(_mm_add_epi32(abs_i, normal_bias), mant_odd), 13);
+
+		__m128i const is_denorm = _mm_cmpgt_epi32(min_normal, abs_i);
+		__m128i const is_regular = _mm_cmpgt_epi32(f16_max, abs_i);
+		__m128i const finite = _mm_or_si128(_mm_and_si128(is_denorm, denorm), _mm_andnot_si128(is_denorm, normal));
+		__m128i const ret = _mm_or_si128(_mm_and_si128(is_regular, finite), _mm_andnot_si128(is_regular, inf_or_nan));
+
+		// Arithmetic shift, so negative lanes survive the signed saturation of _mm_packs_epi32
+		return _mm_or_si128(ret, _mm_srai_epi32(_mm_castps_si128(just_sign), 16));
+	}
+
+	// 4 halves in the low 16 bits of each lane to 4 floats, same results as HalfBitsToFloat
+	__m128 HalfToFloatSSE2(__m128i h)
+	{
+		__m128i const exp_mant = _mm_and_si128(h, _mm_set1_epi32(0x7FFF));
+		__m128i const just_sign = _mm_xor_si128(h, exp_mant);
+
+		// Multiplying by 2^112 rebiases the exponent, and renormalizes denormalized halves
+		__m128 const scaled = _mm_mul_ps(_mm_castsi128_ps(_mm_slli_epi32(exp_mant, 13)),
+			_mm_castsi128_ps(_mm_set1_epi32((254 - 15) << 23)));
+		__m128i const was_inf_nan = _mm_cmpgt_epi32(exp_mant, _mm_set1_epi32(0x7BFF));
+		__m128 const inf_nan_exp = _mm_and_ps(_mm_castsi128_ps(was_inf_nan), _mm_castsi128_ps(_mm_set1_epi32(0xFF << 23)));
+
+		return _mm_or_ps(_mm_or_ps(scaled, inf_nan_exp), _mm_castsi128_ps(_mm_slli_epi32(just_sign, 16)));
+	}
+#endif
+}
+
+namespace KlayGE
+{
+	half::half(float f)
+		: value_(FloatToHalfBits(f))
+	{
+	}
+
+	half::operator float() const
+	{
+		return HalfBitsToFloat(value_);
+	}
+
+	half half::from_bits(uint16_t bits)
 	{
 		half h;
-		h.value_ = 0x7C00;
+		h.value_ = bits;
 		return h;
 	}
 
+	uint16_t half::bits() const
+	{
+		return value_;
+	}
+
+	half half::pos_inf()
+	{
+		return from_bits(0x7C00);
+	}
+
 	half half::neg_inf()
 	{
-		half h;
-		h.value_ = 0xFC00;
-		return h;
+		return from_bits(0xFC00);
 	}
 
 	half half::q_nan()
 	{
-		half h;
-		h.value_ = 0x7FFF;
-		return h;
+		return from_bits(0x7FFF);
 	}
 
 	half half::s_nan()
 	{
-		half h;
-		h.value_ = 0x7DFF;
-		return h;
+		return from_bits(0x7DFF);
 	}
 
 
@@ -220,4 +302,64 @@ namespace KlayGE
 	{
 		return value_ == rhs.value_;
 	}
+
+
+	void float_to_half_n(half* out, float const * in, size_t num)
+	{
+		KLAYGE_STATIC_ASSERT(sizeof(half) == sizeof(uint16_t), "half must be 16-bit.");
+
+		uint16_t* dst = reinterpret_cast<uint16_t*>(out);
+		size_t i = 0;
+#if defined(KLAYGE_F16C_SUPPORT)
+		for (; i + 8 <= num; i += 8)
+		{
+			_mm_storeu_si128(reinterpret_cast<__m128i*>(dst + i),
+				_mm256_cvtps_ph(_mm256_loadu_ps(in + i), _MM_FROUND_TO_NEAREST_INT));
+		}
+#elif defined(KLAYGE_SSE2_SUPPORT)
+		for (; i + 4 <= num; i += 4)
+		{
+			__m128i const h = FloatToHalfSSE2(_mm_loadu_ps(in + i));
+			_mm_storel_epi64(reinterpret_cast<__m128i*>(dst + i), _mm_packs_epi32(h, h));
+		}
+#elif defined(KLAYGE_NEON_FP16_SUPPORT)
+		for (; i + 4 <= num; i += 4)
+		{
+			vst1_u16(dst + i, vreinterpret_u16_f16(vcvt_f16_f32(vld1q_f32(in + i))));
+		}
+#endif
+		for (; i < num; ++ i)
+		{
+			dst[i] = FloatToHalfBits(in[i]);
+		}
+	}
+
+	void half_to_float_n(float* out, half const * in, size_t num)
+	{
+		KLAYGE_STATIC_ASSERT(sizeof(half) == sizeof(uint16_t), "half must be 16-bit.");
+
+		uint16_t const * src = reinterpret_cast<uint16_t const *>(in);
+		size_t i = 0;
+#if defined(KLAYGE_F16C_SUPPORT)
+		for (; i + 8 <= num; i += 8)
+		{
+			_mm256_storeu_ps(out + i, _mm256_cvtph_ps(_mm_loadu_si128(reinterpret_cast<__m128i const *>(src + i))));
+		}
+#elif defined(KLAYGE_SSE2_SUPPORT)
+		for (; i + 4 <= num; i += 4)
+		{
+			__m128i const h = _mm_loadl_epi64(reinterpret_cast<__m128i const *>(src + i));
+			_mm_storeu_ps(out + i, HalfToFloatSSE2(_mm_unpacklo_epi16(h, _mm_setzero_si128())));
+		}
+#elif defined(KLAYGE_NEON_FP16_SUPPORT)
+		for (; i + 4 <= num; i += 4)
+		{
+			vst1q_f32(out + i, vcvt_f32_f16(vreinterpret_f16_u16(vld1_u16(src + i))));
+		}
+#endif
+		for (; i < num; ++ i)
+		{
+			out[i] = HalfBitsToFloat(src[i]);
+		}
+	}
 }
@@ -30,9 +30,123 @@
 
 #include <KFL/KFL.hpp>
 #include <KFL/Detail/MathHelper.hpp>
+#include <KFL/Detail/MathSIMD.hpp>
 
 #include <KFL/Math.hpp>
 
+namespace
+{
+	using namespace KlayGE;
+
+	// Fills the corners of the silhouette of the box seen from view_pos. Returns -1 if view_pos is inside the box.
+	template <typename T>
+	int PerspectiveAreaHull(Vector_T<T, 3>* corners, Vector_T<T, 3> const & view_pos, AABBox_T<T> const & aabbox)
+	{
+		static uint32_t const HULL_VERTEX[64][7] = 
+		{
+			{ 0, 0, 0, 0, 0, 0, 0 },
+			{ 0, 4, 7, 3, 0, 0, 4 },
+			{ 1, 2, 6, 5, 0, 0, 4 },
+			{ 0, 0, 0, 0, 0, 0, 0 },
+			{ 0, 1, 5, 4, 0, 0, 4 },
+			{ 0, 1, 5, 4, 7, 3, 6 },
+			{ 0, 1, 2, 6, 5, 4, 6 },
+			{ 0, 0, 0, 0, 0, 0, 0 },
+			{ 2, 3, 7, 6, 0, 0, 4 },
+			{ 4, 7, 6, 2, 3, 0, 6 },
+			{ 2, 3, 7, 6, 5, 1, 6 },
+			{ 0, 0, 0, 0, 0, 0, 0 },
+			{ 0, 0, 0, 0, 0, 0, 0 },
+			{ 0, 0, 0, 0, 0, 0, 0 },
+			{ 0, 0, 0, 0, 0, 0, 0 },
+			{ 0, 0, 0, 0, 0, 0, 0 },
+			{ 0, 3, 2, 1, 0, 0, 4 },
+			{ 0, 4, 7, 3, 2, 1, 6 },
+			{ 0, 3, 2, 6, 5, 1, 6 },
+			{ 0, 0, 0, 0, 0, 0, 0 },
+			{ 0, 3, 2, 1, 5, 4, 6 },
+			{ 2, 1, 5, 4, 7, 3, 6 },
+			{ 0, 3, 2, 6, 5, 4, 6 },
+			{ 0, 0, 0, 0, 0, 0, 0 },
+			{ 0, 3, 7, 6, 2, 1, 6 },
+			{ 0, 4, 7, 6, 2, 1, 6 },
+			{ 0, 3, 7, 6, 5, 1, 6 },
+			{ 0, 0, 0, 0, 0, 0, 0 },
+			{ 0, 0, 0, 0, 0, 0, 0 },
+			{ 0, 0, 0, 0, 0, 0, 0 },
+			{ 0, 0, 0, 0, 0, 0, 0 },
+			{ 0, 0, 0, 0, 0, 0, 0 },
+			{ 4, 5, 6, 7, 0, 0, 4 },
+			{ 4, 5, 6, 7, 3, 0, 6 },
+			{ 1, 2, 6, 7, 4, 5, 6 },
+			{ 0, 0, 0, 0, 0, 0, 0 },
+			{ 0, 1, 5, 6, 7, 4, 6 },
+			{ 0, 1, 5, 6, 7, 3, 6 },
+			{ 0, 1, 2, 6, 7, 4, 6 },
+			{ 0, 0, 0, 0, 0, 0, 0 },
+			{ 2, 3, 7, 4, 5, 6, 6 },
+			{ 0, 4, 5, 6, 2, 3, 6 },
+			{ 1, 2, 3, 7, 4, 5, 6 },
+			{ 0, 0, 0, 0, 0, 0, 0 },
+			{ 0, 0, 0, 0, 0, 0, 0 },
+			{ 0, 0, 0, 0, 0, 0, 0 },
+			{ 0, 0, 0, 0, 0, 0, 0 },
+			{ 0, 0, 0, 0, 0, 0, 0 },
+			{ 0, 0, 0, 0, 0, 0, 0 },
+			{ 0, 0, 0, 0, 0, 0, 0 },
+			{ 0, 0, 0, 0, 0, 0, 0 },
+			{ 0, 0, 0, 0, 0, 0, 0 },
+			{ 0, 0, 0, 0, 0, 0, 0 },
+			{ 0, 0, 0, 0, 0, 0, 0 },
+			{ 0, 0, 0, 0, 0, 0, 0 },
+			{ 0, 0, 0, 0, 0, 0, 0 },
+			{ 0, 0, 0, 0, 0, 0, 0 },
+			{ 0, 0, 0, 0, 0, 0, 0 },
+			{ 0, 0, 0, 0, 0, 0, 0 },
+			{ 0, 0, 0, 0, 0, 0, 0 },
+			{ 0, 0, 0, 0, 0, 0, 0 },
+			{ 0, 0, 0, 0, 0, 0, 0 },
+			{ 0, 0, 0, 0, 0, 0, 0 },
+			{ 0, 0, 0, 0, 0, 0, 0 }
+		};
+
+		uint32_t const pos = ((view_pos.x() < aabbox.Min().x()))
+			| ((view_pos.x() > aabbox.Max().x()) << 1)
+			| ((view_pos.y() < aabbox.Min().y()) << 2)
+			| ((view_pos.y() > aabbox.Max().y()) << 3)
+			| ((view_pos.z() < aabbox.Min().z()) << 4)
+			| ((view_pos.z() > aabbox.Max().z()) << 5);
+		if (0 == pos)
+		{
+			return -1;
+		}
+		uint32_t const num = HULL_VERTEX[pos][6];
+		for (uint32_t i = 0; i < num; ++ i)
+		{
+			corners[i] = aabbox.Corner(HULL_VERTEX[pos][i]);
+		}
+		return static_cast<int>(num);
+	}
+
+	// Area of the projected silhouette, in the [0, 1] screen space
+	template <typename T>
+	T PerspectiveAreaHullArea(Vector_T<T, 3>* dst, int num)
+	{
+		for (int i = 0; i < num; ++ i)
+		{
+			dst[i] = dst[i] * T(0.5) + Vector_T<T, 3>(0.5, 0.5, 0.0);
+		}
+
+		T sum = 0;
+		for (int i = 0; i < num; ++ i)
+		{
+			int next = (i + 1) % num;
+			sum += MathLib::abs((dst[i].x() - dst[next].x()) * (dst[i].y() + dst[next].y()));
+		}
+		return sum / 2;
+	}
+}
+
 namespace KlayGE
 {
 	namespace MathLib
@@ -343,7 +457,7 @@ namespace KlayGE
 		template <typename T>
 		Vector_T<typename T::value_type, 4> transform(T const & v, Matrix4_T<typename T::value_type> const & mat)
 		{
-			return detail::transform_helper<typename T::value_type, T::elem_num>::Do(v, mat);
+			return detail::transform_simd(v, mat);
 		}
 
 		template float2 transform_coord(float2 const & v, float4x4 const & mat);
@@ -354,7 +468,7 @@ namespace KlayGE
 		{
 			KLAYGE_STATIC_ASSERT(T::elem_num < 4, "Must be at most 4D vector.");
 
-			Vector_T<typename T::value_type, 4> temp(detail::transform_helper<typename T::value_type, T::elem_num>::Do(v, mat));
+			Vector_T<typename T::value_type, 4> temp(detail::transform_simd(v, mat));
 			Vector_T<typename T::value_type, T::elem_num> ret(&temp[0]);
 			if (equal(temp.w(), typename T::value_type(0)))
 			{
@@ -375,7 +489,7 @@ namespace KlayGE
 		{
 			KLAYGE_STATIC_ASSERT(T::elem_num < 4, "Must be at most 4D vector.");
 
-			return detail::transform_normal_helper<typename T::value_type, T::elem_num>::Do(v, mat);
+			return detail::transform_normal_simd(v, mat);
 		}
 
 		template float1 bary_centric(float1 const & v1, float1 const & v2, float1 const & v3, float const & f, float const & g);
@@ -626,104 +740,17 @@ namespace KlayGE
 		template <typename T>
 		T perspective_area(Vector_T<T, 3> const & view_pos, Matrix4_T<T> const & view_proj, AABBox_T<T> const & aabbox)
 		{
-			static uint32_t const HULL_VERTEX[64][7] = 
-			{
-				{ 0, 0, 0, 0, 0, 0, 0 },
-				{ 0, 4, 7, 3, 0, 0, 4 },
-				{ 1, 2, 6, 5, 0, 0, 4 },
-				{ 0, 0, 0, 0, 0, 0, 0 },
-				{ 0, 1, 5, 4, 0, 0, 4 },
-				{ 0, 1, 5, 4, 7, 3, 6 },
-				{ 0, 1, 2, 6, 5, 4, 6 },
-				{ 0, 0, 0, 0, 0, 0, 0 },
-				{ 2, 3, 7, 6, 0, 0, 4 },
-				{ 4, 7, 6, 2, 3, 0, 6 },
-				{ 2, 3, 7, 6, 5, 1, 6 },
-				{ 0, 0, 0, 0, 0, 0, 0 },
-				{ 0, 0, 0, 0, 0, 0, 0 },
-				{ 0, 0, 0, 0, 0, 0, 0 },
-				{ 0, 0, 0, 0, 0, 0, 0 },
-				{ 0, 0, 0, 0, 0, 0, 0 },
-				{ 0, 3, 2, 1, 0, 0, 4 },
-				{ 0, 4, 7, 3, 2, 1, 6 },
-				{ 0, 3, 2, 6, 5, 1, 6 },
-				{ 0, 0, 0, 0, 0, 0, 0 },
-				{ 0, 3, 2, 1, 5, 4, 6 },
-				{ 2, 1, 5, 4, 7, 3, 6 },
-				{ 0, 3, 2, 6, 5, 4, 6 },
-				{ 0, 0, 0, 0, 0, 0, 0 },
-				{ 0, 3, 7, 6, 2, 1, 6 },
-				{ 0, 4, 7, 6, 2, 1, 6 },
-				{ 0, 3, 7, 6, 5, 1, 6 },
-				{ 0, 0, 0, 0, 0, 0, 0 },
-				{ 0, 0, 0, 0, 0, 0, 0 },
-				{ 0, 0, 0, 0, 0, 0, 0 },
-				{ 0, 0, 0, 0, 0, 0, 0 },
-				{ 0, 0, 0, 0, 0, 0, 0 },
-				{ 4, 5, 6, 7, 0, 0, 4 },
-				{ 4, 5, 6, 7, 3, 0, 6 },
-				{ 1, 2, 6, 7, 4, 5, 6 },
-				{ 0, 0, 0, 0, 0, 0, 0 },
-				{ 0, 1, 5, 6, 7, 4, 6 },
-				{ 0, 1, 5, 6, 7, 3, 6 },
-				{ 0, 1, 2, 6, 7, 4, 6 },
-				{ 0, 0, 0, 0, 0, 0, 0 },
-				{ 2, 3, 7, 4, 5, 6, 6 },
-				{ 0, 4, 5, 6, 2, 3, 6 },
-				{ 1, 2, 3, 7, 4, 5, 6 },
-				{ 0, 0, 0, 0, 0, 0, 0 },
-				{ 0, 0, 0, 0, 0, 0, 0 },
-				{ 0, 0, 0, 0, 0, 0, 0 },
-				{ 0, 0, 0, 0, 0, 0, 0 },
-				{ 0, 0, 0, 0, 0, 0, 0 },
-				{ 0, 0, 0, 0, 0, 0, 0 },
-				{ 0, 0, 0, 0, 0, 0, 0 },
-				{ 0, 0, 0, 0, 0, 0, 0 },
-				{ 0, 0, 0, 0, 0, 0, 0 },
-				{ 0, 0, 0, 0, 0, 0, 0 },
-				{ 0, 0, 0, 0, 0, 0, 0 },
-				{ 0, 0, 0, 0, 0, 0, 0 },
-				{ 0, 0, 0, 0, 0, 0, 0 },
-				{ 0, 0, 0, 0, 0, 0, 0 },
-				{ 0, 0, 0, 0, 0, 0, 0 },
-				{ 0, 0, 0, 0, 0, 0, 0 },
-				{ 0, 0, 0, 0, 0, 0, 0 },
-				{ 0, 0, 0, 0, 0, 0, 0 },
-				{ 0, 0, 0, 0, 0, 0, 0 },
-				{ 0, 0, 0, 0, 0, 0, 0 },
-				{ 0, 0, 0, 0, 0, 0, 0 }
-			};
-
-			uint32_t const pos = ((view_pos.x() < aabbox.Min().x()))
-				| ((view_pos.x() > aabbox.Max().x()) << 1)
-				| ((view_pos.y() < aabbox.Min().y()) << 2)
-				| ((view_pos.y() > aabbox.Max().y()) << 3)
-				| ((view_pos.z() < aabbox.Min().z()) << 4)
-				| ((view_pos.z() > aabbox.Max().z()) << 5);
-			if (0 == pos)
+			Vector_T<T, 3> corners[6];
+			int const num = PerspectiveAreaHull(corners, view_pos, aabbox);
+			if (num < 0)
 			{
 				return 1;
 			}
-			uint32_t const num = HULL_VERTEX[pos][6];
-			if (0 == num)
-			{
-				return 0;
-			}
-
-			Vector_T<T, 3> dst[8];
-			for (uint32_t i = 0; i < num; ++ i)
-			{
-				dst[i] = MathLib::transform_coord(aabbox.Corner(HULL_VERTEX[pos][i]), view_proj);
-				dst[i] = dst[i] * T(0.5) + Vector_T<T, 3>(0.5, 0.5, 0.0);
-			}
 
-			T sum = 0;
-			for (uint32_t i = 0; i < num; ++ i)
-			{
-				int next = (i + 1) % num;
-				sum += abs((dst[i].x() - dst[next].x()) * (dst[i].y() + dst[next].y()));
-			}
-			return sum / 2;
+			// The silhouette corners are projected in one batch
+			Vector_T<T, 3> dst[6];
+			transform_coord_array(dst, corners, num, view_proj);
+			return PerspectiveAreaHullArea(dst, num);
 		}
 
 
@@ -758,28 +785,7 @@ namespace KlayGE
 		template <typename T>
 		Matrix4_T<T> mul(Matrix4_T<T> const & lhs, Matrix4_T<T> const & rhs)
 		{
-			Matrix4_T<T> const tmp(transpose(rhs));
-
-			return Matrix4_T<T>(
-				lhs(0, 0) * tmp(0, 0) + lhs(0, 1) * tmp(0, 1) + lhs(0, 2) * tmp(0, 2) + lhs(0, 3) * tmp(0, 3),
-				lhs(0, 0) * tmp(1, 0) + lhs(0, 1) * tmp(1, 1) + lhs(0, 2) * tmp(1, 2) + lhs(0, 3) * tmp(1, 3),
-				lhs(0, 0) * tmp(2, 0) + lhs(0, 1) * tmp(2, 1) + lhs(0, 2) * tmp(2, 2) + lhs(0, 3) * tmp(2, 3),
-				lhs(0, 0) * tmp(3, 0) + lhs(0, 1) * tmp(3, 1) + lhs(0, 2) * tmp(3, 2) + lhs(0, 3) * tmp(3, 3),
-
-				lhs(1, 0) * tmp(0, 0) + lhs(1, 1) * tmp(0, 1) + lhs(1, 2) * tmp(0, 2) + lhs(1, 3) * tmp(0, 3),
-				lhs(1, 0) * tmp(1, 0) + lhs(1, 1) * tmp(1, 1) + lhs(1, 2) * tmp(1, 2) + lhs(1, 3) * tmp(1, 3),
-				lhs(1, 0) * tmp(2, 0) + lhs(1, 1) * tmp(2, 1) + lhs(1, 2) * tmp(2, 2) + lhs(1, 3) * tmp(2, 3),
-				lhs(1, 0) * tmp(3, 0) + lhs(1, 1) * tmp(3, 1) + lhs(1, 2) * tmp(3, 2) + lhs(1, 3) * tmp(3, 3),
-
-				lhs(2, 0) * tmp(0, 0) + lhs(2, 1) * tmp(0, 1) + lhs(2, 2) * tmp(0, 2) + lhs(2, 3) * tmp(0, 3),
-				lhs(2, 0) * tmp(1, 0) + lhs(2, 1) * tmp(1, 1) + lhs(2, 2) * tmp(1, 2) + lhs(2, 3) * tmp(1, 3),
-				lhs(2, 0) * tmp(2, 0) + lhs(2, 1) * tmp(2, 1) + lhs(2, 2) * tmp(2, 2) + lhs(2, 3) * tmp(2, 3),
-				lhs(2, 0) * tmp(3, 0) + lhs(2, 1) * tmp(3, 1) + lhs(2, 2) * tmp(3, 2) + lhs(2, 3) * tmp(3, 3),
-
-				lhs(3, 0) * tmp(0, 0) + lhs(3, 1) * tmp(0, 1) + lhs(3, 2) * tmp(0, 2) + lhs(3, 3) * tmp(0, 3),
-				lhs(3, 0) * tmp(1, 0) + lhs(3, 1) * tmp(1, 1) + lhs(3, 2) * tmp(1, 2) + lhs(3, 3) * tmp(1, 3),
-				lhs(3, 0) * tmp(2, 0) + lhs(3, 1) * tmp(2, 1) + lhs(3, 2) * tmp(2, 2) + lhs(3, 3) * tmp(2, 3),
-				lhs(3, 0) * tmp(3, 0) + lhs(3, 1) * tmp(3, 1) + lhs(3, 2) * tmp(3, 2) + lhs(3, 3) * tmp(3, 3));
+			return detail::mul_simd(lhs, rhs);
 		}
 
 		template float determinant(float4x4 const & rhs);
@@ -805,56 +811,7 @@ namespace KlayGE
 		template <typename T>
 		Matrix4_T<T> inverse(Matrix4_T<T> const & rhs)
 		{
-			T const _2132_2231(rhs(1, 0) * rhs(2, 1) - rhs(1, 1) * rhs(2, 0));
-			T const _2133_2331(rhs(1, 0) * rhs(2, 2) - rhs(1, 2) * rhs(2, 0));
-			T const _2134_2431(rhs(1, 0) * rhs(2, 3) - rhs(1, 3) * rhs(2, 0));
-			T const _2142_2241(rhs(1, 0) * rhs(3, 1) - rhs(1, 1) * rhs(3, 0));
-			T const _2143_2341(rhs(1, 0) * rhs(3, 2) - rhs(1, 2) * rhs(3, 0));
-			T const _2144_2441(rhs(1, 0) * rhs(3, 3) - rhs(1, 3) * rhs(3, 0));
-			T const _2233_2332(rhs(1, 1) * rhs(2, 2) - rhs(1, 2) * rhs(2, 1));
-			T const _2234_2432(rhs(1, 1) * rhs(2, 3) - rhs(1, 3) * rhs(2, 1));
-			T const _2243_2342(rhs(1, 1) * rhs(3, 2) - rhs(1, 2) * rhs(3, 1));
-			T const _2244_2442(rhs(1, 1) * rhs(3, 3) - rhs(1, 3) * rhs(3, 1));
-			T const _2334_2433(rhs(1, 2) * rhs(2, 3) - rhs(1, 3) * rhs(2, 2));
-			T const _2344_2443(rhs(1, 2) * rhs(3, 3) - rhs(1, 3) * rhs(3, 2));
-			T const _3142_3241(rhs(2, 0) * rhs(3, 1) - rhs(2, 1) * rhs(3, 0));
-			T const _3143_3341(rhs(2, 0) * rhs(3, 2) - rhs(2, 2) * rhs(3, 0));
-			T const _3144_3441(rhs(2, 0) * rhs(3, 3) - rhs(2, 3) * rhs(3, 0));
-			T const _3243_3342(rhs(2, 1) * rhs(3, 2) - rhs(2, 2) * rhs(3, 1));
-			T const _3244_3442(rhs(2, 1) * rhs(3, 3) - rhs(2, 3) * rhs(3, 1));
-			T const _3344_3443(rhs(2, 2) * rhs(3, 3) - rhs(2, 3) * rhs(3, 2));
-
-			// ʽֵ
-			T const det(determinant(rhs));
-			if (equal<T>(det, 0))
-			{
-				return rhs;
-			}
-			else
-			{
-				T invDet(T(1) / det);
-
-				return Matrix4_T<T>(
-					+invDet * (rhs(1, 1) * _3344_3443 - rhs(1, 2) * _3244_3442 + rhs(1, 3) * _3243_3342),
-					-invDet * (rhs(0, 1) * _3344_3443 - rhs(0, 2) * _3244_3442 + rhs(0, 3) * _3243_3342),
-					+invDet * (rhs(0, 1) * _2344_2443 - rhs(0, 2) * _2244_2442 + rhs(0, 3) * _2243_2342),
-					-invDet * (rhs(0, 1) * _2334_2433 - rhs(0, 2) * _2234_2432 + rhs(0, 3) * _2233_2332),
-
-					-invDet * (rhs(1, 0) * _3344_3443 - rhs(1, 2) * _3144_3441 + rhs(1, 3) * _3143_3341),
-					+invDet * (rhs(0, 0) * _3344_3443 - rhs(0, 2) * _3144_3441 + rhs(0, 3) * _3143_3341),
-					-invDet * (rhs(0, 0) * _2344_2443 - rhs(0, 2) * _2144_2441 + rhs(0, 3) * _2143_2341),
-					+invDet * (rhs(0, 0) * _2334_2433 - rhs(0, 2) * _2134_2431 + rhs(0, 3) * _2133_2331),
-
-					+invDet * (rhs(1, 0) * _3244_3442 - rhs(1, 1) * _3144_3441 + rhs(1, 3) * _3142_3241),
-					-invDet * (rhs(0, 0) * _3244_3442 - rhs(0, 1) * _3144_3441 + rhs(0, 3) * _3142_3241),
-					+invDet * (rhs(0, 0) * _2244_2442 - rhs(0, 1) * _2144_2441 + rhs(0, 3) * _2142_2241),
-					-invDet * (rhs(0, 0) * _2234_2432 - rhs(0, 1) * _2134_2431 + rhs(0, 3) * _2132_2231),
-
-					-invDet * (rhs(1, 0) * _3243_3342 - rhs(1, 1) * _3143_3341 + rhs(1, 2) * _3142_3241),
-					+invDet * (rhs(0, 0) * _3243_3342 - rhs(0, 1) * _3143_3341 + rhs(0, 2) * _3142_3241),
-					-invDet * (rhs(0, 0) * _2243_2342 - rhs(0, 1) * _2143_2341 + rhs(0, 2) * _2142_2241),
-					+invDet * (rhs(0, 0) * _2233_2332 - rhs(0, 1) * _2133_2331 + rhs(0, 2) * _2132_2231));
-			}
+			return detail::inverse_simd(rhs);
 		}
 
 		template float4x4 look_at_lh(float3 const & vEye, float3 const & vAt);
@@ -1177,30 +1134,7 @@ namespace KlayGE
 		template <typename T>
 		void decompose(Vector_T<T, 3>& scale, Quaternion_T<T>& rot, Vector_T<T, 3>& trans, Matrix4_T<T> const & rhs)
 		{
-			scale.x() = sqrt(rhs(0, 0) * rhs(0, 0) + rhs(0, 1) * rhs(0, 1) + rhs(0, 2) * rhs(0, 2));
-			scale.y() = sqrt(rhs(1, 0) * rhs(1, 0) + rhs(1, 1) * rhs(1, 1) + rhs(1, 2) * rhs(1, 2));
-			scale.z() = sqrt(rhs(2, 0) * rhs(2, 0) + rhs(2, 1) * rhs(2, 1) + rhs(2, 2) * rhs(2, 2));
-
-			trans = Vector_T<T, 3>(rhs(3, 0), rhs(3, 1), rhs(3, 2));
-
-			Matrix4_T<T> rot_mat;
-			rot_mat(0, 0) = rhs(0, 0) / scale.x();
-			rot_mat(0, 1) = rhs(0, 1) / scale.x();
-			rot_mat(0, 2) = rhs(0, 2) / scale.x();
-			rot_mat(0, 3) = 0;
-			rot_mat(1, 0) = rhs(1, 0) / scale.y();
-			rot_mat(1, 1) = rhs(1, 1) / scale.y();
-			rot_mat(1, 2) = rhs(1, 2) / scale.y();
-			rot_mat(1, 3) = 0;
-			rot_mat(2, 0) = rhs(2, 0) / scale.z();
-			rot_mat(2, 1) = rhs(2, 1) / scale.z();
-			rot_mat(2, 2) = rhs(2, 2) / scale.z();
-			rot_mat(2, 3) = 0;
-			rot_mat(3, 0) = 0;
-			rot_mat(3, 1) = 0;
-			rot_mat(3, 2) = 0;
-			rot_mat(3, 3) = 1;
-			rot = to_quaternion(rot_mat);
+			detail::decompose_simd(scale, rot, trans, rhs);
 		}
 
 		template float4x4 transformation(float3 const * scaling_center, Quaternion const * scaling_rotation, float3 const * scale,
@@ -1432,11 +1366,7 @@ namespace KlayGE
 		template <typename T>
 		Quaternion_T<T> mul(Quaternion_T<T> const & lhs, Quaternion_T<T> const & rhs)
 		{
-			return Quaternion_T<T>(
-				lhs.x() * rhs.w() - lhs.y() * rhs.z() + lhs.z() * rhs.y() + lhs.w() * rhs.x(),
-				lhs.x() * rhs.z() + lhs.y() * rhs.w() - lhs.z() * rhs.x() + lhs.w() * rhs.y(),
-				lhs.y() * rhs.x() - lhs.x() * rhs.y() + lhs.z() * rhs.w() + lhs.w() * rhs.z(),
-				lhs.w() * rhs.w() - lhs.x() * rhs.x() - lhs.y() * rhs.y() - lhs.z() * rhs.z());
+			return detail::mul_simd(lhs, rhs);
 		}
 
 		template Quaternion rotation_quat_yaw_pitch_roll(float const & yaw, float const & pitch, float const & roll);
@@ -1658,36 +1588,7 @@ namespace KlayGE
 		template <typename T>
 		Quaternion_T<T> slerp(Quaternion_T<T> const & lhs, Quaternion_T<T> const & rhs, T s)
 		{
-			T scale0, scale1;
-
-			// DOT the quats to get the cosine of the angle between them
-			T cosom = dot(lhs, rhs);
-
-			T dir = T(1);
-			if (cosom < 0)
-			{
-				dir = T(-1);
-				cosom = -cosom;
-			}
-
-			// make sure they are different enough to avoid a divide by 0
-			if (cosom < T(1) - std::numeric_limits<T>::epsilon())
-			{
-				// SLERP away
-				T const omega = acos(cosom);
-				T const isinom = T(1) / sin(omega);
-				scale0 = sin((T(1) - s) * omega) * isinom;
-				scale1 = sin(s * omega) * isinom;
-			}
-			else
-			{
-				// LERP is good enough at this distance
-				scale0 = T(1) - s;
-				scale1 = s;
-			}
-
-			// Compute the result
-			return scale0 * lhs + dir * scale1 * rhs;
+			return detail::slerp_simd(lhs, rhs, s);
 		}
 
 		template void squad_setup(Quaternion& a, Quaternion& b, Quaternion& c,
@@ -3258,4 +3159,201 @@ namespace KlayGE
 			return dif_dq;
 		}
 	}
+
+	namespace detail
+	{
+		template float4x4 mul_scalar(float4x4 const & lhs, float4x4 const & rhs);
+
+		template <typename T>
+		Matrix4_T<T> mul_scalar(Matrix4_T<T> const & lhs, Matrix4_T<T> const & rhs)
+		{
+			Matrix4_T<T> const tmp(MathLib::transpose(rhs));
+
+			return Matrix4_T<T>(
+				lhs(0, 0) * tmp(0, 0) + lhs(0, 1) * tmp(0, 1) + lhs(0, 2) * tmp(0, 2) + lhs(0, 3) * tmp(0, 3),
+				lhs(0, 0) * tmp(1, 0) + lhs(0, 1) * tmp(1, 1) + lhs(0, 2) * tmp(1, 2) + lhs(0, 3) * tmp(1, 3),
+				lhs(0, 0) * tmp(2, 0) + lhs(0, 1) * tmp(2, 1) + lhs(0, 2) * tmp(2, 2) + lhs(0, 3) * tmp(2, 3),
+				lhs(0, 0) * tmp(3, 0) + lhs(0, 1) * tmp(3, 1) + lhs(0, 2) * tmp(3, 2) + lhs(0, 3) * tmp(3, 3),
+
+				lhs(1, 0) * tmp(0, 0) + lhs(1, 1) * tmp(0, 1) + lhs(1, 2) * tmp(0, 2) + lhs(1, 3) * tmp(0, 3),
+				lhs(1, 0) * tmp(1, 0) + lhs(1, 1) * tmp(1, 1) + lhs(1, 2) * tmp(1, 2) + lhs(1, 3) * tmp(1, 3),
+				lhs(1, 0) * tmp(2, 0) + lhs(1, 1) * tmp(2, 1) + lhs(1, 2) * tmp(2, 2) + lhs(1, 3) * tmp(2, 3),
+				lhs(1, 0) * tmp(3, 0) + lhs(1, 1) * tmp(3, 1) + lhs(1, 2) * tmp(3, 2) + lhs(1, 3) * tmp(3, 3),
+
+				lhs(2, 0) * tmp(0, 0) + lhs(2, 1) * tmp(0, 1) + lhs(2, 2) * tmp(0, 2) + lhs(2, 3) * tmp(0, 3),
+				lhs(2, 0) * tmp(1, 0) + lhs(2, 1) * tmp(1, 1) + lhs(2, 2) * tmp(1, 2) + lhs(2, 3) * tmp(1, 3),
+				lhs(2, 0) * tmp(2, 0) + lhs(2, 1) * tmp(2, 1) + lhs(2, 2) * tmp(2, 2) + lhs(2, 3) * tmp(2, 3),
+				lhs(2, 0) * tmp(3, 0) + lhs(2, 1) * tmp(3, 1) + lhs(2, 2) * tmp(3, 2) + lhs(2, 3) * tmp(3, 3),
+
+				lhs(3, 0) * tmp(0, 0) + lhs(3, 1) * tmp(0, 1) + lhs(3, 2) * tmp(0, 2) + lhs(3, 3) * tmp(0, 3),
+				lhs(3, 0) * tmp(1, 0) + lhs(3, 1) * tmp(1, 1) + lhs(3, 2) * tmp(1, 2) + lhs(3, 3) * tmp(1, 3),
+				lhs(3, 0) * tmp(2, 0) + lhs(3, 1) * tmp(2, 1) + lhs(3, 2) * tmp(2, 2) + lhs(3, 3) * tmp(2, 3),
+				lhs(3, 0) * tmp(3, 0) + lhs(3, 1) * tmp(3, 1) + lhs(3, 2) * tmp(3, 2) + lhs(3, 3) * tmp(3, 3));
+		}
+
+		template Quaternion mul_scalar(Quaternion const & lhs, Quaternion const & rhs);
+
+		template <typename T>
+		Quaternion_T<T> mul_scalar(Quaternion_T<T> const & lhs, Quaternion_T<T> const & rhs)
+		{
+			return Quaternion_T<T>(
+				lhs.x() * rhs.w() - lhs.y() * rhs.z() + lhs.z() * rhs.y() + lhs.w() * rhs.x(),
+				lhs.x() * rhs.z() + lhs.y() * rhs.w() - lhs.z() * rhs.x() + lhs.w() * rhs.y(),
+				lhs.y() * rhs.x() - lhs.x() * rhs.y() + lhs.z() * rhs.w() + lhs.w() * rhs.z(),
+				lhs.w() * rhs.w() - lhs.x() * rhs.x() - lhs.y() * rhs.y() - lhs.z() * rhs.z());
+		}
+
+		template float4x4 inverse_scalar(float4x4 const & rhs);
+
+		template <typename T>
+		Matrix4_T<T> inverse_scalar(Matrix4_T<T> const & rhs)
+		{
+			T const _2132_2231(rhs(1, 0) * rhs(2, 1) - rhs(1, 1) * rhs(2, 0));
+			T const _2133_2331(rhs(1, 0) * rhs(2, 2) - rhs(1, 2) * rhs(2, 0));
+			T const _2134_2431(rhs(1, 0) * rhs(2, 3) - rhs(1, 3) * rhs(2, 0));
+			T const _2142_2241(rhs(1, 0) * rhs(3, 1) - rhs(1, 1) * rhs(3, 0));
+			T const _2143_2341(rhs(1, 0) * rhs(3, 2) - rhs(1, 2) * rhs(3, 0));
+			T const _2144_2441(rhs(1, 0) * rhs(3, 3) - rhs(1, 3) * rhs(3, 0));
+			T const _2233_2332(rhs(1, 1) * rhs(2, 2) - rhs(1, 2) * rhs(2, 1));
+			T const _2234_2432(rhs(1, 1) * rhs(2, 3) - rhs(1, 3) * rhs(2, 1));
+			T const _2243_2342(rhs(1, 1) * rhs(3, 2) - rhs(1, 2) * rhs(3, 1));
+			T const _2244_2442(rhs(1, 1) * rhs(3, 3) - rhs(1, 3) * rhs(3, 1));
+			T const _2334_2433(rhs(1, 2) * rhs(2, 3) - rhs(1, 3) * rhs(2, 2));
+			T const _2344_2443(rhs(1, 2) * rhs(3, 3) - rhs(1, 3) * rhs(3, 2));
+			T const _3142_3241(rhs(2, 0) * rhs(3, 1) - rhs(2, 1) * rhs(3, 0));
+			T const _3143_3341(rhs(2, 0) * rhs(3, 2) - rhs(2, 2) * rhs(3, 0));
+			T const _3144_3441(rhs(2, 0) * rhs(3, 3) - rhs(2, 3) * rhs(3, 0));
+			T const _3243_3342(rhs(2, 1) * rhs(3, 2) - rhs(2, 2) * rhs(3, 1));
+			T const _3244_3442(rhs(2, 1) * rhs(3, 3) - rhs(2, 3) * rhs(3, 1));
+			T const _3344_3443(rhs(2, 2) * rhs(3, 3) - rhs(2, 3) * rhs(3, 2));
+
+			// ʽֵ
+			T const det(MathLib::determinant(rhs));
+			if (MathLib::equal<T>(det, 0))
+			{
+				return rhs;
+			}
+			else
+			{
+				T invDet(T(1) / det);
+
+				return Matrix4_T<T>(
+					+invDet * (rhs(1, 1) * _3344_3443 - rhs(1, 2) * _3244_3442 + rhs(1, 3) * _3243_3342),
+					-invDet * (rhs(0, 1) * _3344_3443 - rhs(0, 2) * _3244_3442 + rhs(0, 3) * _3243_3342),
+					+invDet * (rhs(0, 1) * _2344_2443 - rhs(0, 2) * _2244_2442 + rhs(0, 3) * _2243_2342),
+					-invDet * (rhs(0, 1) * _2334_2433 - rhs(0, 2) * _2234_2432 + rhs(0, 3) * _2233_2332),
+
+					-invDet * (rhs(1, 0) * _3344_3443 - rhs(1, 2) * _3144_3441 + rhs(1, 3) * _3143_3341),
+					+invDet * (rhs(0, 0) * _3344_3443 - rhs(0, 2) * _3144_3441 + rhs(0, 3) * _3143_3341),
+					-invDet * (rhs(0, 0) * _2344_2443 - rhs(0, 2) * _2144_2441 + rhs(0, 3) * _2143_2341),
+					+invDet * (rhs(0, 0) * _2334_2433 - rhs(0, 2) * _2134_2431 + rhs(0, 3) * _2133_2331),
+
+					+invDet * (rhs(1, 0) * _3244_3442 - rhs(1, 1) * _3144_3441 + rhs(1, 3) * _3142_3241),
+					-invDet * (rhs(0, 0) * _3244_3442 - rhs(0, 1) * _3144_3441 + rhs(0, 3) * _3142_3241),
+					+invDet * (rhs(0, 0) * _2244_2442 - rhs(0, 1) * _2144_2441 + rhs(0, 3) * _2142_2241),
+					-invDet * (rhs(0, 0) * _2234_2432 - rhs(0, 1) * _2134_2431 + rhs(0, 3) * _2132_2231),
+
+					-invDet * (rhs(1, 0) * _3243_3342 - rhs(1, 1) * _3143_3341 + rhs(1, 2) * _3142_3241),
+					+invDet * (rhs(0, 0) * _3243_3342 - rhs(0, 1) * _3143_3341 + rhs(0, 2) * _3142_3241),
+					-invDet * (rhs(0, 0) * _2243_2342 - rhs(0, 1) * _2143_2341 + rhs(0, 2) * _2142_2241),
+					+invDet * (rhs(0, 0) * _2233_2332 - rhs(0, 1) * _2133_2331 + rhs(0, 2) * _2132_2231));
+			}
+		}
+
+		template Quaternion slerp_scalar(Quaternion const & lhs, Quaternion const & rhs, float s);
+
+		template <typename T>
+		Quaternion_T<T> slerp_scalar(Quaternion_T<T> const & lhs, Quaternion_T<T> const & rhs, T s)
+		{
+			T scale0, scale1;
+
+			// DOT the quats to get the cosine of the angle between them
+			T cosom = MathLib::dot(lhs, rhs);
+
+			T dir = T(1);
+			if (cosom < 0)
+			{
+				dir = T(-1);
+				cosom = -cosom;
+			}
+
+			// make sure they are different enough to avoid a divide by 0
+			if (cosom < T(1) - std::numeric_limits<T>::epsilon())
+			{
+				// SLERP away
+				T const omega = MathLib::acos(cosom);
+				T const isinom = T(1) / MathLib::sin(omega);
+				scale0 = MathLib::sin((T(1) - s) * omega) * isinom;
+				scale1 = MathLib::sin(s * omega) * isinom;
+			}
+			else
+			{
+				// LERP is good enough at this distance
+				scale0 = T(1) - s;
+				scale1 = s;
+			}
+
+			// Compute the result
+			return scale0 * lhs + dir * scale1 * rhs;
+		}
+
+		template void decompose_scalar(float3& scale, Quaternion& rot, float3& trans, float4x4 const & rhs);
+
+		template <typename T>
+		void decompose_scalar(Vector_T<T, 3>& scale, Quaternion_T<T>& rot, Vector_T<T, 3>& trans, Matrix4_T<T> const & rhs)
+		{
+			scale.x() = MathLib::sqrt(rhs(0, 0) * rhs(0, 0) + rhs(0, 1) * rhs(0, 1) + rhs(0, 2) * rhs(0, 2));
+			scale.y() = MathLib::sqrt(rhs(1, 0) * rhs(1, 0) + rhs(1, 1) * rhs(1, 1) + rhs(1, 2) * rhs(1, 2));
+			scale.z() = MathLib::sqrt(rhs(2, 0) * rhs(2, 0) + rhs(2, 1) * rhs(2, 1) + rhs(2, 2) * rhs(2, 2));
+
+			trans = Vector_T<T, 3>(rhs(3, 0), rhs(3, 1), rhs(3, 2));
+
+			Matrix4_T<T> rot_mat;
+			rot_mat(0, 0) = rhs(0, 0) / scale.x();
+			rot_mat(0, 1) = rhs(0, 1) / scale.x();
+			rot_mat(0, 2) = rhs(0, 2) / scale.x();
+			rot_mat(0, 3) = 0;
+			rot_mat(1, 0) = rhs(1, 0) / scale.y();
+			rot_mat(1, 1) = rhs(1, 1) / scale.y();
+			rot_mat(1, 2) = rhs(1, 2) / scale.y();
+			rot_mat(1, 3) = 0;
+			rot_mat(2, 0) = rhs(2, 0) / scale.z();
+			rot_mat(2, 1) = rhs(2, 1) / scale.z();
+			rot_mat(2, 2) = rhs(2, 2) / scale.z();
+			rot_mat(2, 3) = 0;
+			rot_mat(3, 0) = 0;
+			rot_mat(3, 1) = 0;
+			rot_mat(3, 2) = 0;
+			rot_mat(3, 3) = 1;
+			rot = MathLib::to_quaternion(rot_mat);
+		}
+
+		template float perspective_area_scalar(float3 const & view_pos, float4x4 const & view_proj, AABBox const & aabbox);
+
+		template <typename T>
+		T perspective_area_scalar(Vector_T<T, 3> const & view_pos, Matrix4_T<T> const & view_proj, AABBox_T<T> const & aabbox)
+		{
+			Vector_T<T, 3> corners[6];
+			int const num = PerspectiveAreaHull(corners, view_pos, aabbox);
+			if (num < 0)
+			{
+				return 1;
+			}
+
+			Vector_T<T, 3> dst[6];
+			for (int i = 0; i < num; ++ i)
+			{
+				Vector_T<T, 4> const v = transform_scalar(corners[i], view_proj);
+				if (MathLib::equal(v.w(), T(0)))
+				{
+					dst[i] = Vector_T<T, 3>::Zero();
+				}
+				else
+				{
+					dst[i] = Vector_T<T, 3>(&v[0]) / v.w();
+				}
+			}
+			return PerspectiveAreaHullArea(dst, num);
+		}
+	}
 }
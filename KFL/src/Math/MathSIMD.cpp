@@ -0,0 +1,659 @@
+/**
+ * @file MathSIMD.cpp
+ * @author Minmin Gong
+ *
+ * @section DESCRIPTION
+ *
+ * This source file is part of KFL, a subproject of KlayGE
+ * For the latest info, see http://www.klayge.org
+ *
+ * @section LICENSE
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published
+ * by the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+ *
+ * You may alternatively use this source under the terms of
+ * the KlayGE Proprietary License (KPL). You can obtained such a license
+ * from http://www.klayge.org/licensing/.
+ */
+
+#include <KFL/KFL.hpp>
+#include <KFL/Math.hpp>
+#include <KFL/Detail/MathSIMD.hpp>
+
+#if defined(KLAYGE_SSE_SUPPORT)
+#include <xmmintrin.h>
+#elif defined(KLAYGE_NEON_SUPPORT)
+#include <arm_neon.h>
+#endif
+
+#ifdef KLAYGE_MATH_SIMD_SUPPORT
+
+namespace
+{
+	using namespace KlayGE;
+
+	// All loads and stores are unaligned, float4/float4x4/Quaternion have no alignment requirement.
+
+#if defined(KLAYGE_SSE_SUPPORT)
+	typedef __m128 simd_float4;
+
+	simd_float4 Load(float const * p)
+	{
+		return _mm_loadu_ps(p);
+	}
+
+	simd_float4 Set(float x, float y, float z, float w)
+	{
+		return _mm_setr_ps(x, y, z, w);
+	}
+
+	void Store(float* p, simd_float4 v)
+	{
+		_mm_storeu_ps(p, v);
+	}
+
+	template <int N>
+	simd_float4 Splat(simd_float4 v)
+	{
+		return _mm_shuffle_ps(v, v, _MM_SHUFFLE(N, N, N, N));
+	}
+
+	simd_float4 Add(simd_float4 lhs, simd_float4 rhs)
+	{
+		return _mm_add_ps(lhs, rhs);
+	}
+
+	simd_float4 Sub(simd_float4 lhs, simd_float4 rhs)
+	{
+		return _mm_sub_ps(lhs, rhs);
+	}
+
+	simd_float4 Mul(simd_float4 lhs, simd_float4 rhs)
+	{
+		return _mm_mul_ps(lhs, rhs);
+	}
+
+	// a * b + c
+	simd_float4 MulAdd(simd_float4 a, simd_float4 b, simd_float4 c)
+	{
+		return _mm_add_ps(_mm_mul_ps(a, b), c);
+	}
+
+	// (w, z, y, x)
+	simd_float4 SwizzleWZYX(simd_float4 v)
+	{
+		return _mm_shuffle_ps(v, v, _MM_SHUFFLE(0, 1, 2, 3));
+	}
+
+	// (z, w, x, y)
+	simd_float4 SwizzleZWXY(simd_float4 v)
+	{
+		return _mm_shuffle_ps(v, v, _MM_SHUFFLE(1, 0, 3, 2));
+	}
+
+	// (y, x, w, z)
+	simd_float4 SwizzleYXWZ(simd_float4 v)
+	{
+		return _mm_shuffle_ps(v, v, _MM_SHUFFLE(2, 3, 0, 1));
+	}
+
+	// (lo[A], lo[B], hi[C], hi[D])
+	template <int A, int B, int C, int D>
+	simd_float4 Shuffle(simd_float4 lo, simd_float4 hi)
+	{
+		return _mm_shuffle_ps(lo, hi, _MM_SHUFFLE(D, C, B, A));
+	}
+
+	float X(simd_float4 v)
+	{
+		return _mm_cvtss_f32(v);
+	}
+#elif defined(KLAYGE_NEON_SUPPORT)
+	typedef float32x4_t simd_float4;
+
+	simd_float4 Load(float const * p)
+	{
+		return vld1q_f32(p);
+	}
+
+	simd_float4 Set(float x, float y, float z, float w)
+	{
+		float const v[] = { x, y, z, w };
+		return vld1q_f32(v);
+	}
+
+	void Store(float* p, simd_float4 v)
+	{
+		vst1q_f32(p, v);
+	}
+
+	template <int N>
+	simd_float4 Splat(simd_float4 v)
+	{
+		return vdupq_n_f32(vgetq_lane_f32(v, N));
+	}
+
+	simd_float4 Add(simd_float4 lhs, simd_float4 rhs)
+	{
+		return vaddq_f32(lhs, rhs);
+	}
+
+	simd_float4 Sub(simd_float4 lhs, simd_float4 rhs)
+	{
+		return vsubq_f32(lhs, rhs);
+	}
+
+	simd_float4 Mul(simd_float4 lhs, simd_float4 rhs)
+	{
+		return vmulq_f32(lhs, rhs);
+	}
+
+	// a * b + c
+	simd_float4 MulAdd(simd_float4 a, simd_float4 b, simd_float4 c)
+	{
+		return vmlaq_f32(c, a, b);
+	}
+
+	// (w, z, y, x)
+	simd_float4 SwizzleWZYX(simd_float4 v)
+	{
+		return vrev64q_f32(vcombine_f32(vget_high_f32(v), vget_low_f32(v)));
+	}
+
+	// (z, w, x, y)
+	simd_float4 SwizzleZWXY(simd_float4 v)
+	{
+		return vcombine_f32(vget_high_f32(v), vget_low_f32(v));
+	}
+
+	// (y, x, w, z)
+	simd_float4 SwizzleYXWZ(simd_float4 v)
+	{
+		return vrev64q_f32(v);
+	}
+
+	// (lo[A], lo[B], hi[C], hi[D])
+	template <int A, int B, int C, int D>
+	simd_float4 Shuffle(simd_float4 lo, simd_float4 hi)
+	{
+		simd_float4 ret = vdupq_n_f32(vgetq_lane_f32(lo, A));
+		ret = vsetq_lane_f32(vgetq_lane_f32(lo, B), ret, 1);
+		ret = vsetq_lane_f32(vgetq_lane_f32(hi, C), ret, 2);
+		return vsetq_lane_f32(vgetq_lane_f32(hi, D), ret, 3);
+	}
+
+	float X(simd_float4 v)
+	{
+		return vgetq_lane_f32(v, 0);
+	}
+#endif
+
+	float Dot(simd_float4 lhs, simd_float4 rhs)
+	{
+		simd_float4 t = Mul(lhs, rhs);
+		t = Add(t, SwizzleZWXY(t));
+		return X(Add(t, SwizzleYXWZ(t)));
+	}
+
+	struct SIMDMatrix
+	{
+		simd_float4 r[4];
+	};
+
+	SIMDMatrix Load(float4x4 const & mat)
+	{
+		SIMDMatrix ret;
+		ret.r[0] = Load(&mat(0, 0));
+		ret.r[1] = Load(&mat(1, 0));
+		ret.r[2] = Load(&mat(2, 0));
+		ret.r[3] = Load(&mat(3, 0));
+		return ret;
+	}
+
+	SIMDMatrix Transpose(SIMDMatrix const & mat)
+	{
+		simd_float4 const t0 = Shuffle<0, 1, 0, 1>(mat.r[0], mat.r[1]);
+		simd_float4 const t1 = Shuffle<2, 3, 2, 3>(mat.r[0], mat.r[1]);
+		simd_float4 const t2 = Shuffle<0, 1, 0, 1>(mat.r[2], mat.r[3]);
+		simd_float4 const t3 = Shuffle<2, 3, 2, 3>(mat.r[2], mat.r[3]);
+
+		SIMDMatrix ret;
+		ret.r[0] = Shuffle<0, 2, 0, 2>(t0, t2);
+		ret.r[1] = Shuffle<1, 3, 1, 3>(t0, t2);
+		ret.r[2] = Shuffle<0, 2, 0, 2>(t1, t3);
+		ret.r[3] = Shuffle<1, 3, 1, 3>(t1, t3);
+		return ret;
+	}
+
+	// Row vector times matrix
+	simd_float4 Transform(simd_float4 v, SIMDMatrix const & mat)
+	{
+		simd_float4 ret = Mul(Splat<0>(v), mat.r[0]);
+		ret = MulAdd(Splat<1>(v), mat.r[1], ret);
+		ret = MulAdd(Splat<2>(v), mat.r[2], ret);
+		return MulAdd(Splat<3>(v), mat.r[3], ret);
+	}
+
+	// Each row of the product is the row of lhs transformed by rhs. Rows are written as soon as they are computed,
+	// so out can be the same as lhs.
+	void MulMatrix(float4x4& out, float4x4 const & lhs, SIMDMatrix const & rhs)
+	{
+		simd_float4 const r0 = Transform(Load(&lhs(0, 0)), rhs);
+		simd_float4 const r1 = Transform(Load(&lhs(1, 0)), rhs);
+		simd_float4 const r2 = Transform(Load(&lhs(2, 0)), rhs);
+		simd_float4 const r3 = Transform(Load(&lhs(3, 0)), rhs);
+		Store(&out(0, 0), r0);
+		Store(&out(1, 0), r1);
+		Store(&out(2, 0), r2);
+		Store(&out(3, 0), r3);
+	}
+
+	// out = lhs.x * (rw, rz, -ry, -rx) + lhs.y * (-rz, rw, rx, -ry) + lhs.z * (ry, -rx, rw, -rz) + lhs.w * r
+	simd_float4 MulQuat(simd_float4 lhs, simd_float4 rhs)
+	{
+		simd_float4 const sign_x = Set(+1, +1, -1, -1);
+		simd_float4 const sign_y = Set(-1, +1, +1, -1);
+		simd_float4 const sign_z = Set(+1, -1, +1, -1);
+
+		simd_float4 ret = Mul(Splat<3>(lhs), rhs);
+		ret = MulAdd(Splat<0>(lhs), Mul(SwizzleWZYX(rhs), sign_x), ret);
+		ret = MulAdd(Splat<1>(lhs), Mul(SwizzleZWXY(rhs), sign_y), ret);
+		return MulAdd(Splat<2>(lhs), Mul(SwizzleYXWZ(rhs), sign_z), ret);
+	}
+
+	simd_float4 LoadPoint(float3 const & v)
+	{
+		return Set(v.x(), v.y(), v.z(), 1);
+	}
+
+	simd_float4 LoadNormal(float3 const & v)
+	{
+		return Set(v.x(), v.y(), v.z(), 0);
+	}
+
+	float3 StoreCoord(simd_float4 v)
+	{
+		float4 tmp;
+		Store(&tmp[0], v);
+		float3 ret(&tmp[0]);
+		if (MathLib::equal(tmp.w(), 0.0f))
+		{
+			ret = float3::Zero();
+		}
+		else
+		{
+			ret /= tmp.w();
+		}
+		return ret;
+	}
+
+	float3 StoreNormal(simd_float4 v)
+	{
+		float4 tmp;
+		Store(&tmp[0], v);
+		return float3(&tmp[0]);
+	}
+}
+
+namespace KlayGE
+{
+	namespace detail
+	{
+		float4x4 mul_simd(float4x4 const & lhs, float4x4 const & rhs)
+		{
+			float4x4 ret;
+			MulMatrix(ret, lhs, Load(rhs));
+			return ret;
+		}
+
+		Quaternion mul_simd(Quaternion const & lhs, Quaternion const & rhs)
+		{
+			Quaternion ret;
+			Store(&ret[0], MulQuat(Load(&lhs[0]), Load(&rhs[0])));
+			return ret;
+		}
+
+		float4 transform_simd(float4 const & v, float4x4 const & mat)
+		{
+			float4 ret;
+			Store(&ret[0], Transform(Load(&v[0]), Load(mat)));
+			return ret;
+		}
+
+		float4 transform_simd(float3 const & v, float4x4 const & mat)
+		{
+			float4 ret;
+			Store(&ret[0], Transform(LoadPoint(v), Load(mat)));
+			return ret;
+		}
+
+		float3 transform_normal_simd(float3 const & v, float4x4 const & mat)
+		{
+			return StoreNormal(Transform(LoadNormal(v), Load(mat)));
+		}
+
+		// Cramer's rule on the transposed matrix. The 2x2 sub-determinants of the lower and upper halves are
+		// computed 4 at a time, then combined into the cofactors of each column.
+		float4x4 inverse_simd(float4x4 const & rhs)
+		{
+			SIMDMatrix const mt = Transpose(Load(rhs));
+
+			simd_float4 v00 = Shuffle<0, 0, 1, 1>(mt.r[2], mt.r[2]);
+			simd_float4 v10 = Shuffle<2, 3, 2, 3>(mt.r[3], mt.r[3]);
+			simd_float4 v01 = Shuffle<0, 0, 1, 1>(mt.r[0], mt.r[0]);
+			simd_float4 v11 = Shuffle<2, 3, 2, 3>(mt.r[1], mt.r[1]);
+			simd_float4 v02 = Shuffle<0, 2, 0, 2>(mt.r[2], mt.r[0]);
+			simd_float4 v12 = Shuffle<1, 3, 1, 3>(mt.r[3], mt.r[1]);
+
+			simd_float4 d0 = Mul(v00, v10);
+			simd_float4 d1 = Mul(v01, v11);
+			simd_float4 d2 = Mul(v02, v12);
+
+			v00 = Shuffle<2, 3, 2, 3>(mt.r[2], mt.r[2]);
+			v10 = Shuffle<0, 0, 1, 1>(mt.r[3], mt.r[3]);
+			v01 = Shuffle<2, 3, 2, 3>(mt.r[0], mt.r[0]);
+			v11 = Shuffle<0, 0, 1, 1>(mt.r[1], mt.r[1]);
+			v02 = Shuffle<1, 3, 1, 3>(mt.r[2], mt.r[0]);
+			v12 = Shuffle<0, 2, 0, 2>(mt.r[3], mt.r[1]);
+
+			d0 = Sub(d0, Mul(v00, v10));
+			d1 = Sub(d1, Mul(v01, v11));
+			d2 = Sub(d2, Mul(v02, v12));
+
+			// (d0.y, d0.w, d2.y, d2.y)
+			v11 = Shuffle<1, 3, 1, 1>(d0, d2);
+			v00 = Shuffle<1, 2, 0, 1>(mt.r[1], mt.r[1]);
+			v10 = Shuffle<2, 0, 3, 0>(v11, d0);
+			v01 = Shuffle<2, 0, 1, 0>(mt.r[0], mt.r[0]);
+			v11 = Shuffle<1, 2, 1, 2>(v11, d0);
+			// (d1.y, d1.w, d2.w, d2.w)
+			simd_float4 v13 = Shuffle<1, 3, 3, 3>(d1, d2);
+			v02 = Shuffle<1, 2, 0, 1>(mt.r[3], mt.r[3]);
+			v12 = Shuffle<2, 0, 3, 0>(v13, d1);
+			simd_float4 v03 = Shuffle<2, 0, 1, 0>(mt.r[2], mt.r[2]);
+			v13 = Shuffle<1, 2, 1, 2>(v13, d1);
+
+			simd_float4 c0 = Mul(v00, v10);
+			simd_float4 c2 = Mul(v01, v11);
+			simd_float4 c4 = Mul(v02, v12);
+			simd_float4 c6 = Mul(v03, v13);
+
+			// (d0.x, d0.y, d2.x, d2.x)
+			v11 = Shuffle<0, 1, 0, 0>(d0, d2);
+			v00 = Shuffle<2, 3, 1, 2>(mt.r[1], mt.r[1]);
+			v10 = Shuffle<3, 0, 1, 2>(d0, v11);
+			v01 = Shuffle<3, 2, 3, 1>(mt.r[0], mt.r[0]);
+			v11 = Shuffle<2, 1, 2, 0>(d0, v11);
+			// (d1.x, d1.y, d2.z, d2.z)
+			v13 = Shuffle<0, 1, 2, 2>(d1, d2);
+			v02 = Shuffle<2, 3, 1, 2>(mt.r[3], mt.r[3]);
+			v12 = Shuffle<3, 0, 1, 2>(d1, v13);
+			v03 = Shuffle<3, 2, 3, 1>(mt.r[2], mt.r[2]);
+			v13 = Shuffle<2, 1, 2, 0>(d1, v13);
+
+			c0 = Sub(c0, Mul(v00, v10));
+			c2 = Sub(c2, Mul(v01, v11));
+			c4 = Sub(c4, Mul(v02, v12));
+			c6 = Sub(c6, Mul(v03, v13));
+
+			v00 = Shuffle<3, 0, 3, 0>(mt.r[1], mt.r[1]);
+			// (d0.z, d0.z, d2.x, d2.y)
+			v10 = Shuffle<2, 2, 0, 1>(d0, d2);
+			v10 = Shuffle<0, 3, 2, 0>(v10, v10);
+			v01 = Shuffle<1, 3, 0, 2>(mt.r[0], mt.r[0]);
+			// (d0.x, d0.w, d2.x, d2.y)
+			v11 = Shuffle<0, 3, 0, 1>(d0, d2);
+			v11 = Shuffle<3, 0, 1, 2>(v11, v11);
+			v02 = Shuffle<3, 0, 3, 0>(mt.r[3], mt.r[3]);
+			// (d1.z, d1.z, d2.z, d2.w)
+			v12 = Shuffle<2, 2, 2, 3>(d1, d2);
+			v12 = Shuffle<0, 3, 2, 0>(v12, v12);
+			v03 = Shuffle<1, 3, 0, 2>(mt.r[2], mt.r[2]);
+			// (d1.x, d1.w, d2.z, d2.w)
+			v13 = Shuffle<0, 3, 2, 3>(d1, d2);
+			v13 = Shuffle<3, 0, 1, 2>(v13, v13);
+
+			v00 = Mul(v00, v10);
+			v01 = Mul(v01, v11);
+			v02 = Mul(v02, v12);
+			v03 = Mul(v03, v13);
+
+			simd_float4 const c1 = Sub(c0, v00);
+			c0 = Add(c0, v00);
+			simd_float4 const c3 = Add(c2, v01);
+			c2 = Sub(c2, v01);
+			simd_float4 const c5 = Sub(c4, v02);
+			c4 = Add(c4, v02);
+			simd_float4 const c7 = Add(c6, v03);
+			c6 = Sub(c6, v03);
+
+			c0 = Shuffle<0, 2, 1, 3>(c0, c1);
+			c2 = Shuffle<0, 2, 1, 3>(c2, c3);
+			c4 = Shuffle<0, 2, 1, 3>(c4, c5);
+			c6 = Shuffle<0, 2, 1, 3>(c6, c7);
+			c0 = Shuffle<0, 2, 1, 3>(c0, c0);
+			c2 = Shuffle<0, 2, 1, 3>(c2, c2);
+			c4 = Shuffle<0, 2, 1, 3>(c4, c4);
+			c6 = Shuffle<0, 2, 1, 3>(c6, c6);
+
+			float const det = Dot(c0, mt.r[0]);
+			if (MathLib::equal(det, 0.0f))
+			{
+				return rhs;
+			}
+
+			float const inv_det = 1 / det;
+			simd_float4 const inv_det4 = Set(inv_det, inv_det, inv_det, inv_det);
+			float4x4 ret;
+			Store(&ret(0, 0), Mul(c0, inv_det4));
+			Store(&ret(1, 0), Mul(c2, inv_det4));
+			Store(&ret(2, 0), Mul(c4, inv_det4));
+			Store(&ret(3, 0), Mul(c6, inv_det4));
+			return ret;
+		}
+
+		// The angle terms stay scalar, the dot product and the blend are done in 4 lanes
+		Quaternion slerp_simd(Quaternion const & lhs, Quaternion const & rhs, float s)
+		{
+			simd_float4 const l = Load(&lhs[0]);
+			simd_float4 const r = Load(&rhs[0]);
+
+			float cosom = Dot(l, r);
+			float dir = 1;
+			if (cosom < 0)
+			{
+				dir = -1;
+				cosom = -cosom;
+			}
+
+			float scale0, scale1;
+			if (cosom < 1 - std::numeric_limits<float>::epsilon())
+			{
+				float const omega = MathLib::acos(cosom);
+				float const isinom = 1 / MathLib::sin(omega);
+				scale0 = MathLib::sin((1 - s) * omega) * isinom;
+				scale1 = MathLib::sin(s * omega) * isinom;
+			}
+			else
+			{
+				scale0 = 1 - s;
+				scale1 = s;
+			}
+			scale1 *= dir;
+
+			Quaternion ret;
+			Store(&ret[0], MulAdd(Set(scale0, scale0, scale0, scale0), l, Mul(Set(scale1, scale1, scale1, scale1), r)));
+			return ret;
+		}
+
+		// The row lengths come from three 4-lane dot products, the rotation rows are scaled in 4 lanes with
+		// the 4th column masked out.
+		void decompose_simd(float3& scale, Quaternion& rot, float3& trans, float4x4 const & rhs)
+		{
+			simd_float4 const mask = Set(1, 1, 1, 0);
+			simd_float4 const r0 = Mul(Load(&rhs(0, 0)), mask);
+			simd_float4 const r1 = Mul(Load(&rhs(1, 0)), mask);
+			simd_float4 const r2 = Mul(Load(&rhs(2, 0)), mask);
+
+			scale.x() = MathLib::sqrt(Dot(r0, r0));
+			scale.y() = MathLib::sqrt(Dot(r1, r1));
+			scale.z() = MathLib::sqrt(Dot(r2, r2));
+
+			trans = float3(rhs(3, 0), rhs(3, 1), rhs(3, 2));
+
+			float const inv_x = 1 / scale.x();
+			float const inv_y = 1 / scale.y();
+			float const inv_z = 1 / scale.z();
+
+			float4x4 rot_mat;
+			Store(&rot_mat(0, 0), Mul(r0, Set(inv_x, inv_x, inv_x, inv_x)));
+			Store(&rot_mat(1, 0), Mul(r1, Set(inv_y, inv_y, inv_y, inv_y)));
+			Store(&rot_mat(2, 0), Mul(r2, Set(inv_z, inv_z, inv_z, inv_z)));
+			Store(&rot_mat(3, 0), Set(0, 0, 0, 1));
+			rot = MathLib::to_quaternion(rot_mat);
+		}
+	}
+
+	namespace MathLib
+	{
+		void transform_array(float4* out, float4 const * in, size_t num, float4x4 const & mat)
+		{
+			SIMDMatrix const m = Load(mat);
+			for (size_t i = 0; i < num; ++ i)
+			{
+				Store(&out[i][0], Transform(Load(&in[i][0]), m));
+			}
+		}
+
+		void transform_array(float4* out, float3 const * in, size_t num, float4x4 const & mat)
+		{
+			SIMDMatrix const m = Load(mat);
+			for (size_t i = 0; i < num; ++ i)
+			{
+				Store(&out[i][0], Transform(LoadPoint(in[i]), m));
+			}
+		}
+
+		void transform_coord_array(float3* out, float3 const * in, size_t num, float4x4 const & mat)
+		{
+			SIMDMatrix const m = Load(mat);
+			for (size_t i = 0; i < num; ++ i)
+			{
+				out[i] = StoreCoord(Transform(LoadPoint(in[i]), m));
+			}
+		}
+
+		void transform_normal_array(float3* out, float3 const * in, size_t num, float4x4 const & mat)
+		{
+			SIMDMatrix const m = Load(mat);
+			for (size_t i = 0; i < num; ++ i)
+			{
+				out[i] = StoreNormal(Transform(LoadNormal(in[i]), m));
+			}
+		}
+
+		void mul_array(float4x4* out, float4x4 const * lhs, float4x4 const * rhs, size_t num)
+		{
+			for (size_t i = 0; i < num; ++ i)
+			{
+				MulMatrix(out[i], lhs[i], Load(rhs[i]));
+			}
+		}
+
+		void mul_array(float4x4* out, float4x4 const * lhs, float4x4 const & rhs, size_t num)
+		{
+			SIMDMatrix const m = Load(rhs);
+			for (size_t i = 0; i < num; ++ i)
+			{
+				MulMatrix(out[i], lhs[i], m);
+			}
+		}
+
+		void mul_array(Quaternion* out, Quaternion const * lhs, Quaternion const * rhs, size_t num)
+		{
+			for (size_t i = 0; i < num; ++ i)
+			{
+				Store(&out[i][0], MulQuat(Load(&lhs[i][0]), Load(&rhs[i][0])));
+			}
+		}
+	}
+}
+
+#else
+
+namespace KlayGE
+{
+	namespace MathLib
+	{
+		void transform_array(float4* out, float4 const * in, size_t num, float4x4 const & mat)
+		{
+			for (size_t i = 0; i < num; ++ i)
+			{
+				out[i] = transform(in[i], mat);
+			}
+		}
+
+		void transform_array(float4* out, float3 const * in, size_t num, float4x4 const & mat)
+		{
+			for (size_t i = 0; i < num; ++ i)
+			{
+				out[i] = transform(in[i], mat);
+			}
+		}
+
+		void transform_coord_array(float3* out, float3 const * in, size_t num, float4x4 const & mat)
+		{
+			for (size_t i = 0; i < num; ++ i)
+			{
+				out[i] = transform_coord(in[i], mat);
+			}
+		}
+
+		void transform_normal_array(float3* out, float3 const * in, size_t num, float4x4 const & mat)
+		{
+			for (size_t i = 0; i < num; ++ i)
+			{
+				out[i] = transform_normal(in[i], mat);
+			}
+		}
+
+		void mul_array(float4x4* out, float4x4 const * lhs, float4x4 const * rhs, size_t num)
+		{
+			for (size_t i = 0; i < num; ++ i)
+			{
+				out[i] = mul(lhs[i], rhs[i]);
+			}
+		}
+
+		void mul_array(float4x4* out, float4x4 const * lhs, float4x4 const & rhs, size_t num)
+		{
+			float4x4 const m = rhs;
+			for (size_t i = 0; i < num; ++ i)
+			{
+				out[i] = mul(lhs[i], m);
+			}
+		}
+
+		void mul_array(Quaternion* out, Quaternion const * lhs, Quaternion const * rhs, size_t num)
+		{
+			for (size_t i = 0; i < num; ++ i)
+			{
+				out[i] = mul(lhs[i], rhs[i]);
+			}
+		}
+	}
+}
+
+#endif
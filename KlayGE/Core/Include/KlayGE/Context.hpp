@@ -56,6 +56,7 @@ namespace KlayGE
 		bool deferred_rendering;
 
 		bool perf_profiler;
+		bool memory_tracker;
 		bool location_sensor;
 	};
 
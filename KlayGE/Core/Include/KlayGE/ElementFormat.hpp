@@ -890,6 +890,9 @@ namespace KlayGE
 
 	KLAYGE_CORE_API void ConvertToABGR32F(ElementFormat fmt, void const * input, uint32_t num_elems, Color* output);
 	KLAYGE_CORE_API void ConvertFromABGR32F(ElementFormat fmt, Color const * input, uint32_t num_elems, void* output);
+	// Common pairs are converted directly, the others go through ABGR32F.
+	// output can be the same as input if dst_fmt is not larger than src_fmt.
+	KLAYGE_CORE_API void ConvertFormat(ElementFormat dst_fmt, void* output, ElementFormat src_fmt, void const * input, uint32_t num_elems);
 
 
 	enum ElementAccessHint
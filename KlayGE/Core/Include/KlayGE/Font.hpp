@@ -49,6 +49,44 @@ namespace KlayGE
 {
 	class FontRenderable;
 
+	// A text that is laid out once and drawn many times. The glyph quads are cached, and only rebuilt when
+	// the text, size, color, position or rect changes, or when its glyphs are evicted from the font texture.
+	class KLAYGE_CORE_API RetainedText
+	{
+		friend class FontRenderable;
+
+	public:
+		RetainedText();
+
+		void Text(std::wstring const & text);
+		std::wstring const & Text() const;
+		void FontSize(float font_size);
+		float FontSize() const;
+		void TextColor(Color const & clr);
+		Color const & TextColor() const;
+		void Scale(float x_scale, float y_scale);
+
+		void Position(float x, float y, float z);
+		// Lays the text out in a rect instead of from a position
+		void Region(Rect const & rc, float z, uint32_t align);
+
+	private:
+		struct Layout;
+
+		std::wstring text_;
+		float font_size_;
+		Color clr_;
+		float x_scale_, y_scale_;
+
+		bool in_rect_;
+		float x_, y_, z_;
+		Rect rc_;
+		uint32_t align_;
+
+		bool dirty_;
+		shared_ptr<Layout> layout_;
+	};
+
 	// 3Dл
 	/////////////////////////////////////////////////////////////////////////////////
 	class KLAYGE_CORE_API Font
@@ -77,6 +115,8 @@ namespace KlayGE
 		Font(shared_ptr<FontRenderable> const & fr, uint32_t flags);
 
 		Size_T<float> CalcSize(std::wstring const & text, float font_size);
+		// Decodes the glyphs of a text that is going to be rendered, in background
+		void Prefetch(std::wstring const & text);
 		void RenderText(float x, float y, Color const & clr,
 			std::wstring const & text, float font_size);
 		void RenderText(float x, float y, float z, float xScale, float yScale, Color const & clr,
@@ -84,6 +124,9 @@ namespace KlayGE
 		void RenderText(Rect const & rc, float z, float xScale, float yScale, Color const & clr,
 			std::wstring const & text, float font_size, uint32_t align);
 		void RenderText(float4x4 const & mvp, Color const & clr, std::wstring const & text, float font_size);
+		void RenderText(RetainedTextPtr const & text);
+		// All the texts are drawn in one batch
+		void RenderTexts(std::vector<RetainedTextPtr> const & texts);
 
 	private:
 		shared_ptr<FontRenderable> font_renderable_;
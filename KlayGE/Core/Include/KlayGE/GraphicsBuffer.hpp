@@ -43,6 +43,7 @@
 #pragma once
 
 #include <KlayGE/PreDeclare.hpp>
+#include <KlayGE/MemoryTracker.hpp>
 #include <vector>
 #include <boost/noncopyable.hpp>
 
@@ -117,8 +118,19 @@ namespace KlayGE
 			return access_hint_;
 		}
 
+		// Tag the GPU memory of this buffer is accounted under
+		void TrackingTag(MemoryTag tag);
+		MemoryTag TrackingTag() const
+		{
+			return tracking_tag_;
+		}
+
 		virtual void CopyToBuffer(GraphicsBuffer& rhs) = 0;
 
+	protected:
+		// Called by the implementations when hw_buff_size_ changes
+		void UpdateGPUMemoryUsage();
+
 	private:
 		virtual void DoResize() = 0;
 
@@ -131,6 +143,9 @@ namespace KlayGE
 
 		uint32_t size_in_byte_;
 		uint32_t hw_buff_size_;
+
+		MemoryTag tracking_tag_;
+		uint32_t tracked_gpu_size_;
 	};
 }
 
@@ -21,7 +21,9 @@
 
 #include <vector>
 #include <deque>
+#include <list>
 
+#include <KFL/Thread.hpp>
 #include <KlayGE/LZMACodec.hpp>
 
 namespace KlayGE
@@ -60,8 +62,42 @@ namespace KlayGE
 
 		static uint32_t const LEVEL_SHIFT = 28;
 
+		static uint32_t const MAX_DECODING_THREADS = 2;
+		static uint32_t const TILE_DECODING_BATCH = 8;
+		static uint32_t const MAX_PREFETCH_QUEUE_LENGTH = 64;
+		static uint32_t const MAX_NUM_DECODED_BLOCKS = 64;
+
+		struct TileRequest
+		{
+			uint32_t tile_id;
+			uint32_t attr;
+			array<uint32_t, 9> neighbor_ids;
+			array<bool, 9> in_same_image;
+		};
+
+		struct DecodedTile
+		{
+			uint32_t tile_id;
+			uint32_t attr;
+			std::vector<std::vector<uint8_t> > mips;
+		};
+
+	public:
+		struct CacheStatistics
+		{
+			uint64_t hits;
+			uint64_t misses;
+			uint64_t evictions;
+
+			CacheStatistics()
+				: hits(0), misses(0), evictions(0)
+			{
+			}
+		};
+
 	public:
 		JudaTexture(uint32_t num_tiles, uint32_t tile_size, ElementFormat format);
+		~JudaTexture();
 
 		uint32_t EncodeTileID(uint32_t level, uint32_t tile_x, uint32_t tile_y) const;
 		void DecodeTileID(uint32_t& level, uint32_t& tile_x, uint32_t& tile_y, uint32_t tile_id) const;
@@ -84,14 +120,41 @@ namespace KlayGE
 		std::vector<TexturePtr> const & CacheTexArray() const;
 		TexturePtr const & IndirectTex() const;
 
+		CacheStatistics const & TileCacheStatistics() const;
+		CacheStatistics DecodedBlockCacheStatistics() const;
+		void ResetCacheStatistics();
+
 		void SetParams(RenderTechniquePtr const tech);
 
+		// Missing tiles are decoded in the background, and at most MaxTileUploadsPerFrame of them are uploaded per call
 		void UpdateCache(std::vector<uint32_t> const & tile_ids);
+		// Blocks until all the tiles requested so far are in the cache
+		void FlushCache();
+
+		void AsyncTileLoading(bool async);
+		bool AsyncTileLoading() const;
+		void MaxTileUploadsPerFrame(uint32_t num);
+		uint32_t MaxTileUploadsPerFrame() const;
 
 	private:
+		void MakeTileRequest(TileRequest& request, uint32_t tile_id);
+		void DecodeTileRequests(std::vector<DecodedTile>& tiles, std::vector<TileRequest> const & requests,
+			TexCompressionPtr const & codec);
+		void UploadATile(DecodedTile const & tile);
+		void UploadDecodedTiles(uint32_t max_num);
+		void PrefetchTiles(std::vector<uint32_t> const & tile_ids);
+
+		void StartDecodingThreads();
+		void StopDecodingThreads();
+		void TileDecodingThreadFunc();
+
+
+		typedef std::vector<uint8_t, tracking_allocator<uint8_t, MT_JudaTexture> > DecodedBlock;
+
 		void DecodeATile(std::vector<uint8_t>* data, uint32_t shuff, uint32_t mipmaps);
 		uint32_t DecodeAAttr(uint32_t shuff);
-		uint8_t* RetriveATile(uint32_t data_index);
+		// block keeps a decoded block alive while it's used, even if another thread evicts it from the cache
+		uint8_t const * RetriveATile(shared_ptr<DecodedBlock>& block, uint32_t data_index);
 
 		uint32_t NumNonEmptySubNodes(quadtree_node_ptr const & node) const;
 		quadtree_node_ptr const & GetNode(uint32_t shuff);
@@ -167,19 +230,20 @@ namespace KlayGE
 		// Input only
 		ResIdentifierPtr input_file_;
 		uint32_t data_blocks_offset_;
-		LZMACodec lzma_dec_;
 		struct DecodedBlockInfo
 		{
-			shared_ptr<std::vector<uint8_t> > data;
-			uint64_t tick;
+			shared_ptr<DecodedBlock> data;
+			std::list<uint32_t>::iterator lru_iter;
 
-			DecodedBlockInfo(shared_ptr<std::vector<uint8_t> > const & d, uint64_t t)
-				: data(d), tick(t)
+			DecodedBlockInfo(shared_ptr<DecodedBlock> const & d, std::list<uint32_t>::iterator const & iter)
+				: data(d), lru_iter(iter)
 			{
 			}
 		};
 		unordered_map<uint32_t, DecodedBlockInfo> decoded_block_cache_;
-		uint64_t decode_tick_;
+		// Most recently used first
+		std::list<uint32_t> decoded_block_lru_;
+		CacheStatistics decoded_block_cache_stat_;
 
 	private:
 		// Cache
@@ -196,11 +260,38 @@ namespace KlayGE
 		{
 			uint32_t x, y, z;
 			uint32_t attr;
-			uint64_t tick;
+			std::list<uint32_t>::iterator lru_iter;
 		};
 		unordered_map<uint32_t, TileInfo> tile_info_map_;
+		// Most recently used first
+		std::list<uint32_t> tile_lru_;
 		std::deque<std::pair<uint32_t, uint32_t> > tile_free_list_;
-		uint64_t tile_tick_;
+		CacheStatistics tile_cache_stat_;
+
+	private:
+		// Background decoding
+		bool async_tile_loading_;
+		uint32_t max_tile_uploads_per_frame_;
+
+		std::deque<TileRequest> tile_requests_;
+		std::deque<DecodedTile> decoded_tiles_;
+		unordered_set<uint32_t> pending_tiles_;
+
+		mutable mutex decode_mutex_;
+		mutex request_mutex_;
+		condition_variable request_cond_;
+		mutex decoded_mutex_;
+		condition_variable decoded_cond_;
+
+		std::vector<shared_ptr<joiner<void> > > decoding_threads_;
+		bool quit_;
+
+		struct LevelView
+		{
+			int32_t center_x2, center_y2;
+			bool valid;
+		};
+		array<LevelView, MAX_TREE_LEVEL + 1> level_views_;
 	};
 }
 
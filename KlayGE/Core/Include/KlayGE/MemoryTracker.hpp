@@ -0,0 +1,223 @@
+/**
+* @file MemoryTracker.hpp
+* @author Minmin Gong
+*
+* @section DESCRIPTION
+*
+* This source file is part of KlayGE
+* For the latest info, see http://www.klayge.org
+*
+* @section LICENSE
+*
+* This program is free software; you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published
+* by the Free Software Foundation; either version 2 of the License, or
+* (at your option) any later version.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with this program; if not, write to the Free Software
+* Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+*
+* You may alternatively use this source under the terms of
+* the KlayGE Proprietary License (KPL). You can obtained such a license
+* from http://www.klayge.org/licensing/.
+*/
+
+
+#ifndef _KLAYGE_MEMORYTRACKER_HPP
+#define _KLAYGE_MEMORYTRACKER_HPP
+
+#pragma once
+
+#include <KlayGE/PreDeclare.hpp>
+
+#include <limits>
+#include <iosfwd>
+#include <string>
+
+#include <boost/noncopyable.hpp>
+
+namespace KlayGE
+{
+	enum MemoryTag
+	{
+		MT_General = 0,
+		MT_Texture,
+		MT_GraphicsBuffer,
+		MT_Model,
+		MT_Effect,
+		MT_Font,
+		MT_JudaTexture,
+
+		MT_NumTags
+	};
+
+	enum MemoryPool
+	{
+		MP_CPU = 0,
+		MP_GPU,
+
+		MP_NumPools
+	};
+
+	struct MemoryUsage
+	{
+		int64_t current_bytes;
+		int64_t peak_bytes;
+		uint64_t num_allocations;
+		uint64_t num_deallocations;
+	};
+
+	// Per tag and per pool allocation counters. All the counters are lock-free, and when the tracker is
+	// disabled the only cost is one relaxed load. Every allocation remembers whether it was counted, so the
+	// tracker can be switched at runtime. Blocks allocated while it was disabled are just never counted.
+	class KLAYGE_CORE_API MemoryTracker : boost::noncopyable
+	{
+	public:
+		static MemoryTracker& Instance();
+
+		void Enable(bool enable);
+		bool Enabled() const
+		{
+			return enabled_.load(memory_order_relaxed);
+		}
+
+		void Allocate(MemoryTag tag, MemoryPool pool, uint64_t bytes);
+		void Deallocate(MemoryTag tag, MemoryPool pool, uint64_t bytes);
+
+		MemoryUsage Usage(MemoryTag tag, MemoryPool pool) const;
+		MemoryUsage TotalUsage(MemoryPool pool) const;
+		void ResetPeaks();
+
+		void DumpToStream(std::ostream& os) const;
+		void DumpToFile(std::string const & file_name) const;
+
+		static char const * TagName(MemoryTag tag);
+
+	private:
+		MemoryTracker();
+
+		struct Counter
+		{
+			atomic<int64_t> current_bytes;
+			atomic<int64_t> peak_bytes;
+			atomic<uint64_t> num_allocations;
+			atomic<uint64_t> num_deallocations;
+		};
+
+		static void Add(Counter& counter, int64_t bytes);
+		static MemoryUsage Load(Counter const & counter);
+
+	private:
+		atomic<bool> enabled_;
+
+		Counter counters_[MT_NumTags][MP_NumPools];
+		Counter totals_[MP_NumPools];
+	};
+
+	// STL allocator that reports CPU memory to the tracker under a tag. Each block starts with a header
+	// that records whether the block was counted, so the deallocation matches the allocation.
+	template <typename T, MemoryTag tag>
+	class tracking_allocator
+	{
+		// Keeps the alignment of ::operator new
+		static size_t const HEADER_SIZE = 16;
+
+	public:
+		typedef T value_type;
+		typedef value_type* pointer;
+		typedef value_type& reference;
+		typedef const value_type* const_pointer;
+		typedef const value_type& const_reference;
+
+		typedef size_t size_type;
+		typedef ptrdiff_t difference_type;
+
+		template <typename U>
+		struct rebind
+		{
+			typedef tracking_allocator<U, tag> other;
+		};
+
+		tracking_allocator() throw()
+		{
+		}
+
+		tracking_allocator(const tracking_allocator<T, tag>&) throw()
+		{
+		}
+
+		template <typename U>
+		tracking_allocator(const tracking_allocator<U, tag>&) throw()
+		{
+		}
+
+		pointer address(reference val) const
+		{
+			return &val;
+		}
+
+		const_pointer address(const_reference val) const
+		{
+			return &val;
+		}
+
+		pointer allocate(size_type count, const void* /*hint*/ = nullptr)
+		{
+			uint8_t* block = static_cast<uint8_t*>(::operator new(count * sizeof(T) + HEADER_SIZE));
+			MemoryTracker& tracker = MemoryTracker::Instance();
+			bool const tracked = tracker.Enabled();
+			*block = tracked;
+			if (tracked)
+			{
+				tracker.Allocate(tag, MP_CPU, count * sizeof(T));
+			}
+			return reinterpret_cast<pointer>(block + HEADER_SIZE);
+		}
+
+		void deallocate(pointer p, size_type count)
+		{
+			uint8_t* block = reinterpret_cast<uint8_t*>(p) - HEADER_SIZE;
+			if (*block)
+			{
+				MemoryTracker::Instance().Deallocate(tag, MP_CPU, count * sizeof(T));
+			}
+			::operator delete(block);
+		}
+
+		void construct(pointer p, const T& val)
+		{
+			void* vp = p;
+			::new (vp) T(val);
+		}
+
+		void destroy(pointer p)
+		{
+			p->~T();
+		}
+
+		size_type max_size() const throw()
+		{
+			return (std::numeric_limits<size_t>::max() - HEADER_SIZE) / sizeof(T);
+		}
+	};
+
+	template <typename T, typename U, MemoryTag tag>
+	inline bool operator==(const tracking_allocator<T, tag>&, const tracking_allocator<U, tag>&) throw()
+	{
+		return true;
+	}
+
+	template <typename T, typename U, MemoryTag tag>
+	inline bool operator!=(const tracking_allocator<T, tag>&, const tracking_allocator<U, tag>&) throw()
+	{
+		return false;
+	}
+}
+
+#endif			// _KLAYGE_MEMORYTRACKER_HPP
@@ -115,6 +115,16 @@ namespace KlayGE
 			return rl_->StartInstanceLocation();
 		}
 
+		// The coarser levels of detail are other index ranges over the same vertices. Level 0 is the range set by
+		//  NumTriangles and StartIndexLocation.
+		void AddLod(uint32_t num_triangles, uint32_t start_index_location);
+		uint32_t LodNumTriangles(int32_t lod) const;
+		uint32_t LodStartIndexLocation(int32_t lod) const;
+
+		using Renderable::ActiveLod;
+		virtual uint32_t NumLods() const KLAYGE_OVERRIDE;
+		virtual void ActiveLod(int32_t lod) KLAYGE_OVERRIDE;
+
 		int32_t MaterialID() const
 		{
 			return mtl_id_;
@@ -134,6 +144,9 @@ namespace KlayGE
 
 		int32_t mtl_id_;
 
+		// (num_triangles, start_index_location) of each level of detail, empty if there is only level 0
+		std::vector<std::pair<uint32_t, uint32_t> > lods_;
+
 		weak_ptr<RenderModel> model_;
 
 		function<TexturePtr()> diffuse_tl_;
@@ -201,6 +214,10 @@ namespace KlayGE
 
 		void AddToRenderQueue();
 
+		using Renderable::ActiveLod;
+		virtual uint32_t NumLods() const KLAYGE_OVERRIDE;
+		virtual void ActiveLod(int32_t lod) KLAYGE_OVERRIDE;
+
 		virtual void Pass(PassType type);
 
 		virtual bool SpecialShading() const;
@@ -424,6 +441,8 @@ namespace KlayGE
 		std::vector<AABBox>& pos_bbs, std::vector<AABBox>& tc_bbs,
 		std::vector<uint32_t>& mesh_num_vertices, std::vector<uint32_t>& mesh_base_vertices,
 		std::vector<uint32_t>& mesh_num_triangles, std::vector<uint32_t>& mesh_base_triangles,
+		std::vector<std::vector<uint32_t> >& mesh_lod_num_triangles,
+		std::vector<std::vector<uint32_t> >& mesh_lod_base_triangles,
 		std::vector<Joint>& joints, shared_ptr<AnimationActionsType>& actions,
 		shared_ptr<KeyFramesType>& kfs, uint32_t& num_frames, uint32_t& frame_rate,
 		std::vector<shared_ptr<AABBKeyFrames> >& frame_pos_bbs);
@@ -35,38 +35,118 @@
 
 #include <KlayGE/PreDeclare.hpp>
 #include <KFL/Timer.hpp>
+#include <KFL/Thread.hpp>
 
+#include <deque>
 #include <map>
 #include <string>
+#include <vector>
+
+#include <boost/noncopyable.hpp>
 
 namespace KlayGE
 {
+	enum PerfEventType
+	{
+		PET_CPUScope,
+		PET_CPURange,
+		// Only the durations come from the GPU. The start times are estimated from the CPU issuing order.
+		PET_GPURange
+	};
+
+	// Name must point to a string that outlives the profiler, e.g. a literal or a PerfRange's name
+	struct PerfEvent
+	{
+		char const * name;
+		int category;
+		PerfEventType type;
+		uint32_t thread_index;
+		uint32_t depth;
+		uint32_t frame_id;
+		double begin_time;
+		double end_time;
+	};
+
+	struct PerfSummary
+	{
+		std::string name;
+		int category;
+		uint32_t num_frames;
+		double cpu_avg;
+		double cpu_min;
+		double cpu_max;
+		// Negative if the range has no GPU timing
+		double gpu_avg;
+		double gpu_min;
+		double gpu_max;
+	};
+
+	struct PerfThreadBuffer;
+
 	class KLAYGE_CORE_API PerfRange
 	{
 	public:
-		PerfRange();
+		PerfRange(int category, std::string const & name);
 
 		void Begin();
 		void End();
 
 		void CollectData();
 
+		int Category() const;
+		std::string const & Name() const;
+
+		double CPUBeginTime() const;
 		double CPUTime() const;
 		double GPUTime() const;
 		bool Dirty() const;
 
 	private:
-		Timer cpu_timer_;
+		int category_;
+		std::string name_;
+
 		QueryPtr gpu_timer_query_;
+		PerfThreadBuffer* thread_buffer_;
 
+		double cpu_begin_time_;
 		double cpu_time_;
 		double gpu_time_;
 
 		bool dirty_;
 	};
 
+	// Scoped and nestable CPU marker, usable from any thread
+	class KLAYGE_CORE_API PerfScope : boost::noncopyable
+	{
+	public:
+		explicit PerfScope(char const * name, int category = 0);
+		~PerfScope();
+
+	private:
+		char const * name_;
+		int category_;
+		PerfThreadBuffer* thread_buffer_;
+		double begin_time_;
+	};
+
+	// Compiled out of shipping builds, so the call sites need no guard
+#ifdef KLAYGE_SHIP
+#define KLAYGE_PERF_SCOPE(name)
+#else
+#define KLAYGE_PERF_SCOPE_CONCAT_IMPL(a, b) a##b
+#define KLAYGE_PERF_SCOPE_CONCAT(a, b) KLAYGE_PERF_SCOPE_CONCAT_IMPL(a, b)
+#define KLAYGE_PERF_SCOPE(name) KlayGE::PerfScope KLAYGE_PERF_SCOPE_CONCAT(perf_scope_, __LINE__)(name)
+#endif
+
 	class KLAYGE_CORE_API PerfProfiler
 	{
+		friend class PerfRange;
+		friend class PerfScope;
+
+	public:
+		static uint32_t const GPU_THREAD_INDEX = 0;
+		static uint32_t const DEFAULT_WINDOW_SIZE = 600;
+
 	public:
 		PerfProfiler();
 
@@ -79,14 +159,49 @@ namespace KlayGE
 		PerfRangePtr CreatePerfRange(int category, std::string const & name);
 		void CollectData();
 
+		// Number of frames kept for the rolling summary, the CSV and the trace export
+		void WindowSize(uint32_t num_frames);
+		uint32_t WindowSize() const;
+		void Summarize(std::vector<PerfSummary>& summaries) const;
+
 		void ExportToCSV(std::string const & file_name) const;
+		void ExportToChromeTrace(std::string const & file_name) const;
+
+	private:
+		double TimeStamp() const;
+		PerfThreadBuffer* ThreadBuffer();
+
+		void CollectThreadEvents();
+		void TrimHistory();
+
+	private:
+		struct ScopeHistory
+		{
+			std::string name;
+			int category;
+			double frame_time;
+			bool touched;
+			std::deque<double> history;
+		};
 
 	private:
 		static shared_ptr<PerfProfiler> perf_profiler_instance_;
 
+		uint32_t serial_;
+		Timer timer_;
+
 		std::vector<tuple<int, std::string, PerfRangePtr,
-			std::vector<tuple<uint32_t, double, double> > > > perf_ranges_;
+			std::deque<tuple<uint32_t, double, double> > > > perf_ranges_;
 		uint32_t frame_id_;
+		uint32_t window_size_;
+
+		mutable mutex thread_buffers_mutex_;
+		std::vector<shared_ptr<PerfThreadBuffer> > thread_buffers_;
+
+		std::vector<PerfEvent> drained_events_;
+		std::deque<PerfEvent> trace_events_;
+		std::map<char const *, size_t> scope_indices_;
+		std::vector<ScopeHistory> scope_histories_;
 	};
 }
 
@@ -73,6 +73,8 @@ namespace KlayGE
 	typedef shared_ptr<CameraPathController> CameraPathControllerPtr;
 	class Font;
 	typedef shared_ptr<Font> FontPtr;
+	class RetainedText;
+	typedef shared_ptr<RetainedText> RetainedTextPtr;
 	class RenderEngine;
 	typedef shared_ptr<RenderEngine> RenderEnginePtr;
 	struct RenderSettings;
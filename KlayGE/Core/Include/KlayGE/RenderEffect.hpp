@@ -63,8 +63,10 @@
 
 #include <KlayGE/RenderEngine.hpp>
 #include <KlayGE/Texture.hpp>
+#include <KlayGE/MemoryTracker.hpp>
 #include <KlayGE/ShaderObject.hpp>
 #include <KFL/Math.hpp>
+#include <KFL/Thread.hpp>
 
 namespace KlayGE
 {
@@ -575,7 +577,7 @@ namespace KlayGE
 
 	// ȾЧ
 	//////////////////////////////////////////////////////////////////////////////////
-	class KLAYGE_CORE_API RenderEffect
+	class KLAYGE_CORE_API RenderEffect : public enable_shared_from_this<RenderEffect>
 	{
 	public:
 		RenderEffect();
@@ -585,12 +587,24 @@ namespace KlayGE
 		bool StreamIn(ResIdentifierPtr const & source);
 		void StreamOut(std::ostream& os);
 
+		// The clone shares the prototype of this effect, or this effect if it has none
 		RenderEffectPtr Clone();
 
+		// Hot-reloading. Called on the prototype between frames until it returns true. Parses the fxml again if it
+		//  or the includes changed, and only the passes whose code changed are compiled, on the thread pool.
+		//  Returns true when they are swapped in, to the prototype and its live clones, or when there is nothing
+		//  to reload. Changed parameter defaults are taken by the parameters still holding the old ones.
+		bool Reload();
+		// Takes the passes changed by Reload from the prototype
+		void UpdateFromPrototype();
+		void DependentFiles(std::vector<std::string>& files) const;
+
 		std::string const & ResName() const
 		{
 			return *res_name_;
 		}
+		// Removes the kfx once the driver rejected a native shader block in it, so that the next loading rebuilds it
+		void InvalidateKFX();
 
 		void PrototypeEffect(RenderEffectPtr const & prototype_effect)
 		{
@@ -628,12 +642,9 @@ namespace KlayGE
 		{
 			return static_cast<uint32_t>(techniques_.size());
 		}
+		// Techniques loaded from kfx are instantiated on the first query
 		RenderTechniquePtr const & TechniqueByName(std::string const & name) const;
-		RenderTechniquePtr const & TechniqueByIndex(uint32_t n) const
-		{
-			BOOST_ASSERT(n < this->NumTechniques());
-			return techniques_[n];
-		}
+		RenderTechniquePtr const & TechniqueByIndex(uint32_t n) const;
 
 		uint32_t NumShaders() const
 		{
@@ -662,13 +673,20 @@ namespace KlayGE
 		std::string const & TypeName(uint32_t code) const;
 
 	private:
+		struct ReloadState;
+
 		void RecursiveIncludeNode(XMLNodePtr const & root, std::vector<std::string>& include_names) const;
 		void InsertIncludeNodes(XMLDocument& target_doc, XMLNodePtr const & target_root,
 			XMLNodePtr const & target_place, XMLNodePtr const & include_root) const;
+		void ParseFXML(ResIdentifierPtr const & source);
+		void BuildShaders();
+		bool SameLayout(RenderEffect const & rhs) const;
 
 	private:
 		shared_ptr<std::string> res_name_;
 		uint64_t timestamp_;
+		// All the files included by the fxml, with their timestamps
+		shared_ptr<std::vector<std::pair<std::string, uint64_t> > > includes_;
 
 		std::vector<RenderEffectParameterPtr> params_;
 		std::vector<RenderEffectConstantBufferPtr> cbuffers_;
@@ -678,19 +696,36 @@ namespace KlayGE
 		shared_ptr<std::vector<RenderShaderFunc> > shaders_;
 
 		RenderEffectPtr prototype_effect_;
+		// The effects cloned from this prototype, to be updated on reloading
+		std::vector<weak_ptr<RenderEffect> > clones_;
+		mutex clones_mutex_;
 
 		shared_ptr<std::vector<ShaderDesc> > shader_descs_;
+
+		shared_ptr<ReloadState> reload_state_;
 	};
 
 	class KLAYGE_CORE_API RenderTechnique : boost::noncopyable
 	{
 	public:
 		explicit RenderTechnique(RenderEffect& effect)
-			: effect_(effect)
+			: effect_(effect), instantiated_(true)
 		{
 		}
 
 		void Load(XMLNodePtr const & node, uint32_t tech_index);
+		// Takes the validation and shader features from the passes once their shaders are linked
+		void UpdateShaderStates();
+
+		// Creates the shaders of all the passes, if they are not yet. Can be called from multiple threads.
+		void Instantiate();
+		bool Instantiated() const
+		{
+			return instantiated_;
+		}
+
+		// Hot-reloading, takes everything but the passes from the technique in another effect
+		void Reload(RenderTechnique const & rhs);
 
 		bool StreamIn(ResIdentifierPtr const & res, uint32_t tech_index);
 		void StreamOut(std::ostream& os, uint32_t tech_index);
@@ -777,29 +812,59 @@ namespace KlayGE
 		float weight_;
 		bool transparent_;
 
+		atomic<bool> instantiated_;
+		mutex instantiate_mutex_;
 		bool is_validate_;
 		bool has_discard_;
 		bool has_tessellation_;
 	};
 
-	class KLAYGE_CORE_API RenderPass : boost::noncopyable
+	class KLAYGE_CORE_API RenderPass : boost::noncopyable, public enable_shared_from_this<RenderPass>
 	{
 	public:
 		explicit RenderPass(RenderEffect& effect)
 			: effect_(effect),
 				front_stencil_ref_(0), back_stencil_ref_(0),
-				blend_factor_(1, 1, 1, 1), sample_mask_(0xFFFFFFFF)
+				blend_factor_(1, 1, 1, 1), sample_mask_(0xFFFFFFFF),
+				tech_index_(0), pass_index_(0), revision_(0)
 		{
 		}
 
 		void Load(XMLNodePtr const & node, uint32_t tech_index, uint32_t pass_index, RenderPassPtr const & inherit_pass);
 		void Load(uint32_t tech_index, uint32_t pass_index, RenderPassPtr const & inherit_pass);
+		// Load only sets up the shader descs. CompileShaders compiles the stages this pass is the first user of,
+		//  and can run on any thread. LinkShaders attaches them, and the ones shared from other passes, and links.
+		void CompileShaders(uint32_t tech_index, uint32_t pass_index);
+		void LinkShaders(uint32_t tech_index, uint32_t pass_index);
 
 		bool StreamIn(ResIdentifierPtr const & res, uint32_t tech_index, uint32_t pass_index);
 		void StreamOut(std::ostream& os, uint32_t tech_index, uint32_t pass_index);
 
+		// A clone shares the pass it comes from until it is instantiated
 		RenderPassPtr Clone(RenderEffect& effect);
 
+		// Attaches the native shaders kept from the kfx, or clones the shader object of the source pass.
+		//  Only called by the technique owning the pass, under its lock.
+		void Instantiate(RenderTechnique const & tech);
+		bool Instantiated() const
+		{
+			return !native_shaders_ && !source_pass_;
+		}
+
+		// Hot-reloading. Takes the states of the pass in the reparsed effect, and the shaders if they are
+		//  recompiled. The revision changes with them, for the clones to catch up with UpdateFromPrototype.
+		void Reload(RenderPass const & rhs, bool shaders);
+		void UpdateFromPrototype(RenderPass& prototype_pass);
+		uint32_t Revision() const
+		{
+			return revision_;
+		}
+
+		std::vector<uint32_t> const & ShaderDescIds() const
+		{
+			return *shader_desc_ids_;
+		}
+
 		std::string const & Name() const
 		{
 			return *name_;
@@ -872,6 +937,14 @@ namespace KlayGE
 		ShaderObjectPtr shader_obj_;
 
 		bool is_validate_;
+
+		// Kept for the instantiation of the passes loaded from kfx
+		uint32_t tech_index_;
+		uint32_t pass_index_;
+		shared_ptr<std::vector<std::vector<uint8_t> > > native_shaders_;
+		RenderPassPtr source_pass_;
+
+		uint32_t revision_;
 	};
 
 	class KLAYGE_CORE_API RenderEffectConstantBuffer : boost::noncopyable
@@ -942,7 +1015,7 @@ namespace KlayGE
 		shared_ptr<std::vector<uint32_t> > param_indices_;
 
 		GraphicsBufferPtr hw_buff_;
-		std::vector<uint8_t> buff_;
+		std::vector<uint8_t, tracking_allocator<uint8_t, MT_Effect> > buff_;
 		bool dirty_;
 	};
 
@@ -958,6 +1031,9 @@ namespace KlayGE
 		void StreamOut(std::ostream& os);
 
 		RenderEffectParameterPtr Clone();
+		// Takes the default value and annotations of a reloaded parameter. The value is kept if it was changed
+		//  from the old default.
+		void UpdateDefault(RenderEffectParameter const & old_param, RenderEffectParameter const & new_param);
 
 		uint32_t Type() const
 		{
@@ -1058,6 +1134,9 @@ namespace KlayGE
 		RenderEffectConstantBufferPtr cbuff_;
 	};
 
+	// Techniques to instantiate as soon as the effect is loaded, instead of on the first use
+	KLAYGE_CORE_API void AddRenderEffectWarmUp(std::string const & effect_name, std::string const & tech_name);
+
 	KLAYGE_CORE_API RenderEffectPtr SyncLoadRenderEffect(std::string const & effect_name);
 	KLAYGE_CORE_API function<RenderEffectPtr()> ASyncLoadRenderEffect(std::string const & effect_name);
 }
@@ -196,6 +196,14 @@ namespace KlayGE
 
 		virtual void ModelMatrix(float4x4 const & mat);
 
+		// Levels of detail, 0 is the finest one
+		virtual uint32_t NumLods() const;
+		virtual void ActiveLod(int32_t lod);
+		int32_t ActiveLod() const
+		{
+			return active_lod_;
+		}
+
 		template <typename ForwardIterator>
 		void AssignSubrenderables(ForwardIterator first, ForwardIterator last)
 		{
@@ -305,6 +313,8 @@ namespace KlayGE
 
 		float4x4 model_mat_;
 
+		int32_t active_lod_;
+
 		PassType type_;
 		bool opacity_map_enabled_;
 		uint32_t effect_attrs_;
@@ -48,6 +48,7 @@
 
 #include <KFL/ResIdentifier.hpp>
 #include <KFL/Thread.hpp>
+#include <KFL/Timer.hpp>
 
 namespace KlayGE
 {
@@ -70,6 +71,16 @@ namespace KlayGE
 		virtual bool Match(ResLoadingDesc const & rhs) const = 0;
 		virtual void CopyDataFrom(ResLoadingDesc const & rhs) = 0;
 		virtual shared_ptr<void> CloneResourceFrom(shared_ptr<void> const & resource) = 0;
+
+		// For hot-reloading. The files the resource is made from.
+		virtual void DependentFiles(std::vector<std::string>& /*files*/) const
+		{
+		}
+		// Called between frames after some of the dependent files changed, until it returns true.
+		virtual bool Reload(shared_ptr<void> const & /*resource*/)
+		{
+			return true;
+		}
 	};
 
 	class KLAYGE_CORE_API ResLoader
@@ -132,6 +143,8 @@ namespace KlayGE
 
 		ResIdentifierPtr Open(std::string const & name);
 		std::string Locate(std::string const & name);
+		// The timestamp Open would give, without opening the file. Files in packages have the package's.
+		uint64_t Timestamp(std::string const & name);
 		std::string AbsPath(std::string const & path);
 
 		shared_ptr<void> SyncQuery(ResLoadingDescPtr const & res_desc);
@@ -158,6 +171,13 @@ namespace KlayGE
 
 		void Update();
 
+		// Reloads the resources whose files change, for editing them while the app is running
+		void HotReload(bool hot_reload);
+		bool HotReload() const
+		{
+			return hot_reload_;
+		}
+
 	private:
 		std::string RealPath(std::string const & path);
 
@@ -166,6 +186,7 @@ namespace KlayGE
 		void RemoveUnrefResources();
 
 		void LoadingThreadFunc();
+		void UpdateHotReload();
 
 	private:
 		static shared_ptr<ResLoader> res_loader_instance_;
@@ -181,6 +202,11 @@ namespace KlayGE
 
 		shared_ptr<joiner<void> > loading_thread_;
 		bool quit_;
+
+		bool hot_reload_;
+		Timer hot_reload_timer_;
+		std::vector<std::pair<std::string, uint64_t> > watched_files_;
+		std::vector<std::pair<ResLoadingDescPtr, weak_ptr<void> > > reloading_res_;
 	};
 }
 
@@ -48,6 +48,7 @@ namespace KlayGE
 		void Resume();
 
 		void SmallObjectThreshold(float area);
+		void LodThreshold(float area);
 		void SceneUpdateElapse(float elapse);
 		virtual void ClipScene();
 
@@ -109,6 +110,7 @@ namespace KlayGE
 
 		BoundOverlap VisibleTestFromParent(SceneObjectPtr const & obj,
 			float3 const & eye_pos, float4x4 const & view_proj);
+		void UpdateLod(SceneObject& obj, Camera const & camera, uint32_t num_lods);
 
 	protected:
 		std::vector<CameraPtr> cameras_;
@@ -120,6 +122,7 @@ namespace KlayGE
 		unordered_map<size_t, shared_ptr<std::vector<BoundOverlap> > > visible_marks_map_;
 
 		float small_obj_threshold_;
+		float lod_threshold_;
 		float update_elapse_;
 
 	private:
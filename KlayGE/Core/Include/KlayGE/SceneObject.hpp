@@ -55,6 +55,8 @@ namespace KlayGE
 		void UpdateAbsModelMatrix();
 		void VisibleMark(BoundOverlap vm);
 		BoundOverlap VisibleMark() const;
+		void Lod(int32_t lod);
+		int32_t Lod() const;
 
 		virtual void OnAttachRenderable(bool add_to_scene);
 
@@ -103,6 +105,7 @@ namespace KlayGE
 		float4x4 abs_model_;
 		AABBoxPtr pos_aabb_ws_;
 		BoundOverlap visible_mark_;
+		int32_t lod_;
 
 		function<void(SceneObject&, float, float)> sub_thread_update_func_;
 		function<void(SceneObject&, float, float)> main_thread_update_func_;
@@ -0,0 +1,130 @@
+/**
+* @file ShaderCache.hpp
+* @author Minmin Gong
+*
+* @section DESCRIPTION
+*
+* This source file is part of KlayGE
+* For the latest info, see http://www.klayge.org
+*
+* @section LICENSE
+*
+* This program is free software; you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published
+* by the Free Software Foundation; either version 2 of the License, or
+* (at your option) any later version.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with this program; if not, write to the Free Software
+* Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+*
+* You may alternatively use this source under the terms of
+* the KlayGE Proprietary License (KPL). You can obtained such a license
+* from http://www.klayge.org/licensing/.
+*/
+
+#ifndef _KLAYGE_SHADERCACHE_HPP
+#define _KLAYGE_SHADERCACHE_HPP
+
+#pragma once
+
+#include <KlayGE/PreDeclare.hpp>
+#include <KFL/Thread.hpp>
+
+#include <string>
+#include <vector>
+
+#include <boost/noncopyable.hpp>
+
+namespace KlayGE
+{
+	// Hash of everything that goes into a shader compiler: the source, macros, entry point, profile, flags,
+	//  and the name and version of the compiler. Two keys are equal only if the compiled code is.
+	class KLAYGE_CORE_API ShaderCacheKey
+	{
+	public:
+		ShaderCacheKey();
+
+		ShaderCacheKey& Append(void const * data, size_t size);
+		ShaderCacheKey& Append(std::string const & str);
+		ShaderCacheKey& Append(uint32_t value);
+
+		// Works on D3D_SHADER_MACRO and alike, ends at the first macro with a null name or definition
+		template <typename ShaderMacro>
+		ShaderCacheKey& AppendMacros(ShaderMacro const * macros)
+		{
+			uint32_t num_macros = 0;
+			for (; (macros->Name != nullptr) && (macros->Definition != nullptr); ++ macros, ++ num_macros)
+			{
+				this->Append(std::string(macros->Name));
+				this->Append(std::string(macros->Definition));
+			}
+			return this->Append(num_macros);
+		}
+
+		// 32 hex digits, used as the file name of the entry
+		std::string Name() const;
+
+		bool operator==(ShaderCacheKey const & rhs) const
+		{
+			return (hash_[0] == rhs.hash_[0]) && (hash_[1] == rhs.hash_[1]);
+		}
+
+	private:
+		uint64_t hash_[2];
+	};
+
+	// A content-addressed store of compiled shaders on disk, shared by all effects, backends and runs.
+	// Entries are written to a temporary file and renamed into place, so other threads and processes
+	//  never see a partial entry. Once the size is over the limit, the oldest entries are removed.
+	class KLAYGE_CORE_API ShaderCache : boost::noncopyable
+	{
+	public:
+		static uint64_t const DEFAULT_MAX_SIZE = 256 * 1024 * 1024;
+
+	public:
+		ShaderCache();
+
+		static ShaderCache& Instance();
+		static void Destroy();
+
+		// An empty directory turns the cache off
+		void Directory(std::string const & dir);
+		std::string Directory() const;
+		void MaxSize(uint64_t size);
+		uint64_t MaxSize() const;
+
+		// The compiler's warnings are stored with the code, so a hit reports them the same as a compilation
+		bool Lookup(ShaderCacheKey const & key, std::vector<uint8_t>& code, std::string& msgs);
+		void Insert(ShaderCacheKey const & key, void const * code, size_t size, std::string const & msgs);
+
+		// Identifies a compiler binary by its file name, size and last write time, for the key. Entries
+		//  from another build of the same compiler are not reused.
+		static std::string CompilerVersion(std::string const & compiler_path);
+#ifdef KLAYGE_PLATFORM_WINDOWS
+		// Same, for a loaded module
+		static std::string CompilerVersion(void* module);
+#endif
+
+	private:
+		void Evict();
+
+	private:
+		static shared_ptr<ShaderCache> shader_cache_instance_;
+
+		mutable mutex mutex_;
+		std::string dir_;
+		uint64_t max_size_;
+		// Sum of the entries' sizes, unknown until the directory is scanned for the first time
+		uint64_t total_size_;
+		bool scanned_;
+		atomic<uint32_t> tmp_serial_;
+	};
+}
+
+#endif			// _KLAYGE_SHADERCACHE_HPP
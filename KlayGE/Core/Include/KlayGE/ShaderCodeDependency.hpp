@@ -0,0 +1,76 @@
+/**
+* @file ShaderCodeDependency.hpp
+* @author Minmin Gong
+*
+* @section DESCRIPTION
+*
+* This source file is part of KlayGE
+* For the latest info, see http://www.klayge.org
+*
+* @section LICENSE
+*
+* This program is free software; you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published
+* by the Free Software Foundation; either version 2 of the License, or
+* (at your option) any later version.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with this program; if not, write to the Free Software
+* Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+*
+* You may alternatively use this source under the terms of
+* the KlayGE Proprietary License (KPL). You can obtained such a license
+* from http://www.klayge.org/licensing/.
+*/
+
+#ifndef _KLAYGE_SHADERCODEDEPENDENCY_HPP
+#define _KLAYGE_SHADERCODEDEPENDENCY_HPP
+
+#pragma once
+
+#include <KlayGE/PreDeclare.hpp>
+
+#include <string>
+#include <vector>
+#include <map>
+
+namespace KlayGE
+{
+	class ShaderCacheKey;
+
+	// Splits the shader code of an effect into top level items: functions, structs, variables and preprocessor
+	//  lines. A stage depends on the items reachable from its entry function through the identifiers they use.
+	//  Items it can't tell the names of, such as preprocessor lines, are kept for all stages.
+	class KLAYGE_CORE_API ShaderCodeDependency
+	{
+		struct Item
+		{
+			std::string text;
+			std::vector<std::string> refs;
+		};
+
+	public:
+		explicit ShaderCodeDependency(RenderEffect const & effect);
+		explicit ShaderCodeDependency(std::string const & code);
+
+		// The items the function depends on, in the order of the code
+		void ReachableCode(std::string const & func_name, std::vector<std::string>& items) const;
+		void AppendCode(ShaderCacheKey& key, std::string const & func_name) const;
+
+	private:
+		void Split(std::string const & code);
+		void AddItem(Item& item, std::vector<std::string> const & names, std::string const & text);
+
+	private:
+		std::vector<Item> items_;
+		std::vector<size_t> root_items_;
+		std::map<std::string, std::vector<size_t> > definitions_;
+	};
+}
+
+#endif		// _KLAYGE_SHADERCODEDEPENDENCY_HPP
@@ -105,6 +105,11 @@ namespace KlayGE
 			std::vector<uint32_t> const & shader_desc_ids) = 0;
 		virtual void StreamOut(std::ostream& os, ShaderType type) = 0;
 
+		// Generates and compiles the code of a stage without touching the graphics API, for AttachShader to pick up.
+		// Different shader objects can be compiled on different threads at the same time. Plugins that can't split
+		//  compiling from attaching leave it empty and compile in AttachShader.
+		virtual void CompileShader(ShaderType type, RenderEffect const & effect,
+			RenderTechnique const & tech, RenderPass const & pass, std::vector<uint32_t> const & shader_desc_ids);
 		virtual void AttachShader(ShaderType type, RenderEffect const & effect,
 			RenderTechnique const & tech, RenderPass const & pass, std::vector<uint32_t> const & shader_desc_ids) = 0;
 		virtual void AttachShader(ShaderType type, RenderEffect const & effect,
@@ -83,6 +83,11 @@ namespace KlayGE
 			void* output, uint32_t out_row_pitch, uint32_t out_slice_pitch,
 			void const * input, uint32_t in_row_pitch, uint32_t in_slice_pitch,
 			TexCompressionMethod method);
+		// Encodes depth slices that are a slice pitch apart. By default it's one 2D EncodeMem per slice.
+		virtual void EncodeMem(uint32_t width, uint32_t height, uint32_t depth,
+			void* output, uint32_t out_row_pitch, uint32_t out_slice_pitch,
+			void const * input, uint32_t in_row_pitch, uint32_t in_slice_pitch,
+			TexCompressionMethod method);
 		virtual void DecodeMem(uint32_t width, uint32_t height,
 			void* output, uint32_t out_row_pitch, uint32_t out_slice_pitch,
 			void const * input, uint32_t in_row_pitch, uint32_t in_slice_pitch);
@@ -135,6 +135,14 @@ namespace KlayGE
 
 		virtual void EncodeBlock(void* output, void const * input, TexCompressionMethod method) KLAYGE_OVERRIDE;
 		virtual void DecodeBlock(void* output, void const * input) KLAYGE_OVERRIDE;
+
+		using TexCompression::EncodeMem;
+
+		// Encodes a row of blocks at a time, two blocks per step with AVX2
+		virtual void EncodeMem(uint32_t width, uint32_t height,
+			void* output, uint32_t out_row_pitch, uint32_t out_slice_pitch,
+			void const * input, uint32_t in_row_pitch, uint32_t in_slice_pitch,
+			TexCompressionMethod method) KLAYGE_OVERRIDE;
 	};
 
 	class KLAYGE_CORE_API TexCompressionBC5 : public TexCompression
@@ -157,16 +165,45 @@ namespace KlayGE
 		virtual void EncodeBlock(void* output, void const * input, TexCompressionMethod method) KLAYGE_OVERRIDE;
 		virtual void DecodeBlock(void* output, void const * input) KLAYGE_OVERRIDE;
 
+		// Blocks are independent and EncodeBlock is reentrant, so rows of blocks of all slices are encoded in parallel
+		virtual void EncodeMem(uint32_t width, uint32_t height,
+			void* output, uint32_t out_row_pitch, uint32_t out_slice_pitch,
+			void const * input, uint32_t in_row_pitch, uint32_t in_slice_pitch,
+			TexCompressionMethod method) KLAYGE_OVERRIDE;
+		virtual void EncodeMem(uint32_t width, uint32_t height, uint32_t depth,
+			void* output, uint32_t out_row_pitch, uint32_t out_slice_pitch,
+			void const * input, uint32_t in_row_pitch, uint32_t in_slice_pitch,
+			TexCompressionMethod method) KLAYGE_OVERRIDE;
+
+		void EncodeBC6Internal(void* output, void const * input, TexCompressionMethod method, bool signed_fmt);
 		void DecodeBC6Internal(void* output, void const * input, bool signed_fmt);
 
 	private:
+		static uint32_t const BC6_MAX_REGIONS = 2;
+		static uint32_t const BC6_MAX_INDICES = 16;
+
+		struct CompressParams
+		{
+			uint32_t mode;
+			uint32_t shape;
+			array<std::pair<int3, int3>, BC6_MAX_REGIONS> end_pts;
+			array<uint8_t, BC6_MAX_INDICES> indices;
+		};
+
+	private:
+		int Quantize(int comp, uint8_t bits_per_comp, bool signed_fmt);
 		int Unquantize(int comp, uint8_t bits_per_comp, bool signed_fmt);
 		int FinishUnquantize(int comp, bool signed_fmt);
 
-	private:
-		static uint32_t const BC6_MAX_REGIONS = 2;
-		static uint32_t const BC6_MAX_INDICES = 16;
+		uint64_t CompressMode(CompressParams& params, float3 const * pixels, int3 const * targets,
+			uint32_t mode, uint32_t shape, uint32_t refine_iterations, bool signed_fmt);
+		uint64_t QuantizeEndpoints(CompressParams& params, std::pair<float3, float3> const * unq_end_pts,
+			int3 const * targets, bool signed_fmt);
+		uint64_t AssignIndices(CompressParams& params, int3 const * targets, bool anchor_constrained, bool signed_fmt);
+		bool ClampDeltas(CompressParams& params);
+		void PackBC6Block(void* output, CompressParams const & params);
 
+	private:
 		static int32_t const BC6_WEIGHT_MAX = 64;
 		static uint32_t const BC6_WEIGHT_SHIFT = 6;
 		static int32_t const BC6_WEIGHT_ROUND = 32;
@@ -218,6 +255,15 @@ namespace KlayGE
 		virtual void EncodeBlock(void* output, void const * input, TexCompressionMethod method) KLAYGE_OVERRIDE;
 		virtual void DecodeBlock(void* output, void const * input) KLAYGE_OVERRIDE;
 
+		virtual void EncodeMem(uint32_t width, uint32_t height,
+			void* output, uint32_t out_row_pitch, uint32_t out_slice_pitch,
+			void const * input, uint32_t in_row_pitch, uint32_t in_slice_pitch,
+			TexCompressionMethod method) KLAYGE_OVERRIDE;
+		virtual void EncodeMem(uint32_t width, uint32_t height, uint32_t depth,
+			void* output, uint32_t out_row_pitch, uint32_t out_slice_pitch,
+			void const * input, uint32_t in_row_pitch, uint32_t in_slice_pitch,
+			TexCompressionMethod method) KLAYGE_OVERRIDE;
+
 	private:
 		TexCompressionBC6UPtr bc6u_codec_;
 	};
@@ -331,6 +377,20 @@ namespace KlayGE
 	};
 
 	KLAYGE_CORE_API void BC4ToBC1G(BC1Block& bc1, BC4Block const & bc4);
+
+	namespace detail
+	{
+		// The SIMD block kernels of the BC1 and BC4 encoders, and their scalar references
+		KLAYGE_CORE_API void BC1BlockMinMaxColors(ARGBColor32 const * argb, ARGBColor32& min_clr, ARGBColor32& max_clr);
+		KLAYGE_CORE_API void BC1BlockMinMaxColorsScalar(ARGBColor32 const * argb, ARGBColor32& min_clr, ARGBColor32& max_clr);
+		KLAYGE_CORE_API void BC1BlockColorDots(int* dots, ARGBColor32 const * argb, int dirr, int dirg, int dirb);
+		KLAYGE_CORE_API void BC1BlockColorDotsScalar(int* dots, ARGBColor32 const * argb, int dirr, int dirg, int dirb);
+		KLAYGE_CORE_API uint32_t BC1BlockColorIndices(int const * dots, int c0_point, int half_point, int c3_point);
+		KLAYGE_CORE_API uint32_t BC1BlockColorIndicesScalar(int const * dots, int c0_point, int half_point, int c3_point);
+		// input holds num_blocks blocks of 16 texels one after another
+		KLAYGE_CORE_API void EncodeBC4Blocks(BC4Block* output, uint8_t const * input, uint32_t num_blocks);
+		KLAYGE_CORE_API void EncodeBC4BlocksScalar(BC4Block* output, uint8_t const * input, uint32_t num_blocks);
+	}
 }
 
 #endif		// _TEXCOMPRESSIONBC_HPP
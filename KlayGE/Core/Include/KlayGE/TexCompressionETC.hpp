@@ -89,6 +89,19 @@ namespace KlayGE
 		ETC2HModeBlock etc2_h_mode;
 		ETC2PlanarModeBlock etc2_planar_mode;
 	};
+
+	struct ETC2R11Block
+	{
+		uint8_t base_codeword;
+		uint8_t multiplier_table;
+		uint8_t indices[6];
+	};
+
+	struct ETC2RG11Block
+	{
+		ETC2R11Block red;
+		ETC2R11Block green;
+	};
 #ifdef KLAYGE_HAS_STRUCT_PACK
 	#pragma pack(pop)
 #endif
@@ -216,10 +229,15 @@ namespace KlayGE
 		virtual void EncodeBlock(void* output, void const * input, TexCompressionMethod method) KLAYGE_OVERRIDE;
 		virtual void DecodeBlock(void* output, void const * input) KLAYGE_OVERRIDE;
 
+		uint64_t EncodeETC2BlockInternal(ETC2Block& output, ARGBColor32 const * argb, TexCompressionMethod method);
 		void DecodeETCTModeInternal(ARGBColor32* argb, ETC2TModeBlock const & etc2, bool alpha);
 		void DecodeETCHModeInternal(ARGBColor32* argb, ETC2HModeBlock const & etc2, bool alpha);
 		void DecodeETCPlanarModeInternal(ARGBColor32* argb, ETC2PlanarModeBlock const & etc2);
 
+	private:
+		uint64_t EncodeETC2THModeInternal(ETC2Block& output, ARGBColor32 const * argb, TexCompressionMethod method);
+		uint64_t EncodeETC2PlanarModeInternal(ETC2Block& output, ARGBColor32 const * argb, TexCompressionMethod method);
+
 	private:
 		TexCompressionETC1Ptr etc1_codec_;
 	};
@@ -236,6 +254,35 @@ namespace KlayGE
 		TexCompressionETC1Ptr etc1_codec_;
 		TexCompressionETC2RGB8Ptr etc2_rgb8_codec_;
 	};
+
+	// EAC, unsigned only. Blocks are decoded to 8 bits, like BC4.
+	class KLAYGE_CORE_API TexCompressionETC2R11 : public TexCompression
+	{
+	public:
+		TexCompressionETC2R11();
+
+		virtual void EncodeBlock(void* output, void const * input, TexCompressionMethod method) KLAYGE_OVERRIDE;
+		virtual void DecodeBlock(void* output, void const * input) KLAYGE_OVERRIDE;
+
+		// Encodes num_values distinct 11-bit values, each one weighted by the number of pixels it covers.
+		// selectors receives the index of each value. Returns the weighted squared error in 11-bit units.
+		uint64_t EncodeETC2R11Internal(ETC2R11Block& output, uint8_t* selectors, uint32_t const * values,
+			uint32_t const * weights, uint32_t num_values, TexCompressionMethod method) const;
+		void PackETC2R11Selectors(ETC2R11Block& output, uint8_t const * pixel_selectors) const;
+		void DecodeETC2R11Internal(uint32_t* values, ETC2R11Block const & r11) const;
+	};
+
+	class KLAYGE_CORE_API TexCompressionETC2RG11 : public TexCompression
+	{
+	public:
+		TexCompressionETC2RG11();
+
+		virtual void EncodeBlock(void* output, void const * input, TexCompressionMethod method) KLAYGE_OVERRIDE;
+		virtual void DecodeBlock(void* output, void const * input) KLAYGE_OVERRIDE;
+
+	private:
+		TexCompressionETC2R11Ptr r11_codec_;
+	};
 }
 
 #endif		// _TEXCOMPRESSIONETC_HPP
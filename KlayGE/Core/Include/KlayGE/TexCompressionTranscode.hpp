@@ -0,0 +1,63 @@
+/**
+* @file TexCompressionTranscode.hpp
+* @author Minmin Gong
+*
+* @section DESCRIPTION
+*
+* This source file is part of KlayGE
+* For the latest info, see http://www.klayge.org
+*
+* @section LICENSE
+*
+* This program is free software; you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published
+* by the Free Software Foundation; either version 2 of the License, or
+* (at your option) any later version.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with this program; if not, write to the Free Software
+* Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+*
+* You may alternatively use this source under the terms of
+* the KlayGE Proprietary License (KPL). You can obtained such a license
+* from http://www.klayge.org/licensing/.
+*/
+
+
+#ifndef _TEXCOMPRESSIONTRANSCODE_HPP
+#define _TEXCOMPRESSIONTRANSCODE_HPP
+
+#pragma once
+
+#include <KlayGE/ElementFormat.hpp>
+#include <KlayGE/TexCompression.hpp>
+
+#include <vector>
+
+namespace KlayGE
+{
+	// Block by block conversion between BC and ETC/EAC: BC1 <-> ETC1/ETC2 RGB8, BC4 <-> EAC R11, BC5 <-> EAC RG11.
+	// Both formats of a pair have the same block size, so dst_data can be the same memory as src_data.
+	KLAYGE_CORE_API bool IsTranscodable(ElementFormat dst_format, ElementFormat src_format);
+	// Also checks the content. BC1 data with transparent texels can't go to ETC1/ETC2 RGB8 without losing the alpha.
+	KLAYGE_CORE_API bool IsTranscodable(ElementFormat dst_format, void const * src_data, uint32_t src_row_pitch, uint32_t src_slice_pitch,
+		ElementFormat src_format, uint32_t width, uint32_t height, uint32_t depth);
+	// Formats that src_format can be transcoded to, the preferred one first.
+	KLAYGE_CORE_API void TranscodeTargets(std::vector<ElementFormat>& dst_formats, ElementFormat src_format);
+
+	// Works block by block, without an intermediate image. BC1 and BC4/BC5 blocks are transcoded from their palettes:
+	// the ETC1 base colors and intensity tables, and the EAC bases, multipliers and tables, are fitted to the used
+	// palette entries, whose selectors are then given to the texels. ETC sources go through the palette of their decoded
+	// texels to BC1 endpoints, EAC ones are decoded and encoded to BC4. With other methods than TCM_Speed, the blocks
+	// that end up too far from the source are encoded again from their texels.
+	KLAYGE_CORE_API void TranscodeTexture(void* dst_data, uint32_t dst_row_pitch, uint32_t dst_slice_pitch, ElementFormat dst_format,
+		void const * src_data, uint32_t src_row_pitch, uint32_t src_slice_pitch, ElementFormat src_format,
+		uint32_t width, uint32_t height, uint32_t depth, TexCompressionMethod method);
+}
+
+#endif		// _TEXCOMPRESSIONTRANSCODE_HPP
@@ -52,6 +52,7 @@
 
 #include <KlayGE/PreDeclare.hpp>
 #include <KlayGE/ElementFormat.hpp>
+#include <KlayGE/MemoryTracker.hpp>
 
 #include <string>
 #include <vector>
@@ -67,6 +68,17 @@ namespace KlayGE
 		TMA_Read_Write
 	};
 
+	// Filters used to generate mip levels on the CPU
+	enum MipFilter
+	{
+		// 2x2 average, the same as the hardware mip generation for power of two sizes
+		MF_Box,
+		// Kaiser windowed sinc, radius 3, alpha 4
+		MF_Kaiser,
+		// Lanczos3
+		MF_Lanczos
+	};
+
 	// Abstract class representing a Texture resource.
 	// @remarks
 	// The actual concrete subclass which will exist for a texture
@@ -232,6 +244,12 @@ namespace KlayGE
 
 		uint32_t AccessHint() const;
 
+		// Tag the GPU memory of this texture is accounted under
+		void TrackingTag(MemoryTag tag);
+		MemoryTag TrackingTag() const;
+		// Size of the hardware resource, estimated from the format and dimensions
+		uint64_t GPUMemorySize() const;
+
 		// Copies (and maybe scales to fit) the contents of this texture to another texture.
 		virtual void CopyToTexture(Texture& target) = 0;
 		virtual void CopyToSubTexture1D(Texture& target,
@@ -248,6 +266,8 @@ namespace KlayGE
 			uint32_t src_array_index, CubeFaces src_face, uint32_t src_level, uint32_t src_x_offset, uint32_t src_y_offset, uint32_t src_width, uint32_t src_height) = 0;
 
 		virtual void BuildMipSubLevels() = 0;
+		// Builds the mip levels from level 0 with GenerateMipMaps, through a CPU accessible copy if needed
+		void BuildMipSubLevelsOnCPU(MipFilter filter);
 
 		virtual void Map1D(uint32_t array_index, uint32_t level, TextureMapAccess tma,
 			uint32_t x_offset, uint32_t width,
@@ -272,6 +292,9 @@ namespace KlayGE
 		virtual void ReclaimHWResource(ElementInitData const * init_data) = 0;
 
 	protected:
+		// Called by the implementations when the hardware resource is created or released
+		void UpdateGPUMemoryUsage(bool has_hw_resource);
+
 		void ResizeTexture1D(Texture& target,
 			uint32_t dst_array_index, uint32_t dst_level, uint32_t dst_x_offset, uint32_t dst_width,
 			uint32_t src_array_index, uint32_t src_level, uint32_t src_x_offset, uint32_t src_width,
@@ -297,6 +320,9 @@ namespace KlayGE
 		TextureType		type_;
 		uint32_t		sample_count_, sample_quality_;
 		uint32_t		access_hint_;
+
+		MemoryTag		tracking_tag_;
+		uint64_t		tracked_gpu_size_;
 	};
 
 	KLAYGE_CORE_API void GetImageInfo(std::string const & tex_name, Texture::TextureType& type,
@@ -326,6 +352,16 @@ namespace KlayGE
 		uint32_t src_width, uint32_t src_height, uint32_t src_depth,
 		bool linear);
 
+	// Generates num_mipmaps levels (0 for a full chain) for each of the num_sub_res top levels in src_data.
+	// Faces of cube maps are separate sub resources, and dst_data is indexed by sub_res * num_mipmaps + level.
+	// The filtering is done in ABGR32F, so it's in linear space for sRGB formats, and each level is filtered
+	//  from the unquantized previous one. Compressed dst_format are encoded level by level as they are produced.
+	// Work is split over sub resources and rows on the global thread pool.
+	KLAYGE_CORE_API void GenerateMipMaps(std::vector<ElementInitData>& dst_data, std::vector<uint8_t>& dst_data_block,
+		ElementFormat dst_format, ElementInitData const * src_data, ElementFormat src_format,
+		uint32_t width, uint32_t height, uint32_t depth, uint32_t num_sub_res, uint32_t num_mipmaps,
+		MipFilter filter);
+
 	// return the lookat and up vector in cubemap view
 	//////////////////////////////////////////////////////////////////////////////////
 	template <typename T>
@@ -35,6 +35,8 @@
 #include <KlayGE/DeferredRenderingLayer.hpp>
 #include <KFL/Thread.hpp>
 #include <KlayGE/PerfProfiler.hpp>
+#include <KlayGE/MemoryTracker.hpp>
+#include <KlayGE/ShaderCache.hpp>
 #include <KlayGE/UI.hpp>
 
 #include <fstream>
@@ -90,6 +92,9 @@ namespace KlayGE
 #endif
 
 		gtp_instance_ = MakeSharedPtr<thread_pool>(1, 16);
+
+		AsyncLog(true);
+		InstallLogCrashHandler();
 	}
 
 	Context::~Context()
@@ -100,6 +105,7 @@ namespace KlayGE
 	{
 		scene_mgr_.reset();
 
+		ShaderCache::Destroy();
 		ResLoader::Destroy();
 		PerfProfiler::Destroy();
 		UIManager::Destroy();
@@ -115,6 +121,8 @@ namespace KlayGE
 		app_ = nullptr;
 
 		gtp_instance_.reset();
+
+		AsyncLog(false);
 	}
 
 	Context& Context::Instance()
@@ -239,6 +247,7 @@ namespace KlayGE
 		float stereo_separation = 0;
 		std::string graphics_options;
 		bool perf_profiler = false;
+		bool memory_tracker = false;
 		bool location_sensor = false;
 
 		std::string rf_name = "D3D11";
@@ -306,6 +315,12 @@ namespace KlayGE
 				perf_profiler = perf_profiler_node->Attrib("enabled")->ValueInt() ? true : false;
 			}
 
+			XMLNodePtr memory_tracker_node = context_node->FirstNode("memory_tracker");
+			if (memory_tracker_node)
+			{
+				memory_tracker = memory_tracker_node->Attrib("enabled")->ValueInt() ? true : false;
+			}
+
 			XMLNodePtr location_sensor_node = context_node->FirstNode("location_sensor");
 			if (location_sensor_node)
 			{
@@ -607,7 +622,10 @@ namespace KlayGE
 
 		cfg_.deferred_rendering = false;
 		cfg_.perf_profiler = perf_profiler;
+		cfg_.memory_tracker = memory_tracker;
 		cfg_.location_sensor = location_sensor;
+
+		MemoryTracker::Instance().Enable(cfg_.memory_tracker);
 	}
 
 	void Context::SaveCfg(std::string const & cfg_file)
@@ -650,6 +668,10 @@ namespace KlayGE
 			perf_profiler_node->AppendAttrib(cfg_doc.AllocAttribInt("enabled", cfg_.perf_profiler));
 			context_node->AppendNode(perf_profiler_node);
 
+			XMLNodePtr memory_tracker_node = cfg_doc.AllocNode(XNT_Element, "memory_tracker");
+			memory_tracker_node->AppendAttrib(cfg_doc.AllocAttribInt("enabled", cfg_.memory_tracker));
+			context_node->AppendNode(memory_tracker_node);
+
 			XMLNodePtr location_sensor_node = cfg_doc.AllocNode(XNT_Element, "location_sensor");
 			location_sensor_node->AppendAttrib(cfg_doc.AllocAttribInt("enabled", cfg_.location_sensor));
 			context_node->AppendNode(location_sensor_node);
@@ -805,6 +827,7 @@ namespace KlayGE
 	void Context::Config(ContextCfg const & cfg)
 	{
 		cfg_ = cfg;
+		MemoryTracker::Instance().Enable(cfg_.memory_tracker);
 	}
 
 	ContextCfg const & Context::Config() const
@@ -0,0 +1,208 @@
+/**
+* @file MemoryTracker.cpp
+* @author Minmin Gong
+*
+* @section DESCRIPTION
+*
+* This source file is part of KlayGE
+* For the latest info, see http://www.klayge.org
+*
+* @section LICENSE
+*
+* This program is free software; you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published
+* by the Free Software Foundation; either version 2 of the License, or
+* (at your option) any later version.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with this program; if not, write to the Free Software
+* Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+*
+* You may alternatively use this source under the terms of
+* the KlayGE Proprietary License (KPL). You can obtained such a license
+* from http://www.klayge.org/licensing/.
+*/
+
+
+#include <KlayGE/KlayGE.hpp>
+
+#include <fstream>
+#include <iomanip>
+
+#include <KlayGE/MemoryTracker.hpp>
+
+namespace KlayGE
+{
+	MemoryTracker::MemoryTracker()
+		: enabled_(false)
+	{
+		for (int tag = 0; tag < MT_NumTags; ++ tag)
+		{
+			for (int pool = 0; pool < MP_NumPools; ++ pool)
+			{
+				Counter& counter = counters_[tag][pool];
+				counter.current_bytes = 0;
+				counter.peak_bytes = 0;
+				counter.num_allocations = 0;
+				counter.num_deallocations = 0;
+			}
+		}
+		for (int pool = 0; pool < MP_NumPools; ++ pool)
+		{
+			totals_[pool].current_bytes = 0;
+			totals_[pool].peak_bytes = 0;
+			totals_[pool].num_allocations = 0;
+			totals_[pool].num_deallocations = 0;
+		}
+	}
+
+	MemoryTracker& MemoryTracker::Instance()
+	{
+		// Never destroyed before the resources, whose destructors still report
+		static MemoryTracker* tracker = new MemoryTracker;
+		return *tracker;
+	}
+
+	void MemoryTracker::Enable(bool enable)
+	{
+		enabled_.store(enable, memory_order_relaxed);
+	}
+
+	void MemoryTracker::Add(Counter& counter, int64_t bytes)
+	{
+		int64_t const current = counter.current_bytes.fetch_add(bytes, memory_order_relaxed) + bytes;
+		if (bytes > 0)
+		{
+			counter.num_allocations.fetch_add(1, memory_order_relaxed);
+
+			int64_t peak = counter.peak_bytes.load(memory_order_relaxed);
+			while ((current > peak)
+				&& !counter.peak_bytes.compare_exchange_weak(peak, current, memory_order_relaxed))
+			{
+			}
+		}
+		else
+		{
+			counter.num_deallocations.fetch_add(1, memory_order_relaxed);
+		}
+	}
+
+	MemoryUsage MemoryTracker::Load(Counter const & counter)
+	{
+		MemoryUsage usage;
+		usage.current_bytes = counter.current_bytes.load(memory_order_relaxed);
+		usage.peak_bytes = counter.peak_bytes.load(memory_order_relaxed);
+		usage.num_allocations = counter.num_allocations.load(memory_order_relaxed);
+		usage.num_deallocations = counter.num_deallocations.load(memory_order_relaxed);
+		return usage;
+	}
+
+	void MemoryTracker::Allocate(MemoryTag tag, MemoryPool pool, uint64_t bytes)
+	{
+		BOOST_ASSERT(tag < MT_NumTags);
+		BOOST_ASSERT(pool < MP_NumPools);
+
+		if (bytes > 0)
+		{
+			Add(counters_[tag][pool], static_cast<int64_t>(bytes));
+			Add(totals_[pool], static_cast<int64_t>(bytes));
+		}
+	}
+
+	void MemoryTracker::Deallocate(MemoryTag tag, MemoryPool pool, uint64_t bytes)
+	{
+		BOOST_ASSERT(tag < MT_NumTags);
+		BOOST_ASSERT(pool < MP_NumPools);
+
+		if (bytes > 0)
+		{
+			Add(counters_[tag][pool], -static_cast<int64_t>(bytes));
+			Add(totals_[pool], -static_cast<int64_t>(bytes));
+		}
+	}
+
+	MemoryUsage MemoryTracker::Usage(MemoryTag tag, MemoryPool pool) const
+	{
+		BOOST_ASSERT(tag < MT_NumTags);
+		BOOST_ASSERT(pool < MP_NumPools);
+
+		return Load(counters_[tag][pool]);
+	}
+
+	MemoryUsage MemoryTracker::TotalUsage(MemoryPool pool) const
+	{
+		BOOST_ASSERT(pool < MP_NumPools);
+
+		return Load(totals_[pool]);
+	}
+
+	void MemoryTracker::ResetPeaks()
+	{
+		for (int tag = 0; tag < MT_NumTags; ++ tag)
+		{
+			for (int pool = 0; pool < MP_NumPools; ++ pool)
+			{
+				Counter& counter = counters_[tag][pool];
+				counter.peak_bytes.store(counter.current_bytes.load(memory_order_relaxed), memory_order_relaxed);
+			}
+		}
+		for (int pool = 0; pool < MP_NumPools; ++ pool)
+		{
+			totals_[pool].peak_bytes.store(totals_[pool].current_bytes.load(memory_order_relaxed), memory_order_relaxed);
+		}
+	}
+
+	void MemoryTracker::DumpToStream(std::ostream& os) const
+	{
+		static char const * pool_names[] = { "CPU", "GPU" };
+		KLAYGE_STATIC_ASSERT(sizeof(pool_names) / sizeof(pool_names[0]) == MP_NumPools, "Pool names mismatch.");
+
+		os << std::left << std::setw(16) << "Tag" << std::setw(6) << "Pool"
+			<< std::right << std::setw(16) << "Current (KB)" << std::setw(16) << "Peak (KB)"
+			<< std::setw(12) << "Allocs" << std::setw(12) << "Frees" << std::endl;
+		for (int pool = 0; pool < MP_NumPools; ++ pool)
+		{
+			for (int tag = 0; tag < MT_NumTags; ++ tag)
+			{
+				MemoryUsage const usage = this->Usage(static_cast<MemoryTag>(tag), static_cast<MemoryPool>(pool));
+				os << std::left << std::setw(16) << TagName(static_cast<MemoryTag>(tag)) << std::setw(6) << pool_names[pool]
+					<< std::right << std::setw(16) << usage.current_bytes / 1024 << std::setw(16) << usage.peak_bytes / 1024
+					<< std::setw(12) << usage.num_allocations << std::setw(12) << usage.num_deallocations << std::endl;
+			}
+
+			MemoryUsage const usage = this->TotalUsage(static_cast<MemoryPool>(pool));
+			os << std::left << std::setw(16) << "Total" << std::setw(6) << pool_names[pool]
+				<< std::right << std::setw(16) << usage.current_bytes / 1024 << std::setw(16) << usage.peak_bytes / 1024
+				<< std::setw(12) << usage.num_allocations << std::setw(12) << usage.num_deallocations << std::endl;
+		}
+	}
+
+	void MemoryTracker::DumpToFile(std::string const & file_name) const
+	{
+		std::ofstream ofs(file_name.c_str());
+		this->DumpToStream(ofs);
+	}
+
+	char const * MemoryTracker::TagName(MemoryTag tag)
+	{
+		static char const * tag_names[] =
+		{
+			"General",
+			"Texture",
+			"GraphicsBuffer",
+			"Model",
+			"Effect",
+			"Font",
+			"JudaTexture"
+		};
+		KLAYGE_STATIC_ASSERT(sizeof(tag_names) / sizeof(tag_names[0]) == MT_NumTags, "Tag names mismatch.");
+
+		BOOST_ASSERT(tag < MT_NumTags);
+		return tag_names[tag];
+	}
+}
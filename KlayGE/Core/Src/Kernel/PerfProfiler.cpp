@@ -34,21 +34,118 @@
 #include <KlayGE/Query.hpp>
 #include <KFL/Thread.hpp>
 
+#include <algorithm>
 #include <fstream>
+#include <limits>
 
 #include <KlayGE/PerfProfiler.hpp>
 
+#if defined(KLAYGE_COMPILER_MSVC)
+	#define KLAYGE_PERF_THREAD_LOCAL __declspec(thread)
+#else
+	#define KLAYGE_PERF_THREAD_LOCAL __thread
+#endif
+
+namespace KlayGE
+{
+	// Single producer (the owning thread), single consumer (PerfProfiler::CollectData) ring of finished events
+	struct PerfThreadBuffer
+	{
+		static uint32_t const CAPACITY = 4096;
+
+		explicit PerfThreadBuffer(uint32_t index)
+			: thread_index(index), depth(0), write_pos(0), read_pos(0), num_dropped(0)
+		{
+			events.resize(CAPACITY);
+		}
+
+		void Push(PerfEvent const & event)
+		{
+			uint32_t const w = write_pos.load(memory_order_relaxed);
+			if (w - read_pos.load(memory_order_acquire) >= CAPACITY)
+			{
+				num_dropped.fetch_add(1, memory_order_relaxed);
+			}
+			else
+			{
+				events[w & (CAPACITY - 1)] = event;
+				write_pos.store(w + 1, memory_order_release);
+			}
+		}
+
+		void Drain(std::vector<PerfEvent>& out)
+		{
+			uint32_t r = read_pos.load(memory_order_relaxed);
+			uint32_t const w = write_pos.load(memory_order_acquire);
+			for (; r != w; ++ r)
+			{
+				out.push_back(events[r & (CAPACITY - 1)]);
+			}
+			read_pos.store(r, memory_order_release);
+		}
+
+		uint32_t thread_index;
+		uint32_t depth;
+
+		std::vector<PerfEvent> events;
+		atomic<uint32_t> write_pos;
+		atomic<uint32_t> read_pos;
+		atomic<uint32_t> num_dropped;
+	};
+}
+
 namespace
 {
-	KlayGE::mutex singleton_mutex;
+	using namespace KlayGE;
+
+	mutex singleton_mutex;
+
+	atomic<uint32_t> profiler_serial(0);
+
+	// The serial tells apart buffers of a destroyed profiler from the current one
+	KLAYGE_PERF_THREAD_LOCAL PerfThreadBuffer* tls_thread_buffer = nullptr;
+	KLAYGE_PERF_THREAD_LOCAL uint32_t tls_profiler_serial = 0;
+
+	bool IsProfilerEnabled()
+	{
+		return Context::Instance().Config().perf_profiler;
+	}
+
+	void WriteJSONString(std::ostream& os, char const * str)
+	{
+		os << '"';
+		for (; *str; ++ str)
+		{
+			char const ch = *str;
+			if (('"' == ch) || ('\\' == ch))
+			{
+				os << '\\' << ch;
+			}
+			else if (static_cast<unsigned char>(ch) < 0x20)
+			{
+				os << ' ';
+			}
+			else
+			{
+				os << ch;
+			}
+		}
+		os << '"';
+	}
+
+	bool LessByBeginTime(PerfRangePtr const & lhs, PerfRangePtr const & rhs)
+	{
+		return lhs->CPUBeginTime() < rhs->CPUBeginTime();
+	}
 }
 
 namespace KlayGE
 {
 	shared_ptr<PerfProfiler> PerfProfiler::perf_profiler_instance_;
 
-	PerfRange::PerfRange()
-		: cpu_time_(0), gpu_time_(0), dirty_(false)
+	PerfRange::PerfRange(int category, std::string const & name)
+		: category_(category), name_(name), thread_buffer_(nullptr),
+			cpu_begin_time_(0), cpu_time_(0), gpu_time_(0), dirty_(false)
 	{
 		RenderFactory& rf = Context::Instance().RenderFactoryInstance();
 		gpu_timer_query_ = rf.MakeTimerQuery();
@@ -56,10 +153,14 @@ namespace KlayGE
 
 	void PerfRange::Begin()
 	{
-		if (Context::Instance().Config().perf_profiler)
+		if (IsProfilerEnabled())
 		{
+			PerfProfiler& profiler = PerfProfiler::Instance();
+			thread_buffer_ = profiler.ThreadBuffer();
+			++ thread_buffer_->depth;
+
 			dirty_ = true;
-			cpu_timer_.restart();
+			cpu_begin_time_ = profiler.TimeStamp();
 			if (gpu_timer_query_)
 			{
 				gpu_timer_query_->Begin();
@@ -69,13 +170,29 @@ namespace KlayGE
 
 	void PerfRange::End()
 	{
-		if (Context::Instance().Config().perf_profiler)
+		if (IsProfilerEnabled() && thread_buffer_)
 		{
-			cpu_time_ = cpu_timer_.elapsed();
+			double const end_time = PerfProfiler::Instance().TimeStamp();
+			cpu_time_ = end_time - cpu_begin_time_;
 			if (gpu_timer_query_)
 			{
 				gpu_timer_query_->End();
 			}
+
+			-- thread_buffer_->depth;
+
+			PerfEvent event;
+			event.name = name_.c_str();
+			event.category = category_;
+			event.type = PET_CPURange;
+			event.thread_index = thread_buffer_->thread_index;
+			event.depth = thread_buffer_->depth;
+			event.frame_id = 0;
+			event.begin_time = cpu_begin_time_;
+			event.end_time = end_time;
+			thread_buffer_->Push(event);
+
+			thread_buffer_ = nullptr;
 		}
 	}
 
@@ -87,10 +204,29 @@ namespace KlayGE
 			{
 				gpu_time_ = checked_pointer_cast<TimerQuery>(gpu_timer_query_)->TimeElapsed();
 			}
+			else
+			{
+				gpu_time_ = -1;
+			}
 			dirty_ = false;
 		}
 	}
 
+	int PerfRange::Category() const
+	{
+		return category_;
+	}
+
+	std::string const & PerfRange::Name() const
+	{
+		return name_;
+	}
+
+	double PerfRange::CPUBeginTime() const
+	{
+		return cpu_begin_time_;
+	}
+
 	double PerfRange::CPUTime() const
 	{
 		return cpu_time_;
@@ -107,8 +243,40 @@ namespace KlayGE
 	}
 
 
+	PerfScope::PerfScope(char const * name, int category)
+		: name_(name), category_(category), thread_buffer_(nullptr), begin_time_(0)
+	{
+		if (IsProfilerEnabled())
+		{
+			PerfProfiler& profiler = PerfProfiler::Instance();
+			thread_buffer_ = profiler.ThreadBuffer();
+			++ thread_buffer_->depth;
+			begin_time_ = profiler.TimeStamp();
+		}
+	}
+
+	PerfScope::~PerfScope()
+	{
+		if (thread_buffer_)
+		{
+			-- thread_buffer_->depth;
+
+			PerfEvent event;
+			event.name = name_;
+			event.category = category_;
+			event.type = PET_CPUScope;
+			event.thread_index = thread_buffer_->thread_index;
+			event.depth = thread_buffer_->depth;
+			event.frame_id = 0;
+			event.begin_time = begin_time_;
+			event.end_time = PerfProfiler::Instance().TimeStamp();
+			thread_buffer_->Push(event);
+		}
+	}
+
+
 	PerfProfiler::PerfProfiler()
-		: frame_id_(0)
+		: serial_(++ profiler_serial), frame_id_(0), window_size_(DEFAULT_WINDOW_SIZE)
 	{
 	}
 
@@ -141,38 +309,267 @@ namespace KlayGE
 
 	PerfRangePtr PerfProfiler::CreatePerfRange(int category, std::string const & name)
 	{
-		PerfRangePtr range = MakeSharedPtr<PerfRange>();
+		PerfRangePtr range = MakeSharedPtr<PerfRange>(category, name);
 		typedef KlayGE::remove_reference<KLAYGE_DECLTYPE(get<3>(perf_ranges_[0]))>::type PerfDataType;
 		perf_ranges_.push_back(KlayGE::make_tuple(category, name, range, PerfDataType()));
 		return range;
 	}
 
+	double PerfProfiler::TimeStamp() const
+	{
+		return timer_.elapsed();
+	}
+
+	PerfThreadBuffer* PerfProfiler::ThreadBuffer()
+	{
+		if ((tls_profiler_serial != serial_) || !tls_thread_buffer)
+		{
+			lock_guard<mutex> lock(thread_buffers_mutex_);
+
+			// Index 0 is reserved for the GPU timeline
+			shared_ptr<PerfThreadBuffer> buffer
+				= MakeSharedPtr<PerfThreadBuffer>(static_cast<uint32_t>(thread_buffers_.size() + 1));
+			thread_buffers_.push_back(buffer);
+
+			tls_thread_buffer = buffer.get();
+			tls_profiler_serial = serial_;
+		}
+		return tls_thread_buffer;
+	}
+
 	void PerfProfiler::CollectData()
 	{
-		if (Context::Instance().Config().perf_profiler)
+		if (IsProfilerEnabled())
 		{
 			RenderFactory& rf = Context::Instance().RenderFactoryInstance();
 			RenderEngine& re = rf.RenderEngineInstance();
 			re.UpdateGPUTimestampsFrequency();
 
+			std::vector<PerfRangePtr> gpu_ranges;
 			typedef KLAYGE_DECLTYPE(perf_ranges_) PerfRangesType;
 			KLAYGE_FOREACH(PerfRangesType::reference range, perf_ranges_)
 			{
-				if (get<2>(range)->Dirty())
+				PerfRangePtr const & perf_range = get<2>(range);
+				if (perf_range->Dirty())
 				{
-					get<2>(range)->CollectData();
+					perf_range->CollectData();
 					get<3>(range).push_back(KlayGE::make_tuple(frame_id_,
-						get<2>(range)->CPUTime(), get<2>(range)->GPUTime()));
+						perf_range->CPUTime(), perf_range->GPUTime()));
+					if (perf_range->GPUTime() >= 0)
+					{
+						gpu_ranges.push_back(perf_range);
+					}
 				}
 			}
 
+			// The timer queries only measure durations. GPU work can't start before its commands are issued,
+			// and doesn't overlap on one queue, so the start times are estimated by chaining the ranges in
+			// CPU issuing order. The track is labeled as estimated in the trace.
+			std::sort(gpu_ranges.begin(), gpu_ranges.end(), LessByBeginTime);
+			double gpu_cursor = 0;
+			for (size_t i = 0; i < gpu_ranges.size(); ++ i)
+			{
+				PerfEvent event;
+				event.name = gpu_ranges[i]->Name().c_str();
+				event.category = gpu_ranges[i]->Category();
+				event.type = PET_GPURange;
+				event.thread_index = GPU_THREAD_INDEX;
+				event.depth = 0;
+				event.frame_id = frame_id_;
+				event.begin_time = std::max(gpu_ranges[i]->CPUBeginTime(), gpu_cursor);
+				event.end_time = event.begin_time + gpu_ranges[i]->GPUTime();
+				trace_events_.push_back(event);
+
+				gpu_cursor = event.end_time;
+			}
+
+			this->CollectThreadEvents();
+			this->TrimHistory();
+
 			++ frame_id_;
 		}
 	}
 
+	void PerfProfiler::CollectThreadEvents()
+	{
+		drained_events_.clear();
+		{
+			lock_guard<mutex> lock(thread_buffers_mutex_);
+			for (size_t i = 0; i < thread_buffers_.size(); ++ i)
+			{
+				thread_buffers_[i]->Drain(drained_events_);
+			}
+		}
+
+		for (size_t i = 0; i < drained_events_.size(); ++ i)
+		{
+			PerfEvent& event = drained_events_[i];
+			event.frame_id = frame_id_;
+			trace_events_.push_back(event);
+
+			if (PET_CPUScope == event.type)
+			{
+				size_t index;
+				KLAYGE_AUTO(iter, scope_indices_.find(event.name));
+				if (iter != scope_indices_.end())
+				{
+					index = iter->second;
+				}
+				else
+				{
+					// The same literal could live at different addresses in different modules
+					index = scope_histories_.size();
+					for (size_t j = 0; j < scope_histories_.size(); ++ j)
+					{
+						if ((scope_histories_[j].name == event.name) && (scope_histories_[j].category == event.category))
+						{
+							index = j;
+							break;
+						}
+					}
+					if (index == scope_histories_.size())
+					{
+						ScopeHistory sh;
+						sh.name = event.name;
+						sh.category = event.category;
+						sh.frame_time = 0;
+						sh.touched = false;
+						scope_histories_.push_back(sh);
+					}
+					scope_indices_.insert(std::make_pair(event.name, index));
+				}
+
+				ScopeHistory& sh = scope_histories_[index];
+				sh.frame_time += event.end_time - event.begin_time;
+				sh.touched = true;
+			}
+		}
+
+		for (size_t i = 0; i < scope_histories_.size(); ++ i)
+		{
+			ScopeHistory& sh = scope_histories_[i];
+			if (sh.touched)
+			{
+				sh.history.push_back(sh.frame_time);
+				sh.frame_time = 0;
+				sh.touched = false;
+			}
+		}
+	}
+
+	void PerfProfiler::TrimHistory()
+	{
+		typedef KLAYGE_DECLTYPE(perf_ranges_) PerfRangesType;
+		KLAYGE_FOREACH(PerfRangesType::reference range, perf_ranges_)
+		{
+			while (get<3>(range).size() > window_size_)
+			{
+				get<3>(range).pop_front();
+			}
+		}
+
+		for (size_t i = 0; i < scope_histories_.size(); ++ i)
+		{
+			while (scope_histories_[i].history.size() > window_size_)
+			{
+				scope_histories_[i].history.pop_front();
+			}
+		}
+
+		uint32_t const oldest_frame = (frame_id_ + 1 > window_size_) ? frame_id_ + 1 - window_size_ : 0;
+		while (!trace_events_.empty() && (trace_events_.front().frame_id < oldest_frame))
+		{
+			trace_events_.pop_front();
+		}
+	}
+
+	void PerfProfiler::WindowSize(uint32_t num_frames)
+	{
+		window_size_ = std::max(num_frames, 1U);
+		this->TrimHistory();
+	}
+
+	uint32_t PerfProfiler::WindowSize() const
+	{
+		return window_size_;
+	}
+
+	void PerfProfiler::Summarize(std::vector<PerfSummary>& summaries) const
+	{
+		summaries.clear();
+
+		typedef KLAYGE_DECLTYPE(perf_ranges_) PerfRangesType;
+		KLAYGE_FOREACH(PerfRangesType::const_reference range, perf_ranges_)
+		{
+			typedef KlayGE::remove_reference<KLAYGE_DECLTYPE(get<3>(range))>::type PerfDataType;
+			PerfDataType const & data = get<3>(range);
+			if (!data.empty())
+			{
+				PerfSummary summary;
+				summary.name = get<1>(range);
+				summary.category = get<0>(range);
+				summary.num_frames = static_cast<uint32_t>(data.size());
+				summary.cpu_avg = 0;
+				summary.cpu_min = std::numeric_limits<double>::max();
+				summary.cpu_max = 0;
+				summary.gpu_avg = 0;
+				summary.gpu_min = std::numeric_limits<double>::max();
+				summary.gpu_max = 0;
+				uint32_t num_gpu_frames = 0;
+				KLAYGE_FOREACH(PerfDataType::const_reference d, data)
+				{
+					summary.cpu_avg += get<1>(d);
+					summary.cpu_min = std::min(summary.cpu_min, get<1>(d));
+					summary.cpu_max = std::max(summary.cpu_max, get<1>(d));
+					if (get<2>(d) >= 0)
+					{
+						summary.gpu_avg += get<2>(d);
+						summary.gpu_min = std::min(summary.gpu_min, get<2>(d));
+						summary.gpu_max = std::max(summary.gpu_max, get<2>(d));
+						++ num_gpu_frames;
+					}
+				}
+				summary.cpu_avg /= data.size();
+				if (num_gpu_frames > 0)
+				{
+					summary.gpu_avg /= num_gpu_frames;
+				}
+				else
+				{
+					summary.gpu_avg = summary.gpu_min = summary.gpu_max = -1;
+				}
+				summaries.push_back(summary);
+			}
+		}
+
+		for (size_t i = 0; i < scope_histories_.size(); ++ i)
+		{
+			ScopeHistory const & sh = scope_histories_[i];
+			if (!sh.history.empty())
+			{
+				PerfSummary summary;
+				summary.name = sh.name;
+				summary.category = sh.category;
+				summary.num_frames = static_cast<uint32_t>(sh.history.size());
+				summary.cpu_avg = 0;
+				summary.cpu_min = std::numeric_limits<double>::max();
+				summary.cpu_max = 0;
+				for (size_t j = 0; j < sh.history.size(); ++ j)
+				{
+					summary.cpu_avg += sh.history[j];
+					summary.cpu_min = std::min(summary.cpu_min, sh.history[j]);
+					summary.cpu_max = std::max(summary.cpu_max, sh.history[j]);
+				}
+				summary.cpu_avg /= sh.history.size();
+				summary.gpu_avg = summary.gpu_min = summary.gpu_max = -1;
+				summaries.push_back(summary);
+			}
+		}
+	}
+
 	void PerfProfiler::ExportToCSV(std::string const & file_name) const
 	{
-		if (Context::Instance().Config().perf_profiler)
+		if (IsProfilerEnabled())
 		{
 			std::ofstream ofs(file_name.c_str());
 			ofs << "Frame" << ',' << "Category" << ',' << "Name" << ','
@@ -197,4 +594,43 @@ namespace KlayGE
 			ofs << std::endl;
 		}
 	}
+
+	void PerfProfiler::ExportToChromeTrace(std::string const & file_name) const
+	{
+		if (IsProfilerEnabled())
+		{
+			std::ofstream ofs(file_name.c_str());
+			ofs.setf(std::ios_base::fixed);
+			ofs.precision(3);
+			ofs << "{\"traceEvents\":[" << std::endl;
+
+			ofs << "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":0,\"tid\":" << GPU_THREAD_INDEX
+				<< ",\"args\":{\"name\":\"GPU (estimated start times)\"}}";
+			uint32_t num_threads;
+			{
+				lock_guard<mutex> lock(thread_buffers_mutex_);
+				num_threads = static_cast<uint32_t>(thread_buffers_.size());
+			}
+			for (uint32_t i = 1; i <= num_threads; ++ i)
+			{
+				ofs << ',' << std::endl << "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":0,\"tid\":" << i
+					<< ",\"args\":{\"name\":\"Thread " << i << "\"}}";
+			}
+
+			// Timestamps and durations are in microseconds
+			for (size_t i = 0; i < trace_events_.size(); ++ i)
+			{
+				PerfEvent const & event = trace_events_[i];
+				ofs << ',' << std::endl << "{\"name\":";
+				WriteJSONString(ofs, event.name);
+				ofs << ",\"cat\":\"" << ((PET_GPURange == event.type) ? "GPU" : "CPU") << event.category << '"'
+					<< ",\"ph\":\"X\",\"pid\":0,\"tid\":" << event.thread_index
+					<< ",\"ts\":" << event.begin_time * 1e6
+					<< ",\"dur\":" << (event.end_time - event.begin_time) * 1e6
+					<< ",\"args\":{\"frame\":" << event.frame_id << "}}";
+			}
+
+			ofs << std::endl << "]," << std::endl << "\"displayTimeUnit\":\"ms\"}" << std::endl;
+		}
+	}
 }
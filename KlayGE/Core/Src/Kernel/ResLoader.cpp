@@ -31,9 +31,11 @@
 #include <KlayGE/KlayGE.hpp>
 #include <KFL/Util.hpp>
 #include <KlayGE/Extract7z.hpp>
+#include <KlayGE/PerfProfiler.hpp>
 
 #include <fstream>
 #include <sstream>
+#include <algorithm>
 #if defined(KLAYGE_TR2_LIBRARY_FILESYSTEM_V2_SUPPORT) || defined(KLAYGE_TR2_LIBRARY_FILESYSTEM_V3_SUPPORT)
 	#include <filesystem>
 	namespace KlayGE
@@ -94,7 +96,7 @@ namespace KlayGE
 	shared_ptr<ResLoader> ResLoader::res_loader_instance_;
 
 	ResLoader::ResLoader()
-		: quit_(false)
+		: quit_(false), hot_reload_(false)
 	{
 #if defined KLAYGE_PLATFORM_WINDOWS
 #if defined KLAYGE_PLATFORM_WINDOWS_DESKTOP
@@ -508,6 +510,54 @@ namespace KlayGE
 #endif
 	}
 
+	uint64_t ResLoader::Timestamp(std::string const & name)
+	{
+		typedef KLAYGE_DECLTYPE(paths_) PathsType;
+		KLAYGE_FOREACH(PathsType::const_reference path, paths_)
+		{
+			std::string const res_name(path + name);
+
+			filesystem::path res_path(res_name);
+			if (!filesystem::exists(res_path))
+			{
+				std::string::size_type const pkt_offset(res_name.find("//"));
+				if (pkt_offset == std::string::npos)
+				{
+					continue;
+				}
+
+				// Same as Open, which doesn't extract anything to get it
+				res_path = filesystem::path(res_name.substr(0, pkt_offset));
+				if (!filesystem::exists(res_path)
+					|| !(filesystem::is_regular_file(res_path) || filesystem::is_symlink(res_path)))
+				{
+					continue;
+				}
+			}
+
+#ifdef KLAYGE_TR2_LIBRARY_FILESYSTEM_V3_SUPPORT
+			return filesystem::last_write_time(res_path).time_since_epoch().count();
+#else
+			return filesystem::last_write_time(res_path);
+#endif
+		}
+
+#if defined(KLAYGE_PLATFORM_WINDOWS_RUNTIME)
+		std::string::size_type pos = name.rfind('/');
+		if (std::string::npos == pos)
+		{
+			pos = name.rfind('\\');
+		}
+		if (pos != std::string::npos)
+		{
+			return this->Timestamp(name.substr(pos + 1));
+		}
+#endif
+
+		// Assets in the app bundles can't change while running
+		return 0;
+	}
+
 	shared_ptr<void> ResLoader::SyncQuery(ResLoadingDescPtr const & res_desc)
 	{
 		this->RemoveUnrefResources();
@@ -533,10 +583,14 @@ namespace KlayGE
 		{
 			if (res_desc->HasSubThreadStage())
 			{
+				KLAYGE_PERF_SCOPE("ResLoader::SubThreadStage");
 				res_desc->SubThreadStage();
 			}
 
-			res = res_desc->MainThreadStage();
+			{
+				KLAYGE_PERF_SCOPE("ResLoader::MainThreadStage");
+				res = res_desc->MainThreadStage();
+			}
 			this->AddLoadedResource(res_desc, res);
 		}
 
@@ -683,19 +737,138 @@ namespace KlayGE
 
 	void ResLoader::Update()
 	{
-		lock_guard<mutex> lock(loading_mutex_);
+		{
+			lock_guard<mutex> lock(loading_mutex_);
+
+			for (KLAYGE_AUTO(iter, loading_res_.begin()); iter != loading_res_.end();)
+			{
+				if (*(iter->second))
+				{
+					iter = loading_res_.erase(iter);
+				}
+				else
+				{
+					++ iter;
+				}
+			}
+		}
+
+		if (hot_reload_)
+		{
+			this->UpdateHotReload();
+		}
+	}
+
+	void ResLoader::HotReload(bool hot_reload)
+	{
+		hot_reload_ = hot_reload;
+		watched_files_.clear();
+		reloading_res_.clear();
+		hot_reload_timer_.restart();
+	}
 
-		for (KLAYGE_AUTO(iter, loading_res_.begin()); iter != loading_res_.end();)
+	// The timestamps of the files of the loaded resources are checked once a second, without opening them. Resources
+	//  depending on the changed ones are reloaded by their descs, which can take several frames, so they are called
+	//  on each update until done.
+	void ResLoader::UpdateHotReload()
+	{
+		for (KLAYGE_AUTO(iter, reloading_res_.begin()); iter != reloading_res_.end();)
 		{
-			if (*(iter->second))
+			shared_ptr<void> res = iter->second.lock();
+			if (!res || iter->first->Reload(res))
 			{
-				iter = loading_res_.erase(iter);
+				iter = reloading_res_.erase(iter);
 			}
 			else
 			{
 				++ iter;
 			}
 		}
+
+		if (hot_reload_timer_.elapsed() < 1)
+		{
+			return;
+		}
+		hot_reload_timer_.restart();
+
+		std::vector<std::pair<ResLoadingDescPtr, weak_ptr<void> > > loaded_res;
+		{
+			lock_guard<mutex> lock(loading_mutex_);
+			loaded_res = loaded_res_;
+		}
+
+		std::vector<std::vector<std::string> > dependent_files(loaded_res.size());
+		std::vector<std::string> changed_files;
+		std::vector<std::string> checked_files;
+		for (size_t i = 0; i < loaded_res.size(); ++ i)
+		{
+			if (!loaded_res[i].second.lock())
+			{
+				continue;
+			}
+
+			loaded_res[i].first->DependentFiles(dependent_files[i]);
+			for (size_t j = 0; j < dependent_files[i].size(); ++ j)
+			{
+				std::string const & file = dependent_files[i][j];
+				if (std::find(checked_files.begin(), checked_files.end(), file) != checked_files.end())
+				{
+					continue;
+				}
+				checked_files.push_back(file);
+
+				uint64_t const timestamp = this->Timestamp(file);
+
+				bool found = false;
+				for (size_t k = 0; k < watched_files_.size(); ++ k)
+				{
+					if (watched_files_[k].first == file)
+					{
+						if (watched_files_[k].second != timestamp)
+						{
+							watched_files_[k].second = timestamp;
+							changed_files.push_back(file);
+						}
+						found = true;
+						break;
+					}
+				}
+				if (!found)
+				{
+					watched_files_.push_back(std::make_pair(file, timestamp));
+				}
+			}
+		}
+
+		if (!changed_files.empty())
+		{
+			for (size_t i = 0; i < loaded_res.size(); ++ i)
+			{
+				bool depends = false;
+				for (size_t j = 0; (j < dependent_files[i].size()) && !depends; ++ j)
+				{
+					depends = std::find(changed_files.begin(), changed_files.end(), dependent_files[i][j])
+						!= changed_files.end();
+				}
+
+				if (depends)
+				{
+					bool reloading = false;
+					for (size_t j = 0; j < reloading_res_.size(); ++ j)
+					{
+						if (reloading_res_[j].first == loaded_res[i].first)
+						{
+							reloading = true;
+							break;
+						}
+					}
+					if (!reloading)
+					{
+						reloading_res_.push_back(loaded_res[i]);
+					}
+				}
+			}
+		}
 	}
 
 	void ResLoader::LoadingThreadFunc()
@@ -705,6 +878,7 @@ namespace KlayGE
 			std::pair<ResLoadingDescPtr, shared_ptr<volatile bool> > res_pair;
 			while (loading_res_queue_.pop(res_pair))
 			{
+				KLAYGE_PERF_SCOPE("ResLoader::SubThreadStage");
 				res_pair.first->SubThreadStage();
 				*res_pair.second = true;
 			}
@@ -745,6 +919,7 @@ namespace KlayGE
 				}
 				else
 				{
+					KLAYGE_PERF_SCOPE("ResLoader::MainThreadStage");
 					res_ = res_desc_->MainThreadStage();
 					rl.AddLoadedResource(res_desc_, res_);
 				}
@@ -1271,6 +1271,8 @@ namespace KlayGE
 
 	uint32_t DeferredRenderingLayer::Update(uint32_t pass)
 	{
+		KLAYGE_PERF_SCOPE("DeferredRenderingLayer::Update");
+
 		RenderFactory& rf = Context::Instance().RenderFactoryInstance();
 		RenderEngine& re = rf.RenderEngineInstance();
 		SceneManager& scene_mgr = Context::Instance().SceneManagerInstance();
@@ -1755,6 +1757,8 @@ namespace KlayGE
 
 	void DeferredRenderingLayer::BuildLightList()
 	{
+		KLAYGE_PERF_SCOPE("DeferredRenderingLayer::BuildLightList");
+
 		SceneManager& scene_mgr = Context::Instance().SceneManagerInstance();
 
 		lights_.clear();
@@ -1884,6 +1888,8 @@ namespace KlayGE
 
 	void DeferredRenderingLayer::BuildVisibleSceneObjList(bool& has_opaque_objs, bool& has_transparency_back_objs, bool& has_transparency_front_objs)
 	{
+		KLAYGE_PERF_SCOPE("DeferredRenderingLayer::BuildVisibleSceneObjList");
+
 		SceneManager& scene_mgr = Context::Instance().SceneManagerInstance();
 
 		has_opaque_objs = false;
@@ -1922,6 +1928,8 @@ namespace KlayGE
 
 	void DeferredRenderingLayer::BuildPassScanList(bool has_opaque_objs, bool has_transparency_back_objs, bool has_transparency_front_objs)
 	{
+		KLAYGE_PERF_SCOPE("DeferredRenderingLayer::BuildPassScanList");
+
 		pass_scaned_.clear();
 
 #ifndef KLAYGE_SHIP
@@ -37,6 +37,335 @@
 #include <KFL/Math.hpp>
 #include <KFL/Half.hpp>
 
+#include <cstring>
+
+#if defined(KLAYGE_SSE2_SUPPORT)
+#include <emmintrin.h>
+#elif defined(KLAYGE_NEON_SUPPORT)
+#include <arm_neon.h>
+#endif
+
+namespace
+{
+	using namespace KlayGE;
+
+	// Lookup tables for the sRGB conversions. Filled with the same expressions as the float path, so the results are identical.
+	class SRGBTables
+	{
+	public:
+		SRGBTables()
+		{
+			for (int i = 0; i < 256; ++ i)
+			{
+				float const f = i / 255.0f;
+				float const linear = MathLib::srgb_to_linear(f);
+				srgb_to_linear_32f[i] = linear;
+				srgb_to_linear_8[i] = static_cast<uint8_t>(MathLib::clamp(static_cast<int>(linear * 255.0f + 0.5f), 0, 255));
+				linear_to_srgb_8[i] = static_cast<uint8_t>(MathLib::clamp(static_cast<int>(MathLib::linear_to_srgb(f) * 255.0f + 0.5f), 0, 255));
+			}
+		}
+
+		float srgb_to_linear_32f[256];
+		uint8_t srgb_to_linear_8[256];
+		uint8_t linear_to_srgb_8[256];
+	};
+
+	SRGBTables const srgb_tables;
+
+	enum SRGBLUT
+	{
+		SL_SRGBToLinear,
+		SL_LinearToSRGB
+	};
+
+	typedef void (*ConvertFormatFunc)(void* output, void const * input, uint32_t num_elems);
+
+	// The integer expressions below give the same results as the float path,
+	// e.g. (x * 255 + 15) / 31 == int(x / 31.0f * 255.0f + 0.5f) for every 5-bit x.
+
+	// ARGB8 <-> ABGR8
+	void SwapRB8(void* output, void const * input, uint32_t num_elems)
+	{
+		uint8_t const * src = static_cast<uint8_t const *>(input);
+		uint8_t* dst = static_cast<uint8_t*>(output);
+		uint32_t i = 0;
+#if defined(KLAYGE_SSE2_SUPPORT)
+		__m128i const ag_mask = _mm_set1_epi32(0xFF00FF00);
+		__m128i const rb_mask = _mm_set1_epi32(0x00FF00FF);
+		for (; i + 4 <= num_elems; i += 4)
+		{
+			__m128i const v = _mm_loadu_si128(reinterpret_cast<__m128i const *>(src + i * 4));
+			__m128i rb = _mm_and_si128(v, rb_mask);
+			rb = _mm_shufflelo_epi16(rb, _MM_SHUFFLE(2, 3, 0, 1));
+			rb = _mm_shufflehi_epi16(rb, _MM_SHUFFLE(2, 3, 0, 1));
+			_mm_storeu_si128(reinterpret_cast<__m128i*>(dst + i * 4), _mm_or_si128(_mm_and_si128(v, ag_mask), rb));
+		}
+#elif defined(KLAYGE_NEON_SUPPORT)
+		for (; i + 16 <= num_elems; i += 16)
+		{
+			uint8x16x4_t v = vld4q_u8(src + i * 4);
+			uint8x16_t const t = v.val[0];
+			v.val[0] = v.val[2];
+			v.val[2] = t;
+			vst4q_u8(dst + i * 4, v);
+		}
+#endif
+		for (; i < num_elems; ++ i)
+		{
+			uint8_t const t = src[i * 4 + 0];
+			dst[i * 4 + 0] = src[i * 4 + 2];
+			dst[i * 4 + 1] = src[i * 4 + 1];
+			dst[i * 4 + 2] = t;
+			dst[i * 4 + 3] = src[i * 4 + 3];
+		}
+	}
+
+	// sRGB <-> linear on 8-bit channels, with an optional R/B swap. Alpha goes through the table as well, like the float path.
+	template <SRGBLUT lut_type, bool swap_rb>
+	void SRGBConvert8(void* output, void const * input, uint32_t num_elems)
+	{
+		uint8_t const * lut = (SL_SRGBToLinear == lut_type) ? srgb_tables.srgb_to_linear_8 : srgb_tables.linear_to_srgb_8;
+		uint8_t const * src = static_cast<uint8_t const *>(input);
+		uint8_t* dst = static_cast<uint8_t*>(output);
+		for (uint32_t i = 0; i < num_elems; ++ i, src += 4, dst += 4)
+		{
+			uint8_t const c0 = lut[src[0]];
+			uint8_t const c1 = lut[src[1]];
+			uint8_t const c2 = lut[src[2]];
+			uint8_t const c3 = lut[src[3]];
+			dst[0] = swap_rb ? c2 : c0;
+			dst[1] = c1;
+			dst[2] = swap_rb ? c0 : c2;
+			dst[3] = c3;
+		}
+	}
+
+	// R5G6B5 -> ARGB8 (bgr_first = true) or ABGR8
+	template <bool bgr_first>
+	void R5G6B5ToRGBA8(void* output, void const * input, uint32_t num_elems)
+	{
+		uint16_t const * src = static_cast<uint16_t const *>(input);
+		uint8_t* dst = static_cast<uint8_t*>(output);
+		uint32_t i = 0;
+#if defined(KLAYGE_SSE2_SUPPORT)
+		__m128i const mask5 = _mm_set1_epi16(0x1F);
+		__m128i const mask6 = _mm_set1_epi16(0x3F);
+		__m128i const alpha = _mm_set1_epi16(static_cast<short>(0xFF00));
+		for (; i + 8 <= num_elems; i += 8)
+		{
+			__m128i const v = _mm_loadu_si128(reinterpret_cast<__m128i const *>(src + i));
+			__m128i const r = _mm_srli_epi16(v, 11);
+			__m128i const g = _mm_and_si128(_mm_srli_epi16(v, 5), mask6);
+			__m128i const b = _mm_and_si128(v, mask5);
+
+			// x / 31 == (x * 8457) >> 18 for x <= 7920, x / 63 == (x * 16645) >> 20 for x <= 16096
+			__m128i const r8 = _mm_srli_epi16(_mm_mulhi_epu16(_mm_add_epi16(_mm_mullo_epi16(r, _mm_set1_epi16(255)), _mm_set1_epi16(15)),
+				_mm_set1_epi16(8457)), 2);
+			__m128i const g8 = _mm_srli_epi16(_mm_mulhi_epu16(_mm_add_epi16(_mm_mullo_epi16(g, _mm_set1_epi16(255)), _mm_set1_epi16(31)),
+				_mm_set1_epi16(16645)), 4);
+			__m128i const b8 = _mm_srli_epi16(_mm_mulhi_epu16(_mm_add_epi16(_mm_mullo_epi16(b, _mm_set1_epi16(255)), _mm_set1_epi16(15)),
+				_mm_set1_epi16(8457)), 2);
+
+			__m128i const first = _mm_or_si128(bgr_first ? b8 : r8, _mm_slli_epi16(g8, 8));
+			__m128i const second = _mm_or_si128(bgr_first ? r8 : b8, alpha);
+			_mm_storeu_si128(reinterpret_cast<__m128i*>(dst + i * 4), _mm_unpacklo_epi16(first, second));
+			_mm_storeu_si128(reinterpret_cast<__m128i*>(dst + i * 4 + 16), _mm_unpackhi_epi16(first, second));
+		}
+#endif
+		for (; i < num_elems; ++ i)
+		{
+			uint32_t const v = src[i];
+			uint8_t const r = static_cast<uint8_t>((((v >> 11) & 0x1F) * 255 + 15) / 31);
+			uint8_t const g = static_cast<uint8_t>((((v >> 5) & 0x3F) * 255 + 31) / 63);
+			uint8_t const b = static_cast<uint8_t>(((v & 0x1F) * 255 + 15) / 31);
+			dst[i * 4 + 0] = bgr_first ? b : r;
+			dst[i * 4 + 1] = g;
+			dst[i * 4 + 2] = bgr_first ? r : b;
+			dst[i * 4 + 3] = 0xFF;
+		}
+	}
+
+	// ARGB8 (bgr_first = true) or ABGR8 -> R5G6B5
+	template <bool bgr_first>
+	void RGBA8ToR5G6B5(void* output, void const * input, uint32_t num_elems)
+	{
+		uint8_t const * src = static_cast<uint8_t const *>(input);
+		uint16_t* dst = static_cast<uint16_t*>(output);
+		uint32_t i = 0;
+#if defined(KLAYGE_SSE2_SUPPORT)
+		__m128i const mask8 = _mm_set1_epi32(0xFF);
+		for (; i + 8 <= num_elems; i += 8)
+		{
+			__m128i const v0 = _mm_loadu_si128(reinterpret_cast<__m128i const *>(src + i * 4));
+			__m128i const v1 = _mm_loadu_si128(reinterpret_cast<__m128i const *>(src + i * 4 + 16));
+			__m128i const c0 = _mm_packs_epi32(_mm_and_si128(v0, mask8), _mm_and_si128(v1, mask8));
+			__m128i const g = _mm_packs_epi32(_mm_and_si128(_mm_srli_epi32(v0, 8), mask8), _mm_and_si128(_mm_srli_epi32(v1, 8), mask8));
+			__m128i const c2 = _mm_packs_epi32(_mm_and_si128(_mm_srli_epi32(v0, 16), mask8), _mm_and_si128(_mm_srli_epi32(v1, 16), mask8));
+			__m128i const r = bgr_first ? c2 : c0;
+			__m128i const b = bgr_first ? c0 : c2;
+
+			// x / 255 == (x * 8225) >> 21 for x <= 8032, x / 255 == (x * 16449) >> 22 for x <= 16192
+			__m128i const r5 = _mm_srli_epi16(_mm_mulhi_epu16(_mm_add_epi16(_mm_mullo_epi16(r, _mm_set1_epi16(31)), _mm_set1_epi16(127)),
+				_mm_set1_epi16(8225)), 5);
+			__m128i const g6 = _mm_srli_epi16(_mm_mulhi_epu16(_mm_add_epi16(_mm_mullo_epi16(g, _mm_set1_epi16(63)), _mm_set1_epi16(127)),
+				_mm_set1_epi16(16449)), 6);
+			__m128i const b5 = _mm_srli_epi16(_mm_mulhi_epu16(_mm_add_epi16(_mm_mullo_epi16(b, _mm_set1_epi16(31)), _mm_set1_epi16(127)),
+				_mm_set1_epi16(8225)), 5);
+
+			_mm_storeu_si128(reinterpret_cast<__m128i*>(dst + i),
+				_mm_or_si128(_mm_or_si128(_mm_slli_epi16(r5, 11), _mm_slli_epi16(g6, 5)), b5));
+		}
+#endif
+		for (; i < num_elems; ++ i)
+		{
+			uint32_t const r = src[i * 4 + (bgr_first ? 2 : 0)];
+			uint32_t const g = src[i * 4 + 1];
+			uint32_t const b = src[i * 4 + (bgr_first ? 0 : 2)];
+			dst[i] = static_cast<uint16_t>((((r * 31 + 127) / 255) << 11) | (((g * 63 + 127) / 255) << 5) | ((b * 31 + 127) / 255));
+		}
+	}
+
+	// A2BGR10 -> ARGB8 (bgr_first = true) or ABGR8
+	template <bool bgr_first>
+	void A2BGR10ToRGBA8(void* output, void const * input, uint32_t num_elems)
+	{
+		uint32_t const * src = static_cast<uint32_t const *>(input);
+		uint8_t* dst = static_cast<uint8_t*>(output);
+		for (uint32_t i = 0; i < num_elems; ++ i, dst += 4)
+		{
+			uint32_t const s = src[i];
+			uint8_t const r = static_cast<uint8_t>(((s & 0x03FF) * 255 + 511) / 1023);
+			uint8_t const g = static_cast<uint8_t>((((s >> 10) & 0x03FF) * 255 + 511) / 1023);
+			uint8_t const b = static_cast<uint8_t>((((s >> 20) & 0x03FF) * 255 + 511) / 1023);
+			dst[0] = bgr_first ? b : r;
+			dst[1] = g;
+			dst[2] = bgr_first ? r : b;
+			dst[3] = static_cast<uint8_t>((s >> 30) * 85);
+		}
+	}
+
+	// ARGB8 (bgr_first = true) or ABGR8 -> A2BGR10
+	template <bool bgr_first>
+	void RGBA8ToA2BGR10(void* output, void const * input, uint32_t num_elems)
+	{
+		uint8_t const * src = static_cast<uint8_t const *>(input);
+		uint32_t* dst = static_cast<uint32_t*>(output);
+		for (uint32_t i = 0; i < num_elems; ++ i, src += 4)
+		{
+			uint32_t const r = src[bgr_first ? 2 : 0];
+			uint32_t const g = src[1];
+			uint32_t const b = src[bgr_first ? 0 : 2];
+			uint32_t const a = src[3];
+			dst[i] = ((r * 1023 + 127) / 255) | (((g * 1023 + 127) / 255) << 10)
+				| (((b * 1023 + 127) / 255) << 20) | (((a * 3 + 127) / 255) << 30);
+		}
+	}
+
+	template <uint32_t num_channels>
+	void HalfToFloat(void* output, void const * input, uint32_t num_elems)
+	{
+		half_to_float_n(static_cast<float*>(output), static_cast<half const *>(input), num_elems * num_channels);
+	}
+
+	template <uint32_t num_channels>
+	void FloatToHalf(void* output, void const * input, uint32_t num_elems)
+	{
+		float_to_half_n(static_cast<half*>(output), static_cast<float const *>(input), num_elems * num_channels);
+	}
+
+	struct FormatConverter
+	{
+		ElementFormat src_fmt;
+		ElementFormat dst_fmt;
+		ConvertFormatFunc func;
+	};
+
+	FormatConverter const format_converters[] =
+	{
+		{ EF_ARGB8, EF_ABGR8, SwapRB8 },
+		{ EF_ABGR8, EF_ARGB8, SwapRB8 },
+		{ EF_ARGB8_SRGB, EF_ABGR8_SRGB, SwapRB8 },
+		{ EF_ABGR8_SRGB, EF_ARGB8_SRGB, SwapRB8 },
+
+		{ EF_ARGB8_SRGB, EF_ARGB8, SRGBConvert8<SL_SRGBToLinear, false> },
+		{ EF_ABGR8_SRGB, EF_ABGR8, SRGBConvert8<SL_SRGBToLinear, false> },
+		{ EF_ARGB8_SRGB, EF_ABGR8, SRGBConvert8<SL_SRGBToLinear, true> },
+		{ EF_ABGR8_SRGB, EF_ARGB8, SRGBConvert8<SL_SRGBToLinear, true> },
+		{ EF_ARGB8, EF_ARGB8_SRGB, SRGBConvert8<SL_LinearToSRGB, false> },
+		{ EF_ABGR8, EF_ABGR8_SRGB, SRGBConvert8<SL_LinearToSRGB, false> },
+		{ EF_ARGB8, EF_ABGR8_SRGB, SRGBConvert8<SL_LinearToSRGB, true> },
+		{ EF_ABGR8, EF_ARGB8_SRGB, SRGBConvert8<SL_LinearToSRGB, true> },
+
+		{ EF_R5G6B5, EF_ARGB8, R5G6B5ToRGBA8<true> },
+		{ EF_R5G6B5, EF_ABGR8, R5G6B5ToRGBA8<false> },
+		{ EF_ARGB8, EF_R5G6B5, RGBA8ToR5G6B5<true> },
+		{ EF_ABGR8, EF_R5G6B5, RGBA8ToR5G6B5<false> },
+
+		{ EF_A2BGR10, EF_ARGB8, A2BGR10ToRGBA8<true> },
+		{ EF_A2BGR10, EF_ABGR8, A2BGR10ToRGBA8<false> },
+		{ EF_ARGB8, EF_A2BGR10, RGBA8ToA2BGR10<true> },
+		{ EF_ABGR8, EF_A2BGR10, RGBA8ToA2BGR10<false> },
+
+		{ EF_R16F, EF_R32F, HalfToFloat<1> },
+		{ EF_GR16F, EF_GR32F, HalfToFloat<2> },
+		{ EF_BGR16F, EF_BGR32F, HalfToFloat<3> },
+		{ EF_ABGR16F, EF_ABGR32F, HalfToFloat<4> },
+		{ EF_R32F, EF_R16F, FloatToHalf<1> },
+		{ EF_GR32F, EF_GR16F, FloatToHalf<2> },
+		{ EF_BGR32F, EF_BGR16F, FloatToHalf<3> },
+		{ EF_ABGR32F, EF_ABGR16F, FloatToHalf<4> }
+	};
+
+	uint32_t const HALF_BATCH_ELEMS = 256;
+
+	// Missing color channels are 0, missing alpha is 1
+	void ConvertHalfToABGR32F(uint32_t num_channels, half const * input, uint32_t num_elems, Color* output)
+	{
+		if (4 == num_channels)
+		{
+			half_to_float_n(&output[0][0], input, num_elems * 4);
+		}
+		else
+		{
+			float tmp[HALF_BATCH_ELEMS * 3];
+			for (uint32_t base = 0; base < num_elems; base += HALF_BATCH_ELEMS)
+			{
+				uint32_t const n = std::min(HALF_BATCH_ELEMS, num_elems - base);
+				half_to_float_n(tmp, input + base * num_channels, n * num_channels);
+				for (uint32_t i = 0; i < n; ++ i)
+				{
+					float const * s = &tmp[i * num_channels];
+					output[base + i] = Color(s[0], (num_channels > 1) ? s[1] : 0, (num_channels > 2) ? s[2] : 0, 1);
+				}
+			}
+		}
+	}
+
+	void ConvertHalfFromABGR32F(uint32_t num_channels, Color const * input, uint32_t num_elems, half* output)
+	{
+		if (4 == num_channels)
+		{
+			float_to_half_n(output, &input[0][0], num_elems * 4);
+		}
+		else
+		{
+			float tmp[HALF_BATCH_ELEMS * 3];
+			for (uint32_t base = 0; base < num_elems; base += HALF_BATCH_ELEMS)
+			{
+				uint32_t const n = std::min(HALF_BATCH_ELEMS, num_elems - base);
+				for (uint32_t i = 0; i < n; ++ i)
+				{
+					for (uint32_t c = 0; c < num_channels; ++ c)
+					{
+						tmp[i * num_channels + c] = input[base + i][c];
+					}
+				}
+				float_to_half_n(output + base * num_channels, tmp, n * num_channels);
+			}
+		}
+	}
+}
+
 namespace KlayGE
 {
 	void ConvertToABGR32F(ElementFormat fmt, void const * input, uint32_t num_elems, Color* output)
@@ -538,19 +867,11 @@ namespace KlayGE
 
 
 		case EF_R16F:
-			for (uint32_t i = 0; i < num_elems; ++ i, p += elem_size, ++ output)
-			{
-				half const s = *reinterpret_cast<half const *>(p);
-				*output = Color(s, 0, 0, 1);
-			}
+			ConvertHalfToABGR32F(1, reinterpret_cast<half const *>(p), num_elems, output);
 			break;
 
 		case EF_GR16F:
-			for (uint32_t i = 0; i < num_elems; ++ i, p += elem_size, ++ output)
-			{
-				half const * s = reinterpret_cast<half const *>(p);
-				*output = Color(s[0], s[1], 0, 1);
-			}
+			ConvertHalfToABGR32F(2, reinterpret_cast<half const *>(p), num_elems, output);
 			break;
 
 		case EF_B10G11R11F:
@@ -646,19 +967,11 @@ namespace KlayGE
 			break;
 
 		case EF_BGR16F:
-			for (uint32_t i = 0; i < num_elems; ++ i, p += elem_size, ++ output)
-			{
-				half const * s = reinterpret_cast<half const *>(p);
-				*output = Color(s[0], s[1], s[2], 1);
-			}
+			ConvertHalfToABGR32F(3, reinterpret_cast<half const *>(p), num_elems, output);
 			break;
 
 		case EF_ABGR16F:
-			for (uint32_t i = 0; i < num_elems; ++ i, p += elem_size, ++ output)
-			{
-				half const * s = reinterpret_cast<half const *>(p);
-				*output = Color(s[0], s[1], s[2], s[3]);
-			}
+			ConvertHalfToABGR32F(4, reinterpret_cast<half const *>(p), num_elems, output);
 			break;
 
 		case EF_R32F:
@@ -722,20 +1035,16 @@ namespace KlayGE
 		case EF_ARGB8_SRGB:
 			for (uint32_t i = 0; i < num_elems; ++ i, p += elem_size, ++ output)
 			{
-				*output = Color(MathLib::srgb_to_linear(p[2] / 255.0f),
-					MathLib::srgb_to_linear(p[1] / 255.0f),
-					MathLib::srgb_to_linear(p[0] / 255.0f),
-					MathLib::srgb_to_linear(p[3] / 255.0f));
+				*output = Color(srgb_tables.srgb_to_linear_32f[p[2]], srgb_tables.srgb_to_linear_32f[p[1]],
+					srgb_tables.srgb_to_linear_32f[p[0]], srgb_tables.srgb_to_linear_32f[p[3]]);
 			}
 			break;
 
 		case EF_ABGR8_SRGB:
 			for (uint32_t i = 0; i < num_elems; ++ i, p += elem_size, ++ output)
 			{
-				*output = Color(MathLib::srgb_to_linear(p[0] / 255.0f),
-					MathLib::srgb_to_linear(p[1] / 255.0f),
-					MathLib::srgb_to_linear(p[2] / 255.0f),
-					MathLib::srgb_to_linear(p[3] / 255.0f));
+				*output = Color(srgb_tables.srgb_to_linear_32f[p[0]], srgb_tables.srgb_to_linear_32f[p[1]],
+					srgb_tables.srgb_to_linear_32f[p[2]], srgb_tables.srgb_to_linear_32f[p[3]]);
 			}
 			break;
 
@@ -1293,20 +1602,11 @@ namespace KlayGE
 
 
 		case EF_R16F:
-			for (uint32_t i = 0; i < num_elems; ++ i, ++ input, p += elem_size)
-			{
-				half* s = reinterpret_cast<half*>(p);
-				*s = half(input->r());
-			}
+			ConvertHalfFromABGR32F(1, input, num_elems, reinterpret_cast<half*>(p));
 			break;
 
 		case EF_GR16F:
-			for (uint32_t i = 0; i < num_elems; ++ i, ++ input, p += elem_size)
-			{
-				half* s = reinterpret_cast<half*>(p);
-				s[0] = half(input->r());
-				s[1] = half(input->g());
-			}
+			ConvertHalfFromABGR32F(2, input, num_elems, reinterpret_cast<half*>(p));
 			break;
 
 		case EF_B10G11R11F:
@@ -1427,24 +1727,11 @@ namespace KlayGE
 			break;
 
 		case EF_BGR16F:
-			for (uint32_t i = 0; i < num_elems; ++ i, ++ input, p += elem_size)
-			{
-				half* s = reinterpret_cast<half*>(p);
-				s[0] = half(input->r());
-				s[1] = half(input->g());
-				s[2] = half(input->b());
-			}
+			ConvertHalfFromABGR32F(3, input, num_elems, reinterpret_cast<half*>(p));
 			break;
 
 		case EF_ABGR16F:
-			for (uint32_t i = 0; i < num_elems; ++ i, ++ input, p += elem_size)
-			{
-				half* s = reinterpret_cast<half*>(p);
-				s[0] = half(input->r());
-				s[1] = half(input->g());
-				s[2] = half(input->b());
-				s[3] = half(input->a());
-			}
+			ConvertHalfFromABGR32F(4, input, num_elems, reinterpret_cast<half*>(p));
 			break;
 
 		case EF_R32F:
@@ -1536,4 +1823,36 @@ namespace KlayGE
 			break;
 		}
 	}
+
+
+	void ConvertFormat(ElementFormat dst_fmt, void* output, ElementFormat src_fmt, void const * input, uint32_t num_elems)
+	{
+		if (src_fmt == dst_fmt)
+		{
+			std::memmove(output, input, num_elems * NumFormatBytes(src_fmt));
+			return;
+		}
+
+		for (size_t i = 0; i < sizeof(format_converters) / sizeof(format_converters[0]); ++ i)
+		{
+			if ((format_converters[i].src_fmt == src_fmt) && (format_converters[i].dst_fmt == dst_fmt))
+			{
+				format_converters[i].func(output, input, num_elems);
+				return;
+			}
+		}
+
+		uint32_t const BATCH_ELEMS = 256;
+		uint32_t const src_elem_size = NumFormatBytes(src_fmt);
+		uint32_t const dst_elem_size = NumFormatBytes(dst_fmt);
+		uint8_t const * src = static_cast<uint8_t const *>(input);
+		uint8_t* dst = static_cast<uint8_t*>(output);
+		Color tmp[BATCH_ELEMS];
+		for (uint32_t base = 0; base < num_elems; base += BATCH_ELEMS)
+		{
+			uint32_t const n = std::min(BATCH_ELEMS, num_elems - base);
+			ConvertToABGR32F(src_fmt, src + base * src_elem_size, n, tmp);
+			ConvertFromABGR32F(dst_fmt, tmp, n, dst + base * dst_elem_size);
+		}
+	}
 }
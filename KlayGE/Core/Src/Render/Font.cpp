@@ -64,6 +64,7 @@
 #include <KlayGE/ResLoader.hpp>
 #include <KlayGE/SceneObjectHelper.hpp>
 #include <KlayGE/LZMACodec.hpp>
+#include <KFL/Thread.hpp>
 
 #include <algorithm>
 #include <vector>
@@ -79,6 +80,47 @@
 
 namespace KlayGE
 {
+#ifdef KLAYGE_HAS_STRUCT_PACK
+	#pragma pack(push, 1)
+#endif
+	struct FontVert
+	{
+		float3 pos;
+		uint32_t clr;
+		float2 tex;
+
+		FontVert()
+		{
+		}
+		FontVert(float3 const & pos, uint32_t clr, float2 const & tex)
+			: pos(pos), clr(clr), tex(tex)
+		{
+		}
+	};
+#ifdef KLAYGE_HAS_STRUCT_PACK
+	#pragma pack(pop)
+#endif
+
+	struct RetainedText::Layout
+	{
+		// Not owning, an expired or different font means the layout has to be rebuilt
+		weak_ptr<Renderable> font;
+
+		std::vector<FontVert> vertices;
+		std::vector<uint32_t> indices;
+		AABBox pos_aabb;
+
+		// Glyphs used by the text, touched on every draw to keep them in the font texture
+		std::vector<std::list<wchar_t>::iterator> lru_iters;
+		// Texture slots of the glyphs, and the slot versions when the layout was built
+		std::vector<std::pair<uint32_t, uint32_t> > slots;
+
+		Layout()
+			: pos_aabb(float3(0, 0, 0), float3(0, 0, 0))
+		{
+		}
+	};
+
 	class FontRenderable : public RenderableHelper
 	{
 	public:
@@ -87,7 +129,7 @@ namespace KlayGE
 					dirty_(false),
 					three_dim_(false),
 					kfont_loader_(kfl),
-					tick_(0)
+					prefetching_(false)
 		{
 			RenderFactory& rf = Context::Instance().RenderFactoryInstance();
 
@@ -109,9 +151,14 @@ namespace KlayGE
 			RenderDeviceCaps const & caps = renderEngine.DeviceCaps();
 			uint32_t size = std::min<uint32_t>(2048U, std::min<uint32_t>(caps.max_texture_width, caps.max_texture_height)) / kfont_char_size * kfont_char_size;
 			dist_texture_ = rf.MakeTexture2D(size, size, 1, 1, EF_R8, 1, 0, EAH_GPU_Read, nullptr);
-			a_char_texture_ = rf.MakeTexture2D(kfont_char_size, kfont_char_size, 1, 1, EF_R8, 1, 0, EAH_CPU_Write, nullptr);
+			uint32_t const upload_batch = std::max(1U, std::min(static_cast<uint32_t>(MAX_CHAR_UPLOAD_BATCH), size / kfont_char_size));
+			a_char_texture_ = rf.MakeTexture2D(kfont_char_size * upload_batch, kfont_char_size, 1, 1, EF_R8, 1, 0, EAH_CPU_Write, nullptr);
+			dist_texture_->TrackingTag(MT_Font);
+			a_char_texture_->TrackingTag(MT_Font);
 
-			char_free_list_.push_back(std::make_pair(0, size * size / kfont_char_size / kfont_char_size));
+			uint32_t const num_total_chars = size * size / kfont_char_size / kfont_char_size;
+			char_free_list_.push_back(std::make_pair(0, num_total_chars));
+			slot_versions_.assign(num_total_chars, 0);
 
 			effect_ = SyncLoadRenderEffect("Font.fxml");
 			*(effect_->ParameterByName("distance_tex")) = dist_texture_;
@@ -126,12 +173,25 @@ namespace KlayGE
 											vertex_element(VEU_TextureCoord, 0, EF_GR32F)));
 
 			ib_ = rf.MakeIndexBuffer(BU_Dynamic, EAH_CPU_Write | EAH_GPU_Read, nullptr);
-			rl_->BindIndexStream(ib_, EF_R16UI);
+			ib_format_ = EF_R16UI;
+			rl_->BindIndexStream(ib_, ib_format_);
 
 			pos_aabb_ = AABBox(float3(0, 0, 0), float3(0, 0, 0));
 			tc_aabb_ = AABBox(float3(0, 0, 0), float3(0, 0, 0));
 		}
 
+		~FontRenderable()
+		{
+			{
+				lock_guard<mutex> lock(prefetch_mutex_);
+				prefetch_indices_.clear();
+			}
+			if (prefetch_thread_)
+			{
+				(*prefetch_thread_)();
+			}
+		}
+
 		RenderTechniquePtr const & GetRenderTechnique() const
 		{
 			if (three_dim_)
@@ -146,6 +206,9 @@ namespace KlayGE
 
 		void UpdateBuffers()
 		{
+			// All the chars new in this frame go to the texture together
+			this->UploadChars();
+
 			if (dirty_)
 			{
 				if (!vertices_.empty() && !indices_.empty())
@@ -156,10 +219,29 @@ namespace KlayGE
 						std::copy(vertices_.begin(), vertices_.end(), mapper.Pointer<FontVert>());
 					}
 
-					ib_->Resize(static_cast<uint32_t>(indices_.size() * sizeof(indices_[0])));
+					// 16-bit indices unless the texts of this frame have more vertices than that can address
+					ElementFormat const ib_format = (vertices_.size() < 0xFFFF) ? EF_R16UI : EF_R32UI;
+					if (ib_format != ib_format_)
+					{
+						ib_format_ = ib_format;
+						rl_->BindIndexStream(ib_, ib_format_);
+					}
+
+					if (EF_R16UI == ib_format_)
+					{
+						ib_->Resize(static_cast<uint32_t>(indices_.size() * sizeof(uint16_t)));
+						GraphicsBuffer::Mapper mapper(*ib_, BA_Write_Only);
+						uint16_t* p = mapper.Pointer<uint16_t>();
+						for (size_t i = 0; i < indices_.size(); ++ i)
+						{
+							p[i] = (0xFFFFFFFF == indices_[i]) ? 0xFFFF : static_cast<uint16_t>(indices_[i]);
+						}
+					}
+					else
 					{
+						ib_->Resize(static_cast<uint32_t>(indices_.size() * sizeof(uint32_t)));
 						GraphicsBuffer::Mapper mapper(*ib_, BA_Write_Only);
-						std::copy(indices_.begin(), indices_.end(), mapper.Pointer<uint16_t>());
+						std::copy(indices_.begin(), indices_.end(), mapper.Pointer<uint32_t>());
 					}
 				}
 
@@ -196,6 +278,42 @@ namespace KlayGE
 			this->OnRenderEnd();
 		}
 
+		// Decodes the chars not in the texture yet on a worker thread, drawing the text later only uploads them
+		void PrefetchText(std::wstring const & text)
+		{
+			KFont& kl = *kfont_loader_;
+
+			std::vector<int32_t> indices;
+			typedef KlayGE::remove_reference<KLAYGE_DECLTYPE(text)>::type TextType;
+			KLAYGE_FOREACH(TextType::const_reference ch, text)
+			{
+				int32_t const offset = kl.CharIndex(ch);
+				if ((offset != -1) && (char_info_map_.find(ch) == char_info_map_.end()))
+				{
+					indices.push_back(offset);
+				}
+			}
+
+			if (!indices.empty())
+			{
+				lock_guard<mutex> lock(prefetch_mutex_);
+
+				prefetch_indices_.insert(prefetch_indices_.end(), indices.begin(), indices.end());
+				if (!prefetching_)
+				{
+					if (prefetch_thread_)
+					{
+						// The previous thread is already out of its loop
+						(*prefetch_thread_)();
+					}
+
+					prefetching_ = true;
+					prefetch_thread_ = MakeSharedPtr<joiner<void> >(Context::Instance().ThreadPool()(
+						bind(&FontRenderable::PrefetchThreadFunc, this)));
+				}
+			}
+		}
+
 		Size_T<float> CalcSize(std::wstring const & text, float font_size)
 		{
 			this->UpdateTexture(text);
@@ -229,7 +347,7 @@ namespace KlayGE
 		{
 			three_dim_ = false;
 
-			this->AddText(sx, sy, sz, xScale, yScale, clr, text, font_size);
+			this->LayoutText(vertices_, indices_, pos_aabb_, sx, sy, sz, xScale, yScale, clr, text, font_size);
 		}
 
 		void AddText2D(Rect const & rc, float sz,
@@ -237,7 +355,87 @@ namespace KlayGE
 		{
 			three_dim_ = false;
 
-			this->AddText(rc, sz, xScale, yScale, clr, text, font_size, align);
+			this->LayoutText(vertices_, indices_, pos_aabb_, rc, sz, xScale, yScale, clr, text, font_size, align);
+		}
+
+		void AddText2D(RetainedText& text)
+		{
+			three_dim_ = false;
+
+			if (!text.layout_)
+			{
+				text.layout_ = MakeSharedPtr<RetainedText::Layout>();
+			}
+
+			RetainedText::Layout& layout = *text.layout_;
+			bool rebuild = text.dirty_ || (layout.font.lock().get() != this);
+			if (!rebuild)
+			{
+				// Only an eviction of one of its own glyphs invalidates the layout
+				typedef KLAYGE_DECLTYPE(layout.slots) SlotsType;
+				KLAYGE_FOREACH(SlotsType::const_reference slot, layout.slots)
+				{
+					if (slot_versions_[slot.first] != slot.second)
+					{
+						rebuild = true;
+						break;
+					}
+				}
+			}
+			if (rebuild)
+			{
+				layout.vertices.resize(0);
+				layout.indices.resize(0);
+				layout.pos_aabb = AABBox(float3(0, 0, 0), float3(0, 0, 0));
+				if (text.in_rect_)
+				{
+					this->LayoutText(layout.vertices, layout.indices, layout.pos_aabb, text.rc_, text.z_,
+						text.x_scale_, text.y_scale_, text.clr_, text.text_, text.font_size_, text.align_);
+				}
+				else
+				{
+					this->LayoutText(layout.vertices, layout.indices, layout.pos_aabb, text.x_, text.y_, text.z_,
+						text.x_scale_, text.y_scale_, text.clr_, text.text_, text.font_size_);
+				}
+
+				// Laying out could evict glyphs, so the slots are recorded afterwards
+				layout.lru_iters.resize(0);
+				layout.slots.resize(0);
+				typedef KlayGE::remove_reference<KLAYGE_DECLTYPE(text.text_)>::type TextType;
+				KLAYGE_FOREACH(TextType::const_reference ch, text.text_)
+				{
+					KLAYGE_AUTO(cmiter, char_info_map_.find(ch));
+					if (cmiter != char_info_map_.end())
+					{
+						layout.lru_iters.push_back(cmiter->second.lru_iter);
+						layout.slots.push_back(std::make_pair(cmiter->second.slot, slot_versions_[cmiter->second.slot]));
+					}
+				}
+
+				layout.font = this->shared_from_this();
+				text.dirty_ = false;
+			}
+			else
+			{
+				// None of its glyphs is evicted since the layout, all the iterators are still valid
+				typedef KLAYGE_DECLTYPE(layout.lru_iters) LRUItersType;
+				KLAYGE_FOREACH(LRUItersType::const_reference iter, layout.lru_iters)
+				{
+					char_lru_.splice(char_lru_.begin(), char_lru_, iter);
+				}
+			}
+
+			uint32_t const base_index = static_cast<uint32_t>(vertices_.size());
+			vertices_.insert(vertices_.end(), layout.vertices.begin(), layout.vertices.end());
+			indices_.reserve(indices_.size() + layout.indices.size());
+			typedef KLAYGE_DECLTYPE(layout.indices) IndicesType;
+			KLAYGE_FOREACH(IndicesType::const_reference index, layout.indices)
+			{
+				indices_.push_back((0xFFFFFFFF == index) ? index : index + base_index);
+			}
+			pos_aabb_ |= layout.pos_aabb;
+
+			dirty_ = true;
 		}
 
 		void AddText3D(float4x4 const & mvp, Color const & clr, std::wstring const & text, float font_size)
@@ -245,19 +443,18 @@ namespace KlayGE
 			three_dim_ = true;
 			*mvp_ep_ = mvp;
 
-			this->AddText(0, 0, 0, 1, 1, clr, text, font_size);
+			this->LayoutText(vertices_, indices_, pos_aabb_, 0, 0, 0, 1, 1, clr, text, font_size);
 		}
 
 	private:
-		void AddText(Rect const & rc, float sz,
+		void LayoutText(std::vector<FontVert>& verts, std::vector<uint32_t>& inds, AABBox& pos_aabb,
+			Rect const & rc, float sz,
 			float xScale, float yScale, Color const & clr, std::wstring const & text, float font_size, uint32_t align)
 		{
 			this->UpdateTexture(text);
 
 			KFont& kl = *kfont_loader_;
 			KLAYGE_AUTO(&cim, char_info_map_);
-			KLAYGE_AUTO(&verts, vertices_);
-			KLAYGE_AUTO(&inds, indices_);
 
 			float const h = font_size * yScale;
 			float const rel_size = font_size / kl.CharSize();
@@ -359,7 +556,7 @@ namespace KlayGE
 				verts.reserve(verts.size() + maxSize * 4);
 				inds.reserve(inds.size() + maxSize * index_per_char);
 
-				uint16_t lastIndex(static_cast<uint16_t>(verts.size()));
+				uint32_t lastIndex = static_cast<uint32_t>(verts.size());
 
 				typedef KLAYGE_DECLTYPE(lines[i].second) LinesType;
 				KLAYGE_FOREACH(LinesType::const_reference ch, lines[i].second)
@@ -400,7 +597,7 @@ namespace KlayGE
 							{
 								inds.push_back(lastIndex + 3);
 								inds.push_back(lastIndex + 2);
-								inds.push_back(0xFFFF);
+								inds.push_back(0xFFFFFFFF);
 							}
 							else
 							{
@@ -417,19 +614,18 @@ namespace KlayGE
 					y += (offset_adv.second >> 16) * rel_size_y;
 				}
 
-				pos_aabb_ |= AABBox(float3(sx[i], sy[i], sz), float3(sx[i] + lines[i].first, sy[i] + h, sz + 0.1f));
+				pos_aabb |= AABBox(float3(sx[i], sy[i], sz), float3(sx[i] + lines[i].first, sy[i] + h, sz + 0.1f));
 			}
 		}
 
-		void AddText(float sx, float sy, float sz,
+		void LayoutText(std::vector<FontVert>& verts, std::vector<uint32_t>& inds, AABBox& pos_aabb,
+			float sx, float sy, float sz,
 			float xScale, float yScale, Color const & clr, std::wstring const & text, float font_size)
 		{
 			this->UpdateTexture(text);
 
 			KFont& kl = *kfont_loader_;
 			KLAYGE_AUTO(&cim, char_info_map_);
-			KLAYGE_AUTO(&verts, vertices_);
-			KLAYGE_AUTO(&inds, indices_);
 
 			uint32_t const clr32 = clr.ABGR();
 			float const h = font_size * yScale;
@@ -455,7 +651,7 @@ namespace KlayGE
 			verts.reserve(verts.size() + maxSize * 4);
 			inds.reserve(inds.size() + maxSize * index_per_char);
 
-			uint16_t lastIndex(static_cast<uint16_t>(verts.size()));
+			uint32_t lastIndex = static_cast<uint32_t>(verts.size());
 
 			typedef KlayGE::remove_reference<KLAYGE_DECLTYPE(text)>::type TextType;
 			KLAYGE_FOREACH(TextType::const_reference ch, text)
@@ -497,7 +693,7 @@ namespace KlayGE
 							{
 								inds.push_back(lastIndex + 3);
 								inds.push_back(lastIndex + 2);
-								inds.push_back(0xFFFF);
+								inds.push_back(0xFFFFFFFF);
 							}
 							else
 							{
@@ -530,15 +726,13 @@ namespace KlayGE
 				}
 			}
 
-			pos_aabb_ |= AABBox(float3(sx, sy, sz), float3(maxx, maxy, sz + 0.1f));
+			pos_aabb |= AABBox(float3(sx, sy, sz), float3(maxx, maxy, sz + 0.1f));
 		}
 
 		// ʹLRU㷨
 		/////////////////////////////////////////////////////////////////////////////////
 		void UpdateTexture(std::wstring const & text)
 		{
-			++ tick_;
-
 			uint32_t const tex_size = dist_texture_->Width(0);
 
 			KFont& kl = *kfont_loader_;
@@ -560,7 +754,7 @@ namespace KlayGE
 					{
 						// ҵ
 
-						cmiter->second.tick = tick_;
+						char_lru_.splice(char_lru_.begin(), char_lru_, cmiter->second.lru_iter);
 					}
 					else
 					{
@@ -587,6 +781,7 @@ namespace KlayGE
 
 							charInfo.rc.left() = static_cast<float>(char_pos.x()) / tex_size;
 							charInfo.rc.top() = static_cast<float>(char_pos.y()) / tex_size;
+							charInfo.slot = s;
 
 							++ char_free_list_.front().first;
 							if (char_free_list_.front().first == char_free_list_.front().second)
@@ -596,79 +791,39 @@ namespace KlayGE
 						}
 						else
 						{
-							// ҵʹʱûʹõ
+							// Reuse the slot of the least recently used char
 
-							uint64_t min_tick = cim.begin()->second.tick;
-							KLAYGE_AUTO(min_chiter, cim.begin());
-							for (KLAYGE_AUTO(chiter, cim.begin()); chiter != cim.end(); ++ chiter)
-							{
-								if (chiter->second.tick < min_tick)
-								{
-									min_tick = chiter->second.tick;
-									min_chiter = chiter;
-								}
-							}
+							KLAYGE_AUTO(lru_chiter, cim.find(char_lru_.back()));
+							BOOST_ASSERT(lru_chiter != cim.end());
 
-							char_pos.x() = static_cast<int32_t>(min_chiter->second.rc.left() * tex_size);
-							char_pos.y() = static_cast<int32_t>(min_chiter->second.rc.top() * tex_size);
-							charInfo.rc.left() = min_chiter->second.rc.left();
-							charInfo.rc.top() = min_chiter->second.rc.top();
+							char_pos.x() = static_cast<int32_t>(lru_chiter->second.rc.left() * tex_size + 0.5f);
+							char_pos.y() = static_cast<int32_t>(lru_chiter->second.rc.top() * tex_size + 0.5f);
+							charInfo.rc.left() = lru_chiter->second.rc.left();
+							charInfo.rc.top() = lru_chiter->second.rc.top();
+							charInfo.slot = lru_chiter->second.slot;
+							++ slot_versions_[charInfo.slot];
 
-							for (KLAYGE_AUTO(chiter, cim.begin()); chiter != cim.end(); ++ chiter)
+							// The evicted char could still be waiting for its upload
+							for (size_t i = 0; i < pending_uploads_.size(); ++ i)
 							{
-								if (chiter->second.tick == min_tick)
+								if (pending_uploads_[i].second == char_pos)
 								{
-									uint32_t const x = static_cast<int32_t>(chiter->second.rc.left() * tex_size);
-									uint32_t const y = static_cast<int32_t>(chiter->second.rc.top() * tex_size);
-									uint32_t const id = y * num_chars_a_row + x;
-									KLAYGE_AUTO(freeiter, char_free_list_.begin());
-									while ((freeiter != char_free_list_.end()) && (freeiter->second <= id))
-									{
-										++ freeiter;
-									}
-									char_free_list_.insert(freeiter, std::make_pair(id, id + 1));
-
-									cim.erase(chiter);
+									pending_uploads_.erase(pending_uploads_.begin() + i);
 									break;
 								}
 							}
-							for (KLAYGE_AUTO(freeiter, char_free_list_.begin()); freeiter != char_free_list_.end();)
-							{
-								KLAYGE_AUTO(nextiter, freeiter);
-								++ nextiter;
 
-								if (nextiter != char_free_list_.end())
-								{
-									if (freeiter->second == nextiter->first)
-									{
-										freeiter->second = nextiter->second;
-										char_free_list_.erase(nextiter);
-									}
-									else
-									{
-										++ freeiter;
-									}
-								}
-								else
-								{
-									break;
-								}
-							}
+							cim.erase(lru_chiter);
+							char_lru_.pop_back();
 						}
 
 						charInfo.rc.right()		= charInfo.rc.left() + static_cast<float>(width) / tex_size;
 						charInfo.rc.bottom()	= charInfo.rc.top() + static_cast<float>(height) / tex_size;
-						charInfo.tick			= tick_;
 
-						{
-							Texture::Mapper mapper(*a_char_texture_, 0, 0, TMA_Write_Only,
-								0, 0, kfont_char_size, kfont_char_size);
-							kl.GetDistanceData(mapper.Pointer<uint8_t>(), mapper.RowPitch(), offset);
-						}
+						char_lru_.push_front(ch);
+						charInfo.lru_iter = char_lru_.begin();
 
-						a_char_texture_->CopyToSubTexture2D(*dist_texture_,
-							0, 0, char_pos.x(), char_pos.y(), kfont_char_size, kfont_char_size,
-							0, 0, 0, 0, kfont_char_size, kfont_char_size);
+						pending_uploads_.push_back(std::make_pair(offset, char_pos));
 
 						cim.insert(std::make_pair(ch, charInfo));
 					}
@@ -676,47 +831,90 @@ namespace KlayGE
 			}
 		}
 
-	private:
-		struct CharInfo
+		// Distance data of the pending chars are written into a strip of a_char_texture_ with one mapping,
+		// and copied to their places in dist_texture_ afterwards. Called once a frame.
+		void UploadChars()
 		{
-			Rect rc;
-			uint64_t tick;
-		};
+			std::vector<std::pair<int32_t, int2> > uploads;
+			uploads.swap(pending_uploads_);
 
-#ifdef KLAYGE_HAS_STRUCT_PACK
-	#pragma pack(push, 1)
-#endif
-		struct FontVert
-		{
-			float3 pos;
-			uint32_t clr;
-			float2 tex;
+			KFont& kl = *kfont_loader_;
+			uint32_t const kfont_char_size = kl.CharSize();
+			uint32_t const batch_size = a_char_texture_->Width(0) / kfont_char_size;
 
-			FontVert()
+			for (size_t begin = 0; begin < uploads.size(); begin += batch_size)
 			{
+				uint32_t const num = static_cast<uint32_t>(std::min<size_t>(batch_size, uploads.size() - begin));
+
+				{
+					Texture::Mapper mapper(*a_char_texture_, 0, 0, TMA_Write_Only,
+						0, 0, num * kfont_char_size, kfont_char_size);
+					uint8_t* p = mapper.Pointer<uint8_t>();
+					for (uint32_t i = 0; i < num; ++ i)
+					{
+						kl.GetDistanceData(p + i * kfont_char_size, mapper.RowPitch(), uploads[begin + i].first);
+					}
+				}
+
+				for (uint32_t i = 0; i < num; ++ i)
+				{
+					int2 const & char_pos = uploads[begin + i].second;
+					a_char_texture_->CopyToSubTexture2D(*dist_texture_,
+						0, 0, char_pos.x(), char_pos.y(), kfont_char_size, kfont_char_size,
+						0, 0, i * kfont_char_size, 0, kfont_char_size, kfont_char_size);
+				}
 			}
-			FontVert(float3 const & pos, uint32_t clr, float2 const & tex)
-				: pos(pos), clr(clr), tex(tex)
+		}
+
+		void PrefetchThreadFunc()
+		{
+			for (;;)
 			{
+				std::vector<int32_t> indices;
+				{
+					lock_guard<mutex> lock(prefetch_mutex_);
+					if (prefetch_indices_.empty())
+					{
+						prefetching_ = false;
+						break;
+					}
+					indices.swap(prefetch_indices_);
+				}
+
+				kfont_loader_->PrefetchDistanceData(indices);
 			}
+		}
+
+	private:
+		static uint32_t const MAX_CHAR_UPLOAD_BATCH = 16;
+
+		struct CharInfo
+		{
+			Rect rc;
+			std::list<wchar_t>::iterator lru_iter;
+			uint32_t slot;
 		};
-#ifdef KLAYGE_HAS_STRUCT_PACK
-	#pragma pack(pop)
-#endif
 
 		bool restart_;
 		bool dirty_;
 
 		unordered_map<wchar_t, CharInfo> char_info_map_;
+		// Most recently used first
+		std::list<wchar_t> char_lru_;
 		std::list<std::pair<uint32_t, uint32_t> > char_free_list_;
+		// Bumped when the char in a slot is evicted, invalidating the cached layouts using it
+		std::vector<uint32_t> slot_versions_;
+		// Chars added to the texture in this frame, uploaded by the next UpdateBuffers
+		std::vector<std::pair<int32_t, int2> > pending_uploads_;
 
 		bool three_dim_;
 
 		std::vector<FontVert>	vertices_;
-		std::vector<uint16_t>	indices_;
+		std::vector<uint32_t>	indices_;
 
 		GraphicsBufferPtr vb_;
 		GraphicsBufferPtr ib_;
+		ElementFormat ib_format_;
 
 		TexturePtr		dist_texture_;
 		TexturePtr		a_char_texture_;
@@ -727,7 +925,10 @@ namespace KlayGE
 
 		shared_ptr<KFont> kfont_loader_;
 
-		uint64_t tick_;
+		std::vector<int32_t> prefetch_indices_;
+		bool prefetching_;
+		mutex prefetch_mutex_;
+		shared_ptr<joiner<void> > prefetch_thread_;
 	};
 
 	class FontObject : public SceneObjectHelper
@@ -844,6 +1045,90 @@ namespace
 
 namespace KlayGE
 {
+	RetainedText::RetainedText()
+		: font_size_(16), clr_(1, 1, 1, 1), x_scale_(1), y_scale_(1),
+			in_rect_(false), x_(0), y_(0), z_(0), align_(Font::FA_Hor_Left | Font::FA_Ver_Top),
+			dirty_(true)
+	{
+	}
+
+	void RetainedText::Text(std::wstring const & text)
+	{
+		if (text != text_)
+		{
+			text_ = text;
+			dirty_ = true;
+		}
+	}
+
+	std::wstring const & RetainedText::Text() const
+	{
+		return text_;
+	}
+
+	void RetainedText::FontSize(float font_size)
+	{
+		if (font_size != font_size_)
+		{
+			font_size_ = font_size;
+			dirty_ = true;
+		}
+	}
+
+	float RetainedText::FontSize() const
+	{
+		return font_size_;
+	}
+
+	void RetainedText::TextColor(Color const & clr)
+	{
+		if (clr != clr_)
+		{
+			clr_ = clr;
+			dirty_ = true;
+		}
+	}
+
+	Color const & RetainedText::TextColor() const
+	{
+		return clr_;
+	}
+
+	void RetainedText::Scale(float x_scale, float y_scale)
+	{
+		if ((x_scale != x_scale_) || (y_scale != y_scale_))
+		{
+			x_scale_ = x_scale;
+			y_scale_ = y_scale;
+			dirty_ = true;
+		}
+	}
+
+	void RetainedText::Position(float x, float y, float z)
+	{
+		if (in_rect_ || (x != x_) || (y != y_) || (z != z_))
+		{
+			in_rect_ = false;
+			x_ = x;
+			y_ = y;
+			z_ = z;
+			dirty_ = true;
+		}
+	}
+
+	void RetainedText::Region(Rect const & rc, float z, uint32_t align)
+	{
+		if (!in_rect_ || (rc != rc_) || (z != z_) || (align != align_))
+		{
+			in_rect_ = true;
+			rc_ = rc;
+			z_ = z;
+			align_ = align;
+			dirty_ = true;
+		}
+	}
+
+
 	// 캯
 	/////////////////////////////////////////////////////////////////////////////////
 	Font::Font(shared_ptr<FontRenderable> const & fr)
@@ -876,6 +1161,43 @@ namespace KlayGE
 		}
 	}
 
+	void Font::RenderText(RetainedTextPtr const & text)
+	{
+		if (!text->Text().empty())
+		{
+			shared_ptr<FontObject> font_obj = MakeSharedPtr<FontObject>(font_renderable_, fso_attrib_);
+			font_renderable_->AddText2D(*text);
+			font_obj->AddToSceneManager();
+		}
+	}
+
+	void Font::RenderTexts(std::vector<RetainedTextPtr> const & texts)
+	{
+		bool any = false;
+		for (size_t i = 0; i < texts.size(); ++ i)
+		{
+			if (!texts[i]->Text().empty())
+			{
+				font_renderable_->AddText2D(*texts[i]);
+				any = true;
+			}
+		}
+
+		if (any)
+		{
+			shared_ptr<FontObject> font_obj = MakeSharedPtr<FontObject>(font_renderable_, fso_attrib_);
+			font_obj->AddToSceneManager();
+		}
+	}
+
+	void Font::Prefetch(std::wstring const & text)
+	{
+		if (!text.empty())
+		{
+			font_renderable_->PrefetchText(text);
+		}
+	}
+
 	// ָλû
 	/////////////////////////////////////////////////////////////////////////////////
 	void Font::RenderText(float sx, float sy, Color const & clr,
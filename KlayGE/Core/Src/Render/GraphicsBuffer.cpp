@@ -61,12 +61,17 @@ namespace KlayGE
 	};
 
 	GraphicsBuffer::GraphicsBuffer(BufferUsage usage, uint32_t access_hint)
-			: usage_(usage), access_hint_(access_hint), size_in_byte_(0), hw_buff_size_(0)
+			: usage_(usage), access_hint_(access_hint), size_in_byte_(0), hw_buff_size_(0),
+				tracking_tag_(MT_GraphicsBuffer), tracked_gpu_size_(0)
 	{
 	}
 
 	GraphicsBuffer::~GraphicsBuffer()
 	{
+		if (tracked_gpu_size_ > 0)
+		{
+			MemoryTracker::Instance().Deallocate(tracking_tag_, MP_GPU, tracked_gpu_size_);
+		}
 	}
 
 	GraphicsBufferPtr GraphicsBuffer::NullObject()
@@ -82,6 +87,36 @@ namespace KlayGE
 		{
 			this->DoResize();
 			hw_buff_size_ = size_in_byte_;
+			this->UpdateGPUMemoryUsage();
+		}
+	}
+
+	void GraphicsBuffer::TrackingTag(MemoryTag tag)
+	{
+		if (tag != tracking_tag_)
+		{
+			if (tracked_gpu_size_ > 0)
+			{
+				MemoryTracker& tracker = MemoryTracker::Instance();
+				tracker.Deallocate(tracking_tag_, MP_GPU, tracked_gpu_size_);
+				tracker.Allocate(tag, MP_GPU, tracked_gpu_size_);
+			}
+			tracking_tag_ = tag;
+		}
+	}
+
+	void GraphicsBuffer::UpdateGPUMemoryUsage()
+	{
+		MemoryTracker& tracker = MemoryTracker::Instance();
+		if (tracked_gpu_size_ > 0)
+		{
+			tracker.Deallocate(tracking_tag_, MP_GPU, tracked_gpu_size_);
+			tracked_gpu_size_ = 0;
+		}
+		if ((hw_buff_size_ > 0) && tracker.Enabled())
+		{
+			tracked_gpu_size_ = hw_buff_size_;
+			tracker.Allocate(tracking_tag_, MP_GPU, tracked_gpu_size_);
 		}
 	}
 }
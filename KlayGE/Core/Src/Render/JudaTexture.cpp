@@ -12,6 +12,8 @@
 
 #include <KlayGE/KlayGE.hpp>
 #include <KFL/ThrowErr.hpp>
+#include <KFL/Util.hpp>
+#include <KFL/CpuInfo.hpp>
 #include <KlayGE/ResLoader.hpp>
 #include <KlayGE/RenderFactory.hpp>
 #include <KlayGE/RenderEngine.hpp>
@@ -20,6 +22,7 @@
 
 #include <fstream>
 #include <cstring>
+#include <limits>
 #include <boost/assert.hpp>
 #ifdef KLAYGE_COMPILER_MSVC
 #pragma warning(push)
@@ -114,6 +117,30 @@ namespace
 		}
 		return bias;
 	}
+
+	TexCompressionPtr CreateTileCodec(ElementFormat format)
+	{
+		TexCompressionPtr codec;
+		switch (format)
+		{
+		case EF_BC1:
+			codec = MakeSharedPtr<TexCompressionBC1>();
+			break;
+
+		case EF_BC2:
+			codec = MakeSharedPtr<TexCompressionBC2>();
+			break;
+
+		case EF_BC3:
+			codec = MakeSharedPtr<TexCompressionBC3>();
+			break;
+
+		default:
+			BOOST_ASSERT(false);
+			break;
+		}
+		return codec;
+	}
 }
 
 namespace KlayGE
@@ -125,7 +152,7 @@ namespace KlayGE
 		: root_(MakeSharedPtr<quadtree_node>()),
 			num_tiles_(num_tiles), tile_size_(tile_size), format_(format),
 			texel_size_(NumFormatBytes(format)),
-			decode_tick_(0), tile_tick_(0)
+			async_tile_loading_(true), max_tile_uploads_per_frame_(16), quit_(false)
 	{
 		BOOST_ASSERT(num_tiles_ <= MAX_NUM_TILES);
 		BOOST_ASSERT(tile_size_ <= MAX_TILE_SIZE);
@@ -187,6 +214,11 @@ namespace KlayGE
 		}
 	}
 
+	JudaTexture::~JudaTexture()
+	{
+		this->StopDecodingThreads();
+	}
+
 	uint32_t JudaTexture::EncodeTileID(uint32_t level, uint32_t tile_x, uint32_t tile_y) const
 	{
 		BOOST_ASSERT(level <= MAX_TREE_LEVEL);
@@ -456,15 +488,14 @@ namespace KlayGE
 
 	void JudaTexture::DecodeATile(std::vector<uint8_t>* data, uint32_t shuff, uint32_t mipmaps)
 	{
-		++ decode_tick_;
-
 		uint32_t const full_tile_bytes = cache_tile_size_ * cache_tile_size_ * texel_size_;
 		uint32_t target_level = this->ShuffLevel(shuff);
 
+		shared_ptr<DecodedBlock> block;
 		quadtree_node_ptr node = root_;
 		if (0 == target_level)
 		{
-			std::memcpy(&data[0][0], this->RetriveATile(root_->data_index), full_tile_bytes);
+			std::memcpy(&data[0][0], this->RetriveATile(block, root_->data_index), full_tile_bytes);
 		}
 		else
 		{
@@ -517,7 +548,7 @@ namespace KlayGE
 						uint8_t const * src;
 						if (1 == ll_b)
 						{
-							src = this->RetriveATile(root_->data_index);
+							src = this->RetriveATile(block, root_->data_index);
 						}
 						else
 						{
@@ -541,7 +572,7 @@ namespace KlayGE
 						{
 							uint32_t start_x = (start_sub_tile_x >> shift) * used_w * 2;
 							uint32_t start_y = (start_sub_tile_y >> shift) * used_h * 2;
-							uint8_t const * start_src = this->RetriveATile(node->data_index) + (start_y * tile_size_ + start_x) * texel_size_;
+							uint8_t const * start_src = this->RetriveATile(block, node->data_index) + (start_y * tile_size_ + start_x) * texel_size_;
 							uint8_t* dst = &temp[0];
 							for (size_t y = 0; y < used_h * 2; ++ y)
 							{
@@ -632,69 +663,78 @@ namespace KlayGE
 		return ret_attr;
 	}
 
-	uint8_t* JudaTexture::RetriveATile(uint32_t data_index)
+	uint8_t const * JudaTexture::RetriveATile(shared_ptr<DecodedBlock>& block, uint32_t data_index)
 	{
 		if (data_blocks_.empty())
 		{
 			typedef KLAYGE_DECLTYPE(decoded_block_cache_) DecodedBlockCacheType;
-			DecodedBlockCacheType::iterator iter = decoded_block_cache_.find(data_index);
-			if (iter != decoded_block_cache_.end())
-			{
-				iter->second.tick = decode_tick_;
-			}
-			else
+
+			// The cache and the input file are shared by all decoding threads
+			std::vector<uint8_t> comed_data;
 			{
-				if (decoded_block_cache_.size() >= 64)
+				lock_guard<mutex> lock(decode_mutex_);
+
+				DecodedBlockCacheType::iterator iter = decoded_block_cache_.find(data_index);
+				if (iter != decoded_block_cache_.end())
 				{
-					DecodedBlockCacheType::iterator min_iter = decoded_block_cache_.begin();
-					uint64_t min_tick = min_iter->second.tick;
-					for (DecodedBlockCacheType::iterator dbiter = decoded_block_cache_.begin();
-						dbiter != decoded_block_cache_.end(); ++ dbiter)
-					{
-						if (dbiter->second.tick < min_tick)
-						{
-							min_tick = dbiter->second.tick;
-							min_iter = dbiter;
-						}
-					}
+					decoded_block_lru_.splice(decoded_block_lru_.begin(), decoded_block_lru_, iter->second.lru_iter);
+					++ decoded_block_cache_stat_.hits;
 
-					for (DecodedBlockCacheType::iterator dbiter = decoded_block_cache_.begin();
-						dbiter != decoded_block_cache_.end();)
-					{
-						if (dbiter->second.tick == min_tick)
-						{
-							dbiter = decoded_block_cache_.erase(dbiter);
-						}
-						else
-						{
-							++ dbiter;
-						}
-					}
+					block = iter->second.data;
+					return &(*block)[0];
 				}
 
-				uint32_t const full_tile_bytes = tile_size_ * tile_size_ * texel_size_;
-				shared_ptr<std::vector<uint8_t> > data = MakeSharedPtr<std::vector<uint8_t> >(full_tile_bytes);
+				++ decoded_block_cache_stat_.misses;
 				if (data_index != EMPTY_DATA_INDEX)
 				{
 					uint64_t offsets[2];
 					input_file_->seekg(data_blocks_offset_ + data_index * sizeof(uint64_t), std::ios_base::beg);
 					input_file_->read(offsets, sizeof(offsets));
 					uint32_t const comed_len = static_cast<uint32_t>(offsets[1] - offsets[0]);
-					std::vector<uint8_t> comed_data(comed_len);
+					comed_data.resize(comed_len);
 					input_file_->seekg(offsets[0], std::ios_base::beg);
 					input_file_->read(&comed_data[0], comed_len);
-					lzma_dec_.Decode(&(*data)[0], &comed_data[0], comed_len, full_tile_bytes);
 				}
-				else
+			}
+
+			// LZMA decoding is the expensive part, so the threads do it in parallel
+			uint32_t const full_tile_bytes = tile_size_ * tile_size_ * texel_size_;
+			block = MakeSharedPtr<DecodedBlock>(full_tile_bytes);
+			if (data_index != EMPTY_DATA_INDEX)
+			{
+				LZMACodec lzma_dec;
+				lzma_dec.Decode(&(*block)[0], &comed_data[0], comed_data.size(), full_tile_bytes);
+			}
+			else
+			{
+				memset(&(*block)[0], 0, full_tile_bytes);
+			}
+
+			{
+				lock_guard<mutex> lock(decode_mutex_);
+
+				// Another thread could have decoded the same block in the meantime
+				DecodedBlockCacheType::iterator iter = decoded_block_cache_.find(data_index);
+				if (iter != decoded_block_cache_.end())
 				{
-					memset(&(*data)[0], 0, full_tile_bytes);
+					decoded_block_lru_.splice(decoded_block_lru_.begin(), decoded_block_lru_, iter->second.lru_iter);
+					block = iter->second.data;
 				}
+				else
+				{
+					if (decoded_block_cache_.size() >= MAX_NUM_DECODED_BLOCKS)
+					{
+						decoded_block_cache_.erase(decoded_block_lru_.back());
+						decoded_block_lru_.pop_back();
+						++ decoded_block_cache_stat_.evictions;
+					}
 
-				std::pair<DecodedBlockCacheType::iterator, bool> p = decoded_block_cache_.insert(std::make_pair(data_index, DecodedBlockInfo(data, decode_tick_)));
-				iter = p.first;
+					decoded_block_lru_.push_front(data_index);
+					decoded_block_cache_.insert(std::make_pair(data_index, DecodedBlockInfo(block, decoded_block_lru_.begin())));
+				}
 			}
 
-			return &(*iter->second.data)[0];
+			return &(*block)[0];
 		}
 		else
 		{
@@ -1181,24 +1221,7 @@ namespace KlayGE
 			}
 			if (IsCompressedFormat(format))
 			{
-				switch (format)
-				{
-				case EF_BC1:
-					tex_codec_ = MakeSharedPtr<TexCompressionBC1>();
-					break;
-
-				case EF_BC2:
-					tex_codec_ = MakeSharedPtr<TexCompressionBC2>();
-					break;
-
-				case EF_BC3:
-					tex_codec_ = MakeSharedPtr<TexCompressionBC3>();
-					break;
-
-				default:
-					BOOST_ASSERT(false);
-					break;
-				}
+				tex_codec_ = CreateTileCodec(format);
 
 				// BC format must be multiply of 4
 				while (((tile_with_border_size >> mipmap) & 0x3) != 0)
@@ -1215,6 +1238,7 @@ namespace KlayGE
 			if (caps.max_texture_array_length > array_size)
 			{
 				tex_cache_ = rf.MakeTexture2D(tile_with_border_size * s, tile_with_border_size * s, mipmap, array_size, format, 1, 0, EAH_GPU_Read, nullptr);
+				tex_cache_->TrackingTag(MT_JudaTexture);
 			}
 			else
 			{
@@ -1222,14 +1246,28 @@ namespace KlayGE
 				for (uint32_t i = 0; i < array_size; ++ i)
 				{
 					tex_cache_array_[i] = rf.MakeTexture2D(tile_with_border_size * s, tile_with_border_size * s, mipmap, 1, format, 1, 0, EAH_GPU_Read, nullptr);
+					tex_cache_array_[i]->TrackingTag(MT_JudaTexture);
 				}
 			}
 
 			tex_a_tile_cache_ = rf.MakeTexture2D(tile_with_border_size, tile_with_border_size, mipmap, 1, format, 1, 0, EAH_CPU_Write, nullptr);
 			tex_indirect_ = rf.MakeTexture2D(num_tiles_, num_tiles_, 1, 1, EF_ABGR8, 1, 0, EAH_GPU_Read, nullptr);
 			tex_a_tile_indirect_ = rf.MakeTexture2D(1, 1, 1, 1, EF_ABGR8, 1, 0, EAH_CPU_Write, nullptr);
+			tex_a_tile_cache_->TrackingTag(MT_JudaTexture);
+			tex_indirect_->TrackingTag(MT_JudaTexture);
+			tex_a_tile_indirect_->TrackingTag(MT_JudaTexture);
 
 			tile_free_list_.push_back(std::make_pair(0, pages));
+
+			for (size_t i = 0; i < level_views_.size(); ++ i)
+			{
+				level_views_[i].valid = false;
+			}
+
+			if (async_tile_loading_)
+			{
+				this->StartDecodingThreads();
+			}
 		}
 	}
 
@@ -1248,6 +1286,25 @@ namespace KlayGE
 		return tex_indirect_;
 	}
 
+	JudaTexture::CacheStatistics const & JudaTexture::TileCacheStatistics() const
+	{
+		return tile_cache_stat_;
+	}
+
+	JudaTexture::CacheStatistics JudaTexture::DecodedBlockCacheStatistics() const
+	{
+		lock_guard<mutex> lock(decode_mutex_);
+		return decoded_block_cache_stat_;
+	}
+
+	void JudaTexture::ResetCacheStatistics()
+	{
+		tile_cache_stat_ = CacheStatistics();
+
+		lock_guard<mutex> lock(decode_mutex_);
+		decoded_block_cache_stat_ = CacheStatistics();
+	}
+
 	void JudaTexture::SetParams(RenderTechniquePtr const tech)
 	{
 		RenderEffect& effect = tech->Effect();
@@ -1278,230 +1335,459 @@ namespace KlayGE
 	{
 		BOOST_ASSERT(tex_cache_ || !tex_cache_array_.empty());
 
-		++ tile_tick_;
-
-		uint32_t const tex_width = tex_cache_ ? tex_cache_->Width(0) : tex_cache_array_[0]->Width(0);
-		uint32_t const tex_height = tex_cache_ ? tex_cache_->Height(0) : tex_cache_array_[0]->Height(0);
-		uint32_t const tex_layer = tex_cache_ ? tex_cache_->ArraySize() : static_cast<uint32_t>(tex_cache_array_.size());
-		uint32_t const tile_with_border_size = cache_tile_size_ + cache_tile_border_size_ * 2;
-
-		uint32_t const num_cache_tiles_a_row = tex_width / tile_with_border_size;
-		uint32_t const num_cache_tiles_a_layer = num_cache_tiles_a_row * tex_height / tile_with_border_size;
-		uint32_t const num_cache_total_tiles = num_cache_tiles_a_layer * tex_layer;
-
-		unordered_map<uint32_t, uint32_t> neighbor_id_map;
-		std::vector<uint32_t> all_neighbor_ids;
-		std::vector<uint32_t> neighbor_ids;
-		std::vector<uint32_t> tile_attrs;
-		std::vector<bool> in_same_image;
-		KLAYGE_AUTO(&tim, tile_info_map_);
+		std::vector<TileRequest> requests;
 		for (size_t i = 0; i < tile_ids.size(); ++ i)
 		{
-			KLAYGE_AUTO(tmiter, tim.find(tile_ids[i]));
-			if (tmiter != tim.end())
+			KLAYGE_AUTO(tmiter, tile_info_map_.find(tile_ids[i]));
+			if (tmiter != tile_info_map_.end())
 			{
 				// Exists in cache
 
-				tmiter->second.tick = tile_tick_;
+				tile_lru_.splice(tile_lru_.begin(), tile_lru_, tmiter->second.lru_iter);
+				++ tile_cache_stat_.hits;
 			}
 			else
 			{
-				uint32_t level, tile_x, tile_y;
-				this->DecodeTileID(level, tile_x, tile_y, tile_ids[i]);
-
-				array<uint32_t, 9> new_tile_id_with_neighbors;
-				new_tile_id_with_neighbors.fill(0xFFFFFFFF);
-				new_tile_id_with_neighbors[0] = tile_ids[i];
+				++ tile_cache_stat_.misses;
+				if (pending_tiles_.find(tile_ids[i]) == pending_tiles_.end())
+				{
+					requests.push_back(TileRequest());
+					this->MakeTileRequest(requests.back(), tile_ids[i]);
+					pending_tiles_.insert(tile_ids[i]);
+				}
+			}
+		}
 
-				array<bool, 9> new_in_same_image;
-				new_in_same_image.fill(false);
-				new_in_same_image[0] = true;
+		if (decoding_threads_.empty())
+		{
+			std::vector<DecodedTile> tiles;
+			this->DecodeTileRequests(tiles, requests, tex_codec_);
+			for (size_t i = 0; i < tiles.size(); ++ i)
+			{
+				pending_tiles_.erase(tiles[i].tile_id);
+				this->UploadATile(tiles[i]);
+			}
+		}
+		else
+		{
+			{
+				lock_guard<mutex> lock(request_mutex_);
 
-				uint32_t attr = this->DecodeAAttr(this->Pos2Shuff(level, tile_x, tile_y));
-				tile_attrs.push_back(attr);
-				if (attr != 0xFFFFFFFF)
+				// Visible tiles jump the queue, ahead of the prefetched ones
+				for (KLAYGE_AUTO(iter, requests.rbegin()); iter != requests.rend(); ++ iter)
 				{
-					array<int32_t, 9> new_tile_id_x;
-					array<int32_t, 9> new_tile_id_y;
+					tile_requests_.push_front(*iter);
+				}
+			}
+			this->PrefetchTiles(tile_ids);
+			request_cond_.notify_all();
 
-					int32_t left = tile_x - 1;
-					int32_t right = tile_x + 1;
-					int32_t up = tile_y - 1;
-					int32_t down = tile_y + 1;
+			this->UploadDecodedTiles(max_tile_uploads_per_frame_);
+		}
+	}
 
-					ImageEntry const & entry = image_entries_[attr];
-					if (TAM_Wrap == (entry.addr_u_v & 0xF))
-					{
-						left = entry.x + (left - entry.x + entry.w) % entry.w;
-						right = entry.x + (right - entry.x + entry.w) % entry.w;
-					}
-					if (TAM_Wrap == ((entry.addr_u_v >> 4) & 0xF))
-					{
-						up = entry.y + (up - entry.y + entry.h) % entry.h;
-						down = entry.y + (down - entry.y + entry.h) % entry.h;
-					}
+	void JudaTexture::FlushCache()
+	{
+		while (!pending_tiles_.empty())
+		{
+			this->UploadDecodedTiles(static_cast<uint32_t>(pending_tiles_.size()));
+			if (!pending_tiles_.empty())
+			{
+				if (decoding_threads_.empty())
+				{
+					break;
+				}
 
-					new_tile_id_x[1] = left;
-					new_tile_id_y[1] = up;
-					new_tile_id_x[2] = tile_x;
-					new_tile_id_y[2] = up;
-					new_tile_id_x[3] = right;
-					new_tile_id_y[3] = up;
-
-					new_tile_id_x[4] = left;
-					new_tile_id_y[4] = tile_y;
-					new_tile_id_x[5] = right;
-					new_tile_id_y[5] = tile_y;
-
-					new_tile_id_x[6] = left;
-					new_tile_id_y[6] = down;
-					new_tile_id_x[7] = tile_x;
-					new_tile_id_y[7] = down;
-					new_tile_id_x[8] = right;
-					new_tile_id_y[8] = down;
-
-					for (int j = 1; j < 9; ++ j)
-					{
-						if ((new_tile_id_x[j] >= 0) && (new_tile_id_y[j] >= 0)
-							&& (new_tile_id_x[j] < static_cast<int32_t>(num_tiles_) - 1)
-							&& (new_tile_id_y[j] < static_cast<int32_t>(num_tiles_) - 1))
-						{
-							new_tile_id_with_neighbors[j] = this->EncodeTileID(level, new_tile_id_x[j], new_tile_id_y[j]);
-							if (new_tile_id_with_neighbors[j] != 0xFFFFFFFF)
-							{
-								if (attr == this->DecodeAAttr(this->Pos2Shuff(level, new_tile_id_x[j], new_tile_id_y[j])))
-								{
-									new_in_same_image[j] = true;
-								}
-							}
-						}
-						else
-						{
-							new_tile_id_with_neighbors[j] = 0xFFFFFFFF;
-						}
-					}
+				unique_lock<mutex> lock(decoded_mutex_);
+				while (decoded_tiles_.empty())
+				{
+					decoded_cond_.wait(lock);
 				}
+			}
+		}
+	}
 
-				for (size_t j = 0; j < new_tile_id_with_neighbors.size(); ++ j)
+	void JudaTexture::AsyncTileLoading(bool async)
+	{
+		if (async != async_tile_loading_)
+		{
+			async_tile_loading_ = async;
+			if (async)
+			{
+				this->StartDecodingThreads();
+			}
+			else
+			{
+				this->StopDecodingThreads();
+
+				// Finish the requests left behind by the threads on this thread
+				std::vector<TileRequest> requests(tile_requests_.begin(), tile_requests_.end());
+				tile_requests_.clear();
+				std::vector<DecodedTile> tiles;
+				this->DecodeTileRequests(tiles, requests, tex_codec_);
+				for (size_t i = 0; i < tiles.size(); ++ i)
 				{
-					if (new_tile_id_with_neighbors[j] != 0xFFFFFFFF)
-					{
-						if (neighbor_id_map.find(new_tile_id_with_neighbors[j]) == neighbor_id_map.end())
-						{
-							neighbor_id_map.insert(std::make_pair(new_tile_id_with_neighbors[j], static_cast<uint32_t>(neighbor_ids.size())));
-							neighbor_ids.push_back(new_tile_id_with_neighbors[j]);
-						}
-					}
-					all_neighbor_ids.push_back(new_tile_id_with_neighbors[j]);
-					in_same_image.push_back(new_in_same_image[j]);
+					decoded_tiles_.push_back(DecodedTile());
+					decoded_tiles_.back().tile_id = tiles[i].tile_id;
+					decoded_tiles_.back().attr = tiles[i].attr;
+					decoded_tiles_.back().mips.swap(tiles[i].mips);
 				}
+				this->UploadDecodedTiles(static_cast<uint32_t>(decoded_tiles_.size()));
+				pending_tiles_.clear();
 			}
 		}
+	}
 
-		uint32_t mipmaps = tex_a_tile_cache_->NumMipMaps();
-		std::vector<std::vector<uint8_t> > neighbor_data;
-		this->DecodeTiles(neighbor_data, neighbor_ids, mipmaps);
+	bool JudaTexture::AsyncTileLoading() const
+	{
+		return async_tile_loading_;
+	}
 
-		TileInfo tile_info;
-		tile_info.tick = tile_tick_;
-		for (size_t i = 0; i < all_neighbor_ids.size(); i += 9)
+	void JudaTexture::MaxTileUploadsPerFrame(uint32_t num)
+	{
+		max_tile_uploads_per_frame_ = std::max(num, 1U);
+	}
+
+	uint32_t JudaTexture::MaxTileUploadsPerFrame() const
+	{
+		return max_tile_uploads_per_frame_;
+	}
+
+	void JudaTexture::StartDecodingThreads()
+	{
+		if (input_file_ && (tex_cache_ || !tex_cache_array_.empty()) && decoding_threads_.empty())
 		{
-			tile_info.attr = tile_attrs[i / 9];
-			uint8_t border_clr[4];
-			TexAddressingMode addr_u, addr_v;
-			if (tile_info.attr != 0xFFFFFFFF)
+			quit_ = false;
+
+			int const num_threads = std::max(1, std::min(CPUInfo().NumHWThreads() - 1, static_cast<int>(MAX_DECODING_THREADS)));
+			for (int i = 0; i < num_threads; ++ i)
 			{
-				ImageEntry const & entry = image_entries_[tile_info.attr];
-				addr_u = static_cast<TexAddressingMode>(entry.addr_u_v & 0xF);
-				addr_v = static_cast<TexAddressingMode>((entry.addr_u_v >> 4) & 0xF);
-				texel_op_.from_float4(border_clr, &entry.border_clr.r());
+				decoding_threads_.push_back(MakeSharedPtr<joiner<void> >(Context::Instance().ThreadPool()(
+					bind(&JudaTexture::TileDecodingThreadFunc, this))));
 			}
-			else
+		}
+	}
+
+	void JudaTexture::StopDecodingThreads()
+	{
+		if (!decoding_threads_.empty())
+		{
 			{
-				addr_u = TAM_Clamp;
-				addr_v = TAM_Clamp;
-				border_clr[0] = border_clr[1] = border_clr[2] = border_clr[3] = 0;
+				lock_guard<mutex> lock(request_mutex_);
+				quit_ = true;
 			}
+			request_cond_.notify_all();
 
-			if (tile_info_map_.size() < num_cache_total_tiles)
+			for (size_t i = 0; i < decoding_threads_.size(); ++ i)
 			{
-				// Still has space in cache
+				(*decoding_threads_[i])();
+			}
+			decoding_threads_.clear();
+		}
+	}
+
+	void JudaTexture::TileDecodingThreadFunc()
+	{
+		// Each thread owns a codec, the encoders keep scratch state
+		TexCompressionPtr codec = tex_codec_ ? CreateTileCodec(tex_a_tile_cache_->Format()) : TexCompressionPtr();
 
-				uint32_t const s = tile_free_list_.front().first;
-				tile_info.z = s / num_cache_tiles_a_layer;
-				tile_info.y = (s - tile_info.z * num_cache_tiles_a_layer) / num_cache_tiles_a_row;
-				tile_info.x = s - tile_info.z * num_cache_tiles_a_layer - tile_info.y * num_cache_tiles_a_row;
+		std::vector<TileRequest> requests;
+		std::vector<DecodedTile> tiles;
+		for (;;)
+		{
+			{
+				unique_lock<mutex> lock(request_mutex_);
+				while (!quit_ && tile_requests_.empty())
+				{
+					request_cond_.wait(lock);
+				}
+				if (quit_)
+				{
+					break;
+				}
 
-				++ tile_free_list_.front().first;
-				if (tile_free_list_.front().first == tile_free_list_.front().second)
+				// A small batch shares the decoding of the common neighbors, and still spreads over the threads
+				requests.clear();
+				while (!tile_requests_.empty() && (requests.size() < TILE_DECODING_BATCH))
 				{
-					tile_free_list_.pop_front();
+					requests.push_back(tile_requests_.front());
+					tile_requests_.pop_front();
 				}
 			}
-			else
+
+			this->DecodeTileRequests(tiles, requests, codec);
+
 			{
-				// Find tiles that are not used for the longest time
+				lock_guard<mutex> lock(decoded_mutex_);
+				for (size_t i = 0; i < tiles.size(); ++ i)
+				{
+					decoded_tiles_.push_back(DecodedTile());
+					decoded_tiles_.back().tile_id = tiles[i].tile_id;
+					decoded_tiles_.back().attr = tiles[i].attr;
+					decoded_tiles_.back().mips.swap(tiles[i].mips);
+				}
+			}
+			decoded_cond_.notify_all();
+		}
+	}
+
+	void JudaTexture::PrefetchTiles(std::vector<uint32_t> const & tile_ids)
+	{
+		// Bounding box of the requested tiles in each level
+		array<int32_t, MAX_TREE_LEVEL + 1> min_x, min_y, max_x, max_y;
+		min_x.fill(std::numeric_limits<int32_t>::max());
+		min_y.fill(std::numeric_limits<int32_t>::max());
+		max_x.fill(-1);
+		max_y.fill(-1);
+		for (size_t i = 0; i < tile_ids.size(); ++ i)
+		{
+			uint32_t level, tile_x, tile_y;
+			this->DecodeTileID(level, tile_x, tile_y, tile_ids[i]);
+			min_x[level] = std::min(min_x[level], static_cast<int32_t>(tile_x));
+			min_y[level] = std::min(min_y[level], static_cast<int32_t>(tile_y));
+			max_x[level] = std::max(max_x[level], static_cast<int32_t>(tile_x));
+			max_y[level] = std::max(max_y[level], static_cast<int32_t>(tile_y));
+		}
+
+		size_t num_queued;
+		{
+			lock_guard<mutex> lock(request_mutex_);
+			num_queued = tile_requests_.size();
+		}
+
+		std::vector<TileRequest> requests;
+		for (uint32_t level = 0; level <= MAX_TREE_LEVEL; ++ level)
+		{
+			LevelView& view = level_views_[level];
+			if (max_x[level] < 0)
+			{
+				view.valid = false;
+				continue;
+			}
+
+			// Centers are kept in doubled coordinates to stay in integers
+			int32_t const center_x2 = min_x[level] + max_x[level];
+			int32_t const center_y2 = min_y[level] + max_y[level];
+			int32_t dx = 0;
+			int32_t dy = 0;
+			if (view.valid)
+			{
+				dx = (center_x2 > view.center_x2) ? 1 : ((center_x2 < view.center_x2) ? -1 : 0);
+				dy = (center_y2 > view.center_y2) ? 1 : ((center_y2 < view.center_y2) ? -1 : 0);
+			}
+			view.center_x2 = center_x2;
+			view.center_y2 = center_y2;
+			view.valid = true;
+
+			if ((0 == dx) && (0 == dy))
+			{
+				continue;
+			}
 
-				uint64_t min_tick = tim.begin()->second.tick;
-				KLAYGE_AUTO(min_tileiter, tim.begin());
-				for (KLAYGE_AUTO(tileiter, tim.begin()); tileiter != tim.end(); ++ tileiter)
+			// The leading edge in the direction of motion is the next to be visible
+			int32_t const edge_x = (dx > 0) ? max_x[level] + 1 : min_x[level] - 1;
+			int32_t const edge_y = (dy > 0) ? max_y[level] + 1 : min_y[level] - 1;
+			for (int32_t y = min_y[level] - 1; y <= max_y[level] + 1; ++ y)
+			{
+				for (int32_t x = min_x[level] - 1; x <= max_x[level] + 1; ++ x)
 				{
-					if (tileiter->second.tick < min_tick)
+					if (num_queued + requests.size() >= MAX_PREFETCH_QUEUE_LENGTH)
+					{
+						break;
+					}
+
+					if (((dx != 0) && (x == edge_x)) || ((dy != 0) && (y == edge_y)))
 					{
-						min_tick = tileiter->second.tick;
-						min_tileiter = tileiter;
+						if ((x >= 0) && (y >= 0) && (x < static_cast<int32_t>(num_tiles_)) && (y < static_cast<int32_t>(num_tiles_)))
+						{
+							uint32_t const tile_id = this->EncodeTileID(level, x, y);
+							if ((tile_info_map_.find(tile_id) == tile_info_map_.end())
+								&& (pending_tiles_.find(tile_id) == pending_tiles_.end())
+								&& (this->DecodeAAttr(this->Pos2Shuff(level, x, y)) != 0xFFFFFFFF))
+							{
+								requests.push_back(TileRequest());
+								this->MakeTileRequest(requests.back(), tile_id);
+								pending_tiles_.insert(tile_id);
+							}
+						}
 					}
 				}
+			}
+		}
 
-				tile_info.x = min_tileiter->second.x;
-				tile_info.y = min_tileiter->second.y;
-				tile_info.z = min_tileiter->second.z;
+		if (!requests.empty())
+		{
+			lock_guard<mutex> lock(request_mutex_);
+			tile_requests_.insert(tile_requests_.end(), requests.begin(), requests.end());
+		}
+	}
 
-				for (KLAYGE_AUTO(tileiter, tim.begin()); tileiter != tim.end();)
+	void JudaTexture::UploadDecodedTiles(uint32_t max_num)
+	{
+		std::vector<DecodedTile> tiles;
+		{
+			lock_guard<mutex> lock(decoded_mutex_);
+			while (!decoded_tiles_.empty() && (tiles.size() < max_num))
+			{
+				tiles.push_back(DecodedTile());
+				tiles.back().tile_id = decoded_tiles_.front().tile_id;
+				tiles.back().attr = decoded_tiles_.front().attr;
+				tiles.back().mips.swap(decoded_tiles_.front().mips);
+				decoded_tiles_.pop_front();
+			}
+		}
+
+		for (size_t i = 0; i < tiles.size(); ++ i)
+		{
+			pending_tiles_.erase(tiles[i].tile_id);
+			if (tile_info_map_.find(tiles[i].tile_id) == tile_info_map_.end())
+			{
+				this->UploadATile(tiles[i]);
+			}
+		}
+	}
+
+	void JudaTexture::MakeTileRequest(TileRequest& request, uint32_t tile_id)
+	{
+		uint32_t level, tile_x, tile_y;
+		this->DecodeTileID(level, tile_x, tile_y, tile_id);
+
+		request.tile_id = tile_id;
+
+		request.neighbor_ids.fill(0xFFFFFFFF);
+		request.neighbor_ids[0] = tile_id;
+
+		request.in_same_image.fill(false);
+		request.in_same_image[0] = true;
+
+		request.attr = this->DecodeAAttr(this->Pos2Shuff(level, tile_x, tile_y));
+		if (request.attr != 0xFFFFFFFF)
+		{
+			array<int32_t, 9> new_tile_id_x;
+			array<int32_t, 9> new_tile_id_y;
+
+			int32_t left = tile_x - 1;
+			int32_t right = tile_x + 1;
+			int32_t up = tile_y - 1;
+			int32_t down = tile_y + 1;
+
+			ImageEntry const & entry = image_entries_[request.attr];
+			if (TAM_Wrap == (entry.addr_u_v & 0xF))
+			{
+				left = entry.x + (left - entry.x + entry.w) % entry.w;
+				right = entry.x + (right - entry.x + entry.w) % entry.w;
+			}
+			if (TAM_Wrap == ((entry.addr_u_v >> 4) & 0xF))
+			{
+				up = entry.y + (up - entry.y + entry.h) % entry.h;
+				down = entry.y + (down - entry.y + entry.h) % entry.h;
+			}
+
+			new_tile_id_x[1] = left;
+			new_tile_id_y[1] = up;
+			new_tile_id_x[2] = tile_x;
+			new_tile_id_y[2] = up;
+			new_tile_id_x[3] = right;
+			new_tile_id_y[3] = up;
+
+			new_tile_id_x[4] = left;
+			new_tile_id_y[4] = tile_y;
+			new_tile_id_x[5] = right;
+			new_tile_id_y[5] = tile_y;
+
+			new_tile_id_x[6] = left;
+			new_tile_id_y[6] = down;
+			new_tile_id_x[7] = tile_x;
+			new_tile_id_y[7] = down;
+			new_tile_id_x[8] = right;
+			new_tile_id_y[8] = down;
+
+			for (int j = 1; j < 9; ++ j)
+			{
+				if ((new_tile_id_x[j] >= 0) && (new_tile_id_y[j] >= 0)
+					&& (new_tile_id_x[j] < static_cast<int32_t>(num_tiles_) - 1)
+					&& (new_tile_id_y[j] < static_cast<int32_t>(num_tiles_) - 1))
 				{
-					if (tileiter->second.tick == min_tick)
+					request.neighbor_ids[j] = this->EncodeTileID(level, new_tile_id_x[j], new_tile_id_y[j]);
+					if (request.neighbor_ids[j] != 0xFFFFFFFF)
 					{
-						uint32_t const id = tileiter->second.z * num_cache_tiles_a_layer + tileiter->second.y * num_cache_tiles_a_row + tileiter->second.x;
-						KLAYGE_AUTO(freeiter, tile_free_list_.begin());
-						while ((freeiter != tile_free_list_.end()) && (freeiter->second <= id))
+						if (request.attr == this->DecodeAAttr(this->Pos2Shuff(level, new_tile_id_x[j], new_tile_id_y[j])))
 						{
-							++ freeiter;
+							request.in_same_image[j] = true;
 						}
-						tile_free_list_.insert(freeiter, std::make_pair(id, id + 1));
-
-						tileiter = tim.erase(tileiter);
-					}
-					else
-					{
-						 ++ tileiter;
 					}
 				}
-				for (KLAYGE_AUTO(freeiter, tile_free_list_.begin()); freeiter != tile_free_list_.end() - 1;)
+				else
 				{
-					KLAYGE_AUTO(nextiter, freeiter);
-					++ nextiter;
+					request.neighbor_ids[j] = 0xFFFFFFFF;
+				}
+			}
+		}
+	}
 
-					if (freeiter->second == nextiter->first)
-					{
-						freeiter->second = nextiter->second;
-						freeiter = tile_free_list_.erase(nextiter);
-						-- freeiter;
-					}
-					else
-					{
-						++ freeiter;
-					}
+	void JudaTexture::DecodeTileRequests(std::vector<DecodedTile>& tiles, std::vector<TileRequest> const & requests,
+		TexCompressionPtr const & codec)
+	{
+		tiles.resize(requests.size());
+		if (requests.empty())
+		{
+			return;
+		}
+
+		uint32_t const tile_with_border_size = cache_tile_size_ + cache_tile_border_size_ * 2;
+		uint32_t const mipmaps = tex_a_tile_cache_->NumMipMaps();
+		ElementFormat const format = tex_a_tile_cache_->Format();
+
+		unordered_map<uint32_t, uint32_t> neighbor_id_map;
+		std::vector<uint32_t> neighbor_ids;
+		for (size_t i = 0; i < requests.size(); ++ i)
+		{
+			for (size_t j = 0; j < requests[i].neighbor_ids.size(); ++ j)
+			{
+				uint32_t const id = requests[i].neighbor_ids[j];
+				if ((id != 0xFFFFFFFF) && (neighbor_id_map.find(id) == neighbor_id_map.end()))
+				{
+					neighbor_id_map.insert(std::make_pair(id, static_cast<uint32_t>(neighbor_ids.size())));
+					neighbor_ids.push_back(id);
 				}
 			}
+		}
+
+		std::vector<std::vector<uint8_t> > neighbor_data;
+		this->DecodeTiles(neighbor_data, neighbor_ids, mipmaps);
+
+		for (size_t i = 0; i < requests.size(); ++ i)
+		{
+			TileRequest const & request = requests[i];
+			DecodedTile& tile = tiles[i];
+			tile.tile_id = request.tile_id;
+			tile.attr = request.attr;
+			tile.mips.resize(mipmaps);
+
+			uint8_t border_clr[4];
+			TexAddressingMode addr_u, addr_v;
+			if (request.attr != 0xFFFFFFFF)
+			{
+				ImageEntry const & entry = image_entries_[request.attr];
+				addr_u = static_cast<TexAddressingMode>(entry.addr_u_v & 0xF);
+				addr_v = static_cast<TexAddressingMode>((entry.addr_u_v >> 4) & 0xF);
+				texel_op_.from_float4(border_clr, &entry.border_clr.r());
+			}
+			else
+			{
+				addr_u = TAM_Clamp;
+				addr_v = TAM_Clamp;
+				border_clr[0] = border_clr[1] = border_clr[2] = border_clr[3] = 0;
+			}
 
 			array<uint32_t, 9> index_with_neighbors;
 			for (size_t j = 0; j < index_with_neighbors.size(); ++ j)
 			{
-				if (all_neighbor_ids[i + j] != 0xFFFFFFFF)
+				if (request.neighbor_ids[j] != 0xFFFFFFFF)
 				{
-					BOOST_ASSERT(neighbor_id_map.find(all_neighbor_ids[i + j]) != neighbor_id_map.end());
+					BOOST_ASSERT(neighbor_id_map.find(request.neighbor_ids[j]) != neighbor_id_map.end());
 
-					index_with_neighbors[j] = neighbor_id_map[all_neighbor_ids[i + j]];
+					index_with_neighbors[j] = neighbor_id_map[request.neighbor_ids[j]];
 				}
 				else
 				{
@@ -1539,7 +1825,7 @@ namespace KlayGE
 							neighbor_data_ptr[0] + y * mip_tile_size * texel_size_, mip_tile_size);
 					}
 
-					if ((neighbor_data_ptr[1] != nullptr) && in_same_image[i + 1])
+					if ((neighbor_data_ptr[1] != nullptr) && request.in_same_image[1])
 					{
 						for (uint32_t y = 0; y < mip_border_size; ++ y)
 						{
@@ -1550,7 +1836,7 @@ namespace KlayGE
 					}
 					else
 					{
-						if (tile_info.attr != 0xFFFFFFFF)
+						if (request.attr != 0xFFFFFFFF)
 						{
 							std::vector<int32_t> border_coords_x(mip_border_size * mip_border_size);
 							std::vector<int32_t> border_coords_y(mip_border_size * mip_border_size);
@@ -1655,7 +1941,7 @@ namespace KlayGE
 							}
 						}
 					}
-					if ((neighbor_data_ptr[2] != nullptr) && in_same_image[i + 2])
+					if ((neighbor_data_ptr[2] != nullptr) && request.in_same_image[2])
 					{
 						for (uint32_t y = 0; y < mip_border_size; ++ y)
 						{
@@ -1665,7 +1951,7 @@ namespace KlayGE
 					}
 					else
 					{
-						if (tile_info.attr != 0xFFFFFFFF)
+						if (request.attr != 0xFFFFFFFF)
 						{
 							std::vector<int32_t> border_coords_x(mip_tile_size * mip_border_size);
 							std::vector<int32_t> border_coords_y(mip_tile_size * mip_border_size);
@@ -1767,7 +2053,7 @@ namespace KlayGE
 							}
 						}
 					}
-					if ((neighbor_data_ptr[3] != nullptr) && in_same_image[i + 3])
+					if ((neighbor_data_ptr[3] != nullptr) && request.in_same_image[3])
 					{
 						for (uint32_t y = 0; y < mip_border_size; ++ y)
 						{
@@ -1777,7 +2063,7 @@ namespace KlayGE
 					}
 					else
 					{
-						if (tile_info.attr != 0xFFFFFFFF)
+						if (request.attr != 0xFFFFFFFF)
 						{
 							std::vector<int32_t> border_coords_x(mip_border_size * mip_border_size);
 							std::vector<int32_t> border_coords_y(mip_border_size * mip_border_size);
@@ -1883,7 +2169,7 @@ namespace KlayGE
 						}
 					}
 
-					if ((neighbor_data_ptr[4] != nullptr) && in_same_image[i + 4])
+					if ((neighbor_data_ptr[4] != nullptr) && request.in_same_image[4])
 					{
 						for (uint32_t y = 0; y < mip_tile_size; ++ y)
 						{
@@ -1893,7 +2179,7 @@ namespace KlayGE
 					}
 					else
 					{
-						if (tile_info.attr != 0xFFFFFFFF)
+						if (request.attr != 0xFFFFFFFF)
 						{
 							std::vector<int32_t> border_coords_x(mip_border_size * mip_tile_size);
 							std::vector<int32_t> border_coords_y(mip_border_size * mip_tile_size);
@@ -1998,7 +2284,7 @@ namespace KlayGE
 							}
 						}
 					}
-					if ((neighbor_data_ptr[5] != nullptr) && in_same_image[i + 5])
+					if ((neighbor_data_ptr[5] != nullptr) && request.in_same_image[5])
 					{
 						for (uint32_t y = 0; y < mip_tile_size; ++ y)
 						{
@@ -2008,7 +2294,7 @@ namespace KlayGE
 					}
 					else
 					{
-						if (tile_info.attr != 0xFFFFFFFF)
+						if (request.attr != 0xFFFFFFFF)
 						{
 							std::vector<int32_t> border_coords_x(mip_border_size * mip_tile_size);
 							std::vector<int32_t> border_coords_y(mip_border_size * mip_tile_size);
@@ -2114,7 +2400,7 @@ namespace KlayGE
 						}
 					}
 
-					if ((neighbor_data_ptr[6] != nullptr) && in_same_image[i + 6])
+					if ((neighbor_data_ptr[6] != nullptr) && request.in_same_image[6])
 					{
 						for (uint32_t y = 0; y < mip_border_size; ++ y)
 						{
@@ -2124,7 +2410,7 @@ namespace KlayGE
 					}
 					else
 					{
-						if (tile_info.attr != 0xFFFFFFFF)
+						if (request.attr != 0xFFFFFFFF)
 						{
 							std::vector<int32_t> border_coords_x(mip_border_size * mip_border_size);
 							std::vector<int32_t> border_coords_y(mip_border_size * mip_border_size);
@@ -2229,7 +2515,7 @@ namespace KlayGE
 							}
 						}
 					}
-					if ((neighbor_data_ptr[7] != nullptr) && in_same_image[i + 7])
+					if ((neighbor_data_ptr[7] != nullptr) && request.in_same_image[7])
 					{
 						for (uint32_t y = 0; y < mip_border_size; ++ y)
 						{
@@ -2239,7 +2525,7 @@ namespace KlayGE
 					}
 					else
 					{
-						if (tile_info.attr != 0xFFFFFFFF)
+						if (request.attr != 0xFFFFFFFF)
 						{
 							std::vector<int32_t> border_coords_x(mip_tile_size * mip_border_size);
 							std::vector<int32_t> border_coords_y(mip_tile_size * mip_border_size);
@@ -2341,7 +2627,7 @@ namespace KlayGE
 							}
 						}
 					}			
-					if ((neighbor_data_ptr[8] != nullptr) && in_same_image[i + 8])
+					if ((neighbor_data_ptr[8] != nullptr) && request.in_same_image[8])
 					{
 						for (uint32_t y = 0; y < mip_border_size; ++ y)
 						{
@@ -2351,7 +2637,7 @@ namespace KlayGE
 					}
 					else
 					{
-						if (tile_info.attr != 0xFFFFFFFF)
+						if (request.attr != 0xFFFFFFFF)
 						{
 							std::vector<int32_t> border_coords_x(mip_border_size * mip_border_size);
 							std::vector<int32_t> border_coords_y(mip_border_size * mip_border_size);
@@ -2458,24 +2744,15 @@ namespace KlayGE
 					}
 				}
 
-				ElementFormat format;
-				if (tex_cache_)
-				{
-					format = tex_cache_->Format();
-				}
-				else
-				{
-					format = tex_cache_array_[tile_info.z]->Format();
-				}
-
 				if (IsCompressedFormat(format))
 				{
-					uint32_t const block_width = tex_codec_->BlockWidth();
-					uint32_t const block_height = tex_codec_->BlockHeight();
+					uint32_t const block_width = codec->BlockWidth();
+					uint32_t const block_height = codec->BlockHeight();
 					uint32_t const block_bytes = NumFormatBytes(format) * 4;
 					uint32_t const bc_row_pitch = (mip_tile_with_border_size + block_width - 1) / block_width * block_bytes;
 					uint32_t const bc_slice_pitch = (mip_tile_with_border_size + block_height - 1) / block_height * bc_row_pitch;
-					std::vector<uint8_t> bc(bc_slice_pitch);
+					std::vector<uint8_t>& bc = tile.mips[l];
+					bc.resize(bc_slice_pitch);
 					{
 						uint8_t const * data_with_border = &tex_a_tile_data[0];
 						uint32_t const data_row_pitch = mip_tile_with_border_size * texel_size_;
@@ -2553,78 +2830,137 @@ namespace KlayGE
 							break;
 						}
 
-						tex_codec_->EncodeMem(mip_tile_with_border_size, mip_tile_with_border_size,
-							&bc[0], bc_row_pitch, bc_slice_pitch, p_argb, row_pitch, slice_pitch, TCM_Quality);
-					}
-					{
-						Texture::Mapper mapper(*tex_a_tile_cache_, 0, l, TMA_Write_Only,
-							0, 0, mip_tile_with_border_size, mip_tile_with_border_size);
-
-						uint8_t const * src = &bc[0];
-						uint32_t const src_pitch = bc_row_pitch;
-
-						uint8_t* dst = mapper.Pointer<uint8_t>();
-						uint32_t const dst_pitch = mapper.RowPitch();
-
-						for (uint32_t y = 0; y < (mip_tile_with_border_size + block_height - 1) / block_height; ++ y)
-						{
-							std::memcpy(dst, src, src_pitch);
-							src += src_pitch;
-							dst += dst_pitch;
-						}
+						codec->EncodeMem(mip_tile_with_border_size, mip_tile_with_border_size,
+							&bc[0], bc_row_pitch, bc_slice_pitch, p_argb, row_pitch, slice_pitch, TCM_Speed);
 					}
 				}
 				else
 				{
-					Texture::Mapper mapper(*tex_a_tile_cache_, 0, l, TMA_Write_Only,
-						0, 0, mip_tile_with_border_size, mip_tile_with_border_size);
+					tile.mips[l].swap(tex_a_tile_data);
+				}
 
-					uint8_t const * src = &tex_a_tile_data[0];
-					uint32_t const src_pitch = mip_tile_with_border_size * texel_size_;
+				mip_tile_size /= 2;
+				mip_tile_with_border_size /= 2;
+				mip_border_size /= 2;
+			}
+		}
+	}
 
-					uint8_t* dst = mapper.Pointer<uint8_t>();
-					uint32_t const dst_pitch = mapper.RowPitch();
+	void JudaTexture::UploadATile(DecodedTile const & tile)
+	{
+		uint32_t const tex_width = tex_cache_ ? tex_cache_->Width(0) : tex_cache_array_[0]->Width(0);
+		uint32_t const tex_height = tex_cache_ ? tex_cache_->Height(0) : tex_cache_array_[0]->Height(0);
+		uint32_t const tex_layer = tex_cache_ ? tex_cache_->ArraySize() : static_cast<uint32_t>(tex_cache_array_.size());
+		uint32_t const tile_with_border_size = cache_tile_size_ + cache_tile_border_size_ * 2;
 
-					for (uint32_t y = 0; y < mip_tile_with_border_size; ++ y)
-					{
-						std::memcpy(dst, src, src_pitch);
-						src += src_pitch;
-						dst += dst_pitch;
-					}
-				}
+		uint32_t const num_cache_tiles_a_row = tex_width / tile_with_border_size;
+		uint32_t const num_cache_tiles_a_layer = num_cache_tiles_a_row * tex_height / tile_with_border_size;
+		uint32_t const num_cache_total_tiles = num_cache_tiles_a_layer * tex_layer;
 
-				if (tex_cache_)
-				{
-					tex_a_tile_cache_->CopyToSubTexture2D(*tex_cache_,
-						tile_info.z, l, tile_info.x * mip_tile_with_border_size, tile_info.y * mip_tile_with_border_size, mip_tile_with_border_size, mip_tile_with_border_size,
-						0, l, 0, 0, mip_tile_with_border_size, mip_tile_with_border_size);
-				}
-				else
+		KLAYGE_AUTO(&tim, tile_info_map_);
+
+		TileInfo tile_info;
+		tile_info.attr = tile.attr;
+		if (tile_info_map_.size() < num_cache_total_tiles)
+		{
+			// Still has space in cache
+
+			uint32_t const s = tile_free_list_.front().first;
+			tile_info.z = s / num_cache_tiles_a_layer;
+			tile_info.y = (s - tile_info.z * num_cache_tiles_a_layer) / num_cache_tiles_a_row;
+			tile_info.x = s - tile_info.z * num_cache_tiles_a_layer - tile_info.y * num_cache_tiles_a_row;
+
+			++ tile_free_list_.front().first;
+			if (tile_free_list_.front().first == tile_free_list_.front().second)
+			{
+				tile_free_list_.pop_front();
+			}
+		}
+		else
+		{
+			// Reuse the slot of the least recently used tile
+
+			uint32_t const lru_id = tile_lru_.back();
+			KLAYGE_AUTO(lru_iter, tim.find(lru_id));
+			BOOST_ASSERT(lru_iter != tim.end());
+
+			tile_info.x = lru_iter->second.x;
+			tile_info.y = lru_iter->second.y;
+			tile_info.z = lru_iter->second.z;
+
+			tim.erase(lru_iter);
+			tile_lru_.pop_back();
+			++ tile_cache_stat_.evictions;
+		}
+
+		uint32_t const mipmaps = tex_a_tile_cache_->NumMipMaps();
+		uint32_t mip_tile_with_border_size = tile_with_border_size;
+		for (uint32_t l = 0; l < mipmaps; ++ l)
+		{
+			uint32_t rows;
+			uint32_t row_bytes;
+			if (tex_codec_)
+			{
+				uint32_t const block_width = tex_codec_->BlockWidth();
+				uint32_t const block_height = tex_codec_->BlockHeight();
+				uint32_t const block_bytes = NumFormatBytes(tex_a_tile_cache_->Format()) * 4;
+				rows = (mip_tile_with_border_size + block_height - 1) / block_height;
+				row_bytes = (mip_tile_with_border_size + block_width - 1) / block_width * block_bytes;
+			}
+			else
+			{
+				rows = mip_tile_with_border_size;
+				row_bytes = mip_tile_with_border_size * texel_size_;
+			}
+			BOOST_ASSERT(tile.mips[l].size() == rows * row_bytes);
+
+			{
+				Texture::Mapper mapper(*tex_a_tile_cache_, 0, l, TMA_Write_Only,
+					0, 0, mip_tile_with_border_size, mip_tile_with_border_size);
+
+				uint8_t const * src = &tile.mips[l][0];
+				uint8_t* dst = mapper.Pointer<uint8_t>();
+				uint32_t const dst_pitch = mapper.RowPitch();
+
+				for (uint32_t y = 0; y < rows; ++ y)
 				{
-					tex_a_tile_cache_->CopyToSubTexture2D(*tex_cache_array_[tile_info.z],
-						0, l, tile_info.x * mip_tile_with_border_size, tile_info.y * mip_tile_with_border_size, mip_tile_with_border_size, mip_tile_with_border_size,
-						0, l, 0, 0, mip_tile_with_border_size, mip_tile_with_border_size);
+					std::memcpy(dst, src, row_bytes);
+					src += row_bytes;
+					dst += dst_pitch;
 				}
+			}
 
-				mip_tile_size /= 2;
-				mip_tile_with_border_size /= 2;
-				mip_border_size /= 2;
+			if (tex_cache_)
+			{
+				tex_a_tile_cache_->CopyToSubTexture2D(*tex_cache_,
+					tile_info.z, l, tile_info.x * mip_tile_with_border_size, tile_info.y * mip_tile_with_border_size, mip_tile_with_border_size, mip_tile_with_border_size,
+					0, l, 0, 0, mip_tile_with_border_size, mip_tile_with_border_size);
 			}
+			else
 			{
-				Texture::Mapper mapper(*tex_a_tile_indirect_, 0, 0, TMA_Write_Only, 0, 0, 1, 1);
-				uint8_t* p = mapper.Pointer<uint8_t>();
-				p[0] = static_cast<uint8_t>(tile_info.x);
-				p[1] = static_cast<uint8_t>(tile_info.y);
-				p[2] = static_cast<uint8_t>(tile_info.z);
+				tex_a_tile_cache_->CopyToSubTexture2D(*tex_cache_array_[tile_info.z],
+					0, l, tile_info.x * mip_tile_with_border_size, tile_info.y * mip_tile_with_border_size, mip_tile_with_border_size, mip_tile_with_border_size,
+					0, l, 0, 0, mip_tile_with_border_size, mip_tile_with_border_size);
 			}
 
-			uint32_t level, tile_x, tile_y;
-			this->DecodeTileID(level, tile_x, tile_y, all_neighbor_ids[i]);
-			tex_a_tile_indirect_->CopyToSubTexture2D(*tex_indirect_,
-				0, 0, tile_x, tile_y, 1, 1,
-				0, 0, 0, 0, 1, 1);
-
-			tim.insert(std::make_pair(all_neighbor_ids[i], tile_info));
+			mip_tile_with_border_size /= 2;
+		}
+		{
+			Texture::Mapper mapper(*tex_a_tile_indirect_, 0, 0, TMA_Write_Only, 0, 0, 1, 1);
+			uint8_t* p = mapper.Pointer<uint8_t>();
+			p[0] = static_cast<uint8_t>(tile_info.x);
+			p[1] = static_cast<uint8_t>(tile_info.y);
+			p[2] = static_cast<uint8_t>(tile_info.z);
 		}
+
+		uint32_t level, tile_x, tile_y;
+		this->DecodeTileID(level, tile_x, tile_y, tile.tile_id);
+		tex_a_tile_indirect_->CopyToSubTexture2D(*tex_indirect_,
+			0, 0, tile_x, tile_y, 1, 1,
+			0, 0, 0, 0, 1, 1);
+
+		tile_lru_.push_front(tile.tile_id);
+		tile_info.lru_iter = tile_lru_.begin();
+		tim.insert(std::make_pair(tile.tile_id, tile_info));
 	}
 }
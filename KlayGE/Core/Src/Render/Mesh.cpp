@@ -46,7 +46,7 @@ namespace
 {
 	using namespace KlayGE;
 
-	uint32_t const MODEL_BIN_VERSION = 9;
+	uint32_t const MODEL_BIN_VERSION = 11;
 
 	class RenderModelLoadingDesc : public ResLoadingDesc
 	{
@@ -73,6 +73,8 @@ namespace
 				std::vector<uint32_t> mesh_base_vertices;
 				std::vector<uint32_t> mesh_num_indices;
 				std::vector<uint32_t> mesh_start_indices;
+				std::vector<std::vector<uint32_t> > mesh_lod_num_indices;
+				std::vector<std::vector<uint32_t> > mesh_lod_start_indices;
 				std::vector<Joint> joints;
 				shared_ptr<AnimationActionsType> actions;
 				shared_ptr<KeyFramesType> kfs;
@@ -118,6 +120,7 @@ namespace
 				model_desc_.model_data->pos_bbs, model_desc_.model_data->tc_bbs,
 				model_desc_.model_data->mesh_num_vertices, model_desc_.model_data->mesh_base_vertices,
 				model_desc_.model_data->mesh_num_indices, model_desc_.model_data->mesh_start_indices, 
+				model_desc_.model_data->mesh_lod_num_indices, model_desc_.model_data->mesh_lod_start_indices,
 				model_desc_.model_data->joints, model_desc_.model_data->actions, model_desc_.model_data->kfs,
 				model_desc_.model_data->num_frames, model_desc_.model_data->frame_rate,
 				model_desc_.model_data->frame_pos_bbs);
@@ -212,9 +215,13 @@ namespace
 					mesh->AddIndexStream(rhs_rl->GetIndexStream(), rhs_rl->IndexStreamFormat());
 
 					mesh->NumVertices(rhs_mesh->NumVertices());
-					mesh->NumTriangles(rhs_mesh->NumTriangles());
+					mesh->NumTriangles(rhs_mesh->LodNumTriangles(0));
 					mesh->StartVertexLocation(rhs_mesh->StartVertexLocation());
-					mesh->StartIndexLocation(rhs_mesh->StartIndexLocation());
+					mesh->StartIndexLocation(rhs_mesh->LodStartIndexLocation(0));
+					for (int32_t lod = 1; lod < static_cast<int32_t>(rhs_mesh->NumLods()); ++ lod)
+					{
+						mesh->AddLod(rhs_mesh->LodNumTriangles(lod), rhs_mesh->LodStartIndexLocation(lod));
+					}
 				}
 
 				BOOST_ASSERT(model->IsSkinned() == rhs_model->IsSkinned());
@@ -285,6 +292,7 @@ namespace
 				init_data.row_pitch = static_cast<uint32_t>(model_desc_.model_data->merged_buff[i].size());
 				init_data.slice_pitch = 0;
 				merged_vbs[i] = rf.MakeVertexBuffer(BU_Static, model_desc_.access_hint, &init_data);
+				merged_vbs[i]->TrackingTag(MT_Model);
 			}
 
 			GraphicsBufferPtr merged_ib;
@@ -293,6 +301,7 @@ namespace
 				init_data.row_pitch = static_cast<uint32_t>(model_desc_.model_data->merged_indices.size());
 				init_data.slice_pitch = 0;
 				merged_ib = rf.MakeIndexBuffer(BU_Static, model_desc_.access_hint, &init_data);
+				merged_ib->TrackingTag(MT_Model);
 			}
 
 			std::vector<StaticMeshPtr> meshes(model_desc_.model_data->mesh_names.size());
@@ -318,6 +327,11 @@ namespace
 				mesh->NumTriangles(model_desc_.model_data->mesh_num_indices[mesh_index] / 3);
 				mesh->StartVertexLocation(model_desc_.model_data->mesh_base_vertices[mesh_index]);
 				mesh->StartIndexLocation(model_desc_.model_data->mesh_start_indices[mesh_index]);
+				for (size_t lod = 0; lod < model_desc_.model_data->mesh_lod_num_indices[mesh_index].size(); ++ lod)
+				{
+					mesh->AddLod(model_desc_.model_data->mesh_lod_num_indices[mesh_index][lod] / 3,
+						model_desc_.model_data->mesh_lod_start_indices[mesh_index][lod]);
+				}
 			}
 
 			if (model_desc_.model_data->kfs && !model_desc_.model_data->kfs->empty())
@@ -406,6 +420,27 @@ namespace KlayGE
 		}
 	}
 
+	uint32_t RenderModel::NumLods() const
+	{
+		uint32_t num_lods = 1;
+		typedef KLAYGE_DECLTYPE(subrenderables_) MeshesType;
+		KLAYGE_FOREACH(MeshesType::const_reference mesh, subrenderables_)
+		{
+			num_lods = std::max(num_lods, mesh->NumLods());
+		}
+		return num_lods;
+	}
+
+	void RenderModel::ActiveLod(int32_t lod)
+	{
+		Renderable::ActiveLod(lod);
+		typedef KLAYGE_DECLTYPE(subrenderables_) MeshesType;
+		KLAYGE_FOREACH(MeshesType::const_reference mesh, subrenderables_)
+		{
+			mesh->ActiveLod(lod);
+		}
+	}
+
 	void RenderModel::Pass(PassType type)
 	{
 		Renderable::Pass(type);
@@ -657,6 +692,42 @@ namespace KlayGE
 		rl_->BindIndexStream(index_stream, format);
 	}
 
+	void StaticMesh::AddLod(uint32_t num_triangles, uint32_t start_index_location)
+	{
+		if (lods_.empty())
+		{
+			BOOST_ASSERT(0 == active_lod_);
+			lods_.push_back(std::make_pair(this->NumTriangles(), this->StartIndexLocation()));
+		}
+		lods_.push_back(std::make_pair(num_triangles, start_index_location));
+	}
+
+	uint32_t StaticMesh::LodNumTriangles(int32_t lod) const
+	{
+		return lods_.empty() ? this->NumTriangles() : lods_[lod].first;
+	}
+
+	uint32_t StaticMesh::LodStartIndexLocation(int32_t lod) const
+	{
+		return lods_.empty() ? this->StartIndexLocation() : lods_[lod].second;
+	}
+
+	uint32_t StaticMesh::NumLods() const
+	{
+		return std::max(static_cast<uint32_t>(lods_.size()), 1U);
+	}
+
+	void StaticMesh::ActiveLod(int32_t lod)
+	{
+		int32_t const old_lod = active_lod_;
+		Renderable::ActiveLod(lod);
+		if (!lods_.empty() && (active_lod_ != old_lod))
+		{
+			this->NumTriangles(lods_[active_lod_].first);
+			this->StartIndexLocation(lods_[active_lod_].second);
+		}
+	}
+
 
 	std::pair<std::pair<Quaternion, Quaternion>, float> KeyFrames::Frame(float frame) const
 	{
@@ -1032,6 +1103,8 @@ namespace KlayGE
 		std::vector<AABBox>& pos_bbs, std::vector<AABBox>& tc_bbs,
 		std::vector<uint32_t>& mesh_num_vertices, std::vector<uint32_t>& mesh_base_vertices,
 		std::vector<uint32_t>& mesh_num_triangles, std::vector<uint32_t>& mesh_base_triangles,
+		std::vector<std::vector<uint32_t> >& mesh_lod_num_triangles,
+		std::vector<std::vector<uint32_t> >& mesh_lod_base_triangles,
 		std::vector<Joint>& joints, shared_ptr<AnimationActionsType>& actions,
 		shared_ptr<KeyFramesType>& kfs, uint32_t& num_frames, uint32_t& frame_rate,
 		std::vector<shared_ptr<AABBKeyFrames> >& frame_pos_bbs)
@@ -1244,6 +1317,8 @@ namespace KlayGE
 		mesh_base_vertices.resize(num_meshes);
 		mesh_num_triangles.resize(num_meshes);
 		mesh_base_triangles.resize(num_meshes);
+		mesh_lod_num_triangles.resize(num_meshes);
+		mesh_lod_base_triangles.resize(num_meshes);
 		for (uint32_t mesh_index = 0; mesh_index < num_meshes; ++ mesh_index)
 		{
 			mesh_names[mesh_index] = ReadShortString(decoded);
@@ -1282,6 +1357,20 @@ namespace KlayGE
 			mesh_num_triangles[mesh_index] = LE2Native(mesh_num_triangles[mesh_index]);
 			decoded->read(&mesh_base_triangles[mesh_index], sizeof(mesh_base_triangles[mesh_index]));
 			mesh_base_triangles[mesh_index] = LE2Native(mesh_base_triangles[mesh_index]);
+
+			uint32_t num_lods;
+			decoded->read(&num_lods, sizeof(num_lods));
+			num_lods = LE2Native(num_lods);
+			BOOST_ASSERT(num_lods >= 1);
+			mesh_lod_num_triangles[mesh_index].resize(num_lods - 1);
+			mesh_lod_base_triangles[mesh_index].resize(num_lods - 1);
+			for (uint32_t lod = 0; lod < num_lods - 1; ++ lod)
+			{
+				decoded->read(&mesh_lod_num_triangles[mesh_index][lod], sizeof(mesh_lod_num_triangles[mesh_index][lod]));
+				mesh_lod_num_triangles[mesh_index][lod] = LE2Native(mesh_lod_num_triangles[mesh_index][lod]);
+				decoded->read(&mesh_lod_base_triangles[mesh_index][lod], sizeof(mesh_lod_base_triangles[mesh_index][lod]));
+				mesh_lod_base_triangles[mesh_index][lod] = LE2Native(mesh_lod_base_triangles[mesh_index][lod]);
+			}
 		}
 
 		joints.resize(num_joints);
@@ -1869,8 +1958,8 @@ namespace KlayGE
 
 				mesh_num_vertices[mesh_index] = mesh.NumVertices();
 				mesh_base_vertices[mesh_index] = mesh.StartVertexLocation();
-				mesh_num_triangles[mesh_index] = mesh.NumTriangles();
-				mesh_base_triangles[mesh_index] =  mesh.StartIndexLocation();
+				mesh_num_triangles[mesh_index] = mesh.LodNumTriangles(0);
+				mesh_base_triangles[mesh_index] = mesh.LodStartIndexLocation(0);
 			}
 		}
 
@@ -39,6 +39,7 @@
 #include <KlayGE/ResLoader.hpp>
 #include <KFL/XMLDom.hpp>
 #include <KlayGE/DeferredRenderingLayer.hpp>
+#include <KlayGE/PerfProfiler.hpp>
 
 #include <fstream>
 
@@ -708,6 +709,8 @@ namespace KlayGE
 
 	void ParticleSystem::SubThreadUpdate(float /*app_time*/, float elapsed_time)
 	{
+		KLAYGE_PERF_SCOPE("ParticleSystem::SubThreadUpdate");
+
 		KLAYGE_AUTO(emitter_iter, emitters_.begin());
 		uint32_t new_particle = (*emitter_iter)->Update(elapsed_time);
 		
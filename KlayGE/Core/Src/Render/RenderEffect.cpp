@@ -54,8 +54,12 @@
 #include <KlayGE/ShaderObject.hpp>
 #include <KFL/XMLDom.hpp>
 #include <KFL/Thread.hpp>
+#include <KFL/CpuInfo.hpp>
+#include <KlayGE/ShaderCache.hpp>
+#include <KlayGE/ShaderCodeDependency.hpp>
 
 #include <fstream>
+#include <cstdio>
 #include <boost/assert.hpp>
 #include <boost/algorithm/string/split.hpp>
 #include <boost/algorithm/string/trim.hpp>
@@ -82,10 +86,13 @@ namespace
 {
 	using namespace KlayGE;
 
-	uint32_t const KFX_VERSION = 0x0106;
+	uint32_t const KFX_VERSION = 0x0107;
 
 	mutex singleton_mutex;
 
+	mutex warm_up_mutex;
+	std::vector<std::pair<std::string, std::string> > warm_up_techs;
+
 	class type_define
 	{
 	public:
@@ -2666,6 +2673,278 @@ namespace
 			break;
 		}
 	}
+
+	// A worker of the shader compiling stage, takes passes from the shared list until it's empty
+	class CompilePassesFunc
+	{
+	public:
+		CompilePassesFunc(std::vector<tuple<RenderPass*, uint32_t, uint32_t> > const & passes, atomic<uint32_t>& next_pass)
+			: passes_(&passes), next_pass_(&next_pass)
+		{
+		}
+
+		void operator()()
+		{
+			for (;;)
+			{
+				uint32_t const i = (*next_pass_) ++;
+				if (i >= passes_->size())
+				{
+					break;
+				}
+
+				tuple<RenderPass*, uint32_t, uint32_t> const & pass = (*passes_)[i];
+				get<0>(pass)->CompileShaders(get<1>(pass), get<2>(pass));
+			}
+		}
+
+	private:
+		std::vector<tuple<RenderPass*, uint32_t, uint32_t> > const * passes_;
+		atomic<uint32_t>* next_pass_;
+	};
+
+	// Compiles passes for hot-reloading, and keeps the reloading state alive until done
+	class ReloadPassesFunc
+	{
+	public:
+		ReloadPassesFunc(shared_ptr<void> const & state, std::vector<tuple<RenderPass*, uint32_t, uint32_t> > const & passes,
+				atomic<uint32_t>& next_pass, atomic<uint32_t>& num_finished)
+			: state_(state), passes_(&passes), next_pass_(&next_pass), num_finished_(&num_finished)
+		{
+		}
+
+		void operator()()
+		{
+			CompilePassesFunc(*passes_, *next_pass_)();
+			++ (*num_finished_);
+		}
+
+	private:
+		shared_ptr<void> state_;
+		std::vector<tuple<RenderPass*, uint32_t, uint32_t> > const * passes_;
+		atomic<uint32_t>* next_pass_;
+		atomic<uint32_t>* num_finished_;
+	};
+
+	// Everything a stage's generated code depends on, apart from the parameters
+	ShaderCacheKey StageFingerprint(RenderEffect const & effect, RenderTechnique const & tech, RenderPass const & pass,
+		ShaderDesc const & sd, ShaderCodeDependency const & code)
+	{
+		ShaderCacheKey key;
+		for (uint32_t i = 0; i < effect.NumMacros(); ++ i)
+		{
+			key.Append(effect.MacroByIndex(i).first).Append(effect.MacroByIndex(i).second);
+		}
+		key.Append(effect.NumMacros());
+		for (uint32_t i = 0; i < tech.NumMacros(); ++ i)
+		{
+			key.Append(tech.MacroByIndex(i).first).Append(tech.MacroByIndex(i).second);
+		}
+		key.Append(tech.NumMacros());
+		for (uint32_t i = 0; i < pass.NumMacros(); ++ i)
+		{
+			key.Append(pass.MacroByIndex(i).first).Append(pass.MacroByIndex(i).second);
+		}
+		key.Append(pass.NumMacros());
+		key.Append(sd.profile).Append(sd.func_name);
+		for (size_t i = 0; i < sd.so_decl.size(); ++ i)
+		{
+			ShaderDesc::StreamOutputDecl const & decl = sd.so_decl[i];
+			key.Append(static_cast<uint32_t>(decl.usage)).Append(decl.usage_index)
+				.Append(decl.start_component).Append(decl.component_count);
+		}
+		key.Append(static_cast<uint32_t>(sd.so_decl.size()));
+		code.AppendCode(key, sd.func_name);
+		return key;
+	}
+
+	template <typename T>
+	void update_default(RenderVariable& var, RenderVariable const & old_default, RenderVariable const & new_default)
+	{
+		T old_value;
+		T new_value;
+		old_default.Value(old_value);
+		new_default.Value(new_value);
+		if (!(old_value == new_value))
+		{
+			T value;
+			var.Value(value);
+			if (value == old_value)
+			{
+				var = new_value;
+			}
+		}
+	}
+
+	// Resources are left alone, they are bound by the application
+	void update_var_default(RenderVariable& var, RenderVariable const & old_default, RenderVariable const & new_default,
+		uint32_t type, bool is_array)
+	{
+		switch (type)
+		{
+		case REDT_bool:
+			if (!is_array)
+			{
+				update_default<bool>(var, old_default, new_default);
+			}
+			break;
+
+		case REDT_uint:
+			if (is_array)
+			{
+				update_default<std::vector<uint32_t> >(var, old_default, new_default);
+			}
+			else
+			{
+				update_default<uint32_t>(var, old_default, new_default);
+			}
+			break;
+
+		case REDT_int:
+			if (is_array)
+			{
+				update_default<std::vector<int32_t> >(var, old_default, new_default);
+			}
+			else
+			{
+				update_default<int32_t>(var, old_default, new_default);
+			}
+			break;
+
+		case REDT_float:
+			if (is_array)
+			{
+				update_default<std::vector<float> >(var, old_default, new_default);
+			}
+			else
+			{
+				update_default<float>(var, old_default, new_default);
+			}
+			break;
+
+		case REDT_uint2:
+			if (is_array)
+			{
+				update_default<std::vector<uint2> >(var, old_default, new_default);
+			}
+			else
+			{
+				update_default<uint2>(var, old_default, new_default);
+			}
+			break;
+
+		case REDT_uint3:
+			if (is_array)
+			{
+				update_default<std::vector<uint3> >(var, old_default, new_default);
+			}
+			else
+			{
+				update_default<uint3>(var, old_default, new_default);
+			}
+			break;
+
+		case REDT_uint4:
+			if (is_array)
+			{
+				update_default<std::vector<uint4> >(var, old_default, new_default);
+			}
+			else
+			{
+				update_default<uint4>(var, old_default, new_default);
+			}
+			break;
+
+		case REDT_int2:
+			if (is_array)
+			{
+				update_default<std::vector<int2> >(var, old_default, new_default);
+			}
+			else
+			{
+				update_default<int2>(var, old_default, new_default);
+			}
+			break;
+
+		case REDT_int3:
+			if (is_array)
+			{
+				update_default<std::vector<int3> >(var, old_default, new_default);
+			}
+			else
+			{
+				update_default<int3>(var, old_default, new_default);
+			}
+			break;
+
+		case REDT_int4:
+			if (is_array)
+			{
+				update_default<std::vector<int4> >(var, old_default, new_default);
+			}
+			else
+			{
+				update_default<int4>(var, old_default, new_default);
+			}
+			break;
+
+		case REDT_float2:
+			if (is_array)
+			{
+				update_default<std::vector<float2> >(var, old_default, new_default);
+			}
+			else
+			{
+				update_default<float2>(var, old_default, new_default);
+			}
+			break;
+
+		case REDT_float3:
+			if (is_array)
+			{
+				update_default<std::vector<float3> >(var, old_default, new_default);
+			}
+			else
+			{
+				update_default<float3>(var, old_default, new_default);
+			}
+			break;
+
+		case REDT_float4:
+			if (is_array)
+			{
+				update_default<std::vector<float4> >(var, old_default, new_default);
+			}
+			else
+			{
+				update_default<float4>(var, old_default, new_default);
+			}
+			break;
+
+		case REDT_float4x4:
+			if (is_array)
+			{
+				update_default<std::vector<float4x4> >(var, old_default, new_default);
+			}
+			else
+			{
+				update_default<float4x4>(var, old_default, new_default);
+			}
+			break;
+
+		case REDT_string:
+			update_default<std::string>(var, old_default, new_default);
+			break;
+
+		case REDT_sampler:
+			// Sampler states are pooled by their descriptions
+			update_default<SamplerStateObjectPtr>(var, old_default, new_default);
+			break;
+
+		default:
+			break;
+		}
+	}
 }
 
 namespace KlayGE
@@ -2706,7 +2985,7 @@ namespace KlayGE
 			RenderEffectPtr prototype = MakeSharedPtr<RenderEffect>();
 			prototype->Load(effect_desc_.res_name);
 			effect_desc_.effect = prototype->Clone();
-			effect_desc_.effect->PrototypeEffect(prototype);
+			this->WarmUp();
 			return static_pointer_cast<void>(effect_desc_.effect);
 		}
 
@@ -2735,12 +3014,49 @@ namespace KlayGE
 
 		shared_ptr<void> CloneResourceFrom(shared_ptr<void> const & resource)
 		{
-			RenderEffectPtr prototype = static_pointer_cast<RenderEffect>(resource)->PrototypeEffect();
-			effect_desc_.effect = prototype->Clone();
-			effect_desc_.effect->PrototypeEffect(prototype);
+			effect_desc_.effect = static_pointer_cast<RenderEffect>(resource)->PrototypeEffect()->Clone();
+			this->WarmUp();
 			return static_pointer_cast<void>(effect_desc_.effect);
 		}
 
+		void DependentFiles(std::vector<std::string>& files) const
+		{
+			if (effect_desc_.effect)
+			{
+				effect_desc_.effect->DependentFiles(files);
+			}
+		}
+
+		bool Reload(shared_ptr<void> const & resource)
+		{
+			// All the effects loaded from the same fxml share a prototype, which is reloaded only once and updates
+			//  all its clones
+			RenderEffectPtr const & prototype = static_pointer_cast<RenderEffect>(resource)->PrototypeEffect();
+			return !prototype || prototype->Reload();
+		}
+
+	private:
+		// Instantiates the warm-up techniques on the effect handed out, which instantiates them on the prototype too
+		void WarmUp()
+		{
+			std::vector<std::string> tech_names;
+			{
+				lock_guard<mutex> lock(warm_up_mutex);
+				for (size_t i = 0; i < warm_up_techs.size(); ++ i)
+				{
+					if (warm_up_techs[i].first == effect_desc_.res_name)
+					{
+						tech_names.push_back(warm_up_techs[i].second);
+					}
+				}
+			}
+
+			for (size_t i = 0; i < tech_names.size(); ++ i)
+			{
+				effect_desc_.effect->TechniqueByName(tech_names[i]);
+			}
+		}
+
 	private:
 		EffectDesc effect_desc_;
 	};
@@ -2829,217 +3145,214 @@ namespace KlayGE
 		ResIdentifierPtr source = ResLoader::Instance().Open(fxml_name);
 		ResIdentifierPtr kfx_source = ResLoader::Instance().Open(kfx_name);
 
-		XMLDocumentPtr doc;
-		XMLNodePtr root;
-
 		res_name_ = MakeSharedPtr<std::string>(fxml_name);
-		if (source)
-		{
-			timestamp_ = source->Timestamp();
-
-			doc = MakeSharedPtr<XMLDocument>();
-			root = doc->Parse(source);
-
-			std::vector<std::string> include_names;
-			this->RecursiveIncludeNode(root, include_names);
-
-			typedef KLAYGE_DECLTYPE(include_names) IncludeNamesType;
-			KLAYGE_FOREACH(IncludeNamesType::const_reference include_name, include_names)
-			{
-				ResIdentifierPtr include_source = ResLoader::Instance().Open(include_name);
-				if (include_source)
-				{
-					timestamp_ = std::max(timestamp_, include_source->Timestamp());
-				}
-			}
-		}
-		else
-		{
-			timestamp_ = 0;
-		}
+		timestamp_ = source ? source->Timestamp() : 0;
 
+		// The kfx records the includes, so the fxml is parsed only when the kfx is out of date
 		if (!this->StreamIn(kfx_source))
 		{
 			if (source)
 			{
-				shader_descs_.reset();
-				macros_.reset();
-				cbuffers_.clear();
-				params_.clear();
-				shaders_.reset();
-				techniques_.clear();
+				this->ParseFXML(source);
+				this->BuildShaders();
+			}
 
-				shader_descs_ = MakeSharedPtr<KlayGE::remove_reference<KLAYGE_DECLTYPE(*shader_descs_)>::type>(1);
+			std::ofstream ofs(kfx_name.c_str(), std::ios_base::binary | std::ios_base::out);
+			this->StreamOut(ofs);
+		}
+	}
 
-				XMLAttributePtr attr;
+	void RenderEffect::ParseFXML(ResIdentifierPtr const & source)
+	{
+		XMLDocumentPtr doc = MakeSharedPtr<XMLDocument>();
+		XMLNodePtr root = doc->Parse(source);
 
-				std::vector<XMLDocumentPtr> include_docs;
-				std::vector<std::string> whole_include_names;
-				for (XMLNodePtr node = root->FirstNode("include"); node;)
-				{
-					attr = node->Attrib("name");
-					BOOST_ASSERT(attr);
-					std::string include_name = attr->ValueString();
+		std::vector<std::string> include_names;
+		this->RecursiveIncludeNode(root, include_names);
 
-					include_docs.push_back(MakeSharedPtr<XMLDocument>());
-					XMLNodePtr include_root = include_docs.back()->Parse(ResLoader::Instance().Open(include_name));
+		includes_ = MakeSharedPtr<KlayGE::remove_reference<KLAYGE_DECLTYPE(*includes_)>::type>();
+		typedef KLAYGE_DECLTYPE(include_names) IncludeNamesType;
+		KLAYGE_FOREACH(IncludeNamesType::const_reference include_name, include_names)
+		{
+			// Only stats the file, 0 if it's missing
+			uint64_t const include_timestamp = ResLoader::Instance().Timestamp(include_name);
+			timestamp_ = std::max(timestamp_, include_timestamp);
+			includes_->push_back(std::make_pair(include_name, include_timestamp));
+		}
 
-					std::vector<std::string> include_names;
-					this->RecursiveIncludeNode(include_root, include_names);
+		shader_descs_.reset();
+		macros_.reset();
+		cbuffers_.clear();
+		params_.clear();
+		shaders_.reset();
+		techniques_.clear();
 
-					if (!include_names.empty())
-					{
-						for (KLAYGE_AUTO(iter, include_names.begin()); iter != include_names.end();)
-						{
-							bool found = false;
-							for (KLAYGE_AUTO(iter_w, whole_include_names.begin()); iter_w != whole_include_names.end(); ++ iter_w)
-							{
-								if (*iter == *iter_w)
-								{
-									found = true;
-									break;
-								}
-							}
+		shader_descs_ = MakeSharedPtr<KlayGE::remove_reference<KLAYGE_DECLTYPE(*shader_descs_)>::type>(1);
 
-							if (found)
-							{
-								iter = include_names.erase(iter);
-							}
-							else
-							{
-								include_docs.push_back(MakeSharedPtr<XMLDocument>());
-								XMLNodePtr recursive_include_root = include_docs.back()->Parse(ResLoader::Instance().Open(*iter));
-								this->InsertIncludeNodes(*doc, root, node, recursive_include_root);
+		XMLAttributePtr attr;
 
-								whole_include_names.push_back(*iter);
-								++ iter;
-							}
-						}
-					}
+		std::vector<XMLDocumentPtr> include_docs;
+		std::vector<std::string> whole_include_names;
+		for (XMLNodePtr node = root->FirstNode("include"); node;)
+		{
+			attr = node->Attrib("name");
+			BOOST_ASSERT(attr);
+			std::string include_name = attr->ValueString();
+
+			include_docs.push_back(MakeSharedPtr<XMLDocument>());
+			XMLNodePtr include_root = include_docs.back()->Parse(ResLoader::Instance().Open(include_name));
+
+			std::vector<std::string> include_names;
+			this->RecursiveIncludeNode(include_root, include_names);
 
+			if (!include_names.empty())
+			{
+				for (KLAYGE_AUTO(iter, include_names.begin()); iter != include_names.end();)
+				{
 					bool found = false;
 					for (KLAYGE_AUTO(iter_w, whole_include_names.begin()); iter_w != whole_include_names.end(); ++ iter_w)
 					{
-						if (include_name == *iter_w)
+						if (*iter == *iter_w)
 						{
 							found = true;
 							break;
 						}
 					}
 
-					if (!found)
+					if (found)
 					{
-						this->InsertIncludeNodes(*doc, root, node, include_root);
-						whole_include_names.push_back(include_name);
+						iter = include_names.erase(iter);
 					}
+					else
+					{
+						include_docs.push_back(MakeSharedPtr<XMLDocument>());
+						XMLNodePtr recursive_include_root = include_docs.back()->Parse(ResLoader::Instance().Open(*iter));
+						this->InsertIncludeNodes(*doc, root, node, recursive_include_root);
 
-					XMLNodePtr node_next = node->NextSibling("include");
-					root->RemoveNode(node);
-					node = node_next;
+						whole_include_names.push_back(*iter);
+						++ iter;
+					}
 				}
+			}
 
+			bool found = false;
+			for (KLAYGE_AUTO(iter_w, whole_include_names.begin()); iter_w != whole_include_names.end(); ++ iter_w)
+			{
+				if (include_name == *iter_w)
 				{
-					XMLNodePtr macro_node = root->FirstNode("macro");
-					if (macro_node)
-					{
-						macros_ = MakeSharedPtr<KlayGE::remove_reference<KLAYGE_DECLTYPE(*macros_)>::type>();
-					}
-					for (; macro_node; macro_node = macro_node->NextSibling("macro"))
-					{
-						macros_->push_back(std::make_pair(std::make_pair(macro_node->Attrib("name")->ValueString(), macro_node->Attrib("value")->ValueString()), true));
-					}
+					found = true;
+					break;
 				}
+			}
 
-				std::vector<XMLNodePtr> parameter_nodes;
-				for (XMLNodePtr node = root->FirstNode(); node; node = node->NextSibling())
-				{
-					if ("parameter" == node->Name())
-					{
-						parameter_nodes.push_back(node);
-					}
-					else if ("cbuffer" == node->Name())
-					{
-						for (XMLNodePtr sub_node = node->FirstNode("parameter"); sub_node; sub_node = sub_node->NextSibling("parameter"))
-						{
-							parameter_nodes.push_back(sub_node);
-						}
-					}
-				}
-
-				for (uint32_t param_index = 0; param_index < parameter_nodes.size(); ++ param_index)
-				{
-					XMLNodePtr const & node = parameter_nodes[param_index];
+			if (!found)
+			{
+				this->InsertIncludeNodes(*doc, root, node, include_root);
+				whole_include_names.push_back(include_name);
+			}
 
-					uint32_t type = type_define::instance().type_code(node->Attrib("type")->ValueString());
-					if ((type != REDT_sampler)
-						&& (type != REDT_texture1D) && (type != REDT_texture2D) && (type != REDT_texture3D)
-						&& (type != REDT_textureCUBE)
-						&& (type != REDT_texture1DArray) && (type != REDT_texture2DArray)
-						&& (type != REDT_texture3DArray) && (type != REDT_textureCUBEArray)
-						&& (type != REDT_buffer) && (type != REDT_structured_buffer)
-						&& (type != REDT_byte_address_buffer) && (type != REDT_rw_buffer)
-						&& (type != REDT_rw_structured_buffer) && (type != REDT_rw_texture1D)
-						&& (type != REDT_rw_texture2D) && (type != REDT_rw_texture3D)
-						&& (type != REDT_rw_texture1DArray) && (type != REDT_rw_texture2DArray)
-						&& (type != REDT_rw_byte_address_buffer) && (type != REDT_append_structured_buffer)
-						&& (type != REDT_consume_structured_buffer))
-					{
-						RenderEffectConstantBufferPtr cbuff;
-						XMLNodePtr parent_node = node->Parent();
-						std::string cbuff_name = parent_node->AttribString("name", "global_cb");
-						size_t const cbuff_name_hash = RT_HASH(cbuff_name.c_str());
+			XMLNodePtr node_next = node->NextSibling("include");
+			root->RemoveNode(node);
+			node = node_next;
+		}
 
-						bool found = false;
-						for (size_t i = 0; i < cbuffers_.size(); ++ i)
-						{
-							if (cbuffers_[i]->NameHash() == cbuff_name_hash)
-							{
-								cbuff = cbuffers_[i];
-								found = true;
-								break;
-							}
-						}
-						if (!found)
-						{
-							cbuff = MakeSharedPtr<RenderEffectConstantBuffer>();
-							cbuff->Load(cbuff_name);
-							cbuffers_.push_back(cbuff);
-						}
+		{
+			XMLNodePtr macro_node = root->FirstNode("macro");
+			if (macro_node)
+			{
+				macros_ = MakeSharedPtr<KlayGE::remove_reference<KLAYGE_DECLTYPE(*macros_)>::type>();
+			}
+			for (; macro_node; macro_node = macro_node->NextSibling("macro"))
+			{
+				macros_->push_back(std::make_pair(std::make_pair(macro_node->Attrib("name")->ValueString(), macro_node->Attrib("value")->ValueString()), true));
+			}
+		}
 
-						cbuff->AddParameter(param_index);
-					}
+		std::vector<XMLNodePtr> parameter_nodes;
+		for (XMLNodePtr node = root->FirstNode(); node; node = node->NextSibling())
+		{
+			if ("parameter" == node->Name())
+			{
+				parameter_nodes.push_back(node);
+			}
+			else if ("cbuffer" == node->Name())
+			{
+				for (XMLNodePtr sub_node = node->FirstNode("parameter"); sub_node; sub_node = sub_node->NextSibling("parameter"))
+				{
+					parameter_nodes.push_back(sub_node);
+				}
+			}
+		}
 
-					RenderEffectParameterPtr param = MakeSharedPtr<RenderEffectParameter>();
-					params_.push_back(param);
+		for (uint32_t param_index = 0; param_index < parameter_nodes.size(); ++ param_index)
+		{
+			XMLNodePtr const & node = parameter_nodes[param_index];
 
-					param->Load(node);
-				}
+			uint32_t type = type_define::instance().type_code(node->Attrib("type")->ValueString());
+			if ((type != REDT_sampler)
+				&& (type != REDT_texture1D) && (type != REDT_texture2D) && (type != REDT_texture3D)
+				&& (type != REDT_textureCUBE)
+				&& (type != REDT_texture1DArray) && (type != REDT_texture2DArray)
+				&& (type != REDT_texture3DArray) && (type != REDT_textureCUBEArray)
+				&& (type != REDT_buffer) && (type != REDT_structured_buffer)
+				&& (type != REDT_byte_address_buffer) && (type != REDT_rw_buffer)
+				&& (type != REDT_rw_structured_buffer) && (type != REDT_rw_texture1D)
+				&& (type != REDT_rw_texture2D) && (type != REDT_rw_texture3D)
+				&& (type != REDT_rw_texture1DArray) && (type != REDT_rw_texture2DArray)
+				&& (type != REDT_rw_byte_address_buffer) && (type != REDT_append_structured_buffer)
+				&& (type != REDT_consume_structured_buffer))
+			{
+				RenderEffectConstantBufferPtr cbuff;
+				XMLNodePtr parent_node = node->Parent();
+				std::string cbuff_name = parent_node->AttribString("name", "global_cb");
+				size_t const cbuff_name_hash = RT_HASH(cbuff_name.c_str());
 
+				bool found = false;
+				for (size_t i = 0; i < cbuffers_.size(); ++ i)
 				{
-					XMLNodePtr shader_node = root->FirstNode("shader");
-					if (shader_node)
+					if (cbuffers_[i]->NameHash() == cbuff_name_hash)
 					{
-						shaders_ = MakeSharedPtr<KlayGE::remove_reference<KLAYGE_DECLTYPE(*shaders_)>::type>();
-						for (; shader_node; shader_node = shader_node->NextSibling("shader"))
-						{
-							shaders_->push_back(RenderShaderFunc());
-							shaders_->back().Load(shader_node);
-						}
+						cbuff = cbuffers_[i];
+						found = true;
+						break;
 					}
 				}
-
-				uint32_t index = 0;
-				for (XMLNodePtr node = root->FirstNode("technique"); node; node = node->NextSibling("technique"), ++ index)
+				if (!found)
 				{
-					RenderTechniquePtr technique = MakeSharedPtr<RenderTechnique>(*this);
-					techniques_.push_back(technique);
+					cbuff = MakeSharedPtr<RenderEffectConstantBuffer>();
+					cbuff->Load(cbuff_name);
+					cbuffers_.push_back(cbuff);
+				}
 
-					technique->Load(node, index);
+				cbuff->AddParameter(param_index);
+			}
+
+			RenderEffectParameterPtr param = MakeSharedPtr<RenderEffectParameter>();
+			params_.push_back(param);
+
+			param->Load(node);
+		}
+
+		{
+			XMLNodePtr shader_node = root->FirstNode("shader");
+			if (shader_node)
+			{
+				shaders_ = MakeSharedPtr<KlayGE::remove_reference<KLAYGE_DECLTYPE(*shaders_)>::type>();
+				for (; shader_node; shader_node = shader_node->NextSibling("shader"))
+				{
+					shaders_->push_back(RenderShaderFunc());
+					shaders_->back().Load(shader_node);
 				}
 			}
+		}
 
-			std::ofstream ofs(kfx_name.c_str(), std::ios_base::binary | std::ios_base::out);
-			this->StreamOut(ofs);
+		uint32_t index = 0;
+		for (XMLNodePtr node = root->FirstNode("technique"); node; node = node->NextSibling("technique"), ++ index)
+		{
+			RenderTechniquePtr technique = MakeSharedPtr<RenderTechnique>(*this);
+			techniques_.push_back(technique);
+
+			technique->Load(node, index);
 		}
 	}
 
@@ -3073,7 +3386,31 @@ namespace KlayGE
 					uint64_t timestamp;
 					source->read(&timestamp, sizeof(timestamp));
 					timestamp = LE2Native(timestamp);
-					if (timestamp_ <= timestamp)
+
+					bool includes_up_to_date = true;
+					{
+						uint16_t num_includes;
+						source->read(&num_includes, sizeof(num_includes));
+						num_includes = LE2Native(num_includes);
+
+						includes_ = MakeSharedPtr<KlayGE::remove_reference<KLAYGE_DECLTYPE(*includes_)>::type>(num_includes);
+						for (uint32_t i = 0; i < num_includes; ++ i)
+						{
+							std::pair<std::string, uint64_t>& include = (*includes_)[i];
+							include.first = ReadShortString(source);
+							source->read(&include.second, sizeof(include.second));
+							include.second = LE2Native(include.second);
+
+							// Missing includes are fine, only the kfx may be shipped. Their timestamps are 0.
+							uint64_t const include_timestamp = ResLoader::Instance().Timestamp(include.first);
+							if ((include_timestamp != 0) && (include_timestamp != include.second))
+							{
+								includes_up_to_date = false;
+							}
+						}
+					}
+
+					if ((timestamp_ <= timestamp) && includes_up_to_date)
 					{
 						shader_descs_ = MakeSharedPtr<KlayGE::remove_reference<KLAYGE_DECLTYPE(*shader_descs_)>::type>(1);
 
@@ -3203,6 +3540,18 @@ namespace KlayGE
 		uint64_t timestamp = Native2LE(timestamp_);
 		os.write(reinterpret_cast<char const *>(&timestamp), sizeof(timestamp));
 
+		{
+			uint16_t num_includes = includes_ ? static_cast<uint16_t>(includes_->size()) : 0;
+			uint16_t tmp = Native2LE(num_includes);
+			os.write(reinterpret_cast<char const *>(&tmp), sizeof(tmp));
+			for (uint32_t i = 0; i < num_includes; ++ i)
+			{
+				WriteShortString(os, (*includes_)[i].first);
+				uint64_t include_timestamp = Native2LE((*includes_)[i].second);
+				os.write(reinterpret_cast<char const *>(&include_timestamp), sizeof(include_timestamp));
+			}
+		}
+
 		{
 			uint16_t num_macros = 0;
 			if (macros_)
@@ -3303,8 +3652,27 @@ namespace KlayGE
 
 		ret->res_name_ = res_name_;
 		ret->timestamp_ = timestamp_;
+		ret->includes_ = includes_;
 
-		ret->prototype_effect_ = prototype_effect_;
+		RenderEffectPtr const prototype = prototype_effect_ ? prototype_effect_ : this->shared_from_this();
+		ret->prototype_effect_ = prototype;
+		{
+			lock_guard<mutex> lock(prototype->clones_mutex_);
+			std::vector<weak_ptr<RenderEffect> >& clones = prototype->clones_;
+			for (size_t i = 0; i < clones.size();)
+			{
+				if (clones[i].expired())
+				{
+					clones[i] = clones.back();
+					clones.pop_back();
+				}
+				else
+				{
+					++ i;
+				}
+			}
+			clones.push_back(ret);
+		}
 		ret->macros_ = macros_;
 		ret->shaders_ = shaders_;
 		ret->shader_descs_ = shader_descs_;
@@ -3321,6 +3689,7 @@ namespace KlayGE
 			ret->cbuffers_[i] = cbuffers_[i]->Clone(*this, *ret);
 		}
 
+		// Passes of the cloned techniques share the ones here until they are used
 		ret->techniques_.resize(techniques_.size());
 		for (size_t i = 0; i < techniques_.size(); ++ i)
 		{
@@ -3330,6 +3699,327 @@ namespace KlayGE
 		return ret;
 	}
 
+	struct RenderEffect::ReloadState
+	{
+		RenderEffectPtr effect;
+		// Passes of the reparsed effect to compile, in loading order
+		std::vector<tuple<RenderPass*, uint32_t, uint32_t> > passes;
+		std::vector<std::vector<bool> > recompiled;
+
+		atomic<uint32_t> next_pass;
+		atomic<uint32_t> num_finished;
+		uint32_t num_workers;
+		std::vector<joiner<void> > joiners;
+
+		ReloadState()
+			: next_pass(0), num_finished(0), num_workers(0)
+		{
+		}
+	};
+
+	bool RenderEffect::Reload()
+	{
+		if (!reload_state_)
+		{
+			// Only the timestamps are checked, to not extract the files from packages until they changed
+			uint64_t const timestamp = ResLoader::Instance().Timestamp(*res_name_);
+			bool up_to_date = (timestamp <= timestamp_);
+			shared_ptr<std::vector<std::pair<std::string, uint64_t> > > includes
+				= MakeSharedPtr<std::vector<std::pair<std::string, uint64_t> > >();
+			if (includes_)
+			{
+				*includes = *includes_;
+				for (size_t i = 0; i < includes->size(); ++ i)
+				{
+					uint64_t const include_timestamp = ResLoader::Instance().Timestamp((*includes)[i].first);
+					if ((include_timestamp != 0) && (include_timestamp != (*includes)[i].second))
+					{
+						(*includes)[i].second = include_timestamp;
+						up_to_date = false;
+					}
+				}
+			}
+			if (up_to_date)
+			{
+				return true;
+			}
+
+			ResIdentifierPtr source = ResLoader::Instance().Open(*res_name_);
+			if (!source)
+			{
+				return true;
+			}
+
+			RenderEffectPtr effect = MakeSharedPtr<RenderEffect>();
+			effect->res_name_ = res_name_;
+			effect->timestamp_ = timestamp;
+			bool parsed = true;
+			try
+			{
+				effect->ParseFXML(source);
+			}
+			catch (...)
+			{
+				parsed = false;
+			}
+
+			if (!parsed || !this->SameLayout(*effect))
+			{
+				if (parsed)
+				{
+					LogError("The parameters or techniques of %s changed, it will be reloaded on the next launch",
+						res_name_->c_str());
+				}
+				else
+				{
+					LogError("Failed to parse %s, keeps the loaded one", res_name_->c_str());
+				}
+
+				// Not tried again until the files change again
+				timestamp_ = std::max(timestamp_, timestamp);
+				includes_ = includes;
+				return true;
+			}
+
+			// A pass is recompiled if the generated code of any stage changes. The owners of its shared stages are
+			//  compiled with it, for linking. Unchanged stages are likely to be in the shader cache.
+			ShaderCodeDependency const old_code(*this);
+			ShaderCodeDependency const new_code(*effect);
+
+			reload_state_ = MakeSharedPtr<ReloadState>();
+			reload_state_->effect = effect;
+			std::vector<std::vector<bool> >& recompiled = reload_state_->recompiled;
+			recompiled.resize(effect->techniques_.size());
+			for (uint32_t tech_index = 0; tech_index < effect->techniques_.size(); ++ tech_index)
+			{
+				recompiled[tech_index].resize(effect->techniques_[tech_index]->NumPasses(), false);
+			}
+			for (uint32_t tech_index = 0; tech_index < effect->techniques_.size(); ++ tech_index)
+			{
+				RenderTechnique const & old_tech = *techniques_[tech_index];
+				RenderTechnique const & new_tech = *effect->techniques_[tech_index];
+				for (uint32_t pass_index = 0; pass_index < new_tech.NumPasses(); ++ pass_index)
+				{
+					RenderPass const & old_pass = *old_tech.Pass(pass_index);
+					RenderPass const & new_pass = *new_tech.Pass(pass_index);
+
+					bool changed = false;
+					for (int type = 0; (type < ShaderObject::ST_NumShaderTypes) && !changed; ++ type)
+					{
+						ShaderDesc const & old_sd = this->GetShaderDesc(old_pass.ShaderDescIds()[type]);
+						ShaderDesc const & new_sd = effect->GetShaderDesc(new_pass.ShaderDescIds()[type]);
+						if (old_sd.func_name.empty() || new_sd.func_name.empty())
+						{
+							changed = (old_sd.func_name.empty() != new_sd.func_name.empty());
+						}
+						else
+						{
+							changed = !(StageFingerprint(*this, old_tech, old_pass, old_sd, old_code)
+								== StageFingerprint(*effect, new_tech, new_pass, new_sd, new_code));
+						}
+					}
+
+					if (changed)
+					{
+						recompiled[tech_index][pass_index] = true;
+						for (int type = 0; type < ShaderObject::ST_NumShaderTypes; ++ type)
+						{
+							ShaderDesc const & new_sd = effect->GetShaderDesc(new_pass.ShaderDescIds()[type]);
+							if (!new_sd.func_name.empty())
+							{
+								recompiled[new_sd.tech_pass_type >> 16][(new_sd.tech_pass_type >> 8) & 0xFF] = true;
+							}
+						}
+					}
+				}
+			}
+			for (uint32_t tech_index = 0; tech_index < effect->techniques_.size(); ++ tech_index)
+			{
+				for (uint32_t pass_index = 0; pass_index < recompiled[tech_index].size(); ++ pass_index)
+				{
+					if (recompiled[tech_index][pass_index])
+					{
+						reload_state_->passes.push_back(KlayGE::make_tuple(
+							effect->techniques_[tech_index]->Pass(pass_index).get(), tech_index, pass_index));
+					}
+				}
+			}
+
+			reload_state_->num_workers = std::min(static_cast<uint32_t>(reload_state_->passes.size()),
+				static_cast<uint32_t>(CPUInfo().NumHWThreads()));
+			thread_pool& tp = Context::Instance().ThreadPool();
+			for (uint32_t i = 0; i < reload_state_->num_workers; ++ i)
+			{
+				reload_state_->joiners.push_back(tp(ReloadPassesFunc(reload_state_, reload_state_->passes,
+					reload_state_->next_pass, reload_state_->num_finished)));
+			}
+		}
+
+		if (reload_state_->num_finished < reload_state_->num_workers)
+		{
+			return false;
+		}
+
+		shared_ptr<ReloadState> state = reload_state_;
+		reload_state_.reset();
+		for (size_t i = 0; i < state->joiners.size(); ++ i)
+		{
+			state->joiners[i]();
+		}
+
+		bool valid = true;
+		for (size_t i = 0; i < state->passes.size(); ++ i)
+		{
+			get<0>(state->passes[i])->LinkShaders(get<1>(state->passes[i]), get<2>(state->passes[i]));
+			valid &= get<0>(state->passes[i])->Validate();
+		}
+
+		RenderEffect const & effect = *state->effect;
+		timestamp_ = effect.timestamp_;
+		includes_ = effect.includes_;
+		if (!valid)
+		{
+			LogError("Failed to compile %s, keeps the loaded shaders", res_name_->c_str());
+			return true;
+		}
+
+		macros_ = effect.macros_;
+		shaders_ = effect.shaders_;
+		shader_descs_ = effect.shader_descs_;
+		for (size_t tech_index = 0; tech_index < techniques_.size(); ++ tech_index)
+		{
+			RenderTechnique const & new_tech = *effect.techniques_[tech_index];
+			for (uint32_t pass_index = 0; pass_index < new_tech.NumPasses(); ++ pass_index)
+			{
+				techniques_[tech_index]->Pass(pass_index)->Reload(*new_tech.Pass(pass_index),
+					state->recompiled[tech_index][pass_index]);
+			}
+		}
+		for (size_t tech_index = 0; tech_index < techniques_.size(); ++ tech_index)
+		{
+			techniques_[tech_index]->Reload(*effect.techniques_[tech_index]);
+		}
+
+		std::vector<RenderEffectPtr> clones;
+		{
+			lock_guard<mutex> lock(clones_mutex_);
+			for (size_t i = 0; i < clones_.size(); ++ i)
+			{
+				RenderEffectPtr clone = clones_[i].lock();
+				if (clone)
+				{
+					clones.push_back(clone);
+				}
+			}
+		}
+		// The clones compare their values with the old defaults, still in the prototype
+		for (size_t i = 0; i < params_.size(); ++ i)
+		{
+			for (size_t j = 0; j < clones.size(); ++ j)
+			{
+				clones[j]->params_[i]->UpdateDefault(*params_[i], *effect.params_[i]);
+			}
+			params_[i]->UpdateDefault(*params_[i], *effect.params_[i]);
+		}
+		for (size_t i = 0; i < clones.size(); ++ i)
+		{
+			clones[i]->UpdateFromPrototype();
+		}
+
+		LogInfo("%s reloaded, %d passes recompiled", res_name_->c_str(), static_cast<int>(state->passes.size()));
+
+		return true;
+	}
+
+	void RenderEffect::UpdateFromPrototype()
+	{
+		if (!prototype_effect_ || (prototype_effect_.get() == this))
+		{
+			return;
+		}
+
+		RenderEffect& prototype = *prototype_effect_;
+		timestamp_ = prototype.timestamp_;
+		includes_ = prototype.includes_;
+		macros_ = prototype.macros_;
+		shaders_ = prototype.shaders_;
+		shader_descs_ = prototype.shader_descs_;
+		for (size_t tech_index = 0; tech_index < techniques_.size(); ++ tech_index)
+		{
+			RenderTechnique const & prototype_tech = *prototype.techniques_[tech_index];
+			for (uint32_t pass_index = 0; pass_index < prototype_tech.NumPasses(); ++ pass_index)
+			{
+				techniques_[tech_index]->Pass(pass_index)->UpdateFromPrototype(*prototype_tech.Pass(pass_index));
+			}
+		}
+		for (size_t tech_index = 0; tech_index < techniques_.size(); ++ tech_index)
+		{
+			techniques_[tech_index]->Reload(*prototype.techniques_[tech_index]);
+		}
+	}
+
+	void RenderEffect::DependentFiles(std::vector<std::string>& files) const
+	{
+		files.push_back(*res_name_);
+		if (includes_)
+		{
+			for (size_t i = 0; i < includes_->size(); ++ i)
+			{
+				files.push_back((*includes_)[i].first);
+			}
+		}
+	}
+
+	// The passes can be swapped in place only if the effect looks the same from outside
+	bool RenderEffect::SameLayout(RenderEffect const & rhs) const
+	{
+		if ((params_.size() != rhs.params_.size()) || (cbuffers_.size() != rhs.cbuffers_.size())
+			|| (techniques_.size() != rhs.techniques_.size()))
+		{
+			return false;
+		}
+
+		for (size_t i = 0; i < params_.size(); ++ i)
+		{
+			RenderEffectParameter const & lhs_param = *params_[i];
+			RenderEffectParameter const & rhs_param = *rhs.params_[i];
+			if ((lhs_param.Type() != rhs_param.Type()) || (*lhs_param.Name() != *rhs_param.Name())
+				|| (!lhs_param.ArraySize() != !rhs_param.ArraySize())
+				|| (lhs_param.ArraySize() && (*lhs_param.ArraySize() != *rhs_param.ArraySize())))
+			{
+				return false;
+			}
+		}
+
+		for (size_t i = 0; i < cbuffers_.size(); ++ i)
+		{
+			RenderEffectConstantBuffer const & lhs_cbuff = *cbuffers_[i];
+			RenderEffectConstantBuffer const & rhs_cbuff = *rhs.cbuffers_[i];
+			if ((*lhs_cbuff.Name() != *rhs_cbuff.Name()) || (lhs_cbuff.NumParameters() != rhs_cbuff.NumParameters()))
+			{
+				return false;
+			}
+			for (uint32_t j = 0; j < lhs_cbuff.NumParameters(); ++ j)
+			{
+				if (lhs_cbuff.ParameterIndex(j) != rhs_cbuff.ParameterIndex(j))
+				{
+					return false;
+				}
+			}
+		}
+
+		for (size_t i = 0; i < techniques_.size(); ++ i)
+		{
+			if ((techniques_[i]->NameHash() != rhs.techniques_[i]->NameHash())
+				|| (techniques_[i]->NumPasses() != rhs.techniques_[i]->NumPasses()))
+			{
+				return false;
+			}
+		}
+
+		return true;
+	}
+
 	RenderEffectParameterPtr const & RenderEffect::ParameterByName(std::string const & name) const
 	{
 		size_t const name_hash = boost::hash_range(name.begin(), name.end());
@@ -3383,6 +4073,10 @@ namespace KlayGE
 		{
 			if (name_hash == tech->NameHash())
 			{
+				if (!tech->Instantiated())
+				{
+					tech->Instantiate();
+				}
 				return tech;
 			}
 		}
@@ -3390,6 +4084,113 @@ namespace KlayGE
 		return null_tech;
 	}
 
+	void RenderEffect::InvalidateKFX()
+	{
+		std::string const & fxml_name = *res_name_;
+		std::string const kfx_name = fxml_name.substr(0, fxml_name.rfind(".")) + ".kfx";
+		if (0 == std::remove(kfx_name.c_str()))
+		{
+			LogWarn("%s has native shaders rejected by the driver, it will be rebuilt on the next loading", kfx_name.c_str());
+		}
+	}
+
+	RenderTechniquePtr const & RenderEffect::TechniqueByIndex(uint32_t n) const
+	{
+		BOOST_ASSERT(n < this->NumTechniques());
+
+		RenderTechniquePtr const & tech = techniques_[n];
+		if (!tech->Instantiated())
+		{
+			tech->Instantiate();
+		}
+		return tech;
+	}
+
+	// Compiling is most of the time of loading an effect from fxml. Shader descs are unique on profile, function and
+	//  macros hash, and each one is compiled once, by the first pass using it. Those owner passes are compiled
+	//  concurrently on the global thread pool. Attaching and linking need the graphics API, and the owner of a shared
+	//  stage attached first, so they are done afterwards in loading order.
+	void RenderEffect::BuildShaders()
+	{
+		// Techniques without passes of their own share their parent's, which keep the parent's indices
+		std::vector<tuple<RenderPass*, uint32_t, uint32_t> > passes;
+		for (uint32_t tech_index = 0; tech_index < techniques_.size(); ++ tech_index)
+		{
+			RenderTechniquePtr const & tech = techniques_[tech_index];
+			for (uint32_t pass_index = 0; pass_index < tech->NumPasses(); ++ pass_index)
+			{
+				RenderPass* pass = tech->Pass(pass_index).get();
+
+				bool found = false;
+				for (size_t i = 0; i < passes.size(); ++ i)
+				{
+					if (get<0>(passes[i]) == pass)
+					{
+						found = true;
+						break;
+					}
+				}
+				if (!found)
+				{
+					passes.push_back(KlayGE::make_tuple(pass, tech_index, pass_index));
+				}
+			}
+		}
+
+		{
+			// The work list comes from the unique shader descs rather than the passes, a pass that only shares stages
+			//  of others has nothing to compile
+			std::vector<uint32_t> owners;
+			for (size_t i = 0; i < shader_descs_->size(); ++ i)
+			{
+				ShaderDesc const & sd = (*shader_descs_)[i];
+				if (!sd.func_name.empty() && (sd.tech_pass_type != 0xFFFFFFFF))
+				{
+					uint32_t const owner = sd.tech_pass_type >> 8;
+					if (std::find(owners.begin(), owners.end(), owner) == owners.end())
+					{
+						owners.push_back(owner);
+					}
+				}
+			}
+
+			std::vector<tuple<RenderPass*, uint32_t, uint32_t> > compile_passes;
+			for (size_t i = 0; i < owners.size(); ++ i)
+			{
+				uint32_t const tech_index = owners[i] >> 8;
+				uint32_t const pass_index = owners[i] & 0xFF;
+				compile_passes.push_back(KlayGE::make_tuple(techniques_[tech_index]->Pass(pass_index).get(),
+					tech_index, pass_index));
+			}
+
+			atomic<uint32_t> next_pass(0);
+			uint32_t const num_workers = std::min(static_cast<uint32_t>(compile_passes.size()),
+				static_cast<uint32_t>(CPUInfo().NumHWThreads()));
+
+			thread_pool& tp = Context::Instance().ThreadPool();
+			std::vector<joiner<void> > joiners;
+			for (uint32_t i = 1; i < num_workers; ++ i)
+			{
+				joiners.push_back(tp(CompilePassesFunc(compile_passes, next_pass)));
+			}
+			CompilePassesFunc(compile_passes, next_pass)();
+			for (size_t i = 0; i < joiners.size(); ++ i)
+			{
+				joiners[i]();
+			}
+		}
+
+		for (size_t i = 0; i < passes.size(); ++ i)
+		{
+			get<0>(passes[i])->LinkShaders(get<1>(passes[i]), get<2>(passes[i]));
+		}
+
+		for (size_t i = 0; i < techniques_.size(); ++ i)
+		{
+			techniques_[i]->UpdateShaderStates();
+		}
+	}
+
 	uint32_t RenderEffect::AddShaderDesc(ShaderDesc const & sd)
 	{
 		for (uint32_t i = 0; i < shader_descs_->size(); ++ i)
@@ -3498,9 +4299,6 @@ namespace KlayGE
 
 		if (!node->FirstNode("pass") && parent_tech)
 		{
-			is_validate_ = parent_tech->is_validate_;
-			has_discard_ = parent_tech->has_discard_;
-			has_tessellation_ = parent_tech->has_tessellation_;
 			transparent_ = parent_tech->transparent_;
 			weight_ = parent_tech->weight_;
 
@@ -3518,16 +4316,11 @@ namespace KlayGE
 					RenderPassPtr inherit_pass = parent_tech->passes_[index];
 
 					pass->Load(tech_index, index, inherit_pass);
-					is_validate_ &= pass->Validate();
 				}
 			}
 		}
 		else
 		{
-			is_validate_ = true;
-
-			has_discard_ = false;
-			has_tessellation_ = false;
 			transparent_ = false;
 			if (parent_tech)
 			{
@@ -3552,8 +4345,6 @@ namespace KlayGE
 
 				pass->Load(pass_node, tech_index, index, inherit_pass);
 
-				is_validate_ &= pass->Validate();
-
 				for (XMLNodePtr state_node = pass_node->FirstNode("state"); state_node; state_node = state_node->NextSibling("state"))
 				{
 					++ weight_;
@@ -3568,9 +4359,6 @@ namespace KlayGE
 						}
 					}
 				}
-
-				has_discard_ |= pass->GetShaderObject()->HasDiscard();
-				has_tessellation_ |= pass->GetShaderObject()->HasTessellation();
 			}
 			if (transparent_)
 			{
@@ -3579,6 +4367,50 @@ namespace KlayGE
 		}
 	}
 
+	void RenderTechnique::UpdateShaderStates()
+	{
+		is_validate_ = true;
+		has_discard_ = false;
+		has_tessellation_ = false;
+		for (size_t i = 0; i < passes_.size(); ++ i)
+		{
+			is_validate_ &= passes_[i]->Validate();
+			has_discard_ |= passes_[i]->GetShaderObject()->HasDiscard();
+			has_tessellation_ |= passes_[i]->GetShaderObject()->HasTessellation();
+		}
+	}
+
+	void RenderTechnique::Reload(RenderTechnique const & rhs)
+	{
+		annotations_ = rhs.annotations_;
+		macros_ = rhs.macros_;
+		weight_ = rhs.weight_;
+		transparent_ = rhs.transparent_;
+
+		if (instantiated_)
+		{
+			this->UpdateShaderStates();
+		}
+	}
+
+	void RenderTechnique::Instantiate()
+	{
+		// Techniques are instantiated through the const lookups of the effect, which can come from any thread.
+		//  A technique only waits for the ones before it, or in the prototype, so the locks can't deadlock.
+		lock_guard<mutex> lock(instantiate_mutex_);
+		if (!instantiated_)
+		{
+			for (size_t i = 0; i < passes_.size(); ++ i)
+			{
+				passes_[i]->Instantiate(*this);
+			}
+
+			this->UpdateShaderStates();
+
+			instantiated_ = true;
+		}
+	}
+
 	bool RenderTechnique::StreamIn(ResIdentifierPtr const & res, uint32_t tech_index)
 	{
 		name_ = MakeSharedPtr<KlayGE::remove_reference<KLAYGE_DECLTYPE(*name_)>::type>(ReadShortString(res));
@@ -3613,8 +4445,9 @@ namespace KlayGE
 			}
 		}
 
-		is_validate_ = true;
-
+		// The shader states are known when the passes are instantiated
+		instantiated_ = false;
+		is_validate_ = false;
 		has_discard_ = false;
 		has_tessellation_ = false;
 		
@@ -3632,11 +4465,6 @@ namespace KlayGE
 			passes_[pass_index] = pass;
 
 			ret &= pass->StreamIn(res, tech_index, pass_index);
-
-			is_validate_ &= pass->Validate();
-
-			has_discard_ |= pass->GetShaderObject()->HasDiscard();
-			has_tessellation_ |= pass->GetShaderObject()->HasTessellation();
 		}
 
 		return ret;
@@ -3703,6 +4531,7 @@ namespace KlayGE
 		ret->macros_ = macros_;
 		ret->weight_ = weight_;
 		ret->transparent_ = transparent_;
+		ret->instantiated_ = false;
 		ret->is_validate_ = is_validate_;
 		ret->has_discard_ = has_discard_;
 		ret->has_tessellation_ = has_tessellation_;
@@ -4185,29 +5014,15 @@ namespace KlayGE
 
 		for (int type = 0; type < ShaderObject::ST_NumShaderTypes; ++ type)
 		{
+			// The first pass using a shader desc compiles it, the others share its shader object
 			ShaderDesc& sd = effect_.GetShaderDesc((*shader_desc_ids_)[type]);
-			if (!sd.func_name.empty())
+			if (!sd.func_name.empty() && (0xFFFFFFFF == sd.tech_pass_type))
 			{
-				if (sd.tech_pass_type != 0xFFFFFFFF)
-				{
-					RenderTechniquePtr const & tech = effect_.TechniqueByIndex(sd.tech_pass_type >> 16);
-					RenderPassPtr const & pass = tech->Pass((sd.tech_pass_type >> 8) & 0xFF);
-					shader_obj_->AttachShader(static_cast<ShaderObject::ShaderType>(type),
-						effect_, *tech, *pass, pass->GetShaderObject());
-				}
-				else
-				{
-					RenderTechniquePtr const & tech = effect_.TechniqueByIndex(tech_index);
-					shader_obj_->AttachShader(static_cast<ShaderObject::ShaderType>(type),
-						effect_, *tech, *this, *shader_desc_ids_);
-					sd.tech_pass_type = (tech_index << 16) + (pass_index << 8) + type;
-				}
+				sd.tech_pass_type = (tech_index << 16) + (pass_index << 8) + type;
 			}
 		}
 
-		shader_obj_->LinkShaders(effect_);
-
-		is_validate_ = shader_obj_->Validate();
+		is_validate_ = false;
 	}
 
 	void RenderPass::Load(uint32_t tech_index, uint32_t pass_index, RenderPassPtr const & inherit_pass)
@@ -4262,12 +5077,54 @@ namespace KlayGE
 				sd.macros_hash = macros_hash;
 				sd.tech_pass_type = (tech_index << 16) + (pass_index << 8) + type;
 				(*shader_desc_ids_)[type] = effect_.AddShaderDesc(sd);
-				
-				RenderTechniquePtr const & tech = effect_.TechniqueByIndex(tech_index);
-				shader_obj_->AttachShader(static_cast<ShaderObject::ShaderType>(type),
+
+				ShaderDesc& added_sd = effect_.GetShaderDesc((*shader_desc_ids_)[type]);
+				if (0xFFFFFFFF == added_sd.tech_pass_type)
+				{
+					added_sd.tech_pass_type = sd.tech_pass_type;
+				}
+			}
+		}
+
+		is_validate_ = false;
+	}
+
+	void RenderPass::CompileShaders(uint32_t tech_index, uint32_t pass_index)
+	{
+		RenderTechniquePtr const & tech = effect_.TechniqueByIndex(tech_index);
+		for (int type = 0; type < ShaderObject::ST_NumShaderTypes; ++ type)
+		{
+			ShaderDesc const & sd = effect_.GetShaderDesc((*shader_desc_ids_)[type]);
+			if (!sd.func_name.empty() && (sd.tech_pass_type == (tech_index << 16) + (pass_index << 8) + type))
+			{
+				shader_obj_->CompileShader(static_cast<ShaderObject::ShaderType>(type),
 					effect_, *tech, *this, *shader_desc_ids_);
 			}
 		}
+	}
+
+	void RenderPass::LinkShaders(uint32_t tech_index, uint32_t pass_index)
+	{
+		for (int type = 0; type < ShaderObject::ST_NumShaderTypes; ++ type)
+		{
+			ShaderDesc const & sd = effect_.GetShaderDesc((*shader_desc_ids_)[type]);
+			if (!sd.func_name.empty())
+			{
+				if (sd.tech_pass_type == (tech_index << 16) + (pass_index << 8) + type)
+				{
+					RenderTechniquePtr const & tech = effect_.TechniqueByIndex(tech_index);
+					shader_obj_->AttachShader(static_cast<ShaderObject::ShaderType>(type),
+						effect_, *tech, *this, *shader_desc_ids_);
+				}
+				else
+				{
+					RenderTechniquePtr const & tech = effect_.TechniqueByIndex(sd.tech_pass_type >> 16);
+					RenderPassPtr const & pass = tech->Pass((sd.tech_pass_type >> 8) & 0xFF);
+					shader_obj_->AttachShader(static_cast<ShaderObject::ShaderType>(type),
+						effect_, *tech, *pass, pass->GetShaderObject());
+				}
+			}
+		}
 
 		shader_obj_->LinkShaders(effect_);
 
@@ -4371,41 +5228,76 @@ namespace KlayGE
 			(*shader_desc_ids_)[i] = LE2Native((*shader_desc_ids_)[i]);
 		}
 
-		
-		shader_obj_ = rf.MakeShaderObject();
-
-		bool native_accepted = true;
+		tech_index_ = tech_index;
+		pass_index_ = pass_index;
 
+		// Only the native blocks are read here, the shaders are created by Instantiate when the pass is used
+		native_shaders_ = MakeSharedPtr<KlayGE::remove_reference<KLAYGE_DECLTYPE(*native_shaders_)>::type>(ShaderObject::ST_NumShaderTypes);
 		for (int type = 0; type < ShaderObject::ST_NumShaderTypes; ++ type)
 		{
 			ShaderDesc const & sd = effect_.GetShaderDesc((*shader_desc_ids_)[type]);
-			if (!sd.func_name.empty())
+			if (!sd.func_name.empty() && (sd.tech_pass_type == (tech_index << 16) + (pass_index << 8) + type))
 			{
-				ShaderObject::ShaderType st = static_cast<ShaderObject::ShaderType>(type);
-
-				bool this_native_accepted;
-				if (sd.tech_pass_type != (tech_index << 16) + (pass_index << 8) + type)
-				{
-					RenderTechniquePtr const & tech = effect_.TechniqueByIndex(sd.tech_pass_type >> 16);
-					RenderPassPtr const & pass = tech->Pass((sd.tech_pass_type >> 8) & 0xFF);
-					shader_obj_->AttachShader(st, effect_, *tech, *pass, pass->GetShaderObject());
-					this_native_accepted = true;
-				}
-				else
+				uint32_t len;
+				res->read(&len, sizeof(len));
+				len = LE2Native(len);
+				std::vector<uint8_t>& native_shader_block = (*native_shaders_)[type];
+				native_shader_block.resize(len);
+				if (len > 0)
 				{
-					this_native_accepted = shader_obj_->StreamIn(res, static_cast<ShaderObject::ShaderType>(type),
-						effect_, *shader_desc_ids_);
+					res->read(&native_shader_block[0], len * sizeof(native_shader_block[0]));
 				}
-
-				native_accepted &= this_native_accepted;
 			}
 		}
 
-		shader_obj_->LinkShaders(effect_);
+		shader_obj_ = rf.MakeShaderObject();
+		is_validate_ = false;
 
-		is_validate_ = shader_obj_->Validate();
+		return true;
+	}
 
-		return native_accepted;
+	void RenderPass::Instantiate(RenderTechnique const & tech)
+	{
+		if (source_pass_)
+		{
+			// Through the technique of the source, the clones of a pass don't instantiate it at the same time
+			source_pass_->effect_.TechniqueByIndex(tech_index_);
+			shader_obj_ = source_pass_->shader_obj_->Clone(effect_);
+			is_validate_ = source_pass_->is_validate_;
+			source_pass_.reset();
+		}
+		else if (native_shaders_)
+		{
+			for (int type = 0; type < ShaderObject::ST_NumShaderTypes; ++ type)
+			{
+				ShaderDesc const & sd = effect_.GetShaderDesc((*shader_desc_ids_)[type]);
+				if (!sd.func_name.empty())
+				{
+					ShaderObject::ShaderType st = static_cast<ShaderObject::ShaderType>(type);
+
+					if (sd.tech_pass_type != (tech_index_ << 16) + (pass_index_ << 8) + type)
+					{
+						// The owner of a shared stage comes first. If it's in this technique, it's already instantiated.
+						uint32_t const owner_tech_index = sd.tech_pass_type >> 16;
+						RenderTechnique const & owner_tech = (owner_tech_index == tech_index_)
+							? tech : *effect_.TechniqueByIndex(owner_tech_index);
+						RenderPassPtr const & pass = owner_tech.Pass((sd.tech_pass_type >> 8) & 0xFF);
+						shader_obj_->AttachShader(st, effect_, owner_tech, *pass, pass->GetShaderObject());
+					}
+					else if (!shader_obj_->AttachNativeShader(st, effect_, *shader_desc_ids_, (*native_shaders_)[type]))
+					{
+						// The native block is rejected by the driver, compiles the stage from the code in the kfx
+						effect_.InvalidateKFX();
+						shader_obj_->AttachShader(st, effect_, tech, *this, *shader_desc_ids_);
+					}
+				}
+			}
+			native_shaders_.reset();
+
+			shader_obj_->LinkShaders(effect_);
+
+			is_validate_ = shader_obj_->Validate();
+		}
 	}
 
 	void RenderPass::StreamOut(std::ostream& os, uint32_t tech_index, uint32_t pass_index)
@@ -4539,13 +5431,83 @@ namespace KlayGE
 		ret->blend_state_obj_ = blend_state_obj_;
 		ret->blend_factor_ = blend_factor_;
 		ret->sample_mask_ = sample_mask_;
-		ret->shader_obj_ = shader_obj_->Clone(effect);
+		ret->shader_obj_ = shader_obj_;
 
 		ret->is_validate_ = is_validate_;
 
+		ret->tech_index_ = tech_index_;
+		ret->pass_index_ = pass_index_;
+		ret->source_pass_ = source_pass_ ? source_pass_ : this->shared_from_this();
+		ret->revision_ = revision_;
+
 		return ret;
 	}
 
+	void RenderPass::Reload(RenderPass const & rhs, bool shaders)
+	{
+		bool const changed = shaders
+			|| (rasterizer_state_obj_ != rhs.rasterizer_state_obj_)
+			|| (depth_stencil_state_obj_ != rhs.depth_stencil_state_obj_)
+			|| (blend_state_obj_ != rhs.blend_state_obj_)
+			|| (front_stencil_ref_ != rhs.front_stencil_ref_) || (back_stencil_ref_ != rhs.back_stencil_ref_)
+			|| !(blend_factor_ == rhs.blend_factor_) || (sample_mask_ != rhs.sample_mask_);
+
+		annotations_ = rhs.annotations_;
+		macros_ = rhs.macros_;
+		shader_desc_ids_ = rhs.shader_desc_ids_;
+
+		rasterizer_state_obj_ = rhs.rasterizer_state_obj_;
+		depth_stencil_state_obj_ = rhs.depth_stencil_state_obj_;
+		front_stencil_ref_ = rhs.front_stencil_ref_;
+		back_stencil_ref_ = rhs.back_stencil_ref_;
+		blend_state_obj_ = rhs.blend_state_obj_;
+		blend_factor_ = rhs.blend_factor_;
+		sample_mask_ = rhs.sample_mask_;
+
+		if (shaders)
+		{
+			native_shaders_.reset();
+			source_pass_.reset();
+			shader_obj_ = rhs.shader_obj_->Clone(effect_);
+			is_validate_ = rhs.is_validate_;
+		}
+
+		if (changed)
+		{
+			++ revision_;
+		}
+	}
+
+	void RenderPass::UpdateFromPrototype(RenderPass& prototype_pass)
+	{
+		if (revision_ == prototype_pass.revision_)
+		{
+			return;
+		}
+
+		annotations_ = prototype_pass.annotations_;
+		macros_ = prototype_pass.macros_;
+		shader_desc_ids_ = prototype_pass.shader_desc_ids_;
+
+		rasterizer_state_obj_ = prototype_pass.rasterizer_state_obj_;
+		depth_stencil_state_obj_ = prototype_pass.depth_stencil_state_obj_;
+		front_stencil_ref_ = prototype_pass.front_stencil_ref_;
+		back_stencil_ref_ = prototype_pass.back_stencil_ref_;
+		blend_state_obj_ = prototype_pass.blend_state_obj_;
+		blend_factor_ = prototype_pass.blend_factor_;
+		sample_mask_ = prototype_pass.sample_mask_;
+
+		// Passes not instantiated yet clone the shaders of their source when they are
+		if (this->Instantiated())
+		{
+			prototype_pass.effect_.TechniqueByIndex(tech_index_);
+			shader_obj_ = prototype_pass.shader_obj_->Clone(effect_);
+			is_validate_ = prototype_pass.is_validate_;
+		}
+
+		revision_ = prototype_pass.revision_;
+	}
+
 	void RenderPass::Bind()
 	{
 		RenderEngine& render_eng = Context::Instance().RenderFactoryInstance().RenderEngineInstance();
@@ -4644,6 +5606,7 @@ namespace KlayGE
 			{
 				RenderFactory& rf = Context::Instance().RenderFactoryInstance();
 				hw_buff_ = rf.MakeConstantBuffer(BU_Dynamic, EAH_CPU_Write, nullptr);
+				hw_buff_->TrackingTag(MT_Effect);
 			}
 			if (hw_buff_)
 			{
@@ -4904,6 +5867,13 @@ namespace KlayGE
 		return ret;
 	}
 
+	void RenderEffectParameter::UpdateDefault(RenderEffectParameter const & old_param,
+		RenderEffectParameter const & new_param)
+	{
+		update_var_default(*var_, *old_param.var_, *new_param.var_, type_, static_cast<bool>(array_size_));
+		annotations_ = new_param.annotations_;
+	}
+
 	void RenderEffectParameter::BindToCBuffer(RenderEffectConstantBufferPtr const & cbuff, uint32_t offset,
 		uint32_t stride)
 	{
@@ -5647,6 +6617,12 @@ namespace KlayGE
 	}
 
 
+	void AddRenderEffectWarmUp(std::string const & effect_name, std::string const & tech_name)
+	{
+		lock_guard<mutex> lock(warm_up_mutex);
+		warm_up_techs.push_back(std::make_pair(effect_name, tech_name));
+	}
+
 	RenderEffectPtr SyncLoadRenderEffect(std::string const & effect_name)
 	{
 		return ResLoader::Instance().SyncQueryT<RenderEffect>(MakeSharedPtr<EffectLoadingDesc>(effect_name));
@@ -34,7 +34,7 @@ namespace KlayGE
 {
 	Renderable::Renderable()
 		: select_mode_on_(false),
-			model_mat_(float4x4::Identity()), effect_attrs_(0)
+			model_mat_(float4x4::Identity()), active_lod_(0), effect_attrs_(0)
 	{
 		DeferredRenderingLayerPtr const & drl = Context::Instance().DeferredRenderingLayerInstance();
 		if (drl)
@@ -265,6 +265,16 @@ namespace KlayGE
 		model_mat_ = mat;
 	}
 
+	uint32_t Renderable::NumLods() const
+	{
+		return 1;
+	}
+
+	void Renderable::ActiveLod(int32_t lod)
+	{
+		active_lod_ = MathLib::clamp(lod, 0, static_cast<int32_t>(this->NumLods()) - 1);
+	}
+
 	void Renderable::UpdateBoundBox()
 	{
 	}
@@ -0,0 +1,415 @@
+/**
+* @file ShaderCache.cpp
+* @author Minmin Gong
+*
+* @section DESCRIPTION
+*
+* This source file is part of KlayGE
+* For the latest info, see http://www.klayge.org
+*
+* @section LICENSE
+*
+* This program is free software; you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published
+* by the Free Software Foundation; either version 2 of the License, or
+* (at your option) any later version.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with this program; if not, write to the Free Software
+* Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+*
+* You may alternatively use this source under the terms of
+* the KlayGE Proprietary License (KPL). You can obtained such a license
+* from http://www.klayge.org/licensing/.
+*/
+
+#include <KlayGE/KlayGE.hpp>
+#include <KFL/Util.hpp>
+#include <KlayGE/ResLoader.hpp>
+
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+#include <boost/lexical_cast.hpp>
+#if defined(KLAYGE_TR2_LIBRARY_FILESYSTEM_V2_SUPPORT) || defined(KLAYGE_TR2_LIBRARY_FILESYSTEM_V3_SUPPORT)
+	#include <filesystem>
+	namespace KlayGE
+	{
+		namespace filesystem = std::tr2::sys;
+	}
+#else
+	#include <boost/filesystem.hpp>
+	namespace KlayGE
+	{
+		namespace filesystem = boost::filesystem;
+	}
+#endif
+
+#if defined KLAYGE_PLATFORM_WINDOWS
+#include <windows.h>
+#else
+#include <unistd.h>
+#endif
+
+#include <KlayGE/ShaderCache.hpp>
+
+namespace
+{
+	using namespace KlayGE;
+
+	mutex singleton_mutex;
+
+	uint32_t const SHADER_CACHE_VERSION = 2;
+
+	uint64_t Mix(uint64_t h)
+	{
+		h ^= h >> 33;
+		h *= 0xFF51AFD7ED558CCDULL;
+		h ^= h >> 33;
+		h *= 0xC4CEB9FE1A85EC53ULL;
+		h ^= h >> 33;
+		return h;
+	}
+
+	uint32_t ProcessID()
+	{
+#if defined KLAYGE_PLATFORM_WINDOWS
+		return static_cast<uint32_t>(::GetCurrentProcessId());
+#else
+		return static_cast<uint32_t>(::getpid());
+#endif
+	}
+
+	uint64_t LastWriteTime(filesystem::path const & path)
+	{
+#if defined(KLAYGE_TR2_LIBRARY_FILESYSTEM_V3_SUPPORT)
+		return filesystem::last_write_time(path).time_since_epoch().count();
+#else
+		return filesystem::last_write_time(path);
+#endif
+	}
+}
+
+namespace KlayGE
+{
+	ShaderCacheKey::ShaderCacheKey()
+	{
+		hash_[0] = 0xCBF29CE484222325ULL;
+		hash_[1] = 0x84222325CBF29CE4ULL;
+	}
+
+	ShaderCacheKey& ShaderCacheKey::Append(void const * data, size_t size)
+	{
+		// Two lanes of FNV-1a with different bases and multipliers
+		uint8_t const * p = static_cast<uint8_t const *>(data);
+		uint64_t h0 = hash_[0];
+		uint64_t h1 = hash_[1];
+		for (size_t i = 0; i < size; ++ i)
+		{
+			h0 = (h0 ^ p[i]) * 0x100000001B3ULL;
+			h1 = (h1 ^ p[i]) * 0x9E3779B97F4A7C15ULL;
+		}
+		hash_[0] = h0;
+		hash_[1] = h1;
+		return *this;
+	}
+
+	ShaderCacheKey& ShaderCacheKey::Append(std::string const & str)
+	{
+		// The length keeps "ab" + "c" apart from "a" + "bc"
+		this->Append(static_cast<uint32_t>(str.size()));
+		return this->Append(str.c_str(), str.size());
+	}
+
+	ShaderCacheKey& ShaderCacheKey::Append(uint32_t value)
+	{
+		uint32_t le = Native2LE(value);
+		return this->Append(&le, sizeof(le));
+	}
+
+	std::string ShaderCacheKey::Name() const
+	{
+		static char const HEX_DIGITS[] = "0123456789abcdef";
+
+		std::string ret(32, '0');
+		for (int lane = 0; lane < 2; ++ lane)
+		{
+			uint64_t h = Mix(hash_[lane]);
+			for (int i = 15; i >= 0; -- i)
+			{
+				ret[lane * 16 + i] = HEX_DIGITS[h & 0xF];
+				h >>= 4;
+			}
+		}
+		return ret;
+	}
+
+
+	shared_ptr<ShaderCache> ShaderCache::shader_cache_instance_;
+
+	ShaderCache::ShaderCache()
+		: max_size_(DEFAULT_MAX_SIZE), total_size_(0), scanned_(false), tmp_serial_(0)
+	{
+#if defined KLAYGE_PLATFORM_WINDOWS_DESKTOP || defined KLAYGE_PLATFORM_LINUX || defined KLAYGE_PLATFORM_DARWIN
+		std::string exe_dir = ResLoader::Instance().AbsPath("");
+		if (!exe_dir.empty())
+		{
+			this->Directory((filesystem::path(exe_dir) / "ShaderCache").string());
+		}
+#endif
+	}
+
+	ShaderCache& ShaderCache::Instance()
+	{
+		if (!shader_cache_instance_)
+		{
+			lock_guard<mutex> lock(singleton_mutex);
+			if (!shader_cache_instance_)
+			{
+				shader_cache_instance_ = MakeSharedPtr<ShaderCache>();
+			}
+		}
+		return *shader_cache_instance_;
+	}
+
+	void ShaderCache::Destroy()
+	{
+		lock_guard<mutex> lock(singleton_mutex);
+		shader_cache_instance_.reset();
+	}
+
+	void ShaderCache::Directory(std::string const & dir)
+	{
+		lock_guard<mutex> lock(mutex_);
+
+		dir_ = dir;
+		total_size_ = 0;
+		scanned_ = false;
+		if (!dir_.empty())
+		{
+			try
+			{
+				filesystem::create_directories(filesystem::path(dir_));
+			}
+			catch (...)
+			{
+				LogWarn("Can't create the shader cache at %s", dir_.c_str());
+				dir_.clear();
+			}
+		}
+	}
+
+	std::string ShaderCache::Directory() const
+	{
+		lock_guard<mutex> lock(mutex_);
+		return dir_;
+	}
+
+	void ShaderCache::MaxSize(uint64_t size)
+	{
+		lock_guard<mutex> lock(mutex_);
+		max_size_ = size;
+	}
+
+	uint64_t ShaderCache::MaxSize() const
+	{
+		lock_guard<mutex> lock(mutex_);
+		return max_size_;
+	}
+
+	bool ShaderCache::Lookup(ShaderCacheKey const & key, std::vector<uint8_t>& code, std::string& msgs)
+	{
+		std::string const dir = this->Directory();
+		if (dir.empty())
+		{
+			return false;
+		}
+
+		// Entries are never modified in place, reading needs no lock
+		std::ifstream ifs((filesystem::path(dir) / key.Name()).string().c_str(), std::ios_base::binary);
+		if (!ifs)
+		{
+			return false;
+		}
+
+		uint32_t fourcc;
+		uint32_t ver;
+		uint64_t size;
+		ifs.read(reinterpret_cast<char*>(&fourcc), sizeof(fourcc));
+		ifs.read(reinterpret_cast<char*>(&ver), sizeof(ver));
+		ifs.read(reinterpret_cast<char*>(&size), sizeof(size));
+		if (!ifs || (LE2Native(fourcc) != MakeFourCC<'K', 'S', 'C', ' '>::value)
+			|| (LE2Native(ver) != SHADER_CACHE_VERSION))
+		{
+			return false;
+		}
+
+		code.resize(static_cast<size_t>(LE2Native(size)));
+		if (!code.empty())
+		{
+			ifs.read(reinterpret_cast<char*>(&code[0]), code.size());
+			if (static_cast<size_t>(ifs.gcount()) != code.size())
+			{
+				return false;
+			}
+		}
+
+		uint32_t msgs_size;
+		ifs.read(reinterpret_cast<char*>(&msgs_size), sizeof(msgs_size));
+		if (!ifs)
+		{
+			return false;
+		}
+		msgs.resize(LE2Native(msgs_size));
+		if (!msgs.empty())
+		{
+			ifs.read(&msgs[0], msgs.size());
+			if (static_cast<size_t>(ifs.gcount()) != msgs.size())
+			{
+				return false;
+			}
+		}
+		return true;
+	}
+
+	void ShaderCache::Insert(ShaderCacheKey const & key, void const * code, size_t size, std::string const & msgs)
+	{
+		std::string const dir = this->Directory();
+		if (dir.empty())
+		{
+			return;
+		}
+
+		filesystem::path const entry_path = filesystem::path(dir) / key.Name();
+		filesystem::path const tmp_path = filesystem::path(dir) / (key.Name() + "."
+			+ boost::lexical_cast<std::string>(ProcessID()) + "." + boost::lexical_cast<std::string>(tmp_serial_ ++) + ".tmp");
+
+		{
+			std::ofstream ofs(tmp_path.string().c_str(), std::ios_base::binary);
+			if (!ofs)
+			{
+				return;
+			}
+
+			uint32_t fourcc = Native2LE(MakeFourCC<'K', 'S', 'C', ' '>::value);
+			uint32_t ver = Native2LE(SHADER_CACHE_VERSION);
+			uint64_t le_size = Native2LE(static_cast<uint64_t>(size));
+			ofs.write(reinterpret_cast<char const *>(&fourcc), sizeof(fourcc));
+			ofs.write(reinterpret_cast<char const *>(&ver), sizeof(ver));
+			ofs.write(reinterpret_cast<char const *>(&le_size), sizeof(le_size));
+			ofs.write(static_cast<char const *>(code), size);
+			uint32_t le_msgs_size = Native2LE(static_cast<uint32_t>(msgs.size()));
+			ofs.write(reinterpret_cast<char const *>(&le_msgs_size), sizeof(le_msgs_size));
+			ofs.write(msgs.c_str(), msgs.size());
+			if (!ofs)
+			{
+				ofs.close();
+				try
+				{
+					filesystem::remove(tmp_path);
+				}
+				catch (...)
+				{
+				}
+				return;
+			}
+		}
+
+		try
+		{
+			// Another thread or process may have written the same entry, with the same content
+			filesystem::rename(tmp_path, entry_path);
+		}
+		catch (...)
+		{
+			try
+			{
+				filesystem::remove(tmp_path);
+			}
+			catch (...)
+			{
+			}
+			return;
+		}
+
+		lock_guard<mutex> lock(mutex_);
+		total_size_ += size + msgs.size() + 20;
+		if (!scanned_ || (total_size_ > max_size_))
+		{
+			this->Evict();
+		}
+	}
+
+	void ShaderCache::Evict()
+	{
+		std::vector<tuple<uint64_t, uint64_t, filesystem::path> > entries;
+		total_size_ = 0;
+		try
+		{
+			filesystem::directory_iterator end_itr;
+			for (filesystem::directory_iterator i((filesystem::path(dir_))); i != end_itr; ++ i)
+			{
+				// Temporary files belong to writers in progress, removing one would fail its rename
+				if (filesystem::is_regular_file(i->status()) && (i->path().extension() != ".tmp"))
+				{
+					filesystem::path const & path = i->path();
+					uint64_t const size = filesystem::file_size(path);
+					entries.push_back(KlayGE::make_tuple(LastWriteTime(path), size, path));
+					total_size_ += size;
+				}
+			}
+		}
+		catch (...)
+		{
+		}
+		scanned_ = true;
+
+		if (total_size_ > max_size_)
+		{
+			// Leaves some room, so that not every insertion has to scan the directory again
+			uint64_t const target_size = max_size_ / 4 * 3;
+
+			std::sort(entries.begin(), entries.end());
+			for (size_t i = 0; (i < entries.size()) && (total_size_ > target_size); ++ i)
+			{
+				try
+				{
+					filesystem::remove(get<2>(entries[i]));
+					total_size_ -= get<1>(entries[i]);
+				}
+				catch (...)
+				{
+				}
+			}
+		}
+	}
+
+	std::string ShaderCache::CompilerVersion(std::string const & compiler_path)
+	{
+		filesystem::path const path(compiler_path);
+		std::string ret = path.filename().string();
+		try
+		{
+			ret += "." + boost::lexical_cast<std::string>(filesystem::file_size(path))
+				+ "." + boost::lexical_cast<std::string>(LastWriteTime(path));
+		}
+		catch (...)
+		{
+		}
+		return ret;
+	}
+
+#ifdef KLAYGE_PLATFORM_WINDOWS
+	std::string ShaderCache::CompilerVersion(void* module)
+	{
+		char path[MAX_PATH];
+		DWORD const len = ::GetModuleFileNameA(static_cast<HMODULE>(module), path, MAX_PATH);
+		return CompilerVersion(std::string(path, path + len));
+	}
+#endif
+}
@@ -0,0 +1,386 @@
+/**
+* @file ShaderCodeDependency.cpp
+* @author Minmin Gong
+*
+* @section DESCRIPTION
+*
+* This source file is part of KlayGE
+* For the latest info, see http://www.klayge.org
+*
+* @section LICENSE
+*
+* This program is free software; you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published
+* by the Free Software Foundation; either version 2 of the License, or
+* (at your option) any later version.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with this program; if not, write to the Free Software
+* Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+*
+* You may alternatively use this source under the terms of
+* the KlayGE Proprietary License (KPL). You can obtained such a license
+* from http://www.klayge.org/licensing/.
+*/
+
+#include <KlayGE/KlayGE.hpp>
+#include <KlayGE/RenderEffect.hpp>
+#include <KlayGE/ShaderCache.hpp>
+
+#include <algorithm>
+#include <set>
+
+#include <KlayGE/ShaderCodeDependency.hpp>
+
+namespace
+{
+	bool IsIdentifierChar(char ch)
+	{
+		return ((ch >= 'a') && (ch <= 'z')) || ((ch >= 'A') && (ch <= 'Z')) || ((ch >= '0') && (ch <= '9')) || ('_' == ch);
+	}
+}
+
+namespace KlayGE
+{
+	ShaderCodeDependency::ShaderCodeDependency(RenderEffect const & effect)
+	{
+		for (uint32_t i = 0; i < effect.NumShaders(); ++ i)
+		{
+			this->Split(effect.ShaderByIndex(i).str());
+		}
+	}
+
+	ShaderCodeDependency::ShaderCodeDependency(std::string const & code)
+	{
+		this->Split(code);
+	}
+
+	void ShaderCodeDependency::ReachableCode(std::string const & func_name, std::vector<std::string>& items) const
+	{
+		std::vector<bool> reached(items_.size(), false);
+		std::vector<std::string> names(1, func_name);
+		for (size_t i = 0; i < root_items_.size(); ++ i)
+		{
+			reached[root_items_[i]] = true;
+			names.insert(names.end(), items_[root_items_[i]].refs.begin(), items_[root_items_[i]].refs.end());
+		}
+
+		std::set<std::string> visited;
+		while (!names.empty())
+		{
+			std::string name = names.back();
+			names.pop_back();
+			if (!visited.insert(name).second)
+			{
+				continue;
+			}
+
+			KLAYGE_AUTO(iter, definitions_.find(name));
+			if (iter != definitions_.end())
+			{
+				for (size_t i = 0; i < iter->second.size(); ++ i)
+				{
+					size_t const item = iter->second[i];
+					if (!reached[item])
+					{
+						reached[item] = true;
+						names.insert(names.end(), items_[item].refs.begin(), items_[item].refs.end());
+					}
+				}
+			}
+		}
+
+		for (size_t i = 0; i < items_.size(); ++ i)
+		{
+			if (reached[i])
+			{
+				items.push_back(items_[i].text);
+			}
+		}
+	}
+
+	void ShaderCodeDependency::AppendCode(ShaderCacheKey& key, std::string const & func_name) const
+	{
+		std::vector<std::string> items;
+		this->ReachableCode(func_name, items);
+		for (size_t i = 0; i < items.size(); ++ i)
+		{
+			key.Append(items[i]);
+		}
+	}
+
+	void ShaderCodeDependency::Split(std::string const & code)
+	{
+		Item item;
+		std::vector<std::string> names;
+		std::vector<std::string> top_idents;
+		std::vector<std::string> var_names;
+		std::string last_ident;
+		size_t begin = 0;
+		int paren = 0;
+		int bracket = 0;
+		int brace = 0;
+		bool is_func = false;
+		bool is_struct = false;
+		bool struct_name_next = false;
+		bool has_brace = false;
+		bool has_assign = false;
+		bool in_init = false;
+		bool has_tokens = false;
+
+		size_t i = 0;
+		while (i < code.size())
+		{
+			char const ch = code[i];
+			bool end_item = false;
+
+			if (('/' == ch) && (i + 1 < code.size()) && ('/' == code[i + 1]))
+			{
+				i = std::min(code.find('\n', i), code.size());
+				continue;
+			}
+			if (('/' == ch) && (i + 1 < code.size()) && ('*' == code[i + 1]))
+			{
+				size_t const end = code.find("*/", i + 2);
+				i = (std::string::npos == end) ? code.size() : end + 2;
+				continue;
+			}
+
+			if (('#' == ch) && !has_tokens)
+			{
+				// Preprocessor line, with its continuations
+				size_t end = i;
+				for (;;)
+				{
+					end = std::min(code.find('\n', end), code.size());
+					size_t last = end;
+					while ((last > i) && (('\r' == code[last - 1]) || (' ' == code[last - 1])))
+					{
+						-- last;
+					}
+					if ((end < code.size()) && (last > i) && ('\\' == code[last - 1]))
+					{
+						++ end;
+					}
+					else
+					{
+						break;
+					}
+				}
+
+				Item pp_item;
+				pp_item.text = code.substr(i, end - i);
+				for (size_t j = 0; j < pp_item.text.size();)
+				{
+					if (IsIdentifierChar(pp_item.text[j]))
+					{
+						size_t k = j;
+						while ((k < pp_item.text.size()) && IsIdentifierChar(pp_item.text[k]))
+						{
+							++ k;
+						}
+						pp_item.refs.push_back(pp_item.text.substr(j, k - j));
+						j = k;
+					}
+					else
+					{
+						++ j;
+					}
+				}
+				root_items_.push_back(items_.size());
+				items_.push_back(pp_item);
+
+				i = end;
+				begin = i;
+				continue;
+			}
+
+			if ('"' == ch)
+			{
+				size_t j = i + 1;
+				while ((j < code.size()) && (code[j] != '"'))
+				{
+					j += ('\\' == code[j]) ? 2 : 1;
+				}
+				i = std::min(j + 1, code.size());
+				has_tokens = true;
+				continue;
+			}
+
+			if (IsIdentifierChar(ch))
+			{
+				size_t j = i;
+				while ((j < code.size()) && IsIdentifierChar(code[j]))
+				{
+					++ j;
+				}
+
+				if ((ch >= '0') && (ch <= '9'))
+				{
+					last_ident.clear();
+				}
+				else
+				{
+					std::string ident = code.substr(i, j - i);
+					item.refs.push_back(ident);
+					if ((0 == paren) && (0 == bracket) && (0 == brace))
+					{
+						if (struct_name_next)
+						{
+							names.push_back(ident);
+							struct_name_next = false;
+						}
+						else if (("struct" == ident) && !has_tokens)
+						{
+							is_struct = true;
+							struct_name_next = true;
+						}
+						else if (is_struct && has_brace)
+						{
+							// Variables declared with the struct
+							names.push_back(ident);
+						}
+						else if (!is_func && !is_struct)
+						{
+							top_idents.push_back(ident);
+						}
+					}
+					last_ident = ident;
+				}
+
+				i = j;
+				has_tokens = true;
+				continue;
+			}
+
+			// A variable is named by the identifier before its initializer, semantic, array size or the end
+			bool const top_level = (0 == paren) && (0 == bracket) && (0 == brace);
+			if (top_level && !is_func && !is_struct && !in_init && !last_ident.empty()
+				&& (('=' == ch) || (':' == ch) || ('[' == ch) || (',' == ch) || (';' == ch)))
+			{
+				var_names.push_back(last_ident);
+			}
+
+			switch (ch)
+			{
+			case '(':
+				if ((0 == paren) && (0 == bracket) && (0 == brace) && !has_brace && !has_assign
+					&& !is_func && !is_struct && !last_ident.empty())
+				{
+					is_func = true;
+					names.push_back(last_ident);
+				}
+				++ paren;
+				break;
+
+			case ')':
+				-- paren;
+				break;
+
+			case '[':
+				++ bracket;
+				break;
+
+			case ']':
+				-- bracket;
+				break;
+
+			case '{':
+				++ brace;
+				has_brace = true;
+				break;
+
+			case '}':
+				-- brace;
+				if ((0 == brace) && is_func)
+				{
+					end_item = true;
+				}
+				break;
+
+			case '=':
+				if (top_level)
+				{
+					has_assign = true;
+					in_init = true;
+				}
+				break;
+
+			case ',':
+				if (top_level)
+				{
+					in_init = false;
+				}
+				break;
+
+			case ';':
+				if (top_level)
+				{
+					end_item = true;
+				}
+				break;
+
+			default:
+				break;
+			}
+
+			if ((ch != ' ') && (ch != '\t') && (ch != '\r') && (ch != '\n'))
+			{
+				has_tokens = true;
+				last_ident.clear();
+			}
+			++ i;
+
+			if (end_item)
+			{
+				if (!is_func && !is_struct)
+				{
+					// Variables are named by all their identifiers, types included, if the names can't be told.
+					//  Other blocks are kept for all stages.
+					if (!has_brace || has_assign)
+					{
+						names.swap(var_names.empty() ? top_idents : var_names);
+					}
+				}
+				this->AddItem(item, names, code.substr(begin, i - begin));
+
+				item = Item();
+				names.clear();
+				top_idents.clear();
+				var_names.clear();
+				last_ident.clear();
+				begin = i;
+				paren = bracket = brace = 0;
+				is_func = is_struct = struct_name_next = has_brace = has_assign = in_init = has_tokens = false;
+			}
+		}
+
+		if (has_tokens)
+		{
+			names.clear();
+			this->AddItem(item, names, code.substr(begin));
+		}
+	}
+
+	void ShaderCodeDependency::AddItem(Item& item, std::vector<std::string> const & names, std::string const & text)
+	{
+		item.text = text;
+		if (names.empty())
+		{
+			root_items_.push_back(items_.size());
+		}
+		else
+		{
+			for (size_t i = 0; i < names.size(); ++ i)
+			{
+				definitions_[names[i]].push_back(items_.size());
+			}
+		}
+		items_.push_back(item);
+	}
+}
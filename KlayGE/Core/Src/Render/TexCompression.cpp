@@ -59,20 +59,33 @@ namespace KlayGE
 
 			for (uint32_t x_base = 0; x_base < width; x_base += block_width_)
 			{
-				for (uint32_t y = 0; y < block_height_; ++ y)
+				if ((x_base + block_width_ <= width) && (y_base + block_height_ <= height))
 				{
-					for (uint32_t x = 0; x < block_width_; ++ x)
+					// Interior block, gather it row by row
+					for (uint32_t y = 0; y < block_height_; ++ y)
 					{
-						if ((x_base + x < width) && (y_base + y < height))
-						{
-							memcpy(&uncompressed[(y * block_width_ + x) * elem_size],
-								&src[(y_base + y) * in_row_pitch + (x_base + x) * elem_size],
-								elem_size);
-						}
-						else
+						memcpy(&uncompressed[y * block_width_ * elem_size],
+							&src[(y_base + y) * in_row_pitch + x_base * elem_size],
+							block_width_ * elem_size);
+					}
+				}
+				else
+				{
+					for (uint32_t y = 0; y < block_height_; ++ y)
+					{
+						for (uint32_t x = 0; x < block_width_; ++ x)
 						{
-							memset(&uncompressed[(y * block_width_ + x) * elem_size],
-								0, elem_size);
+							if ((x_base + x < width) && (y_base + y < height))
+							{
+								memcpy(&uncompressed[(y * block_width_ + x) * elem_size],
+									&src[(y_base + y) * in_row_pitch + (x_base + x) * elem_size],
+									elem_size);
+							}
+							else
+							{
+								memset(&uncompressed[(y * block_width_ + x) * elem_size],
+									0, elem_size);
+							}
 						}
 					}
 				}
@@ -83,6 +96,23 @@ namespace KlayGE
 		}
 	}
 
+	void TexCompression::EncodeMem(uint32_t width, uint32_t height, uint32_t depth,
+		void* output, uint32_t out_row_pitch, uint32_t out_slice_pitch,
+		void const * input, uint32_t in_row_pitch, uint32_t in_slice_pitch,
+		TexCompressionMethod method)
+	{
+		uint8_t const * src = static_cast<uint8_t const *>(input);
+		uint8_t* dst = static_cast<uint8_t*>(output);
+		for (uint32_t z = 0; z < depth; ++ z)
+		{
+			this->EncodeMem(width, height, dst, out_row_pitch, out_slice_pitch,
+				src, in_row_pitch, in_slice_pitch, method);
+
+			src += in_slice_pitch;
+			dst += out_slice_pitch;
+		}
+	}
+
 	void TexCompression::DecodeMem(uint32_t width, uint32_t height,
 		void* output, uint32_t out_row_pitch, uint32_t out_slice_pitch,
 		void const * input, uint32_t in_row_pitch, uint32_t in_slice_pitch)
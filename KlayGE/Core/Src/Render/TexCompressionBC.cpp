@@ -35,10 +35,18 @@
 #include <KlayGE/Texture.hpp>
 #include <KFL/Thread.hpp>
 #include <KFL/Half.hpp>
+#include <KFL/CpuInfo.hpp>
 
 #include <vector>
+#include <algorithm>
 #include <cstring>
 #include <boost/assert.hpp>
+#ifdef KLAYGE_SSE2_SUPPORT
+#include <emmintrin.h>
+#endif
+#ifdef KLAYGE_AVX2_SUPPORT
+#include <immintrin.h>
+#endif
 
 #include <KlayGE/TexCompressionBC.hpp>
 
@@ -875,6 +883,528 @@ namespace
 			break;
 		}
 	}
+
+	// Per-channel bounding box of a 4x4 block of ARGB pixels
+	void BlockMinMaxColorsScalar(ARGBColor32 const * argb, ARGBColor32& min_clr, ARGBColor32& max_clr)
+	{
+		min_clr = max_clr = argb[0];
+		for (int i = 1; i < 16; ++ i)
+		{
+			for (int ch = 0; ch < 4; ++ ch)
+			{
+				min_clr[ch] = std::min(min_clr[ch], argb[i][ch]);
+				max_clr[ch] = std::max(max_clr[ch], argb[i][ch]);
+			}
+		}
+	}
+
+	void BlockMinMaxColors(ARGBColor32 const * argb, ARGBColor32& min_clr, ARGBColor32& max_clr)
+	{
+#ifdef KLAYGE_SSE2_SUPPORT
+		__m128i const * src = reinterpret_cast<__m128i const *>(argb);
+		__m128i const c0 = _mm_loadu_si128(src + 0);
+		__m128i const c1 = _mm_loadu_si128(src + 1);
+		__m128i const c2 = _mm_loadu_si128(src + 2);
+		__m128i const c3 = _mm_loadu_si128(src + 3);
+
+		__m128i mn = _mm_min_epu8(_mm_min_epu8(c0, c1), _mm_min_epu8(c2, c3));
+		__m128i mx = _mm_max_epu8(_mm_max_epu8(c0, c1), _mm_max_epu8(c2, c3));
+		mn = _mm_min_epu8(mn, _mm_shuffle_epi32(mn, _MM_SHUFFLE(1, 0, 3, 2)));
+		mx = _mm_max_epu8(mx, _mm_shuffle_epi32(mx, _MM_SHUFFLE(1, 0, 3, 2)));
+		mn = _mm_min_epu8(mn, _mm_shuffle_epi32(mn, _MM_SHUFFLE(2, 3, 0, 1)));
+		mx = _mm_max_epu8(mx, _mm_shuffle_epi32(mx, _MM_SHUFFLE(2, 3, 0, 1)));
+
+		min_clr.ARGB() = static_cast<uint32_t>(_mm_cvtsi128_si32(mn));
+		max_clr.ARGB() = static_cast<uint32_t>(_mm_cvtsi128_si32(mx));
+#else
+		BlockMinMaxColorsScalar(argb, min_clr, max_clr);
+#endif
+	}
+
+	// Projects 16 pixels onto the color direction (dirr, dirg, dirb)
+	void BlockColorDotsScalar(int* dots, ARGBColor32 const * argb, int dirr, int dirg, int dirb)
+	{
+		for (int i = 0; i < 16; ++ i)
+		{
+			dots[i] = argb[i].r() * dirr + argb[i].g() * dirg + argb[i].b() * dirb;
+		}
+	}
+
+	void BlockColorDots(int* dots, ARGBColor32 const * argb, int dirr, int dirg, int dirb)
+	{
+#ifdef KLAYGE_SSE2_SUPPORT
+		__m128i const zero = _mm_setzero_si128();
+		__m128i const dir = _mm_setr_epi16(static_cast<short>(dirb), static_cast<short>(dirg), static_cast<short>(dirr), 0,
+			static_cast<short>(dirb), static_cast<short>(dirg), static_cast<short>(dirr), 0);
+		for (int i = 0; i < 16; i += 4)
+		{
+			__m128i const pixels = _mm_loadu_si128(reinterpret_cast<__m128i const *>(&argb[i]));
+			__m128 const lo = _mm_castsi128_ps(_mm_madd_epi16(_mm_unpacklo_epi8(pixels, zero), dir));
+			__m128 const hi = _mm_castsi128_ps(_mm_madd_epi16(_mm_unpackhi_epi8(pixels, zero), dir));
+			__m128i const bg = _mm_castps_si128(_mm_shuffle_ps(lo, hi, _MM_SHUFFLE(2, 0, 2, 0)));
+			__m128i const ra = _mm_castps_si128(_mm_shuffle_ps(lo, hi, _MM_SHUFFLE(3, 1, 3, 1)));
+			_mm_storeu_si128(reinterpret_cast<__m128i*>(&dots[i]), _mm_add_epi32(bg, ra));
+		}
+#else
+		BlockColorDotsScalar(dots, argb, dirr, dirg, dirb);
+#endif
+	}
+
+	// Selects the 4-color BC1 index of each projected pixel, and packs them into a bitmap
+	uint32_t BlockColorIndicesScalar(int const * dots, int c0_point, int half_point, int c3_point)
+	{
+		uint32_t mask = 0;
+		for (int i = 15; i >= 0; -- i)
+		{
+			mask <<= 2;
+			int dot = dots[i];
+
+			if (dot < half_point)
+			{
+				mask |= (dot < c0_point) ? 1 : 3;
+			}
+			else
+			{
+				mask |= (dot < c3_point) ? 2 : 0;
+			}
+		}
+		return mask;
+	}
+
+	uint32_t BlockColorIndices(int const * dots, int c0_point, int half_point, int c3_point)
+	{
+#ifdef KLAYGE_SSE2_SUPPORT
+		uint32_t mask = 0;
+		__m128i const c0 = _mm_set1_epi32(c0_point);
+		__m128i const hp = _mm_set1_epi32(half_point);
+		__m128i const c3 = _mm_set1_epi32(c3_point);
+		__m128i const two = _mm_set1_epi32(2);
+		__m128i const three = _mm_set1_epi32(3);
+		__m128i const weights = _mm_setr_epi16(1, 0, 4, 0, 16, 0, 64, 0);
+		for (int i = 0; i < 16; i += 4)
+		{
+			// (dot < half) ? ((dot < c0) ? 1 : 3) : ((dot < c3) ? 2 : 0)
+			__m128i const dot = _mm_loadu_si128(reinterpret_cast<__m128i const *>(&dots[i]));
+			__m128i const lower = _mm_cmplt_epi32(dot, hp);
+			__m128i const lo_ind = _mm_sub_epi32(three, _mm_and_si128(_mm_cmplt_epi32(dot, c0), two));
+			__m128i const hi_ind = _mm_and_si128(_mm_cmplt_epi32(dot, c3), two);
+			__m128i ind = _mm_or_si128(_mm_and_si128(lower, lo_ind), _mm_andnot_si128(lower, hi_ind));
+
+			// Shift the 4 indices into their 2-bit fields and gather them into one byte
+			ind = _mm_madd_epi16(ind, weights);
+			ind = _mm_or_si128(ind, _mm_shuffle_epi32(ind, _MM_SHUFFLE(1, 0, 3, 2)));
+			ind = _mm_or_si128(ind, _mm_shuffle_epi32(ind, _MM_SHUFFLE(2, 3, 0, 1)));
+			mask |= (static_cast<uint32_t>(_mm_cvtsi128_si32(ind)) & 0xFF) << (i * 2);
+		}
+		return mask;
+#else
+		return BlockColorIndicesScalar(dots, c0_point, half_point, c3_point);
+#endif
+	}
+
+	void EncodeBC4BlockScalar(BC4Block& bc4, uint8_t const * r)
+	{
+		// find min/max color
+		int min, max;
+		min = max = r[0];
+
+		for (int i = 1; i < 16; ++ i)
+		{
+			min = std::min<int>(min, r[i]);
+			max = std::max<int>(max, r[i]);
+		}
+
+		// encode them
+		bc4.alpha_0 = static_cast<uint8_t>(max);
+		bc4.alpha_1 = static_cast<uint8_t>(min);
+
+		// determine bias and emit color indices
+		int dist = max - min;
+		int bias = min * 7 - (dist >> 1);
+		int dist4 = dist * 4;
+		int dist2 = dist * 2;
+		int bits = 0, mask = 0;
+
+		int dest = 0;
+		for (int i = 0; i < 16; ++ i)
+		{
+			int a = r[i] * 7 - bias;
+			int ind, t;
+
+			// select index (hooray for bit magic)
+			t = (dist4 - a) >> 31;  ind = t & 4; a -= dist4 & t;
+			t = (dist2 - a) >> 31;  ind += t & 2; a -= dist2 & t;
+			t = (dist - a) >> 31;   ind += t & 1;
+
+			ind = -ind & 7;
+			ind ^= (2 > ind);
+
+			// write index
+			mask |= ind << bits;
+			if ((bits += 3) >= 8)
+			{
+				bc4.bitmap[dest] = static_cast<uint8_t>(mask);
+				++ dest;
+				mask >>= 8;
+				bits -= 8;
+			}
+		}
+	}
+
+#ifdef KLAYGE_SSE2_SUPPORT
+	void PackBC4Indices(BC4Block& bc4, uint8_t const * ind8)
+	{
+		for (int i = 0; i < 2; ++ i)
+		{
+			uint32_t mask = 0;
+			for (int j = 0; j < 8; ++ j)
+			{
+				mask |= ind8[i * 8 + j] << (j * 3);
+			}
+			bc4.bitmap[i * 3 + 0] = static_cast<uint8_t>(mask >> 0);
+			bc4.bitmap[i * 3 + 1] = static_cast<uint8_t>(mask >> 8);
+			bc4.bitmap[i * 3 + 2] = static_cast<uint8_t>(mask >> 16);
+		}
+	}
+
+	// Same index selection as EncodeBC4BlockScalar, 8 pixels per 16-bit lane group
+	void EncodeBC4BlockSSE2(BC4Block& bc4, uint8_t const * r)
+	{
+		__m128i const r8 = _mm_loadu_si128(reinterpret_cast<__m128i const *>(r));
+		__m128i mn = _mm_min_epu8(r8, _mm_srli_si128(r8, 8));
+		__m128i mx = _mm_max_epu8(r8, _mm_srli_si128(r8, 8));
+		mn = _mm_min_epu8(mn, _mm_srli_si128(mn, 4));
+		mx = _mm_max_epu8(mx, _mm_srli_si128(mx, 4));
+		mn = _mm_min_epu8(mn, _mm_srli_si128(mn, 2));
+		mx = _mm_max_epu8(mx, _mm_srli_si128(mx, 2));
+		mn = _mm_min_epu8(mn, _mm_srli_si128(mn, 1));
+		mx = _mm_max_epu8(mx, _mm_srli_si128(mx, 1));
+		int const min = _mm_cvtsi128_si32(mn) & 0xFF;
+		int const max = _mm_cvtsi128_si32(mx) & 0xFF;
+
+		bc4.alpha_0 = static_cast<uint8_t>(max);
+		bc4.alpha_1 = static_cast<uint8_t>(min);
+
+		int const dist = max - min;
+		int const bias = min * 7 - (dist >> 1);
+
+		__m128i const zero = _mm_setzero_si128();
+		__m128i const seven = _mm_set1_epi16(7);
+		__m128i const v_bias = _mm_set1_epi16(static_cast<short>(bias));
+		__m128i const v_dist = _mm_set1_epi16(static_cast<short>(dist));
+		__m128i const v_dist2 = _mm_set1_epi16(static_cast<short>(dist * 2));
+		__m128i const v_dist4 = _mm_set1_epi16(static_cast<short>(dist * 4));
+		__m128i const v_one = _mm_set1_epi16(1);
+		__m128i const v_two = _mm_set1_epi16(2);
+		__m128i const v_four = _mm_set1_epi16(4);
+
+		__m128i inds[2];
+		for (int i = 0; i < 2; ++ i)
+		{
+			__m128i a = _mm_sub_epi16(_mm_mullo_epi16(i ? _mm_unpackhi_epi8(r8, zero) : _mm_unpacklo_epi8(r8, zero), seven), v_bias);
+			__m128i t = _mm_srai_epi16(_mm_sub_epi16(v_dist4, a), 15);
+			__m128i ind = _mm_and_si128(t, v_four);
+			a = _mm_sub_epi16(a, _mm_and_si128(v_dist4, t));
+			t = _mm_srai_epi16(_mm_sub_epi16(v_dist2, a), 15);
+			ind = _mm_add_epi16(ind, _mm_and_si128(t, v_two));
+			a = _mm_sub_epi16(a, _mm_and_si128(v_dist2, t));
+			t = _mm_srai_epi16(_mm_sub_epi16(v_dist, a), 15);
+			ind = _mm_add_epi16(ind, _mm_and_si128(t, v_one));
+
+			ind = _mm_and_si128(_mm_sub_epi16(zero, ind), seven);
+			inds[i] = _mm_xor_si128(ind, _mm_and_si128(_mm_cmpgt_epi16(v_two, ind), v_one));
+		}
+
+		array<uint8_t, 16> ind8;
+		_mm_storeu_si128(reinterpret_cast<__m128i*>(&ind8[0]), _mm_packus_epi16(inds[0], inds[1]));
+		PackBC4Indices(bc4, &ind8[0]);
+	}
+#endif
+
+#ifdef KLAYGE_AVX2_SUPPORT
+	// Two blocks at once, one in each 128-bit lane. The in-lane operations are the ones of EncodeBC4BlockSSE2.
+	void EncodeBC4BlocksAVX2(BC4Block* bc4, uint8_t const * r)
+	{
+		__m256i const r8 = _mm256_loadu_si256(reinterpret_cast<__m256i const *>(r));
+		__m256i mn = _mm256_min_epu8(r8, _mm256_srli_si256(r8, 8));
+		__m256i mx = _mm256_max_epu8(r8, _mm256_srli_si256(r8, 8));
+		mn = _mm256_min_epu8(mn, _mm256_srli_si256(mn, 4));
+		mx = _mm256_max_epu8(mx, _mm256_srli_si256(mx, 4));
+		mn = _mm256_min_epu8(mn, _mm256_srli_si256(mn, 2));
+		mx = _mm256_max_epu8(mx, _mm256_srli_si256(mx, 2));
+		mn = _mm256_min_epu8(mn, _mm256_srli_si256(mn, 1));
+		mx = _mm256_max_epu8(mx, _mm256_srli_si256(mx, 1));
+
+		short bias[2];
+		short dist[2];
+		for (int b = 0; b < 2; ++ b)
+		{
+			int const min = _mm_cvtsi128_si32(b ? _mm256_extracti128_si256(mn, 1) : _mm256_castsi256_si128(mn)) & 0xFF;
+			int const max = _mm_cvtsi128_si32(b ? _mm256_extracti128_si256(mx, 1) : _mm256_castsi256_si128(mx)) & 0xFF;
+
+			bc4[b].alpha_0 = static_cast<uint8_t>(max);
+			bc4[b].alpha_1 = static_cast<uint8_t>(min);
+
+			dist[b] = static_cast<short>(max - min);
+			bias[b] = static_cast<short>(min * 7 - (dist[b] >> 1));
+		}
+
+		__m256i const zero = _mm256_setzero_si256();
+		__m256i const seven = _mm256_set1_epi16(7);
+		__m256i const v_bias = _mm256_inserti128_si256(_mm256_set1_epi16(bias[0]), _mm_set1_epi16(bias[1]), 1);
+		__m256i const v_dist = _mm256_inserti128_si256(_mm256_set1_epi16(dist[0]), _mm_set1_epi16(dist[1]), 1);
+		__m256i const v_dist2 = _mm256_add_epi16(v_dist, v_dist);
+		__m256i const v_dist4 = _mm256_add_epi16(v_dist2, v_dist2);
+		__m256i const v_one = _mm256_set1_epi16(1);
+		__m256i const v_two = _mm256_set1_epi16(2);
+		__m256i const v_four = _mm256_set1_epi16(4);
+
+		__m256i inds[2];
+		for (int i = 0; i < 2; ++ i)
+		{
+			__m256i a = _mm256_sub_epi16(_mm256_mullo_epi16(i ? _mm256_unpackhi_epi8(r8, zero) : _mm256_unpacklo_epi8(r8, zero), seven), v_bias);
+			__m256i t = _mm256_srai_epi16(_mm256_sub_epi16(v_dist4, a), 15);
+			__m256i ind = _mm256_and_si256(t, v_four);
+			a = _mm256_sub_epi16(a, _mm256_and_si256(v_dist4, t));
+			t = _mm256_srai_epi16(_mm256_sub_epi16(v_dist2, a), 15);
+			ind = _mm256_add_epi16(ind, _mm256_and_si256(t, v_two));
+			a = _mm256_sub_epi16(a, _mm256_and_si256(v_dist2, t));
+			t = _mm256_srai_epi16(_mm256_sub_epi16(v_dist, a), 15);
+			ind = _mm256_add_epi16(ind, _mm256_and_si256(t, v_one));
+
+			ind = _mm256_and_si256(_mm256_sub_epi16(zero, ind), seven);
+			inds[i] = _mm256_xor_si256(ind, _mm256_and_si256(_mm256_cmpgt_epi16(v_two, ind), v_one));
+		}
+
+		// The pack is in-lane too, so the indices of each block stay in its own lane
+		array<uint8_t, 32> ind8;
+		_mm256_storeu_si256(reinterpret_cast<__m256i*>(&ind8[0]), _mm256_packus_epi16(inds[0], inds[1]));
+		PackBC4Indices(bc4[0], &ind8[0]);
+		PackBC4Indices(bc4[1], &ind8[16]);
+	}
+#endif
+
+	int F162Int(uint16_t input, bool signed_fmt)
+	{
+		// NaN and Inf are clamped to the largest finite value, negative values are clamped to 0 in unsigned formats
+		int const magnitude = std::min(static_cast<int>(input & 0x7FFF), 0x7BFF);
+		if (input & 0x8000)
+		{
+			return signed_fmt ? -magnitude : 0;
+		}
+		else
+		{
+			return magnitude;
+		}
+	}
+
+	uint32_t BC6AnchorIndex(uint32_t partitions, uint32_t shape, uint32_t region)
+	{
+		return (region > 0) ? ((FIX_UP_TABLE[partitions - 2][shape] >> (region * 4)) & 0xF) : 0;
+	}
+
+	// Principal axis of the pixels in a region, extended to the extremes of their projections
+	// and clamped to their bounding box
+	void FitBC6Endpoints(float3 const * pixels, uint32_t partitions, uint32_t shape, uint32_t region,
+		float3& e0, float3& e1)
+	{
+		float3 mean(0, 0, 0);
+		float3 min_clr(+1e10f, +1e10f, +1e10f);
+		float3 max_clr(-1e10f, -1e10f, -1e10f);
+		uint32_t num = 0;
+		for (uint32_t i = 0; i < 16; ++ i)
+		{
+			if (GetPartition(partitions, shape, i) == region)
+			{
+				mean += pixels[i];
+				min_clr = MathLib::minimize(min_clr, pixels[i]);
+				max_clr = MathLib::maximize(max_clr, pixels[i]);
+				++ num;
+			}
+		}
+		BOOST_ASSERT(num > 0);
+		mean /= static_cast<float>(num);
+
+		float cov[6] = { 0, 0, 0, 0, 0, 0 };
+		for (uint32_t i = 0; i < 16; ++ i)
+		{
+			if (GetPartition(partitions, shape, i) == region)
+			{
+				float3 const diff = pixels[i] - mean;
+				cov[0] += diff.x() * diff.x();
+				cov[1] += diff.x() * diff.y();
+				cov[2] += diff.x() * diff.z();
+				cov[3] += diff.y() * diff.y();
+				cov[4] += diff.y() * diff.z();
+				cov[5] += diff.z() * diff.z();
+			}
+		}
+
+		float3 axis(1, 1, 1);
+		for (int iter = 0; iter < 4; ++ iter)
+		{
+			float3 const v(cov[0] * axis.x() + cov[1] * axis.y() + cov[2] * axis.z(),
+				cov[1] * axis.x() + cov[3] * axis.y() + cov[4] * axis.z(),
+				cov[2] * axis.x() + cov[4] * axis.y() + cov[5] * axis.z());
+			float const len = MathLib::length(v);
+			if (len < 1e-6f)
+			{
+				break;
+			}
+			axis = v / len;
+		}
+
+		float min_t = 0;
+		float max_t = 0;
+		for (uint32_t i = 0; i < 16; ++ i)
+		{
+			if (GetPartition(partitions, shape, i) == region)
+			{
+				float const t = MathLib::dot(pixels[i] - mean, axis);
+				min_t = std::min(min_t, t);
+				max_t = std::max(max_t, t);
+			}
+		}
+
+		e0 = MathLib::maximize(MathLib::minimize(mean + axis * min_t, max_clr), min_clr);
+		e1 = MathLib::maximize(MathLib::minimize(mean + axis * max_t, max_clr), min_clr);
+	}
+
+	// Error of a shape before quantization, used to rank the 2-region shapes
+	float EstimateBC6ShapeError(float3 const * pixels, uint32_t shape)
+	{
+		float error = 0;
+		for (uint32_t p = 0; p < 2; ++ p)
+		{
+			float3 e0, e1;
+			FitBC6Endpoints(pixels, 2, shape, p, e0, e1);
+
+			float3 const dir = e1 - e0;
+			float const len_sq = MathLib::dot(dir, dir);
+			for (uint32_t i = 0; i < 16; ++ i)
+			{
+				if (GetPartition(2, shape, i) == p)
+				{
+					float t = 0;
+					if (len_sq > 0)
+					{
+						t = MathLib::clamp(MathLib::dot(pixels[i] - e0, dir) / len_sq, 0.0f, 1.0f);
+						t = MathLib::round(t * 7) / 7;
+					}
+					float3 const diff = e0 + dir * t - pixels[i];
+					error += MathLib::dot(diff, diff);
+				}
+			}
+		}
+		return error;
+	}
+
+	// Least squares endpoints in the unquantized domain for the given indices, kept in the bounding box
+	void RefineBC6Endpoints(float3 const * pixels, uint32_t partitions, uint32_t shape, uint8_t const * indices,
+		int const * weights, std::pair<float3, float3>* unq_end_pts)
+	{
+		for (uint32_t p = 0; p < partitions; ++ p)
+		{
+			float a = 0, b = 0, c = 0;
+			float3 rhs0(0, 0, 0), rhs1(0, 0, 0);
+			float3 min_clr(+1e10f, +1e10f, +1e10f);
+			float3 max_clr(-1e10f, -1e10f, -1e10f);
+			for (uint32_t i = 0; i < 16; ++ i)
+			{
+				if (GetPartition(partitions, shape, i) == p)
+				{
+					min_clr = MathLib::minimize(min_clr, pixels[i]);
+					max_clr = MathLib::maximize(max_clr, pixels[i]);
+
+					float const t = weights[indices[i]] / 64.0f;
+					float const s = 1 - t;
+					a += s * s;
+					b += s * t;
+					c += t * t;
+					rhs0 += pixels[i] * s;
+					rhs1 += pixels[i] * t;
+				}
+			}
+
+			float const det = a * c - b * b;
+			if (MathLib::abs(det) > 1e-6f)
+			{
+				float const inv_det = 1 / det;
+				unq_end_pts[p].first = MathLib::maximize(MathLib::minimize((rhs0 * c - rhs1 * b) * inv_det, max_clr), min_clr);
+				unq_end_pts[p].second = MathLib::maximize(MathLib::minimize((rhs1 * a - rhs0 * b) * inv_det, max_clr), min_clr);
+			}
+		}
+	}
+
+	class EncodeBlockRowsFunc
+	{
+	public:
+		EncodeBlockRowsFunc(TexCompression& codec, uint32_t width, uint32_t height,
+				void* output, uint32_t out_row_pitch, void const * input, uint32_t in_row_pitch,
+				TexCompressionMethod method)
+			: codec_(&codec), width_(width), height_(height),
+				output_(output), out_row_pitch_(out_row_pitch), input_(input), in_row_pitch_(in_row_pitch),
+				method_(method)
+		{
+		}
+
+		void operator()()
+		{
+			codec_->TexCompression::EncodeMem(width_, height_, output_, out_row_pitch_, 0,
+				input_, in_row_pitch_, 0, method_);
+		}
+
+	private:
+		TexCompression* codec_;
+		uint32_t width_;
+		uint32_t height_;
+		void* output_;
+		uint32_t out_row_pitch_;
+		void const * input_;
+		uint32_t in_row_pitch_;
+		TexCompressionMethod method_;
+	};
+
+	// Splits the rows of blocks of all slices over the global thread pool. Only for codecs with a reentrant EncodeBlock.
+	void EncodeMemParallel(TexCompression& codec, uint32_t width, uint32_t height, uint32_t depth,
+		void* output, uint32_t out_row_pitch, uint32_t out_slice_pitch,
+		void const * input, uint32_t in_row_pitch, uint32_t in_slice_pitch,
+		TexCompressionMethod method)
+	{
+		uint32_t const block_height = codec.BlockHeight();
+		uint32_t const num_block_rows = (height + block_height - 1) / block_height;
+		uint32_t const num_tasks = std::min(num_block_rows * depth, static_cast<uint32_t>(CPUInfo().NumHWThreads()));
+		if (num_tasks <= 1)
+		{
+			codec.TexCompression::EncodeMem(width, height, depth, output, out_row_pitch, out_slice_pitch,
+				input, in_row_pitch, in_slice_pitch, method);
+			return;
+		}
+
+		// A task never crosses a slice
+		uint32_t const rows_per_task = std::min((num_block_rows * depth + num_tasks - 1) / num_tasks, num_block_rows);
+
+		thread_pool& tp = Context::Instance().ThreadPool();
+		std::vector<joiner<void> > joiners;
+		joiners.reserve(num_tasks + depth);
+		for (uint32_t z = 0; z < depth; ++ z)
+		{
+			uint8_t* slice_output = static_cast<uint8_t*>(output) + z * out_slice_pitch;
+			uint8_t const * slice_input = static_cast<uint8_t const *>(input) + z * in_slice_pitch;
+			for (uint32_t row = 0; row < num_block_rows; row += rows_per_task)
+			{
+				uint32_t const y_base = row * block_height;
+				uint32_t const task_height = std::min(rows_per_task * block_height, height - y_base);
+				joiners.push_back(tp(EncodeBlockRowsFunc(codec, width, task_height,
+					slice_output + row * out_row_pitch, out_row_pitch,
+					slice_input + y_base * in_row_pitch, in_row_pitch, method)));
+			}
+		}
+		for (size_t i = 0; i < joiners.size(); ++ i)
+		{
+			joiners[i]();
+		}
+	}
 }
 
 namespace KlayGE
@@ -1053,10 +1583,7 @@ namespace KlayGE
 		int dirb = color[0].b() - color[1].b();
 
 		int dots[16];
-		for (int i = 0; i < 16; ++ i)
-		{
-			dots[i] = argb[i].r() * dirr + argb[i].g() * dirg + argb[i].b() * dirb;
-		}
+		BlockColorDots(dots, argb, dirr, dirg, dirb);
 
 		if (alpha)
 		{
@@ -1098,20 +1625,7 @@ namespace KlayGE
 			int half_point = (stops[3] + stops[2]) >> 1;
 			int c3_point = (stops[2] + stops[0]) >> 1;
 
-			for (int i = 15; i >= 0; -- i)
-			{
-				mask <<= 2;
-				int dot = dots[i];
-
-				if (dot < half_point)
-				{
-					mask |= (dot < c0_point) ? 1 : 3;
-				}
-				else
-				{
-					mask |= (dot < c3_point) ? 2 : 0;
-				}
-			}
+			mask = BlockColorIndices(dots, c0_point, half_point, c3_point);
 		}
 
 		return mask;
@@ -1121,7 +1635,42 @@ namespace KlayGE
 	void TexCompressionBC1::OptimizeColorsBlock(ARGBColor32 const * argb,
 			ARGBColor32& min_clr, ARGBColor32& max_clr, TexCompressionMethod method) const
 	{
-		if (method != TCM_Quality)
+		if (TCM_Speed == method)
+		{
+			// Real-time path. Bounding box of the block, flipped to the diagonal that matches the
+			// correlation of r and b against g, and inset a little to reduce the error of the extremes
+			static int const INSET_SHIFT = 4;
+
+			BlockMinMaxColors(argb, min_clr, max_clr);
+
+			int const center_r = (min_clr.r() + max_clr.r()) >> 1;
+			int const center_g = (min_clr.g() + max_clr.g()) >> 1;
+			int const center_b = (min_clr.b() + max_clr.b()) >> 1;
+			int cov_rg = 0;
+			int cov_bg = 0;
+			for (int i = 0; i < 16; ++ i)
+			{
+				int const g = argb[i].g() - center_g;
+				cov_rg += (argb[i].r() - center_r) * g;
+				cov_bg += (argb[i].b() - center_b) * g;
+			}
+			if (cov_rg < 0)
+			{
+				std::swap(min_clr.r(), max_clr.r());
+			}
+			if (cov_bg < 0)
+			{
+				std::swap(min_clr.b(), max_clr.b());
+			}
+
+			for (int ch = 0; ch < 4; ++ ch)
+			{
+				int const inset = (max_clr[ch] - min_clr[ch]) >> INSET_SHIFT;
+				min_clr[ch] = static_cast<uint8_t>(min_clr[ch] + inset);
+				max_clr[ch] = static_cast<uint8_t>(max_clr[ch] - inset);
+			}
+		}
+		else if (TCM_Balanced == method)
 		{
 			Color const LUM_WEIGHT(0.2126f, 0.7152f, 0.0722f, 0);
 
@@ -1210,7 +1759,7 @@ namespace KlayGE
 				vfb = b;
 			}
 
-			float magn = std::max(std::max(abs(vfr), abs(vfg)), abs(vfb));
+			float magn = std::max(std::max(MathLib::abs(vfr), MathLib::abs(vfg)), MathLib::abs(vfb));
 			int v_r, v_g, v_b;
 
 			if (magn < 4.0f) // too small, default to luminance
@@ -1332,13 +1881,8 @@ namespace KlayGE
 		BOOST_ASSERT(argb);
 
 		// check if block is constant
-		uint32_t min32, max32;
-		min32 = max32 = argb[0].ARGB();
-		for (int i = 1; i < 16; ++ i)
-		{
-			min32 = std::min(min32, argb[i].ARGB());
-			max32 = std::max(max32, argb[i].ARGB());
-		}
+		ARGBColor32 min32, max32;
+		BlockMinMaxColors(argb, min32, max32);
 
 		uint32_t mask;
 		uint16_t max16, min16;
@@ -1554,53 +2098,40 @@ namespace KlayGE
 
 		UNREF_PARAM(method);
 
-		BC4Block& bc4 = *static_cast<BC4Block*>(output);
-		uint8_t const * r = static_cast<uint8_t const *>(input);
-
-		// find min/max color
-		int min, max;
-		min = max = r[0];
-
-		for (int i = 1; i < 16; ++ i)
-		{
-			min = std::min<int>(min, r[i]);
-			max = std::max<int>(max, r[i]);
-		}
+		detail::EncodeBC4Blocks(static_cast<BC4Block*>(output), static_cast<uint8_t const *>(input), 1);
+	}
 
-		// encode them
-		bc4.alpha_0 = static_cast<uint8_t>(max);
-		bc4.alpha_1 = static_cast<uint8_t>(min);
+	void TexCompressionBC4::EncodeMem(uint32_t width, uint32_t height,
+		void* output, uint32_t out_row_pitch, uint32_t out_slice_pitch,
+		void const * input, uint32_t in_row_pitch, uint32_t in_slice_pitch,
+		TexCompressionMethod method)
+	{
+		UNREF_PARAM(out_slice_pitch);
+		UNREF_PARAM(in_slice_pitch);
+		UNREF_PARAM(method);
 
-		// determine bias and emit color indices
-		int dist = max - min;
-		int bias = min * 7 - (dist >> 1);
-		int dist4 = dist * 4;
-		int dist2 = dist * 2;
-		int bits = 0, mask = 0;
+		uint8_t const * src = static_cast<uint8_t const *>(input);
 
-		int dest = 0;
-		for (int i = 0; i < 16; ++ i)
+		// A whole row of blocks is gathered, and encoded in one go
+		uint32_t const blocks_x = (width + 3) / 4;
+		std::vector<uint8_t> uncompressed(blocks_x * 16);
+		for (uint32_t y_base = 0; y_base < height; y_base += 4)
 		{
-			int a = r[i] * 7 - bias;
-			int ind, t;
-
-			// select index (hooray for bit magic)
-			t = (dist4 - a) >> 31;  ind = t & 4; a -= dist4 & t;
-			t = (dist2 - a) >> 31;  ind += t & 2; a -= dist2 & t;
-			t = (dist - a) >> 31;   ind += t & 1;
-
-			ind = -ind & 7;
-			ind ^= (2 > ind);
-
-			// write index
-			mask |= ind << bits;
-			if ((bits += 3) >= 8)
+			for (uint32_t bx = 0; bx < blocks_x; ++ bx)
 			{
-				bc4.bitmap[dest] = static_cast<uint8_t>(mask);
-				++ dest;
-				mask >>= 8;
-				bits -= 8;
+				uint32_t const x_base = bx * 4;
+				for (uint32_t y = 0; y < 4; ++ y)
+				{
+					for (uint32_t x = 0; x < 4; ++ x)
+					{
+						uncompressed[bx * 16 + y * 4 + x] = ((x_base + x < width) && (y_base + y < height))
+							? src[(y_base + y) * in_row_pitch + x_base + x] : 0;
+					}
+				}
 			}
+
+			detail::EncodeBC4Blocks(reinterpret_cast<BC4Block*>(static_cast<uint8_t*>(output) + (y_base / 4) * out_row_pitch),
+				&uncompressed[0], blocks_x);
 		}
 	}
 
@@ -1665,16 +2196,17 @@ namespace KlayGE
 		BC5Block& bc5 = *static_cast<BC5Block*>(output);
 		uint16_t const * gr = static_cast<uint16_t const *>(input);
 
-		array<uint8_t, 16> r;
-		array<uint8_t, 16> g;
-		for (size_t i = 0; i < r.size(); ++ i)
+		UNREF_PARAM(method);
+
+		// The red and green blocks are adjacent, so they are encoded together
+		array<uint8_t, 32> rg;
+		for (size_t i = 0; i < 16; ++ i)
 		{
-			r[i] = gr[i] & 0xFF;
-			g[i] = gr[i] >> 8;
+			rg[i] = gr[i] & 0xFF;
+			rg[16 + i] = gr[i] >> 8;
 		}
 
-		bc4_codec_->EncodeBlock(&bc5.red, &r[0], method);
-		bc4_codec_->EncodeBlock(&bc5.green, &g[0], method);
+		detail::EncodeBC4Blocks(&bc5.red, &rg[0], 2);
 	}
 
 	void TexCompressionBC5::DecodeBlock(void* output, void const * input)
@@ -1962,11 +2494,7 @@ namespace KlayGE
 
 	void TexCompressionBC6U::EncodeBlock(void* output, void const * input, TexCompressionMethod method)
 	{
-		UNREF_PARAM(output);
-		UNREF_PARAM(input);
-		UNREF_PARAM(method);
-
-		// TODO
+		this->EncodeBC6Internal(output, input, method, false);
 	}
 
 	void TexCompressionBC6U::DecodeBlock(void* output, void const * input)
@@ -1974,6 +2502,113 @@ namespace KlayGE
 		this->DecodeBC6Internal(output, input, false);
 	}
 
+	void TexCompressionBC6U::EncodeMem(uint32_t width, uint32_t height,
+			void* output, uint32_t out_row_pitch, uint32_t out_slice_pitch,
+			void const * input, uint32_t in_row_pitch, uint32_t in_slice_pitch,
+			TexCompressionMethod method)
+	{
+		EncodeMemParallel(*this, width, height, 1, output, out_row_pitch, out_slice_pitch,
+			input, in_row_pitch, in_slice_pitch, method);
+	}
+
+	void TexCompressionBC6U::EncodeMem(uint32_t width, uint32_t height, uint32_t depth,
+			void* output, uint32_t out_row_pitch, uint32_t out_slice_pitch,
+			void const * input, uint32_t in_row_pitch, uint32_t in_slice_pitch,
+			TexCompressionMethod method)
+	{
+		EncodeMemParallel(*this, width, height, depth, output, out_row_pitch, out_slice_pitch,
+			input, in_row_pitch, in_slice_pitch, method);
+	}
+
+	void TexCompressionBC6U::EncodeBC6Internal(void* output, void const * input, TexCompressionMethod method, bool signed_fmt)
+	{
+		BOOST_ASSERT(output);
+		BOOST_ASSERT(input);
+
+		uint16_t const * abgr = static_cast<uint16_t const *>(input);
+
+		// targets are in the domain of the decoded half bits, pixels in the domain before FinishUnquantize
+		float const unq_scale = signed_fmt ? 32.0f / 31 : 64.0f / 31;
+		array<int3, BC6_MAX_INDICES> targets;
+		array<float3, BC6_MAX_INDICES> pixels;
+		for (uint32_t i = 0; i < BC6_MAX_INDICES; ++ i)
+		{
+			for (uint32_t c = 0; c < 3; ++ c)
+			{
+				targets[i][c] = F162Int(abgr[i * 4 + c], signed_fmt);
+				pixels[i][c] = targets[i][c] * unq_scale;
+			}
+		}
+
+		uint32_t refine_iterations;
+		uint32_t num_shapes;
+		switch (method)
+		{
+		case TCM_Speed:
+			refine_iterations = 0;
+			num_shapes = 0;
+			break;
+
+		case TCM_Balanced:
+			refine_iterations = 1;
+			num_shapes = 4;
+			break;
+
+		default:
+			refine_iterations = 2;
+			num_shapes = 16;
+			break;
+		}
+
+		uint32_t const num_modes = sizeof(mode_info_) / sizeof(mode_info_[0]);
+
+		CompressParams best_params;
+		uint64_t best_err = static_cast<uint64_t>(-1);
+		for (uint32_t mode = 0; (mode < num_modes) && (best_err > 0); ++ mode)
+		{
+			if (1 == mode_info_[mode].partitions)
+			{
+				CompressParams params;
+				uint64_t err = this->CompressMode(params, &pixels[0], &targets[0], mode, 0, refine_iterations, signed_fmt);
+				if (err < best_err)
+				{
+					best_err = err;
+					best_params = params;
+				}
+			}
+		}
+
+		if ((num_shapes > 0) && (best_err > 0))
+		{
+			array<std::pair<float, uint32_t>, 32> shape_errors;
+			for (uint32_t shape = 0; shape < shape_errors.size(); ++ shape)
+			{
+				shape_errors[shape] = std::make_pair(EstimateBC6ShapeError(&pixels[0], shape), shape);
+			}
+			std::partial_sort(shape_errors.begin(), shape_errors.begin() + num_shapes, shape_errors.end());
+
+			for (uint32_t s = 0; (s < num_shapes) && (best_err > 0); ++ s)
+			{
+				for (uint32_t mode = 0; (mode < num_modes) && (best_err > 0); ++ mode)
+				{
+					if (2 == mode_info_[mode].partitions)
+					{
+						CompressParams params;
+						uint64_t err = this->CompressMode(params, &pixels[0], &targets[0], mode, shape_errors[s].second,
+							refine_iterations, signed_fmt);
+						if (err < best_err)
+						{
+							best_err = err;
+							best_params = params;
+						}
+					}
+				}
+			}
+		}
+
+		this->PackBC6Block(output, best_params);
+	}
+
 	void TexCompressionBC6U::DecodeBC6Internal(void* output, void const * input, bool signed_fmt)
 	{
 		BOOST_ASSERT(output);
@@ -2133,6 +2768,65 @@ namespace KlayGE
 		}
 	}
 
+	int TexCompressionBC6U::Quantize(int comp, uint8_t bits_per_comp, bool signed_fmt)
+	{
+		// Inverse of Unquantize, picks the closest of the neighbor codes
+		int q = 0;
+		if (signed_fmt)
+		{
+			if (bits_per_comp >= 16)
+			{
+				q = MathLib::clamp(comp, -0x7FFF, 0x7FFF);
+			}
+			else
+			{
+				int const magnitude = std::min(MathLib::abs(comp), 0x7FFF);
+				int const max_q = (1 << (bits_per_comp - 1)) - 1;
+				int const guess = std::min((magnitude << (bits_per_comp - 1)) >> 15, max_q);
+				int min_diff = 0x7FFFFFFF;
+				for (int c = std::max(guess - 1, 0); c <= std::min(guess + 1, max_q); ++ c)
+				{
+					int const diff = MathLib::abs(this->Unquantize(c, bits_per_comp, true) - magnitude);
+					if (diff < min_diff)
+					{
+						min_diff = diff;
+						q = c;
+					}
+				}
+
+				if (comp < 0)
+				{
+					q = -q;
+				}
+			}
+		}
+		else
+		{
+			comp = MathLib::clamp(comp, 0, 0xFFFF);
+			if (bits_per_comp >= 15)
+			{
+				q = comp;
+			}
+			else
+			{
+				int const max_q = (1 << bits_per_comp) - 1;
+				int const guess = (comp << bits_per_comp) >> 16;
+				int min_diff = 0x7FFFFFFF;
+				for (int c = std::max(guess - 1, 0); c <= std::min(guess + 1, max_q); ++ c)
+				{
+					int const diff = MathLib::abs(this->Unquantize(c, bits_per_comp, false) - comp);
+					if (diff < min_diff)
+					{
+						min_diff = diff;
+						q = c;
+					}
+				}
+			}
+		}
+
+		return q;
+	}
+
 	int TexCompressionBC6U::Unquantize(int comp, uint8_t bits_per_comp, bool signed_fmt)
 	{
 		int unq = 0, s = 0;
@@ -2204,6 +2898,250 @@ namespace KlayGE
 		}
 	}
 
+	uint64_t TexCompressionBC6U::CompressMode(CompressParams& params, float3 const * pixels, int3 const * targets,
+		uint32_t mode, uint32_t shape, uint32_t refine_iterations, bool signed_fmt)
+	{
+		ModeInfo const & info = mode_info_[mode];
+
+		params.mode = mode;
+		params.shape = shape;
+		memset(&params.end_pts[0], 0, sizeof(params.end_pts));
+
+		array<std::pair<float3, float3>, BC6_MAX_REGIONS> unq_end_pts;
+		for (uint32_t p = 0; p < info.partitions; ++ p)
+		{
+			FitBC6Endpoints(pixels, info.partitions, shape, p, unq_end_pts[p].first, unq_end_pts[p].second);
+		}
+
+		uint64_t best_err = this->QuantizeEndpoints(params, &unq_end_pts[0], targets, signed_fmt);
+
+		int const * weights = BC67_PREC_WEIGHTS[1 + (1 == info.partitions)];
+		CompressParams trial = params;
+		for (uint32_t iter = 0; (iter < refine_iterations) && (best_err > 0); ++ iter)
+		{
+			RefineBC6Endpoints(pixels, info.partitions, shape, &params.indices[0], weights, &unq_end_pts[0]);
+			uint64_t err = this->QuantizeEndpoints(trial, &unq_end_pts[0], targets, signed_fmt);
+			if (err < best_err)
+			{
+				best_err = err;
+				params = trial;
+			}
+			else
+			{
+				break;
+			}
+		}
+
+		return best_err;
+	}
+
+	uint64_t TexCompressionBC6U::QuantizeEndpoints(CompressParams& params, std::pair<float3, float3> const * unq_end_pts,
+		int3 const * targets, bool signed_fmt)
+	{
+		ModeInfo const & info = mode_info_[params.mode];
+		uint8_t const prec[] = { info.rgba_prec[0][0].r(), info.rgba_prec[0][0].g(), info.rgba_prec[0][0].b() };
+
+		for (uint32_t p = 0; p < info.partitions; ++ p)
+		{
+			for (uint32_t c = 0; c < 3; ++ c)
+			{
+				params.end_pts[p].first[c] = this->Quantize(static_cast<int>(MathLib::round(unq_end_pts[p].first[c])),
+					prec[c], signed_fmt);
+				params.end_pts[p].second[c] = this->Quantize(static_cast<int>(MathLib::round(unq_end_pts[p].second[c])),
+					prec[c], signed_fmt);
+			}
+		}
+
+		uint64_t err = this->AssignIndices(params, targets, false, signed_fmt);
+
+		// The MSB of an anchor index is implicitly 0. Swapping the end points mirrors the palette.
+		uint8_t const num_indices = static_cast<uint8_t>(1U << info.index_prec);
+		for (uint32_t p = 0; p < info.partitions; ++ p)
+		{
+			if (params.indices[BC6AnchorIndex(info.partitions, params.shape, p)] >= num_indices / 2)
+			{
+				std::swap(params.end_pts[p].first, params.end_pts[p].second);
+				for (uint32_t i = 0; i < BC6_MAX_INDICES; ++ i)
+				{
+					if (GetPartition(info.partitions, params.shape, i) == p)
+					{
+						params.indices[i] = num_indices - 1 - params.indices[i];
+					}
+				}
+			}
+		}
+
+		if (info.transformed && this->ClampDeltas(params))
+		{
+			err = this->AssignIndices(params, targets, true, signed_fmt);
+		}
+
+		return err;
+	}
+
+	uint64_t TexCompressionBC6U::AssignIndices(CompressParams& params, int3 const * targets,
+		bool anchor_constrained, bool signed_fmt)
+	{
+		ModeInfo const & info = mode_info_[params.mode];
+		uint8_t const prec[] = { info.rgba_prec[0][0].r(), info.rgba_prec[0][0].g(), info.rgba_prec[0][0].b() };
+		int const * weights = BC67_PREC_WEIGHTS[1 + (1 == info.partitions)];
+		uint32_t const num_indices = 1U << info.index_prec;
+
+		int3 palette[BC6_MAX_REGIONS][16];
+		for (uint32_t p = 0; p < info.partitions; ++ p)
+		{
+			int3 unq1, unq2;
+			for (uint32_t c = 0; c < 3; ++ c)
+			{
+				unq1[c] = this->Unquantize(params.end_pts[p].first[c], prec[c], signed_fmt);
+				unq2[c] = this->Unquantize(params.end_pts[p].second[c], prec[c], signed_fmt);
+			}
+			for (uint32_t k = 0; k < num_indices; ++ k)
+			{
+				for (uint32_t c = 0; c < 3; ++ c)
+				{
+					palette[p][k][c] = this->FinishUnquantize((unq1[c] * (BC6_WEIGHT_MAX - weights[k])
+						+ unq2[c] * weights[k] + BC6_WEIGHT_ROUND) >> BC6_WEIGHT_SHIFT, signed_fmt);
+				}
+			}
+		}
+
+		uint64_t total_err = 0;
+		for (uint32_t i = 0; i < BC6_MAX_INDICES; ++ i)
+		{
+			uint32_t const region = GetPartition(info.partitions, params.shape, i);
+			uint32_t const max_index = (anchor_constrained && IsFixUpOffset(info.partitions, params.shape, i))
+				? num_indices / 2 : num_indices;
+
+			uint64_t min_err = static_cast<uint64_t>(-1);
+			for (uint32_t k = 0; k < max_index; ++ k)
+			{
+				int64_t const dr = palette[region][k].x() - targets[i].x();
+				int64_t const dg = palette[region][k].y() - targets[i].y();
+				int64_t const db = palette[region][k].z() - targets[i].z();
+				uint64_t const err = static_cast<uint64_t>(dr * dr + dg * dg + db * db);
+				if (err < min_err)
+				{
+					min_err = err;
+					params.indices[i] = static_cast<uint8_t>(k);
+				}
+			}
+			total_err += min_err;
+		}
+
+		return total_err;
+	}
+
+	bool TexCompressionBC6U::ClampDeltas(CompressParams& params)
+	{
+		// Moves the end points toward the base end point until the deltas fit in the transformed precision
+		ModeInfo const & info = mode_info_[params.mode];
+		int3 const & base = params.end_pts[0].first;
+
+		bool clamped = false;
+		for (uint32_t p = 0; p < info.partitions; ++ p)
+		{
+			for (uint32_t e = (0 == p) ? 1 : 0; e < 2; ++ e)
+			{
+				int3& end_pt = (0 == e) ? params.end_pts[p].first : params.end_pts[p].second;
+				uint8_t const prec[] = { info.rgba_prec[p][e].r(), info.rgba_prec[p][e].g(), info.rgba_prec[p][e].b() };
+				for (uint32_t c = 0; c < 3; ++ c)
+				{
+					int const delta = end_pt[c] - base[c];
+					int const clamped_delta = MathLib::clamp(delta, -(1 << (prec[c] - 1)), (1 << (prec[c] - 1)) - 1);
+					if (clamped_delta != delta)
+					{
+						end_pt[c] = base[c] + clamped_delta;
+						clamped = true;
+					}
+				}
+			}
+		}
+
+		return clamped;
+	}
+
+	void TexCompressionBC6U::PackBC6Block(void* output, CompressParams const & params)
+	{
+		ModeInfo const & info = mode_info_[params.mode];
+		ModeDescriptor const * desc = mode_desc_[params.mode];
+
+		array<std::pair<int3, int3>, BC6_MAX_REGIONS> end_pts = params.end_pts;
+		if (info.transformed)
+		{
+			end_pts[0].second -= end_pts[0].first;
+			end_pts[1].first -= end_pts[0].first;
+			end_pts[1].second -= end_pts[0].first;
+		}
+
+		memset(output, 0, block_bytes_);
+
+		size_t start_bit = 0;
+		size_t const header_bits = info.partitions > 1 ? 82 : 65;
+		for (size_t i = 0; i < header_bits; ++ i)
+		{
+			int val;
+			switch (desc[i].field)
+			{
+			case M:
+				val = info.mode;
+				break;
+			case D:
+				val = params.shape;
+				break;
+			case RW:
+				val = end_pts[0].first.x();
+				break;
+			case RX:
+				val = end_pts[0].second.x();
+				break;
+			case RY:
+				val = end_pts[1].first.x();
+				break;
+			case RZ:
+				val = end_pts[1].second.x();
+				break;
+			case GW:
+				val = end_pts[0].first.y();
+				break;
+			case GX:
+				val = end_pts[0].second.y();
+				break;
+			case GY:
+				val = end_pts[1].first.y();
+				break;
+			case GZ:
+				val = end_pts[1].second.y();
+				break;
+			case BW:
+				val = end_pts[0].first.z();
+				break;
+			case BX:
+				val = end_pts[0].second.z();
+				break;
+			case BY:
+				val = end_pts[1].first.z();
+				break;
+			case BZ:
+				val = end_pts[1].second.z();
+				break;
+
+			default:
+				val = 0;
+				break;
+			}
+
+			WriteBit(output, start_bit, static_cast<uint8_t>((val >> desc[i].bit) & 1));
+		}
+
+		for (uint32_t i = 0; i < BC6_MAX_INDICES; ++ i)
+		{
+			size_t num_bits = IsFixUpOffset(info.partitions, params.shape, i) ? info.index_prec - 1 : info.index_prec;
+			WriteBits(output, start_bit, num_bits, params.indices[i]);
+		}
+		BOOST_ASSERT(128 == start_bit);
+	}
+
 
 	TexCompressionBC6S::TexCompressionBC6S()
 	{
@@ -2211,15 +3149,13 @@ namespace KlayGE
 		block_depth_ = 1;
 		block_bytes_ = NumFormatBytes(EF_SIGNED_BC6) * 4;
 		decoded_fmt_ = EF_ABGR16F;
+
+		bc6u_codec_ = MakeSharedPtr<TexCompressionBC6U>();
 	}
 
 	void TexCompressionBC6S::EncodeBlock(void* output, void const * input, TexCompressionMethod method)
 	{
-		UNREF_PARAM(output);
-		UNREF_PARAM(input);
-		UNREF_PARAM(method);
-
-		// TODO
+		bc6u_codec_->EncodeBC6Internal(output, input, method, true);
 	}
 
 	void TexCompressionBC6S::DecodeBlock(void* output, void const * input)
@@ -2227,6 +3163,24 @@ namespace KlayGE
 		bc6u_codec_->DecodeBC6Internal(output, input, true);
 	}
 
+	void TexCompressionBC6S::EncodeMem(uint32_t width, uint32_t height,
+			void* output, uint32_t out_row_pitch, uint32_t out_slice_pitch,
+			void const * input, uint32_t in_row_pitch, uint32_t in_slice_pitch,
+			TexCompressionMethod method)
+	{
+		EncodeMemParallel(*this, width, height, 1, output, out_row_pitch, out_slice_pitch,
+			input, in_row_pitch, in_slice_pitch, method);
+	}
+
+	void TexCompressionBC6S::EncodeMem(uint32_t width, uint32_t height, uint32_t depth,
+			void* output, uint32_t out_row_pitch, uint32_t out_slice_pitch,
+			void const * input, uint32_t in_row_pitch, uint32_t in_slice_pitch,
+			TexCompressionMethod method)
+	{
+		EncodeMemParallel(*this, width, height, depth, output, out_row_pitch, out_slice_pitch,
+			input, in_row_pitch, in_slice_pitch, method);
+	}
+
 
 	// BC7 compression: mode partitions, partition_bits, p_bits, rotation_bits, index_mode_bits, index_prec, index_prec_2, rgba_prec, rgba_prec_with_p, p_bit_type
 	TexCompressionBC7::ModeInfo const TexCompressionBC7::mode_info_[] =
@@ -3914,4 +4868,64 @@ namespace KlayGE
 			bc1.bitmap[i] = mask;
 		}
 	}
+
+	namespace detail
+	{
+		void BC1BlockMinMaxColors(ARGBColor32 const * argb, ARGBColor32& min_clr, ARGBColor32& max_clr)
+		{
+			BlockMinMaxColors(argb, min_clr, max_clr);
+		}
+
+		void BC1BlockMinMaxColorsScalar(ARGBColor32 const * argb, ARGBColor32& min_clr, ARGBColor32& max_clr)
+		{
+			BlockMinMaxColorsScalar(argb, min_clr, max_clr);
+		}
+
+		void BC1BlockColorDots(int* dots, ARGBColor32 const * argb, int dirr, int dirg, int dirb)
+		{
+			BlockColorDots(dots, argb, dirr, dirg, dirb);
+		}
+
+		void BC1BlockColorDotsScalar(int* dots, ARGBColor32 const * argb, int dirr, int dirg, int dirb)
+		{
+			BlockColorDotsScalar(dots, argb, dirr, dirg, dirb);
+		}
+
+		uint32_t BC1BlockColorIndices(int const * dots, int c0_point, int half_point, int c3_point)
+		{
+			return BlockColorIndices(dots, c0_point, half_point, c3_point);
+		}
+
+		uint32_t BC1BlockColorIndicesScalar(int const * dots, int c0_point, int half_point, int c3_point)
+		{
+			return BlockColorIndicesScalar(dots, c0_point, half_point, c3_point);
+		}
+
+		void EncodeBC4Blocks(BC4Block* output, uint8_t const * input, uint32_t num_blocks)
+		{
+			uint32_t i = 0;
+#ifdef KLAYGE_AVX2_SUPPORT
+			for (; i + 2 <= num_blocks; i += 2)
+			{
+				EncodeBC4BlocksAVX2(&output[i], &input[i * 16]);
+			}
+#endif
+			for (; i < num_blocks; ++ i)
+			{
+#ifdef KLAYGE_SSE2_SUPPORT
+				EncodeBC4BlockSSE2(output[i], &input[i * 16]);
+#else
+				EncodeBC4BlockScalar(output[i], &input[i * 16]);
+#endif
+			}
+		}
+
+		void EncodeBC4BlocksScalar(BC4Block* output, uint8_t const * input, uint32_t num_blocks)
+		{
+			for (uint32_t i = 0; i < num_blocks; ++ i)
+			{
+				EncodeBC4BlockScalar(output[i], &input[i * 16]);
+			}
+		}
+	}
 }
@@ -38,6 +38,9 @@
 #include <vector>
 #include <cstring>
 #include <boost/assert.hpp>
+#ifdef KLAYGE_SSE2_SUPPORT
+#include <emmintrin.h>
+#endif
 
 #include <KlayGE/TexCompressionETC.hpp>
 
@@ -49,6 +52,27 @@ namespace
 
 	static uint8_t const selector_index_to_etc1[] = { 3, 2, 0, 1 };
 
+	// EAC modifier tables, shared with the alpha channel of ETC2 RGBA8
+	static int const eac_modifier_table[16][8] =
+	{
+		{ -3, -6, -9, -15, 2, 5, 8, 14 },
+		{ -3, -7, -10, -13, 2, 6, 9, 12 },
+		{ -2, -5, -8, -13, 1, 4, 7, 12 },
+		{ -2, -4, -6, -13, 1, 3, 5, 12 },
+		{ -3, -6, -8, -12, 2, 5, 7, 11 },
+		{ -3, -7, -9, -11, 2, 6, 8, 10 },
+		{ -4, -7, -8, -11, 3, 6, 7, 10 },
+		{ -3, -5, -8, -11, 2, 4, 7, 10 },
+		{ -2, -6, -8, -10, 1, 5, 7, 9 },
+		{ -2, -5, -8, -10, 1, 4, 7, 9 },
+		{ -2, -4, -8, -10, 1, 3, 7, 9 },
+		{ -2, -5, -7, -10, 1, 4, 6, 9 },
+		{ -3, -4, -7, -10, 2, 3, 6, 9 },
+		{ -1, -2, -3, -10, 0, 1, 2, 9 },
+		{ -4, -6, -8, -9, 3, 5, 7, 8 },
+		{ -3, -5, -7, -9, 2, 4, 6, 8 }
+	};
+
 	// color8_to_etc_block_config_0_255[color][table_index] = Supplies for each 8-bit color value a list of packed ETC1 diff/intensity table/selectors/packed_colors that map to that color.
 	// To pack: diff | (inten << 1) | (selector << 4) | (packed_c << 8)
 	static uint16_t const color8_to_etc_block_config_0_255[2][33] =
@@ -502,6 +526,296 @@ namespace
 
 		return cur_ind;
 	}
+
+	// Picks the closest of the 4 palette colors for each pixel, returns the total squared RGB error.
+	// num_pixels has to be a multiple of 4.
+	uint32_t SelectPaletteColors(ARGBColor32 const * pixels, uint32_t num_pixels, ARGBColor32 const * palette,
+		uint8_t* selectors)
+	{
+		BOOST_ASSERT(0 == (num_pixels & 3));
+
+#ifdef KLAYGE_SSE2_SUPPORT
+		__m128i const zero = _mm_setzero_si128();
+		__m128i const rgb_mask = _mm_set1_epi32(0x00FFFFFF);
+
+		__m128i pal[4];
+		for (uint32_t k = 0; k < 4; ++ k)
+		{
+			pal[k] = _mm_unpacklo_epi8(_mm_and_si128(_mm_set1_epi32(palette[k].ARGB()), rgb_mask), zero);
+		}
+
+		uint32_t total_err = 0;
+		for (uint32_t i = 0; i < num_pixels; i += 4)
+		{
+			__m128i const p = _mm_and_si128(_mm_loadu_si128(reinterpret_cast<__m128i const *>(&pixels[i])), rgb_mask);
+			__m128i const p01 = _mm_unpacklo_epi8(p, zero);
+			__m128i const p23 = _mm_unpackhi_epi8(p, zero);
+
+			__m128i best_err = zero;
+			__m128i best_sel = zero;
+			for (uint32_t k = 0; k < 4; ++ k)
+			{
+				__m128i const d01 = _mm_sub_epi16(p01, pal[k]);
+				__m128i const d23 = _mm_sub_epi16(p23, pal[k]);
+				__m128 const s01 = _mm_castsi128_ps(_mm_madd_epi16(d01, d01));
+				__m128 const s23 = _mm_castsi128_ps(_mm_madd_epi16(d23, d23));
+				__m128i const err = _mm_add_epi32(_mm_castps_si128(_mm_shuffle_ps(s01, s23, _MM_SHUFFLE(2, 0, 2, 0))),
+					_mm_castps_si128(_mm_shuffle_ps(s01, s23, _MM_SHUFFLE(3, 1, 3, 1))));
+				if (0 == k)
+				{
+					best_err = err;
+				}
+				else
+				{
+					// Strictly less, so ties keep the lower selector like the scalar path
+					__m128i const mask = _mm_cmplt_epi32(err, best_err);
+					best_err = _mm_or_si128(_mm_and_si128(mask, err), _mm_andnot_si128(mask, best_err));
+					best_sel = _mm_or_si128(_mm_and_si128(mask, _mm_set1_epi32(k)), _mm_andnot_si128(mask, best_sel));
+				}
+			}
+
+			__m128i sum = _mm_add_epi32(best_err, _mm_shuffle_epi32(best_err, _MM_SHUFFLE(1, 0, 3, 2)));
+			sum = _mm_add_epi32(sum, _mm_shuffle_epi32(sum, _MM_SHUFFLE(2, 3, 0, 1)));
+			total_err += _mm_cvtsi128_si32(sum);
+
+			__m128i const sel8 = _mm_packus_epi16(_mm_packs_epi32(best_sel, zero), zero);
+			uint32_t const sel4 = _mm_cvtsi128_si32(sel8);
+			memcpy(&selectors[i], &sel4, sizeof(sel4));
+		}
+
+		return total_err;
+#else
+		uint32_t total_err = 0;
+		for (uint32_t i = 0; i < num_pixels; ++ i)
+		{
+			uint32_t best_err = std::numeric_limits<uint32_t>::max();
+			for (uint32_t k = 0; k < 4; ++ k)
+			{
+				uint32_t const err = MathLib::sqr(pixels[i].r() - palette[k].r())
+					+ MathLib::sqr(pixels[i].g() - palette[k].g())
+					+ MathLib::sqr(pixels[i].b() - palette[k].b());
+				if (err < best_err)
+				{
+					best_err = err;
+					selectors[i] = static_cast<uint8_t>(k);
+				}
+			}
+			total_err += best_err;
+		}
+
+		return total_err;
+#endif
+	}
+
+	// Sum of the squared RGB distances to the subblock means
+	float SubblockVariance(ARGBColor32 const * argb, bool flip)
+	{
+		float variance = 0;
+		for (uint32_t subblock = 0; subblock < 2; ++ subblock)
+		{
+			float3 pixels[8];
+			float3 mean(0, 0, 0);
+			for (uint32_t i = 0; i < 8; ++ i)
+			{
+				ARGBColor32 const & c = flip ? argb[subblock * 8 + i] : argb[(i & 3) * 4 + subblock * 2 + (i >> 2)];
+				pixels[i] = float3(c.r(), c.g(), c.b());
+				mean += pixels[i];
+			}
+			mean /= 8;
+
+			for (uint32_t i = 0; i < 8; ++ i)
+			{
+				variance += MathLib::length_sq(pixels[i] - mean);
+			}
+		}
+		return variance;
+	}
+
+	uint64_t BlockRGBError(ARGBColor32 const * argb, ARGBColor32 const * decoded)
+	{
+		uint64_t err = 0;
+		for (uint32_t i = 0; i < 16; ++ i)
+		{
+			err += MathLib::sqr(argb[i].r() - decoded[i].r())
+				+ MathLib::sqr(argb[i].g() - decoded[i].g())
+				+ MathLib::sqr(argb[i].b() - decoded[i].b());
+		}
+		return err;
+	}
+
+	int Quantize4Bits(float v)
+	{
+		return MathLib::clamp(static_cast<int>(v * 15 / 255 + 0.5f), 0, 15);
+	}
+
+	// Sets the free bits of a differential-mode byte so that base + delta goes out of [0, 31],
+	// which is how T, H and planar blocks are told apart from ETC1 blocks.
+	uint8_t ForceDiffOverflow(uint8_t byte)
+	{
+		byte &= 0x1B;
+		if (((byte >> 3) & 0x3) + (byte & 0x3) >= 4)
+		{
+			byte |= 0xE0;
+		}
+		else
+		{
+			byte |= 0x04;
+		}
+		return byte;
+	}
+
+	// Sets bit 7 of a differential-mode byte, if necessary, so that base + delta stays in [0, 31]
+	uint8_t AvoidDiffOverflow(uint8_t byte)
+	{
+		byte &= 0x7F;
+		int const d = byte & 0x7;
+		int const c = (byte >> 3) - (d & 0x4) + (d & 0x3);
+		if (c & 0xFFE0)
+		{
+			byte |= 0x80;
+		}
+		return byte;
+	}
+
+	void PackETC2Selectors(uint16_t& msb, uint16_t& lsb, uint8_t const * selectors)
+	{
+		msb = 0;
+		lsb = 0;
+		for (int y = 0; y < 4; ++ y)
+		{
+			for (int x = 0; x < 4; ++ x)
+			{
+				int const bit_index = (x * 4 + y) ^ 0x8;
+				uint32_t const sel = selectors[y * 4 + x];
+				msb |= static_cast<uint16_t>((sel >> 1) << bit_index);
+				lsb |= static_cast<uint16_t>((sel & 1) << bit_index);
+			}
+		}
+	}
+
+	void PackETC2TMode(ETC2TModeBlock& block, int const * base1, int const * base2, uint32_t distance,
+		uint8_t const * selectors)
+	{
+		block.r1 = ForceDiffOverflow(static_cast<uint8_t>(((base1[0] & 0xC) << 1) | (base1[0] & 0x3)));
+		block.g1_b1 = static_cast<uint8_t>((base1[1] << 4) | base1[2]);
+		block.r2_g2 = static_cast<uint8_t>((base2[0] << 4) | base2[1]);
+		block.b2_d = static_cast<uint8_t>((base2[2] << 4) | ((distance >> 1) << 2) | 0x2 | (distance & 1));
+		PackETC2Selectors(block.msb, block.lsb, selectors);
+	}
+
+	void PackETC2HMode(ETC2HModeBlock& block, int const * base1, int const * base2, uint32_t distance,
+		uint8_t const * selectors)
+	{
+		block.r1_g1 = AvoidDiffOverflow(static_cast<uint8_t>((base1[0] << 3) | (base1[1] >> 1)));
+		block.g1_b1 = ForceDiffOverflow(static_cast<uint8_t>(((base1[1] & 1) << 4) | (base1[2] & 0x8)
+			| ((base1[2] >> 1) & 0x3)));
+		block.b1_r2_g2 = static_cast<uint8_t>(((base1[2] & 1) << 7) | (base2[0] << 3) | (base2[1] >> 1));
+		block.g2_b2_d = static_cast<uint8_t>(((base2[1] & 1) << 7) | (base2[2] << 3) | (distance & 0x4)
+			| 0x2 | ((distance >> 1) & 1));
+		PackETC2Selectors(block.msb, block.lsb, selectors);
+	}
+
+	void PackETC2PlanarMode(ETC2PlanarModeBlock& block, int const * o, int const * h, int const * v)
+	{
+		block.ro_go = AvoidDiffOverflow(static_cast<uint8_t>((o[0] << 1) | (o[1] >> 6)));
+		block.go_bo = AvoidDiffOverflow(static_cast<uint8_t>(((o[1] & 0x3F) << 1) | (o[2] >> 5)));
+		block.bo = ForceDiffOverflow(static_cast<uint8_t>((o[2] & 0x18) | ((o[2] >> 1) & 0x3)));
+		block.bo_rh = static_cast<uint8_t>(((o[2] & 1) << 7) | ((h[0] >> 1) << 2) | 0x2 | (h[0] & 1));
+		block.gh_bh = static_cast<uint8_t>((h[1] << 1) | (h[2] >> 5));
+		block.bh_rv = static_cast<uint8_t>(((h[2] & 0x1F) << 3) | (v[0] >> 3));
+		block.rv_gv = static_cast<uint8_t>(((v[0] & 0x7) << 5) | (v[1] >> 2));
+		block.gv_bv = static_cast<uint8_t>(((v[1] & 0x3) << 6) | v[2]);
+	}
+
+	int ExtendPlanarBits(int input, int bits)
+	{
+		return (7 == bits) ? Extend7To8Bits(input) : Extend6To8Bits(input);
+	}
+
+	// Squared error of one channel of a planar block, evaluated exactly like the decoder
+	uint32_t PlanarChannelError(ARGBColor32 const * argb, uint32_t ch, int o, int h, int v)
+	{
+		uint32_t err = 0;
+		for (int y = 0; y < 4; ++ y)
+		{
+			for (int x = 0; x < 4; ++ x)
+			{
+				int const p = MathLib::clamp((x * (h - o) + y * (v - o) + 4 * o + 2) >> 2, 0, 255);
+				err += MathLib::sqr(p - argb[y * 4 + x][ch]);
+			}
+		}
+		return err;
+	}
+
+	// Splits the pixels into 2 clusters, starting from the principal axis and refined by k-means.
+	// Returns false if all pixels fall into one cluster.
+	bool SplitBlockColors(ARGBColor32 const * argb, float3* centroids)
+	{
+		float3 pixels[16];
+		float3 mean(0, 0, 0);
+		for (uint32_t i = 0; i < 16; ++ i)
+		{
+			pixels[i] = float3(argb[i].r(), argb[i].g(), argb[i].b());
+			mean += pixels[i];
+		}
+		mean /= 16;
+
+		float cov[6] = { 0, 0, 0, 0, 0, 0 };
+		for (uint32_t i = 0; i < 16; ++ i)
+		{
+			float3 const diff = pixels[i] - mean;
+			cov[0] += diff.x() * diff.x();
+			cov[1] += diff.x() * diff.y();
+			cov[2] += diff.x() * diff.z();
+			cov[3] += diff.y() * diff.y();
+			cov[4] += diff.y() * diff.z();
+			cov[5] += diff.z() * diff.z();
+		}
+
+		float3 axis(1, 1, 1);
+		for (int iter = 0; iter < 4; ++ iter)
+		{
+			float3 const v(cov[0] * axis.x() + cov[1] * axis.y() + cov[2] * axis.z(),
+				cov[1] * axis.x() + cov[3] * axis.y() + cov[4] * axis.z(),
+				cov[2] * axis.x() + cov[4] * axis.y() + cov[5] * axis.z());
+			float const len = MathLib::length(v);
+			if (len < 1e-6f)
+			{
+				return false;
+			}
+			axis = v / len;
+		}
+
+		bool cluster[16];
+		for (uint32_t i = 0; i < 16; ++ i)
+		{
+			cluster[i] = MathLib::dot(pixels[i] - mean, axis) >= 0;
+		}
+
+		for (int iter = 0; iter < 3; ++ iter)
+		{
+			float3 sums[2] = { float3(0, 0, 0), float3(0, 0, 0) };
+			uint32_t counts[2] = { 0, 0 };
+			for (uint32_t i = 0; i < 16; ++ i)
+			{
+				sums[cluster[i]] += pixels[i];
+				++ counts[cluster[i]];
+			}
+			if ((0 == counts[0]) || (0 == counts[1]))
+			{
+				return false;
+			}
+			centroids[0] = sums[0] / static_cast<float>(counts[0]);
+			centroids[1] = sums[1] / static_cast<float>(counts[1]);
+
+			for (uint32_t i = 0; i < 16; ++ i)
+			{
+				cluster[i] = MathLib::length_sq(pixels[i] - centroids[1]) < MathLib::length_sq(pixels[i] - centroids[0]);
+			}
+		}
+
+		return true;
+	}
 }
 
 namespace KlayGE
@@ -752,10 +1066,29 @@ namespace KlayGE
 		params.num_src_pixels_ = 8;
 		params.src_pixels_ = subblock_pixels;
 
+		// The fast path only tries the split with the lower variance, and falls back to the individual mode
+		// only when the differential mode doesn't do well
+		uint32_t speed_flip = 0;
+		if (TCM_Speed == method)
+		{
+			speed_flip = (SubblockVariance(argb, true) < SubblockVariance(argb, false)) ? 1 : 0;
+		}
+		uint64_t const speed_color4_threshold = 16 * 3 * 8 * 8;
+
 		for (uint32_t flip = 0; flip < 2; ++ flip)
 		{
+			if ((TCM_Speed == method) && (flip != speed_flip))
+			{
+				continue;
+			}
+
 			for (uint32_t use_color4 = 0; use_color4 < 2; ++ use_color4)
 			{
+				if ((TCM_Speed == method) && use_color4 && (best_err <= speed_color4_threshold))
+				{
+					continue;
+				}
+
 				uint64_t trial_err = 0;
 
 				uint32_t subblock;
@@ -1246,19 +1579,20 @@ namespace KlayGE
 		memset(&block.msb, (etc1_selector & 2) ? 0xFF : 0, 2);
 		memset(&block.lsb, (etc1_selector & 1) ? 0xFF : 0, 2);
 
+		// The channels of ARGBColor32 are stored b, g, r, the ones of the block r, g, b
 		uint8_t* bytes = &block.r;
 		uint32_t const best_packed_c0 = (best_x >> 8) & 255;
 		if (diff)
 		{
-			bytes[best_i] = static_cast<uint8_t>(best_packed_c0 << 3);
-			bytes[next_comp[best_i + 0]] = static_cast<uint8_t>(best_packed_c1 << 3);
-			bytes[next_comp[best_i + 1]] = static_cast<uint8_t>(best_packed_c2 << 3);
+			bytes[2 - best_i] = static_cast<uint8_t>(best_packed_c0 << 3);
+			bytes[2 - next_comp[best_i + 0]] = static_cast<uint8_t>(best_packed_c1 << 3);
+			bytes[2 - next_comp[best_i + 1]] = static_cast<uint8_t>(best_packed_c2 << 3);
 		}
 		else
 		{
-			bytes[best_i] = static_cast<uint8_t>(best_packed_c0 | (best_packed_c0 << 4));
-			bytes[next_comp[best_i + 0]] = static_cast<uint8_t>(best_packed_c1 | (best_packed_c1 << 4));
-			bytes[next_comp[best_i + 1]] = static_cast<uint8_t>(best_packed_c2 | (best_packed_c2 << 4));
+			bytes[2 - best_i] = static_cast<uint8_t>(best_packed_c0 | (best_packed_c0 << 4));
+			bytes[2 - next_comp[best_i + 0]] = static_cast<uint8_t>(best_packed_c1 | (best_packed_c1 << 4));
+			bytes[2 - next_comp[best_i + 1]] = static_cast<uint8_t>(best_packed_c2 | (best_packed_c2 << 4));
 		}
 
 		return best_err;
@@ -1662,54 +1996,7 @@ namespace KlayGE
 				block_colors[s] = From4Ints(0, base_color.r() + yd, base_color.g() + yd, base_color.b() + yd);
 			}
 
-			uint64_t total_err = 0;
-
-			ARGBColor32 const * src_pixels = params_->src_pixels_;
-			for (uint32_t c = 0; c < N; ++ c)
-			{
-				ARGBColor32 src_pixel = *src_pixels;
-				++ src_pixels;
-
-				uint32_t best_selector_index = 0;
-				uint32_t best_err = MathLib::sqr(src_pixel.r() - block_colors[0].r())
-					+ MathLib::sqr(src_pixel.g() - block_colors[0].g())
-					+ MathLib::sqr(src_pixel.b() - block_colors[0].b());
-
-				uint32_t trial_err = MathLib::sqr(src_pixel.r() - block_colors[1].r())
-					+ MathLib::sqr(src_pixel.g() - block_colors[1].g())
-					+ MathLib::sqr(src_pixel.b() - block_colors[1].b());
-				if (trial_err < best_err)
-				{
-					best_err = trial_err;
-					best_selector_index = 1;
-				}
-
-				trial_err = MathLib::sqr(src_pixel.r() - block_colors[2].r())
-					+ MathLib::sqr(src_pixel.g() - block_colors[2].g())
-					+ MathLib::sqr(src_pixel.b() - block_colors[2].b());
-				if (trial_err < best_err)
-				{
-					best_err = trial_err;
-					best_selector_index = 2;
-				}
-
-				trial_err = MathLib::sqr(src_pixel.r() - block_colors[3].r())
-					+ MathLib::sqr(src_pixel.g() - block_colors[3].g())
-					+ MathLib::sqr(src_pixel.b() - block_colors[3].b());
-				if (trial_err < best_err)
-				{
-					best_err = trial_err;
-					best_selector_index = 3;
-				}
-
-				temp_selectors_[c] = static_cast<uint8_t>(best_selector_index);
-
-				total_err += best_err;
-				if (total_err >= trial_solution.error_)
-				{
-					break;
-				}
-			}
+			uint64_t const total_err = SelectPaletteColors(params_->src_pixels_, N, block_colors, temp_selectors_);
 
 			if (total_err < trial_solution.error_)
 			{
@@ -1888,11 +2175,44 @@ namespace KlayGE
 
 	void TexCompressionETC2RGB8::EncodeBlock(void* output, void const * input, TexCompressionMethod method)
 	{
-		UNREF_PARAM(output);
-		UNREF_PARAM(input);
-		UNREF_PARAM(method);
+		BOOST_ASSERT(output);
+		BOOST_ASSERT(input);
 
-		// TODO
+		this->EncodeETC2BlockInternal(*static_cast<ETC2Block*>(output), static_cast<ARGBColor32 const *>(input), method);
+	}
+
+	uint64_t TexCompressionETC2RGB8::EncodeETC2BlockInternal(ETC2Block& output, ARGBColor32 const * argb, TexCompressionMethod method)
+	{
+		BOOST_ASSERT(argb);
+
+		// Every ETC1 block is a valid ETC2 block. The planar, T and H modes only replace it when they are closer.
+		// Errors are measured on the decoded blocks, so they are exactly what the decoder produces.
+		ARGBColor32 decoded[16];
+		etc1_codec_->EncodeETC1BlockInternal(output.etc1, argb, method);
+		this->DecodeBlock(decoded, &output);
+		uint64_t best_err = BlockRGBError(argb, decoded);
+
+		ETC2Block trial;
+		if (best_err > 0)
+		{
+			uint64_t const err = this->EncodeETC2PlanarModeInternal(trial, argb, method);
+			if (err < best_err)
+			{
+				best_err = err;
+				output = trial;
+			}
+		}
+		if ((best_err > 0) && (method != TCM_Speed))
+		{
+			uint64_t const err = this->EncodeETC2THModeInternal(trial, argb, method);
+			if (err < best_err)
+			{
+				best_err = err;
+				output = trial;
+			}
+		}
+
+		return best_err;
 	}
 
 	void TexCompressionETC2RGB8::DecodeBlock(void* output, void const * input)
@@ -2098,6 +2418,263 @@ namespace KlayGE
 		}
 	}
 
+	uint64_t TexCompressionETC2RGB8::EncodeETC2THModeInternal(ETC2Block& output, ARGBColor32 const * argb, TexCompressionMethod method)
+	{
+		static int const distance_table[8] = { 3, 6, 11, 16, 23, 32, 41, 64 };
+
+		float3 centroids[2];
+		if (!SplitBlockColors(argb, centroids))
+		{
+			return std::numeric_limits<uint64_t>::max();
+		}
+
+		// Quality moves the base colors to the means of their pixels and tries again
+		uint32_t const num_refinements = (TCM_Quality == method) ? 2 : 0;
+
+		uint64_t best_err = std::numeric_limits<uint64_t>::max();
+		ETC2Block trial;
+		ARGBColor32 decoded[16];
+		uint8_t selectors[16];
+		uint8_t best_selectors[16];
+
+		// H mode: both clusters are painted around their base colors
+		{
+			float3 centers[2] = { centroids[0], centroids[1] };
+			for (uint32_t iter = 0; iter <= num_refinements; ++ iter)
+			{
+				int base[2][3];
+				for (uint32_t g = 0; g < 2; ++ g)
+				{
+					for (uint32_t c = 0; c < 3; ++ c)
+					{
+						base[g][c] = Quantize4Bits(centers[g][c]);
+					}
+				}
+				ARGBColor32 const clr1(0, Extend4To8Bits(base[0][0]), Extend4To8Bits(base[0][1]), Extend4To8Bits(base[0][2]));
+				ARGBColor32 const clr2(0, Extend4To8Bits(base[1][0]), Extend4To8Bits(base[1][1]), Extend4To8Bits(base[1][2]));
+
+				uint32_t best_dist = 8;
+				uint32_t min_err = std::numeric_limits<uint32_t>::max();
+				for (uint32_t d = 0; d < 8; ++ d)
+				{
+					// The lowest bit of the distance index is the order of the base colors, which can't be
+					// chosen when they are equal
+					if ((clr1 == clr2) && !(d & 1))
+					{
+						continue;
+					}
+
+					int const dist = distance_table[d];
+					ARGBColor32 const palette[] =
+					{
+						From4Ints(255, clr1.r() + dist, clr1.g() + dist, clr1.b() + dist),
+						From4Ints(255, clr1.r() - dist, clr1.g() - dist, clr1.b() - dist),
+						From4Ints(255, clr2.r() + dist, clr2.g() + dist, clr2.b() + dist),
+						From4Ints(255, clr2.r() - dist, clr2.g() - dist, clr2.b() - dist)
+					};
+					uint32_t const err = SelectPaletteColors(argb, 16, palette, selectors);
+					if (err < min_err)
+					{
+						min_err = err;
+						best_dist = d;
+						memcpy(best_selectors, selectors, sizeof(selectors));
+					}
+				}
+				if (best_dist >= 8)
+				{
+					break;
+				}
+
+				uint32_t const ordering = (clr1.ARGB() >= clr2.ARGB()) ? 1 : 0;
+				if (ordering != (best_dist & 1))
+				{
+					for (uint32_t i = 0; i < 16; ++ i)
+					{
+						selectors[i] = best_selectors[i] ^ 2;
+					}
+					PackETC2HMode(trial.etc2_h_mode, base[1], base[0], best_dist, selectors);
+				}
+				else
+				{
+					PackETC2HMode(trial.etc2_h_mode, base[0], base[1], best_dist, best_selectors);
+				}
+
+				this->DecodeBlock(decoded, &trial);
+				uint64_t const err = BlockRGBError(argb, decoded);
+				if (err < best_err)
+				{
+					best_err = err;
+					output = trial;
+				}
+
+				if (iter < num_refinements)
+				{
+					int const dist = distance_table[best_dist];
+					float3 sums[2] = { float3(0, 0, 0), float3(0, 0, 0) };
+					uint32_t counts[2] = { 0, 0 };
+					for (uint32_t i = 0; i < 16; ++ i)
+					{
+						uint32_t const g = best_selectors[i] >> 1;
+						float const offset = static_cast<float>((best_selectors[i] & 1) ? -dist : dist);
+						sums[g] += float3(argb[i].r() - offset, argb[i].g() - offset, argb[i].b() - offset);
+						++ counts[g];
+					}
+					for (uint32_t g = 0; g < 2; ++ g)
+					{
+						if (counts[g] > 0)
+						{
+							centers[g] = sums[g] / static_cast<float>(counts[g]);
+						}
+					}
+				}
+			}
+		}
+
+		// T mode: one cluster is a single color, the other one is painted around its base color
+		for (uint32_t single = 0; single < 2; ++ single)
+		{
+			float3 centers[2] = { centroids[single], centroids[1 - single] };
+			for (uint32_t iter = 0; iter <= num_refinements; ++ iter)
+			{
+				int base[2][3];
+				for (uint32_t g = 0; g < 2; ++ g)
+				{
+					for (uint32_t c = 0; c < 3; ++ c)
+					{
+						base[g][c] = Quantize4Bits(centers[g][c]);
+					}
+				}
+				ARGBColor32 const clr1(0, Extend4To8Bits(base[0][0]), Extend4To8Bits(base[0][1]), Extend4To8Bits(base[0][2]));
+				ARGBColor32 const clr2(0, Extend4To8Bits(base[1][0]), Extend4To8Bits(base[1][1]), Extend4To8Bits(base[1][2]));
+
+				uint32_t best_dist = 0;
+				uint32_t min_err = std::numeric_limits<uint32_t>::max();
+				for (uint32_t d = 0; d < 8; ++ d)
+				{
+					int const dist = distance_table[d];
+					ARGBColor32 const palette[] =
+					{
+						clr1,
+						From4Ints(255, clr2.r() + dist, clr2.g() + dist, clr2.b() + dist),
+						clr2,
+						From4Ints(255, clr2.r() - dist, clr2.g() - dist, clr2.b() - dist)
+					};
+					uint32_t const err = SelectPaletteColors(argb, 16, palette, selectors);
+					if (err < min_err)
+					{
+						min_err = err;
+						best_dist = d;
+						memcpy(best_selectors, selectors, sizeof(selectors));
+					}
+				}
+
+				PackETC2TMode(trial.etc2_t_mode, base[0], base[1], best_dist, best_selectors);
+
+				this->DecodeBlock(decoded, &trial);
+				uint64_t const err = BlockRGBError(argb, decoded);
+				if (err < best_err)
+				{
+					best_err = err;
+					output = trial;
+				}
+
+				if (iter < num_refinements)
+				{
+					int const dist = distance_table[best_dist];
+					float const offsets[] = { 0, static_cast<float>(dist), 0, static_cast<float>(-dist) };
+					float3 sums[2] = { float3(0, 0, 0), float3(0, 0, 0) };
+					uint32_t counts[2] = { 0, 0 };
+					for (uint32_t i = 0; i < 16; ++ i)
+					{
+						uint32_t const g = (best_selectors[i] != 0) ? 1 : 0;
+						float const offset = offsets[best_selectors[i]];
+						sums[g] += float3(argb[i].r() - offset, argb[i].g() - offset, argb[i].b() - offset);
+						++ counts[g];
+					}
+					for (uint32_t g = 0; g < 2; ++ g)
+					{
+						if (counts[g] > 0)
+						{
+							centers[g] = sums[g] / static_cast<float>(counts[g]);
+						}
+					}
+				}
+			}
+		}
+
+		return best_err;
+	}
+
+	uint64_t TexCompressionETC2RGB8::EncodeETC2PlanarModeInternal(ETC2Block& output, ARGBColor32 const * argb, TexCompressionMethod method)
+	{
+		static uint32_t const channels[] = { ARGBColor32::RChannel, ARGBColor32::GChannel, ARGBColor32::BChannel };
+		static int const bits[] = { 6, 7, 6 };
+
+		int o[3], h[3], v[3];
+		for (uint32_t c = 0; c < 3; ++ c)
+		{
+			uint32_t const ch = channels[c];
+
+			// Least squares fit of p = mean + grad_x * (x - 1.5) + grad_y * (y - 1.5)
+			float sum = 0;
+			float sum_x = 0;
+			float sum_y = 0;
+			for (int y = 0; y < 4; ++ y)
+			{
+				for (int x = 0; x < 4; ++ x)
+				{
+					float const p = argb[y * 4 + x][ch];
+					sum += p;
+					sum_x += (x - 1.5f) * p;
+					sum_y += (y - 1.5f) * p;
+				}
+			}
+			float const grad_x = sum_x / 20;
+			float const grad_y = sum_y / 20;
+			float const fo = sum / 16 - 1.5f * (grad_x + grad_y);
+			float const fh = fo + 4 * grad_x;
+			float const fv = fo + 4 * grad_y;
+
+			int const max_q = (1 << bits[c]) - 1;
+			o[c] = MathLib::clamp(static_cast<int>(fo * max_q / 255 + 0.5f), 0, max_q);
+			h[c] = MathLib::clamp(static_cast<int>(fh * max_q / 255 + 0.5f), 0, max_q);
+			v[c] = MathLib::clamp(static_cast<int>(fv * max_q / 255 + 0.5f), 0, max_q);
+
+			if (TCM_Quality == method)
+			{
+				// Channels are independent, so the neighbors of each channel's rounded values are searched exhaustively
+				int const center[] = { o[c], h[c], v[c] };
+				uint32_t min_err = std::numeric_limits<uint32_t>::max();
+				for (int i = 0; i < 27; ++ i)
+				{
+					int const qo = center[0] + (i % 3) - 1;
+					int const qh = center[1] + (i / 3 % 3) - 1;
+					int const qv = center[2] + (i / 9) - 1;
+					if ((qo < 0) || (qo > max_q) || (qh < 0) || (qh > max_q) || (qv < 0) || (qv > max_q))
+					{
+						continue;
+					}
+
+					uint32_t const err = PlanarChannelError(argb, ch, ExtendPlanarBits(qo, bits[c]),
+						ExtendPlanarBits(qh, bits[c]), ExtendPlanarBits(qv, bits[c]));
+					if (err < min_err)
+					{
+						min_err = err;
+						o[c] = qo;
+						h[c] = qh;
+						v[c] = qv;
+					}
+				}
+			}
+		}
+
+		PackETC2PlanarMode(output.etc2_planar_mode, o, h, v);
+
+		ARGBColor32 decoded[16];
+		this->DecodeBlock(decoded, &output);
+		return BlockRGBError(argb, decoded);
+	}
+
 
 	TexCompressionETC2RGB8A1::TexCompressionETC2RGB8A1()
 	{
@@ -2152,4 +2729,229 @@ namespace KlayGE
 			etc1_codec_->DecodeETCDifferentialModeInternal(argb, etc2.etc1, !op);
 		}
 	}
+
+
+	TexCompressionETC2R11::TexCompressionETC2R11()
+	{
+		block_width_ = block_height_ = 4;
+		block_depth_ = 1;
+		block_bytes_ = NumFormatBytes(EF_ETC2_R11) * 4;
+		decoded_fmt_ = EF_R8;
+	}
+
+	void TexCompressionETC2R11::EncodeBlock(void* output, void const * input, TexCompressionMethod method)
+	{
+		BOOST_ASSERT(output);
+		BOOST_ASSERT(input);
+
+		ETC2R11Block& r11 = *static_cast<ETC2R11Block*>(output);
+		uint8_t const * r = static_cast<uint8_t const *>(input);
+
+		// Identical pixels are merged, so flat and banded blocks are searched much faster
+		uint32_t values[16];
+		uint32_t weights[16];
+		uint8_t slots[16];
+		uint32_t num_values = 0;
+		for (uint32_t i = 0; i < 16; ++ i)
+		{
+			uint32_t const v = (r[i] * 2047 + 127) / 255;
+			uint32_t slot = 0;
+			while ((slot < num_values) && (values[slot] != v))
+			{
+				++ slot;
+			}
+			if (slot == num_values)
+			{
+				values[num_values] = v;
+				weights[num_values] = 0;
+				++ num_values;
+			}
+			++ weights[slot];
+			slots[i] = static_cast<uint8_t>(slot);
+		}
+
+		uint8_t selectors[16];
+		this->EncodeETC2R11Internal(r11, selectors, values, weights, num_values, method);
+
+		uint8_t pixel_selectors[16];
+		for (uint32_t i = 0; i < 16; ++ i)
+		{
+			pixel_selectors[i] = selectors[slots[i]];
+		}
+		this->PackETC2R11Selectors(r11, pixel_selectors);
+	}
+
+	void TexCompressionETC2R11::DecodeBlock(void* output, void const * input)
+	{
+		BOOST_ASSERT(output);
+		BOOST_ASSERT(input);
+
+		uint8_t* r = static_cast<uint8_t*>(output);
+		ETC2R11Block const & r11 = *static_cast<ETC2R11Block const *>(input);
+
+		uint32_t values[16];
+		this->DecodeETC2R11Internal(values, r11);
+		for (uint32_t i = 0; i < 16; ++ i)
+		{
+			r[i] = static_cast<uint8_t>((values[i] * 255 + 1023) / 2047);
+		}
+	}
+
+	uint64_t TexCompressionETC2R11::EncodeETC2R11Internal(ETC2R11Block& output, uint8_t* selectors, uint32_t const * values,
+		uint32_t const * weights, uint32_t num_values, TexCompressionMethod method) const
+	{
+		BOOST_ASSERT((num_values > 0) && (num_values <= 16));
+
+		uint32_t min_v = values[0];
+		uint32_t max_v = values[0];
+		for (uint32_t i = 1; i < num_values; ++ i)
+		{
+			min_v = std::min(min_v, values[i]);
+			max_v = std::max(max_v, values[i]);
+		}
+
+		// Speed takes the multiplier and base that fit the range of each table, the others search around them
+		int const radius = (TCM_Speed == method) ? 0 : ((TCM_Balanced == method) ? 1 : 2);
+
+		uint64_t best_err = std::numeric_limits<uint64_t>::max();
+		uint8_t trial_selectors[16];
+		for (int table = 0; (table < 16) && (best_err > 0); ++ table)
+		{
+			int const* modifiers = eac_modifier_table[table];
+			int const span = modifiers[7] - modifiers[3];
+			int const center_mod = modifiers[7] + modifiers[3];
+
+			int const fit_mult = MathLib::clamp(static_cast<int>((max_v - min_v + span * 4) / (span * 8)), 1, 15);
+			for (int mult = std::max(fit_mult - radius, 0); mult <= std::min(fit_mult + radius, 15); ++ mult)
+			{
+				// A multiplier of 0 means the modifiers are used without scaling
+				int const scale = (0 == mult) ? 1 : mult * 8;
+				int const fit_base = MathLib::clamp(static_cast<int>(MathLib::round(
+					((min_v + max_v) - center_mod * scale) / 16.0f - 0.5f)), 0, 255);
+				for (int base = std::max(fit_base - radius, 0); base <= std::min(fit_base + radius, 255); ++ base)
+				{
+					int palette[8];
+					for (int s = 0; s < 8; ++ s)
+					{
+						palette[s] = MathLib::clamp(base * 8 + 4 + modifiers[s] * scale, 0, 2047);
+					}
+
+					uint64_t err = 0;
+					for (uint32_t i = 0; (i < num_values) && (err < best_err); ++ i)
+					{
+						int const v = static_cast<int>(values[i]);
+						int best_diff = std::numeric_limits<int>::max();
+						for (int s = 0; s < 8; ++ s)
+						{
+							int const diff = std::abs(palette[s] - v);
+							if (diff < best_diff)
+							{
+								best_diff = diff;
+								trial_selectors[i] = static_cast<uint8_t>(s);
+							}
+						}
+						err += static_cast<uint64_t>(best_diff * best_diff) * weights[i];
+					}
+
+					if (err < best_err)
+					{
+						best_err = err;
+						output.base_codeword = static_cast<uint8_t>(base);
+						output.multiplier_table = static_cast<uint8_t>((mult << 4) | table);
+						memcpy(selectors, trial_selectors, num_values);
+					}
+				}
+			}
+		}
+
+		return best_err;
+	}
+
+	void TexCompressionETC2R11::PackETC2R11Selectors(ETC2R11Block& output, uint8_t const * pixel_selectors) const
+	{
+		// 48 big endian bits, pixels in column major order
+		uint64_t bits = 0;
+		for (uint32_t x = 0; x < 4; ++ x)
+		{
+			for (uint32_t y = 0; y < 4; ++ y)
+			{
+				bits = (bits << 3) | pixel_selectors[y * 4 + x];
+			}
+		}
+		for (uint32_t i = 0; i < 6; ++ i)
+		{
+			output.indices[i] = static_cast<uint8_t>(bits >> ((5 - i) * 8));
+		}
+	}
+
+	void TexCompressionETC2R11::DecodeETC2R11Internal(uint32_t* values, ETC2R11Block const & r11) const
+	{
+		uint64_t bits = 0;
+		for (uint32_t i = 0; i < 6; ++ i)
+		{
+			bits = (bits << 8) | r11.indices[i];
+		}
+
+		int const mult = r11.multiplier_table >> 4;
+		int const* modifiers = eac_modifier_table[r11.multiplier_table & 0xF];
+		int const scale = (0 == mult) ? 1 : mult * 8;
+		for (uint32_t x = 0; x < 4; ++ x)
+		{
+			for (uint32_t y = 0; y < 4; ++ y)
+			{
+				uint32_t const s = static_cast<uint32_t>(bits >> (45 - (x * 4 + y) * 3)) & 0x7;
+				values[y * 4 + x] = MathLib::clamp(r11.base_codeword * 8 + 4 + modifiers[s] * scale, 0, 2047);
+			}
+		}
+	}
+
+
+	TexCompressionETC2RG11::TexCompressionETC2RG11()
+	{
+		block_width_ = block_height_ = 4;
+		block_depth_ = 1;
+		block_bytes_ = NumFormatBytes(EF_ETC2_GR11) * 4;
+		decoded_fmt_ = EF_GR8;
+
+		r11_codec_ = MakeSharedPtr<TexCompressionETC2R11>();
+	}
+
+	void TexCompressionETC2RG11::EncodeBlock(void* output, void const * input, TexCompressionMethod method)
+	{
+		BOOST_ASSERT(output);
+		BOOST_ASSERT(input);
+
+		ETC2RG11Block& rg11 = *static_cast<ETC2RG11Block*>(output);
+		uint16_t const * gr = static_cast<uint16_t const *>(input);
+
+		uint8_t r[16];
+		uint8_t g[16];
+		for (uint32_t i = 0; i < 16; ++ i)
+		{
+			r[i] = gr[i] & 0xFF;
+			g[i] = gr[i] >> 8;
+		}
+
+		r11_codec_->EncodeBlock(&rg11.red, r, method);
+		r11_codec_->EncodeBlock(&rg11.green, g, method);
+	}
+
+	void TexCompressionETC2RG11::DecodeBlock(void* output, void const * input)
+	{
+		BOOST_ASSERT(output);
+		BOOST_ASSERT(input);
+
+		uint16_t* gr = static_cast<uint16_t*>(output);
+		ETC2RG11Block const & rg11 = *static_cast<ETC2RG11Block const *>(input);
+
+		uint8_t r[16];
+		r11_codec_->DecodeBlock(r, &rg11.red);
+		uint8_t g[16];
+		r11_codec_->DecodeBlock(g, &rg11.green);
+
+		for (uint32_t i = 0; i < 16; ++ i)
+		{
+			gr[i] = static_cast<uint16_t>(r[i] | (g[i] << 8));
+		}
+	}
 }
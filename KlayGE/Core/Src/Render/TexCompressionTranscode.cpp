@@ -0,0 +1,915 @@
+/**
+* @file TexCompressionTranscode.cpp
+* @author Minmin Gong
+*
+* @section DESCRIPTION
+*
+* This source file is part of KlayGE
+* For the latest info, see http://www.klayge.org
+*
+* @section LICENSE
+*
+* This program is free software; you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published
+* by the Free Software Foundation; either version 2 of the License, or
+* (at your option) any later version.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with this program; if not, write to the Free Software
+* Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+*
+* You may alternatively use this source under the terms of
+* the KlayGE Proprietary License (KPL). You can obtained such a license
+* from http://www.klayge.org/licensing/.
+*/
+
+
+#include <KlayGE/KlayGE.hpp>
+#include <KlayGE/TexCompressionBC.hpp>
+#include <KlayGE/TexCompressionETC.hpp>
+
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+#include <limits>
+#include <vector>
+#include <boost/assert.hpp>
+
+#include <KlayGE/TexCompressionTranscode.hpp>
+
+namespace
+{
+	using namespace KlayGE;
+
+	// Blocks from the speed tier are kept when their mean squared error per channel is under this
+	uint32_t const REFINE_MSE_THRESHOLD = 16;
+
+	// Destinations of the same source are listed in the order of preference
+	static ElementFormat const transcodable_fmts[][2] =
+	{
+		{ EF_ETC1, EF_BC1 },
+		{ EF_ETC2_BGR8, EF_BC1 },
+		{ EF_ETC2_BGR8_SRGB, EF_BC1_SRGB },
+		{ EF_ETC2_R11, EF_BC4 },
+		{ EF_ETC2_GR11, EF_BC5 },
+		{ EF_BC1, EF_ETC2_BGR8 },
+		{ EF_BC1, EF_ETC1 },
+		{ EF_BC1_SRGB, EF_ETC2_BGR8_SRGB },
+		{ EF_BC4, EF_ETC2_R11 },
+		{ EF_BC5, EF_ETC2_GR11 }
+	};
+
+	TexCompressionPtr MakeTranscodingCodec(ElementFormat format)
+	{
+		TexCompressionPtr codec;
+		switch (format)
+		{
+		case EF_BC1:
+		case EF_BC1_SRGB:
+			codec = MakeSharedPtr<TexCompressionBC1>();
+			break;
+
+		case EF_BC4:
+			codec = MakeSharedPtr<TexCompressionBC4>();
+			break;
+
+		case EF_BC5:
+			codec = MakeSharedPtr<TexCompressionBC5>();
+			break;
+
+		case EF_ETC1:
+			codec = MakeSharedPtr<TexCompressionETC1>();
+			break;
+
+		case EF_ETC2_BGR8:
+		case EF_ETC2_BGR8_SRGB:
+			codec = MakeSharedPtr<TexCompressionETC2RGB8>();
+			break;
+
+		case EF_ETC2_R11:
+			codec = MakeSharedPtr<TexCompressionETC2R11>();
+			break;
+
+		case EF_ETC2_GR11:
+			codec = MakeSharedPtr<TexCompressionETC2RG11>();
+			break;
+
+		default:
+			BOOST_ASSERT(false);
+			break;
+		}
+
+		return codec;
+	}
+
+	// In the 3-color mode of BC1, index 3 is a transparent black texel
+	bool BC1HasTransparentTexels(void const * src_data, uint32_t src_row_pitch, uint32_t src_slice_pitch,
+		uint32_t width, uint32_t height, uint32_t depth)
+	{
+		uint32_t const blocks_x = (width + 3) / 4;
+		uint32_t const blocks_y = (height + 3) / 4;
+		for (uint32_t z = 0; z < depth; ++ z)
+		{
+			for (uint32_t by = 0; by < blocks_y; ++ by)
+			{
+				BC1Block const * block = reinterpret_cast<BC1Block const *>(static_cast<uint8_t const *>(src_data)
+					+ z * src_slice_pitch + by * src_row_pitch);
+				for (uint32_t bx = 0; bx < blocks_x; ++ bx, ++ block)
+				{
+					if (block->clr_0 <= block->clr_1)
+					{
+						uint32_t const bitmap = block->bitmap[0] | (block->bitmap[1] << 16);
+						for (uint32_t i = 0; i < 16; ++ i)
+						{
+							if (3 == ((bitmap >> (i * 2)) & 3))
+							{
+								return true;
+							}
+						}
+					}
+				}
+			}
+		}
+		return false;
+	}
+
+	uint32_t BlockSquaredError(uint8_t const * lhs, uint8_t const * rhs, uint32_t size)
+	{
+		uint32_t err = 0;
+		for (uint32_t i = 0; i < size; ++ i)
+		{
+			int const diff = lhs[i] - rhs[i];
+			err += diff * diff;
+		}
+		return err;
+	}
+
+	// Decoding a block whose texel i has index i gives the palette in the first texels
+	uint8_t const bc4_ramp_bitmap[6] = { 0x88, 0xC6, 0xFA, 0, 0, 0 };
+	uint16_t const bc1_ramp_bitmap[2] = { 0xE4, 0 };
+
+	// ETC1 texel index of each selector of TexCompressionETC1::GetModifier
+	uint8_t const etc1_selector_to_index[] = { 3, 2, 0, 1 };
+
+	void BC4Palette(uint8_t* palette, TexCompressionBC4& bc4_codec, uint8_t alpha_0, uint8_t alpha_1)
+	{
+		BC4Block ramp;
+		ramp.alpha_0 = alpha_0;
+		ramp.alpha_1 = alpha_1;
+		std::memcpy(ramp.bitmap, bc4_ramp_bitmap, sizeof(ramp.bitmap));
+
+		uint8_t texels[16];
+		bc4_codec.DecodeBlock(texels, &ramp);
+		std::memcpy(palette, texels, 8);
+	}
+
+	void BC1Palette(ARGBColor32* palette, TexCompressionBC1& bc1_codec, uint16_t clr_0, uint16_t clr_1)
+	{
+		BC1Block ramp;
+		ramp.clr_0 = clr_0;
+		ramp.clr_1 = clr_1;
+		ramp.bitmap[0] = bc1_ramp_bitmap[0];
+		ramp.bitmap[1] = bc1_ramp_bitmap[1];
+
+		ARGBColor32 texels[16];
+		bc1_codec.DecodeBlock(texels, &ramp);
+		std::memcpy(palette, texels, 4 * sizeof(palette[0]));
+	}
+
+	void UnpackBC4Indices(uint8_t* indices, BC4Block const & bc4)
+	{
+		for (int i = 0; i < 2; ++ i)
+		{
+			uint32_t const bits = (bc4.bitmap[i * 3 + 2] << 16) | (bc4.bitmap[i * 3 + 1] << 8) | (bc4.bitmap[i * 3 + 0] << 0);
+			for (int j = 0; j < 8; ++ j)
+			{
+				indices[i * 8 + j] = (bits >> (j * 3)) & 0x7;
+			}
+		}
+	}
+
+	// The EAC block is searched on the used entries of the BC4 palette, their selectors are then given to the texels
+	void TranscodeBC4ToR11(ETC2R11Block& r11, BC4Block const & bc4,
+		TexCompressionBC4& bc4_codec, TexCompressionETC2R11& r11_codec, TexCompressionMethod method)
+	{
+		uint8_t palette[8];
+		BC4Palette(palette, bc4_codec, bc4.alpha_0, bc4.alpha_1);
+		uint8_t indices[16];
+		UnpackBC4Indices(indices, bc4);
+
+		uint32_t counts[8] = { 0 };
+		for (uint32_t i = 0; i < 16; ++ i)
+		{
+			++ counts[indices[i]];
+		}
+
+		uint32_t values[8];
+		uint32_t weights[8];
+		uint8_t slots[8];
+		uint32_t num_values = 0;
+		for (uint32_t p = 0; p < 8; ++ p)
+		{
+			if (counts[p] > 0)
+			{
+				uint32_t const v = (palette[p] * 2047 + 127) / 255;
+				uint32_t slot = 0;
+				while ((slot < num_values) && (values[slot] != v))
+				{
+					++ slot;
+				}
+				if (slot == num_values)
+				{
+					values[num_values] = v;
+					weights[num_values] = 0;
+					++ num_values;
+				}
+				weights[slot] += counts[p];
+				slots[p] = static_cast<uint8_t>(slot);
+			}
+		}
+
+		uint8_t selectors[8];
+		r11_codec.EncodeETC2R11Internal(r11, selectors, values, weights, num_values, method);
+
+		uint8_t pixel_selectors[16];
+		for (uint32_t i = 0; i < 16; ++ i)
+		{
+			pixel_selectors[i] = selectors[slots[indices[i]]];
+		}
+		r11_codec.PackETC2R11Selectors(r11, pixel_selectors);
+	}
+
+	struct ETC1SubblockFit
+	{
+		int color[3];
+		uint32_t table;
+		uint8_t selectors[4];
+		uint64_t error;
+	};
+
+	// Picks the intensity table and the selector of each palette color for a quantized base color.
+	// TCM_Speed only tries the tables next to the one that fits the largest offset from the base color.
+	void EvaluateETC1Subblock(ETC1SubblockFit& fit, int const * color, bool color4,
+		int const (*palette)[3], uint32_t const * weights, TexCompressionMethod method)
+	{
+		int base[3];
+		for (int c = 0; c < 3; ++ c)
+		{
+			base[c] = color4 ? Extend4To8Bits(color[c]) : Extend5To8Bits(color[c]);
+		}
+
+		// Without clamping, the error of a modifier m is constant - 2 * m * offset + 3 * m * m,
+		// so the selector is the one with the modifier nearest to offset / 3
+		int offsets[4];
+		int max_offset = 0;
+		for (uint32_t k = 0; k < 4; ++ k)
+		{
+			offsets[k] = (palette[k][0] - base[0]) + (palette[k][1] - base[1]) + (palette[k][2] - base[2]);
+			if (weights[k] > 0)
+			{
+				max_offset = std::max(max_offset, std::abs(offsets[k]));
+			}
+		}
+
+		uint32_t first_table = 0;
+		uint32_t last_table = 7;
+		if (TCM_Speed == method)
+		{
+			uint32_t seed_table = 0;
+			int best_dist = std::numeric_limits<int>::max();
+			for (uint32_t table = 0; table < 8; ++ table)
+			{
+				int const dist = std::abs(TexCompressionETC1::GetModifier(table, 3) * 3 - max_offset);
+				if (dist < best_dist)
+				{
+					best_dist = dist;
+					seed_table = table;
+				}
+			}
+			first_table = (seed_table > 0) ? seed_table - 1 : 0;
+			last_table = std::min(seed_table + 1, 7U);
+		}
+
+		fit.error = std::numeric_limits<uint64_t>::max();
+		for (uint32_t table = first_table; (table <= last_table) && (fit.error > 0); ++ table)
+		{
+			int modifiers[4];
+			for (int sel = 0; sel < 4; ++ sel)
+			{
+				modifiers[sel] = TexCompressionETC1::GetModifier(table, sel);
+			}
+
+			uint64_t err = 0;
+			uint8_t selectors[4] = { 0, 0, 0, 0 };
+			for (uint32_t k = 0; (k < 4) && (err < fit.error); ++ k)
+			{
+				if (weights[k] > 0)
+				{
+					int best_dist = std::numeric_limits<int>::max();
+					for (int sel = 0; sel < 4; ++ sel)
+					{
+						int const dist = std::abs(modifiers[sel] * 3 - offsets[k]);
+						if (dist < best_dist)
+						{
+							best_dist = dist;
+							selectors[k] = static_cast<uint8_t>(sel);
+						}
+					}
+
+					int const modifier = modifiers[selectors[k]];
+					int diff = 0;
+					for (int c = 0; c < 3; ++ c)
+					{
+						int const d = MathLib::clamp(base[c] + modifier, 0, 255) - palette[k][c];
+						diff += d * d;
+					}
+					err += static_cast<uint64_t>(diff) * weights[k];
+				}
+			}
+
+			if (err < fit.error)
+			{
+				fit.error = err;
+				fit.table = table;
+				std::memcpy(fit.selectors, selectors, sizeof(selectors));
+			}
+		}
+
+		for (int c = 0; c < 3; ++ c)
+		{
+			fit.color[c] = color[c];
+		}
+	}
+
+	// The base color starts at the weighted mean of the palette colors. The modifiers move all the channels
+	// together, so it is then centered again between the modified colors.
+	void FitETC1Subblock(ETC1SubblockFit& fit, bool color4, int const (*palette)[3], uint32_t const * weights,
+		TexCompressionMethod method)
+	{
+		int const max_q = color4 ? 15 : 31;
+
+		float sum[3] = { 0, 0, 0 };
+		uint32_t total = 0;
+		for (uint32_t k = 0; k < 4; ++ k)
+		{
+			for (int c = 0; c < 3; ++ c)
+			{
+				sum[c] += static_cast<float>(palette[k][c] * weights[k]);
+			}
+			total += weights[k];
+		}
+		BOOST_ASSERT(total > 0);
+
+		int color[3];
+		for (int c = 0; c < 3; ++ c)
+		{
+			color[c] = MathLib::clamp(static_cast<int>(sum[c] / total * max_q / 255 + 0.5f), 0, max_q);
+		}
+		EvaluateETC1Subblock(fit, color, color4, palette, weights, method);
+
+		for (int c = 0; c < 3; ++ c)
+		{
+			sum[c] = 0;
+			for (uint32_t k = 0; k < 4; ++ k)
+			{
+				int const modifier = TexCompressionETC1::GetModifier(fit.table, fit.selectors[k]);
+				sum[c] += static_cast<float>((palette[k][c] - modifier) * static_cast<int>(weights[k]));
+			}
+			color[c] = MathLib::clamp(static_cast<int>(sum[c] / total * max_q / 255 + 0.5f), 0, max_q);
+		}
+
+		ETC1SubblockFit trial;
+		if ((color[0] != fit.color[0]) || (color[1] != fit.color[1]) || (color[2] != fit.color[2]))
+		{
+			EvaluateETC1Subblock(trial, color, color4, palette, weights, method);
+			if (trial.error < fit.error)
+			{
+				fit = trial;
+			}
+		}
+
+		if (method != TCM_Speed)
+		{
+			int const radius = (TCM_Balanced == method) ? 1 : 2;
+			int const center[3] = { fit.color[0], fit.color[1], fit.color[2] };
+			for (int d = -radius; (d <= radius) && (fit.error > 0); ++ d)
+			{
+				if (d != 0)
+				{
+					for (int c = 0; c < 3; ++ c)
+					{
+						color[c] = MathLib::clamp(center[c] + d, 0, max_q);
+					}
+					EvaluateETC1Subblock(trial, color, color4, palette, weights, method);
+					if (trial.error < fit.error)
+					{
+						fit = trial;
+					}
+				}
+			}
+		}
+	}
+
+	bool InDifferentialRange(int const * color0, int const * color1)
+	{
+		for (int c = 0; c < 3; ++ c)
+		{
+			int const delta = color1[c] - color0[c];
+			if ((delta < -4) || (delta > 3))
+			{
+				return false;
+			}
+		}
+		return true;
+	}
+
+	// Moves one of the base colors of the differential mode into the range of the other
+	void ConstrainDifferential(ETC1SubblockFit* fits, int const (*palette)[3], uint32_t const (*weights)[4],
+		TexCompressionMethod method)
+	{
+		if (!InDifferentialRange(fits[0].color, fits[1].color))
+		{
+			int color[3];
+			ETC1SubblockFit moved[2];
+			for (int c = 0; c < 3; ++ c)
+			{
+				color[c] = MathLib::clamp(fits[1].color[c], fits[0].color[c] - 4, fits[0].color[c] + 3);
+			}
+			EvaluateETC1Subblock(moved[1], color, false, palette, weights[1], method);
+			for (int c = 0; c < 3; ++ c)
+			{
+				color[c] = MathLib::clamp(fits[0].color[c], fits[1].color[c] - 3, fits[1].color[c] + 4);
+			}
+			EvaluateETC1Subblock(moved[0], color, false, palette, weights[0], method);
+
+			if (fits[0].error + moved[1].error <= moved[0].error + fits[1].error)
+			{
+				fits[1] = moved[1];
+			}
+			else
+			{
+				fits[0] = moved[0];
+			}
+		}
+	}
+
+	void PackETC1Block(ETC1Block& etc1, ETC1SubblockFit const * fits, bool diff, bool flip, uint8_t const * indices)
+	{
+		uint8_t* rgb[3] = { &etc1.r, &etc1.g, &etc1.b };
+		for (int c = 0; c < 3; ++ c)
+		{
+			if (diff)
+			{
+				*rgb[c] = static_cast<uint8_t>((fits[0].color[c] << 3) | ((fits[1].color[c] - fits[0].color[c]) & 0x7));
+			}
+			else
+			{
+				*rgb[c] = static_cast<uint8_t>((fits[0].color[c] << 4) | fits[1].color[c]);
+			}
+		}
+		etc1.cw_diff_flip = static_cast<uint8_t>((fits[0].table << 5) | (fits[1].table << 2) | (diff ? 0x2 : 0) | (flip ? 0x1 : 0));
+
+		// The selector bits are big endian, pixels in column major order
+		uint16_t msb = 0;
+		uint16_t lsb = 0;
+		for (int x = 0; x < 4; ++ x)
+		{
+			for (int y = 0; y < 4; ++ y)
+			{
+				int const sub_block = (flip ? y : x) >> 1;
+				int const index = etc1_selector_to_index[fits[sub_block].selectors[indices[y * 4 + x]]];
+				int const bit_index = (x * 4 + y) ^ 0x8;
+				msb |= static_cast<uint16_t>((index >> 1) << bit_index);
+				lsb |= static_cast<uint16_t>((index & 0x1) << bit_index);
+			}
+		}
+		etc1.msb = msb;
+		etc1.lsb = lsb;
+	}
+
+	// Each subblock is fitted to the BC1 palette colors it uses. The block is valid in ETC2 RGB8 as well.
+	void TranscodeBC1ToETC1(ETC1Block& etc1, BC1Block const & bc1, TexCompressionBC1& bc1_codec, TexCompressionMethod method)
+	{
+		ARGBColor32 palette_argb[4];
+		BC1Palette(palette_argb, bc1_codec, bc1.clr_0, bc1.clr_1);
+		int palette[4][3];
+		for (uint32_t k = 0; k < 4; ++ k)
+		{
+			palette[k][0] = palette_argb[k].r();
+			palette[k][1] = palette_argb[k].g();
+			palette[k][2] = palette_argb[k].b();
+		}
+
+		uint8_t indices[16];
+		for (uint32_t i = 0; i < 16; ++ i)
+		{
+			indices[i] = (bc1.bitmap[i / 8] >> ((i & 7) * 2)) & 0x3;
+		}
+
+		uint64_t best_err = std::numeric_limits<uint64_t>::max();
+		for (int flip = 0; (flip < 2) && (best_err > 0); ++ flip)
+		{
+			uint32_t weights[2][4] = { { 0, 0, 0, 0 }, { 0, 0, 0, 0 } };
+			for (int y = 0; y < 4; ++ y)
+			{
+				for (int x = 0; x < 4; ++ x)
+				{
+					++ weights[(flip ? y : x) >> 1][indices[y * 4 + x]];
+				}
+			}
+
+			ETC1SubblockFit diff_fits[2];
+			for (int sub = 0; sub < 2; ++ sub)
+			{
+				FitETC1Subblock(diff_fits[sub], false, palette, weights[sub], method);
+			}
+
+			// TCM_Speed only falls back to the individual mode when the base colors are too far apart
+			ETC1SubblockFit individual_fits[2];
+			uint64_t individual_err = std::numeric_limits<uint64_t>::max();
+			if ((method != TCM_Speed) || !InDifferentialRange(diff_fits[0].color, diff_fits[1].color))
+			{
+				for (int sub = 0; sub < 2; ++ sub)
+				{
+					FitETC1Subblock(individual_fits[sub], true, palette, weights[sub], method);
+				}
+				individual_err = individual_fits[0].error + individual_fits[1].error;
+			}
+			ConstrainDifferential(diff_fits, palette, weights, method);
+
+			uint64_t const diff_err = diff_fits[0].error + diff_fits[1].error;
+			if (std::min(diff_err, individual_err) < best_err)
+			{
+				bool const diff = (diff_err <= individual_err);
+				best_err = diff ? diff_err : individual_err;
+				PackETC1Block(etc1, diff ? diff_fits : individual_fits, diff, flip != 0, indices);
+			}
+		}
+	}
+
+	uint16_t QuantizeRGB565(float const * color)
+	{
+		int const r = MathLib::clamp(static_cast<int>(color[0] * 31 / 255 + 0.5f), 0, 31);
+		int const g = MathLib::clamp(static_cast<int>(color[1] * 63 / 255 + 0.5f), 0, 63);
+		int const b = MathLib::clamp(static_cast<int>(color[2] * 31 / 255 + 0.5f), 0, 31);
+		return static_cast<uint16_t>((r << 11) | (g << 5) | b);
+	}
+
+	// Maps each color to the nearest one of the 4-color mode, or to the single color when the endpoints are equal
+	uint64_t MatchBC1Colors(BC1Block& bc1, uint8_t* color_indices, uint16_t clr_0, uint16_t clr_1,
+		int const (*colors)[3], uint32_t const * weights, uint32_t num_colors, TexCompressionBC1& bc1_codec)
+	{
+		if (clr_0 < clr_1)
+		{
+			std::swap(clr_0, clr_1);
+		}
+		bc1.clr_0 = clr_0;
+		bc1.clr_1 = clr_1;
+
+		ARGBColor32 palette[4];
+		BC1Palette(palette, bc1_codec, clr_0, clr_1);
+		uint32_t const num_entries = (clr_0 > clr_1) ? 4 : 1;
+
+		uint64_t err = 0;
+		for (uint32_t k = 0; k < num_colors; ++ k)
+		{
+			int best_diff = std::numeric_limits<int>::max();
+			for (uint32_t p = 0; p < num_entries; ++ p)
+			{
+				int const dr = palette[p].r() - colors[k][0];
+				int const dg = palette[p].g() - colors[k][1];
+				int const db = palette[p].b() - colors[k][2];
+				int const diff = dr * dr + dg * dg + db * db;
+				if (diff < best_diff)
+				{
+					best_diff = diff;
+					color_indices[k] = static_cast<uint8_t>(p);
+				}
+			}
+			err += static_cast<uint64_t>(best_diff) * weights[k];
+		}
+		return err;
+	}
+
+	// The BC1 endpoints are the extremes of the decoded colors along their principal axis.
+	// Other methods than TCM_Speed refine them by least squares on the chosen indices.
+	void TranscodeETCToBC1(BC1Block& bc1, void const * src, TexCompression& etc_codec, TexCompressionBC1& bc1_codec,
+		TexCompressionMethod method)
+	{
+		ARGBColor32 texels[16];
+		etc_codec.DecodeBlock(texels, src);
+
+		int colors[16][3];
+		uint32_t rgbs[16];
+		uint32_t weights[16];
+		uint8_t slots[16];
+		uint32_t num_colors = 0;
+		for (uint32_t i = 0; i < 16; ++ i)
+		{
+			uint32_t const rgb = texels[i].ARGB() & 0x00FFFFFF;
+			uint32_t slot = 0;
+			while ((slot < num_colors) && (rgbs[slot] != rgb))
+			{
+				++ slot;
+			}
+			if (slot == num_colors)
+			{
+				colors[num_colors][0] = texels[i].r();
+				colors[num_colors][1] = texels[i].g();
+				colors[num_colors][2] = texels[i].b();
+				rgbs[num_colors] = rgb;
+				weights[num_colors] = 0;
+				++ num_colors;
+			}
+			++ weights[slot];
+			slots[i] = static_cast<uint8_t>(slot);
+		}
+
+		if (1 == num_colors)
+		{
+			// The codec fits a single color with its optimal endpoint tables
+			bc1_codec.EncodeBC1Internal(bc1, texels, false, TCM_Speed);
+			return;
+		}
+
+		float mean[3] = { 0, 0, 0 };
+		for (uint32_t k = 0; k < num_colors; ++ k)
+		{
+			for (int c = 0; c < 3; ++ c)
+			{
+				mean[c] += static_cast<float>(colors[k][c] * static_cast<int>(weights[k]));
+			}
+		}
+		for (int c = 0; c < 3; ++ c)
+		{
+			mean[c] /= 16;
+		}
+
+		float cov[6] = { 0, 0, 0, 0, 0, 0 };
+		for (uint32_t k = 0; k < num_colors; ++ k)
+		{
+			float const dr = colors[k][0] - mean[0];
+			float const dg = colors[k][1] - mean[1];
+			float const db = colors[k][2] - mean[2];
+			float const w = static_cast<float>(weights[k]);
+			cov[0] += dr * dr * w;
+			cov[1] += dr * dg * w;
+			cov[2] += dr * db * w;
+			cov[3] += dg * dg * w;
+			cov[4] += dg * db * w;
+			cov[5] += db * db * w;
+		}
+
+		// Power iterations, starting from the luminance direction
+		float axis[3] = { 0.299f, 0.587f, 0.114f };
+		for (int iter = 0; iter < 4; ++ iter)
+		{
+			float const r = cov[0] * axis[0] + cov[1] * axis[1] + cov[2] * axis[2];
+			float const g = cov[1] * axis[0] + cov[3] * axis[1] + cov[4] * axis[2];
+			float const b = cov[2] * axis[0] + cov[4] * axis[1] + cov[5] * axis[2];
+			float const len = std::max(std::max(std::abs(r), std::abs(g)), std::abs(b));
+			if (len > 0)
+			{
+				axis[0] = r / len;
+				axis[1] = g / len;
+				axis[2] = b / len;
+			}
+		}
+
+		uint32_t min_k = 0;
+		uint32_t max_k = 0;
+		float min_dot = std::numeric_limits<float>::max();
+		float max_dot = -std::numeric_limits<float>::max();
+		for (uint32_t k = 0; k < num_colors; ++ k)
+		{
+			float const dot = colors[k][0] * axis[0] + colors[k][1] * axis[1] + colors[k][2] * axis[2];
+			if (dot < min_dot)
+			{
+				min_dot = dot;
+				min_k = k;
+			}
+			if (dot > max_dot)
+			{
+				max_dot = dot;
+				max_k = k;
+			}
+		}
+
+		float endpoints[2][3];
+		for (int c = 0; c < 3; ++ c)
+		{
+			endpoints[0][c] = static_cast<float>(colors[max_k][c]);
+			endpoints[1][c] = static_cast<float>(colors[min_k][c]);
+		}
+
+		uint8_t color_indices[16];
+		uint64_t best_err = MatchBC1Colors(bc1, color_indices, QuantizeRGB565(endpoints[0]), QuantizeRGB565(endpoints[1]),
+			colors, weights, num_colors, bc1_codec);
+
+		if ((method != TCM_Speed) && (best_err > 0) && (bc1.clr_0 > bc1.clr_1))
+		{
+			// Weight of clr_0 in each entry of the 4-color mode
+			static float const clr_0_weights[] = { 1, 0, 2 / 3.0f, 1 / 3.0f };
+
+			float a = 0;
+			float b = 0;
+			float d = 0;
+			float rhs[2][3] = { { 0, 0, 0 }, { 0, 0, 0 } };
+			for (uint32_t k = 0; k < num_colors; ++ k)
+			{
+				float const t = clr_0_weights[color_indices[k]];
+				float const w = static_cast<float>(weights[k]);
+				a += t * t * w;
+				b += t * (1 - t) * w;
+				d += (1 - t) * (1 - t) * w;
+				for (int c = 0; c < 3; ++ c)
+				{
+					rhs[0][c] += t * colors[k][c] * w;
+					rhs[1][c] += (1 - t) * colors[k][c] * w;
+				}
+			}
+
+			float const det = a * d - b * b;
+			if (std::abs(det) > 1e-6f)
+			{
+				for (int c = 0; c < 3; ++ c)
+				{
+					endpoints[0][c] = (d * rhs[0][c] - b * rhs[1][c]) / det;
+					endpoints[1][c] = (a * rhs[1][c] - b * rhs[0][c]) / det;
+				}
+
+				BC1Block trial;
+				uint8_t trial_indices[16];
+				uint64_t const err = MatchBC1Colors(trial, trial_indices, QuantizeRGB565(endpoints[0]), QuantizeRGB565(endpoints[1]),
+					colors, weights, num_colors, bc1_codec);
+				if (err < best_err)
+				{
+					bc1.clr_0 = trial.clr_0;
+					bc1.clr_1 = trial.clr_1;
+					std::memcpy(color_indices, trial_indices, num_colors);
+				}
+			}
+		}
+
+		bc1.bitmap[0] = bc1.bitmap[1] = 0;
+		for (uint32_t i = 0; i < 16; ++ i)
+		{
+			bc1.bitmap[i / 8] |= static_cast<uint16_t>(color_indices[slots[i]] << ((i & 7) * 2));
+		}
+	}
+
+	// The source block is read completely before the destination block is written
+	void TranscodeBlock(void* dst, void const * src, ElementFormat src_format, TexCompression& src_codec, TexCompression& dst_codec,
+		TexCompressionBC1& bc1_codec, TexCompressionBC4& bc4_codec, TexCompressionETC2R11& r11_codec,
+		TexCompressionMethod method)
+	{
+		switch (src_format)
+		{
+		case EF_BC1:
+		case EF_BC1_SRGB:
+			TranscodeBC1ToETC1(*static_cast<ETC1Block*>(dst), *static_cast<BC1Block const *>(src), bc1_codec, method);
+			break;
+
+		case EF_BC4:
+			TranscodeBC4ToR11(*static_cast<ETC2R11Block*>(dst), *static_cast<BC4Block const *>(src), bc4_codec, r11_codec, method);
+			break;
+
+		case EF_BC5:
+			{
+				BC5Block const & bc5 = *static_cast<BC5Block const *>(src);
+				ETC2RG11Block& rg11 = *static_cast<ETC2RG11Block*>(dst);
+				TranscodeBC4ToR11(rg11.red, bc5.red, bc4_codec, r11_codec, method);
+				TranscodeBC4ToR11(rg11.green, bc5.green, bc4_codec, r11_codec, method);
+			}
+			break;
+
+		case EF_ETC2_R11:
+		case EF_ETC2_GR11:
+			{
+				// BC4 fits its endpoints to the 16 values directly, which is already cheaper than working on the EAC palette
+				uint8_t texels[32];
+				src_codec.DecodeBlock(texels, src);
+				dst_codec.EncodeBlock(dst, texels, method);
+			}
+			break;
+
+		default:
+			TranscodeETCToBC1(*static_cast<BC1Block*>(dst), src, src_codec, bc1_codec, method);
+			break;
+		}
+	}
+}
+
+namespace KlayGE
+{
+	bool IsTranscodable(ElementFormat dst_format, ElementFormat src_format)
+	{
+		for (size_t i = 0; i < sizeof(transcodable_fmts) / sizeof(transcodable_fmts[0]); ++ i)
+		{
+			if ((transcodable_fmts[i][0] == dst_format) && (transcodable_fmts[i][1] == src_format))
+			{
+				return true;
+			}
+		}
+		return false;
+	}
+
+	bool IsTranscodable(ElementFormat dst_format, void const * src_data, uint32_t src_row_pitch, uint32_t src_slice_pitch,
+		ElementFormat src_format, uint32_t width, uint32_t height, uint32_t depth)
+	{
+		if (!IsTranscodable(dst_format, src_format))
+		{
+			return false;
+		}
+
+		// None of the ETC destinations of BC1 has alpha, so punch-through texels would turn opaque
+		if ((EF_BC1 == src_format) || (EF_BC1_SRGB == src_format))
+		{
+			return !BC1HasTransparentTexels(src_data, src_row_pitch, src_slice_pitch, width, height, depth);
+		}
+		return true;
+	}
+
+	void TranscodeTargets(std::vector<ElementFormat>& dst_formats, ElementFormat src_format)
+	{
+		dst_formats.clear();
+		for (size_t i = 0; i < sizeof(transcodable_fmts) / sizeof(transcodable_fmts[0]); ++ i)
+		{
+			if (transcodable_fmts[i][1] == src_format)
+			{
+				dst_formats.push_back(transcodable_fmts[i][0]);
+			}
+		}
+	}
+
+	void TranscodeTexture(void* dst_data, uint32_t dst_row_pitch, uint32_t dst_slice_pitch, ElementFormat dst_format,
+		void const * src_data, uint32_t src_row_pitch, uint32_t src_slice_pitch, ElementFormat src_format,
+		uint32_t width, uint32_t height, uint32_t depth, TexCompressionMethod method)
+	{
+		BOOST_ASSERT(IsTranscodable(dst_format, src_format));
+
+		TexCompressionPtr src_codec = MakeTranscodingCodec(src_format);
+		TexCompressionPtr dst_codec = MakeTranscodingCodec(dst_format);
+		BOOST_ASSERT(src_codec->DecodedFormat() == dst_codec->DecodedFormat());
+		BOOST_ASSERT(src_codec->BlockBytes() == dst_codec->BlockBytes());
+
+		TexCompressionBC1Ptr bc1_codec = MakeSharedPtr<TexCompressionBC1>();
+		TexCompressionBC4Ptr bc4_codec = MakeSharedPtr<TexCompressionBC4>();
+		TexCompressionETC2R11Ptr r11_codec = MakeSharedPtr<TexCompressionETC2R11>();
+
+		uint32_t const block_bytes = dst_codec->BlockBytes();
+		uint32_t const pixels_bytes = 16 * NumFormatBytes(dst_codec->DecodedFormat());
+		uint32_t const threshold = REFINE_MSE_THRESHOLD * pixels_bytes;
+
+		// Big enough for 16 ARGB8 pixels, the widest decoded format of the supported pairs
+		uint64_t src_block[2];
+		uint8_t pixels[64];
+		uint8_t decoded[64];
+		uint8_t trial[16];
+		uint8_t trial_decoded[64];
+		BOOST_ASSERT(pixels_bytes <= sizeof(pixels));
+		BOOST_ASSERT(block_bytes <= sizeof(trial));
+		BOOST_ASSERT(block_bytes <= sizeof(src_block));
+
+		uint32_t const blocks_x = (width + 3) / 4;
+		uint32_t const blocks_y = (height + 3) / 4;
+		for (uint32_t z = 0; z < depth; ++ z)
+		{
+			for (uint32_t by = 0; by < blocks_y; ++ by)
+			{
+				uint8_t const * src = static_cast<uint8_t const *>(src_data) + z * src_slice_pitch + by * src_row_pitch;
+				uint8_t* dst = static_cast<uint8_t*>(dst_data) + z * dst_slice_pitch + by * dst_row_pitch;
+				for (uint32_t bx = 0; bx < blocks_x; ++ bx)
+				{
+					// The source block is copied first, which allows in place transcoding
+					std::memcpy(src_block, src, block_bytes);
+					TranscodeBlock(dst, src_block, src_format, *src_codec, *dst_codec, *bc1_codec, *bc4_codec, *r11_codec, method);
+
+					if (method != TCM_Speed)
+					{
+						src_codec->DecodeBlock(pixels, src_block);
+						dst_codec->DecodeBlock(decoded, dst);
+						uint32_t const err = BlockSquaredError(pixels, decoded, pixels_bytes);
+						if (err > threshold)
+						{
+							dst_codec->EncodeBlock(trial, pixels, method);
+							dst_codec->DecodeBlock(trial_decoded, trial);
+							if (BlockSquaredError(pixels, trial_decoded, pixels_bytes) < err)
+							{
+								std::memcpy(dst, trial, block_bytes);
+							}
+						}
+					}
+
+					src += block_bytes;
+					dst += block_bytes;
+				}
+			}
+		}
+	}
+}
@@ -36,11 +36,23 @@
 #include <KlayGE/ResLoader.hpp>
 #include <KFL/Util.hpp>
 #include <KlayGE/TexCompressionBC.hpp>
+#include <KlayGE/TexCompressionETC.hpp>
+#include <KlayGE/TexCompressionTranscode.hpp>
 #include <KFL/Half.hpp>
+#include <KFL/Color.hpp>
+#include <KFL/Thread.hpp>
+#include <KFL/CpuInfo.hpp>
 
 #include <cstring>
+#include <cmath>
+#include <algorithm>
 #include <fstream>
 #include <boost/functional/hash.hpp>
+#if defined(KLAYGE_SSE_SUPPORT)
+#include <xmmintrin.h>
+#elif defined(KLAYGE_NEON_SUPPORT)
+#include <arm_neon.h>
+#endif
 
 #include <KlayGE/Texture.hpp>
 
@@ -848,21 +860,38 @@ namespace
 			codec = MakeSharedPtr<TexCompressionBC5>();
 			break;
 
+		case EF_BC6:
+			codec = MakeSharedPtr<TexCompressionBC6U>();
+			break;
+
+		case EF_SIGNED_BC6:
+			codec = MakeSharedPtr<TexCompressionBC6S>();
+			break;
+
+		case EF_ETC1:
+			codec = MakeSharedPtr<TexCompressionETC1>();
+			break;
+
+		case EF_ETC2_BGR8:
+		case EF_ETC2_BGR8_SRGB:
+			codec = MakeSharedPtr<TexCompressionETC2RGB8>();
+			break;
+
+		case EF_ETC2_R11:
+			codec = MakeSharedPtr<TexCompressionETC2R11>();
+			break;
+
+		case EF_ETC2_GR11:
+			codec = MakeSharedPtr<TexCompressionETC2RG11>();
+			break;
+
 		default:
 			BOOST_ASSERT(false);
 			break;
 		}
 
-		uint8_t const * src = static_cast<uint8_t const *>(src_data);
-		uint8_t* dst = static_cast<uint8_t*>(dst_data);
-		for (uint32_t z = 0; z < src_depth; ++ z)
-		{
-			codec->EncodeMem(src_width, src_height, dst, dst_row_pitch, dst_slice_pitch,
-				src, src_row_pitch, src_slice_pitch, TCM_Quality);
-
-			src += src_slice_pitch;
-			dst += dst_slice_pitch;
-		}
+		codec->EncodeMem(src_width, src_height, src_depth, dst_data, dst_row_pitch, dst_slice_pitch,
+			src_data, src_row_pitch, src_slice_pitch, TCM_Quality);
 	}
 	
 	void DecodeTexture(std::vector<uint8_t>& dst_data_block, uint32_t& dst_row_pitch, uint32_t& dst_slice_pitch, ElementFormat& dst_format,
@@ -901,11 +930,32 @@ namespace
 			dst_format = EF_SIGNED_GR8;
 			break;
 
+		case EF_BC6:
+		case EF_SIGNED_BC6:
+			dst_format = EF_ABGR16F;
+			break;
+
+		case EF_ETC1:
+		case EF_ETC2_BGR8:
+		case EF_ETC2_A1BGR8:
+			dst_format = EF_ARGB8;
+			break;
+
+		case EF_ETC2_R11:
+			dst_format = EF_R8;
+			break;
+
+		case EF_ETC2_GR11:
+			dst_format = EF_GR8;
+			break;
+
 		case EF_BC1_SRGB:
 		case EF_BC2_SRGB:
 		case EF_BC3_SRGB:
 		case EF_BC4_SRGB:
 		case EF_BC5_SRGB:
+		case EF_ETC2_BGR8_SRGB:
+		case EF_ETC2_A1BGR8_SRGB:
 			dst_format = EF_ARGB8_SRGB;
 			break;
 
@@ -948,6 +998,36 @@ namespace
 			codec = MakeSharedPtr<TexCompressionBC5>();
 			break;
 
+		case EF_BC6:
+			codec = MakeSharedPtr<TexCompressionBC6U>();
+			break;
+
+		case EF_SIGNED_BC6:
+			codec = MakeSharedPtr<TexCompressionBC6S>();
+			break;
+
+		case EF_ETC1:
+			codec = MakeSharedPtr<TexCompressionETC1>();
+			break;
+
+		case EF_ETC2_BGR8:
+		case EF_ETC2_BGR8_SRGB:
+			codec = MakeSharedPtr<TexCompressionETC2RGB8>();
+			break;
+
+		case EF_ETC2_A1BGR8:
+		case EF_ETC2_A1BGR8_SRGB:
+			codec = MakeSharedPtr<TexCompressionETC2RGB8A1>();
+			break;
+
+		case EF_ETC2_R11:
+			codec = MakeSharedPtr<TexCompressionETC2R11>();
+			break;
+
+		case EF_ETC2_GR11:
+			codec = MakeSharedPtr<TexCompressionETC2RG11>();
+			break;
+
 		default:
 			BOOST_ASSERT(false);
 			break;
@@ -1088,6 +1168,73 @@ namespace
 				array_size *= 6;
 			}
 
+			// Switching to the other compressed family keeps the texture compressed, and needs no decoded image.
+			//  BC1 with transparent texels isn't transcodable, and goes down the ARGB8 path below to keep its alpha.
+			if (!caps.texture_format_support(tex_data.format))
+			{
+				std::vector<ElementFormat> transcode_fmts;
+				TranscodeTargets(transcode_fmts, tex_data.format);
+				for (size_t i = 0; i < transcode_fmts.size(); ++ i)
+				{
+					ElementFormat const dst_fmt = transcode_fmts[i];
+					if (!caps.texture_format_support(dst_fmt))
+					{
+						continue;
+					}
+
+					bool transcodable = true;
+					uint32_t data_block_size = 0;
+					for (size_t index = 0; (index < array_size) && transcodable; ++ index)
+					{
+						uint32_t width = tex_data.width;
+						uint32_t height = tex_data.height;
+						uint32_t depth = tex_data.depth;
+						for (size_t level = 0; (level < tex_data.num_mipmaps) && transcodable; ++ level)
+						{
+							ElementInitData const & sub_init_data = tex_data.init_data[index * tex_data.num_mipmaps + level];
+							transcodable = IsTranscodable(dst_fmt, sub_init_data.data, sub_init_data.row_pitch, sub_init_data.slice_pitch,
+								tex_data.format, width, height, depth);
+							data_block_size += sub_init_data.slice_pitch * depth;
+
+							width = std::max<uint32_t>(1U, width / 2);
+							height = std::max<uint32_t>(1U, height / 2);
+							depth = std::max<uint32_t>(1U, depth / 2);
+						}
+					}
+					if (!transcodable)
+					{
+						break;
+					}
+
+					// Both formats have the same block size, so the pitches are kept
+					std::vector<uint8_t> new_data_block(data_block_size);
+					uint32_t offset = 0;
+					for (size_t index = 0; index < array_size; ++ index)
+					{
+						uint32_t width = tex_data.width;
+						uint32_t height = tex_data.height;
+						uint32_t depth = tex_data.depth;
+						for (size_t level = 0; level < tex_data.num_mipmaps; ++ level)
+						{
+							ElementInitData& sub_init_data = tex_data.init_data[index * tex_data.num_mipmaps + level];
+							TranscodeTexture(&new_data_block[offset], sub_init_data.row_pitch, sub_init_data.slice_pitch,
+								dst_fmt, sub_init_data.data, sub_init_data.row_pitch, sub_init_data.slice_pitch,
+								tex_data.format, width, height, depth, TCM_Balanced);
+							sub_init_data.data = &new_data_block[offset];
+							offset += sub_init_data.slice_pitch * depth;
+
+							width = std::max<uint32_t>(1U, width / 2);
+							height = std::max<uint32_t>(1U, height / 2);
+							depth = std::max<uint32_t>(1U, depth / 2);
+						}
+					}
+
+					tex_data.data_block.swap(new_data_block);
+					tex_data.format = dst_fmt;
+					break;
+				}
+			}
+
 			if (((EF_BC5 == tex_data.format) && !caps.texture_format_support(EF_BC5))
 				|| ((EF_BC5_SRGB == tex_data.format) && !caps.texture_format_support(EF_BC5_SRGB)))
 			{
@@ -1273,58 +1420,560 @@ namespace
 					}
 				}
 
-				if (!found)
-				{
-					LogError("%s's format (%ld) is not supported.",
-						tex_desc_.res_name.c_str(), tex_data.format);
-					break;
-				}
-			}
+				if (!found)
+				{
+					LogError("%s's format (%ld) is not supported.",
+						tex_desc_.res_name.c_str(), tex_data.format);
+					break;
+				}
+			}
+
+			if (caps.multithread_res_creating_support)
+			{
+				this->MainThreadStage();
+			}
+		}
+
+		TexturePtr CreateTexture()
+		{
+			TexDesc::TexData const & tex_data = *tex_desc_.tex_data;
+
+			TexturePtr texture;
+			RenderFactory& rf = Context::Instance().RenderFactoryInstance();
+			switch (tex_data.type)
+			{
+			case Texture::TT_1D:
+				texture = rf.MakeTexture1D(tex_data.width, tex_data.num_mipmaps, tex_data.array_size,
+					tex_data.format, 1, 0, tex_desc_.access_hint, &tex_data.init_data[0]);
+				break;
+
+			case Texture::TT_2D:
+				texture = rf.MakeTexture2D(tex_data.width, tex_data.height, tex_data.num_mipmaps, tex_data.array_size,
+					tex_data.format, 1, 0, tex_desc_.access_hint, &tex_data.init_data[0]);
+				break;
+
+			case Texture::TT_3D:
+				texture = rf.MakeTexture3D(tex_data.width, tex_data.height, tex_data.depth, tex_data.num_mipmaps,
+					tex_data.array_size, tex_data.format, 1, 0, tex_desc_.access_hint, &tex_data.init_data[0]);
+				break;
+
+			case Texture::TT_Cube:
+				texture = rf.MakeTextureCube(tex_data.width, tex_data.num_mipmaps, tex_data.array_size,
+					tex_data.format, 1, 0, tex_desc_.access_hint, &tex_data.init_data[0]);
+				break;
+
+			default:
+				BOOST_ASSERT(false);
+				break;
+			}
+
+			return texture;
+		}
+
+	private:
+		TexDesc tex_desc_;
+	};
+
+	// The uncompressed format a compressed format is encoded from and decoded to
+	ElementFormat UncompressedFormat(ElementFormat format)
+	{
+		switch (format)
+		{
+		case EF_BC1:
+		case EF_BC2:
+		case EF_BC3:
+			return EF_ARGB8;
+
+		case EF_BC4:
+			return EF_R8;
+
+		case EF_BC5:
+			return EF_GR8;
+
+		case EF_SIGNED_BC1:
+		case EF_SIGNED_BC2:
+		case EF_SIGNED_BC3:
+			return EF_SIGNED_ABGR8;
+
+		case EF_SIGNED_BC4:
+			return EF_SIGNED_R8;
+
+		case EF_SIGNED_BC5:
+			return EF_SIGNED_GR8;
+
+		case EF_BC6:
+		case EF_SIGNED_BC6:
+			return EF_ABGR16F;
+
+		case EF_ETC1:
+		case EF_ETC2_BGR8:
+			return EF_ARGB8;
+
+		case EF_ETC2_R11:
+			return EF_R8;
+
+		case EF_ETC2_GR11:
+			return EF_GR8;
+
+		case EF_BC1_SRGB:
+		case EF_BC2_SRGB:
+		case EF_BC3_SRGB:
+		case EF_BC4_SRGB:
+		case EF_BC5_SRGB:
+		case EF_ETC2_BGR8_SRGB:
+			return EF_ARGB8_SRGB;
+
+		default:
+			BOOST_ASSERT(false);
+			return format;
+		}
+	}
+
+	// Pitches of a tightly packed level, compressed formats are counted in 4x4 blocks
+	void LevelPitches(ElementFormat format, uint32_t width, uint32_t height,
+		uint32_t& row_pitch, uint32_t& slice_pitch, uint32_t& num_rows)
+	{
+		if (IsCompressedFormat(format))
+		{
+			uint32_t const block_size = NumFormatBytes(format) * 4;
+			row_pitch = (width + 3) / 4 * block_size;
+			num_rows = (height + 3) / 4;
+		}
+		else
+		{
+			row_pitch = width * NumFormatBytes(format);
+			num_rows = height;
+		}
+		slice_pitch = row_pitch * num_rows;
+	}
+
+	void CopyLevel(void* dst, uint32_t dst_row_pitch, uint32_t dst_slice_pitch,
+		void const * src, uint32_t src_row_pitch, uint32_t src_slice_pitch,
+		uint32_t row_bytes, uint32_t num_rows, uint32_t depth)
+	{
+		for (uint32_t z = 0; z < depth; ++ z)
+		{
+			uint8_t* dst_p = static_cast<uint8_t*>(dst) + z * dst_slice_pitch;
+			uint8_t const * src_p = static_cast<uint8_t const *>(src) + z * src_slice_pitch;
+			for (uint32_t y = 0; y < num_rows; ++ y)
+			{
+				std::memcpy(dst_p, src_p, row_bytes);
+				dst_p += dst_row_pitch;
+				src_p += src_row_pitch;
+			}
+		}
+	}
+
+	void TransferLevel(Texture::Mapper& mapper, TextureMapAccess tma, ElementInitData const & data,
+		uint32_t row_bytes, uint32_t num_rows, uint32_t depth)
+	{
+		if (TMA_Read_Only == tma)
+		{
+			CopyLevel(const_cast<void*>(data.data), data.row_pitch, data.slice_pitch,
+				mapper.Pointer<void>(), mapper.RowPitch(), mapper.SlicePitch(), row_bytes, num_rows, depth);
+		}
+		else
+		{
+			CopyLevel(mapper.Pointer<void>(), mapper.RowPitch(), mapper.SlicePitch(),
+				data.data, data.row_pitch, data.slice_pitch, row_bytes, num_rows, depth);
+		}
+	}
+
+	// Reads or writes a level of a sub resource (array_index * 6 + face for cube maps) of a CPU accessible texture
+	void AccessSubResource(Texture& tex, uint32_t sub_res, uint32_t level, TextureMapAccess tma,
+		ElementInitData const & data)
+	{
+		uint32_t const width = tex.Width(level);
+		uint32_t const height = tex.Height(level);
+		uint32_t const depth = tex.Depth(level);
+
+		uint32_t row_pitch, slice_pitch, num_rows;
+		LevelPitches(tex.Format(), width, height, row_pitch, slice_pitch, num_rows);
+
+		switch (tex.Type())
+		{
+		case Texture::TT_1D:
+			{
+				Texture::Mapper mapper(tex, sub_res, level, tma, 0, width);
+				TransferLevel(mapper, tma, data, row_pitch, num_rows, 1);
+			}
+			break;
+
+		case Texture::TT_2D:
+			{
+				Texture::Mapper mapper(tex, sub_res, level, tma, 0, 0, width, height);
+				TransferLevel(mapper, tma, data, row_pitch, num_rows, 1);
+			}
+			break;
+
+		case Texture::TT_3D:
+			{
+				Texture::Mapper mapper(tex, sub_res, level, tma, 0, 0, 0, width, height, depth);
+				TransferLevel(mapper, tma, data, row_pitch, num_rows, depth);
+			}
+			break;
+
+		case Texture::TT_Cube:
+			{
+				Texture::Mapper mapper(tex, sub_res / 6, static_cast<Texture::CubeFaces>(sub_res % 6), level, tma,
+					0, 0, width, height);
+				TransferLevel(mapper, tma, data, row_pitch, num_rows, 1);
+			}
+			break;
+
+		default:
+			BOOST_ASSERT(false);
+			break;
+		}
+	}
+
+	float Sinc(float x)
+	{
+		if (MathLib::abs(x) < 1e-4f)
+		{
+			return 1;
+		}
+		else
+		{
+			x *= PI;
+			return MathLib::sin(x) / x;
+		}
+	}
+
+	// Modified Bessel function of the first kind, order 0
+	float BesselI0(float x)
+	{
+		float sum = 1;
+		float term = 1;
+		float const half_x_sq = x * x / 4;
+		for (int k = 1; term > sum * 1e-7f; ++ k)
+		{
+			term *= half_x_sq / (k * k);
+			sum += term;
+		}
+		return sum;
+	}
+
+	float BoxFilter(float x)
+	{
+		x = MathLib::abs(x);
+		if (x < 0.5f)
+		{
+			return 1;
+		}
+		else
+		{
+			return (x == 0.5f) ? 0.5f : 0.0f;
+		}
+	}
+
+	float const KAISER_RADIUS = 3;
+	float const KAISER_ALPHA = 4;
+
+	float KaiserFilter(float x)
+	{
+		float const t = x / KAISER_RADIUS;
+		if (t * t >= 1)
+		{
+			return 0;
+		}
+		else
+		{
+			return Sinc(x) * BesselI0(KAISER_ALPHA * MathLib::sqrt(1 - t * t)) / BesselI0(KAISER_ALPHA);
+		}
+	}
+
+	float const LANCZOS_RADIUS = 3;
+
+	float LanczosFilter(float x)
+	{
+		if (MathLib::abs(x) >= LANCZOS_RADIUS)
+		{
+			return 0;
+		}
+		else
+		{
+			return Sinc(x) * Sinc(x / LANCZOS_RADIUS);
+		}
+	}
+
+	// Normalized weights for resampling one axis from src_size to dst_size texels, edges are clamped.
+	//  Every destination texel gets the same number of taps, padded with zero weights.
+	class MipFilterTaps
+	{
+	public:
+		MipFilterTaps(MipFilter filter, uint32_t src_size, uint32_t dst_size)
+		{
+			float radius;
+			float (*func)(float);
+			switch (filter)
+			{
+			case MF_Kaiser:
+				radius = KAISER_RADIUS;
+				func = KaiserFilter;
+				break;
+
+			case MF_Lanczos:
+				radius = LANCZOS_RADIUS;
+				func = LanczosFilter;
+				break;
+
+			case MF_Box:
+			default:
+				radius = 0.5f;
+				func = BoxFilter;
+				break;
+			}
+
+			float const scale = static_cast<float>(src_size) / dst_size;
+			float const support = radius * scale;
+			uint32_t const max_taps = static_cast<uint32_t>(std::ceil(support * 2)) + 1;
+
+			std::vector<uint32_t> indices(dst_size * max_taps);
+			std::vector<float> weights(dst_size * max_taps);
+			std::vector<uint32_t> counts(dst_size);
+			num_taps_ = 1;
+			for (uint32_t i = 0; i < dst_size; ++ i)
+			{
+				float const center = (i + 0.5f) * scale;
+				int const first = static_cast<int>(std::floor(center - support));
+
+				float sum = 0;
+				uint32_t count = 0;
+				for (uint32_t t = 0; t < max_taps; ++ t)
+				{
+					int const j = first + static_cast<int>(t);
+					float const w = func((j + 0.5f - center) / scale);
+					if (w != 0)
+					{
+						indices[i * max_taps + count] = MathLib::clamp<int>(j, 0, static_cast<int>(src_size) - 1);
+						weights[i * max_taps + count] = w;
+						sum += w;
+						++ count;
+					}
+				}
+				for (uint32_t t = 0; t < count; ++ t)
+				{
+					weights[i * max_taps + t] /= sum;
+				}
+
+				counts[i] = count;
+				num_taps_ = std::max(num_taps_, count);
+			}
+
+			indices_.assign(dst_size * num_taps_, 0);
+			weights_.assign(dst_size * num_taps_, 0.0f);
+			for (uint32_t i = 0; i < dst_size; ++ i)
+			{
+				std::copy(&indices[i * max_taps], &indices[i * max_taps] + counts[i], &indices_[i * num_taps_]);
+				std::copy(&weights[i * max_taps], &weights[i * max_taps] + counts[i], &weights_[i * num_taps_]);
+			}
+		}
+
+		uint32_t NumTaps() const
+		{
+			return num_taps_;
+		}
+		uint32_t const * Indices(uint32_t i) const
+		{
+			return &indices_[i * num_taps_];
+		}
+		float const * Weights(uint32_t i) const
+		{
+			return &weights_[i * num_taps_];
+		}
+
+	private:
+		uint32_t num_taps_;
+		std::vector<uint32_t> indices_;
+		std::vector<float> weights_;
+	};
+
+	// dst[k] = sum(weights[t] * src[indices[t] * src_stride + k]) for k in [0, num)
+	void FilterTexels(Color* dst, Color const * src, uint32_t src_stride, uint32_t num,
+		uint32_t const * indices, float const * weights, uint32_t num_taps)
+	{
+		for (uint32_t k = 0; k < num; ++ k)
+		{
+#if defined(KLAYGE_SSE_SUPPORT)
+			__m128 acc = _mm_setzero_ps();
+			for (uint32_t t = 0; t < num_taps; ++ t)
+			{
+				acc = _mm_add_ps(acc, _mm_mul_ps(_mm_set1_ps(weights[t]),
+					_mm_loadu_ps(&src[indices[t] * src_stride + k].r())));
+			}
+			_mm_storeu_ps(&dst[k].r(), acc);
+#elif defined(KLAYGE_NEON_SUPPORT)
+			float32x4_t acc = vdupq_n_f32(0);
+			for (uint32_t t = 0; t < num_taps; ++ t)
+			{
+				acc = vmlaq_n_f32(acc, vld1q_f32(&src[indices[t] * src_stride + k].r()), weights[t]);
+			}
+			vst1q_f32(&dst[k].r(), acc);
+#else
+			Color acc(0, 0, 0, 0);
+			for (uint32_t t = 0; t < num_taps; ++ t)
+			{
+				acc += src[indices[t] * src_stride + k] * weights[t];
+			}
+			dst[k] = acc;
+#endif
+		}
+	}
+
+	// A piece of work split into independent items, run over the global thread pool
+	class MipJob
+	{
+	public:
+		virtual ~MipJob()
+		{
+		}
+
+		virtual void Run(uint32_t begin, uint32_t end) const = 0;
+	};
+
+	class MipJobFunc
+	{
+	public:
+		MipJobFunc(MipJob const & job, uint32_t begin, uint32_t end)
+			: job_(&job), begin_(begin), end_(end)
+		{
+		}
+
+		void operator()()
+		{
+			job_->Run(begin_, end_);
+		}
+
+	private:
+		MipJob const * job_;
+		uint32_t begin_;
+		uint32_t end_;
+	};
+
+	// Jobs with fewer texels than this per thread are run on the calling thread
+	uint32_t const MIN_TEXELS_PER_TASK = 16 * 1024;
+
+	void RunMipJob(MipJob const & job, uint32_t num_items, uint32_t texels_per_item)
+	{
+		uint32_t const min_items = std::max(MIN_TEXELS_PER_TASK / std::max(texels_per_item, 1U), 1U);
+		uint32_t const num_tasks = std::min(num_items / min_items, static_cast<uint32_t>(CPUInfo().NumHWThreads()));
+		if (num_tasks <= 1)
+		{
+			job.Run(0, num_items);
+			return;
+		}
+
+		uint32_t const items_per_task = (num_items + num_tasks - 1) / num_tasks;
 
-			if (caps.multithread_res_creating_support)
-			{
-				this->MainThreadStage();
-			}
+		thread_pool& tp = Context::Instance().ThreadPool();
+		std::vector<joiner<void> > joiners;
+		joiners.reserve(num_tasks);
+		for (uint32_t begin = 0; begin < num_items; begin += items_per_task)
+		{
+			joiners.push_back(tp(MipJobFunc(job, begin, std::min(begin + items_per_task, num_items))));
 		}
+		for (size_t i = 0; i < joiners.size(); ++ i)
+		{
+			joiners[i]();
+		}
+	}
 
-		TexturePtr CreateTexture()
+	// Resamples one axis of every sub resource. The data is viewed as [outer][axis][inner] units of unit_size texels,
+	//  an item is one destination unit.
+	class FilterAxisJob : public MipJob
+	{
+	public:
+		FilterAxisJob(std::vector<std::vector<Color> >& dst, std::vector<std::vector<Color> > const & src,
+				MipFilterTaps const & taps, uint32_t num_outer, uint32_t src_axis, uint32_t dst_axis,
+				uint32_t num_inner, uint32_t unit_size)
+			: dst_(&dst), src_(&src), taps_(&taps), num_outer_(num_outer), src_axis_(src_axis), dst_axis_(dst_axis),
+				num_inner_(num_inner), unit_size_(unit_size)
 		{
-			TexDesc::TexData const & tex_data = *tex_desc_.tex_data;
+		}
 
-			TexturePtr texture;
-			RenderFactory& rf = Context::Instance().RenderFactoryInstance();
-			switch (tex_data.type)
+		uint32_t NumItems() const
+		{
+			return static_cast<uint32_t>(src_->size()) * num_outer_ * dst_axis_ * num_inner_;
+		}
+
+		void Run(uint32_t begin, uint32_t end) const
+		{
+			uint32_t const units_per_sub_res = num_outer_ * dst_axis_ * num_inner_;
+			for (uint32_t item = begin; item < end; ++ item)
 			{
-			case Texture::TT_1D:
-				texture = rf.MakeTexture1D(tex_data.width, tex_data.num_mipmaps, tex_data.array_size,
-					tex_data.format, 1, 0, tex_desc_.access_hint, &tex_data.init_data[0]);
-				break;
+				uint32_t const sub_res = item / units_per_sub_res;
+				uint32_t const unit = item - sub_res * units_per_sub_res;
+				uint32_t const inner = unit % num_inner_;
+				uint32_t const a = unit / num_inner_ % dst_axis_;
+				uint32_t const outer = unit / num_inner_ / dst_axis_;
+
+				Color const * src = &(*src_)[sub_res][(outer * src_axis_ * num_inner_ + inner) * unit_size_];
+				Color* dst = &(*dst_)[sub_res][unit * unit_size_];
+				FilterTexels(dst, src, num_inner_ * unit_size_, unit_size_,
+					taps_->Indices(a), taps_->Weights(a), taps_->NumTaps());
+			}
+		}
 
-			case Texture::TT_2D:
-				texture = rf.MakeTexture2D(tex_data.width, tex_data.height, tex_data.num_mipmaps, tex_data.array_size,
-					tex_data.format, 1, 0, tex_desc_.access_hint, &tex_data.init_data[0]);
-				break;
+	private:
+		std::vector<std::vector<Color> >* dst_;
+		std::vector<std::vector<Color> > const * src_;
+		MipFilterTaps const * taps_;
+		uint32_t num_outer_;
+		uint32_t src_axis_;
+		uint32_t dst_axis_;
+		uint32_t num_inner_;
+		uint32_t unit_size_;
+	};
 
-			case Texture::TT_3D:
-				texture = rf.MakeTexture3D(tex_data.width, tex_data.height, tex_data.depth, tex_data.num_mipmaps,
-					tex_data.array_size, tex_data.format, 1, 0, tex_desc_.access_hint, &tex_data.init_data[0]);
-				break;
+	// Converts rows between a format and ABGR32F, an item is one row of one sub resource
+	class ConvertRowsJob : public MipJob
+	{
+	public:
+		ConvertRowsJob(std::vector<std::vector<Color> >& levels, std::vector<ElementInitData> const & data,
+				ElementFormat format, uint32_t width, uint32_t height, uint32_t depth, bool to_float)
+			: levels_(&levels), data_(&data), format_(format), width_(width), height_(height), depth_(depth),
+				to_float_(to_float)
+		{
+		}
 
-			case Texture::TT_Cube:
-				texture = rf.MakeTextureCube(tex_data.width, tex_data.num_mipmaps, tex_data.array_size,
-					tex_data.format, 1, 0, tex_desc_.access_hint, &tex_data.init_data[0]);
-				break;
+		uint32_t NumItems() const
+		{
+			return static_cast<uint32_t>(levels_->size()) * height_ * depth_;
+		}
 
-			default:
-				BOOST_ASSERT(false);
-				break;
+		void Run(uint32_t begin, uint32_t end) const
+		{
+			uint32_t const rows_per_sub_res = height_ * depth_;
+			for (uint32_t item = begin; item < end; ++ item)
+			{
+				uint32_t const sub_res = item / rows_per_sub_res;
+				uint32_t const row = item - sub_res * rows_per_sub_res;
+				uint32_t const z = row / height_;
+				uint32_t const y = row - z * height_;
+
+				ElementInitData const & data = (*data_)[sub_res];
+				uint8_t* p = static_cast<uint8_t*>(const_cast<void*>(data.data)) + z * data.slice_pitch + y * data.row_pitch;
+				Color* clr = &(*levels_)[sub_res][row * width_];
+				if (to_float_)
+				{
+					ConvertToABGR32F(format_, p, width_, clr);
+				}
+				else
+				{
+					ConvertFromABGR32F(format_, clr, width_, p);
+				}
 			}
-
-			return texture;
 		}
 
 	private:
-		TexDesc tex_desc_;
+		std::vector<std::vector<Color> >* levels_;
+		std::vector<ElementInitData> const * data_;
+		ElementFormat format_;
+		uint32_t width_;
+		uint32_t height_;
+		uint32_t depth_;
+		bool to_float_;
 	};
 }
 
@@ -2832,12 +3481,17 @@ namespace KlayGE
 
 
 	Texture::Texture(Texture::TextureType type, uint32_t sample_count, uint32_t sample_quality, uint32_t access_hint)
-			: type_(type), sample_count_(sample_count), sample_quality_(sample_quality), access_hint_(access_hint)
+			: type_(type), sample_count_(sample_count), sample_quality_(sample_quality), access_hint_(access_hint),
+				tracking_tag_(MT_Texture), tracked_gpu_size_(0)
 	{
 	}
 
 	Texture::~Texture()
 	{
+		if (tracked_gpu_size_ > 0)
+		{
+			MemoryTracker::Instance().Deallocate(tracking_tag_, MP_GPU, tracked_gpu_size_);
+		}
 	}
 
 	TexturePtr Texture::NullObject()
@@ -2881,6 +3535,67 @@ namespace KlayGE
 		return access_hint_;
 	}
 
+	void Texture::TrackingTag(MemoryTag tag)
+	{
+		if (tag != tracking_tag_)
+		{
+			if (tracked_gpu_size_ > 0)
+			{
+				MemoryTracker& tracker = MemoryTracker::Instance();
+				tracker.Deallocate(tracking_tag_, MP_GPU, tracked_gpu_size_);
+				tracker.Allocate(tag, MP_GPU, tracked_gpu_size_);
+			}
+			tracking_tag_ = tag;
+		}
+	}
+
+	MemoryTag Texture::TrackingTag() const
+	{
+		return tracking_tag_;
+	}
+
+	uint64_t Texture::GPUMemorySize() const
+	{
+		uint64_t size = 0;
+		for (uint32_t level = 0; level < num_mip_maps_; ++ level)
+		{
+			uint32_t const width = this->Width(level);
+			uint32_t const height = this->Height(level);
+			uint32_t const depth = this->Depth(level);
+			if (IsCompressedFormat(format_))
+			{
+				uint32_t const block_size = NumFormatBytes(format_) * 4;
+				size += static_cast<uint64_t>((width + 3) / 4) * ((height + 3) / 4) * depth * block_size;
+			}
+			else
+			{
+				size += static_cast<uint64_t>(width) * height * depth * NumFormatBytes(format_);
+			}
+		}
+
+		size *= array_size_ * std::max(sample_count_, 1U);
+		if (TT_Cube == type_)
+		{
+			size *= 6;
+		}
+		return size;
+	}
+
+	void Texture::UpdateGPUMemoryUsage(bool has_hw_resource)
+	{
+		MemoryTracker& tracker = MemoryTracker::Instance();
+		if (tracked_gpu_size_ > 0)
+		{
+			tracker.Deallocate(tracking_tag_, MP_GPU, tracked_gpu_size_);
+			tracked_gpu_size_ = 0;
+		}
+		if (has_hw_resource && tracker.Enabled())
+		{
+			tracked_gpu_size_ = this->GPUMemorySize();
+			tracker.Allocate(tracking_tag_, MP_GPU, tracked_gpu_size_);
+		}
+	}
+
 	void Texture::ResizeTexture1D(Texture& target,
 		uint32_t dst_array_index, uint32_t dst_level, uint32_t dst_x_offset, uint32_t dst_width,
 		uint32_t src_array_index, uint32_t src_level, uint32_t src_x_offset, uint32_t src_width,
@@ -3189,12 +3904,105 @@ namespace KlayGE
 	}
 
 
+	void Texture::BuildMipSubLevelsOnCPU(MipFilter filter)
+	{
+		uint32_t const num_mipmaps = this->NumMipMaps();
+		if (num_mipmaps <= 1)
+		{
+			return;
+		}
+
+		uint32_t const num_sub_res = this->ArraySize() * ((TT_Cube == type_) ? 6 : 1);
+		uint32_t const width = this->Width(0);
+		uint32_t const height = this->Height(0);
+		uint32_t const depth = this->Depth(0);
+
+		TexturePtr cpu_tex;
+		Texture* cpu_tex_ptr;
+		if ((access_hint_ & EAH_CPU_Read) && (access_hint_ & EAH_CPU_Write))
+		{
+			cpu_tex_ptr = this;
+		}
+		else
+		{
+			RenderFactory& rf = Context::Instance().RenderFactoryInstance();
+			uint32_t const cpu_access_hint = EAH_CPU_Read | EAH_CPU_Write;
+			switch (type_)
+			{
+			case TT_1D:
+				cpu_tex = rf.MakeTexture1D(width, num_mipmaps, this->ArraySize(), format_, 1, 0, cpu_access_hint, nullptr);
+				break;
+
+			case TT_2D:
+				cpu_tex = rf.MakeTexture2D(width, height, num_mipmaps, this->ArraySize(), format_, 1, 0, cpu_access_hint, nullptr);
+				break;
+
+			case TT_3D:
+				cpu_tex = rf.MakeTexture3D(width, height, depth, num_mipmaps, this->ArraySize(), format_, 1, 0, cpu_access_hint, nullptr);
+				break;
+
+			case TT_Cube:
+				cpu_tex = rf.MakeTextureCube(width, num_mipmaps, this->ArraySize(), format_, 1, 0, cpu_access_hint, nullptr);
+				break;
+
+			default:
+				BOOST_ASSERT(false);
+				break;
+			}
+			this->CopyToTexture(*cpu_tex);
+			cpu_tex_ptr = cpu_tex.get();
+		}
+
+		// The top levels are copied out first, so that no more than one sub resource is mapped at a time
+		std::vector<ElementInitData> top_data(num_sub_res);
+		std::vector<uint8_t> top_data_block;
+		{
+			uint32_t row_pitch, slice_pitch, num_rows;
+			LevelPitches(format_, width, height, row_pitch, slice_pitch, num_rows);
+			top_data_block.resize(num_sub_res * slice_pitch * depth);
+			for (uint32_t sub_res = 0; sub_res < num_sub_res; ++ sub_res)
+			{
+				top_data[sub_res].data = &top_data_block[sub_res * slice_pitch * depth];
+				top_data[sub_res].row_pitch = row_pitch;
+				top_data[sub_res].slice_pitch = slice_pitch;
+				AccessSubResource(*cpu_tex_ptr, sub_res, 0, TMA_Read_Only, top_data[sub_res]);
+			}
+		}
+
+		std::vector<ElementInitData> mip_data;
+		std::vector<uint8_t> mip_data_block;
+		GenerateMipMaps(mip_data, mip_data_block, format_, &top_data[0], format_,
+			width, height, depth, num_sub_res, num_mipmaps, filter);
+
+		for (uint32_t sub_res = 0; sub_res < num_sub_res; ++ sub_res)
+		{
+			for (uint32_t level = 1; level < num_mipmaps; ++ level)
+			{
+				AccessSubResource(*cpu_tex_ptr, sub_res, level, TMA_Write_Only, mip_data[sub_res * num_mipmaps + level]);
+			}
+		}
+
+		if (cpu_tex_ptr != this)
+		{
+			cpu_tex->CopyToTexture(*this);
+		}
+	}
+
 	void ResizeTexture(void* dst_data, uint32_t dst_row_pitch, uint32_t dst_slice_pitch, ElementFormat dst_format,
 		uint32_t dst_width, uint32_t dst_height, uint32_t dst_depth,
 		void const * src_data, uint32_t src_row_pitch, uint32_t src_slice_pitch, ElementFormat src_format,
 		uint32_t src_width, uint32_t src_height, uint32_t src_depth,
 		bool linear)
 	{
+		if ((src_width == dst_width) && (src_height == dst_height) && (src_depth == dst_depth)
+			&& IsTranscodable(dst_format, src_data, src_row_pitch, src_slice_pitch, src_format, src_width, src_height, src_depth))
+		{
+			TranscodeTexture(dst_data, dst_row_pitch, dst_slice_pitch, dst_format,
+				src_data, src_row_pitch, src_slice_pitch, src_format,
+				src_width, src_height, src_depth, TCM_Quality);
+			return;
+		}
+
 		std::vector<uint8_t> src_cpu_data_block;
 		void* src_cpu_data;
 		uint32_t src_cpu_row_pitch;
@@ -3221,51 +4029,9 @@ namespace KlayGE
 		ElementFormat dst_cpu_format;
 		if (IsCompressedFormat(dst_format))
 		{
-			switch (dst_format)
-			{				
-			case EF_BC1:
-			case EF_BC2:
-			case EF_BC3:
-				dst_cpu_format = EF_ARGB8;
-				break;
-				
-			case EF_BC4:
-				dst_cpu_format = EF_R8;
-				break;
+			dst_cpu_format = UncompressedFormat(dst_format);
 
-			case EF_BC5:
-				dst_cpu_format = EF_GR8;
-				break;
-
-			case EF_SIGNED_BC1:
-			case EF_SIGNED_BC2:
-			case EF_SIGNED_BC3:
-				dst_cpu_format = EF_SIGNED_ABGR8;
-				break;
-
-			case EF_SIGNED_BC4:
-				dst_cpu_format = EF_SIGNED_R8;
-				break;
-
-			case EF_SIGNED_BC5:
-				dst_cpu_format = EF_SIGNED_GR8;
-				break;
-
-			case EF_BC1_SRGB:
-			case EF_BC2_SRGB:
-			case EF_BC3_SRGB:
-			case EF_BC4_SRGB:
-			case EF_BC5_SRGB:
-				dst_cpu_format = EF_ARGB8_SRGB;
-				break;
-
-			default:
-				BOOST_ASSERT(false);
-				dst_cpu_format = src_format;
-				break;
-			}
-
-			dst_cpu_row_pitch = dst_width * NumFormatBytes(src_cpu_format);
+			dst_cpu_row_pitch = dst_width * NumFormatBytes(dst_cpu_format);
 			dst_cpu_slice_pitch = dst_cpu_row_pitch * dst_height;
 			dst_cpu_data_block.resize(dst_depth * dst_cpu_slice_pitch);
 			dst_cpu_data = &dst_cpu_data_block[0];
@@ -3281,10 +4047,16 @@ namespace KlayGE
 		uint8_t const * src_ptr = static_cast<uint8_t const *>(src_cpu_data);
 		uint8_t* dst_ptr = static_cast<uint8_t*>(dst_cpu_data);
 		uint32_t const src_elem_size = NumFormatBytes(src_cpu_format);
-		uint32_t const dst_elem_size = NumFormatBytes(dst_cpu_format);
 
-		if (!linear && (src_cpu_format == dst_cpu_format))
+		if (!linear)
 		{
+			// Nearest sampling, converted row by row without going through ABGR32F for the common format pairs
+			std::vector<uint8_t> sampled_row;
+			if ((src_width != dst_width) && (src_cpu_format != dst_cpu_format))
+			{
+				sampled_row.resize(dst_width * src_elem_size);
+			}
+
 			for (uint32_t z = 0; z < dst_depth; ++ z)
 			{
 				float fz = static_cast<float>(z) / dst_depth * src_depth;
@@ -3300,15 +4072,20 @@ namespace KlayGE
 
 					if (src_width == dst_width)
 					{
-						std::memcpy(dst_p, src_p, src_width * src_elem_size);
+						ConvertFormat(dst_cpu_format, dst_p, src_cpu_format, src_p, src_width);
 					}
 					else
 					{
-						for (uint32_t x = 0; x < dst_width; ++ x, dst_p += dst_elem_size)
+						uint8_t* sampled_p = sampled_row.empty() ? dst_p : &sampled_row[0];
+						for (uint32_t x = 0; x < dst_width; ++ x)
 						{
 							float fx = static_cast<float>(x) / dst_width * src_width;
 							uint32_t sx = std::min(static_cast<uint32_t>(fx + 0.5f), src_width - 1);
-							std::memcpy(dst_p, src_p + sx * src_elem_size, src_elem_size);
+							std::memcpy(sampled_p + x * src_elem_size, src_p + sx * src_elem_size, src_elem_size);
+						}
+						if (!sampled_row.empty())
+						{
+							ConvertFormat(dst_cpu_format, dst_p, src_cpu_format, sampled_p, dst_width);
 						}
 					}
 				}
@@ -3328,62 +4105,39 @@ namespace KlayGE
 				}
 			}
 
+			// Only linear filtering gets here, nearest sampling is handled above without the float round trip
 			std::vector<Color> dst_32f(dst_width * dst_height * dst_depth);
-			if (linear)
-			{
-				for (uint32_t z = 0; z < dst_depth; ++ z)
-				{
-					float fz = static_cast<float>(z) / dst_depth * src_depth;
-					uint32_t sz0 = static_cast<uint32_t>(fz);
-					uint32_t sz1 = MathLib::clamp<uint32_t>(sz0 + 1, 0, src_depth - 1);
-					float weight_z = fz - sz0;
-							
-					for (uint32_t y = 0; y < dst_height; ++ y)
-					{
-						float fy = static_cast<float>(y) / dst_height * src_height;
-						uint32_t sy0 = static_cast<uint32_t>(fy);
-						uint32_t sy1 = MathLib::clamp<uint32_t>(sy0 + 1, 0, src_height - 1);
-						float weight_y = fy - sy0;
-							
-						for (uint32_t x = 0; x < dst_width; ++ x)
-						{
-							float fx = static_cast<float>(x) / dst_width * src_width;
-							uint32_t sx0 = static_cast<uint32_t>(fx);
-							uint32_t sx1 = MathLib::clamp<uint32_t>(sx0 + 1, 0, src_width - 1);
-							float weight_x = fx - sx0;
-							Color clr_x00 = MathLib::lerp(src_32f[(sz0 * src_height + sy0) * src_width + sx0],
-								src_32f[(sz0 * src_height + sy0) * src_width + sx1], weight_x);
-							Color clr_x01 = MathLib::lerp(src_32f[(sz0 * src_height + sy1) * src_width + sx0],
-								src_32f[(sz0 * src_height + sy1) * src_width + sx1], weight_x);
-							Color clr_y0 = MathLib::lerp(clr_x00, clr_x01, weight_y);
-							Color clr_x10 = MathLib::lerp(src_32f[(sz1 * src_height + sy0) * src_width + sx0],
-								src_32f[(sz1 * src_height + sy0) * src_width + sx1], weight_x);
-							Color clr_x11 = MathLib::lerp(src_32f[(sz1 * src_height + sy1) * src_width + sx0],
-								src_32f[(sz1 * src_height + sy1) * src_width + sx1], weight_x);
-							Color clr_y1 = MathLib::lerp(clr_x10, clr_x11, weight_y);
-							dst_32f[(z * dst_height + y) * dst_width + x] = MathLib::lerp(clr_y0, clr_y1, weight_z);
-						}
-					}
-				}
-			}
-			else
+			for (uint32_t z = 0; z < dst_depth; ++ z)
 			{
-				for (uint32_t z = 0; z < dst_depth; ++ z)
+				float fz = static_cast<float>(z) / dst_depth * src_depth;
+				uint32_t sz0 = static_cast<uint32_t>(fz);
+				uint32_t sz1 = MathLib::clamp<uint32_t>(sz0 + 1, 0, src_depth - 1);
+				float weight_z = fz - sz0;
+						
+				for (uint32_t y = 0; y < dst_height; ++ y)
 				{
-					float fz = static_cast<float>(z) / dst_depth * src_depth;
-					uint32_t sz = std::min(static_cast<uint32_t>(fz + 0.5f), src_depth - 1);
-
-					for (uint32_t y = 0; y < dst_height; ++ y)
+					float fy = static_cast<float>(y) / dst_height * src_height;
+					uint32_t sy0 = static_cast<uint32_t>(fy);
+					uint32_t sy1 = MathLib::clamp<uint32_t>(sy0 + 1, 0, src_height - 1);
+					float weight_y = fy - sy0;
+						
+					for (uint32_t x = 0; x < dst_width; ++ x)
 					{
-						float fy = static_cast<float>(y) / dst_height * src_height;
-						uint32_t sy = std::min(static_cast<uint32_t>(fy + 0.5f), src_height - 1);
-
-						for (uint32_t x = 0; x < dst_width; ++ x)
-						{
-							float fx = static_cast<float>(x) / dst_width * src_width;
-							uint32_t sx = std::min(static_cast<uint32_t>(fx + 0.5f), src_width - 1);
-							dst_32f[(z * dst_height + y) * dst_width + x] = src_32f[(sz * src_height + sy) * src_width + sx];
-						}
+						float fx = static_cast<float>(x) / dst_width * src_width;
+						uint32_t sx0 = static_cast<uint32_t>(fx);
+						uint32_t sx1 = MathLib::clamp<uint32_t>(sx0 + 1, 0, src_width - 1);
+						float weight_x = fx - sx0;
+						Color clr_x00 = MathLib::lerp(src_32f[(sz0 * src_height + sy0) * src_width + sx0],
+							src_32f[(sz0 * src_height + sy0) * src_width + sx1], weight_x);
+						Color clr_x01 = MathLib::lerp(src_32f[(sz0 * src_height + sy1) * src_width + sx0],
+							src_32f[(sz0 * src_height + sy1) * src_width + sx1], weight_x);
+						Color clr_y0 = MathLib::lerp(clr_x00, clr_x01, weight_y);
+						Color clr_x10 = MathLib::lerp(src_32f[(sz1 * src_height + sy0) * src_width + sx0],
+							src_32f[(sz1 * src_height + sy0) * src_width + sx1], weight_x);
+						Color clr_x11 = MathLib::lerp(src_32f[(sz1 * src_height + sy1) * src_width + sx0],
+							src_32f[(sz1 * src_height + sy1) * src_width + sx1], weight_x);
+						Color clr_y1 = MathLib::lerp(clr_x10, clr_x11, weight_y);
+						dst_32f[(z * dst_height + y) * dst_width + x] = MathLib::lerp(clr_y0, clr_y1, weight_z);
 					}
 				}
 			}
@@ -3407,6 +4161,173 @@ namespace KlayGE
 		}
 	}
 
+	void GenerateMipMaps(std::vector<ElementInitData>& dst_data, std::vector<uint8_t>& dst_data_block, ElementFormat dst_format,
+		ElementInitData const * src_data, ElementFormat src_format,
+		uint32_t width, uint32_t height, uint32_t depth, uint32_t num_sub_res, uint32_t num_mipmaps,
+		MipFilter filter)
+	{
+		if (0 == num_mipmaps)
+		{
+			uint32_t const max_size = std::max(std::max(width, height), depth);
+			num_mipmaps = 1;
+			while ((max_size >> num_mipmaps) != 0)
+			{
+				++ num_mipmaps;
+			}
+		}
+
+		dst_data.resize(num_sub_res * num_mipmaps);
+		{
+			std::vector<size_t> base(dst_data.size());
+			size_t data_block_size = 0;
+			for (uint32_t sub_res = 0; sub_res < num_sub_res; ++ sub_res)
+			{
+				for (uint32_t mip = 0; mip < num_mipmaps; ++ mip)
+				{
+					uint32_t const index = sub_res * num_mipmaps + mip;
+					uint32_t num_rows;
+					LevelPitches(dst_format, std::max(width >> mip, 1U), std::max(height >> mip, 1U),
+						dst_data[index].row_pitch, dst_data[index].slice_pitch, num_rows);
+					base[index] = data_block_size;
+					data_block_size += dst_data[index].slice_pitch * std::max(depth >> mip, 1U);
+				}
+			}
+
+			dst_data_block.resize(data_block_size);
+			for (size_t i = 0; i < dst_data.size(); ++ i)
+			{
+				dst_data[i].data = &dst_data_block[base[i]];
+			}
+		}
+
+		// Every level is filtered from the previous one in ABGR32F, which is linear for sRGB formats.
+		//  Only the stored copy of a level is quantized.
+		std::vector<std::vector<Color> > levels(num_sub_res, std::vector<Color>(width * height * depth));
+		{
+			std::vector<ElementInitData> src_cpu_data(src_data, src_data + num_sub_res);
+			ElementFormat src_cpu_format = src_format;
+			std::vector<std::vector<uint8_t> > decoded_data_blocks;
+			if (IsCompressedFormat(src_format))
+			{
+				decoded_data_blocks.resize(num_sub_res);
+				for (uint32_t sub_res = 0; sub_res < num_sub_res; ++ sub_res)
+				{
+					DecodeTexture(decoded_data_blocks[sub_res], src_cpu_data[sub_res].row_pitch, src_cpu_data[sub_res].slice_pitch,
+						src_cpu_format, src_data[sub_res].data, src_data[sub_res].row_pitch, src_data[sub_res].slice_pitch,
+						src_format, width, height, depth);
+					src_cpu_data[sub_res].data = &decoded_data_blocks[sub_res][0];
+				}
+			}
+
+			ConvertRowsJob job(levels, src_cpu_data, src_cpu_format, width, height, depth, true);
+			RunMipJob(job, job.NumItems(), width);
+		}
+
+		bool const compressed = IsCompressedFormat(dst_format);
+		ElementFormat const dst_cpu_format = compressed ? UncompressedFormat(dst_format) : dst_format;
+
+		std::vector<std::vector<Color> > filtered(num_sub_res);
+		std::vector<uint8_t> dst_cpu_data_block;
+		std::vector<ElementInitData> level_data(num_sub_res);
+		uint32_t the_width = width;
+		uint32_t the_height = height;
+		uint32_t the_depth = depth;
+		for (uint32_t mip = 0; mip < num_mipmaps; ++ mip)
+		{
+			if (mip > 0)
+			{
+				uint32_t const new_width = std::max(the_width / 2, 1U);
+				uint32_t const new_height = std::max(the_height / 2, 1U);
+				uint32_t const new_depth = std::max(the_depth / 2, 1U);
+
+				// Separable, one pass per axis that changes
+				if (new_width != the_width)
+				{
+					MipFilterTaps taps(filter, the_width, new_width);
+					for (uint32_t sub_res = 0; sub_res < num_sub_res; ++ sub_res)
+					{
+						filtered[sub_res].resize(new_width * the_height * the_depth);
+					}
+					FilterAxisJob job(filtered, levels, taps, the_height * the_depth, the_width, new_width, 1, 1);
+					RunMipJob(job, job.NumItems(), taps.NumTaps());
+					levels.swap(filtered);
+				}
+				if (new_height != the_height)
+				{
+					MipFilterTaps taps(filter, the_height, new_height);
+					for (uint32_t sub_res = 0; sub_res < num_sub_res; ++ sub_res)
+					{
+						filtered[sub_res].resize(new_width * new_height * the_depth);
+					}
+					FilterAxisJob job(filtered, levels, taps, the_depth, the_height, new_height, 1, new_width);
+					RunMipJob(job, job.NumItems(), new_width * taps.NumTaps());
+					levels.swap(filtered);
+				}
+				if (new_depth != the_depth)
+				{
+					MipFilterTaps taps(filter, the_depth, new_depth);
+					for (uint32_t sub_res = 0; sub_res < num_sub_res; ++ sub_res)
+					{
+						filtered[sub_res].resize(new_width * new_height * new_depth);
+					}
+					FilterAxisJob job(filtered, levels, taps, 1, the_depth, new_depth, new_height, new_width);
+					RunMipJob(job, job.NumItems(), new_width * taps.NumTaps());
+					levels.swap(filtered);
+				}
+
+				the_width = new_width;
+				the_height = new_height;
+				the_depth = new_depth;
+			}
+
+			for (uint32_t sub_res = 0; sub_res < num_sub_res; ++ sub_res)
+			{
+				level_data[sub_res] = dst_data[sub_res * num_mipmaps + mip];
+			}
+
+			if ((0 == mip) && (src_format == dst_format))
+			{
+				uint32_t row_pitch, slice_pitch, num_rows;
+				LevelPitches(dst_format, width, height, row_pitch, slice_pitch, num_rows);
+				for (uint32_t sub_res = 0; sub_res < num_sub_res; ++ sub_res)
+				{
+					CopyLevel(const_cast<void*>(level_data[sub_res].data), level_data[sub_res].row_pitch, level_data[sub_res].slice_pitch,
+						src_data[sub_res].data, src_data[sub_res].row_pitch, src_data[sub_res].slice_pitch,
+						row_pitch, num_rows, depth);
+				}
+			}
+			else if (compressed)
+			{
+				// Compress each level as soon as it's produced, only one uncompressed level is kept around
+				uint32_t const cpu_row_pitch = the_width * NumFormatBytes(dst_cpu_format);
+				uint32_t const cpu_slice_pitch = cpu_row_pitch * the_height;
+				dst_cpu_data_block.resize(num_sub_res * cpu_slice_pitch * the_depth);
+				std::vector<ElementInitData> cpu_data(num_sub_res);
+				for (uint32_t sub_res = 0; sub_res < num_sub_res; ++ sub_res)
+				{
+					cpu_data[sub_res].data = &dst_cpu_data_block[sub_res * cpu_slice_pitch * the_depth];
+					cpu_data[sub_res].row_pitch = cpu_row_pitch;
+					cpu_data[sub_res].slice_pitch = cpu_slice_pitch;
+				}
+
+				ConvertRowsJob job(levels, cpu_data, dst_cpu_format, the_width, the_height, the_depth, false);
+				RunMipJob(job, job.NumItems(), the_width);
+
+				for (uint32_t sub_res = 0; sub_res < num_sub_res; ++ sub_res)
+				{
+					EncodeTexture(const_cast<void*>(level_data[sub_res].data), level_data[sub_res].row_pitch, level_data[sub_res].slice_pitch,
+						dst_format, cpu_data[sub_res].data, cpu_row_pitch, cpu_slice_pitch, dst_cpu_format,
+						the_width, the_height, the_depth);
+				}
+			}
+			else
+			{
+				ConvertRowsJob job(levels, level_data, dst_format, the_width, the_height, the_depth, false);
+				RunMipJob(job, job.NumItems(), the_width);
+			}
+		}
+	}
+
 
 	template KLAYGE_CORE_API std::pair<float3, float3> CubeMapViewVector(Texture::CubeFaces face);
 
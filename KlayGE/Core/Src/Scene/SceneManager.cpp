@@ -53,6 +53,7 @@
 #include <KlayGE/InputFactory.hpp>
 #include <KlayGE/FrameBuffer.hpp>
 #include <KlayGE/DeferredRenderingLayer.hpp>
+#include <KlayGE/PerfProfiler.hpp>
 
 #include <map>
 #include <algorithm>
@@ -98,7 +99,7 @@ namespace KlayGE
 	/////////////////////////////////////////////////////////////////////////////////
 	SceneManager::SceneManager()
 		: frustum_(nullptr),
-			small_obj_threshold_(0),
+			small_obj_threshold_(0), lod_threshold_(0.1f),
 			update_elapse_(1.0f / 60),
 			num_objects_rendered_(0), num_renderables_rendered_(0),
 			num_primitives_rendered_(0), num_vertices_rendered_(0),
@@ -134,6 +135,11 @@ namespace KlayGE
 		small_obj_threshold_ = area;
 	}
 
+	void SceneManager::LodThreshold(float area)
+	{
+		lod_threshold_ = area;
+	}
+
 	void SceneManager::SceneUpdateElapse(float elapse)
 	{
 		update_elapse_ = elapse;
@@ -143,6 +149,8 @@ namespace KlayGE
 	/////////////////////////////////////////////////////////////////////////////////
 	void SceneManager::ClipScene()
 	{
+		KLAYGE_PERF_SCOPE("SceneManager::ClipScene");
+
 		App3DFramework& app = Context::Instance().AppInstance();
 		Camera& camera = app.ActiveCamera();
 
@@ -545,6 +553,8 @@ namespace KlayGE
 	/////////////////////////////////////////////////////////////////////////////////
 	void SceneManager::Flush(uint32_t urt)
 	{
+		KLAYGE_PERF_SCOPE("SceneManager::Flush");
+
 		lock_guard<mutex> lock(update_mutex_);
 
 		urt_ = urt;
@@ -562,6 +572,10 @@ namespace KlayGE
 		Camera& camera = app.ActiveCamera();
 		SceneObjsType& scene_objs = (urt & App3DFramework::URV_Overlay) ? overlay_scene_objs_ : scene_objs_;
 
+		// Only the main camera picks the levels of detail. Shadow maps and other views reuse them, so that a mesh
+		//  doesn't shadow itself with a different shape.
+		bool const lod_camera = (re.DefaultFrameBuffer()->GetViewport()->camera.get() == &camera);
+
 		KLAYGE_FOREACH(SceneObjsType::const_reference scene_obj, scene_objs)
 		{
 			scene_obj->VisibleMark(BO_No);
@@ -625,6 +639,15 @@ namespace KlayGE
 					RenderablePtr const & renderable = so->GetRenderable();
 					if (renderable)
 					{
+						if (lod_camera && (so->Attrib() & SceneObject::SOA_Cullable))
+						{
+							uint32_t const num_lods = renderable->NumLods();
+							if (num_lods > 1)
+							{
+								this->UpdateLod(*so, camera, num_lods);
+							}
+						}
+
 						KLAYGE_AUTO(iter, renderables_map.lower_bound(renderable));
 						if ((iter != renderables_map.end()) && (iter->first == renderable))
 						{
@@ -647,6 +670,15 @@ namespace KlayGE
 		{
 			Renderable& ra(*renderable.first);
 			ra.AssignInstances(renderable.second.begin(), renderable.second.end());
+
+			// The instances are drawn together, with the finest level any of them needs
+			int32_t lod = renderable.second[0]->Lod();
+			for (size_t i = 1; i < renderable.second.size(); ++ i)
+			{
+				lod = std::min(lod, renderable.second[i]->Lod());
+			}
+			ra.ActiveLod(lod);
+
 			ra.AddToRenderQueue();
 		}
 
@@ -860,4 +892,28 @@ namespace KlayGE
 
 		return visible;
 	}
+
+	// Level 1 takes over below lod_threshold_ of the screen, and each level after it when the area halves again,
+	//  as it has half the triangles. The level only changes once the area is LOD_HYSTERESIS of a level past the
+	//  boundary, so objects near it don't pop back and forth.
+	void SceneManager::UpdateLod(SceneObject& obj, Camera const & camera, uint32_t num_lods)
+	{
+		float const LOD_HYSTERESIS = 0.25f;
+
+		float const area = MathLib::perspective_area(camera.EyePos(), camera.ViewProjMatrix(), *obj.PosBoundWS());
+		float const level = (area > 0) ? log(lod_threshold_ / area) / log(2.0f) + 1 : static_cast<float>(num_lods);
+
+		int32_t lod = obj.Lod();
+		int32_t const coarser = static_cast<int32_t>(floor(level - LOD_HYSTERESIS));
+		int32_t const finer = static_cast<int32_t>(floor(level + LOD_HYSTERESIS));
+		if (coarser > lod)
+		{
+			lod = coarser;
+		}
+		else if (finer < lod)
+		{
+			lod = finer;
+		}
+		obj.Lod(MathLib::clamp(lod, 0, static_cast<int32_t>(num_lods) - 1));
+	}
 }
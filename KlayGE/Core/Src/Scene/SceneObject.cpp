@@ -29,7 +29,7 @@ namespace KlayGE
 	SceneObject::SceneObject(uint32_t attrib)
 		: attrib_(attrib), parent_(nullptr),
 			model_(float4x4::Identity()), abs_model_(float4x4::Identity()),
-			visible_mark_(BO_No)
+			visible_mark_(BO_No), lod_(0)
 	{
 		if (!(attrib & SOA_Overlay) && (attrib & (SOA_Cullable | SOA_Moveable)))
 		{
@@ -119,6 +119,16 @@ namespace KlayGE
 		return visible_mark_;
 	}
 
+	void SceneObject::Lod(int32_t lod)
+	{
+		lod_ = lod;
+	}
+
+	int32_t SceneObject::Lod() const
+	{
+		return lod_;
+	}
+
 	void SceneObject::BindSubThreadUpdateFunc(function<void(SceneObject&, float, float)> const & update_func)
 	{
 		sub_thread_update_func_ = update_func;
@@ -78,5 +78,14 @@ namespace KlayGE
 	void UIStatic::SetText(std::wstring const & strText)
 	{
 		text_ = strText;
+
+		if (!elements_.empty())
+		{
+			FontPtr const & font = UIManager::Instance().GetFont(elements_[0]->FontIndex());
+			if (font)
+			{
+				font->Prefetch(text_);
+			}
+		}
 	}
 }
@@ -1031,6 +1031,7 @@ namespace KlayGE
 			user_export_settings |= MeshMLObj::UES_CombineMeshes;
 		}
 		user_export_settings |= MeshMLObj::UES_SortMeshes;
+		user_export_settings |= MeshMLObj::UES_OptimizeVertexCache;
 
 		meshml_obj_.WriteMeshML(ofs, vertex_export_settings, user_export_settings);
 	}
@@ -132,6 +132,7 @@ namespace KlayGE
 								LPCSTR pTarget, UINT Flags1, UINT Flags2, ID3DBlob** ppCode, ID3DBlob** ppErrorMsgs) const;
 		HRESULT D3DReflect(LPCVOID pSrcData, SIZE_T SrcDataSize, REFIID pInterface, void** ppReflector) const;
 		HRESULT D3DStripShader(LPCVOID pShaderBytecode, SIZE_T BytecodeLength, UINT uStripFlags, ID3DBlob** ppStrippedBlob) const;
+		std::string const & D3DCompilerVersion() const;
 #endif
 
 	private:
@@ -187,6 +188,8 @@ namespace KlayGE
 		D3DCompileFunc DynamicD3DCompile_;
 		D3DReflectFunc DynamicD3DReflect_;
 		D3DStripShaderFunc DynamicD3DStripShader_;
+
+		std::string d3dcompiler_version_;
 #endif
 
 		// Direct3D rendering device
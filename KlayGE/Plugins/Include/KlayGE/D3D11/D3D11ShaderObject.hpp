@@ -105,6 +105,8 @@ namespace KlayGE
 			std::vector<uint32_t> const & shader_desc_ids) KLAYGE_OVERRIDE;
 		virtual void StreamOut(std::ostream& os, ShaderType type) KLAYGE_OVERRIDE;
 
+		virtual void CompileShader(ShaderType type, RenderEffect const & effect,
+			RenderTechnique const & tech, RenderPass const & pass, std::vector<uint32_t> const & shader_desc_ids) KLAYGE_OVERRIDE;
 		void AttachShader(ShaderType type, RenderEffect const & effect,
 			RenderTechnique const & tech, RenderPass const & pass, std::vector<uint32_t> const & shader_desc_ids);
 		void AttachShader(ShaderType type, RenderEffect const & effect,
@@ -153,6 +155,8 @@ namespace KlayGE
 		ID3D11DomainShaderPtr domain_shader_;
 		array<std::pair<shared_ptr<std::vector<uint8_t> >, std::string>, ST_NumShaderTypes> shader_code_;
 		array<D3D11ShaderDesc, ST_NumShaderTypes> shader_desc_;
+		array<bool, ST_NumShaderTypes> is_compiled_;
+		array<shared_ptr<std::vector<uint8_t> >, ST_NumShaderTypes> compiled_code_;
 
 		array<std::vector<ID3D11SamplerStatePtr>, ST_NumShaderTypes> samplers_;
 		array<std::vector<tuple<void*, uint32_t, uint32_t> >, ST_NumShaderTypes> srvsrcs_;
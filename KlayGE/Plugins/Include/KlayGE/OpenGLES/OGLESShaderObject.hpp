@@ -37,6 +37,8 @@ namespace KlayGE
 			std::vector<uint32_t> const & shader_desc_ids) KLAYGE_OVERRIDE;
 		virtual void StreamOut(std::ostream& os, ShaderType type) KLAYGE_OVERRIDE;
 
+		virtual void CompileShader(ShaderType type, RenderEffect const & effect,
+			RenderTechnique const & tech, RenderPass const & pass, std::vector<uint32_t> const & shader_desc_ids) KLAYGE_OVERRIDE;
 		void AttachShader(ShaderType type, RenderEffect const & effect,
 			RenderTechnique const & tech, RenderPass const & pass, std::vector<uint32_t> const & shader_desc_ids);
 		void AttachShader(ShaderType type, RenderEffect const & effect,
@@ -77,6 +79,7 @@ namespace KlayGE
 		GLuint glsl_program_;
 		GLenum glsl_bin_format_;
 		shared_ptr<std::vector<uint8_t> > glsl_bin_program_;
+		array<bool, ST_NumShaderTypes> is_compiled_;
 		shared_ptr<array<std::string, ST_NumShaderTypes> > shader_func_names_;
 		shared_ptr<array<shared_ptr<std::string>, ST_NumShaderTypes> > glsl_srcs_;
 		shared_ptr<array<shared_ptr<std::vector<std::string> >, ST_NumShaderTypes> > pnames_;
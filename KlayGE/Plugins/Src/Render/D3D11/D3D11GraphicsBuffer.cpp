@@ -53,6 +53,7 @@ namespace KlayGE
 
 			this->CreateBuffer(&subres_init);
 			hw_buff_size_ = size_in_byte_;
+			this->UpdateGPUMemoryUsage();
 		}
 	}
 
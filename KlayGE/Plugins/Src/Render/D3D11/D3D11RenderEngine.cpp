@@ -29,6 +29,7 @@
 #include <KlayGE/RenderEffect.hpp>
 #include <KlayGE/RenderSettings.hpp>
 #include <KlayGE/PostProcess.hpp>
+#include <KlayGE/ShaderCache.hpp>
 
 #include <KlayGE/D3D11/D3D11RenderWindow.hpp>
 #include <KlayGE/D3D11/D3D11FrameBuffer.hpp>
@@ -156,6 +157,7 @@ namespace KlayGE
 			DynamicD3DCompile_ = reinterpret_cast<D3DCompileFunc>(::GetProcAddress(mod_d3dcompiler_, "D3DCompile"));
 			DynamicD3DReflect_ = reinterpret_cast<D3DReflectFunc>(::GetProcAddress(mod_d3dcompiler_, "D3DReflect"));
 			DynamicD3DStripShader_ = reinterpret_cast<D3DStripShaderFunc>(::GetProcAddress(mod_d3dcompiler_, "D3DStripShader"));
+			d3dcompiler_version_ = ShaderCache::CompilerVersion(static_cast<void*>(mod_d3dcompiler_));
 		}
 #else
 		DynamicCreateDXGIFactory1_ = ::CreateDXGIFactory1;
@@ -1771,5 +1773,10 @@ namespace KlayGE
 	{
 		return DynamicD3DStripShader_(pShaderBytecode, BytecodeLength, uStripFlags, ppStrippedBlob);
 	}
+
+	std::string const & D3D11RenderEngine::D3DCompilerVersion() const
+	{
+		return d3dcompiler_version_;
+	}
 #endif
 }
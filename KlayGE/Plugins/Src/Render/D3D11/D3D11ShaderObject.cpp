@@ -25,6 +25,7 @@
 #include <KlayGE/RenderEngine.hpp>
 #include <KlayGE/RenderFactory.hpp>
 #include <KlayGE/RenderEffect.hpp>
+#include <KlayGE/ShaderCache.hpp>
 
 #include <string>
 #include <map>
@@ -236,6 +237,7 @@ namespace KlayGE
 		has_discard_ = true;
 		has_tessellation_ = false;
 		is_shader_validate_.fill(true);
+		is_compiled_.fill(false);
 	}
 
 	std::string D3D11ShaderObject::GenShaderText(ShaderType type, RenderEffect const & effect,
@@ -951,10 +953,9 @@ namespace KlayGE
 		}
 		shader_code_[type].second = shader_profile;
 
-		ID3DBlob* code = nullptr;
+		std::vector<uint8_t> code;
 		if (is_shader_validate_[type])
 		{
-			ID3DBlob* err_msg;
 			std::vector<D3D_SHADER_MACRO> macros;
 			{
 				D3D_SHADER_MACRO macro_d3d11 = { "KLAYGE_D3D11", "1" };
@@ -1052,16 +1053,37 @@ namespace KlayGE
 #if !defined(KLAYGE_DEBUG)
 			flags |= D3DCOMPILE_OPTIMIZATION_LEVEL3;
 #endif
-			render_eng.D3DCompile(shader_text.c_str(), static_cast<UINT>(shader_text.size()), nullptr, &macros[0],
-				nullptr, sd.func_name.c_str(), shader_profile.c_str(),
-				flags, 0, &code, &err_msg);
-			if (err_msg != nullptr)
+			ShaderCacheKey key;
+			key.Append(shader_text).AppendMacros(&macros[0]).Append(sd.func_name).Append(shader_profile)
+				.Append(flags).Append(render_eng.D3DCompilerVersion());
+			std::string err_msgs;
+			if (!ShaderCache::Instance().Lookup(key, code, err_msgs))
+			{
+				ID3DBlob* code_blob = nullptr;
+				ID3DBlob* err_msg = nullptr;
+				render_eng.D3DCompile(shader_text.c_str(), static_cast<UINT>(shader_text.size()), nullptr, &macros[0],
+					nullptr, sd.func_name.c_str(), shader_profile.c_str(),
+					flags, 0, &code_blob, &err_msg);
+				if (err_msg != nullptr)
+				{
+					err_msgs = static_cast<char const *>(err_msg->GetBufferPointer());
+					err_msg->Release();
+				}
+				if (code_blob)
+				{
+					uint8_t const * p = static_cast<uint8_t const *>(code_blob->GetBufferPointer());
+					code.assign(p, p + code_blob->GetBufferSize());
+					code_blob->Release();
+					ShaderCache::Instance().Insert(key, &code[0], code.size(), err_msgs);
+				}
+			}
+			if (!err_msgs.empty())
 			{
 				LogError("Error when compiling %s:", sd.func_name.c_str());
 
 				std::map<int, std::vector<std::string> > err_lines;
 				{
-					std::istringstream err_iss(static_cast<char*>(err_msg->GetBufferPointer()));
+					std::istringstream err_iss(err_msgs);
 					std::string err_str;
 					while (err_iss)
 					{
@@ -1142,14 +1164,12 @@ namespace KlayGE
 						LogError(msg.c_str());
 					}
 				}
-
-				err_msg->Release();
 			}
 
-			if (code)
+			if (!code.empty())
 			{
 				ID3D11ShaderReflection* reflection;
-				render_eng.D3DReflect(code->GetBufferPointer(), code->GetBufferSize(),
+				render_eng.D3DReflect(&code[0], code.size(),
 					IID_ID3D11ShaderReflection_47, reinterpret_cast<void**>(&reflection));
 				if (reflection != nullptr)
 				{
@@ -1296,24 +1316,24 @@ namespace KlayGE
 				}
 
 				ID3DBlob* strip_code = nullptr;
-				render_eng.D3DStripShader(code->GetBufferPointer(), code->GetBufferSize(),
+				render_eng.D3DStripShader(&code[0], code.size(),
 					D3DCOMPILER_STRIP_REFLECTION_DATA | D3DCOMPILER_STRIP_DEBUG_INFO
 					| D3DCOMPILER_STRIP_TEST_BLOBS | D3DCOMPILER_STRIP_PRIVATE_DATA,
 					&strip_code);
 				if (strip_code)
 				{
-					code->Release();
-					code = strip_code;
+					uint8_t const * p = static_cast<uint8_t const *>(strip_code->GetBufferPointer());
+					code.assign(p, p + strip_code->GetBufferSize());
+					strip_code->Release();
 				}
 			}
 		}
 
 		shared_ptr<std::vector<uint8_t> > ret;
-		if (code)
+		if (!code.empty())
 		{
-			ret = MakeSharedPtr<std::vector<uint8_t> >(code->GetBufferSize());
-			std::memcpy(&((*ret)[0]), code->GetBufferPointer(), code->GetBufferSize());
-			code->Release();
+			ret = MakeSharedPtr<std::vector<uint8_t> >();
+			ret->swap(code);
 		}
 
 		return ret;
@@ -1625,10 +1645,24 @@ namespace KlayGE
 		}
 	}
 
+	void D3D11ShaderObject::CompileShader(ShaderType type, RenderEffect const & effect,
+			RenderTechnique const & tech, RenderPass const & pass, std::vector<uint32_t> const & shader_desc_ids)
+	{
+		compiled_code_[type] = this->CompiteToBytecode(type, effect, tech, pass, shader_desc_ids);
+		is_compiled_[type] = true;
+	}
+
 	void D3D11ShaderObject::AttachShader(ShaderType type, RenderEffect const & effect,
 			RenderTechnique const & tech, RenderPass const & pass, std::vector<uint32_t> const & shader_desc_ids)
 	{
-		shared_ptr<std::vector<uint8_t> > code_blob = this->CompiteToBytecode(type, effect, tech, pass, shader_desc_ids);
+		if (!is_compiled_[type])
+		{
+			this->CompileShader(type, effect, tech, pass, shader_desc_ids);
+		}
+
+		shared_ptr<std::vector<uint8_t> > code_blob = compiled_code_[type];
+		compiled_code_[type].reset();
+		is_compiled_[type] = false;
 		this->AttachShaderBytecode(type, effect, shader_desc_ids, code_blob);
 	}
 
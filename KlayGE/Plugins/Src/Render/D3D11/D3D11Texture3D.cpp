@@ -319,14 +319,7 @@ namespace KlayGE
 	{
 		if (d3d_sr_views_.empty())
 		{
-			for (uint32_t index = 0; index < this->ArraySize(); ++ index)
-			{
-				for (uint32_t level = 1; level < this->NumMipMaps(); ++ level)
-				{
-					this->ResizeTexture3D(*this, index, level, 0, 0, 0, this->Width(level), this->Height(level), this->Depth(level),
-						index, level - 1, 0, 0, 0, this->Width(level - 1), this->Height(level - 1), this->Depth(level - 1), true);
-				}
-			}
+			this->BuildMipSubLevelsOnCPU(MF_Box);
 		}
 		else
 		{
@@ -337,6 +330,8 @@ namespace KlayGE
 	
 	void D3D11Texture3D::OfferHWResource()
 	{
+		this->UpdateGPUMemoryUsage(false);
+
 		d3d_sr_views_.clear();
 		d3d_ua_views_.clear();
 		d3d_rt_views_.clear();
@@ -365,5 +360,7 @@ namespace KlayGE
 		{
 			this->RetriveD3DShaderResourceView(0, array_size_, 0, num_mip_maps_);
 		}
+
+		this->UpdateGPUMemoryUsage(true);
 	}
 }
@@ -368,18 +368,7 @@ namespace KlayGE
 	{
 		if (d3d_sr_views_.empty())
 		{
-			for (uint32_t index = 0; index < this->ArraySize(); ++ index)
-			{
-				for (int f = 0; f < 6; ++ f)
-				{
-					CubeFaces const face = static_cast<CubeFaces>(f);
-					for (uint32_t level = 1; level < this->NumMipMaps(); ++ level)
-					{
-						this->ResizeTextureCube(*this, index, face, level, 0, 0, this->Width(level), this->Height(level),
-							index, face, level - 1, 0, 0, this->Width(level - 1), this->Height(level - 1), true);
-					}
-				}
-			}
+			this->BuildMipSubLevelsOnCPU(MF_Box);
 		}
 		else
 		{
@@ -390,6 +379,8 @@ namespace KlayGE
 	
 	void D3D11TextureCube::OfferHWResource()
 	{
+		this->UpdateGPUMemoryUsage(false);
+
 		d3d_sr_views_.clear();
 		d3d_ua_views_.clear();
 		d3d_rt_views_.clear();
@@ -421,5 +412,7 @@ namespace KlayGE
 		{
 			this->RetriveD3DShaderResourceView(0, array_size_, 0, num_mip_maps_);
 		}
+
+		this->UpdateGPUMemoryUsage(true);
 	}
 }
@@ -56,6 +56,8 @@
 #undef Bool		// for boost::foreach
 #endif
 
+#include <DXBC2GLSL/DXBC2GLSL.hpp>
+
 #include <algorithm>
 #include <sstream>
 #include <cstring>
@@ -1518,6 +1520,9 @@ namespace KlayGE
 
 		so_rl_.reset();
 
+		// No more shaders to translate
+		DXBC2GLSL::DXBC2GLSL::ClearCache();
+
 #if defined KLAYGE_PLATFORM_WINDOWS
 		::FreeLibrary(mod_opengl32_);
 #endif
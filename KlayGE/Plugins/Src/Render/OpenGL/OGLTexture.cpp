@@ -301,6 +301,8 @@ namespace KlayGE
 
 	void OGLTexture::OfferHWResource()
 	{
+		this->UpdateGPUMemoryUsage(false);
+
 		if (Context::Instance().RenderFactoryValid())
 		{
 			OGLRenderEngine& re = *checked_cast<OGLRenderEngine*>(&Context::Instance().RenderFactoryInstance().RenderEngineInstance());
@@ -408,5 +408,7 @@ namespace KlayGE
 			glBindRenderbuffer(GL_RENDERBUFFER, texture_);
 			glRenderbufferStorageMultisample(GL_RENDERBUFFER, sample_count_, glinternalFormat, widths_[0], 1);
 		}
+
+		this->UpdateGPUMemoryUsage(true);
 	}
 }
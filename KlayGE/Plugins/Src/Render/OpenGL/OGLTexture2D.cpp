@@ -569,5 +569,7 @@ namespace KlayGE
 			glRenderbufferStorageMultisample(GL_RENDERBUFFER, sample_count_, glinternalFormat,
 				widths_[0], heights_[0]);
 		}
+
+		this->UpdateGPUMemoryUsage(true);
 	}
 }
@@ -381,5 +381,7 @@ namespace KlayGE
 					(nullptr == init_data) ? nullptr : init_data[level].data);
 			}
 		}
+
+		this->UpdateGPUMemoryUsage(true);
 	}
 }
@@ -419,5 +419,7 @@ namespace KlayGE
 				}
 			}
 		}
+
+		this->UpdateGPUMemoryUsage(true);
 	}
 }
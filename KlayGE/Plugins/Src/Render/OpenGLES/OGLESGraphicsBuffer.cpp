@@ -38,6 +38,7 @@ namespace KlayGE
 			size_in_byte_ = init_data->row_pitch;
 			this->CreateBuffer(init_data->data);
 			hw_buff_size_ = size_in_byte_;
+			this->UpdateGPUMemoryUsage();
 		}
 	}
 
@@ -31,6 +31,10 @@
 #undef Bool		// for boost::foreach
 #endif
 
+#if KLAYGE_IS_DEV_PLATFORM
+#include <DXBC2GLSL/DXBC2GLSL.hpp>
+#endif
+
 #include <algorithm>
 #include <sstream>
 #include <cstring>
@@ -1426,6 +1430,11 @@ namespace KlayGE
 		}
 
 		so_rl_.reset();
+
+#if KLAYGE_IS_DEV_PLATFORM
+		// No more shaders to translate
+		DXBC2GLSL::DXBC2GLSL::ClearCache();
+#endif
 	}
 
 	void OGLESRenderEngine::DoSuspend()
@@ -20,8 +20,10 @@
 #include <KlayGE/Context.hpp>
 #include <KFL/Math.hpp>
 #include <KFL/Matrix.hpp>
+#include <KFL/Thread.hpp>
 #include <KlayGE/RenderEngine.hpp>
 #include <KlayGE/RenderEffect.hpp>
+#include <KlayGE/ShaderCache.hpp>
 
 #include <cstdio>
 #include <string>
@@ -118,6 +120,19 @@ namespace
 	using namespace KlayGE;
 
 #if KLAYGE_IS_DEV_PLATFORM
+	class DXBC2GLSLIniter;
+
+	// Namespace scope rather than function-local statics, whose initialization isn't thread-safe on all the
+	// compilers, since the shaders are compiled on pool workers
+	mutex dxbc2glsl_initer_mutex;
+	shared_ptr<DXBC2GLSLIniter> dxbc2glsl_initer;
+
+#ifndef KLAYGE_PLATFORM_WINDOWS
+	// The one-time wineserver start
+	mutex wineserver_mutex;
+	bool wineserver_started = false;
+#endif
+
 	class DXBC2GLSLIniter
 	{
 	public:
@@ -130,8 +145,12 @@ namespace
 
 		static DXBC2GLSLIniter& Instance()
 		{
-			static DXBC2GLSLIniter initer;
-			return initer;
+			lock_guard<mutex> lock(dxbc2glsl_initer_mutex);
+			if (!dxbc2glsl_initer)
+			{
+				dxbc2glsl_initer = shared_ptr<DXBC2GLSLIniter>(new DXBC2GLSLIniter);
+			}
+			return *dxbc2glsl_initer;
 		}
 
 		HRESULT D3DCompile(std::string const & src_data,
@@ -139,6 +158,27 @@ namespace
 			std::string const & target, uint32_t flags1, uint32_t flags2,
 			std::vector<uint8_t>& code, std::string& error_msgs) const
 		{
+			ShaderCacheKey key;
+			key.Append(src_data).AppendMacros(defines).Append(entry_point).Append(target)
+				.Append(flags1).Append(flags2).Append(compiler_version_);
+			if (ShaderCache::Instance().Lookup(key, code, error_msgs))
+			{
+				return 0;
+			}
+
+			HRESULT hr = this->D3DCompileNoCache(src_data, defines, entry_point, target, flags1, flags2, code, error_msgs);
+			if (!code.empty())
+			{
+				ShaderCache::Instance().Insert(key, &code[0], code.size(), error_msgs);
+			}
+			return hr;
+		}
+
+		HRESULT D3DCompileNoCache(std::string const & src_data,
+			D3D_SHADER_MACRO const * defines, std::string const & entry_point,
+			std::string const & target, uint32_t flags1, uint32_t flags2,
+			std::vector<uint8_t>& code, std::string& error_msgs) const
+		{
 #ifdef CALL_D3DCOMPILER_DIRECTLY
 			ID3DBlob* code_blob = nullptr;
 			ID3DBlob* error_msgs_blob = nullptr;
@@ -205,14 +245,17 @@ namespace
 #ifdef KLAYGE_PLATFORM_WINDOWS
 			ss << d3dcompiler_wrapper_name << ".exe";
 #else
-			static bool first = true;
-			if (first)
 			{
-				ss << WINE_PATH << "wineserver -p";
-				system(ss.str().c_str());
-				// We should hold on a persistant wineserver, or XCode will lost connection after wineserver instance close and wine may not be able to find '.exe.so' file
-				first = false;
-				ss.str(std::string());
+				// Shaders of an effect are compiled from multiple threads
+				lock_guard<mutex> lock(wineserver_mutex);
+				if (!wineserver_started)
+				{
+					ss << WINE_PATH << "wineserver -p";
+					system(ss.str().c_str());
+					// We should hold on a persistant wineserver, or XCode will lost connection after wineserver instance close and wine may not be able to find '.exe.so' file
+					wineserver_started = true;
+					ss.str(std::string());
+				}
 			}
 			ss << WINE_PATH << "wine ./" << d3dcompiler_wrapper_name << ".exe.so";
 #endif
@@ -276,6 +319,13 @@ namespace
 			__assume(mod_d3dcompiler_ != nullptr);
 #endif
 			DynamicD3DCompile_ = reinterpret_cast<D3DCompileFunc>(::GetProcAddress(mod_d3dcompiler_, "D3DCompile"));
+			compiler_version_ = ShaderCache::CompilerVersion(static_cast<void*>(mod_d3dcompiler_));
+#else
+			std::string d3dcompiler_wrapper_name = "D3DCompilerWrapper";
+#ifdef KLAYGE_DEBUG
+			d3dcompiler_wrapper_name += "_d";
+#endif
+			compiler_version_ = ShaderCache::CompilerVersion(ResLoader::Instance().Locate(d3dcompiler_wrapper_name + ".exe.so"));
 #endif
 
 			if (glloader_GLES_VERSION_3_1())
@@ -302,6 +352,7 @@ namespace
 		D3DCompileFunc DynamicD3DCompile_;
 #endif
 		GLSLVersion gsv_;
+		std::string compiler_version_;
 	};
 #endif
 
@@ -1055,6 +1106,7 @@ namespace KlayGE
 		has_discard_ = false;
 		has_tessellation_ = false;
 		is_shader_validate_.fill(true);
+		is_compiled_.fill(false);
 
 		glsl_program_ = glCreateProgram();
 
@@ -1615,7 +1667,7 @@ namespace KlayGE
 		}
 	}
 
-	void OGLESShaderObject::AttachShader(ShaderType type, RenderEffect const & effect,
+	void OGLESShaderObject::CompileShader(ShaderType type, RenderEffect const & effect,
 			RenderTechnique const & tech, RenderPass const & pass, std::vector<uint32_t> const & shader_desc_ids)
 	{
 		ShaderDesc const & sd = effect.GetShaderDesc(shader_desc_ids[type]);
@@ -2120,6 +2172,18 @@ namespace KlayGE
 #endif
 		}
 
+		is_compiled_[type] = true;
+	}
+
+	void OGLESShaderObject::AttachShader(ShaderType type, RenderEffect const & effect,
+			RenderTechnique const & tech, RenderPass const & pass, std::vector<uint32_t> const & shader_desc_ids)
+	{
+		if (!is_compiled_[type])
+		{
+			this->CompileShader(type, effect, tech, pass, shader_desc_ids);
+		}
+		is_compiled_[type] = false;
+
 		if (is_shader_validate_[type])
 		{
 			this->AttachGLSL(type);
@@ -236,6 +236,8 @@ namespace KlayGE
 
 	void OGLESTexture::OfferHWResource()
 	{
+		this->UpdateGPUMemoryUsage(false);
+
 		tex_data_.clear();
 		glDeleteTextures(1, &texture_);
 	}
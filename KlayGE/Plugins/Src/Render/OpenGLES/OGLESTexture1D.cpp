@@ -332,5 +332,7 @@ namespace KlayGE
 				glTexImage2D(target_type_, level, glinternalFormat, widths_[level], 1, 0, glformat, gltype, ptr);
 			}
 		}
+
+		this->UpdateGPUMemoryUsage(true);
 	}
 }
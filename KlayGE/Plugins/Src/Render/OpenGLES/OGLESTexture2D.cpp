@@ -455,5 +455,7 @@ namespace KlayGE
 				glTexImage2D(target_type_, level, glinternalFormat, widths_[level], heights_[level], 0, glformat, gltype, ptr);
 			}
 		}
+
+		this->UpdateGPUMemoryUsage(true);
 	}
 }
@@ -350,5 +350,7 @@ namespace KlayGE
 				}
 			}
 		}
+
+		this->UpdateGPUMemoryUsage(true);
 	}
 }
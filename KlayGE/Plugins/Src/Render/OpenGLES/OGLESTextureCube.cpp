@@ -336,5 +336,7 @@ namespace KlayGE
 				}
 			}
 		}
+
+		this->UpdateGPUMemoryUsage(true);
 	}
 }
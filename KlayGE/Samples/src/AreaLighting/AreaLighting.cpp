@@ -222,6 +222,7 @@ void AreaLightingApp::InputHandler(InputEngine const & /*sender*/, InputAction c
 	case Profile:
 #ifndef KLAYGE_SHIP
 		PerfProfiler::Instance().ExportToCSV("profile.csv");
+		PerfProfiler::Instance().ExportToChromeTrace("profile.json");
 #endif
 		break;
 	}
@@ -558,6 +558,7 @@ uint32_t DetailedSurfaceApp::DoUpdate(uint32_t /*pass*/)
 			polygon_ = MakeSharedPtr<PolygonObject>();
 			checked_pointer_cast<PolygonObject>(polygon_)->BindJudaTexture(juda_tex_);
 			juda_tex_->UpdateCache(checked_pointer_cast<PolygonObject>(polygon_)->JudaTexTileIDs(0));
+			juda_tex_->FlushCache();
 			polygon_->AddToSceneManager();
 
 			this->LookAt(float3(-0.18f, 0.24f, -0.18f), float3(0, 0.05f, 0));
@@ -491,6 +491,11 @@ void JudaTexViewer::DoUpdateOverlay()
 	font_->RenderText(0, 0, Color(1, 1, 0, 1), L"Juda Texture Viewer", 16);
 	font_->RenderText(0, 18, Color(1, 1, 0, 1), stream.str(), 16);
 
+	JudaTexture::CacheStatistics const & stat = juda_tex_->TileCacheStatistics();
+	stream.str(L"");
+	stream << "Tile cache: " << stat.hits << " hits, " << stat.misses << " misses, " << stat.evictions << " evictions";
+	font_->RenderText(0, 36, Color(1, 1, 0, 1), stream.str(), 16);
+
 	if (tile_size_ * scale_ > 64)
 	{
 		for (uint32_t y = sy_; y < ey_; ++ y)
@@ -0,0 +1,190 @@
+#include <KlayGE/KlayGE.hpp>
+#include <KFL/Timer.hpp>
+#include <DXBC2GLSL/DXBC2GLSL.hpp>
+
+#include <boost/test/unit_test.hpp>
+
+#include <vector>
+#include <string>
+#include <sstream>
+#include <iostream>
+#include <cstring>
+
+using namespace std;
+using namespace KlayGE;
+
+namespace
+{
+	// A vs_4_0 container without checksum, which writes (0, 0, 0, w) to SV_Position. The padding chunk is
+	//  skipped by the parser.
+	std::vector<uint32_t> MakeDXBC(float w, uint32_t padding = 0)
+	{
+		std::vector<uint32_t> osgn;
+		osgn.push_back(1);			// count
+		osgn.push_back(8);			// offset
+		osgn.push_back(32);			// name_offset
+		osgn.push_back(0);			// semantic_index
+		osgn.push_back(1);			// system_value_type, position
+		osgn.push_back(3);			// component_type, float32
+		osgn.push_back(0);			// register_num
+		osgn.push_back(0x0000000F);	// mask
+		char const name[12] = "SV_Position";
+		uint32_t name_tokens[3];
+		memcpy(name_tokens, name, sizeof(name));
+		osgn.insert(osgn.end(), name_tokens, name_tokens + 3);
+
+		uint32_t w_bits;
+		memcpy(&w_bits, &w, sizeof(w));
+		uint32_t const shdr_tokens[] =
+		{
+			0x00010040, 15,										// vs_4_0
+			0x04000067, 0x001020F2, 0, 1,						// dcl_output_siv o0.xyzw, position
+			0x08000036, 0x001020F2, 0, 0x00004002, 0, 0, 0, w_bits,	// mov o0.xyzw, l(0, 0, 0, w)
+			0x0100003E											// ret
+		};
+
+		std::vector<uint32_t> blob(11, 0);
+		blob[0] = MakeFourCC<'D', 'X', 'B', 'C'>::value;
+		blob[5] = 1;
+		blob[7] = 3;
+		blob[8] = static_cast<uint32_t>(blob.size() * sizeof(uint32_t));
+		blob.push_back(MakeFourCC<'O', 'S', 'G', 'N'>::value);
+		blob.push_back(static_cast<uint32_t>(osgn.size() * sizeof(uint32_t)));
+		blob.insert(blob.end(), osgn.begin(), osgn.end());
+		blob[9] = static_cast<uint32_t>(blob.size() * sizeof(uint32_t));
+		blob.push_back(MakeFourCC<'S', 'H', 'D', 'R'>::value);
+		blob.push_back(static_cast<uint32_t>(sizeof(shdr_tokens)));
+		blob.insert(blob.end(), shdr_tokens, shdr_tokens + sizeof(shdr_tokens) / sizeof(shdr_tokens[0]));
+		blob[10] = static_cast<uint32_t>(blob.size() * sizeof(uint32_t));
+		blob.push_back(MakeFourCC<'P', 'A', 'D', 'D'>::value);
+		blob.push_back(padding * sizeof(uint32_t));
+		blob.resize(blob.size() + padding, 0);
+		blob[6] = static_cast<uint32_t>(blob.size() * sizeof(uint32_t));
+		return blob;
+	}
+
+	// The translation without the cache
+	std::string ReferenceGLSL(std::vector<uint32_t> const & blob, GLSLVersion version)
+	{
+		shared_ptr<DXBCContainer> dxbc = DXBCParse(&blob[0]);
+		shared_ptr<ShaderProgram> shader = ShaderParse(*dxbc);
+		std::ostringstream ss;
+		GLSLGen converter;
+		converter.FeedDXBC(shader, false, version, GLSLGen::DefaultRules(version));
+		converter.ToGLSL(ss);
+		return ss.str();
+	}
+
+	std::string TranslatedGLSL(std::vector<uint32_t> const & blob, GLSLVersion version)
+	{
+		DXBC2GLSL::DXBC2GLSL dxbc2glsl;
+		dxbc2glsl.FeedDXBC(&blob[0], false, version);
+		return dxbc2glsl.GLSLString();
+	}
+}
+
+BOOST_AUTO_TEST_CASE(DXBC2GLSLByteIdentical)
+{
+	DXBC2GLSL::DXBC2GLSL::ClearCache();
+
+	std::vector<uint32_t> const blob = MakeDXBC(1.0f);
+	std::string const reference = ReferenceGLSL(blob, GSV_330);
+	BOOST_REQUIRE(!reference.empty());
+
+	// Miss, then hit
+	BOOST_CHECK(TranslatedGLSL(blob, GSV_330) == reference);
+	BOOST_CHECK(TranslatedGLSL(blob, GSV_330) == reference);
+
+	// The version is a part of the key
+	BOOST_CHECK(TranslatedGLSL(blob, GSV_430) == ReferenceGLSL(blob, GSV_430));
+	BOOST_CHECK(TranslatedGLSL(blob, GSV_330) == reference);
+}
+
+BOOST_AUTO_TEST_CASE(DXBC2GLSLSameChecksumDifferentCode)
+{
+	DXBC2GLSL::DXBC2GLSL::ClearCache();
+
+	// Same zero checksum and size, only the code differs
+	std::vector<uint32_t> const blob_a = MakeDXBC(1.0f);
+	std::vector<uint32_t> const blob_b = MakeDXBC(2.0f);
+	BOOST_REQUIRE(0 == memcmp(&blob_a[0], &blob_b[0], 32));
+
+	std::string const glsl_a = TranslatedGLSL(blob_a, GSV_330);
+	std::string const glsl_b = TranslatedGLSL(blob_b, GSV_330);
+	BOOST_CHECK(glsl_a != glsl_b);
+	BOOST_CHECK(glsl_a == ReferenceGLSL(blob_a, GSV_330));
+	BOOST_CHECK(glsl_b == ReferenceGLSL(blob_b, GSV_330));
+}
+
+BOOST_AUTO_TEST_CASE(DXBC2GLSLOwnsDXBC)
+{
+	DXBC2GLSL::DXBC2GLSL::ClearCache();
+
+	DXBC2GLSL::DXBC2GLSL dxbc2glsl;
+	{
+		std::vector<uint32_t> blob = MakeDXBC(1.0f);
+		dxbc2glsl.FeedDXBC(&blob[0], false, GSV_330);
+		memset(&blob[0], 0xCD, blob.size() * sizeof(blob[0]));
+	}
+
+	// The names point into the copy of the DXBC
+	BOOST_REQUIRE_EQUAL(dxbc2glsl.NumOutputParams(), 1U);
+	BOOST_CHECK_EQUAL(std::string(dxbc2glsl.OutputParam(0).semantic_name), "SV_Position");
+
+	DXBC2GLSL::DXBC2GLSL::ClearCache();
+	BOOST_CHECK_EQUAL(std::string(dxbc2glsl.OutputParam(0).semantic_name), "SV_Position");
+	BOOST_CHECK(!dxbc2glsl.GLSLString().empty());
+}
+
+BOOST_AUTO_TEST_CASE(DXBC2GLSLCacheBounded)
+{
+	DXBC2GLSL::DXBC2GLSL::ClearCache();
+
+	// 64KB a piece, enough to go over the bound of the cache and drop the first ones
+	uint32_t const padding = 16 * 1024;
+	uint32_t const num_shaders = 320;
+	std::vector<std::string> references(num_shaders);
+	for (uint32_t i = 0; i < num_shaders; ++ i)
+	{
+		std::vector<uint32_t> const blob = MakeDXBC(static_cast<float>(i), padding);
+		references[i] = ReferenceGLSL(blob, GSV_330);
+		BOOST_CHECK(TranslatedGLSL(blob, GSV_330) == references[i]);
+	}
+	for (uint32_t i = 0; i < num_shaders; ++ i)
+	{
+		BOOST_CHECK(TranslatedGLSL(MakeDXBC(static_cast<float>(i), padding), GSV_330) == references[i]);
+	}
+
+	DXBC2GLSL::DXBC2GLSL::ClearCache();
+}
+
+BOOST_AUTO_TEST_CASE(DXBC2GLSLCacheBenchmark)
+{
+	DXBC2GLSL::DXBC2GLSL::ClearCache();
+
+	int const iterations = 1000;
+	std::vector<uint32_t> const blob = MakeDXBC(1.0f);
+
+	Timer timer;
+	for (int i = 0; i < iterations; ++ i)
+	{
+		ReferenceGLSL(blob, GSV_330);
+	}
+	double const uncached_time = timer.elapsed();
+
+	timer.restart();
+	for (int i = 0; i < iterations; ++ i)
+	{
+		TranslatedGLSL(blob, GSV_330);
+	}
+	double const cached_time = timer.elapsed();
+
+	cout << "DXBC2GLSL: uncached " << uncached_time * 1000 << " ms, cached " << cached_time * 1000 << " ms";
+	if (cached_time > 0)
+	{
+		cout << ", speedup " << uncached_time / cached_time << "x";
+	}
+	cout << endl;
+
+	DXBC2GLSL::DXBC2GLSL::ClearCache();
+}
@@ -1,9 +1,12 @@
 #include <KlayGE/KlayGE.hpp>
 #include <KlayGE/TexCompressionBC.hpp>
 #include <KlayGE/TexCompressionETC.hpp>
+#include <KlayGE/TexCompressionTranscode.hpp>
 #include <KlayGE/Texture.hpp>
+#include <KlayGE/ElementFormat.hpp>
 #include <KlayGE/ResLoader.hpp>
 #include <KFL/Half.hpp>
+#include <KFL/Math.hpp>
 
 #include <boost/assert.hpp>
 #include <boost/test/unit_test.hpp>
@@ -11,12 +14,14 @@
 #include <vector>
 #include <string>
 #include <iostream>
+#include <algorithm>
+#include <cstdlib>
 
 using namespace std;
 using namespace KlayGE;
 
-void TestEncodeDecodeTex(std::string const & input_name, std::string const & tc_name,
-		ElementFormat bc_fmt, float threshold)
+float EncodeDecodeTexRMSE(std::string const & input_name, std::string const & tc_name,
+		ElementFormat bc_fmt, TexCompressionMethod method)
 {
 	std::vector<uint8_t> input_argb;
 	std::vector<uint8_t> bc_blocks;
@@ -53,6 +58,10 @@ void TestEncodeDecodeTex(std::string const & input_name, std::string const & tc_
 		codec = MakeSharedPtr<TexCompressionETC1>();
 		break;
 
+	case EF_ETC2_BGR8:
+		codec = MakeSharedPtr<TexCompressionETC2RGB8>();
+		break;
+
 	default:
 		BOOST_ASSERT(false);
 		break;
@@ -133,7 +142,7 @@ void TestEncodeDecodeTex(std::string const & input_name, std::string const & tc_
 				}
 
 				uint32_t index = ((y_base / block_height) * ((width + block_width - 1) / block_width) + (x_base / block_width)) * block_bytes;
-				codec->EncodeBlock(&bc_blocks[index], &uncompressed[0], TCM_Balanced);
+				codec->EncodeBlock(&bc_blocks[index], &uncompressed[0], method);
 			}
 		}
 	}
@@ -230,8 +239,63 @@ void TestEncodeDecodeTex(std::string const & input_name, std::string const & tc_
 		}
 	}
 
-	mse = sqrt(mse / (width * height) / 4);
-	BOOST_CHECK(mse < threshold);
+	return sqrt(mse / (width * height) / 4);
+}
+
+void TestEncodeDecodeTex(std::string const & input_name, std::string const & tc_name,
+		ElementFormat bc_fmt, float threshold)
+{
+	float const rmse = EncodeDecodeTexRMSE(input_name, tc_name, bc_fmt, TCM_Balanced);
+	BOOST_CHECK(rmse < threshold);
+}
+
+// The real-time tier trades some quality for throughput, but has to stay close to the balanced encoder
+void TestEncodeDecodeTexSpeed(std::string const & input_name, ElementFormat bc_fmt, float tolerance)
+{
+	float const balanced_rmse = EncodeDecodeTexRMSE(input_name, "", bc_fmt, TCM_Balanced);
+	float const speed_rmse = EncodeDecodeTexRMSE(input_name, "", bc_fmt, TCM_Speed);
+	BOOST_CHECK(speed_rmse < balanced_rmse * tolerance);
+}
+
+// Transcoding has to preserve the decoded source blocks, so the error is measured against them
+void TestTranscodeTex(std::string const & input_name, ElementFormat src_fmt, ElementFormat dst_fmt, float threshold)
+{
+	Texture::TextureType type;
+	uint32_t width, height, depth, num_mipmaps, array_size;
+	ElementFormat format;
+	std::vector<ElementInitData> init_data;
+	std::vector<uint8_t> data_block;
+	LoadTexture(input_name, type, width, height, depth, num_mipmaps, array_size,
+		format, init_data, data_block);
+
+	BOOST_ASSERT(EF_ARGB8 == format);
+
+	uint32_t const block_row_pitch = (width + 3) / 4 * NumFormatBytes(src_fmt) * 4;
+	uint32_t const block_slice_pitch = (height + 3) / 4 * block_row_pitch;
+	std::vector<uint8_t> src_blocks(block_slice_pitch);
+	ResizeTexture(&src_blocks[0], block_row_pitch, block_slice_pitch, src_fmt, width, height, 1,
+		init_data[0].data, init_data[0].row_pitch, init_data[0].slice_pitch, format, width, height, 1, false);
+
+	std::vector<uint8_t> dst_blocks(block_slice_pitch);
+	TranscodeTexture(&dst_blocks[0], block_row_pitch, block_slice_pitch, dst_fmt,
+		&src_blocks[0], block_row_pitch, block_slice_pitch, src_fmt, width, height, 1, TCM_Balanced);
+
+	std::vector<uint8_t> src_argb(width * height * 4);
+	ResizeTexture(&src_argb[0], width * 4, width * height * 4, EF_ARGB8, width, height, 1,
+		&src_blocks[0], block_row_pitch, block_slice_pitch, src_fmt, width, height, 1, false);
+	std::vector<uint8_t> dst_argb(width * height * 4);
+	ResizeTexture(&dst_argb[0], width * 4, width * height * 4, EF_ARGB8, width, height, 1,
+		&dst_blocks[0], block_row_pitch, block_slice_pitch, dst_fmt, width, height, 1, false);
+
+	float mse = 0;
+	for (size_t i = 0; i < src_argb.size(); ++ i)
+	{
+		float const diff = static_cast<float>(src_argb[i]) - dst_argb[i];
+		mse += diff * diff;
+	}
+
+	float const rmse = sqrt(mse / (width * height) / 4);
+	BOOST_CHECK(rmse < threshold);
 }
 
 class EncodeDecodeTexFixture
@@ -300,6 +364,198 @@ BOOST_AUTO_TEST_CASE(EncodeDecodeBC3)
 	TestEncodeDecodeTex("leaf_v3_green_tex.dds", "", EF_BC3, 8.9f);
 }
 
+BOOST_AUTO_TEST_CASE(EncodeDecodeBC1Speed)
+{
+	TestEncodeDecodeTexSpeed("Lenna.dds", EF_BC1, 1.25f);
+}
+
+BOOST_AUTO_TEST_CASE(EncodeDecodeBC3Speed)
+{
+	TestEncodeDecodeTexSpeed("leaf_v3_green_tex.dds", EF_BC3, 1.25f);
+}
+
+// The SIMD kernels have to match their scalar references bit for bit
+BOOST_AUTO_TEST_CASE(BCSIMDParity)
+{
+	uint32_t const num_blocks = 1023;
+
+	srand(0);
+	std::vector<ARGBColor32> argb(num_blocks * 16);
+	std::vector<uint8_t> r(num_blocks * 16);
+	for (uint32_t i = 0; i < num_blocks * 16; ++ i)
+	{
+		// Every 4th block has a narrow range, like most real blocks do
+		int const range = (i / 16 % 4 == 0) ? 8 : 256;
+		argb[i] = ARGBColor32(static_cast<uint8_t>(rand() % range), static_cast<uint8_t>(rand() % range),
+			static_cast<uint8_t>(rand() % range), static_cast<uint8_t>(rand() % range));
+		r[i] = static_cast<uint8_t>(rand() % range);
+	}
+
+	for (uint32_t b = 0; b < num_blocks; ++ b)
+	{
+		ARGBColor32 const * block = &argb[b * 16];
+
+		ARGBColor32 min_clr, max_clr, ref_min_clr, ref_max_clr;
+		detail::BC1BlockMinMaxColors(block, min_clr, max_clr);
+		detail::BC1BlockMinMaxColorsScalar(block, ref_min_clr, ref_max_clr);
+		BOOST_CHECK(min_clr == ref_min_clr);
+		BOOST_CHECK(max_clr == ref_max_clr);
+
+		int const dirr = max_clr.r() - min_clr.r();
+		int const dirg = max_clr.g() - min_clr.g();
+		int const dirb = max_clr.b() - min_clr.b();
+		int dots[16], ref_dots[16];
+		detail::BC1BlockColorDots(dots, block, dirr, dirg, dirb);
+		detail::BC1BlockColorDotsScalar(ref_dots, block, dirr, dirg, dirb);
+		BOOST_CHECK(0 == memcmp(dots, ref_dots, sizeof(dots)));
+
+		int const stop0 = min_clr.r() * dirr + min_clr.g() * dirg + min_clr.b() * dirb;
+		int const stop3 = max_clr.r() * dirr + max_clr.g() * dirg + max_clr.b() * dirb;
+		int const c0_point = (stop0 * 5 + stop3) / 6;
+		int const half_point = (stop0 + stop3) / 2;
+		int const c3_point = (stop0 + stop3 * 5) / 6;
+		BOOST_CHECK_EQUAL(detail::BC1BlockColorIndices(dots, c0_point, half_point, c3_point),
+			detail::BC1BlockColorIndicesScalar(dots, c0_point, half_point, c3_point));
+	}
+
+	// Odd counts leave a block for the single block path after the AVX2 pairs
+	std::vector<BC4Block> bc4(num_blocks);
+	std::vector<BC4Block> ref_bc4(num_blocks);
+	detail::EncodeBC4Blocks(&bc4[0], &r[0], num_blocks);
+	detail::EncodeBC4BlocksScalar(&ref_bc4[0], &r[0], num_blocks);
+	BOOST_CHECK(0 == memcmp(&bc4[0], &ref_bc4[0], num_blocks * sizeof(BC4Block)));
+}
+
+// The encoder has to be as good as the one that made the reference files of DecodeBC6U and DecodeBC6S
+BOOST_AUTO_TEST_CASE(EncodeDecodeBC6U)
+{
+	TestEncodeDecodeTex("memorial.dds", "", EF_BC6, 0.1f);
+}
+
+BOOST_AUTO_TEST_CASE(EncodeDecodeBC6S)
+{
+	TestEncodeDecodeTex("uffizi_probe.dds", "", EF_SIGNED_BC6, 0.1f);
+}
+
+// A smooth HDR image with a few sharp edges, from 1/16 up to 16, so the BC6 thresholds don't depend on test media
+void MakeHDRImage(std::vector<half>& abgr, uint32_t width, uint32_t height, bool signed_fmt)
+{
+	abgr.resize(width * height * 4);
+	for (uint32_t y = 0; y < height; ++ y)
+	{
+		for (uint32_t x = 0; x < width; ++ x)
+		{
+			float const lum = pow(2.0f, 4 * sin(x * 0.07f) * cos(y * 0.05f)) * (((x / 24 + y / 24) & 1) ? 1 : 0.5f);
+			float const sign = (signed_fmt && (sin(x * 0.03f + y * 0.02f) < 0)) ? -1.0f : 1.0f;
+			abgr[(y * width + x) * 4 + 0] = half(sign * lum * (0.6f + 0.4f * sin(y * 0.11f)));
+			abgr[(y * width + x) * 4 + 1] = half(sign * lum);
+			abgr[(y * width + x) * 4 + 2] = half(sign * lum * (0.6f + 0.4f * cos(x * 0.13f)));
+			abgr[(y * width + x) * 4 + 3] = half(1.0f);
+		}
+	}
+}
+
+float BC6SyntheticRMSE(ElementFormat bc6_fmt, TexCompressionMethod method)
+{
+	uint32_t const width = 128;
+	uint32_t const height = 128;
+	bool const signed_fmt = (EF_SIGNED_BC6 == bc6_fmt);
+
+	TexCompressionPtr codec;
+	if (signed_fmt)
+	{
+		codec = MakeSharedPtr<TexCompressionBC6S>();
+	}
+	else
+	{
+		codec = MakeSharedPtr<TexCompressionBC6U>();
+	}
+
+	std::vector<half> input;
+	MakeHDRImage(input, width, height, signed_fmt);
+
+	uint32_t const block_row_pitch = width / 4 * codec->BlockBytes();
+	std::vector<uint8_t> blocks(height / 4 * block_row_pitch);
+	codec->EncodeMem(width, height, &blocks[0], block_row_pitch, static_cast<uint32_t>(blocks.size()),
+		&input[0], width * 8, width * height * 8, method);
+
+	std::vector<half> restored(input.size());
+	codec->DecodeMem(width, height, &restored[0], width * 8, width * height * 8,
+		&blocks[0], block_row_pitch, static_cast<uint32_t>(blocks.size()));
+
+	float mse = 0;
+	for (size_t i = 0; i < input.size(); ++ i)
+	{
+		float const diff = static_cast<float>(input[i]) - static_cast<float>(restored[i]);
+		mse += diff * diff;
+	}
+	return sqrt(mse / input.size());
+}
+
+// Measured 0.064 for Speed and 0.041 for Balanced
+BOOST_AUTO_TEST_CASE(EncodeDecodeBC6USynthetic)
+{
+	BOOST_CHECK(BC6SyntheticRMSE(EF_BC6, TCM_Speed) < 0.07f);
+	BOOST_CHECK(BC6SyntheticRMSE(EF_BC6, TCM_Balanced) < 0.045f);
+}
+
+// Measured 0.123 for Speed and 0.071 for Balanced
+BOOST_AUTO_TEST_CASE(EncodeDecodeBC6SSynthetic)
+{
+	BOOST_CHECK(BC6SyntheticRMSE(EF_SIGNED_BC6, TCM_Speed) < 0.135f);
+	BOOST_CHECK(BC6SyntheticRMSE(EF_SIGNED_BC6, TCM_Balanced) < 0.078f);
+}
+
+// Slices are a padded slice pitch apart, and have to come out the same as when they are encoded one by one
+void TestEncodeMemSlices(TexCompression& codec, ElementFormat decoded_fmt)
+{
+	uint32_t const width = 36;
+	uint32_t const height = 20;
+	uint32_t const depth = 3;
+	uint32_t const elem_size = NumFormatBytes(decoded_fmt);
+
+	uint32_t const in_row_pitch = width * elem_size + 4;
+	uint32_t const in_slice_pitch = in_row_pitch * height + 12;
+	std::vector<uint8_t> input(in_slice_pitch * depth);
+	if (EF_ABGR16F == decoded_fmt)
+	{
+		half* p = reinterpret_cast<half*>(&input[0]);
+		for (size_t i = 0; i < input.size() / 2; ++ i)
+		{
+			p[i] = half(static_cast<float>(i % 97) / 16);
+		}
+	}
+	else
+	{
+		for (size_t i = 0; i < input.size(); ++ i)
+		{
+			input[i] = static_cast<uint8_t>(i * 13 + (i >> 7));
+		}
+	}
+
+	uint32_t const out_row_pitch = (width + 3) / 4 * codec.BlockBytes();
+	uint32_t const out_slice_pitch = out_row_pitch * ((height + 3) / 4) + 16;
+	std::vector<uint8_t> volume(out_slice_pitch * depth);
+	codec.EncodeMem(width, height, depth, &volume[0], out_row_pitch, out_slice_pitch,
+		&input[0], in_row_pitch, in_slice_pitch, TCM_Speed);
+
+	std::vector<uint8_t> slice(out_slice_pitch);
+	for (uint32_t z = 0; z < depth; ++ z)
+	{
+		codec.EncodeMem(width, height, &slice[0], out_row_pitch, out_slice_pitch,
+			&input[z * in_slice_pitch], in_row_pitch, in_slice_pitch, TCM_Speed);
+		BOOST_CHECK(0 == memcmp(&slice[0], &volume[z * out_slice_pitch], out_slice_pitch - 16));
+	}
+}
+
+BOOST_AUTO_TEST_CASE(EncodeMemSlices)
+{
+	TexCompressionBC4 bc4;
+	TestEncodeMemSlices(bc4, EF_R8);
+	TexCompressionBC6U bc6u;
+	TestEncodeMemSlices(bc6u, EF_ABGR16F);
+}
+
 BOOST_AUTO_TEST_CASE(EncodeDecodeBC7XRGB)
 {
 	TestEncodeDecodeTex("Lenna.dds", "", EF_BC7, 1.8f);
@@ -314,3 +570,526 @@ BOOST_AUTO_TEST_CASE(EncodeDecodeETC1)
 {
 	TestEncodeDecodeTex("Lenna.dds", "", EF_ETC1, 4.8f);
 }
+
+BOOST_AUTO_TEST_CASE(EncodeDecodeETC1Speed)
+{
+	TestEncodeDecodeTexSpeed("Lenna.dds", EF_ETC1, 1.25f);
+}
+
+// Every ETC1 block is an ETC2 block, and the ETC2 encoder only replaces it with a closer one
+BOOST_AUTO_TEST_CASE(EncodeDecodeETC2)
+{
+	float const etc1_rmse = EncodeDecodeTexRMSE("Lenna.dds", "", EF_ETC1, TCM_Balanced);
+	float const etc2_rmse = EncodeDecodeTexRMSE("Lenna.dds", "", EF_ETC2_BGR8, TCM_Balanced);
+	BOOST_CHECK(etc2_rmse <= etc1_rmse);
+}
+
+enum ETC2Mode
+{
+	ETC2M_Individual,
+	ETC2M_Differential,
+	ETC2M_T,
+	ETC2M_H,
+	ETC2M_Planar
+};
+
+// The T, H and planar modes hide in the differential ones whose red, green or blue overflows
+ETC2Mode BlockETC2Mode(ETC2Block const & block)
+{
+	if (!(block.etc1.cw_diff_flip & 0x2))
+	{
+		return ETC2M_Individual;
+	}
+
+	int const dr = block.etc1.r & 0x7;
+	int const dg = block.etc1.g & 0x7;
+	int const db = block.etc1.b & 0x7;
+	if (((block.etc1.r >> 3) - (dr & 0x4) + (dr & 0x3)) & 0xFFE0)
+	{
+		return ETC2M_T;
+	}
+	if (((block.etc1.g >> 3) - (dg & 0x4) + (dg & 0x3)) & 0xFFE0)
+	{
+		return ETC2M_H;
+	}
+	if (((block.etc1.b >> 3) - (db & 0x4) + (db & 0x3)) & 0xFFE0)
+	{
+		return ETC2M_Planar;
+	}
+	return ETC2M_Differential;
+}
+
+ARGBColor32 ClampedColor(int r, int g, int b)
+{
+	return ARGBColor32(255, static_cast<uint8_t>(MathLib::clamp(r, 0, 255)),
+		static_cast<uint8_t>(MathLib::clamp(g, 0, 255)), static_cast<uint8_t>(MathLib::clamp(b, 0, 255)));
+}
+
+// 8x8 blocks, each made for one of the ETC2 modes
+void MakeETC2Block(ETC2Mode mode, uint32_t bx, uint32_t by, ARGBColor32* argb)
+{
+	for (uint32_t y = 0; y < 4; ++ y)
+	{
+		for (uint32_t x = 0; x < 4; ++ x)
+		{
+			uint32_t const gx = bx * 4 + x;
+			uint32_t const gy = by * 4 + y;
+			ARGBColor32& clr = argb[y * 4 + x];
+			switch (mode)
+			{
+			case ETC2M_T:
+				// A few pixels of one color, the others around a far away second one
+				if (((0 == x) && (0 == y)) || ((3 == x) && (3 == y)) || ((1 == x) && (2 == y)))
+				{
+					clr = ClampedColor(230, 40 + bx * 4, 30);
+				}
+				else
+				{
+					clr = ClampedColor(30 + by * 3, 90 + ((x + y) & 1) * 40, 200);
+				}
+				break;
+
+			case ETC2M_H:
+				// Two colors, each split in a pair
+				{
+					int const t = ((x * 3 + y) & 1) * 30;
+					if (x + y < 3)
+					{
+						clr = ClampedColor(200 + t / 2, 60 + t, 40);
+					}
+					else
+					{
+						clr = ClampedColor(40, 90 + t, 200 - t / 2);
+					}
+				}
+				break;
+
+			case ETC2M_Planar:
+				clr = ClampedColor(30 + 3 * gx + 2 * gy, 200 - 2 * gx + gy, 90 + 3 * gy);
+				break;
+
+			default:
+				clr = ClampedColor(120 + bx * 2, 100 + by * 2, 80);
+				break;
+			}
+		}
+	}
+}
+
+void TestETC2Mode(ETC2Mode mode, uint32_t min_mode_blocks, float threshold)
+{
+	TexCompressionETC1 etc1;
+	TexCompressionETC2RGB8 etc2;
+
+	uint32_t num_mode_blocks = 0;
+	float etc1_mse = 0;
+	float etc2_mse = 0;
+	for (uint32_t by = 0; by < 8; ++ by)
+	{
+		for (uint32_t bx = 0; bx < 8; ++ bx)
+		{
+			ARGBColor32 argb[16];
+			MakeETC2Block(mode, bx, by, argb);
+
+			ETC2Block block;
+			ARGBColor32 restored[16];
+			etc2.EncodeBlock(&block, argb, TCM_Balanced);
+			etc2.DecodeBlock(restored, &block);
+			num_mode_blocks += (BlockETC2Mode(block) == mode);
+
+			ETC1Block etc1_block;
+			ARGBColor32 etc1_restored[16];
+			etc1.EncodeBlock(&etc1_block, argb, TCM_Balanced);
+			etc1.DecodeBlock(etc1_restored, &etc1_block);
+
+			for (uint32_t i = 0; i < 16; ++ i)
+			{
+				for (uint32_t ch = 0; ch < 3; ++ ch)
+				{
+					float const diff = static_cast<float>(argb[i][ch]) - restored[i][ch];
+					etc2_mse += diff * diff;
+					float const etc1_diff = static_cast<float>(argb[i][ch]) - etc1_restored[i][ch];
+					etc1_mse += etc1_diff * etc1_diff;
+				}
+			}
+		}
+	}
+
+	BOOST_CHECK_GE(num_mode_blocks, min_mode_blocks);
+	BOOST_CHECK_LE(etc2_mse, etc1_mse);
+	BOOST_CHECK_LT(sqrt(etc2_mse / (64 * 16 * 3)), threshold);
+}
+
+// Measured 9.55 RMSE, 50 of 64 blocks in T mode and the others in H mode. ETC1 gets 58.5
+BOOST_AUTO_TEST_CASE(EncodeDecodeETC2TMode)
+{
+	TestETC2Mode(ETC2M_T, 48, 9.8f);
+}
+
+// Measured 9.03 RMSE, all blocks in H mode. ETC1 gets 54.8
+BOOST_AUTO_TEST_CASE(EncodeDecodeETC2HMode)
+{
+	TestETC2Mode(ETC2M_H, 64, 9.3f);
+}
+
+// Measured 0.90 RMSE, all blocks in planar mode. ETC1 gets 2.46
+BOOST_AUTO_TEST_CASE(EncodeDecodeETC2PlanarMode)
+{
+	TestETC2Mode(ETC2M_Planar, 64, 0.95f);
+}
+
+// Solid blocks take their own path in the ETC1 encoder, which has to keep the channels in place
+BOOST_AUTO_TEST_CASE(EncodeDecodeETC1Solid)
+{
+	TexCompressionETC1 etc1;
+	int max_diff = 0;
+	for (uint32_t i = 0; i < 4096; ++ i)
+	{
+		ARGBColor32 const clr(255, static_cast<uint8_t>(i * 37), static_cast<uint8_t>(i * 101 + 7),
+			static_cast<uint8_t>(i * 59 + 13));
+		ARGBColor32 argb[16];
+		for (uint32_t j = 0; j < 16; ++ j)
+		{
+			argb[j] = clr;
+		}
+
+		ETC1Block block;
+		ARGBColor32 restored[16];
+		etc1.EncodeBlock(&block, argb, TCM_Speed);
+		etc1.DecodeBlock(restored, &block);
+		for (uint32_t ch = 0; ch < 3; ++ ch)
+		{
+			max_diff = std::max(max_diff, std::abs(static_cast<int>(clr[ch]) - restored[5][ch]));
+		}
+	}
+	BOOST_CHECK_LE(max_diff, 4);
+}
+
+BOOST_AUTO_TEST_CASE(TranscodeBC1ToETC1)
+{
+	TestTranscodeTex("Lenna.dds", EF_BC1, EF_ETC1, 4.8f);
+}
+
+BOOST_AUTO_TEST_CASE(TranscodeBC1ToETC2)
+{
+	TestTranscodeTex("Lenna.dds", EF_BC1, EF_ETC2_BGR8, 4.8f);
+}
+
+BOOST_AUTO_TEST_CASE(TranscodeETC2ToBC1)
+{
+	TestTranscodeTex("Lenna.dds", EF_ETC2_BGR8, EF_BC1, 4.6f);
+}
+
+BOOST_AUTO_TEST_CASE(TranscodeBC4ToEAC)
+{
+	TestTranscodeTex("Lenna.dds", EF_BC4, EF_ETC2_R11, 1.5f);
+	TestTranscodeTex("Lenna.dds", EF_ETC2_R11, EF_BC4, 1.5f);
+}
+
+BOOST_AUTO_TEST_CASE(TranscodeBC5ToEAC)
+{
+	TestTranscodeTex("Lenna.dds", EF_BC5, EF_ETC2_GR11, 1.5f);
+	TestTranscodeTex("Lenna.dds", EF_ETC2_GR11, EF_BC5, 1.5f);
+}
+
+BOOST_AUTO_TEST_CASE(TranscodeBC1WithAlpha)
+{
+	// 4-color mode, 3-color mode without index 3, and 3-color mode with a transparent texel
+	BC1Block blocks[3];
+	blocks[0].clr_0 = 0xF800;
+	blocks[0].clr_1 = 0x001F;
+	blocks[0].bitmap[0] = 0xFFFF;
+	blocks[0].bitmap[1] = 0xFFFF;
+	blocks[1].clr_0 = 0x001F;
+	blocks[1].clr_1 = 0xF800;
+	blocks[1].bitmap[0] = 0x5A5A;
+	blocks[1].bitmap[1] = 0x0000;
+	blocks[2] = blocks[1];
+	blocks[2].bitmap[1] = 0x0300;
+
+	BOOST_CHECK(IsTranscodable(EF_ETC2_BGR8, &blocks[0], sizeof(blocks), sizeof(blocks), EF_BC1, 8, 4, 1));
+	BOOST_CHECK(!IsTranscodable(EF_ETC2_BGR8, &blocks[0], sizeof(blocks), sizeof(blocks), EF_BC1, 12, 4, 1));
+	BOOST_CHECK(!IsTranscodable(EF_ETC1, &blocks[0], sizeof(blocks), sizeof(blocks), EF_BC1, 12, 4, 1));
+	BOOST_CHECK(IsTranscodable(EF_BC1, &blocks[0], sizeof(blocks), sizeof(blocks), EF_ETC2_BGR8, 12, 4, 1));
+
+	// Without a transcodable target, ResizeTexture decodes the block, and the transparent texel survives
+	uint32_t argb[4 * 4];
+	ResizeTexture(argb, 4 * 4, sizeof(argb), EF_ARGB8, 4, 4, 1,
+		&blocks[2], sizeof(BC1Block), sizeof(BC1Block), EF_BC1, 4, 4, 1, false);
+	BOOST_CHECK_EQUAL(argb[12] >> 24, 0U);
+	BOOST_CHECK_EQUAL(argb[0] >> 24, 0xFFU);
+}
+
+// Smooth gradients with noise, and a few tiles of hard edged stripes
+void MakeTranscodeImage(std::vector<ARGBColor32>& argb, uint32_t width, uint32_t height)
+{
+	argb.resize(width * height);
+	uint32_t seed = 1234;
+	for (uint32_t y = 0; y < height; ++ y)
+	{
+		for (uint32_t x = 0; x < width; ++ x)
+		{
+			seed = seed * 1664525U + 1013904223U;
+			int const noise = static_cast<int>((seed >> 24) & 31) - 16;
+			float const fx = static_cast<float>(x) / width;
+			float const fy = static_cast<float>(y) / height;
+			int r = static_cast<int>(128 + 100 * sin(fx * 9 + fy * 3)) + ((((x / 16) + (y / 16)) & 1) ? noise : 0);
+			int g = static_cast<int>(128 + 90 * sin(fy * 13 - fx * 2)) + ((y > height / 2) ? noise / 2 : 0);
+			int b = static_cast<int>(128 + 110 * cos((fx + fy) * 7)) + ((x > width / 2) ? noise : 0);
+			if (0 == ((x / 8) + (y / 8)) % 5)
+			{
+				r = ((x / 2) & 1) ? 230 : 20;
+				g = ((y / 2) & 1) ? 200 : 40;
+				b = 90;
+			}
+			argb[y * width + x] = ARGBColor32(255, static_cast<uint8_t>(MathLib::clamp(r, 0, 255)),
+				static_cast<uint8_t>(MathLib::clamp(g, 0, 255)), static_cast<uint8_t>(MathLib::clamp(b, 0, 255)));
+		}
+	}
+}
+
+// Transcoding fits the destination to the palette of each source block. With TCM_Speed, it has to stay close to
+// decoding the source and encoding it again.
+void TestTranscodeAgainstReencode(ElementFormat src_fmt, TexCompression& src_codec, ElementFormat dst_fmt, TexCompression& dst_codec,
+	float ratio)
+{
+	uint32_t const width = 128;
+	uint32_t const height = 128;
+	std::vector<ARGBColor32> argb;
+	MakeTranscodeImage(argb, width, height);
+
+	uint32_t const texel_bytes = NumFormatBytes(src_codec.DecodedFormat());
+	uint32_t const block_bytes = src_codec.BlockBytes();
+	uint32_t const num_blocks = (width / 4) * (height / 4);
+	std::vector<uint8_t> src_blocks(num_blocks * block_bytes);
+	for (uint32_t by = 0; by < height / 4; ++ by)
+	{
+		for (uint32_t bx = 0; bx < width / 4; ++ bx)
+		{
+			uint8_t texels[64];
+			for (uint32_t i = 0; i < 16; ++ i)
+			{
+				memcpy(&texels[i * texel_bytes], &argb[(by * 4 + i / 4) * width + bx * 4 + i % 4], texel_bytes);
+			}
+			src_codec.EncodeBlock(&src_blocks[(by * width / 4 + bx) * block_bytes], texels, TCM_Balanced);
+		}
+	}
+
+	uint32_t const row_pitch = width / 4 * block_bytes;
+	std::vector<uint8_t> transcoded(src_blocks.size());
+	TranscodeTexture(&transcoded[0], row_pitch, row_pitch * height / 4, dst_fmt,
+		&src_blocks[0], row_pitch, row_pitch * height / 4, src_fmt, width, height, 1, TCM_Speed);
+
+	float transcode_mse = 0;
+	float reencode_mse = 0;
+	for (uint32_t i = 0; i < num_blocks; ++ i)
+	{
+		uint8_t src_texels[64];
+		src_codec.DecodeBlock(src_texels, &src_blocks[i * block_bytes]);
+
+		uint8_t reencoded[16];
+		dst_codec.EncodeBlock(reencoded, src_texels, TCM_Speed);
+
+		uint8_t transcode_texels[64];
+		dst_codec.DecodeBlock(transcode_texels, &transcoded[i * block_bytes]);
+		uint8_t reencode_texels[64];
+		dst_codec.DecodeBlock(reencode_texels, reencoded);
+
+		for (uint32_t j = 0; j < 16 * texel_bytes; ++ j)
+		{
+			// Alpha of ARGB8 is always 255
+			if ((texel_bytes != 4) || (j % 4 != 3))
+			{
+				float const transcode_diff = static_cast<float>(src_texels[j]) - transcode_texels[j];
+				float const reencode_diff = static_cast<float>(src_texels[j]) - reencode_texels[j];
+				transcode_mse += transcode_diff * transcode_diff;
+				reencode_mse += reencode_diff * reencode_diff;
+			}
+		}
+	}
+
+	BOOST_CHECK_LE(sqrt(transcode_mse), sqrt(reencode_mse) * ratio);
+}
+
+BOOST_AUTO_TEST_CASE(TranscodeAgainstReencode)
+{
+	TexCompressionBC1 bc1;
+	TexCompressionBC4 bc4;
+	TexCompressionBC5 bc5;
+	TexCompressionETC1 etc1;
+	TexCompressionETC2RGB8 etc2;
+	TexCompressionETC2R11 r11;
+	TexCompressionETC2RG11 rg11;
+
+	// Measured 1.005 and 1.026. The ETC2 encoder can also pick the T, H and planar modes.
+	TestTranscodeAgainstReencode(EF_BC1, bc1, EF_ETC1, etc1, 1.02f);
+	TestTranscodeAgainstReencode(EF_BC1, bc1, EF_ETC2_BGR8, etc2, 1.04f);
+	// Measured 0.983 and 0.984
+	TestTranscodeAgainstReencode(EF_ETC1, etc1, EF_BC1, bc1, 1.0f);
+	TestTranscodeAgainstReencode(EF_ETC2_BGR8, etc2, EF_BC1, bc1, 1.0f);
+	// The EAC search sees the same values as from the decoded texels
+	TestTranscodeAgainstReencode(EF_BC4, bc4, EF_ETC2_R11, r11, 1.0f);
+	TestTranscodeAgainstReencode(EF_BC5, bc5, EF_ETC2_GR11, rg11, 1.0f);
+}
+
+void TestConvertFormat(ElementFormat src_fmt, ElementFormat dst_fmt)
+{
+	// Not a multiple of the SIMD widths, so the scalar tails are covered too
+	uint32_t const num_elems = 65536 + 7;
+	uint32_t const src_elem_size = NumFormatBytes(src_fmt);
+	uint32_t const dst_elem_size = NumFormatBytes(dst_fmt);
+
+	std::vector<uint8_t> src(num_elems * src_elem_size);
+	if (IsFloatFormat(src_fmt))
+	{
+		std::vector<Color> clrs(num_elems);
+		for (uint32_t i = 0; i < num_elems; ++ i)
+		{
+			clrs[i] = Color((i & 0xFF) / 64.0f - 2, ((i >> 8) & 0xFF) / 32.0f, i * 0.001f, 1 - i * 0.0001f);
+		}
+		ConvertFromABGR32F(src_fmt, &clrs[0], num_elems, &src[0]);
+	}
+	else
+	{
+		for (uint32_t i = 0; i < src.size(); ++ i)
+		{
+			src[i] = static_cast<uint8_t>((i / src_elem_size) >> ((i % src_elem_size) * 8 % 16));
+		}
+	}
+
+	std::vector<Color> tmp(num_elems);
+	std::vector<uint8_t> expected(num_elems * dst_elem_size);
+	ConvertToABGR32F(src_fmt, &src[0], num_elems, &tmp[0]);
+	ConvertFromABGR32F(dst_fmt, &tmp[0], num_elems, &expected[0]);
+
+	std::vector<uint8_t> converted(num_elems * dst_elem_size);
+	ConvertFormat(dst_fmt, &converted[0], src_fmt, &src[0], num_elems);
+
+	BOOST_CHECK(expected == converted);
+}
+
+BOOST_AUTO_TEST_CASE(ConvertFormatRGBA8)
+{
+	TestConvertFormat(EF_ARGB8, EF_ABGR8);
+	TestConvertFormat(EF_ABGR8, EF_ARGB8);
+	TestConvertFormat(EF_ARGB8_SRGB, EF_ABGR8_SRGB);
+	TestConvertFormat(EF_ABGR8_SRGB, EF_ARGB8_SRGB);
+}
+
+BOOST_AUTO_TEST_CASE(ConvertFormatSRGB)
+{
+	TestConvertFormat(EF_ARGB8_SRGB, EF_ARGB8);
+	TestConvertFormat(EF_ABGR8_SRGB, EF_ABGR8);
+	TestConvertFormat(EF_ARGB8_SRGB, EF_ABGR8);
+	TestConvertFormat(EF_ABGR8_SRGB, EF_ARGB8);
+	TestConvertFormat(EF_ARGB8, EF_ARGB8_SRGB);
+	TestConvertFormat(EF_ABGR8, EF_ABGR8_SRGB);
+	TestConvertFormat(EF_ARGB8, EF_ABGR8_SRGB);
+	TestConvertFormat(EF_ABGR8, EF_ARGB8_SRGB);
+}
+
+BOOST_AUTO_TEST_CASE(ConvertFormatR5G6B5)
+{
+	TestConvertFormat(EF_R5G6B5, EF_ARGB8);
+	TestConvertFormat(EF_R5G6B5, EF_ABGR8);
+	TestConvertFormat(EF_ARGB8, EF_R5G6B5);
+	TestConvertFormat(EF_ABGR8, EF_R5G6B5);
+}
+
+BOOST_AUTO_TEST_CASE(ConvertFormatA2BGR10)
+{
+	TestConvertFormat(EF_A2BGR10, EF_ARGB8);
+	TestConvertFormat(EF_A2BGR10, EF_ABGR8);
+	TestConvertFormat(EF_ARGB8, EF_A2BGR10);
+	TestConvertFormat(EF_ABGR8, EF_A2BGR10);
+}
+
+BOOST_AUTO_TEST_CASE(ConvertFormatFloat)
+{
+	TestConvertFormat(EF_R16F, EF_R32F);
+	TestConvertFormat(EF_GR16F, EF_GR32F);
+	TestConvertFormat(EF_BGR16F, EF_BGR32F);
+	TestConvertFormat(EF_ABGR16F, EF_ABGR32F);
+	TestConvertFormat(EF_R32F, EF_R16F);
+	TestConvertFormat(EF_GR32F, EF_GR16F);
+	TestConvertFormat(EF_BGR32F, EF_BGR16F);
+	TestConvertFormat(EF_ABGR32F, EF_ABGR16F);
+}
+
+BOOST_AUTO_TEST_CASE(ConvertFormatFallback)
+{
+	TestConvertFormat(EF_R8, EF_ARGB8);
+	TestConvertFormat(EF_ARGB4, EF_A2BGR10);
+}
+
+BOOST_AUTO_TEST_CASE(GenerateMipMapsBox)
+{
+	uint32_t const width = 256;
+	uint32_t const height = 128;
+
+	std::vector<uint8_t> src(width * height * 4);
+	for (uint32_t i = 0; i < src.size(); ++ i)
+	{
+		src[i] = static_cast<uint8_t>(i * 7 + (i >> 10));
+	}
+	ElementInitData src_data;
+	src_data.data = &src[0];
+	src_data.row_pitch = width * 4;
+	src_data.slice_pitch = width * height * 4;
+
+	std::vector<ElementInitData> mip_data;
+	std::vector<uint8_t> mip_data_block;
+	GenerateMipMaps(mip_data, mip_data_block, EF_ARGB8, &src_data, EF_ARGB8, width, height, 1, 1, 0, MF_Box);
+	BOOST_CHECK_EQUAL(mip_data.size(), 9U);
+	BOOST_CHECK(0 == memcmp(mip_data[0].data, &src[0], src.size()));
+
+	uint8_t const * level1 = static_cast<uint8_t const *>(mip_data[1].data);
+	for (uint32_t y = 0; y < height / 2; ++ y)
+	{
+		for (uint32_t x = 0; x < width / 2; ++ x)
+		{
+			for (uint32_t ch = 0; ch < 4; ++ ch)
+			{
+				float const avg = (src[((y * 2 + 0) * width + x * 2 + 0) * 4 + ch] + src[((y * 2 + 0) * width + x * 2 + 1) * 4 + ch]
+					+ src[((y * 2 + 1) * width + x * 2 + 0) * 4 + ch] + src[((y * 2 + 1) * width + x * 2 + 1) * 4 + ch]) / 4.0f;
+				BOOST_CHECK_SMALL(level1[y * mip_data[1].row_pitch + x * 4 + ch] - avg, 0.51f);
+			}
+		}
+	}
+}
+
+BOOST_AUTO_TEST_CASE(GenerateMipMapsSRGB)
+{
+	// A black and white checker averages to 0.5 in linear space, which is about 188 in sRGB, not 128.
+	//  The sinc based filters are a few steps off on the first level because of the clamped edges.
+	uint32_t const size = 8;
+	std::vector<uint32_t> src(size * size);
+	for (uint32_t y = 0; y < size; ++ y)
+	{
+		for (uint32_t x = 0; x < size; ++ x)
+		{
+			src[y * size + x] = ((x + y) & 1) ? 0xFFFFFFFF : 0xFF000000;
+		}
+	}
+	ElementInitData src_data;
+	src_data.data = &src[0];
+	src_data.row_pitch = size * 4;
+	src_data.slice_pitch = size * size * 4;
+
+	MipFilter const filters[] = { MF_Box, MF_Kaiser, MF_Lanczos };
+	for (size_t i = 0; i < sizeof(filters) / sizeof(filters[0]); ++ i)
+	{
+		std::vector<ElementInitData> mip_data;
+		std::vector<uint8_t> mip_data_block;
+		GenerateMipMaps(mip_data, mip_data_block, EF_ARGB8_SRGB, &src_data, EF_ARGB8_SRGB, size, size, 1, 1, 0, filters[i]);
+		BOOST_CHECK_EQUAL(mip_data.size(), 4U);
+
+		for (size_t level = 1; level < mip_data.size(); ++ level)
+		{
+			uint8_t const * p = static_cast<uint8_t const *>(mip_data[level].data);
+			BOOST_CHECK_SMALL(p[0] - 188, 6);
+			BOOST_CHECK_SMALL(p[1] - 188, 6);
+			BOOST_CHECK_SMALL(p[2] - 188, 6);
+		}
+	}
+}
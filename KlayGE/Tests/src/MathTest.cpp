@@ -1,5 +1,8 @@
 #include <KlayGE/KlayGE.hpp>
 #include <KFL/Math.hpp>
+#include <KFL/Half.hpp>
+#include <KFL/Timer.hpp>
+#include <KFL/Detail/MathSIMD.hpp>
 
 #include <boost/assert.hpp>
 #include <boost/test/unit_test.hpp>
@@ -7,6 +10,8 @@
 #include <vector>
 #include <string>
 #include <iostream>
+#include <limits>
+#include <cstring>
 
 using namespace std;
 using namespace KlayGE;
@@ -31,3 +36,579 @@ BOOST_AUTO_TEST_CASE(NormalizeFloat4)
 	v = MathLib::normalize(v);
 	BOOST_CHECK(MathLib::abs(MathLib::length(v) - 1.0f) < 1e-5f);
 }
+
+namespace
+{
+	int const BENCHMARK_SIZE = 4096;
+	int const BENCHMARK_ITERATIONS = 100;
+
+	float RandomFloat()
+	{
+		return static_cast<float>(rand()) / RAND_MAX * 2 - 1;
+	}
+
+	template <typename T>
+	void RandomFill(std::vector<T>& v)
+	{
+		for (size_t i = 0; i < v.size(); ++ i)
+		{
+			for (typename T::iterator iter = v[i].begin(); iter != v[i].end(); ++ iter)
+			{
+				*iter = RandomFloat();
+			}
+		}
+	}
+
+	template <typename T>
+	bool Close(T const & lhs, T const & rhs)
+	{
+		for (typename T::const_iterator l_iter = lhs.begin(), r_iter = rhs.begin(); l_iter != lhs.end(); ++ l_iter, ++ r_iter)
+		{
+			float const l = *l_iter;
+			float const r = *r_iter;
+			if (MathLib::abs(l - r) > 1e-5f * std::max(1.0f, MathLib::abs(l)))
+			{
+				return false;
+			}
+		}
+		return true;
+	}
+
+	void ReportBenchmark(char const * name, double scalar_time, double simd_time)
+	{
+		cout << name << ": scalar " << scalar_time * 1000 << " ms, SIMD " << simd_time * 1000 << " ms";
+		if (simd_time > 0)
+		{
+			cout << ", speedup " << scalar_time / simd_time << "x";
+		}
+		cout << endl;
+	}
+}
+
+BOOST_AUTO_TEST_CASE(SIMDMulFloat4x4)
+{
+	std::vector<float4x4> lhs(BENCHMARK_SIZE), rhs(BENCHMARK_SIZE);
+	std::vector<float4x4> scalar_ret(BENCHMARK_SIZE), simd_ret(BENCHMARK_SIZE), batch_ret(BENCHMARK_SIZE);
+	RandomFill(lhs);
+	RandomFill(rhs);
+
+	Timer timer;
+	for (int it = 0; it < BENCHMARK_ITERATIONS; ++ it)
+	{
+		for (int i = 0; i < BENCHMARK_SIZE; ++ i)
+		{
+			scalar_ret[i] = detail::mul_scalar(lhs[i], rhs[i]);
+		}
+	}
+	double const scalar_time = timer.elapsed();
+
+	timer.restart();
+	for (int it = 0; it < BENCHMARK_ITERATIONS; ++ it)
+	{
+		for (int i = 0; i < BENCHMARK_SIZE; ++ i)
+		{
+			simd_ret[i] = MathLib::mul(lhs[i], rhs[i]);
+		}
+	}
+	double const simd_time = timer.elapsed();
+
+	timer.restart();
+	for (int it = 0; it < BENCHMARK_ITERATIONS; ++ it)
+	{
+		MathLib::mul_array(&batch_ret[0], &lhs[0], &rhs[0], BENCHMARK_SIZE);
+	}
+	double const batch_time = timer.elapsed();
+
+	ReportBenchmark("mul(float4x4)", scalar_time, simd_time);
+	ReportBenchmark("mul_array(float4x4)", scalar_time, batch_time);
+
+	for (int i = 0; i < BENCHMARK_SIZE; ++ i)
+	{
+		BOOST_CHECK(Close(scalar_ret[i], simd_ret[i]));
+		BOOST_CHECK(Close(scalar_ret[i], batch_ret[i]));
+	}
+
+	MathLib::mul_array(&batch_ret[0], &lhs[0], rhs[0], BENCHMARK_SIZE);
+	for (int i = 0; i < BENCHMARK_SIZE; ++ i)
+	{
+		BOOST_CHECK(Close(detail::mul_scalar(lhs[i], rhs[0]), batch_ret[i]));
+	}
+}
+
+BOOST_AUTO_TEST_CASE(SIMDMulQuaternion)
+{
+	std::vector<Quaternion> lhs(BENCHMARK_SIZE), rhs(BENCHMARK_SIZE);
+	std::vector<Quaternion> scalar_ret(BENCHMARK_SIZE), simd_ret(BENCHMARK_SIZE), batch_ret(BENCHMARK_SIZE);
+	RandomFill(lhs);
+	RandomFill(rhs);
+
+	Timer timer;
+	for (int it = 0; it < BENCHMARK_ITERATIONS; ++ it)
+	{
+		for (int i = 0; i < BENCHMARK_SIZE; ++ i)
+		{
+			scalar_ret[i] = detail::mul_scalar(lhs[i], rhs[i]);
+		}
+	}
+	double const scalar_time = timer.elapsed();
+
+	timer.restart();
+	for (int it = 0; it < BENCHMARK_ITERATIONS; ++ it)
+	{
+		for (int i = 0; i < BENCHMARK_SIZE; ++ i)
+		{
+			simd_ret[i] = MathLib::mul(lhs[i], rhs[i]);
+		}
+	}
+	double const simd_time = timer.elapsed();
+
+	timer.restart();
+	for (int it = 0; it < BENCHMARK_ITERATIONS; ++ it)
+	{
+		MathLib::mul_array(&batch_ret[0], &lhs[0], &rhs[0], BENCHMARK_SIZE);
+	}
+	double const batch_time = timer.elapsed();
+
+	ReportBenchmark("mul(Quaternion)", scalar_time, simd_time);
+	ReportBenchmark("mul_array(Quaternion)", scalar_time, batch_time);
+
+	for (int i = 0; i < BENCHMARK_SIZE; ++ i)
+	{
+		BOOST_CHECK(Close(scalar_ret[i], simd_ret[i]));
+		BOOST_CHECK(Close(scalar_ret[i], batch_ret[i]));
+	}
+}
+
+BOOST_AUTO_TEST_CASE(SIMDTransformFloat4)
+{
+	float4x4 mat;
+	for (size_t i = 0; i < float4x4::size(); ++ i)
+	{
+		*(mat.begin() + i) = RandomFloat();
+	}
+
+	std::vector<float4> v(BENCHMARK_SIZE);
+	std::vector<float4> scalar_ret(BENCHMARK_SIZE), simd_ret(BENCHMARK_SIZE), batch_ret(BENCHMARK_SIZE);
+	RandomFill(v);
+
+	Timer timer;
+	for (int it = 0; it < BENCHMARK_ITERATIONS; ++ it)
+	{
+		for (int i = 0; i < BENCHMARK_SIZE; ++ i)
+		{
+			scalar_ret[i] = detail::transform_scalar(v[i], mat);
+		}
+	}
+	double const scalar_time = timer.elapsed();
+
+	timer.restart();
+	for (int it = 0; it < BENCHMARK_ITERATIONS; ++ it)
+	{
+		for (int i = 0; i < BENCHMARK_SIZE; ++ i)
+		{
+			simd_ret[i] = MathLib::transform(v[i], mat);
+		}
+	}
+	double const simd_time = timer.elapsed();
+
+	timer.restart();
+	for (int it = 0; it < BENCHMARK_ITERATIONS; ++ it)
+	{
+		MathLib::transform_array(&batch_ret[0], &v[0], BENCHMARK_SIZE, mat);
+	}
+	double const batch_time = timer.elapsed();
+
+	ReportBenchmark("transform(float4)", scalar_time, simd_time);
+	ReportBenchmark("transform_array(float4)", scalar_time, batch_time);
+
+	for (int i = 0; i < BENCHMARK_SIZE; ++ i)
+	{
+		BOOST_CHECK(Close(scalar_ret[i], simd_ret[i]));
+		BOOST_CHECK(Close(scalar_ret[i], batch_ret[i]));
+	}
+}
+
+BOOST_AUTO_TEST_CASE(SIMDTransformFloat3)
+{
+	float4x4 mat;
+	for (size_t i = 0; i < float4x4::size(); ++ i)
+	{
+		*(mat.begin() + i) = RandomFloat();
+	}
+
+	std::vector<float3> v(BENCHMARK_SIZE);
+	std::vector<float4> scalar_ret(BENCHMARK_SIZE), simd_ret(BENCHMARK_SIZE), batch_ret(BENCHMARK_SIZE);
+	std::vector<float3> scalar_normal(BENCHMARK_SIZE), simd_normal(BENCHMARK_SIZE), batch_normal(BENCHMARK_SIZE);
+	RandomFill(v);
+
+	Timer timer;
+	for (int it = 0; it < BENCHMARK_ITERATIONS; ++ it)
+	{
+		for (int i = 0; i < BENCHMARK_SIZE; ++ i)
+		{
+			scalar_ret[i] = detail::transform_scalar(v[i], mat);
+		}
+	}
+	double const scalar_time = timer.elapsed();
+
+	timer.restart();
+	for (int it = 0; it < BENCHMARK_ITERATIONS; ++ it)
+	{
+		for (int i = 0; i < BENCHMARK_SIZE; ++ i)
+		{
+			simd_ret[i] = MathLib::transform(v[i], mat);
+		}
+	}
+	double const simd_time = timer.elapsed();
+
+	timer.restart();
+	for (int it = 0; it < BENCHMARK_ITERATIONS; ++ it)
+	{
+		MathLib::transform_array(&batch_ret[0], &v[0], BENCHMARK_SIZE, mat);
+	}
+	double const batch_time = timer.elapsed();
+
+	timer.restart();
+	for (int it = 0; it < BENCHMARK_ITERATIONS; ++ it)
+	{
+		for (int i = 0; i < BENCHMARK_SIZE; ++ i)
+		{
+			scalar_normal[i] = detail::transform_normal_scalar(v[i], mat);
+		}
+	}
+	double const scalar_normal_time = timer.elapsed();
+
+	timer.restart();
+	for (int it = 0; it < BENCHMARK_ITERATIONS; ++ it)
+	{
+		for (int i = 0; i < BENCHMARK_SIZE; ++ i)
+		{
+			simd_normal[i] = MathLib::transform_normal(v[i], mat);
+		}
+	}
+	double const simd_normal_time = timer.elapsed();
+
+	timer.restart();
+	for (int it = 0; it < BENCHMARK_ITERATIONS; ++ it)
+	{
+		MathLib::transform_normal_array(&batch_normal[0], &v[0], BENCHMARK_SIZE, mat);
+	}
+	double const batch_normal_time = timer.elapsed();
+
+	ReportBenchmark("transform(float3)", scalar_time, simd_time);
+	ReportBenchmark("transform_array(float3)", scalar_time, batch_time);
+	ReportBenchmark("transform_normal(float3)", scalar_normal_time, simd_normal_time);
+	ReportBenchmark("transform_normal_array(float3)", scalar_normal_time, batch_normal_time);
+
+	for (int i = 0; i < BENCHMARK_SIZE; ++ i)
+	{
+		BOOST_CHECK(Close(scalar_ret[i], simd_ret[i]));
+		BOOST_CHECK(Close(scalar_ret[i], batch_ret[i]));
+		BOOST_CHECK(Close(scalar_normal[i], simd_normal[i]));
+		BOOST_CHECK(Close(scalar_normal[i], batch_normal[i]));
+	}
+
+	std::vector<float3> coord(v);
+	MathLib::transform_coord_array(&coord[0], &coord[0], BENCHMARK_SIZE, mat);
+	for (int i = 0; i < BENCHMARK_SIZE; ++ i)
+	{
+		BOOST_CHECK(Close(MathLib::transform_coord(v[i], mat), coord[i]));
+	}
+}
+
+namespace
+{
+	Quaternion RandomRotation()
+	{
+		Quaternion q(RandomFloat(), RandomFloat(), RandomFloat(), RandomFloat());
+		return MathLib::normalize(q);
+	}
+
+	// Scaling, rotation and translation, well conditioned for inverting and decomposing
+	float4x4 RandomTransform()
+	{
+		return MathLib::scaling(RandomFloat() * 0.5f + 1, RandomFloat() * 0.5f + 1, RandomFloat() * 0.5f + 1)
+			* MathLib::to_matrix(RandomRotation())
+			* MathLib::translation(RandomFloat() * 10, RandomFloat() * 10, RandomFloat() * 10);
+	}
+
+	// q and -q are the same rotation
+	bool CloseRotation(Quaternion const & lhs, Quaternion const & rhs)
+	{
+		return Close(lhs, rhs) || Close(lhs, -rhs);
+	}
+}
+
+BOOST_AUTO_TEST_CASE(SIMDInverseFloat4x4)
+{
+	std::vector<float4x4> m(BENCHMARK_SIZE);
+	for (int i = 0; i < BENCHMARK_SIZE; ++ i)
+	{
+		m[i] = RandomTransform();
+	}
+	std::vector<float4x4> scalar_ret(BENCHMARK_SIZE), simd_ret(BENCHMARK_SIZE);
+
+	Timer timer;
+	for (int it = 0; it < BENCHMARK_ITERATIONS; ++ it)
+	{
+		for (int i = 0; i < BENCHMARK_SIZE; ++ i)
+		{
+			scalar_ret[i] = detail::inverse_scalar(m[i]);
+		}
+	}
+	double const scalar_time = timer.elapsed();
+
+	timer.restart();
+	for (int it = 0; it < BENCHMARK_ITERATIONS; ++ it)
+	{
+		for (int i = 0; i < BENCHMARK_SIZE; ++ i)
+		{
+			simd_ret[i] = MathLib::inverse(m[i]);
+		}
+	}
+	double const simd_time = timer.elapsed();
+
+	ReportBenchmark("inverse(float4x4)", scalar_time, simd_time);
+
+	for (int i = 0; i < BENCHMARK_SIZE; ++ i)
+	{
+		BOOST_CHECK(Close(scalar_ret[i], simd_ret[i]));
+	}
+
+	// A singular matrix is returned as is
+	float4x4 const singular(1, 2, 3, 4, 2, 4, 6, 8, 0, 1, 0, 1, 1, 0, 1, 0);
+	BOOST_CHECK(MathLib::inverse(singular) == singular);
+}
+
+BOOST_AUTO_TEST_CASE(SIMDSlerpQuaternion)
+{
+	std::vector<Quaternion> lhs(BENCHMARK_SIZE), rhs(BENCHMARK_SIZE);
+	std::vector<float> s(BENCHMARK_SIZE);
+	for (int i = 0; i < BENCHMARK_SIZE; ++ i)
+	{
+		lhs[i] = RandomRotation();
+		rhs[i] = RandomRotation();
+		s[i] = RandomFloat() * 0.5f + 0.5f;
+	}
+	// Nearly the same rotations take the lerp branch
+	rhs[0] = lhs[0];
+	rhs[1] = -lhs[1];
+	std::vector<Quaternion> scalar_ret(BENCHMARK_SIZE), simd_ret(BENCHMARK_SIZE);
+
+	Timer timer;
+	for (int it = 0; it < BENCHMARK_ITERATIONS; ++ it)
+	{
+		for (int i = 0; i < BENCHMARK_SIZE; ++ i)
+		{
+			scalar_ret[i] = detail::slerp_scalar(lhs[i], rhs[i], s[i]);
+		}
+	}
+	double const scalar_time = timer.elapsed();
+
+	timer.restart();
+	for (int it = 0; it < BENCHMARK_ITERATIONS; ++ it)
+	{
+		for (int i = 0; i < BENCHMARK_SIZE; ++ i)
+		{
+			simd_ret[i] = MathLib::slerp(lhs[i], rhs[i], s[i]);
+		}
+	}
+	double const simd_time = timer.elapsed();
+
+	ReportBenchmark("slerp(Quaternion)", scalar_time, simd_time);
+
+	for (int i = 0; i < BENCHMARK_SIZE; ++ i)
+	{
+		BOOST_CHECK(Close(scalar_ret[i], simd_ret[i]));
+	}
+}
+
+BOOST_AUTO_TEST_CASE(SIMDDecomposeFloat4x4)
+{
+	std::vector<float4x4> m(BENCHMARK_SIZE);
+	for (int i = 0; i < BENCHMARK_SIZE; ++ i)
+	{
+		m[i] = RandomTransform();
+	}
+	std::vector<float3> scalar_scale(BENCHMARK_SIZE), simd_scale(BENCHMARK_SIZE);
+	std::vector<Quaternion> scalar_rot(BENCHMARK_SIZE), simd_rot(BENCHMARK_SIZE);
+	std::vector<float3> scalar_trans(BENCHMARK_SIZE), simd_trans(BENCHMARK_SIZE);
+
+	Timer timer;
+	for (int it = 0; it < BENCHMARK_ITERATIONS; ++ it)
+	{
+		for (int i = 0; i < BENCHMARK_SIZE; ++ i)
+		{
+			detail::decompose_scalar(scalar_scale[i], scalar_rot[i], scalar_trans[i], m[i]);
+		}
+	}
+	double const scalar_time = timer.elapsed();
+
+	timer.restart();
+	for (int it = 0; it < BENCHMARK_ITERATIONS; ++ it)
+	{
+		for (int i = 0; i < BENCHMARK_SIZE; ++ i)
+		{
+			MathLib::decompose(simd_scale[i], simd_rot[i], simd_trans[i], m[i]);
+		}
+	}
+	double const simd_time = timer.elapsed();
+
+	ReportBenchmark("decompose(float4x4)", scalar_time, simd_time);
+
+	for (int i = 0; i < BENCHMARK_SIZE; ++ i)
+	{
+		BOOST_CHECK(Close(scalar_scale[i], simd_scale[i]));
+		BOOST_CHECK(CloseRotation(scalar_rot[i], simd_rot[i]));
+		BOOST_CHECK(Close(scalar_trans[i], simd_trans[i]));
+	}
+}
+
+BOOST_AUTO_TEST_CASE(SIMDPerspectiveArea)
+{
+	float3 const eye(0, 0, -10);
+	float4x4 const view_proj = MathLib::look_at_lh(eye, float3(0, 0, 0))
+		* MathLib::perspective_fov_lh(PI / 4, 1.0f, 0.1f, 100.0f);
+
+	std::vector<AABBox> boxes(BENCHMARK_SIZE, AABBox(float3(0, 0, 0), float3(0, 0, 0)));
+	for (int i = 0; i < BENCHMARK_SIZE; ++ i)
+	{
+		float3 const center(RandomFloat() * 4, RandomFloat() * 4, RandomFloat() * 4);
+		float3 const extent(RandomFloat() * 0.5f + 1, RandomFloat() * 0.5f + 1, RandomFloat() * 0.5f + 1);
+		boxes[i] = AABBox(center - extent, center + extent);
+	}
+	// The eye inside a box covers the whole screen
+	boxes[0] = AABBox(eye - float3(1, 1, 1), eye + float3(1, 1, 1));
+	std::vector<float> scalar_ret(BENCHMARK_SIZE), simd_ret(BENCHMARK_SIZE);
+
+	Timer timer;
+	for (int it = 0; it < BENCHMARK_ITERATIONS; ++ it)
+	{
+		for (int i = 0; i < BENCHMARK_SIZE; ++ i)
+		{
+			scalar_ret[i] = detail::perspective_area_scalar(eye, view_proj, boxes[i]);
+		}
+	}
+	double const scalar_time = timer.elapsed();
+
+	timer.restart();
+	for (int it = 0; it < BENCHMARK_ITERATIONS; ++ it)
+	{
+		for (int i = 0; i < BENCHMARK_SIZE; ++ i)
+		{
+			simd_ret[i] = MathLib::perspective_area(eye, view_proj, boxes[i]);
+		}
+	}
+	double const simd_time = timer.elapsed();
+
+	ReportBenchmark("perspective_area", scalar_time, simd_time);
+
+	BOOST_CHECK_EQUAL(simd_ret[0], 1.0f);
+	for (int i = 0; i < BENCHMARK_SIZE; ++ i)
+	{
+		BOOST_CHECK(MathLib::abs(scalar_ret[i] - simd_ret[i]) <= 1e-5f * std::max(1.0f, scalar_ret[i]));
+	}
+}
+
+namespace
+{
+	uint32_t FloatBits(float f)
+	{
+		uint32_t ret;
+		std::memcpy(&ret, &f, sizeof(ret));
+		return ret;
+	}
+
+	float FloatFromBits(uint32_t bits)
+	{
+		float ret;
+		std::memcpy(&ret, &bits, sizeof(ret));
+		return ret;
+	}
+}
+
+BOOST_AUTO_TEST_CASE(HalfScalar)
+{
+	BOOST_CHECK_EQUAL(half(0.0f).bits(), 0x0000);
+	BOOST_CHECK_EQUAL(half(-0.0f).bits(), 0x8000);
+	BOOST_CHECK_EQUAL(half(1.0f).bits(), 0x3C00);
+	BOOST_CHECK_EQUAL(half(HALF_MAX).bits(), 0x7BFF);
+	BOOST_CHECK_EQUAL(half(HALF_MIN).bits(), 0x0001);
+	// Ties round to even
+	BOOST_CHECK_EQUAL(half(1.0f + 1.0f / 2048).bits(), 0x3C00);
+	BOOST_CHECK_EQUAL(half(1.0f + 3.0f / 2048).bits(), 0x3C02);
+	// Overflow goes to infinity
+	BOOST_CHECK_EQUAL(half(65520.0f).bits(), 0x7C00);
+	BOOST_CHECK_EQUAL(half(-1e10f).bits(), 0xFC00);
+	BOOST_CHECK_EQUAL(half(std::numeric_limits<float>::infinity()).bits(), 0x7C00);
+	BOOST_CHECK_EQUAL(half(std::numeric_limits<float>::quiet_NaN()).bits() & 0x7E00, 0x7E00);
+
+	BOOST_CHECK_EQUAL(FloatBits(half::from_bits(0x0000)), 0x00000000U);
+	BOOST_CHECK_EQUAL(FloatBits(half::from_bits(0x8000)), 0x80000000U);
+	BOOST_CHECK_EQUAL(static_cast<float>(half::from_bits(0x3C00)), 1.0f);
+	BOOST_CHECK_EQUAL(static_cast<float>(half::from_bits(0x0001)), HALF_MIN);
+	BOOST_CHECK_EQUAL(static_cast<float>(half::from_bits(0x7C00)), std::numeric_limits<float>::infinity());
+
+	// Every non-NaN half survives a round trip
+	for (uint32_t i = 0; i < 0x10000; ++ i)
+	{
+		uint16_t const bits = static_cast<uint16_t>(i);
+		if (((bits & 0x7C00) != 0x7C00) || (0 == (bits & 0x03FF)))
+		{
+			BOOST_CHECK_EQUAL(half(static_cast<float>(half::from_bits(bits))).bits(), bits);
+		}
+	}
+}
+
+BOOST_AUTO_TEST_CASE(HalfToFloatBatch)
+{
+	std::vector<half> in(0x10000);
+	for (uint32_t i = 0; i < in.size(); ++ i)
+	{
+		in[i] = half::from_bits(static_cast<uint16_t>(i));
+	}
+
+	// Odd count and offset to cover the unaligned head and the scalar tail
+	std::vector<float> out(in.size());
+	half_to_float_n(&out[0], &in[0], 3);
+	half_to_float_n(&out[3], &in[3], in.size() - 3);
+
+	for (uint32_t i = 0; i < in.size(); ++ i)
+	{
+		float const expected = in[i];
+		if (expected != expected)
+		{
+			BOOST_CHECK(out[i] != out[i]);
+		}
+		else
+		{
+			BOOST_CHECK_EQUAL(FloatBits(out[i]), FloatBits(expected));
+		}
+	}
+}
+
+BOOST_AUTO_TEST_CASE(FloatToHalfBatch)
+{
+	// Denormal, normal, overflow and NaN ranges in both signs
+	std::vector<float> in;
+	for (uint64_t i = 0; i < 0x100000000ULL; i += 4093)
+	{
+		in.push_back(FloatFromBits(static_cast<uint32_t>(i)));
+	}
+	// Exact ties in the denormal and normal ranges
+	for (uint32_t i = 0; i < 0x10000; ++ i)
+	{
+		uint32_t const bits = FloatBits(half::from_bits(static_cast<uint16_t>(i)));
+		in.push_back(FloatFromBits(bits + 0x1000));
+		in.push_back(FloatFromBits(bits | 0x1000));
+	}
+
+	std::vector<half> out(in.size());
+	float_to_half_n(&out[0], &in[0], 5);
+	float_to_half_n(&out[5], &in[5], in.size() - 5);
+
+	for (size_t i = 0; i < in.size(); ++ i)
+	{
+		BOOST_CHECK_EQUAL(out[i].bits(), half(in[i]).bits());
+	}
+}
@@ -0,0 +1,160 @@
+#include <KlayGE/KlayGE.hpp>
+#include <MeshMLLib/MeshMLLib.hpp>
+
+#include <boost/test/unit_test.hpp>
+
+#include <vector>
+#include <string>
+#include <sstream>
+#include <iomanip>
+#include <limits>
+#include <stdexcept>
+#include <cstdlib>
+#include <cstring>
+#include <cmath>
+
+using namespace std;
+using namespace KlayGE;
+
+namespace
+{
+	uint32_t FloatBits(float v)
+	{
+		uint32_t bits;
+		memcpy(&bits, &v, sizeof(bits));
+		return bits;
+	}
+
+	// The parsed value has to be the same bits as the one of strtof, nan and the sign of 0 included
+	void CheckAgainstStrtof(std::string const & str)
+	{
+		float v;
+		char const * end = ParseMeshMLFloat(str.c_str(), v);
+		BOOST_CHECK_EQUAL(end, str.c_str() + str.size());
+
+		float const expected = strtof(str.c_str(), nullptr);
+		BOOST_CHECK_MESSAGE(FloatBits(v) == FloatBits(expected), "\"" << str << "\" parsed to " << std::setprecision(9) << v
+			<< " instead of " << expected);
+	}
+
+	uint32_t NextRandom(uint32_t& seed)
+	{
+		seed = seed * 1664525 + 1013904223;
+		return seed;
+	}
+}
+
+BOOST_AUTO_TEST_CASE(MeshMLParseFloatTokens)
+{
+	char const * tokens[] =
+	{
+		"0", "-0", "+0", "0.0", "-0.0", ".5", "5.", "-.5", "+1.25",
+		"000123.4500", "-0000.000001", "00000000000000000000000001",
+		"1e10", "1E10", "1e+10", "1e-10", "-2.5e-3", "2.5E+003", "1e38", "3.4028235e38", "3.5e38", "1e39",
+		"1e-38", "1.17549435e-38", "1e-40", "1.4e-45", "1e-46", "1e-9999", "1e9999",
+		"0.1", "0.2", "0.3", "3.14159265358979323846", "2.71828182845904523536028747135266249775724709369995",
+		"16777216", "16777217", "16777218", "33554435", "9007199254740993", "123456789012345678901234567890",
+		"0.000000000000000000000000000000000000000000001", "1.00000000000000000000000000000000000000001",
+		// Right above the midpoint between 1 and its next float, within half an ulp of double
+		"1.0000000596046448", "1.00000005960464477550", "1.000000059604644775390625",
+		"inf", "-inf", "INF", "infinity", "-Infinity", "nan", "-nan", "NaN",
+	};
+	for (size_t i = 0; i < sizeof(tokens) / sizeof(tokens[0]); ++ i)
+	{
+		CheckAgainstStrtof(tokens[i]);
+	}
+}
+
+BOOST_AUTO_TEST_CASE(MeshMLParseFloatRandom)
+{
+	uint32_t seed = 0x2545F491;
+	for (uint32_t i = 0; i < 100000; ++ i)
+	{
+		float f;
+		uint32_t const bits = NextRandom(seed);
+		memcpy(&f, &bits, sizeof(f));
+		if (!(std::abs(f) <= std::numeric_limits<float>::max()))
+		{
+			continue;
+		}
+
+		std::ostringstream ss;
+		ss << std::setprecision(9) << f;
+		CheckAgainstStrtof(ss.str());
+
+		// The middle of f and its next float, slightly off, is where rounding twice goes wrong
+		float const next = std::nextafter(f, (f < 0) ? -std::numeric_limits<float>::max() : std::numeric_limits<float>::max());
+		double const mid = (static_cast<double>(f) + next) / 2;
+		for (int precision = 16; precision <= 18; ++ precision)
+		{
+			std::ostringstream mid_ss;
+			mid_ss << std::setprecision(precision) << mid;
+			CheckAgainstStrtof(mid_ss.str());
+		}
+
+		// What exporters usually write
+		if (std::abs(f) < 1e6f)
+		{
+			std::ostringstream fixed_ss;
+			fixed_ss << std::fixed << std::setprecision(6) << f;
+			CheckAgainstStrtof(fixed_ss.str());
+		}
+	}
+}
+
+BOOST_AUTO_TEST_CASE(MeshMLParseLists)
+{
+	std::string const str = "  1 -2.5\t\t3e2\r\n  ";
+	float v[5];
+	char const * p = str.c_str();
+	for (int i = 0; i < 5; ++ i)
+	{
+		p = ParseMeshMLFloat(p, v[i]);
+	}
+	BOOST_CHECK_EQUAL(v[0], 1.0f);
+	BOOST_CHECK_EQUAL(v[1], -2.5f);
+	BOOST_CHECK_EQUAL(v[2], 300.0f);
+	BOOST_CHECK_EQUAL(v[3], 0.0f);
+	BOOST_CHECK_EQUAL(v[4], 0.0f);
+	BOOST_CHECK_EQUAL(p, str.c_str() + str.size());
+
+	float empty_v = 1;
+	ParseMeshMLFloat("", empty_v);
+	BOOST_CHECK_EQUAL(empty_v, 0.0f);
+
+	std::string const uint_str = "7 +8  4294967295 -1";
+	uint32_t u[5];
+	p = uint_str.c_str();
+	for (int i = 0; i < 5; ++ i)
+	{
+		p = ParseMeshMLUInt(p, u[i]);
+	}
+	BOOST_CHECK_EQUAL(u[0], 7U);
+	BOOST_CHECK_EQUAL(u[1], 8U);
+	BOOST_CHECK_EQUAL(u[2], 4294967295U);
+	BOOST_CHECK_EQUAL(u[3], 4294967295U);
+	BOOST_CHECK_EQUAL(u[4], 0U);
+}
+
+BOOST_AUTO_TEST_CASE(MeshMLParseMalformed)
+{
+	char const * float_tokens[] = { "abc", "1.5x", "1e", "1e+", "--1", "+-1", ".", "-", "1.2.3", "1,5", "0x" };
+	for (size_t i = 0; i < sizeof(float_tokens) / sizeof(float_tokens[0]); ++ i)
+	{
+		float v;
+		BOOST_CHECK_THROW(ParseMeshMLFloat(float_tokens[i], v), std::invalid_argument);
+	}
+
+	// The error is on the bad token, not on the ones before
+	float v;
+	char const * p = ParseMeshMLFloat("1 x 3", v);
+	BOOST_CHECK_EQUAL(v, 1.0f);
+	BOOST_CHECK_THROW(ParseMeshMLFloat(p, v), std::invalid_argument);
+
+	char const * uint_tokens[] = { "abc", "12a", "1.5", "-", "1e3" };
+	for (size_t i = 0; i < sizeof(uint_tokens) / sizeof(uint_tokens[0]); ++ i)
+	{
+		uint32_t u;
+		BOOST_CHECK_THROW(ParseMeshMLUInt(uint_tokens[i], u), std::invalid_argument);
+	}
+}
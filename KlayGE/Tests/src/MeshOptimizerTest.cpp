@@ -0,0 +1,439 @@
+#include <KlayGE/KlayGE.hpp>
+#include <MeshMLLib/MeshMLLib.hpp>
+
+#include <boost/test/unit_test.hpp>
+
+#include <vector>
+#include <algorithm>
+
+using namespace std;
+using namespace KlayGE;
+
+namespace
+{
+	uint32_t const GRID_SIZE = 64;
+
+	// A height field of GRID_SIZE x GRID_SIZE quads, two triangles each
+	void MakeGrid(std::vector<float3>& positions, std::vector<uint32_t>& indices)
+	{
+		positions.clear();
+		for (uint32_t y = 0; y <= GRID_SIZE; ++ y)
+		{
+			for (uint32_t x = 0; x <= GRID_SIZE; ++ x)
+			{
+				positions.push_back(float3(static_cast<float>(x), static_cast<float>(y),
+					static_cast<float>((x * 7 + y * 3) % 5) * 0.1f));
+			}
+		}
+
+		indices.clear();
+		for (uint32_t y = 0; y < GRID_SIZE; ++ y)
+		{
+			for (uint32_t x = 0; x < GRID_SIZE; ++ x)
+			{
+				uint32_t const v0 = y * (GRID_SIZE + 1) + x;
+				uint32_t const v1 = v0 + 1;
+				uint32_t const v2 = v0 + GRID_SIZE + 1;
+				uint32_t const v3 = v2 + 1;
+				indices.push_back(v0);
+				indices.push_back(v2);
+				indices.push_back(v1);
+				indices.push_back(v1);
+				indices.push_back(v2);
+				indices.push_back(v3);
+			}
+		}
+	}
+
+	// Shuffles the triangles with a fixed seed, so the input has no locality to start from
+	void ShuffleTriangles(std::vector<uint32_t>& indices)
+	{
+		uint32_t const num_tris = static_cast<uint32_t>(indices.size() / 3);
+		uint32_t seed = 0x12345678;
+		for (uint32_t i = num_tris - 1; i > 0; -- i)
+		{
+			seed = seed * 1664525 + 1013904223;
+			uint32_t const j = (seed >> 8) % (i + 1);
+			for (uint32_t k = 0; k < 3; ++ k)
+			{
+				std::swap(indices[i * 3 + k], indices[j * 3 + k]);
+			}
+		}
+	}
+
+	// The height field of MakeGrid, flat or with small bumps
+	void MakeHeightGrid(std::vector<float3>& positions, std::vector<uint32_t>& indices, bool flat)
+	{
+		MakeGrid(positions, indices);
+		if (flat)
+		{
+			for (size_t i = 0; i < positions.size(); ++ i)
+			{
+				positions[i].z() = 0;
+			}
+		}
+	}
+
+	bool IsGridBorder(uint32_t v)
+	{
+		uint32_t const x = v % (GRID_SIZE + 1);
+		uint32_t const y = v / (GRID_SIZE + 1);
+		return (0 == x) || (0 == y) || (GRID_SIZE == x) || (GRID_SIZE == y);
+	}
+
+	bool IsReferenced(std::vector<uint32_t> const & indices, uint32_t v)
+	{
+		return std::find(indices.begin(), indices.end(), v) != indices.end();
+	}
+
+	// Triangles as sorted tuples, so two index buffers can be compared whatever the order and rotation
+	std::vector<uint64_t> SortedTriangles(std::vector<uint32_t> const & indices)
+	{
+		std::vector<uint64_t> tris;
+		for (size_t i = 0; i < indices.size(); i += 3)
+		{
+			uint32_t v[3] = { indices[i + 0], indices[i + 1], indices[i + 2] };
+			std::rotate(v, std::min_element(v, v + 3), v + 3);
+			tris.push_back((static_cast<uint64_t>(v[0]) << 42) | (static_cast<uint64_t>(v[1]) << 21) | v[2]);
+		}
+		std::sort(tris.begin(), tris.end());
+		return tris;
+	}
+}
+
+BOOST_AUTO_TEST_CASE(AnalyzeVertexCacheKnownInputs)
+{
+	uint32_t const one_tri[] = { 0, 1, 2 };
+	VertexCacheStats stats = AnalyzeVertexCache(one_tri, 3, 3);
+	BOOST_CHECK_EQUAL(stats.acmr, 3.0f);
+	BOOST_CHECK_EQUAL(stats.atvr, 1.0f);
+
+	// The second triangle reuses two vertices of the first one
+	uint32_t const two_tris[] = { 0, 1, 2, 2, 1, 3 };
+	stats = AnalyzeVertexCache(two_tris, 6, 4);
+	BOOST_CHECK_EQUAL(stats.acmr, 2.0f);
+	BOOST_CHECK_EQUAL(stats.atvr, 1.0f);
+
+	// With a cache of 3, vertex 0 is evicted by 3, 4, 5 and has to be transformed again
+	uint32_t const evicted[] = { 0, 1, 2, 3, 4, 5, 0, 4, 5 };
+	stats = AnalyzeVertexCache(evicted, 9, 6, 3);
+	BOOST_CHECK_EQUAL(stats.acmr, 7.0f / 3);
+	BOOST_CHECK_EQUAL(stats.atvr, 7.0f / 6);
+
+	stats = AnalyzeVertexCache(nullptr, 0, 0);
+	BOOST_CHECK_EQUAL(stats.acmr, 0.0f);
+	BOOST_CHECK_EQUAL(stats.atvr, 0.0f);
+}
+
+BOOST_AUTO_TEST_CASE(ForsythOrderReducesACMR)
+{
+	std::vector<float3> positions;
+	std::vector<uint32_t> indices;
+	MakeGrid(positions, indices);
+	ShuffleTriangles(indices);
+
+	uint32_t const num_indices = static_cast<uint32_t>(indices.size());
+	uint32_t const num_vertices = static_cast<uint32_t>(positions.size());
+	std::vector<uint64_t> const orig_tris = SortedTriangles(indices);
+	VertexCacheStats const orig_stats = AnalyzeVertexCache(&indices[0], num_indices, num_vertices);
+
+	OptimizeTriangleOrder(&indices[0], num_indices, num_vertices);
+	VertexCacheStats const stats = AnalyzeVertexCache(&indices[0], num_indices, num_vertices);
+
+	// Only the order changes, never the triangles themselves
+	BOOST_CHECK(SortedTriangles(indices) == orig_tris);
+
+	// A shuffled grid is close to 3, a good order on a regular grid is below 0.8
+	BOOST_CHECK_GT(orig_stats.acmr, 2.5f);
+	BOOST_CHECK_LT(stats.acmr, 0.8f);
+	BOOST_CHECK_LT(stats.atvr, 1.5f);
+}
+
+BOOST_AUTO_TEST_CASE(OverdrawOrderKeepsACMR)
+{
+	std::vector<float3> positions;
+	std::vector<uint32_t> indices;
+	MakeGrid(positions, indices);
+	ShuffleTriangles(indices);
+
+	uint32_t const num_indices = static_cast<uint32_t>(indices.size());
+	uint32_t const num_vertices = static_cast<uint32_t>(positions.size());
+	std::vector<uint64_t> const orig_tris = SortedTriangles(indices);
+
+	std::vector<uint32_t> cache_indices = indices;
+	OptimizeTriangleOrder(&cache_indices[0], num_indices, num_vertices);
+	VertexCacheStats const cache_stats = AnalyzeVertexCache(&cache_indices[0], num_indices, num_vertices);
+
+	std::vector<uint32_t> overdraw_indices = indices;
+	OptimizeTriangleOrder(&overdraw_indices[0], num_indices, num_vertices, &positions[0]);
+	VertexCacheStats const overdraw_stats = AnalyzeVertexCache(&overdraw_indices[0], num_indices, num_vertices);
+
+	BOOST_CHECK(SortedTriangles(overdraw_indices) == orig_tris);
+	BOOST_CHECK_LE(overdraw_stats.acmr, cache_stats.acmr);
+
+	// A looser ratio can only let the overdraw order through, within that ratio
+	std::vector<uint32_t> loose_indices = indices;
+	OptimizeTriangleOrder(&loose_indices[0], num_indices, num_vertices, &positions[0], 1.1f);
+	VertexCacheStats const loose_stats = AnalyzeVertexCache(&loose_indices[0], num_indices, num_vertices);
+
+	BOOST_CHECK(SortedTriangles(loose_indices) == orig_tris);
+	BOOST_CHECK_LE(loose_stats.acmr, cache_stats.acmr * 1.1f);
+}
+
+BOOST_AUTO_TEST_CASE(VertexFetchRemap)
+{
+	// Vertices 1 and 5 are not referenced
+	uint32_t const num_vertices = 7;
+	uint32_t const orig_indices[] = { 4, 2, 6, 6, 2, 0, 3, 4, 0 };
+	uint32_t const num_indices = sizeof(orig_indices) / sizeof(orig_indices[0]);
+
+	std::vector<uint32_t> indices(orig_indices, orig_indices + num_indices);
+	std::vector<uint32_t> remap;
+	OptimizeVertexFetch(&indices[0], num_indices, num_vertices, remap);
+
+	BOOST_REQUIRE_EQUAL(remap.size(), num_vertices);
+
+	// A bijection on [0, num_vertices)
+	std::vector<uint32_t> sorted_remap = remap;
+	std::sort(sorted_remap.begin(), sorted_remap.end());
+	for (uint32_t v = 0; v < num_vertices; ++ v)
+	{
+		BOOST_CHECK_EQUAL(sorted_remap[v], v);
+	}
+
+	// The indices are rewritten through the remap
+	for (uint32_t i = 0; i < num_indices; ++ i)
+	{
+		BOOST_CHECK_EQUAL(indices[i], remap[orig_indices[i]]);
+	}
+
+	// In the order of the first fetch, the unreferenced vertices at the end in their original order
+	uint32_t const expected_remap[] = { 3, 5, 1, 4, 0, 6, 2 };
+	for (uint32_t v = 0; v < num_vertices; ++ v)
+	{
+		BOOST_CHECK_EQUAL(remap[v], expected_remap[v]);
+	}
+
+	// Each index is either a vertex seen before or the next new one
+	uint32_t next_vertex = 0;
+	for (uint32_t i = 0; i < num_indices; ++ i)
+	{
+		BOOST_CHECK_LE(indices[i], next_vertex);
+		if (indices[i] == next_vertex)
+		{
+			++ next_vertex;
+		}
+	}
+	BOOST_CHECK_EQUAL(next_vertex, 5U);
+}
+
+BOOST_AUTO_TEST_CASE(SimplifyReachesTarget)
+{
+	std::vector<float3> positions;
+	std::vector<uint32_t> indices;
+	MakeHeightGrid(positions, indices, false);
+
+	uint32_t const num_indices = static_cast<uint32_t>(indices.size());
+	uint32_t const num_vertices = static_cast<uint32_t>(positions.size());
+	uint32_t const target = num_indices / 4 / 3 * 3;
+
+	std::vector<uint32_t> simplified;
+	float const error = SimplifyMesh(&indices[0], num_indices, &positions[0], num_vertices, target, 1.0f, simplified);
+
+	// A collapse removes two triangles, it can go one triangle below the target
+	BOOST_CHECK_EQUAL(simplified.size() % 3, 0U);
+	BOOST_CHECK_LE(simplified.size(), target);
+	BOOST_CHECK_GE(simplified.size() + 3, target);
+	BOOST_CHECK_GE(error, 0.0f);
+	BOOST_CHECK_LE(error, 1.0f);
+
+	for (size_t i = 0; i < simplified.size(); i += 3)
+	{
+		BOOST_CHECK_LT(simplified[i + 0], num_vertices);
+		BOOST_CHECK_LT(simplified[i + 1], num_vertices);
+		BOOST_CHECK_LT(simplified[i + 2], num_vertices);
+
+		// No degenerate triangle is left
+		BOOST_CHECK_NE(simplified[i + 0], simplified[i + 1]);
+		BOOST_CHECK_NE(simplified[i + 1], simplified[i + 2]);
+		BOOST_CHECK_NE(simplified[i + 2], simplified[i + 0]);
+	}
+}
+
+BOOST_AUTO_TEST_CASE(SimplifyLocksBordersAndSeams)
+{
+	std::vector<float3> positions;
+	std::vector<uint32_t> indices;
+	MakeHeightGrid(positions, indices, true);
+
+	// Splits the vertices of the middle column, as a UV seam would. The triangles right of it use the copies.
+	uint32_t const seam_x = GRID_SIZE / 2;
+	uint32_t const num_grid_vertices = static_cast<uint32_t>(positions.size());
+	std::vector<uint32_t> seam_copies(GRID_SIZE + 1);
+	for (uint32_t y = 0; y <= GRID_SIZE; ++ y)
+	{
+		seam_copies[y] = static_cast<uint32_t>(positions.size());
+		positions.push_back(positions[y * (GRID_SIZE + 1) + seam_x]);
+	}
+	for (size_t i = 0; i < indices.size(); i += 3)
+	{
+		uint32_t min_x = GRID_SIZE;
+		for (uint32_t k = 0; k < 3; ++ k)
+		{
+			min_x = std::min(min_x, indices[i + k] % (GRID_SIZE + 1));
+		}
+		if (min_x >= seam_x)
+		{
+			for (uint32_t k = 0; k < 3; ++ k)
+			{
+				uint32_t const v = indices[i + k];
+				if (v % (GRID_SIZE + 1) == seam_x)
+				{
+					indices[i + k] = seam_copies[v / (GRID_SIZE + 1)];
+				}
+			}
+		}
+	}
+
+	uint32_t const num_indices = static_cast<uint32_t>(indices.size());
+	uint32_t const num_vertices = static_cast<uint32_t>(positions.size());
+
+	// Asks for far more than the locked vertices allow
+	std::vector<uint32_t> simplified;
+	SimplifyMesh(&indices[0], num_indices, &positions[0], num_vertices, 0, 1.0f, simplified);
+	BOOST_CHECK_LT(simplified.size(), num_indices / 4);
+
+	for (uint32_t v = 0; v < num_grid_vertices; ++ v)
+	{
+		if (IsGridBorder(v) || (v % (GRID_SIZE + 1) == seam_x))
+		{
+			BOOST_CHECK(IsReferenced(simplified, v));
+		}
+	}
+	for (uint32_t y = 0; y <= GRID_SIZE; ++ y)
+	{
+		BOOST_CHECK(IsReferenced(simplified, seam_copies[y]));
+	}
+
+	// Nothing crosses the seam, the two sides never share a vertex
+	for (size_t i = 0; i < simplified.size(); i += 3)
+	{
+		bool left = false;
+		bool right = false;
+		for (uint32_t k = 0; k < 3; ++ k)
+		{
+			uint32_t const v = simplified[i + k];
+			if (v < num_grid_vertices)
+			{
+				uint32_t const x = v % (GRID_SIZE + 1);
+				left |= (x < seam_x);
+				right |= (x > seam_x);
+			}
+			else
+			{
+				right = true;
+			}
+		}
+		BOOST_CHECK(!(left && right));
+	}
+}
+
+BOOST_AUTO_TEST_CASE(SimplifyKeepsOrientation)
+{
+	// On a flat grid every collapse is free, so only the flip check keeps the triangles from turning over
+	for (int flat = 0; flat < 2; ++ flat)
+	{
+		std::vector<float3> positions;
+		std::vector<uint32_t> indices;
+		MakeHeightGrid(positions, indices, flat != 0);
+		ShuffleTriangles(indices);
+
+		uint32_t const num_indices = static_cast<uint32_t>(indices.size());
+		uint32_t const num_vertices = static_cast<uint32_t>(positions.size());
+
+		std::vector<uint32_t> simplified;
+		SimplifyMesh(&indices[0], num_indices, &positions[0], num_vertices, num_indices / 20 / 3 * 3, 1.0f, simplified);
+		BOOST_REQUIRE(!simplified.empty());
+
+		// All the grid's triangles face -z, and none may turn over. With bumps, triangles spanning three locked
+		//  border vertices stand up along the border, so their normal is horizontal.
+		for (size_t i = 0; i < simplified.size(); i += 3)
+		{
+			float3 const & p0 = positions[simplified[i + 0]];
+			float3 const & p1 = positions[simplified[i + 1]];
+			float3 const & p2 = positions[simplified[i + 2]];
+			float3 const normal = MathLib::cross(p1 - p0, p2 - p0);
+			BOOST_CHECK_GT(MathLib::length(normal), 0.0f);
+			BOOST_CHECK_LE(normal.z(), 0.0f);
+		}
+	}
+}
+
+BOOST_AUTO_TEST_CASE(SimplifyStopsAtMaxError)
+{
+	std::vector<float3> positions;
+	std::vector<uint32_t> indices;
+	// The 256 locked border vertices need 254 triangles at least
+	uint32_t const target = 900;
+
+	// Collapses on a plane are free, so a flat grid goes down to the target even with a tiny max error
+	MakeHeightGrid(positions, indices, true);
+	std::vector<uint32_t> flat_simplified;
+	float const flat_error = SimplifyMesh(&indices[0], static_cast<uint32_t>(indices.size()), &positions[0],
+		static_cast<uint32_t>(positions.size()), target, 1e-4f, flat_simplified);
+	BOOST_CHECK_LE(flat_simplified.size(), target);
+	BOOST_CHECK_LE(flat_error, 1e-4f);
+
+	// The bumps cost more than that, so the bumpy grid stops early
+	MakeHeightGrid(positions, indices, false);
+	std::vector<uint32_t> tight_simplified;
+	float const tight_error = SimplifyMesh(&indices[0], static_cast<uint32_t>(indices.size()), &positions[0],
+		static_cast<uint32_t>(positions.size()), target, 1e-4f, tight_simplified);
+	BOOST_CHECK_GT(tight_simplified.size(), target);
+	BOOST_CHECK_LE(tight_error, 1e-4f);
+
+	// A looser bound goes further, and reports more error
+	std::vector<uint32_t> loose_simplified;
+	float const loose_error = SimplifyMesh(&indices[0], static_cast<uint32_t>(indices.size()), &positions[0],
+		static_cast<uint32_t>(positions.size()), target, 0.05f, loose_simplified);
+	BOOST_CHECK_LT(loose_simplified.size(), tight_simplified.size());
+	BOOST_CHECK_GT(loose_error, tight_error);
+	BOOST_CHECK_LE(loose_error, 0.05f);
+}
+
+BOOST_AUTO_TEST_CASE(SimplifyLeavesTinyAndDegenerateInput)
+{
+	std::vector<uint32_t> simplified;
+
+	float error = SimplifyMesh(nullptr, 0, nullptr, 0, 0, 1.0f, simplified);
+	BOOST_CHECK(simplified.empty());
+	BOOST_CHECK_EQUAL(error, 0.0f);
+
+	float3 const positions[] =
+	{
+		float3(0, 0, 0), float3(1, 0, 0), float3(0, 1, 0), float3(1, 1, 0), float3(2, 0, 0)
+	};
+	uint32_t const num_vertices = sizeof(positions) / sizeof(positions[0]);
+
+	// Every vertex of a single triangle or a quad is on the border
+	uint32_t const one_tri[] = { 0, 1, 2 };
+	error = SimplifyMesh(one_tri, 3, positions, num_vertices, 0, 1.0f, simplified);
+	BOOST_CHECK(SortedTriangles(simplified) == SortedTriangles(std::vector<uint32_t>(one_tri, one_tri + 3)));
+	BOOST_CHECK_EQUAL(error, 0.0f);
+
+	uint32_t const quad[] = { 0, 1, 2, 2, 1, 3 };
+	error = SimplifyMesh(quad, 6, positions, num_vertices, 3, 1.0f, simplified);
+	BOOST_CHECK(SortedTriangles(simplified) == SortedTriangles(std::vector<uint32_t>(quad, quad + 6)));
+	BOOST_CHECK_EQUAL(error, 0.0f);
+
+	// Zero area triangles, with a repeated index and with collinear vertices
+	uint32_t const degenerate[] = { 0, 0, 1, 0, 1, 4 };
+	error = SimplifyMesh(degenerate, 6, positions, num_vertices, 0, 1.0f, simplified);
+	BOOST_CHECK(SortedTriangles(simplified) == SortedTriangles(std::vector<uint32_t>(degenerate, degenerate + 6)));
+	BOOST_CHECK_EQUAL(error, 0.0f);
+
+	// Already at the target
+	error = SimplifyMesh(quad, 6, positions, num_vertices, 6, 0.0f, simplified);
+	BOOST_CHECK(SortedTriangles(simplified) == SortedTriangles(std::vector<uint32_t>(quad, quad + 6)));
+	BOOST_CHECK_EQUAL(error, 0.0f);
+}
@@ -0,0 +1,265 @@
+#include <KlayGE/KlayGE.hpp>
+#include <KlayGE/ShaderCache.hpp>
+
+#include <boost/assert.hpp>
+#include <boost/test/unit_test.hpp>
+
+#include <vector>
+#include <string>
+#include <fstream>
+#include <cstdio>
+
+using namespace std;
+using namespace KlayGE;
+
+namespace
+{
+	struct TestShaderMacro
+	{
+		char const * Name;
+		char const * Definition;
+	};
+
+	std::string const TEST_CACHE_DIR = "ShaderCacheTest";
+
+	std::string EntryPath(ShaderCacheKey const & key)
+	{
+		return TEST_CACHE_DIR + "/" + key.Name();
+	}
+
+	bool FileExists(std::string const & path)
+	{
+		std::ifstream ifs(path.c_str(), std::ios_base::binary);
+		return static_cast<bool>(ifs);
+	}
+
+	void WriteFile(std::string const & path, void const * data, size_t size)
+	{
+		std::ofstream ofs(path.c_str(), std::ios_base::binary);
+		ofs.write(static_cast<char const *>(data), size);
+	}
+
+	ShaderCacheKey MakeKey(std::string const & src, std::string const & compiler_version)
+	{
+		TestShaderMacro const macros[] =
+		{
+			{ "KLAYGE_D3D11", "1" },
+			{ "KLAYGE_VERTEX_SHADER", "1" },
+			{ nullptr, nullptr }
+		};
+
+		ShaderCacheKey key;
+		key.Append(src).AppendMacros(macros).Append(std::string("main")).Append(std::string("vs_5_0"))
+			.Append(static_cast<uint32_t>(0)).Append(compiler_version);
+		return key;
+	}
+}
+
+BOOST_AUTO_TEST_CASE(ShaderCacheKeyEquality)
+{
+	BOOST_CHECK(MakeKey("float4 main() : SV_Position { return 0; }", "d3dcompiler_47.dll.1.2")
+		== MakeKey("float4 main() : SV_Position { return 0; }", "d3dcompiler_47.dll.1.2"));
+
+	BOOST_CHECK(!(MakeKey("float4 main() : SV_Position { return 0; }", "d3dcompiler_47.dll.1.2")
+		== MakeKey("float4 main() : SV_Position { return 1; }", "d3dcompiler_47.dll.1.2")));
+	BOOST_CHECK(!(MakeKey("float4 main() : SV_Position { return 0; }", "d3dcompiler_47.dll.1.2")
+		== MakeKey("float4 main() : SV_Position { return 0; }", "d3dcompiler_47.dll.1.3")));
+
+	ShaderCacheKey key_ab_c;
+	key_ab_c.Append(std::string("ab")).Append(std::string("c"));
+	ShaderCacheKey key_a_bc;
+	key_a_bc.Append(std::string("a")).Append(std::string("bc"));
+	BOOST_CHECK(!(key_ab_c == key_a_bc));
+
+	TestShaderMacro const macros_0[] = { { "A", "1" }, { nullptr, nullptr } };
+	TestShaderMacro const macros_1[] = { { "A", "2" }, { nullptr, nullptr } };
+	TestShaderMacro const macros_2[] = { { "A", "1" }, { "B", "1" }, { nullptr, nullptr } };
+	ShaderCacheKey key_0;
+	key_0.AppendMacros(macros_0);
+	ShaderCacheKey key_1;
+	key_1.AppendMacros(macros_1);
+	ShaderCacheKey key_2;
+	key_2.AppendMacros(macros_2);
+	BOOST_CHECK(!(key_0 == key_1));
+	BOOST_CHECK(!(key_0 == key_2));
+
+	ShaderCacheKey key_flags_0;
+	key_flags_0.Append(static_cast<uint32_t>(0));
+	ShaderCacheKey key_flags_1;
+	key_flags_1.Append(static_cast<uint32_t>(0x8000));
+	BOOST_CHECK(!(key_flags_0 == key_flags_1));
+}
+
+BOOST_AUTO_TEST_CASE(ShaderCacheKeyName)
+{
+	std::string const name = MakeKey("", "").Name();
+	BOOST_CHECK_EQUAL(name.size(), 32U);
+	BOOST_CHECK(name.find_first_not_of("0123456789abcdefABCDEF") == std::string::npos);
+
+	BOOST_CHECK(MakeKey("a", "").Name() != MakeKey("b", "").Name());
+}
+
+BOOST_AUTO_TEST_CASE(ShaderCacheCompilerVersion)
+{
+	BOOST_CHECK_EQUAL(ShaderCache::CompilerVersion("no_such_compiler.dll"), "no_such_compiler.dll");
+
+	std::string const compiler_path = "ShaderCacheTestCompiler.dll";
+	WriteFile(compiler_path, "1234", 4);
+	std::string const version_4 = ShaderCache::CompilerVersion(compiler_path);
+	WriteFile(compiler_path, "12345678", 8);
+	std::string const version_8 = ShaderCache::CompilerVersion(compiler_path);
+	std::remove(compiler_path.c_str());
+
+	BOOST_CHECK_EQUAL(version_4.find(compiler_path), 0U);
+	BOOST_CHECK(version_4 != compiler_path);
+	BOOST_CHECK(version_4 != version_8);
+}
+
+BOOST_AUTO_TEST_CASE(ShaderCacheRoundTrip)
+{
+	ShaderCache cache;
+	cache.Directory(TEST_CACHE_DIR);
+
+	ShaderCacheKey const key = MakeKey("round trip", "test_compiler");
+	std::vector<uint8_t> code(100);
+	for (size_t i = 0; i < code.size(); ++ i)
+	{
+		code[i] = static_cast<uint8_t>(i * 7);
+	}
+	std::string const warnings = "(3,5): warning X3206: implicit truncation of vector type";
+
+	std::vector<uint8_t> cached_code;
+	std::string cached_msgs;
+	std::remove(EntryPath(key).c_str());
+	BOOST_CHECK(!cache.Lookup(key, cached_code, cached_msgs));
+
+	cache.Insert(key, &code[0], code.size(), warnings);
+	BOOST_CHECK(cache.Lookup(key, cached_code, cached_msgs));
+	BOOST_CHECK(cached_code == code);
+	BOOST_CHECK_EQUAL(cached_msgs, warnings);
+
+	// Replacing an existing entry
+	cache.Insert(key, &code[0], code.size(), "");
+	BOOST_CHECK(cache.Lookup(key, cached_code, cached_msgs));
+	BOOST_CHECK(cached_code == code);
+	BOOST_CHECK(cached_msgs.empty());
+
+	std::remove(EntryPath(key).c_str());
+
+	// A turned off cache stores nothing
+	ShaderCache off_cache;
+	off_cache.Directory("");
+	off_cache.Insert(key, &code[0], code.size(), warnings);
+	BOOST_CHECK(!off_cache.Lookup(key, cached_code, cached_msgs));
+	BOOST_CHECK(!FileExists(EntryPath(key)));
+}
+
+BOOST_AUTO_TEST_CASE(ShaderCacheRejectsPartialEntries)
+{
+	ShaderCache cache;
+	cache.Directory(TEST_CACHE_DIR);
+
+	ShaderCacheKey const key = MakeKey("partial", "test_compiler");
+	std::vector<uint8_t> cached_code;
+	std::string cached_msgs;
+
+	// Version 1 entries have no messages
+	uint8_t const old_entry[] =
+	{
+		'K', 'S', 'C', ' ',
+		1, 0, 0, 0,
+		4, 0, 0, 0, 0, 0, 0, 0,
+		1, 2, 3, 4
+	};
+	WriteFile(EntryPath(key), old_entry, sizeof(old_entry));
+	BOOST_CHECK(!cache.Lookup(key, cached_code, cached_msgs));
+
+	// Truncated in the code
+	uint8_t const truncated_code[] =
+	{
+		'K', 'S', 'C', ' ',
+		2, 0, 0, 0,
+		16, 0, 0, 0, 0, 0, 0, 0,
+		1, 2, 3, 4
+	};
+	WriteFile(EntryPath(key), truncated_code, sizeof(truncated_code));
+	BOOST_CHECK(!cache.Lookup(key, cached_code, cached_msgs));
+
+	// Truncated in the messages
+	uint8_t const truncated_msgs[] =
+	{
+		'K', 'S', 'C', ' ',
+		2, 0, 0, 0,
+		4, 0, 0, 0, 0, 0, 0, 0,
+		1, 2, 3, 4,
+		8, 0, 0, 0,
+		'w', 'a'
+	};
+	WriteFile(EntryPath(key), truncated_msgs, sizeof(truncated_msgs));
+	BOOST_CHECK(!cache.Lookup(key, cached_code, cached_msgs));
+
+	uint8_t const complete[] =
+	{
+		'K', 'S', 'C', ' ',
+		2, 0, 0, 0,
+		4, 0, 0, 0, 0, 0, 0, 0,
+		1, 2, 3, 4,
+		2, 0, 0, 0,
+		'w', 'a'
+	};
+	WriteFile(EntryPath(key), complete, sizeof(complete));
+	BOOST_CHECK(cache.Lookup(key, cached_code, cached_msgs));
+	BOOST_CHECK_EQUAL(cached_code.size(), 4U);
+	BOOST_CHECK_EQUAL(cached_msgs, "wa");
+
+	std::remove(EntryPath(key).c_str());
+}
+
+BOOST_AUTO_TEST_CASE(ShaderCacheEviction)
+{
+	uint32_t const NUM_ENTRIES = 16;
+	size_t const CODE_SIZE = 1000;
+	uint64_t const MAX_SIZE = 4096;
+
+	// Stands for an entry another process is writing
+	std::string const foreign_tmp = TEST_CACHE_DIR + "/0123456789abcdef0123456789abcdef.1.0.tmp";
+
+	ShaderCache cache;
+	cache.Directory(TEST_CACHE_DIR);
+	cache.MaxSize(MAX_SIZE);
+
+	std::vector<uint8_t> code(CODE_SIZE, 0xCD);
+	WriteFile(foreign_tmp, &code[0], code.size());
+
+	std::vector<ShaderCacheKey> keys;
+	for (uint32_t i = 0; i < NUM_ENTRIES; ++ i)
+	{
+		ShaderCacheKey key = MakeKey("eviction", "test_compiler");
+		key.Append(i);
+		keys.push_back(key);
+		cache.Insert(key, &code[0], code.size(), "");
+	}
+
+	uint32_t num_alive = 0;
+	for (uint32_t i = 0; i < NUM_ENTRIES; ++ i)
+	{
+		std::vector<uint8_t> cached_code;
+		std::string cached_msgs;
+		if (cache.Lookup(keys[i], cached_code, cached_msgs))
+		{
+			BOOST_CHECK(cached_code == code);
+			++ num_alive;
+		}
+	}
+	BOOST_CHECK(num_alive > 0);
+	BOOST_CHECK(num_alive < NUM_ENTRIES);
+	BOOST_CHECK(num_alive * (CODE_SIZE + 20) <= MAX_SIZE);
+
+	BOOST_CHECK(FileExists(foreign_tmp));
+
+	std::remove(foreign_tmp.c_str());
+	for (uint32_t i = 0; i < NUM_ENTRIES; ++ i)
+	{
+		std::remove(EntryPath(keys[i]).c_str());
+	}
+}
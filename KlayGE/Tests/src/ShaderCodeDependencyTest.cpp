@@ -0,0 +1,167 @@
+#include <KlayGE/KlayGE.hpp>
+#include <KlayGE/ShaderCodeDependency.hpp>
+
+#include <boost/test/unit_test.hpp>
+
+#include <vector>
+#include <string>
+
+using namespace std;
+using namespace KlayGE;
+
+namespace
+{
+	// All the reachable items, joined
+	std::string Reachable(std::string const & code, std::string const & func_name)
+	{
+		std::vector<std::string> items;
+		ShaderCodeDependency(code).ReachableCode(func_name, items);
+		std::string ret;
+		for (size_t i = 0; i < items.size(); ++ i)
+		{
+			ret += items[i];
+		}
+		return ret;
+	}
+
+	bool Contains(std::string const & str, std::string const & sub)
+	{
+		return str.find(sub) != std::string::npos;
+	}
+}
+
+BOOST_AUTO_TEST_CASE(ShaderCodeDependencyUnusedFunctions)
+{
+	std::string const code =
+		"float4 Used(float4 v)\n"
+		"{\n"
+		"	return v * 2;\n"
+		"}\n"
+		"float4 Unused(float4 v)\n"
+		"{\n"
+		"	return v * 3;\n"
+		"}\n"
+		"float4 MainPS(float4 v : TEXCOORD0) : SV_Target\n"
+		"{\n"
+		"	return Used(v);\n"
+		"}\n";
+
+	std::string const ps = Reachable(code, "MainPS");
+	BOOST_CHECK(Contains(ps, "MainPS"));
+	BOOST_CHECK(Contains(ps, "v * 2"));
+	BOOST_CHECK(!Contains(ps, "Unused"));
+
+	std::string const unused = Reachable(code, "Unused");
+	BOOST_CHECK(Contains(unused, "v * 3"));
+	BOOST_CHECK(!Contains(unused, "MainPS"));
+	BOOST_CHECK(!Contains(unused, "v * 2"));
+}
+
+BOOST_AUTO_TEST_CASE(ShaderCodeDependencyTransitiveCalls)
+{
+	std::string const code =
+		"float Leaf(float x) { return x + 1; }\n"
+		"float Middle(float x) { return Leaf(x) * 2; }\n"
+		"float Other(float x) { return x - 1; }\n"
+		"float MainVS(float x) { return Middle(x); }\n";
+
+	std::string const vs = Reachable(code, "MainVS");
+	BOOST_CHECK(Contains(vs, "Middle"));
+	BOOST_CHECK(Contains(vs, "x + 1"));
+	BOOST_CHECK(!Contains(vs, "Other"));
+
+	std::string const leaf = Reachable(code, "Leaf");
+	BOOST_CHECK(Contains(leaf, "x + 1"));
+	BOOST_CHECK(!Contains(leaf, "Middle"));
+}
+
+BOOST_AUTO_TEST_CASE(ShaderCodeDependencyStructsAndVariables)
+{
+	std::string const code =
+		"struct VSOut\n"
+		"{\n"
+		"	float4 pos : SV_Position;\n"
+		"};\n"
+		"struct Unrelated\n"
+		"{\n"
+		"	float unrelated_member;\n"
+		"};\n"
+		"static const float scale = 0.5f;\n"
+		"static const float other_scale = 0.25f;\n"
+		"VSOut MainVS(float4 pos : POSITION)\n"
+		"{\n"
+		"	VSOut opt;\n"
+		"	opt.pos = pos * scale;\n"
+		"	return opt;\n"
+		"}\n";
+
+	std::string const vs = Reachable(code, "MainVS");
+	BOOST_CHECK(Contains(vs, "SV_Position"));
+	BOOST_CHECK(Contains(vs, "0.5f"));
+	BOOST_CHECK(!Contains(vs, "unrelated_member"));
+	BOOST_CHECK(!Contains(vs, "0.25f"));
+}
+
+BOOST_AUTO_TEST_CASE(ShaderCodeDependencyComments)
+{
+	std::string const code =
+		"float Helper() { return 1; }\n"
+		"// float Commented() { return Helper(); }\n"
+		"/* Helper(); */\n"
+		"float MainPS() : SV_Target\n"
+		"{\n"
+		"	// Helper();\n"
+		"	/* return Helper(); */\n"
+		"	return 0;\n"
+		"}\n";
+
+	// Identifiers in comments are not calls
+	std::string const ps = Reachable(code, "MainPS");
+	BOOST_CHECK(Contains(ps, "MainPS"));
+	BOOST_CHECK(!Contains(ps, "return 1"));
+
+	std::string const commented = Reachable(code, "Commented");
+	BOOST_CHECK(!Contains(commented, "return 1"));
+}
+
+BOOST_AUTO_TEST_CASE(ShaderCodeDependencyPreprocessor)
+{
+	std::string const code =
+		"#include \"Lighting.fxml\"\n"
+		"#define SCALE(x) \\\n"
+		"	((x) * FromMacro())\n"
+		"float FromMacro() { return 2; }\n"
+		"float Unused() { return 3; }\n"
+		"#if USE_FOG\n"
+		"float MainPS() : SV_Target { return SCALE(1); }\n"
+		"#endif\n";
+
+	// Preprocessor lines are kept for all stages, with the items they name
+	std::string const ps = Reachable(code, "MainPS");
+	BOOST_CHECK(Contains(ps, "#include \"Lighting.fxml\""));
+	BOOST_CHECK(Contains(ps, "#define SCALE(x)"));
+	BOOST_CHECK(Contains(ps, "((x) * FromMacro())"));
+	BOOST_CHECK(Contains(ps, "#if USE_FOG"));
+	BOOST_CHECK(Contains(ps, "#endif"));
+	BOOST_CHECK(Contains(ps, "return 2"));
+	BOOST_CHECK(!Contains(ps, "return 3"));
+
+	std::string const other = Reachable(code, "Unused");
+	BOOST_CHECK(Contains(other, "#define SCALE(x)"));
+	BOOST_CHECK(Contains(other, "return 3"));
+}
+
+BOOST_AUTO_TEST_CASE(ShaderCodeDependencyCodeOrder)
+{
+	std::string const code =
+		"float A() { return 1; }\n"
+		"float B() { return A(); }\n"
+		"float C() { return B(); }\n";
+
+	std::vector<std::string> items;
+	ShaderCodeDependency(code).ReachableCode("C", items);
+	BOOST_REQUIRE_EQUAL(items.size(), 3U);
+	BOOST_CHECK(Contains(items[0], "float A()"));
+	BOOST_CHECK(Contains(items[1], "float B()"));
+	BOOST_CHECK(Contains(items[2], "float C()"));
+}
@@ -32,12 +32,19 @@
 #include <KlayGE/Context.hpp>
 #include <KlayGE/ResLoader.hpp>
 #include <KFL/XMLDom.hpp>
+#include <KFL/Thread.hpp>
+#include <KFL/CpuInfo.hpp>
+#include <DXBC2GLSL/DXBC2GLSL.hpp>
 
 #include <iostream>
 #include <fstream>
 #include <sstream>
 #include <vector>
 #include <cstring>
+#include <algorithm>
+
+#include <boost/algorithm/string/split.hpp>
+#include <boost/algorithm/string/trim.hpp>
 
 #include <boost/algorithm/string/case_conv.hpp>
 
@@ -67,7 +74,7 @@ extern "C"
 }
 #endif
 
-uint32_t const KFX_VERSION = 0x0106;
+uint32_t const KFX_VERSION = 0x0107;
 
 int RetrieveAttrValue(XMLNodePtr node, std::string const & attr_name, int default_value)
 {
@@ -156,140 +163,379 @@ Offline::OfflineRenderDeviceCaps LoadPlatformConfig(std::string const & platform
 	return caps;
 }
 
-int main(int argc, char* argv[])
+std::string PlatformName(std::string const & platform_alias)
 {
-	if (argc < 2)
+	std::string platform = platform_alias;
+	if ("pc_dx11" == platform)
 	{
-		cout << "Usage: FXMLJIT pc_dx11|pc_dx10|pc_dx9|win_tegra3|pc_gl4|pc_gl3|pc_gl2|android_tegra3|ios xxx.fxml [target folder]" << endl;
-		return 1;
+		platform = "d3d_11_0";
+	}
+	else if ("pc_dx10" == platform)
+	{
+		platform = "d3d_10_0";
+	}
+	else if ("pc_dx9" == platform)
+	{
+		platform = "d3d_9_3";
+	}
+	else if ("win_tegra3" == platform)
+	{
+		platform = "d3d_9_1";
+	}
+	else if ("pc_gl4" == platform)
+	{
+		platform = "gl_4_0";
+	}
+	else if ("pc_gl3" == platform)
+	{
+		platform = "gl_3_0";
+	}
+	else if ("pc_gl2" == platform)
+	{
+		platform = "gl_2_0";
+	}
+	else if ("android_tegra3" == platform)
+	{
+		platform = "gles_2_0";
+	}
+	else if ("ios" == platform)
+	{
+		platform = "gles_2_0";
 	}
 
-	ResLoader::Instance().AddPath("../../Tools/media/PlatformDeployer");
+	boost::algorithm::to_lower(platform);
+	return platform;
+}
+
+bool KfxUpToDate(std::string const & fxml_name, filesystem::path const & kfx_path, Offline::OfflineRenderDeviceCaps const & caps)
+{
+	if (!filesystem::exists(kfx_path))
+	{
+		return false;
+	}
+
+	ResIdentifierPtr source = ResLoader::Instance().Open(fxml_name);
+	ResIdentifierPtr kfx_source = ResLoader::Instance().Open(kfx_path.string());
+	if (!source || !kfx_source)
+	{
+		return false;
+	}
+
+	uint64_t src_timestamp = source->Timestamp();
+
+	uint32_t fourcc;
+	kfx_source->read(&fourcc, sizeof(fourcc));
+	fourcc = LE2Native(fourcc);
+
+	uint32_t ver;
+	kfx_source->read(&ver, sizeof(ver));
+	ver = LE2Native(ver);
+
+	if ((MakeFourCC<'K', 'F', 'X', ' '>::value == fourcc) && (KFX_VERSION == ver))
+	{
+		uint32_t shader_fourcc;
+		kfx_source->read(&shader_fourcc, sizeof(shader_fourcc));
+		shader_fourcc = LE2Native(shader_fourcc);
+
+		uint32_t shader_ver;
+		kfx_source->read(&shader_ver, sizeof(shader_ver));
+		shader_ver = LE2Native(shader_ver);
+
+		if ((caps.native_shader_fourcc == shader_fourcc) && (caps.native_shader_version == shader_ver))
+		{
+			uint64_t timestamp;
+			kfx_source->read(&timestamp, sizeof(timestamp));
+			timestamp = LE2Native(timestamp);
+			if (src_timestamp <= timestamp)
+			{
+				uint16_t num_includes;
+				kfx_source->read(&num_includes, sizeof(num_includes));
+				num_includes = LE2Native(num_includes);
+				for (uint32_t i = 0; i < num_includes; ++ i)
+				{
+					std::string include_name = ReadShortString(kfx_source);
+					uint64_t include_timestamp;
+					kfx_source->read(&include_timestamp, sizeof(include_timestamp));
+					include_timestamp = LE2Native(include_timestamp);
+
+					ResIdentifierPtr include_source = ResLoader::Instance().Open(include_name);
+					if (include_source && (include_source->Timestamp() != include_timestamp))
+					{
+						return false;
+					}
+				}
+
+				return true;
+			}
+		}
+	}
+
+	return false;
+}
+
+filesystem::path KfxPath(std::string const & fxml_name)
+{
+	filesystem::path fxml_path(fxml_name);
+#ifdef KLAYGE_TR2_LIBRARY_FILESYSTEM_V2_SUPPORT
+	std::string const base_name = fxml_path.stem();
+#else
+	std::string const base_name = fxml_path.stem().string();
+#endif
+	return fxml_path.parent_path() / filesystem::path(base_name + ".kfx");
+}
+
+// Compiles an effect if its kfx is out of date, and copies the kfx to the target folder. Returns the final kfx path.
+filesystem::path CompileEffect(std::string const & fxml_name, Offline::OfflineRenderDeviceCaps const & caps,
+	filesystem::path const & target_folder)
+{
+	filesystem::path kfx_path = KfxPath(fxml_name);
+	if (!KfxUpToDate(fxml_name, kfx_path, caps))
+	{
+		Offline::RenderEffect effect(caps);
+		effect.Load(fxml_name);
+	}
+	if (!target_folder.empty())
+	{
+		filesystem::path target_path = target_folder / kfx_path.filename();
+		filesystem::copy_file(kfx_path, target_path,
+#ifdef KLAYGE_TR2_LIBRARY_FILESYSTEM_V3_SUPPORT
+			filesystem::copy_options::overwrite_existing);
+#else
+			filesystem::copy_option::overwrite_if_exists);
+#endif
+		kfx_path = target_path;
+	}
 
-	std::string platform = argv[1];
+	return kfx_path;
+}
 
-	if (("pc_dx11" == platform) || ("pc_dx10" == platform) || ("pc_dx9" == platform) || ("win_tegra3" == platform)
-		|| ("pc_gl4" == platform) || ("pc_gl3" == platform) || ("pc_gl2" == platform)
-		|| ("android_tegra3" == platform) || ("ios" == platform))
+bool WildcardMatch(char const * pattern, char const * str)
+{
+	for (; *pattern != '\0'; ++ pattern, ++ str)
 	{
-		if ("pc_dx11" == platform)
+		if ('*' == *pattern)
 		{
-			platform = "d3d_11_0";
+			for (char const * s = str; ; ++ s)
+			{
+				if (WildcardMatch(pattern + 1, s))
+				{
+					return true;
+				}
+				if ('\0' == *s)
+				{
+					return false;
+				}
+			}
+		}
+		if (('\0' == *str) || ((*pattern != '?') && (*pattern != *str)))
+		{
+			return false;
 		}
-		else if ("pc_dx10" == platform)
+	}
+	return '\0' == *str;
+}
+
+// Expands @list files, one name per line, and wildcards in the file name part
+void ExpandInputNames(std::string const & input, std::vector<std::string>& fxml_names)
+{
+	if ('@' == input[0])
+	{
+		std::ifstream ifs(input.substr(1).c_str());
+		std::string line;
+		while (std::getline(ifs, line))
 		{
-			platform = "d3d_10_0";
+			boost::algorithm::trim(line);
+			if (!line.empty())
+			{
+				ExpandInputNames(line, fxml_names);
+			}
 		}
-		else if ("pc_dx9" == platform)
+	}
+	else if (input.find_first_of("*?") != std::string::npos)
+	{
+		filesystem::path pattern_path(input);
+		filesystem::path directory = pattern_path.parent_path();
+		if (directory.empty())
 		{
-			platform = "d3d_9_3";
+			directory = ".";
 		}
-		else if ("win_tegra3" == platform)
+		std::string const pattern = pattern_path.filename().string();
+
+		if (filesystem::exists(directory))
 		{
-			platform = "d3d_9_1";
+			for (filesystem::directory_iterator iter(directory); iter != filesystem::directory_iterator(); ++ iter)
+			{
+				std::string const file_name = iter->path().filename().string();
+				if (filesystem::is_regular_file(iter->path()) && WildcardMatch(pattern.c_str(), file_name.c_str()))
+				{
+					fxml_names.push_back((directory / file_name).string());
+				}
+			}
 		}
-		else if ("pc_gl4" == platform)
+	}
+	else
+	{
+		fxml_names.push_back(input);
+	}
+}
+
+class CompileEffectsFunc
+{
+public:
+	CompileEffectsFunc(std::vector<std::string> const & fxml_names, Offline::OfflineRenderDeviceCaps const & caps,
+			filesystem::path const & target_folder, atomic<uint32_t>& next_effect, mutex& output_mutex)
+		: fxml_names_(&fxml_names), caps_(&caps), target_folder_(&target_folder),
+			next_effect_(&next_effect), output_mutex_(&output_mutex)
+	{
+	}
+
+	void operator()()
+	{
+		for (;;)
 		{
-			platform = "gl_4_0";
+			uint32_t const i = (*next_effect_) ++;
+			if (i >= fxml_names_->size())
+			{
+				break;
+			}
+
+			filesystem::path kfx_path = CompileEffect((*fxml_names_)[i], *caps_, *target_folder_);
+
+			lock_guard<mutex> lock(*output_mutex_);
+			cout << "Compiled kfx has been saved to " << kfx_path << "." << endl;
 		}
-		else if ("pc_gl3" == platform)
+	}
+
+private:
+	std::vector<std::string> const * fxml_names_;
+	Offline::OfflineRenderDeviceCaps const * caps_;
+	filesystem::path const * target_folder_;
+	atomic<uint32_t>* next_effect_;
+	mutex* output_mutex_;
+};
+
+// Batch mode, all the effects for all the platforms in one process. Effects are compiled in parallel, and the
+//  shaders they have in common are compiled once, through the shader cache.
+int BatchMain(int argc, char* argv[])
+{
+	std::vector<std::string> platforms;
+	std::vector<std::string> fxml_names;
+	filesystem::path target_folder;
+	uint32_t num_jobs = static_cast<uint32_t>(CPUInfo().NumHWThreads());
+	for (int i = 2; i < argc; ++ i)
+	{
+		std::string const arg = argv[i];
+		if (("-o" == arg) && (i + 1 < argc))
 		{
-			platform = "gl_3_0";
+			++ i;
+			target_folder = argv[i];
 		}
-		else if ("pc_gl2" == platform)
+		else if (("-j" == arg) && (i + 1 < argc))
 		{
-			platform = "gl_2_0";
+			++ i;
+			num_jobs = std::max(atoi(argv[i]), 1);
 		}
-		else if ("android_tegra3" == platform)
+		else if (platforms.empty())
 		{
-			platform = "gles_2_0";
+			boost::algorithm::split(platforms, arg, boost::is_any_of(","));
 		}
-		else if ("ios" == platform)
+		else
 		{
-			platform = "gles_2_0";
+			ExpandInputNames(arg, fxml_names);
 		}
 	}
 
-	boost::algorithm::to_lower(platform);
-
-	filesystem::path target_folder;
-	if (argc >= 4)
+	std::sort(fxml_names.begin(), fxml_names.end());
+	fxml_names.erase(std::unique(fxml_names.begin(), fxml_names.end()), fxml_names.end());
+	if (platforms.empty() || fxml_names.empty())
 	{
-		target_folder = argv[3];
+		cout << "No effect to compile." << endl;
+		return 1;
 	}
 
-	Offline::OfflineRenderDeviceCaps caps = LoadPlatformConfig(platform);
-
-	std::string fxml_name(argv[2]);
-	filesystem::path fxml_path(fxml_name);
-#ifdef KLAYGE_TR2_LIBRARY_FILESYSTEM_V2_SUPPORT
-	std::string const base_name = fxml_path.stem();
-#else
-	std::string const base_name = fxml_path.stem().string();
-#endif
-	filesystem::path fxml_directory = fxml_path.parent_path();
-	ResLoader::Instance().AddPath(fxml_directory.string());
-
-	filesystem::path kfx_name(base_name + ".kfx");
-	filesystem::path kfx_path = fxml_directory / kfx_name;
-	bool skip_jit = false;
-	if (filesystem::exists(kfx_path))
+	// Paths are added up front, ResLoader is only read by the workers
+	for (size_t i = 0; i < fxml_names.size(); ++ i)
 	{
-		ResIdentifierPtr source = ResLoader::Instance().Open(fxml_name);
-		ResIdentifierPtr kfx_source = ResLoader::Instance().Open(kfx_path.string());
-
-		uint64_t src_timestamp = source->Timestamp();
-
-		uint32_t fourcc;
-		kfx_source->read(&fourcc, sizeof(fourcc));
-		fourcc = LE2Native(fourcc);
+		ResLoader::Instance().AddPath(filesystem::path(fxml_names[i]).parent_path().string());
+	}
 
-		uint32_t ver;
-		kfx_source->read(&ver, sizeof(ver));
-		ver = LE2Native(ver);
+	// The kfx is written next to the fxml, so platforms are done one by one
+	for (size_t p = 0; p < platforms.size(); ++ p)
+	{
+		Offline::OfflineRenderDeviceCaps caps = LoadPlatformConfig(PlatformName(platforms[p]));
 
-		if ((MakeFourCC<'K', 'F', 'X', ' '>::value == fourcc) && (KFX_VERSION == ver))
+		filesystem::path platform_target_folder = target_folder;
+		if (!target_folder.empty() && (platforms.size() > 1))
 		{
-			uint32_t shader_fourcc;
-			kfx_source->read(&shader_fourcc, sizeof(shader_fourcc));
-			shader_fourcc = LE2Native(shader_fourcc);
+			platform_target_folder /= caps.platform;
+		}
+		if (!platform_target_folder.empty())
+		{
+			filesystem::create_directories(platform_target_folder);
+		}
 
-			uint32_t shader_ver;
-			kfx_source->read(&shader_ver, sizeof(shader_ver));
-			shader_ver = LE2Native(shader_ver);
+		atomic<uint32_t> next_effect(0);
+		mutex output_mutex;
+		uint32_t const num_workers = std::min(num_jobs, static_cast<uint32_t>(fxml_names.size()));
 
-			if ((caps.native_shader_fourcc == shader_fourcc) && (caps.native_shader_version == shader_ver))
-			{
-				uint64_t timestamp;
-				kfx_source->read(&timestamp, sizeof(timestamp));
-				timestamp = LE2Native(timestamp);
-				if (src_timestamp <= timestamp)
-				{
-					skip_jit = true;
-				}
-			}
+		thread_pool& tp = Context::Instance().ThreadPool();
+		std::vector<joiner<void> > joiners;
+		for (uint32_t i = 1; i < num_workers; ++ i)
+		{
+			joiners.push_back(tp(CompileEffectsFunc(fxml_names, caps, platform_target_folder, next_effect, output_mutex)));
 		}
+		CompileEffectsFunc(fxml_names, caps, platform_target_folder, next_effect, output_mutex)();
+		for (size_t i = 0; i < joiners.size(); ++ i)
+		{
+			joiners[i]();
+		}
+
+		// The translations are for this platform's GLSL version
+		DXBC2GLSL::DXBC2GLSL::ClearCache();
 	}
 
-	if (!skip_jit)
+	return 0;
+}
+
+int main(int argc, char* argv[])
+{
+	if (argc < 3)
 	{
-		Offline::RenderEffect effect(caps);
-		effect.Load(fxml_name);
+		cout << "Usage: FXMLJIT pc_dx11|pc_dx10|pc_dx9|win_tegra3|pc_gl4|pc_gl3|pc_gl2|android_tegra3|ios xxx.fxml [target folder]" << endl;
+		cout << "       FXMLJIT -b platform[,platform...] xxx.fxml|dir/*.fxml|@list.txt ... [-o target folder] [-j jobs]" << endl;
+		return 1;
 	}
-	if (!target_folder.empty())
+
+	ResLoader::Instance().AddPath("../../Tools/media/PlatformDeployer");
+
+	int ret;
+	if (0 == strcmp(argv[1], "-b"))
 	{
-		filesystem::copy_file(kfx_path, target_folder / kfx_name,
-#ifdef KLAYGE_TR2_LIBRARY_FILESYSTEM_V3_SUPPORT
-			filesystem::copy_options::overwrite_existing);
-#else
-			filesystem::copy_option::overwrite_if_exists);
-#endif
-		kfx_path = target_folder / kfx_name;
+		ret = BatchMain(argc, argv);
 	}
+	else
+	{
+		std::string const platform = PlatformName(argv[1]);
+
+		filesystem::path target_folder;
+		if (argc >= 4)
+		{
+			target_folder = argv[3];
+		}
+
+		Offline::OfflineRenderDeviceCaps caps = LoadPlatformConfig(platform);
 
-	cout << "Compiled kfx has been saved to " << kfx_path << "." << endl;
+		std::string fxml_name(argv[2]);
+		ResLoader::Instance().AddPath(filesystem::path(fxml_name).parent_path().string());
+
+		filesystem::path kfx_path = CompileEffect(fxml_name, caps, target_folder);
+
+		cout << "Compiled kfx has been saved to " << kfx_path << "." << endl;
+
+		ret = 0;
+	}
 
 	Context::Destroy();
 
-	return 0;
+	return ret;
 }
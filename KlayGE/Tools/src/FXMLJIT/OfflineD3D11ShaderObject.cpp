@@ -35,6 +35,7 @@
 #include <KFL/Math.hpp>
 #include <KFL/COMPtr.hpp>
 #include <KFL/ResIdentifier.hpp>
+#include <KlayGE/ShaderCache.hpp>
 
 #include <string>
 #include <map>
@@ -93,6 +94,7 @@ public:
 			DynamicD3DCompile_ = reinterpret_cast<D3DCompileFunc>(::GetProcAddress(mod_d3dcompiler_, "D3DCompile"));
 			DynamicD3DReflect_ = reinterpret_cast<D3DReflectFunc>(::GetProcAddress(mod_d3dcompiler_, "D3DReflect"));
 			DynamicD3DStripShader_ = reinterpret_cast<D3DStripShaderFunc>(::GetProcAddress(mod_d3dcompiler_, "D3DStripShader"));
+			compiler_version_ = KlayGE::ShaderCache::CompilerVersion(static_cast<void*>(mod_d3dcompiler_));
 		}
 		else
 		{
@@ -126,6 +128,11 @@ public:
 		return DynamicD3DStripShader_(pShaderBytecode, BytecodeLength, uStripFlags, ppStrippedBlob);
 	}
 
+	std::string const & CompilerVersion() const
+	{
+		return compiler_version_;
+	}
+
 private:
 	typedef HRESULT(WINAPI *D3DCompileFunc)(LPCVOID pSrcData, SIZE_T SrcDataSize, LPCSTR pSourceName,
 		D3D_SHADER_MACRO const * pDefines, ID3DInclude* pInclude, LPCSTR pEntrypoint,
@@ -139,6 +146,8 @@ private:
 	D3DCompileFunc DynamicD3DCompile_;
 	D3DReflectFunc DynamicD3DReflect_;
 	D3DStripShaderFunc DynamicD3DStripShader_;
+
+	std::string compiler_version_;
 };
 
 D3DCompilerInit d3dcompiler;
@@ -848,10 +857,9 @@ namespace KlayGE
 			}
 			shader_code_[type].second = shader_profile;
 
-			ID3DBlob* code = nullptr;
+			std::vector<uint8_t> code;
 			if (is_shader_validate_[type])
 			{
-				ID3DBlob* err_msg;
 				std::vector<D3D_SHADER_MACRO> macros;
 				{
 					D3D_SHADER_MACRO macro_d3d11 = { "KLAYGE_D3D11", "1" };
@@ -949,16 +957,37 @@ namespace KlayGE
 #if !defined(KLAYGE_DEBUG)
 				flags |= D3DCOMPILE_OPTIMIZATION_LEVEL3;
 #endif
-				d3dcompiler.D3DCompile(shader_text.c_str(), static_cast<UINT>(shader_text.size()), nullptr, &macros[0],
-					nullptr, sd.func_name.c_str(), shader_profile.c_str(),
-					flags, 0, &code, &err_msg);
-				if (err_msg != nullptr)
+				ShaderCacheKey key;
+				key.Append(shader_text).AppendMacros(&macros[0]).Append(sd.func_name).Append(shader_profile)
+					.Append(flags).Append(d3dcompiler.CompilerVersion());
+				std::string err_msgs;
+				if (!ShaderCache::Instance().Lookup(key, code, err_msgs))
+				{
+					ID3DBlob* code_blob = nullptr;
+					ID3DBlob* err_msg = nullptr;
+					d3dcompiler.D3DCompile(shader_text.c_str(), static_cast<UINT>(shader_text.size()), nullptr, &macros[0],
+						nullptr, sd.func_name.c_str(), shader_profile.c_str(),
+						flags, 0, &code_blob, &err_msg);
+					if (err_msg != nullptr)
+					{
+						err_msgs = static_cast<char const *>(err_msg->GetBufferPointer());
+						err_msg->Release();
+					}
+					if (code_blob)
+					{
+						uint8_t const * p = static_cast<uint8_t const *>(code_blob->GetBufferPointer());
+						code.assign(p, p + code_blob->GetBufferSize());
+						code_blob->Release();
+						ShaderCache::Instance().Insert(key, &code[0], code.size(), err_msgs);
+					}
+				}
+				if (!err_msgs.empty())
 				{
 					LogError("Error when compiling %s:", sd.func_name.c_str());
 
 					std::map<int, std::vector<std::string> > err_lines;
 					{
-						std::istringstream err_iss(static_cast<char*>(err_msg->GetBufferPointer()));
+						std::istringstream err_iss(err_msgs);
 						std::string err_str;
 						while (err_iss)
 						{
@@ -1039,14 +1068,12 @@ namespace KlayGE
 							LogError(msg.c_str());
 						}
 					}
-
-					err_msg->Release();
 				}
 
-				if (code)
+				if (!code.empty())
 				{
 					ID3D11ShaderReflection* reflection;
-					d3dcompiler.D3DReflect(code->GetBufferPointer(), code->GetBufferSize(),
+					d3dcompiler.D3DReflect(&code[0], code.size(),
 						IID_ID3D11ShaderReflection_47, reinterpret_cast<void**>(&reflection));
 					if (reflection != nullptr)
 					{
@@ -1193,24 +1220,24 @@ namespace KlayGE
 					}
 
 					ID3DBlob* strip_code = nullptr;
-					d3dcompiler.D3DStripShader(code->GetBufferPointer(), code->GetBufferSize(),
+					d3dcompiler.D3DStripShader(&code[0], code.size(),
 						D3DCOMPILER_STRIP_REFLECTION_DATA | D3DCOMPILER_STRIP_DEBUG_INFO
 						| D3DCOMPILER_STRIP_TEST_BLOBS | D3DCOMPILER_STRIP_PRIVATE_DATA,
 						&strip_code);
 					if (strip_code)
 					{
-						code->Release();
-						code = strip_code;
+						uint8_t const * p = static_cast<uint8_t const *>(strip_code->GetBufferPointer());
+						code.assign(p, p + strip_code->GetBufferSize());
+						strip_code->Release();
 					}
 				}
 			}
 
 			shared_ptr<std::vector<uint8_t> > ret;
-			if (code)
+			if (!code.empty())
 			{
-				ret = MakeSharedPtr<std::vector<uint8_t> >(code->GetBufferSize());
-				std::memcpy(&((*ret)[0]), code->GetBufferPointer(), code->GetBufferSize());
-				code->Release();
+				ret = MakeSharedPtr<std::vector<uint8_t> >();
+				ret->swap(code);
 			}
 
 			return ret;
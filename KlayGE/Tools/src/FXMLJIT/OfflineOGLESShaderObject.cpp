@@ -33,10 +33,13 @@
 #include <KFL/Util.hpp>
 #include <KFL/ResIdentifier.hpp>
 #include <KFL/Math.hpp>
+#include <KFL/Thread.hpp>
 #include <KlayGE/ResLoader.hpp>
+#include <KlayGE/ShaderCache.hpp>
 
 #include <cstdio>
 #include <string>
+#include <map>
 #include <algorithm>
 #include <sstream>
 #include <fstream>
@@ -125,6 +128,20 @@ namespace
 	using namespace KlayGE::Offline;
 
 #if !(defined(KLAYGE_PLATFORM_ANDROID) || defined(KLAYGE_PLATFORM_IOS))
+	class DXBC2GLSLIniter;
+
+	// FXMLJIT compiles effects from multiple threads in batch mode. These are in namespace scope rather than
+	// function-local statics, whose initialization isn't thread-safe on all the compilers.
+	mutex dxbc2glsl_initer_mutex;
+	// One for each version, the platforms of a batch can target different ones
+	std::map<uint32_t, shared_ptr<DXBC2GLSLIniter> > dxbc2glsl_initers;
+
+#ifndef KLAYGE_PLATFORM_WINDOWS
+	// The one-time wineserver start
+	mutex wineserver_mutex;
+	bool wineserver_started = false;
+#endif
+
 	class DXBC2GLSLIniter
 	{
 	public:
@@ -137,8 +154,13 @@ namespace
 
 		static DXBC2GLSLIniter& Instance(OfflineRenderDeviceCaps const & caps)
 		{
-			static DXBC2GLSLIniter initer(caps);
-			return initer;
+			lock_guard<mutex> lock(dxbc2glsl_initer_mutex);
+			shared_ptr<DXBC2GLSLIniter>& initer = dxbc2glsl_initers[(caps.major_version << 8) | caps.minor_version];
+			if (!initer)
+			{
+				initer = shared_ptr<DXBC2GLSLIniter>(new DXBC2GLSLIniter(caps));
+			}
+			return *initer;
 		}
 
 		HRESULT D3DCompile(std::string const & src_data,
@@ -146,6 +168,27 @@ namespace
 			std::string const & target, uint32_t flags1, uint32_t flags2,
 			std::vector<uint8_t>& code, std::string& error_msgs) const
 		{
+			ShaderCacheKey key;
+			key.Append(src_data).AppendMacros(defines).Append(entry_point).Append(target)
+				.Append(flags1).Append(flags2).Append(compiler_version_);
+			if (ShaderCache::Instance().Lookup(key, code, error_msgs))
+			{
+				return 0;
+			}
+
+			HRESULT hr = this->D3DCompileNoCache(src_data, defines, entry_point, target, flags1, flags2, code, error_msgs);
+			if (!code.empty())
+			{
+				ShaderCache::Instance().Insert(key, &code[0], code.size(), error_msgs);
+			}
+			return hr;
+		}
+
+		HRESULT D3DCompileNoCache(std::string const & src_data,
+			D3D_SHADER_MACRO const * defines, std::string const & entry_point,
+			std::string const & target, uint32_t flags1, uint32_t flags2,
+			std::vector<uint8_t>& code, std::string& error_msgs) const
+		{
 #ifdef CALL_D3DCOMPILER_DIRECTLY
 			ID3DBlob* code_blob = nullptr;
 			ID3DBlob* error_msgs_blob = nullptr;
@@ -212,14 +255,17 @@ namespace
 #ifdef KLAYGE_PLATFORM_WINDOWS
 			ss << d3dcompiler_wrapper_name << ".exe";
 #else
-			static bool first = true;
-			if (first)
 			{
-				ss << WINE_PATH << "wineserver -p";
-				system(ss.str().c_str());
-				// We should hold on a persistant wineserver, or XCode will lost connection after wineserver instance close and wine may not be able to find '.exe.so' file
-				first = false;
-				ss.str(std::string());
+				// Effects are compiled from multiple threads in batch mode
+				lock_guard<mutex> lock(wineserver_mutex);
+				if (!wineserver_started)
+				{
+					ss << WINE_PATH << "wineserver -p";
+					system(ss.str().c_str());
+					// We should hold on a persistant wineserver, or XCode will lost connection after wineserver instance close and wine may not be able to find '.exe.so' file
+					wineserver_started = true;
+					ss.str(std::string());
+				}
 			}
 			d3dcompiler_wrapper_name += ".exe.so";
 			std::string wrapper_path = ResLoader::Instance().Locate(d3dcompiler_wrapper_name);
@@ -285,6 +331,13 @@ namespace
 			__assume(mod_d3dcompiler_ != nullptr);
 #endif
 			DynamicD3DCompile_ = reinterpret_cast<D3DCompileFunc>(::GetProcAddress(mod_d3dcompiler_, "D3DCompile"));
+			compiler_version_ = ShaderCache::CompilerVersion(static_cast<void*>(mod_d3dcompiler_));
+#else
+			std::string d3dcompiler_wrapper_name = "D3DCompilerWrapper";
+#ifdef KLAYGE_DEBUG
+			d3dcompiler_wrapper_name += "_d";
+#endif
+			compiler_version_ = ShaderCache::CompilerVersion(ResLoader::Instance().Locate(d3dcompiler_wrapper_name + ".exe.so"));
 #endif
 
 			switch (caps.major_version)
@@ -319,6 +372,7 @@ namespace
 		D3DCompileFunc DynamicD3DCompile_;
 #endif
 		GLSLVersion gsv_;
+		std::string compiler_version_;
 	};
 #endif
 }
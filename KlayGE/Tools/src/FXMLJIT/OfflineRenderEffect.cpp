@@ -67,7 +67,7 @@ namespace
 	using namespace KlayGE;
 	using namespace KlayGE::Offline;
 
-	uint32_t const KFX_VERSION = 0x0106;
+	uint32_t const KFX_VERSION = 0x0107;
 
 	mutex singleton_mutex;
 
@@ -2194,14 +2194,18 @@ namespace KlayGE
 				std::vector<std::string> include_names;
 				this->RecursiveIncludeNode(root, include_names);
 
+				includes_.clear();
 				typedef KLAYGE_DECLTYPE(include_names) IncludeNamesType;
 				KLAYGE_FOREACH(IncludeNamesType::const_reference include_name, include_names)
 				{
+					uint64_t include_timestamp = 0;
 					ResIdentifierPtr include_source = ResLoader::Instance().Open(include_name);
 					if (include_source)
 					{
-						timestamp_ = std::max(timestamp_, include_source->Timestamp());
+						include_timestamp = include_source->Timestamp();
+						timestamp_ = std::max(timestamp_, include_timestamp);
 					}
+					includes_.push_back(std::make_pair(include_name, include_timestamp));
 				}
 
 				shader_descs_.reset();
@@ -2401,6 +2405,17 @@ namespace KlayGE
 			uint64_t timestamp = Native2LE(timestamp_);
 			os.write(reinterpret_cast<char const *>(&timestamp), sizeof(timestamp));
 
+			{
+				uint16_t num_includes = Native2LE(static_cast<uint16_t>(includes_.size()));
+				os.write(reinterpret_cast<char const *>(&num_includes), sizeof(num_includes));
+				for (size_t i = 0; i < includes_.size(); ++ i)
+				{
+					WriteShortString(os, includes_[i].first);
+					uint64_t include_timestamp = Native2LE(includes_[i].second);
+					os.write(reinterpret_cast<char const *>(&include_timestamp), sizeof(include_timestamp));
+				}
+			}
+
 			{
 				uint16_t num_macros = 0;
 				if (macros_)
@@ -624,6 +624,7 @@ namespace KlayGE
 		private:
 			shared_ptr<std::string> res_name_;
 			uint64_t timestamp_;
+			std::vector<std::pair<std::string, uint64_t> > includes_;
 
 			std::vector<RenderEffectParameterPtr> params_;
 			std::vector<RenderEffectConstantBufferPtr> cbuffers_;
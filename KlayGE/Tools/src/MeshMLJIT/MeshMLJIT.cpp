@@ -2,20 +2,22 @@
 #include <KFL/Math.hpp>
 #include <KFL/Util.hpp>
 #include <KFL/XMLDom.hpp>
+#include <KFL/Thread.hpp>
+#include <KFL/CpuInfo.hpp>
+#include <KlayGE/Context.hpp>
 #include <KlayGE/ResLoader.hpp>
 #include <KlayGE/RenderLayout.hpp>
 #include <KlayGE/LZMACodec.hpp>
 #include <KlayGE/Renderable.hpp>
 #include <KlayGE/Mesh.hpp>
+#include <MeshMLLib/MeshMLLib.hpp>
 
 #include <iostream>
 #include <fstream>
 #include <sstream>
 #include <vector>
 #include <cstring>
-
-#include <boost/algorithm/string/split.hpp>
-#include <boost/algorithm/string/trim.hpp>
+#include <stdexcept>
 
 #if defined(KLAYGE_TR2_LIBRARY_FILESYSTEM_V2_SUPPORT) || defined(KLAYGE_TR2_LIBRARY_FILESYSTEM_V3_SUPPORT)
 	#include <filesystem>
@@ -78,7 +80,51 @@ namespace
 	}
 
 	std::string const JIT_EXT_NAME = ".model_bin";
-	uint32_t const MODEL_BIN_VERSION = 9;
+
+	// Meshes are compiled in parallel, their messages must not mix
+	mutex output_mutex;
+
+	// An exception escaping a task on the thread pool only reaches its joiner as std::bad_exception, so the task keeps
+	//  the message of the first error instead
+	void RunTask(function<void()> const & task, std::string& error)
+	{
+		try
+		{
+			task();
+		}
+		catch (std::exception const & e)
+		{
+			lock_guard<mutex> lock(output_mutex);
+			if (error.empty())
+			{
+				error = e.what();
+			}
+		}
+	}
+
+	// The tasks refer to the caller's locals, so all of them are waited for before an error leaves the caller
+	void JoinTasks(std::vector<joiner<void> >& joiners, std::string const & error)
+	{
+		for (size_t i = 0; i < joiners.size(); ++ i)
+		{
+			joiners[i]();
+		}
+		joiners.clear();
+
+		if (!error.empty())
+		{
+			throw std::runtime_error(error);
+		}
+	}
+
+	uint32_t const MODEL_BIN_VERSION = 11;
+
+	// Each level of detail targets half the indices of the previous one. The chain stops when a level can't get
+	//  below MIN_LOD_REDUCTION of the previous one without going beyond MAX_LOD_ERROR.
+	uint32_t const MAX_NUM_LODS = 5;
+	uint32_t const MIN_LOD_NUM_INDICES = 64 * 3;
+	float const MIN_LOD_REDUCTION = 0.8f;
+	float const MAX_LOD_ERROR = 0.05f;
 
 	struct KeyFrames
 	{
@@ -94,41 +140,60 @@ namespace
 		std::vector<AABBox> bb;
 	};
 
+	// The numbers are parsed in place, straight from the attribute's characters. A .meshml has millions of them, so
+	//  splitting the strings and converting each piece dominated the JIT time.
+
+	char const * SkipSpaces(char const * p)
+	{
+		while ((' ' == *p) || ('\t' == *p) || ('\n' == *p) || ('\r' == *p))
+		{
+			++ p;
+		}
+		return p;
+	}
+
+	// A single value attribute has to hold a number, as ValueFloat and ValueUInt required
+	void CheckNotEmpty(std::string const & value_str)
+	{
+		if (!*SkipSpaces(value_str.c_str()))
+		{
+			throw std::invalid_argument("Empty number in a meshml attribute");
+		}
+	}
+
+	float ToFloat(std::string const & value_str)
+	{
+		CheckNotEmpty(value_str);
+		float v;
+		ParseMeshMLFloat(value_str.c_str(), v);
+		return v;
+	}
+
+	uint32_t ToUInt(std::string const & value_str)
+	{
+		CheckNotEmpty(value_str);
+		uint32_t v;
+		ParseMeshMLUInt(value_str.c_str(), v);
+		return v;
+	}
+
 	template <int N>
 	void ExtractFVector(std::string const & value_str, float* v)
 	{
-		std::vector<std::string> strs;
-		boost::algorithm::split(strs, value_str, boost::is_any_of(" "));
-		for (size_t i = 0; i < N; ++ i)
+		char const * p = value_str.c_str();
+		for (int i = 0; i < N; ++ i)
 		{
-			if (i < strs.size())
-			{
-				boost::algorithm::trim(strs[i]);
-				v[i] = static_cast<float>(atof(strs[i].c_str()));
-			}
-			else
-			{
-				v[i] = 0;
-			}
+			p = ParseMeshMLFloat(p, v[i]);
 		}
 	}
 
 	template <int N>
 	void ExtractUIVector(std::string const & value_str, uint32_t* v)
 	{
-		std::vector<std::string> strs;
-		boost::algorithm::split(strs, value_str, boost::is_any_of(" "));
-		for (size_t i = 0; i < N; ++ i)
+		char const * p = value_str.c_str();
+		for (int i = 0; i < N; ++ i)
 		{
-			if (i < strs.size())
-			{
-				boost::algorithm::trim(strs[i]);
-				v[i] = static_cast<uint32_t>(atoi(strs[i].c_str()));
-			}
-			else
-			{
-				v[i] = 0;
-			}
+			p = ParseMeshMLUInt(p, v[i]);
 		}
 	}
 
@@ -146,9 +211,9 @@ namespace
 			}
 			else
 			{
-				mtl.ambient.x() = mtl_node->Attrib("ambient_r")->ValueFloat();
-				mtl.ambient.y() = mtl_node->Attrib("ambient_g")->ValueFloat();
-				mtl.ambient.z() = mtl_node->Attrib("ambient_b")->ValueFloat();
+				mtl.ambient.x() = ToFloat(mtl_node->Attrib("ambient_r")->ValueString());
+				mtl.ambient.y() = ToFloat(mtl_node->Attrib("ambient_g")->ValueString());
+				mtl.ambient.z() = ToFloat(mtl_node->Attrib("ambient_b")->ValueString());
 			}
 			attr = mtl_node->Attrib("diffuse");
 			if (attr)
@@ -157,9 +222,9 @@ namespace
 			}
 			else
 			{
-				mtl.diffuse.x() = mtl_node->Attrib("diffuse_r")->ValueFloat();
-				mtl.diffuse.y() = mtl_node->Attrib("diffuse_g")->ValueFloat();
-				mtl.diffuse.z() = mtl_node->Attrib("diffuse_b")->ValueFloat();
+				mtl.diffuse.x() = ToFloat(mtl_node->Attrib("diffuse_r")->ValueString());
+				mtl.diffuse.y() = ToFloat(mtl_node->Attrib("diffuse_g")->ValueString());
+				mtl.diffuse.z() = ToFloat(mtl_node->Attrib("diffuse_b")->ValueString());
 			}
 			attr = mtl_node->Attrib("specular");
 			if (attr)
@@ -168,9 +233,9 @@ namespace
 			}
 			else
 			{
-				mtl.specular.x() = mtl_node->Attrib("specular_r")->ValueFloat();
-				mtl.specular.y() = mtl_node->Attrib("specular_g")->ValueFloat();
-				mtl.specular.z() = mtl_node->Attrib("specular_b")->ValueFloat();
+				mtl.specular.x() = ToFloat(mtl_node->Attrib("specular_r")->ValueString());
+				mtl.specular.y() = ToFloat(mtl_node->Attrib("specular_g")->ValueString());
+				mtl.specular.z() = ToFloat(mtl_node->Attrib("specular_b")->ValueString());
 			}
 			attr = mtl_node->Attrib("emit");
 			if (attr)
@@ -179,17 +244,17 @@ namespace
 			}
 			else
 			{
-				mtl.emit.x() = mtl_node->Attrib("emit_r")->ValueFloat();
-				mtl.emit.y() = mtl_node->Attrib("emit_g")->ValueFloat();
-				mtl.emit.z() = mtl_node->Attrib("emit_b")->ValueFloat();
+				mtl.emit.x() = ToFloat(mtl_node->Attrib("emit_r")->ValueString());
+				mtl.emit.y() = ToFloat(mtl_node->Attrib("emit_g")->ValueString());
+				mtl.emit.z() = ToFloat(mtl_node->Attrib("emit_b")->ValueString());
 			}
-			mtl.opacity = mtl_node->Attrib("opacity")->ValueFloat();
+			mtl.opacity = ToFloat(mtl_node->Attrib("opacity")->ValueString());
 			attr = mtl_node->Attrib("specular_level");
 			if (attr)
 			{
-				mtl.specular *= attr->ValueFloat();
+				mtl.specular *= ToFloat(attr->ValueString());
 			}
-			mtl.shininess = mtl_node->Attrib("shininess")->ValueFloat();
+			mtl.shininess = ToFloat(mtl_node->Attrib("shininess")->ValueString());
 
 			XMLNodePtr tex_node = mtl_node->FirstNode("texture");
 			if (!tex_node)
@@ -246,9 +311,9 @@ namespace
 				else
 				{
 					XMLNodePtr pos_min_node = pos_bb_node->FirstNode("min");
-					pos_min_bb.x() = pos_min_node->Attrib("x")->ValueFloat();
-					pos_min_bb.y() = pos_min_node->Attrib("y")->ValueFloat();
-					pos_min_bb.z() = pos_min_node->Attrib("z")->ValueFloat();
+					pos_min_bb.x() = ToFloat(pos_min_node->Attrib("x")->ValueString());
+					pos_min_bb.y() = ToFloat(pos_min_node->Attrib("y")->ValueString());
+					pos_min_bb.z() = ToFloat(pos_min_node->Attrib("z")->ValueString());
 				}
 			}
 			{
@@ -260,9 +325,9 @@ namespace
 				else
 				{
 					XMLNodePtr pos_max_node = pos_bb_node->FirstNode("max");
-					pos_max_bb.x() = pos_max_node->Attrib("x")->ValueFloat();
-					pos_max_bb.y() = pos_max_node->Attrib("y")->ValueFloat();
-					pos_max_bb.z() = pos_max_node->Attrib("z")->ValueFloat();
+					pos_max_bb.x() = ToFloat(pos_max_node->Attrib("x")->ValueString());
+					pos_max_bb.y() = ToFloat(pos_max_node->Attrib("y")->ValueString());
+					pos_max_bb.z() = ToFloat(pos_max_node->Attrib("z")->ValueString());
 				}
 			}
 			pos_bb = AABBox(pos_min_bb, pos_max_bb);
@@ -288,8 +353,8 @@ namespace
 				else
 				{
 					XMLNodePtr tc_min_node = tc_bb_node->FirstNode("min");
-					tc_min_bb.x() = tc_min_node->Attrib("x")->ValueFloat();
-					tc_min_bb.y() = tc_min_node->Attrib("y")->ValueFloat();
+					tc_min_bb.x() = ToFloat(tc_min_node->Attrib("x")->ValueString());
+					tc_min_bb.y() = ToFloat(tc_min_node->Attrib("y")->ValueString());
 				}
 			}
 			{
@@ -301,8 +366,8 @@ namespace
 				else
 				{
 					XMLNodePtr tc_max_node = tc_bb_node->FirstNode("max");							
-					tc_max_bb.x() = tc_max_node->Attrib("x")->ValueFloat();
-					tc_max_bb.y() = tc_max_node->Attrib("y")->ValueFloat();
+					tc_max_bb.x() = ToFloat(tc_max_node->Attrib("x")->ValueString());
+					tc_max_bb.y() = ToFloat(tc_max_node->Attrib("y")->ValueString());
 				}
 			}
 
@@ -333,16 +398,16 @@ namespace
 				XMLAttributePtr attr = vertex_node->Attrib("x");
 				if (attr)
 				{
-					pos.x() = vertex_node->Attrib("x")->ValueFloat();
-					pos.y() = vertex_node->Attrib("y")->ValueFloat();
-					pos.z() = vertex_node->Attrib("z")->ValueFloat();
+					pos.x() = ToFloat(vertex_node->Attrib("x")->ValueString());
+					pos.y() = ToFloat(vertex_node->Attrib("y")->ValueString());
+					pos.z() = ToFloat(vertex_node->Attrib("z")->ValueString());
 
 					attr = vertex_node->Attrib("u");
 					if (attr)
 					{
 						float2 tex_coord;
-						tex_coord.x() = vertex_node->Attrib("u")->ValueFloat();
-						tex_coord.y() = vertex_node->Attrib("v")->ValueFloat();
+						tex_coord.x() = ToFloat(vertex_node->Attrib("u")->ValueString());
+						tex_coord.y() = ToFloat(vertex_node->Attrib("v")->ValueString());
 						mesh_tex_coords.push_back(tex_coord);
 					}
 				}
@@ -366,10 +431,10 @@ namespace
 				}
 				else
 				{
-					diffuse.x() = diffuse_node->Attrib("r")->ValueFloat();
-					diffuse.y() = diffuse_node->Attrib("g")->ValueFloat();
-					diffuse.z() = diffuse_node->Attrib("b")->ValueFloat();
-					diffuse.w() = diffuse_node->Attrib("a")->ValueFloat();										
+					diffuse.x() = ToFloat(diffuse_node->Attrib("r")->ValueString());
+					diffuse.y() = ToFloat(diffuse_node->Attrib("g")->ValueString());
+					diffuse.z() = ToFloat(diffuse_node->Attrib("b")->ValueString());
+					diffuse.w() = ToFloat(diffuse_node->Attrib("a")->ValueString());										
 				}
 				mesh_diffuses.push_back(diffuse);
 			}
@@ -387,9 +452,9 @@ namespace
 				}
 				else
 				{
-					specular.x() = specular_node->Attrib("r")->ValueFloat();
-					specular.y() = specular_node->Attrib("g")->ValueFloat();
-					specular.z() = specular_node->Attrib("b")->ValueFloat();
+					specular.x() = ToFloat(specular_node->Attrib("r")->ValueString());
+					specular.y() = ToFloat(specular_node->Attrib("g")->ValueString());
+					specular.z() = ToFloat(specular_node->Attrib("b")->ValueString());
 				}
 				mesh_speculars.push_back(specular);
 			}
@@ -405,8 +470,8 @@ namespace
 					XMLAttributePtr attr = tex_coord_node->Attrib("u");
 					if (attr)
 					{
-						tex_coord.x() = tex_coord_node->Attrib("u")->ValueFloat();
-						tex_coord.y() = tex_coord_node->Attrib("v")->ValueFloat();
+						tex_coord.x() = ToFloat(tex_coord_node->Attrib("u")->ValueString());
+						tex_coord.y() = ToFloat(tex_coord_node->Attrib("v")->ValueString());
 					}
 					else
 					{
@@ -434,30 +499,20 @@ namespace
 				{
 					XMLAttributePtr weight_attr = weight_node->Attrib("weight");
 
-					std::vector<std::string> index_strs;
-					std::vector<std::string> weight_strs;
-					boost::algorithm::split(index_strs, attr->ValueString(), boost::is_any_of(" "));
-					boost::algorithm::split(weight_strs, weight_attr->ValueString(), boost::is_any_of(" "));
-					
-					for (num_blend = 0; num_blend < 4; ++ num_blend)
+					char const * index_str = SkipSpaces(attr->ValueString().c_str());
+					char const * weight_str = SkipSpaces(weight_attr->ValueString().c_str());
+					for (num_blend = 0; (num_blend < 4) && *index_str && *weight_str; ++ num_blend)
 					{
-						if ((num_blend < index_strs.size()) && (num_blend < weight_strs.size()))
-						{
-							bone_index32[num_blend] = static_cast<uint32_t>(atoi(index_strs[num_blend].c_str()));
-							bone_weight32[num_blend] = static_cast<float>(atof(weight_strs[num_blend].c_str()));
-						}
-						else
-						{
-							break;
-						}
+						index_str = SkipSpaces(ParseMeshMLUInt(index_str, bone_index32[num_blend]));
+						weight_str = SkipSpaces(ParseMeshMLFloat(weight_str, bone_weight32[num_blend]));
 					}
 				}
 				else
 				{
 					while (weight_node && (num_blend < 4))
 					{
-						bone_index32[num_blend] = weight_node->Attrib("bone_index")->ValueUInt();
-						bone_weight32[num_blend] = weight_node->Attrib("weight")->ValueFloat();
+						bone_index32[num_blend] = ToUInt(weight_node->Attrib("bone_index")->ValueString());
+						bone_weight32[num_blend] = ToFloat(weight_node->Attrib("weight")->ValueString());
 
 						weight_node = weight_node->NextSibling("weight");
 						++ num_blend;
@@ -491,9 +546,9 @@ namespace
 				}
 				else
 				{
-					normal.x() = normal_node->Attrib("x")->ValueFloat();
-					normal.y() = normal_node->Attrib("y")->ValueFloat();
-					normal.z() = normal_node->Attrib("z")->ValueFloat();
+					normal.x() = ToFloat(normal_node->Attrib("x")->ValueString());
+					normal.y() = ToFloat(normal_node->Attrib("y")->ValueString());
+					normal.z() = ToFloat(normal_node->Attrib("z")->ValueString());
 				}
 				mesh_normals.push_back(normal);
 			}
@@ -511,13 +566,13 @@ namespace
 				}
 				else
 				{
-					tangent.x() = tangent_node->Attrib("x")->ValueFloat();
-					tangent.y() = tangent_node->Attrib("y")->ValueFloat();
-					tangent.z() = tangent_node->Attrib("z")->ValueFloat();
+					tangent.x() = ToFloat(tangent_node->Attrib("x")->ValueString());
+					tangent.y() = ToFloat(tangent_node->Attrib("y")->ValueString());
+					tangent.z() = ToFloat(tangent_node->Attrib("z")->ValueString());
 					attr = tangent_node->Attrib("w");
 					if (attr)
 					{
-						tangent.w() = attr->ValueFloat();
+						tangent.w() = ToFloat(attr->ValueString());
 					}
 					else
 					{
@@ -540,9 +595,9 @@ namespace
 				}
 				else
 				{
-					binormal.x() = binormal_node->Attrib("x")->ValueFloat();
-					binormal.y() = binormal_node->Attrib("y")->ValueFloat();
-					binormal.z() = binormal_node->Attrib("z")->ValueFloat();
+					binormal.x() = ToFloat(binormal_node->Attrib("x")->ValueString());
+					binormal.y() = ToFloat(binormal_node->Attrib("y")->ValueString());
+					binormal.z() = ToFloat(binormal_node->Attrib("z")->ValueString());
 				}
 				mesh_binormals.push_back(binormal);
 			}
@@ -560,10 +615,10 @@ namespace
 				}
 				else
 				{
-					tangent_quat.x() = tangent_quat_node->Attrib("x")->ValueFloat();
-					tangent_quat.y() = tangent_quat_node->Attrib("y")->ValueFloat();
-					tangent_quat.z() = tangent_quat_node->Attrib("z")->ValueFloat();
-					tangent_quat.w() = tangent_quat_node->Attrib("w")->ValueFloat();
+					tangent_quat.x() = ToFloat(tangent_quat_node->Attrib("x")->ValueString());
+					tangent_quat.y() = ToFloat(tangent_quat_node->Attrib("y")->ValueString());
+					tangent_quat.z() = ToFloat(tangent_quat_node->Attrib("z")->ValueString());
+					tangent_quat.w() = ToFloat(tangent_quat_node->Attrib("w")->ValueString());
 				}
 				mesh_tangent_quats.push_back(tangent_quat);
 			}
@@ -824,9 +879,9 @@ namespace
 			}
 			else
 			{
-				ind[0] = tri_node->Attrib("a")->ValueUInt();
-				ind[1] = tri_node->Attrib("b")->ValueUInt();
-				ind[2] = tri_node->Attrib("c")->ValueUInt();
+				ind[0] = ToUInt(tri_node->Attrib("a")->ValueString());
+				ind[1] = ToUInt(tri_node->Attrib("b")->ValueString());
+				ind[2] = ToUInt(tri_node->Attrib("c")->ValueString());
 			}
 			mesh_triangle_indices.push_back(ind[0]);
 			mesh_triangle_indices.push_back(ind[1]);
@@ -1031,8 +1086,11 @@ namespace
 	}
 
 	void AppendMeshIndices(std::vector<uint8_t> const & triangle_indices, char is_index_16s,
+		std::vector<std::vector<uint32_t> > const & lod_indices,
 		std::vector<uint32_t>& mesh_num_indices,
 		std::vector<uint32_t>& mesh_start_indices,
+		std::vector<std::vector<uint32_t> >& mesh_lod_num_indices,
+		std::vector<std::vector<uint32_t> >& mesh_lod_start_indices,
 		std::vector<uint8_t>& merged_indices,
 		char& is_index_16_bit)
 	{
@@ -1041,9 +1099,21 @@ namespace
 		uint32_t num_indices = static_cast<uint32_t>(triangle_indices.size() / (is_index_16s ? 2 : 4));
 		uint32_t start_indicees = mesh_start_indices.back();
 		mesh_num_indices.push_back(num_indices);
-		mesh_start_indices.push_back(start_indicees + num_indices);
 
-		merged_indices.resize(merged_indices.size() + num_indices * 4);
+		// The coarser levels of detail follow the mesh's own indices
+		mesh_lod_num_indices.push_back(std::vector<uint32_t>());
+		mesh_lod_start_indices.push_back(std::vector<uint32_t>());
+		uint32_t lod_start_indices = start_indicees + num_indices;
+		for (size_t lod = 0; lod < lod_indices.size(); ++ lod)
+		{
+			uint32_t const lod_num_indices = static_cast<uint32_t>(lod_indices[lod].size());
+			mesh_lod_num_indices.back().push_back(lod_num_indices);
+			mesh_lod_start_indices.back().push_back(lod_start_indices);
+			lod_start_indices += lod_num_indices;
+		}
+		mesh_start_indices.push_back(lod_start_indices);
+
+		merged_indices.resize(mesh_start_indices.back() * 4);
 
 		for (uint32_t ind_index = 0; ind_index < num_indices; ++ ind_index)
 		{
@@ -1059,6 +1129,244 @@ namespace
 					&triangle_indices[ind_index * sizeof(uint32_t)], sizeof(uint32_t));
 			}
 		}
+		for (size_t lod = 0; lod < lod_indices.size(); ++ lod)
+		{
+			if (!lod_indices[lod].empty())
+			{
+				std::memcpy(&merged_indices[mesh_lod_start_indices.back()[lod] * 4],
+					&lod_indices[lod][0], lod_indices[lod].size() * sizeof(uint32_t));
+			}
+		}
+	}
+
+	// Simplifies each level of detail from the previous one, down to half of its indices
+	void GenerateMeshLods(std::vector<uint32_t> const & indices, std::vector<float3> const & positions,
+		std::vector<std::vector<uint32_t> >& lod_indices)
+	{
+		lod_indices.clear();
+
+		std::vector<uint32_t> const * prev_indices = &indices;
+		for (uint32_t lod = 1; lod < MAX_NUM_LODS; ++ lod)
+		{
+			uint32_t const prev_num_indices = static_cast<uint32_t>(prev_indices->size());
+			if (prev_num_indices < MIN_LOD_NUM_INDICES)
+			{
+				break;
+			}
+
+			std::vector<uint32_t> simplified;
+			SimplifyMesh(&(*prev_indices)[0], prev_num_indices,
+				&positions[0], static_cast<uint32_t>(positions.size()),
+				prev_num_indices / 6 * 3, MAX_LOD_ERROR, simplified);
+			if (simplified.size() > prev_num_indices * MIN_LOD_REDUCTION)
+			{
+				break;
+			}
+
+			lod_indices.push_back(std::vector<uint32_t>());
+			lod_indices.back().swap(simplified);
+			prev_indices = &lod_indices.back();
+		}
+	}
+
+	template <typename T>
+	void RemapVertexAttrib(std::vector<T>& attrib, uint32_t num_components, std::vector<uint32_t> const & remap)
+	{
+		if (!attrib.empty())
+		{
+			std::vector<T> remapped(attrib.size());
+			for (uint32_t i = 0; i < remap.size(); ++ i)
+			{
+				std::copy(attrib.begin() + i * num_components, attrib.begin() + (i + 1) * num_components,
+					remapped.begin() + remap[i] * num_components);
+			}
+			attrib.swap(remapped);
+		}
+	}
+
+	// Generates the levels of detail, reorders the triangles of each of them for the vertex cache and overdraw, then
+	//  the vertices in the order the finest level fetches them
+	void OptimizeMeshVertexCache(std::string const & mesh_name, AABBox const & pos_bb,
+		std::vector<int16_t>& positions, std::vector<uint32_t>& normals,
+		std::vector<uint32_t>& tangent_quats, 
+		std::vector<uint32_t>& diffuses, std::vector<uint32_t>& speculars,
+		std::vector<int16_t>& tex_coords, 
+		std::vector<uint32_t>& bone_indices, std::vector<uint32_t>& bone_weights,
+		std::vector<uint8_t>& triangle_indices, char is_index_16s,
+		std::vector<std::vector<uint32_t> >& lod_indices, bool quiet)
+	{
+		lod_indices.clear();
+
+		uint32_t const num_vertices = static_cast<uint32_t>(positions.size() / 4);
+		uint32_t const num_indices = static_cast<uint32_t>(triangle_indices.size() / (is_index_16s ? 2 : 4));
+		if ((0 == num_vertices) || (num_indices < 6))
+		{
+			return;
+		}
+
+		std::vector<uint32_t> indices(num_indices);
+		if (is_index_16s)
+		{
+			for (uint32_t i = 0; i < num_indices; ++ i)
+			{
+				indices[i] = *reinterpret_cast<uint16_t const *>(&triangle_indices[i * sizeof(uint16_t)]);
+			}
+		}
+		else
+		{
+			std::memcpy(&indices[0], &triangle_indices[0], triangle_indices.size());
+		}
+
+		float3 const pos_center = pos_bb.Center();
+		float3 const pos_extent = pos_bb.HalfSize();
+		std::vector<float3> mesh_positions(num_vertices);
+		for (uint32_t i = 0; i < num_vertices; ++ i)
+		{
+			float3 const pos((positions[i * 4 + 0] + 32768) / 65535.0f, (positions[i * 4 + 1] + 32768) / 65535.0f,
+				(positions[i * 4 + 2] + 32768) / 65535.0f);
+			mesh_positions[i] = (pos - 0.5f) * 2 * pos_extent + pos_center;
+		}
+
+		VertexCacheStats const old_stats = AnalyzeVertexCache(&indices[0], num_indices, num_vertices);
+
+		GenerateMeshLods(indices, mesh_positions, lod_indices);
+
+		OptimizeTriangleOrder(&indices[0], num_indices, num_vertices, &mesh_positions[0]);
+		std::vector<uint32_t> remap;
+		OptimizeVertexFetch(&indices[0], num_indices, num_vertices, remap);
+		for (size_t lod = 0; lod < lod_indices.size(); ++ lod)
+		{
+			std::vector<uint32_t>& lod_ind = lod_indices[lod];
+			OptimizeTriangleOrder(&lod_ind[0], static_cast<uint32_t>(lod_ind.size()), num_vertices, &mesh_positions[0]);
+			for (size_t i = 0; i < lod_ind.size(); ++ i)
+			{
+				lod_ind[i] = remap[lod_ind[i]];
+			}
+		}
+
+		VertexCacheStats const new_stats = AnalyzeVertexCache(&indices[0], num_indices, num_vertices);
+		if (!quiet)
+		{
+			lock_guard<mutex> lock(output_mutex);
+
+			cout << "Mesh " << mesh_name << ": ACMR " << old_stats.acmr << " -> " << new_stats.acmr
+				<< ", ATVR " << old_stats.atvr << " -> " << new_stats.atvr << endl;
+			if (!lod_indices.empty())
+			{
+				cout << "Mesh " << mesh_name << ": " << lod_indices.size() + 1 << " LODs, " << num_indices;
+				for (size_t lod = 0; lod < lod_indices.size(); ++ lod)
+				{
+					cout << " -> " << lod_indices[lod].size();
+				}
+				cout << " indices" << endl;
+			}
+		}
+
+		RemapVertexAttrib(positions, 4, remap);
+		RemapVertexAttrib(normals, 1, remap);
+		RemapVertexAttrib(tangent_quats, 1, remap);
+		RemapVertexAttrib(diffuses, 1, remap);
+		RemapVertexAttrib(speculars, 1, remap);
+		RemapVertexAttrib(tex_coords, 2, remap);
+		RemapVertexAttrib(bone_indices, 1, remap);
+		RemapVertexAttrib(bone_weights, 1, remap);
+
+		if (is_index_16s)
+		{
+			for (uint32_t i = 0; i < num_indices; ++ i)
+			{
+				*reinterpret_cast<uint16_t*>(&triangle_indices[i * sizeof(uint16_t)]) = static_cast<uint16_t>(indices[i]);
+			}
+		}
+		else
+		{
+			std::memcpy(&triangle_indices[0], &indices[0], triangle_indices.size());
+		}
+	}
+
+	struct CompiledMesh
+	{
+		std::string name;
+		int32_t mtl_id;
+		AABBox pos_bb;
+		AABBox tc_bb;
+
+		bool has_vertices;
+		std::vector<vertex_element> ves;
+		std::vector<int16_t> positions;
+		std::vector<uint32_t> normals;
+		std::vector<uint32_t> tangent_quats;
+		std::vector<uint32_t> diffuses;
+		std::vector<uint32_t> speculars;
+		std::vector<int16_t> tex_coords;
+		std::vector<uint32_t> bone_indices;
+		std::vector<uint32_t> bone_weights;
+
+		bool has_triangles;
+		std::vector<uint8_t> triangle_indices;
+		char is_index_16s;
+		std::vector<std::vector<uint32_t> > lod_indices;
+	};
+
+	void CompileMesh(XMLNodePtr const & mesh_node, CompiledMesh& mesh, bool quiet)
+	{
+		mesh.name = mesh_node->Attrib("name")->ValueString();
+		mesh.mtl_id = mesh_node->Attrib("mtl_id")->ValueInt();
+
+		XMLNodePtr vertices_chunk = mesh_node->FirstNode("vertices_chunk");
+		mesh.has_vertices = vertices_chunk ? true : false;
+		if (vertices_chunk)
+		{
+			CompileMeshesVerticesChunk(vertices_chunk,
+				mesh.pos_bb, mesh.tc_bb, mesh.ves,
+				mesh.positions, mesh.normals, mesh.tangent_quats,
+				mesh.diffuses, mesh.speculars, mesh.tex_coords,
+				mesh.bone_indices, mesh.bone_weights);
+		}
+
+		mesh.is_index_16s = true;
+
+		XMLNodePtr triangles_chunk = mesh_node->FirstNode("triangles_chunk");
+		mesh.has_triangles = triangles_chunk ? true : false;
+		if (triangles_chunk)
+		{
+			CompileMeshesTrianglesChunk(triangles_chunk,
+				mesh.triangle_indices, mesh.is_index_16s);
+		}
+
+		if (vertices_chunk && triangles_chunk)
+		{
+			OptimizeMeshVertexCache(mesh.name, mesh.pos_bb,
+				mesh.positions, mesh.normals, mesh.tangent_quats,
+				mesh.diffuses, mesh.speculars, mesh.tex_coords,
+				mesh.bone_indices, mesh.bone_weights,
+				mesh.triangle_indices, mesh.is_index_16s, mesh.lod_indices, quiet);
+		}
+	}
+
+	// Meshes are independent until they are merged, each worker takes the next one left
+	void CompileMeshesFunc(std::vector<XMLNodePtr> const & mesh_nodes, std::vector<CompiledMesh>& meshes,
+		atomic<uint32_t>& next_mesh, bool quiet)
+	{
+		for (;;)
+		{
+			uint32_t const mesh_index = next_mesh ++;
+			if (mesh_index >= mesh_nodes.size())
+			{
+				break;
+			}
+
+			try
+			{
+				CompileMesh(mesh_nodes[mesh_index], meshes[mesh_index], quiet);
+			}
+			catch (...)
+			{
+				// The other workers stop after their current mesh
+				next_mesh = static_cast<uint32_t>(mesh_nodes.size());
+				throw;
+			}
+		}
 	}
 
 	void CompileMeshesChunk(XMLNodePtr const & meshes_chunk,
@@ -1066,8 +1374,10 @@ namespace
 		std::vector<AABBox>& pos_bbs, std::vector<AABBox>& tc_bbs, 
 		std::vector<uint32_t>& mesh_num_vertices, std::vector<uint32_t>& mesh_base_vertices,
 		std::vector<uint32_t>& mesh_num_indices, std::vector<uint32_t>& mesh_start_indices,
+		std::vector<std::vector<uint32_t> >& mesh_lod_num_indices,
+		std::vector<std::vector<uint32_t> >& mesh_lod_start_indices,
 		std::vector<vertex_element>& merged_ves, std::vector<std::vector<uint8_t> >& merged_vertices,
-		std::vector<uint8_t>& merged_indices, char& is_index_16_bit)
+		std::vector<uint8_t>& merged_indices, char& is_index_16_bit, bool quiet)
 	{
 		mesh_names.clear();
 		mtl_ids.clear();
@@ -1076,70 +1386,69 @@ namespace
 		mesh_num_indices.clear();
 		mesh_base_vertices.assign(1, 0);
 		mesh_start_indices.assign(1, 0);
+		mesh_lod_num_indices.clear();
+		mesh_lod_start_indices.clear();
 		merged_ves.clear();
 		merged_vertices.clear();
 		merged_indices.clear();
 		is_index_16_bit = true;
 
-		std::vector<vertex_element> ves;
-		std::vector<int16_t> positions;
-		std::vector<uint32_t> normals;
-		std::vector<uint32_t> tangent_quats;
-		std::vector<uint32_t> diffuses;
-		std::vector<uint32_t> speculars;
-		std::vector<int16_t> tex_coords;
-		std::vector<uint32_t> bone_indices;
-		std::vector<uint32_t> bone_weights;
-		std::vector<uint8_t> triangle_indices;
-		char is_index_16s;
+		std::vector<XMLNodePtr> mesh_nodes;
+		for (XMLNodePtr mesh_node = meshes_chunk->FirstNode("mesh"); mesh_node; mesh_node = mesh_node->NextSibling("mesh"))
+		{
+			mesh_nodes.push_back(mesh_node);
+		}
 
-		uint32_t mesh_index = 0;
-		for (XMLNodePtr mesh_node = meshes_chunk->FirstNode("mesh"); mesh_node; mesh_node = mesh_node->NextSibling("mesh"), ++ mesh_index)
-		{
-			mesh_names.push_back(mesh_node->Attrib("name")->ValueString());
-			mtl_ids.push_back(mesh_node->Attrib("mtl_id")->ValueInt());
-
-			pos_bbs.resize(mesh_index + 1);
-			tc_bbs.resize(pos_bbs.size());
-
-			ves.clear();
-			positions.clear();
-			normals.clear();
-			tangent_quats.clear();
-			diffuses.clear();
-			speculars.clear();
-			tex_coords.clear();
-			bone_indices.clear();
-			bone_weights.clear();
-
-			XMLNodePtr vertices_chunk = mesh_node->FirstNode("vertices_chunk");
-			if (vertices_chunk)
-			{
-				CompileMeshesVerticesChunk(vertices_chunk,
-					pos_bbs[mesh_index], tc_bbs[mesh_index], ves,
-					positions, normals,	tangent_quats,
-					diffuses, speculars, tex_coords,
-					bone_indices, bone_weights);
-				AppendMeshVertices(ves,
-					positions, normals, tangent_quats, 
-					diffuses, speculars, tex_coords, 
-					bone_indices, bone_weights,
-					mesh_num_vertices, mesh_base_vertices,
-					merged_ves, merged_vertices);
+		std::vector<CompiledMesh> meshes(mesh_nodes.size());
+		{
+			atomic<uint32_t> next_mesh(0);
+			uint32_t const num_workers = std::min(static_cast<uint32_t>(CPUInfo().NumHWThreads()),
+				static_cast<uint32_t>(mesh_nodes.size()));
+
+			function<void()> const compile_meshes = KlayGE::bind(CompileMeshesFunc, KlayGE::cref(mesh_nodes),
+				KlayGE::ref(meshes), KlayGE::ref(next_mesh), quiet);
+			std::string error;
+
+			thread_pool& tp = Context::Instance().ThreadPool();
+			std::vector<joiner<void> > joiners;
+			for (uint32_t i = 1; i < num_workers; ++ i)
+			{
+				joiners.push_back(tp(KlayGE::bind(RunTask, compile_meshes, KlayGE::ref(error))));
 			}
+			RunTask(compile_meshes, error);
+			JoinTasks(joiners, error);
+		}
+
+		pos_bbs.resize(meshes.size());
+		tc_bbs.resize(meshes.size());
+		for (size_t mesh_index = 0; mesh_index < meshes.size(); ++ mesh_index)
+		{
+			CompiledMesh& mesh = meshes[mesh_index];
 
-			triangle_indices.clear();
-			is_index_16s = true;
+			mesh_names.push_back(mesh.name);
+			mtl_ids.push_back(mesh.mtl_id);
+			pos_bbs[mesh_index] = mesh.pos_bb;
+			tc_bbs[mesh_index] = mesh.tc_bb;
 
-			XMLNodePtr triangles_chunk = mesh_node->FirstNode("triangles_chunk");
-			if (triangles_chunk)
+			if (mesh.has_vertices)
+			{
+				AppendMeshVertices(mesh.ves,
+					mesh.positions, mesh.normals, mesh.tangent_quats, 
+					mesh.diffuses, mesh.speculars, mesh.tex_coords, 
+					mesh.bone_indices, mesh.bone_weights,
+					mesh_num_vertices, mesh_base_vertices,
+					merged_ves, merged_vertices);
+			}
+			if (mesh.has_triangles)
 			{
-				CompileMeshesTrianglesChunk(triangles_chunk,
-					triangle_indices, is_index_16s);
-				AppendMeshIndices(triangle_indices, is_index_16s,
-					mesh_num_indices, mesh_start_indices, merged_indices,
-					is_index_16_bit);
+				AppendMeshIndices(mesh.triangle_indices, mesh.is_index_16s, mesh.lod_indices,
+					mesh_num_indices, mesh_start_indices,
+					mesh_lod_num_indices, mesh_lod_start_indices,
+					merged_indices, is_index_16_bit);
 			}
+
+			// Merged already, the memory can go
+			mesh = CompiledMesh();
 		}
 
 		if (is_index_16_bit)
@@ -1167,12 +1476,12 @@ namespace
 			XMLNodePtr bind_pos_node = bone_node->FirstNode("bind_pos");
 			if (bind_pos_node)
 			{
-				float3 bind_pos(bind_pos_node->Attrib("x")->ValueFloat(), bind_pos_node->Attrib("y")->ValueFloat(),
-					bind_pos_node->Attrib("z")->ValueFloat());
+				float3 bind_pos(ToFloat(bind_pos_node->Attrib("x")->ValueString()), ToFloat(bind_pos_node->Attrib("y")->ValueString()),
+					ToFloat(bind_pos_node->Attrib("z")->ValueString()));
 
 				XMLNodePtr bind_quat_node = bone_node->FirstNode("bind_quat");
-				Quaternion bind_quat(bind_quat_node->Attrib("x")->ValueFloat(), bind_quat_node->Attrib("y")->ValueFloat(),
-					bind_quat_node->Attrib("z")->ValueFloat(), bind_quat_node->Attrib("w")->ValueFloat());
+				Quaternion bind_quat(ToFloat(bind_quat_node->Attrib("x")->ValueString()), ToFloat(bind_quat_node->Attrib("y")->ValueString()),
+					ToFloat(bind_quat_node->Attrib("z")->ValueString()), ToFloat(bind_quat_node->Attrib("w")->ValueString()));
 
 				float scale = MathLib::length(bind_quat);
 				bind_quat /= scale;
@@ -1194,10 +1503,10 @@ namespace
 				}
 				else
 				{
-					joint.bind_real.x() = bind_real_node->Attrib("x")->ValueFloat();
-					joint.bind_real.y() = bind_real_node->Attrib("y")->ValueFloat();
-					joint.bind_real.z() = bind_real_node->Attrib("z")->ValueFloat();
-					joint.bind_real.w() = bind_real_node->Attrib("w")->ValueFloat();
+					joint.bind_real.x() = ToFloat(bind_real_node->Attrib("x")->ValueString());
+					joint.bind_real.y() = ToFloat(bind_real_node->Attrib("y")->ValueString());
+					joint.bind_real.z() = ToFloat(bind_real_node->Attrib("z")->ValueString());
+					joint.bind_real.w() = ToFloat(bind_real_node->Attrib("w")->ValueString());
 				}
 
 				XMLNodePtr bind_dual_node = bone_node->FirstNode("dual");
@@ -1212,10 +1521,10 @@ namespace
 				}
 				else
 				{
-					joint.bind_dual.x() = bind_dual_node->Attrib("x")->ValueFloat();
-					joint.bind_dual.y() = bind_dual_node->Attrib("y")->ValueFloat();
-					joint.bind_dual.z() = bind_dual_node->Attrib("z")->ValueFloat();
-					joint.bind_dual.w() = bind_dual_node->Attrib("w")->ValueFloat();
+					joint.bind_dual.x() = ToFloat(bind_dual_node->Attrib("x")->ValueString());
+					joint.bind_dual.y() = ToFloat(bind_dual_node->Attrib("y")->ValueString());
+					joint.bind_dual.z() = ToFloat(bind_dual_node->Attrib("z")->ValueString());
+					joint.bind_dual.w() = ToFloat(bind_dual_node->Attrib("w")->ValueString());
 				}
 			}
 
@@ -1267,12 +1576,12 @@ namespace
 				XMLNodePtr pos_node = key_node->FirstNode("pos");
 				if (pos_node)
 				{
-					float3 bind_pos(pos_node->Attrib("x")->ValueFloat(), pos_node->Attrib("y")->ValueFloat(),
-						pos_node->Attrib("z")->ValueFloat());
+					float3 bind_pos(ToFloat(pos_node->Attrib("x")->ValueString()), ToFloat(pos_node->Attrib("y")->ValueString()),
+						ToFloat(pos_node->Attrib("z")->ValueString()));
 
 					XMLNodePtr quat_node = key_node->FirstNode("quat");
-					bind_real = Quaternion(quat_node->Attrib("x")->ValueFloat(), quat_node->Attrib("y")->ValueFloat(),
-						quat_node->Attrib("z")->ValueFloat(), quat_node->Attrib("w")->ValueFloat());
+					bind_real = Quaternion(ToFloat(quat_node->Attrib("x")->ValueString()), ToFloat(quat_node->Attrib("y")->ValueString()),
+						ToFloat(quat_node->Attrib("z")->ValueString()), ToFloat(quat_node->Attrib("w")->ValueString()));
 
 					bind_scale = MathLib::length(bind_real);
 					bind_real /= bind_scale;
@@ -1293,10 +1602,10 @@ namespace
 					}
 					else
 					{
-						bind_real.x() = bind_real_node->Attrib("x")->ValueFloat();
-						bind_real.y() = bind_real_node->Attrib("y")->ValueFloat();
-						bind_real.z() = bind_real_node->Attrib("z")->ValueFloat();
-						bind_real.w() = bind_real_node->Attrib("w")->ValueFloat();
+						bind_real.x() = ToFloat(bind_real_node->Attrib("x")->ValueString());
+						bind_real.y() = ToFloat(bind_real_node->Attrib("y")->ValueString());
+						bind_real.z() = ToFloat(bind_real_node->Attrib("z")->ValueString());
+						bind_real.w() = ToFloat(bind_real_node->Attrib("w")->ValueString());
 					}
 							
 					XMLNodePtr bind_dual_node = key_node->FirstNode("dual");
@@ -1311,10 +1620,10 @@ namespace
 					}
 					else
 					{
-						bind_dual.x() = bind_dual_node->Attrib("x")->ValueFloat();
-						bind_dual.y() = bind_dual_node->Attrib("y")->ValueFloat();
-						bind_dual.z() = bind_dual_node->Attrib("z")->ValueFloat();
-						bind_dual.w() = bind_dual_node->Attrib("w")->ValueFloat();
+						bind_dual.x() = ToFloat(bind_dual_node->Attrib("x")->ValueString());
+						bind_dual.y() = ToFloat(bind_dual_node->Attrib("y")->ValueString());
+						bind_dual.z() = ToFloat(bind_dual_node->Attrib("z")->ValueString());
+						bind_dual.w() = ToFloat(bind_dual_node->Attrib("w")->ValueString());
 					}
 
 					bind_scale = MathLib::length(bind_real);
@@ -1370,9 +1679,9 @@ namespace
 					else
 					{
 						XMLNodePtr min_node = key_node->FirstNode("min");
-						bb_min.x() = min_node->Attrib("x")->ValueFloat();
-						bb_min.y() = min_node->Attrib("y")->ValueFloat();
-						bb_min.z() = min_node->Attrib("z")->ValueFloat();
+						bb_min.x() = ToFloat(min_node->Attrib("x")->ValueString());
+						bb_min.y() = ToFloat(min_node->Attrib("y")->ValueString());
+						bb_min.z() = ToFloat(min_node->Attrib("z")->ValueString());
 					}
 					attr = key_node->Attrib("max");
 					if (attr)
@@ -1382,9 +1691,9 @@ namespace
 					else
 					{
 						XMLNodePtr max_node = key_node->FirstNode("max");
-						bb_max.x() = max_node->Attrib("x")->ValueFloat();
-						bb_max.y() = max_node->Attrib("y")->ValueFloat();
-						bb_max.z() = max_node->Attrib("z")->ValueFloat();
+						bb_max.x() = ToFloat(max_node->Attrib("x")->ValueString());
+						bb_max.y() = ToFloat(max_node->Attrib("y")->ValueString());
+						bb_max.z() = ToFloat(max_node->Attrib("z")->ValueString());
 					}
 
 					bb_kfs.bb.push_back(AABBox(bb_min, bb_max));
@@ -1503,6 +1812,8 @@ namespace
 		std::vector<AABBox> const & pos_bbs, std::vector<AABBox> const & tc_bbs,
 		std::vector<uint32_t> const & mesh_num_vertices, std::vector<uint32_t> const & mesh_base_vertices,
 		std::vector<uint32_t> const & mesh_num_indices, std::vector<uint32_t> const & mesh_start_indices,
+		std::vector<std::vector<uint32_t> > const & mesh_lod_num_indices,
+		std::vector<std::vector<uint32_t> > const & mesh_lod_start_indices,
 		std::vector<vertex_element> const & merged_ves,
 		std::vector<std::vector<uint8_t> > const & merged_vertices, std::vector<uint8_t> const & merged_indices,
 		char is_index_16_bit, std::ostream& os)
@@ -1564,6 +1875,16 @@ namespace
 			os.write(reinterpret_cast<char*>(&ni), sizeof(ni));
 			uint32_t si = Native2LE(mesh_start_indices[mesh_index]);
 			os.write(reinterpret_cast<char*>(&si), sizeof(si));
+
+			uint32_t num_lods = Native2LE(static_cast<uint32_t>(mesh_lod_num_indices[mesh_index].size() + 1));
+			os.write(reinterpret_cast<char*>(&num_lods), sizeof(num_lods));
+			for (size_t lod = 0; lod < mesh_lod_num_indices[mesh_index].size(); ++ lod)
+			{
+				uint32_t lod_ni = Native2LE(mesh_lod_num_indices[mesh_index][lod]);
+				os.write(reinterpret_cast<char*>(&lod_ni), sizeof(lod_ni));
+				uint32_t lod_si = Native2LE(mesh_lod_start_indices[mesh_index][lod]);
+				os.write(reinterpret_cast<char*>(&lod_si), sizeof(lod_si));
+			}
 		}
 	}
 
@@ -1803,7 +2124,8 @@ namespace
 		}
 	}
 
-	void MeshMLJIT(std::string const & meshml_name, std::string const & output_name, std::string const & platform)
+	void MeshMLJIT(std::string const & meshml_name, std::string const & output_name, std::string const & platform,
+		bool quiet)
 	{
 		std::ostringstream ss;
 
@@ -1828,6 +2150,31 @@ namespace
 			ss.write(reinterpret_cast<char*>(&num_mtls), sizeof(num_mtls));
 		}
 
+		// The animation chunks don't depend on the meshes, so they are compiled meanwhile. Only the default bounding
+		//  boxes of the key frames need the meshes, those are made afterwards.
+		XMLNodePtr key_frames_chunk = root->FirstNode("key_frames_chunk");
+		XMLNodePtr bb_kfs_chunk;
+		uint32_t num_frames = 0;
+		uint32_t frame_rate = 0;
+		std::vector<KeyFrames> kfs;
+		std::vector<AABBKeyFrames> bb_kfs;
+		std::string kfs_error;
+		thread_pool& tp = Context::Instance().ThreadPool();
+		std::vector<joiner<void> > joiners;
+		if (key_frames_chunk)
+		{
+			joiners.push_back(tp(KlayGE::bind(RunTask, function<void()>(KlayGE::bind(CompileKeyFramesChunk,
+				key_frames_chunk, KlayGE::ref(num_frames), KlayGE::ref(frame_rate), KlayGE::ref(kfs))),
+				KlayGE::ref(kfs_error))));
+
+			bb_kfs_chunk = root->FirstNode("bb_key_frames_chunk");
+			if (bb_kfs_chunk)
+			{
+				joiners.push_back(tp(KlayGE::bind(RunTask, function<void()>(KlayGE::bind(CompileBBKeyFramesChunk,
+					bb_kfs_chunk, std::vector<AABBox>(), 0U, KlayGE::ref(bb_kfs))), KlayGE::ref(kfs_error))));
+			}
+		}
+
 		XMLNodePtr meshes_chunk = root->FirstNode("meshes_chunk");
 		std::vector<std::string> mesh_names;
 		std::vector<int32_t> mtl_ids;
@@ -1837,44 +2184,48 @@ namespace
 		std::vector<uint32_t> mesh_base_vertices;
 		std::vector<uint32_t> mesh_num_indices;
 		std::vector<uint32_t> mesh_start_indices;
+		std::vector<std::vector<uint32_t> > mesh_lod_num_indices;
+		std::vector<std::vector<uint32_t> > mesh_lod_start_indices;
 		std::vector<vertex_element> merged_ves;
 		std::vector<std::vector<uint8_t> > merged_vertices;
 		std::vector<uint8_t> merged_indices;
 		char is_index_16_bit = true;
-		if (meshes_chunk)
+		XMLNodePtr bones_chunk = root->FirstNode("bones_chunk");
+		std::vector<Joint> joints;
+		try
 		{
-			CompileMeshesChunk(meshes_chunk, mesh_names, mtl_ids, pos_bbs, tc_bbs,
-				mesh_num_vertices, mesh_base_vertices,
-				mesh_num_indices, mesh_start_indices,
-				merged_ves, merged_vertices, merged_indices,
-				is_index_16_bit);
+			if (meshes_chunk)
+			{
+				CompileMeshesChunk(meshes_chunk, mesh_names, mtl_ids, pos_bbs, tc_bbs,
+					mesh_num_vertices, mesh_base_vertices,
+					mesh_num_indices, mesh_start_indices,
+					mesh_lod_num_indices, mesh_lod_start_indices,
+					merged_ves, merged_vertices, merged_indices,
+					is_index_16_bit, quiet);
+			}
+			if (bones_chunk)
+			{
+				CompileBonesChunk(bones_chunk, joints);
+			}
 		}
+		catch (...)
 		{
-			uint32_t num_meshes = Native2LE(static_cast<uint32_t>(pos_bbs.size()));
-			ss.write(reinterpret_cast<char*>(&num_meshes), sizeof(num_meshes));
+			// The key frame tasks still write to the locals here
+			JoinTasks(joiners, std::string());
+			throw;
 		}
-
-		XMLNodePtr bones_chunk = root->FirstNode("bones_chunk");
-		std::vector<Joint> joints;
-		if (bones_chunk)
 		{
-			CompileBonesChunk(bones_chunk, joints);
+			uint32_t num_meshes = Native2LE(static_cast<uint32_t>(pos_bbs.size()));
+			ss.write(reinterpret_cast<char*>(&num_meshes), sizeof(num_meshes));
 		}
 		{
 			uint32_t num_joints = Native2LE(static_cast<uint32_t>(joints.size()));
 			ss.write(reinterpret_cast<char*>(&num_joints), sizeof(num_joints));
 		}
 
-		XMLNodePtr key_frames_chunk = root->FirstNode("key_frames_chunk");
-		uint32_t num_frames = 0;
-		uint32_t frame_rate = 0;
-		std::vector<KeyFrames> kfs;
-		std::vector<AABBKeyFrames> bb_kfs;
-		if (key_frames_chunk)
+		JoinTasks(joiners, kfs_error);
+		if (key_frames_chunk && !bb_kfs_chunk)
 		{
-			CompileKeyFramesChunk(key_frames_chunk, num_frames, frame_rate, kfs);
-
-			XMLNodePtr bb_kfs_chunk = root->FirstNode("bb_key_frames_chunk");
 			CompileBBKeyFramesChunk(bb_kfs_chunk, pos_bbs, num_frames, bb_kfs);
 		}
 		{
@@ -1902,6 +2253,7 @@ namespace
 		{
 			WriteMeshesChunk(mesh_names, mtl_ids, pos_bbs, tc_bbs,
 				mesh_num_vertices, mesh_base_vertices, mesh_num_indices, mesh_start_indices,
+				mesh_lod_num_indices, mesh_lod_start_indices,
 				merged_ves, merged_vertices, merged_indices, is_index_16_bit, ss);
 		}
 
@@ -2040,14 +2392,24 @@ int main(int argc, char* argv[])
 
 	std::string output_name = (target_folder / filesystem::path(file_name)).string() + JIT_EXT_NAME;
 
-	MeshMLJIT(meshml_name, output_name, platform);
+	int ret = 0;
+	try
+	{
+		MeshMLJIT(meshml_name, output_name, platform, quiet);
 
-	if (!quiet)
+		if (!quiet)
+		{
+			cout << "Binary model has been saved to " << output_name << "." << endl;
+		}
+	}
+	catch (std::exception const & e)
 	{
-		cout << "Binary model has been saved to " << output_name << "." << endl;
+		cerr << "Error: " << e.what() << endl;
+		ret = 1;
 	}
 
-	ResLoader::Destroy();
+	// The thread pool of the context was used to compile the meshes
+	Context::Destroy();
 
-	return 0;
+	return ret;
 }
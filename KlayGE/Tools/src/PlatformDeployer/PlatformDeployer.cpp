@@ -304,10 +304,17 @@ void Deploy(std::vector<std::string> const & res_names, std::string const & res_
 	}
 	else if ("effect" == res_type)
 	{
-		for (size_t i = 0; i < res_names.size(); ++ i)
+		// One batch for all the effects, so they are compiled in parallel and share the shader cache. The names go
+		//  to a list file, a command line with all of them would be too long for cmd.
 		{
-			ofs << "FXMLJIT " << caps.platform << " \"" << res_names[i] << "\"" << std::endl;
+			std::ofstream list_ofs("effects.txt");
+			for (size_t i = 0; i < res_names.size(); ++ i)
+			{
+				list_ofs << res_names[i] << std::endl;
+			}
 		}
+		ofs << "FXMLJIT -b " << caps.platform << " @effects.txt" << std::endl;
+		ofs << "del effects.txt" << std::endl;
 	}
 
 	ofs.close();
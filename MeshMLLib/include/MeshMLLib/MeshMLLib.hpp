@@ -66,6 +66,7 @@ namespace KlayGE
 			UES_None = 0,
 			UES_CombineMeshes = 0x1,
 			UES_SortMeshes = 0x2,
+			UES_OptimizeVertexCache = 0x4,
 			UES_All = 0xFF
 		};
 
@@ -131,7 +132,8 @@ namespace KlayGE
 		void SetAction(int action_id, std::string const & name, int start_frame, int end_frame);
 
 		void WriteMeshML(std::ostream& os,
-			int vertex_export_settings = VES_TangentQuat | VES_Texcoord, int user_export_settings = UES_SortMeshes,
+			int vertex_export_settings = VES_TangentQuat | VES_Texcoord,
+			int user_export_settings = UES_SortMeshes | UES_OptimizeVertexCache,
 			std::string const & encoding = std::string());
 
 	private:
@@ -236,6 +238,41 @@ namespace KlayGE
 		std::vector<Keyframes> keyframes_;
 		std::vector<AnimationAction> actions_;
 	};
+
+	struct VertexCacheStats
+	{
+		float acmr;		// Average cache miss ratio, vertices transformed per triangle, 0.5 at best
+		float atvr;		// Average transform to vertex ratio, vertices transformed per vertex, 1 at best
+	};
+
+	// Simulates a FIFO post-transform vertex cache
+	VertexCacheStats AnalyzeVertexCache(uint32_t const * indices, uint32_t num_indices, uint32_t num_vertices,
+		uint32_t cache_size = 16);
+
+	// Reorders the triangles for the post-transform vertex cache, with Forsyth's linear-speed algorithm. If positions
+	//  are given, the clusters of the ordering are then sorted from outside to inside to reduce overdraw, as in
+	//  Tipsify. Triangles inside a cluster keep their order, but the cache still goes cold between clusters, so that
+	//  order is only kept if its ACMR stays within max_acmr_ratio times the one of the cache order.
+	void OptimizeTriangleOrder(uint32_t* indices, uint32_t num_indices, uint32_t num_vertices,
+		float3 const * positions = nullptr, float max_acmr_ratio = 1.0f);
+
+	// Renumbers the vertices in the order the indices fetch them, remap[old_index] = new_index. Vertices not referenced
+	//  are moved to the end.
+	void OptimizeVertexFetch(uint32_t* indices, uint32_t num_indices, uint32_t num_vertices,
+		std::vector<uint32_t>& remap);
+
+	// Simplifies the mesh down to target_num_indices with half-edge collapses ordered by their quadric error, as in
+	//  Garland and Heckbert. Vertices only collapse onto other existing vertices, so the result indexes the same
+	//  vertex buffer. Vertices on borders and on seams where the attributes are split stay in place. Stops earlier if
+	//  the error, relative to the size of the mesh, would go beyond max_error. Returns the error reached.
+	float SimplifyMesh(uint32_t const * indices, uint32_t num_indices, float3 const * positions, uint32_t num_vertices,
+		uint32_t target_num_indices, float max_error, std::vector<uint32_t>& simplified_indices);
+
+	// Parses the next number of a whitespace separated list in a meshml attribute, and returns where the parsing
+	//  stopped. The value is 0 if the list has no number left, and std::invalid_argument is thrown if the next token
+	//  isn't a number. Floats are rounded as strtof does, but without depending on the locale in most cases.
+	char const * ParseMeshMLFloat(char const * p, float& v);
+	char const * ParseMeshMLUInt(char const * p, uint32_t& v);
 }
 
 #endif  // _MESHMLLIB_MESHMLLIB_HPP
@@ -1090,6 +1090,53 @@ namespace KlayGE
 		{
 			std::sort(meshes_.begin(), meshes_.end(), MaterialIDSortOp());
 		}
+
+		if (user_export_settings & UES_OptimizeVertexCache)
+		{
+			typedef KLAYGE_DECLTYPE(meshes_) MeshesType;
+			KLAYGE_FOREACH(MeshesType::reference mesh, meshes_)
+			{
+				if (mesh.triangles.empty())
+				{
+					continue;
+				}
+
+				uint32_t const num_vertices = static_cast<uint32_t>(mesh.vertices.size());
+				uint32_t const num_indices = static_cast<uint32_t>(mesh.triangles.size() * 3);
+
+				std::vector<uint32_t> indices(num_indices);
+				for (size_t i = 0; i < mesh.triangles.size(); ++ i)
+				{
+					for (int j = 0; j < 3; ++ j)
+					{
+						indices[i * 3 + j] = mesh.triangles[i].vertex_index[j];
+					}
+				}
+				std::vector<float3> positions(num_vertices);
+				for (size_t i = 0; i < mesh.vertices.size(); ++ i)
+				{
+					positions[i] = mesh.vertices[i].position;
+				}
+
+				OptimizeTriangleOrder(&indices[0], num_indices, num_vertices, &positions[0]);
+				std::vector<uint32_t> remap;
+				OptimizeVertexFetch(&indices[0], num_indices, num_vertices, remap);
+
+				std::vector<Vertex> vertices(num_vertices);
+				for (size_t i = 0; i < mesh.vertices.size(); ++ i)
+				{
+					vertices[remap[i]] = mesh.vertices[i];
+				}
+				mesh.vertices.swap(vertices);
+				for (size_t i = 0; i < mesh.triangles.size(); ++ i)
+				{
+					for (int j = 0; j < 3; ++ j)
+					{
+						mesh.triangles[i].vertex_index[j] = static_cast<int>(indices[i * 3 + j]);
+					}
+				}
+			}
+		}
 	}
 
 	void MeshMLObj::MatrixToDQ(float4x4 const & mat, Quaternion& real, Quaternion& dual) const
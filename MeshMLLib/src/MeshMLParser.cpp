@@ -0,0 +1,258 @@
+/**
+ * @file MeshMLParser.cpp
+ * @author Minmin Gong
+ *
+ * @section DESCRIPTION
+ *
+ * This source file is part of MeshMLLib, a subproject of KlayGE
+ * For the latest info, see http://www.klayge.org
+ *
+ * @section LICENSE
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published
+ * by the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+ *
+ * You may alternatively use this source under the terms of
+ * the KlayGE Proprietary License (KPL). You can obtained such a license
+ * from http://www.klayge.org/licensing/.
+ */
+
+#include <KFL/KFL.hpp>
+#include <MeshMLLib/MeshMLLib.hpp>
+
+#include <algorithm>
+#include <string>
+#include <cstdlib>
+#include <cstring>
+#include <cfloat>
+#include <stdexcept>
+
+namespace
+{
+	using namespace KlayGE;
+
+	bool IsSpace(char c)
+	{
+		return (' ' == c) || ('\t' == c) || ('\n' == c) || ('\r' == c);
+	}
+
+	char const * SkipSpaces(char const * p)
+	{
+		while (IsSpace(*p))
+		{
+			++ p;
+		}
+		return p;
+	}
+
+	char const * SkipToken(char const * p)
+	{
+		while (*p && !IsSpace(*p))
+		{
+			++ p;
+		}
+		return p;
+	}
+
+	void ThrowMalformed(char const * token, char const * token_end)
+	{
+		throw std::invalid_argument("Malformed number \"" + std::string(token, token_end) + "\" in a meshml attribute");
+	}
+
+	// The significand of a float has 29 bits less than the one of a double. A double with those bits at 1000...0 is
+	//  right between two floats, and converting it would round a second time.
+	bool IsFloatMidpoint(double d)
+	{
+		uint64_t bits;
+		memcpy(&bits, &d, sizeof(bits));
+		return (bits & 0x1FFFFFFFULL) == 0x10000000ULL;
+	}
+
+	// Only called for the rare numbers the fast path can't get exact. strtof depends on the locale, but the JIT tools
+	//  keep the "C" one.
+	float ParseFloatSlow(char const * token, char const * token_end)
+	{
+		std::string const str(token, token_end);
+		char* end;
+		float const v = strtof(str.c_str(), &end);
+		if (end != str.c_str() + str.size())
+		{
+			ThrowMalformed(token, token_end);
+		}
+		return v;
+	}
+}
+
+namespace KlayGE
+{
+	char const * ParseMeshMLFloat(char const * p, float& v)
+	{
+		static double const POW10[] =
+		{
+			1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11,
+			1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22
+		};
+		int const MAX_POW10 = sizeof(POW10) / sizeof(POW10[0]) - 1;
+		int const MAX_DIGITS = 19;
+		uint64_t const MAX_EXACT_MANTISSA = 1ULL << 53;
+
+		p = SkipSpaces(p);
+		if (!*p)
+		{
+			v = 0;
+			return p;
+		}
+
+		char const * const token = p;
+		char const * const token_end = SkipToken(p);
+
+		bool negative = false;
+		if (('-' == *p) || ('+' == *p))
+		{
+			negative = ('-' == *p);
+			++ p;
+		}
+
+		// Digits beyond MAX_DIGITS are dropped, the result is then inexact unless they are all 0
+		uint64_t mantissa = 0;
+		int num_digits = 0;
+		int exponent = 0;
+		bool has_digits = false;
+		bool truncated = false;
+		for (; (*p >= '0') && (*p <= '9'); ++ p)
+		{
+			has_digits = true;
+			if (num_digits < MAX_DIGITS)
+			{
+				mantissa = mantissa * 10 + (*p - '0');
+				num_digits += (mantissa != 0);
+			}
+			else
+			{
+				truncated |= (*p != '0');
+				++ exponent;
+			}
+		}
+		if ('.' == *p)
+		{
+			++ p;
+			for (; (*p >= '0') && (*p <= '9'); ++ p)
+			{
+				has_digits = true;
+				if (num_digits < MAX_DIGITS)
+				{
+					mantissa = mantissa * 10 + (*p - '0');
+					num_digits += (mantissa != 0);
+					-- exponent;
+				}
+				else
+				{
+					truncated |= (*p != '0');
+				}
+			}
+		}
+		if (has_digits && (('e' == *p) || ('E' == *p)))
+		{
+			char const * q = p + 1;
+			bool negative_exp = false;
+			if (('-' == *q) || ('+' == *q))
+			{
+				negative_exp = ('-' == *q);
+				++ q;
+			}
+			if ((*q >= '0') && (*q <= '9'))
+			{
+				int e = 0;
+				for (; (*q >= '0') && (*q <= '9'); ++ q)
+				{
+					e = std::min(e * 10 + (*q - '0'), 9999);
+				}
+				exponent += negative_exp ? -e : e;
+				p = q;
+			}
+		}
+
+		// inf, nan, hex floats, and anything that isn't a number at all
+		if (!has_digits || (p != token_end))
+		{
+			v = ParseFloatSlow(token, token_end);
+			return token_end;
+		}
+
+		if (0 == mantissa)
+		{
+			v = negative ? -0.0f : 0.0f;
+			return token_end;
+		}
+
+		// Both operands are exact in double, so the result is rounded once. It's then rounded again to float, which
+		//  is only wrong when the first rounding landed right between two floats.
+		if (!truncated && (mantissa <= MAX_EXACT_MANTISSA) && (exponent >= -MAX_POW10) && (exponent <= MAX_POW10))
+		{
+			double d = static_cast<double>(mantissa);
+			if (exponent >= 0)
+			{
+				d *= POW10[exponent];
+			}
+			else
+			{
+				d /= POW10[-exponent];
+			}
+			if ((d >= FLT_MIN) && (d <= FLT_MAX) && !IsFloatMidpoint(d))
+			{
+				v = static_cast<float>(negative ? -d : d);
+				return token_end;
+			}
+		}
+
+		v = ParseFloatSlow(token, token_end);
+		return token_end;
+	}
+
+	char const * ParseMeshMLUInt(char const * p, uint32_t& v)
+	{
+		p = SkipSpaces(p);
+		if (!*p)
+		{
+			v = 0;
+			return p;
+		}
+
+		char const * const token = p;
+
+		bool negative = false;
+		if (('-' == *p) || ('+' == *p))
+		{
+			negative = ('-' == *p);
+			++ p;
+		}
+
+		uint32_t n = 0;
+		bool has_digits = false;
+		for (; (*p >= '0') && (*p <= '9'); ++ p)
+		{
+			has_digits = true;
+			n = n * 10 + (*p - '0');
+		}
+
+		char const * const token_end = SkipToken(p);
+		if (!has_digits || (p != token_end))
+		{
+			ThrowMalformed(token, token_end);
+		}
+
+		v = negative ? 0 - n : n;
+		return token_end;
+	}
+}
@@ -0,0 +1,835 @@
+/**
+ * @file MeshOptimizer.cpp
+ * @author Minmin Gong
+ *
+ * @section DESCRIPTION
+ *
+ * This source file is part of MeshMLLib, a subproject of KlayGE
+ * For the latest info, see http://www.klayge.org
+ *
+ * @section LICENSE
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published
+ * by the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+ *
+ * You may alternatively use this source under the terms of
+ * the KlayGE Proprietary License (KPL). You can obtained such a license
+ * from http://www.klayge.org/licensing/.
+ */
+
+#include <KFL/KFL.hpp>
+#include <KFL/Math.hpp>
+#include <MeshMLLib/MeshMLLib.hpp>
+
+#include <algorithm>
+#include <cmath>
+#include <queue>
+
+#include <boost/assert.hpp>
+
+namespace
+{
+	using namespace KlayGE;
+
+	// Tom Forsyth, "Linear-Speed Vertex Cache Optimisation"
+	uint32_t const FORSYTH_CACHE_SIZE = 32;
+	float const CACHE_DECAY_POWER = 1.5f;
+	float const LAST_TRI_SCORE = 0.75f;
+	float const VALENCE_BOOST_SCALE = 2.0f;
+	float const VALENCE_BOOST_POWER = 0.5f;
+
+	// A cluster is split when its own ACMR gets below this times the ACMR of the whole mesh
+	float const OVERDRAW_SPLIT_THRESHOLD = 1.05f;
+	uint32_t const OVERDRAW_CACHE_SIZE = 16;
+
+	float VertexScore(int cache_pos, uint32_t remaining_tris)
+	{
+		if (0 == remaining_tris)
+		{
+			return -1.0f;
+		}
+
+		float score = 0;
+		if (cache_pos >= 0)
+		{
+			if (cache_pos < 3)
+			{
+				// The vertices of the last triangle get a fixed score, whichever way round they were
+				score = LAST_TRI_SCORE;
+			}
+			else
+			{
+				float const scaler = 1.0f / (FORSYTH_CACHE_SIZE - 3);
+				score = pow(1.0f - (cache_pos - 3) * scaler, CACHE_DECAY_POWER);
+			}
+		}
+
+		// Vertices with few triangles left are preferred, to get rid of lone triangles early
+		score += VALENCE_BOOST_SCALE * pow(static_cast<float>(remaining_tris), -VALENCE_BOOST_POWER);
+
+		return score;
+	}
+
+	class FIFOVertexCache
+	{
+	public:
+		FIFOVertexCache(uint32_t num_vertices, uint32_t cache_size)
+			: cache_size_(cache_size), timestamp_(cache_size + 1),
+				vertex_timestamps_(num_vertices, 0)
+		{
+		}
+
+		// Returns true if the vertex has to be transformed
+		bool Access(uint32_t vertex)
+		{
+			if (timestamp_ - vertex_timestamps_[vertex] > cache_size_)
+			{
+				vertex_timestamps_[vertex] = timestamp_;
+				++ timestamp_;
+				return true;
+			}
+			return false;
+		}
+
+		void Flush()
+		{
+			timestamp_ += cache_size_ + 1;
+		}
+
+	private:
+		uint32_t cache_size_;
+		uint32_t timestamp_;
+		std::vector<uint32_t> vertex_timestamps_;
+	};
+
+	float OrderACMR(uint32_t const * indices, uint32_t num_vertices, std::vector<uint32_t> const & tri_order)
+	{
+		FIFOVertexCache cache(num_vertices, OVERDRAW_CACHE_SIZE);
+		uint32_t misses = 0;
+		for (size_t i = 0; i < tri_order.size(); ++ i)
+		{
+			for (uint32_t k = 0; k < 3; ++ k)
+			{
+				misses += cache.Access(indices[tri_order[i] * 3 + k]);
+			}
+		}
+		return static_cast<float>(misses) / tri_order.size();
+	}
+
+	struct ClusterSortOp
+	{
+		explicit ClusterSortOp(std::vector<float> const & keys)
+			: keys_(&keys)
+		{
+		}
+
+		bool operator()(uint32_t lhs, uint32_t rhs) const
+		{
+			return (*keys_)[lhs] > (*keys_)[rhs];
+		}
+
+		std::vector<float> const * keys_;
+	};
+
+	// Splits the triangle order into clusters, and sorts them so that the ones facing out of the mesh are drawn first.
+	//  The new order is dropped if its ACMR goes beyond max_acmr_ratio times the one of the original order.
+	void OptimizeOverdraw(uint32_t const * indices, uint32_t num_vertices, float3 const * positions,
+		float max_acmr_ratio, std::vector<uint32_t>& tri_order, std::vector<uint32_t>& cluster_starts)
+	{
+		uint32_t const num_tris = static_cast<uint32_t>(tri_order.size());
+
+		float const acmr = OrderACMR(indices, num_vertices, tri_order);
+
+		// Soft boundaries, where a cluster has already paid for its cold cache
+		std::vector<uint32_t> splits;
+		{
+			FIFOVertexCache cache(num_vertices, OVERDRAW_CACHE_SIZE);
+			cluster_starts.push_back(num_tris);
+			for (size_t c = 0; c + 1 < cluster_starts.size(); ++ c)
+			{
+				uint32_t misses = 0;
+				uint32_t start = cluster_starts[c];
+				splits.push_back(start);
+				cache.Flush();
+				for (uint32_t i = cluster_starts[c]; i < cluster_starts[c + 1]; ++ i)
+				{
+					for (uint32_t k = 0; k < 3; ++ k)
+					{
+						misses += cache.Access(indices[tri_order[i] * 3 + k]);
+					}
+
+					if ((i + 1 < cluster_starts[c + 1])
+						&& (misses < acmr * OVERDRAW_SPLIT_THRESHOLD * (i + 1 - start)))
+					{
+						start = i + 1;
+						splits.push_back(start);
+						misses = 0;
+						cache.Flush();
+					}
+				}
+			}
+			splits.push_back(num_tris);
+		}
+
+		uint32_t const num_clusters = static_cast<uint32_t>(splits.size() - 1);
+		std::vector<float3> centroids(num_clusters, float3(0, 0, 0));
+		std::vector<float3> normals(num_clusters, float3(0, 0, 0));
+		std::vector<float> areas(num_clusters, 0.0f);
+		float3 mesh_centroid(0, 0, 0);
+		float mesh_area = 0;
+		for (uint32_t c = 0; c < num_clusters; ++ c)
+		{
+			for (uint32_t i = splits[c]; i < splits[c + 1]; ++ i)
+			{
+				uint32_t const * tri = &indices[tri_order[i] * 3];
+				float3 const & p0 = positions[tri[0]];
+				float3 const & p1 = positions[tri[1]];
+				float3 const & p2 = positions[tri[2]];
+
+				float3 const normal = MathLib::cross(p1 - p0, p2 - p0);
+				float const area = MathLib::length(normal);
+				centroids[c] += (p0 + p1 + p2) * (area / 3);
+				normals[c] += normal;
+				areas[c] += area;
+			}
+
+			mesh_centroid += centroids[c];
+			mesh_area += areas[c];
+		}
+		if (mesh_area > 0)
+		{
+			mesh_centroid /= mesh_area;
+		}
+
+		std::vector<float> keys(num_clusters, 0.0f);
+		for (uint32_t c = 0; c < num_clusters; ++ c)
+		{
+			float const normal_len = MathLib::length(normals[c]);
+			if ((areas[c] > 0) && (normal_len > 0))
+			{
+				keys[c] = MathLib::dot(centroids[c] / areas[c] - mesh_centroid, normals[c] / normal_len);
+			}
+		}
+
+		std::vector<uint32_t> clusters(num_clusters);
+		for (uint32_t c = 0; c < num_clusters; ++ c)
+		{
+			clusters[c] = c;
+		}
+		std::stable_sort(clusters.begin(), clusters.end(), ClusterSortOp(keys));
+
+		std::vector<uint32_t> new_order;
+		new_order.reserve(num_tris);
+		for (uint32_t c = 0; c < num_clusters; ++ c)
+		{
+			new_order.insert(new_order.end(), tri_order.begin() + splits[clusters[c]],
+				tri_order.begin() + splits[clusters[c] + 1]);
+		}
+		if (OrderACMR(indices, num_vertices, new_order) <= acmr * max_acmr_ratio)
+		{
+			tri_order.swap(new_order);
+		}
+	}
+
+	// Symmetric 4x4 matrix of a quadric error metric, a2 ab ac ad b2 bc bd c2 cd d2
+	struct Quadric
+	{
+		double m[10];
+
+		Quadric()
+		{
+			std::fill(m, m + 10, 0.0);
+		}
+
+		void AddPlane(double a, double b, double c, double d, double weight)
+		{
+			m[0] += weight * a * a;
+			m[1] += weight * a * b;
+			m[2] += weight * a * c;
+			m[3] += weight * a * d;
+			m[4] += weight * b * b;
+			m[5] += weight * b * c;
+			m[6] += weight * b * d;
+			m[7] += weight * c * c;
+			m[8] += weight * c * d;
+			m[9] += weight * d * d;
+		}
+
+		Quadric& operator+=(Quadric const & rhs)
+		{
+			for (int i = 0; i < 10; ++ i)
+			{
+				m[i] += rhs.m[i];
+			}
+			return *this;
+		}
+
+		double Error(double x, double y, double z) const
+		{
+			double const err = m[0] * x * x + 2 * m[1] * x * y + 2 * m[2] * x * z + 2 * m[3] * x
+				+ m[4] * y * y + 2 * m[5] * y * z + 2 * m[6] * y
+				+ m[7] * z * z + 2 * m[8] * z
+				+ m[9];
+			return std::max(err, 0.0);
+		}
+	};
+
+	struct EdgeCollapse
+	{
+		double error;
+		uint32_t from;
+		uint32_t to;
+		uint32_t from_version;
+		uint32_t to_version;
+	};
+
+	struct EdgeCollapseGreaterOp
+	{
+		bool operator()(EdgeCollapse const & lhs, EdgeCollapse const & rhs) const
+		{
+			return lhs.error > rhs.error;
+		}
+	};
+
+	class MeshSimplifier
+	{
+	public:
+		MeshSimplifier(uint32_t const * indices, uint32_t num_indices, float3 const * positions, uint32_t num_vertices)
+			: indices_(indices, indices + num_indices),
+				positions_(num_vertices), quadrics_(num_vertices),
+				vert_tris_(num_vertices), locked_(num_vertices, false), removed_(num_vertices, false),
+				versions_(num_vertices, 0), tri_removed_(num_indices / 3, false),
+				num_tris_(num_indices / 3)
+		{
+			// Works in a unit sized space, so the errors are relative to the mesh
+			float3 min_pos(+1e30f, +1e30f, +1e30f);
+			float3 max_pos(-1e30f, -1e30f, -1e30f);
+			for (uint32_t i = 0; i < num_indices; ++ i)
+			{
+				min_pos = MathLib::minimize(min_pos, positions[indices[i]]);
+				max_pos = MathLib::maximize(max_pos, positions[indices[i]]);
+			}
+			float3 const extent = max_pos - min_pos;
+			float const size = std::max(std::max(extent.x(), extent.y()), extent.z());
+			float const scale = (size > 0) ? 1 / size : 1.0f;
+			for (uint32_t v = 0; v < num_vertices; ++ v)
+			{
+				positions_[v] = (positions[v] - min_pos) * scale;
+			}
+
+			for (uint32_t t = 0; t < num_tris_; ++ t)
+			{
+				uint32_t const * tri = &indices_[t * 3];
+				for (uint32_t k = 0; k < 3; ++ k)
+				{
+					vert_tris_[tri[k]].push_back(t);
+				}
+
+				float3 normal = MathLib::cross(positions_[tri[1]] - positions_[tri[0]],
+					positions_[tri[2]] - positions_[tri[0]]);
+				float const area = MathLib::length(normal);
+				if (area > 0)
+				{
+					normal /= area;
+					float const d = -MathLib::dot(normal, positions_[tri[0]]);
+					for (uint32_t k = 0; k < 3; ++ k)
+					{
+						quadrics_[tri[k]].AddPlane(normal.x(), normal.y(), normal.z(), d, area);
+					}
+				}
+			}
+
+			this->LockOpenEdges();
+		}
+
+		float Simplify(uint32_t target_num_indices, float max_error)
+		{
+			for (uint32_t t = 0; t < num_tris_; ++ t)
+			{
+				for (uint32_t k = 0; k < 3; ++ k)
+				{
+					this->PushCollapse(indices_[t * 3 + k], indices_[t * 3 + (k + 1) % 3]);
+					this->PushCollapse(indices_[t * 3 + (k + 1) % 3], indices_[t * 3 + k]);
+				}
+			}
+
+			double const max_sq_error = static_cast<double>(max_error) * max_error;
+			double reached_error = 0;
+			uint32_t num_live_tris = num_tris_;
+			while ((num_live_tris * 3 > target_num_indices) && !collapses_.empty())
+			{
+				EdgeCollapse const collapse = collapses_.top();
+				collapses_.pop();
+
+				if (removed_[collapse.from] || removed_[collapse.to]
+					|| (versions_[collapse.from] != collapse.from_version)
+					|| (versions_[collapse.to] != collapse.to_version))
+				{
+					continue;
+				}
+				if (collapse.error > max_sq_error)
+				{
+					break;
+				}
+				if (!this->CanCollapse(collapse.from, collapse.to))
+				{
+					continue;
+				}
+
+				num_live_tris -= this->Collapse(collapse.from, collapse.to);
+				reached_error = std::max(reached_error, collapse.error);
+			}
+
+			return static_cast<float>(sqrt(reached_error));
+		}
+
+		void Output(std::vector<uint32_t>& indices) const
+		{
+			indices.clear();
+			for (uint32_t t = 0; t < num_tris_; ++ t)
+			{
+				if (!tri_removed_[t])
+				{
+					indices.insert(indices.end(), indices_.begin() + t * 3, indices_.begin() + t * 3 + 3);
+				}
+			}
+		}
+
+	private:
+		// Vertices on an edge without exactly one opposite edge are on a border, a seam where the attributes are
+		//  split, or a non-manifold part. They stay where they are.
+		void LockOpenEdges()
+		{
+			std::vector<uint64_t> edges(num_tris_ * 3);
+			for (uint32_t t = 0; t < num_tris_; ++ t)
+			{
+				for (uint32_t k = 0; k < 3; ++ k)
+				{
+					edges[t * 3 + k] = (static_cast<uint64_t>(indices_[t * 3 + k]) << 32) | indices_[t * 3 + (k + 1) % 3];
+				}
+			}
+			std::sort(edges.begin(), edges.end());
+
+			for (size_t i = 0; i < edges.size(); ++ i)
+			{
+				uint32_t const v0 = static_cast<uint32_t>(edges[i] >> 32);
+				uint32_t const v1 = static_cast<uint32_t>(edges[i] & 0xFFFFFFFF);
+				uint64_t const opposite = (static_cast<uint64_t>(v1) << 32) | v0;
+				std::pair<std::vector<uint64_t>::const_iterator, std::vector<uint64_t>::const_iterator> const range
+					= std::equal_range(edges.begin(), edges.end(), opposite);
+				bool const duplicated = ((i > 0) && (edges[i - 1] == edges[i]))
+					|| ((i + 1 < edges.size()) && (edges[i + 1] == edges[i]));
+				if (duplicated || (range.second - range.first != 1))
+				{
+					locked_[v0] = true;
+					locked_[v1] = true;
+				}
+			}
+		}
+
+		void PushCollapse(uint32_t from, uint32_t to)
+		{
+			if (!locked_[from] && (from != to))
+			{
+				Quadric q = quadrics_[from];
+				q += quadrics_[to];
+				float3 const & p = positions_[to];
+
+				EdgeCollapse collapse;
+				collapse.error = q.Error(p.x(), p.y(), p.z());
+				collapse.from = from;
+				collapse.to = to;
+				collapse.from_version = versions_[from];
+				collapse.to_version = versions_[to];
+				collapses_.push(collapse);
+			}
+		}
+
+		void Neighbors(uint32_t v, std::vector<uint32_t>& neighbors) const
+		{
+			neighbors.clear();
+			for (size_t i = 0; i < vert_tris_[v].size(); ++ i)
+			{
+				uint32_t const t = vert_tris_[v][i];
+				if (!tri_removed_[t])
+				{
+					for (uint32_t k = 0; k < 3; ++ k)
+					{
+						if (indices_[t * 3 + k] != v)
+						{
+							neighbors.push_back(indices_[t * 3 + k]);
+						}
+					}
+				}
+			}
+			std::sort(neighbors.begin(), neighbors.end());
+			neighbors.erase(std::unique(neighbors.begin(), neighbors.end()), neighbors.end());
+		}
+
+		bool CanCollapse(uint32_t from, uint32_t to)
+		{
+			uint32_t num_shared_tris = 0;
+			for (size_t i = 0; i < vert_tris_[from].size(); ++ i)
+			{
+				uint32_t const t = vert_tris_[from][i];
+				if (tri_removed_[t])
+				{
+					continue;
+				}
+
+				uint32_t const * tri = &indices_[t * 3];
+				if ((tri[0] == to) || (tri[1] == to) || (tri[2] == to))
+				{
+					++ num_shared_tris;
+				}
+				else
+				{
+					// The triangles left must not flip over
+					float3 p[3];
+					for (uint32_t k = 0; k < 3; ++ k)
+					{
+						p[k] = positions_[tri[k]];
+					}
+					float3 const old_normal = MathLib::cross(p[1] - p[0], p[2] - p[0]);
+					for (uint32_t k = 0; k < 3; ++ k)
+					{
+						if (tri[k] == from)
+						{
+							p[k] = positions_[to];
+						}
+					}
+					float3 const new_normal = MathLib::cross(p[1] - p[0], p[2] - p[0]);
+					if (MathLib::dot(old_normal, new_normal) <= 0)
+					{
+						return false;
+					}
+				}
+			}
+			if (0 == num_shared_tris)
+			{
+				return false;
+			}
+
+			// Link condition, the edge's two triangles must be the only ones sharing both ends' neighbors
+			this->Neighbors(from, from_neighbors_);
+			this->Neighbors(to, to_neighbors_);
+			uint32_t num_common = 0;
+			for (size_t i = 0, j = 0; (i < from_neighbors_.size()) && (j < to_neighbors_.size());)
+			{
+				if (from_neighbors_[i] < to_neighbors_[j])
+				{
+					++ i;
+				}
+				else if (from_neighbors_[i] > to_neighbors_[j])
+				{
+					++ j;
+				}
+				else
+				{
+					++ num_common;
+					++ i;
+					++ j;
+				}
+			}
+			return num_common == num_shared_tris;
+		}
+
+		// Returns the number of triangles removed
+		uint32_t Collapse(uint32_t from, uint32_t to)
+		{
+			uint32_t num_removed = 0;
+			for (size_t i = 0; i < vert_tris_[from].size(); ++ i)
+			{
+				uint32_t const t = vert_tris_[from][i];
+				if (tri_removed_[t])
+				{
+					continue;
+				}
+
+				uint32_t* tri = &indices_[t * 3];
+				if ((tri[0] == to) || (tri[1] == to) || (tri[2] == to))
+				{
+					tri_removed_[t] = true;
+					++ num_removed;
+				}
+				else
+				{
+					for (uint32_t k = 0; k < 3; ++ k)
+					{
+						if (tri[k] == from)
+						{
+							tri[k] = to;
+						}
+					}
+					vert_tris_[to].push_back(t);
+				}
+			}
+			vert_tris_[from].clear();
+			removed_[from] = true;
+
+			quadrics_[to] += quadrics_[from];
+			++ versions_[to];
+
+			// Everything collapsing onto or from the target has a new error now
+			this->Neighbors(to, to_neighbors_);
+			for (size_t i = 0; i < to_neighbors_.size(); ++ i)
+			{
+				this->PushCollapse(to_neighbors_[i], to);
+				this->PushCollapse(to, to_neighbors_[i]);
+			}
+
+			return num_removed;
+		}
+
+	private:
+		std::vector<uint32_t> indices_;
+		std::vector<float3> positions_;
+		std::vector<Quadric> quadrics_;
+		std::vector<std::vector<uint32_t> > vert_tris_;
+		std::vector<bool> locked_;
+		std::vector<bool> removed_;
+		std::vector<uint32_t> versions_;
+		std::vector<bool> tri_removed_;
+		uint32_t num_tris_;
+
+		std::priority_queue<EdgeCollapse, std::vector<EdgeCollapse>, EdgeCollapseGreaterOp> collapses_;
+
+		std::vector<uint32_t> from_neighbors_;
+		std::vector<uint32_t> to_neighbors_;
+	};
+}
+
+namespace KlayGE
+{
+	VertexCacheStats AnalyzeVertexCache(uint32_t const * indices, uint32_t num_indices, uint32_t num_vertices,
+		uint32_t cache_size)
+	{
+		FIFOVertexCache cache(num_vertices, cache_size);
+		std::vector<char> referenced(num_vertices, false);
+		uint32_t misses = 0;
+		uint32_t num_referenced = 0;
+		for (uint32_t i = 0; i < num_indices; ++ i)
+		{
+			misses += cache.Access(indices[i]);
+			if (!referenced[indices[i]])
+			{
+				referenced[indices[i]] = true;
+				++ num_referenced;
+			}
+		}
+
+		VertexCacheStats stats;
+		stats.acmr = (num_indices > 0) ? static_cast<float>(misses) / (num_indices / 3) : 0.0f;
+		stats.atvr = (num_referenced > 0) ? static_cast<float>(misses) / num_referenced : 0.0f;
+		return stats;
+	}
+
+	void OptimizeTriangleOrder(uint32_t* indices, uint32_t num_indices, uint32_t num_vertices,
+		float3 const * positions, float max_acmr_ratio)
+	{
+		uint32_t const num_tris = num_indices / 3;
+		if (num_tris < 2)
+		{
+			return;
+		}
+
+		// Triangles of each vertex, the first remaining_tris[v] are the ones not added yet
+		std::vector<uint32_t> vert_tri_starts(num_vertices + 1, 0);
+		for (uint32_t i = 0; i < num_tris * 3; ++ i)
+		{
+			BOOST_ASSERT(indices[i] < num_vertices);
+			++ vert_tri_starts[indices[i] + 1];
+		}
+		for (uint32_t v = 0; v < num_vertices; ++ v)
+		{
+			vert_tri_starts[v + 1] += vert_tri_starts[v];
+		}
+		std::vector<uint32_t> vert_tris(num_tris * 3);
+		std::vector<uint32_t> remaining_tris(num_vertices, 0);
+		for (uint32_t t = 0; t < num_tris; ++ t)
+		{
+			for (uint32_t k = 0; k < 3; ++ k)
+			{
+				uint32_t const v = indices[t * 3 + k];
+				vert_tris[vert_tri_starts[v] + remaining_tris[v]] = t;
+				++ remaining_tris[v];
+			}
+		}
+
+		std::vector<int> cache_pos(num_vertices, -1);
+		std::vector<float> vert_scores(num_vertices);
+		for (uint32_t v = 0; v < num_vertices; ++ v)
+		{
+			vert_scores[v] = VertexScore(-1, remaining_tris[v]);
+		}
+
+		std::vector<char> tri_added(num_tris, false);
+		int best_tri = -1;
+		{
+			float best_score = -1;
+			for (uint32_t t = 0; t < num_tris; ++ t)
+			{
+				float const score = vert_scores[indices[t * 3 + 0]] + vert_scores[indices[t * 3 + 1]]
+					+ vert_scores[indices[t * 3 + 2]];
+				if (score > best_score)
+				{
+					best_tri = t;
+					best_score = score;
+				}
+			}
+		}
+
+		std::vector<uint32_t> tri_order;
+		tri_order.reserve(num_tris);
+		// Where the ordering had to start over, nothing in the cache was useful any more
+		std::vector<uint32_t> cluster_starts(1, 0);
+		std::vector<uint32_t> cache;
+		cache.reserve(FORSYTH_CACHE_SIZE + 3);
+		std::vector<uint32_t> new_cache;
+		new_cache.reserve(FORSYTH_CACHE_SIZE + 3);
+		uint32_t next_unadded = 0;
+		for (uint32_t n = 0; n < num_tris; ++ n)
+		{
+			if (best_tri < 0)
+			{
+				while (tri_added[next_unadded])
+				{
+					++ next_unadded;
+				}
+				best_tri = next_unadded;
+				cluster_starts.push_back(n);
+			}
+
+			uint32_t const tri = best_tri;
+			uint32_t const * tri_verts = &indices[tri * 3];
+			tri_added[tri] = true;
+			tri_order.push_back(tri);
+
+			new_cache.clear();
+			for (uint32_t k = 0; k < 3; ++ k)
+			{
+				uint32_t const v = tri_verts[k];
+				if (std::find(new_cache.begin(), new_cache.end(), v) == new_cache.end())
+				{
+					new_cache.push_back(v);
+				}
+
+				uint32_t* tris_begin = &vert_tris[vert_tri_starts[v]];
+				uint32_t* tris_end = tris_begin + remaining_tris[v];
+				uint32_t* iter = std::find(tris_begin, tris_end, tri);
+				BOOST_ASSERT(iter != tris_end);
+				std::swap(*iter, *(tris_end - 1));
+				-- remaining_tris[v];
+			}
+			for (size_t i = 0; i < cache.size(); ++ i)
+			{
+				uint32_t const v = cache[i];
+				if ((v != tri_verts[0]) && (v != tri_verts[1]) && (v != tri_verts[2]))
+				{
+					new_cache.push_back(v);
+				}
+			}
+
+			for (size_t i = 0; i < new_cache.size(); ++ i)
+			{
+				uint32_t const v = new_cache[i];
+				cache_pos[v] = (i < FORSYTH_CACHE_SIZE) ? static_cast<int>(i) : -1;
+				vert_scores[v] = VertexScore(cache_pos[v], remaining_tris[v]);
+			}
+
+			// Only the triangles around the cache can have changed their scores
+			best_tri = -1;
+			float best_score = -1;
+			for (size_t i = 0; i < new_cache.size(); ++ i)
+			{
+				uint32_t const v = new_cache[i];
+				for (uint32_t j = 0; j < remaining_tris[v]; ++ j)
+				{
+					uint32_t const t = vert_tris[vert_tri_starts[v] + j];
+					float const score = vert_scores[indices[t * 3 + 0]] + vert_scores[indices[t * 3 + 1]]
+						+ vert_scores[indices[t * 3 + 2]];
+					if (score > best_score)
+					{
+						best_tri = t;
+						best_score = score;
+					}
+				}
+			}
+
+			if (new_cache.size() > FORSYTH_CACHE_SIZE)
+			{
+				new_cache.resize(FORSYTH_CACHE_SIZE);
+			}
+			cache.swap(new_cache);
+		}
+
+		if (positions)
+		{
+			OptimizeOverdraw(indices, num_vertices, positions, max_acmr_ratio, tri_order, cluster_starts);
+		}
+
+		std::vector<uint32_t> new_indices(num_tris * 3);
+		for (uint32_t i = 0; i < num_tris; ++ i)
+		{
+			for (uint32_t k = 0; k < 3; ++ k)
+			{
+				new_indices[i * 3 + k] = indices[tri_order[i] * 3 + k];
+			}
+		}
+		std::copy(new_indices.begin(), new_indices.end(), indices);
+	}
+
+	void OptimizeVertexFetch(uint32_t* indices, uint32_t num_indices, uint32_t num_vertices,
+		std::vector<uint32_t>& remap)
+	{
+		uint32_t const UNUSED = 0xFFFFFFFF;
+
+		remap.assign(num_vertices, UNUSED);
+		uint32_t next_vertex = 0;
+		for (uint32_t i = 0; i < num_indices; ++ i)
+		{
+			BOOST_ASSERT(indices[i] < num_vertices);
+			uint32_t& new_index = remap[indices[i]];
+			if (UNUSED == new_index)
+			{
+				new_index = next_vertex;
+				++ next_vertex;
+			}
+			indices[i] = new_index;
+		}
+		for (uint32_t v = 0; v < num_vertices; ++ v)
+		{
+			if (UNUSED == remap[v])
+			{
+				remap[v] = next_vertex;
+				++ next_vertex;
+			}
+		}
+	}
+
+	float SimplifyMesh(uint32_t const * indices, uint32_t num_indices, float3 const * positions, uint32_t num_vertices,
+		uint32_t target_num_indices, float max_error, std::vector<uint32_t>& simplified_indices)
+	{
+		if (num_indices <= target_num_indices)
+		{
+			simplified_indices.assign(indices, indices + num_indices);
+			return 0;
+		}
+
+		MeshSimplifier simplifier(indices, num_indices, positions, num_vertices);
+		float const error = simplifier.Simplify(target_num_indices, max_error);
+		simplifier.Output(simplified_indices);
+		return error;
+	}
+}
@@ -34,8 +34,11 @@
 #pragma once
 
 #include <vector>
+#include <list>
 #include <istream>
 
+#include <KFL/Thread.hpp>
+
 #ifndef KFONT_SOURCE
 	#define KLAYGE_LIB_NAME kfont
 	#include <KFL/Detail/AutoLink.hpp>
@@ -91,7 +94,7 @@ namespace KlayGE
 
 	public:
 		KFont()
-			: distances_addr_(1, 0)
+			: distances_addr_(1, 0), max_num_decoded_(DEFAULT_NUM_DECODED_CHARS)
 		{
 		}
 		
@@ -108,8 +111,14 @@ namespace KlayGE
 		uint32_t CharAdvance(wchar_t ch) const;
 
 		font_info const & CharInfo(int32_t index) const;
+		// Thread safe. Decoded distance data are kept in a LRU cache.
 		void GetDistanceData(uint8_t* p, uint32_t pitch, int32_t index) const;
 		void GetLZMADistanceData(uint8_t* p, uint32_t& size, int32_t index) const;
+		// Decodes the distance data of the chars into the cache, for calling from a worker thread
+		void PrefetchDistanceData(std::vector<int32_t> const & indices) const;
+
+		void MaxNumDecodedChars(uint32_t num);
+		uint32_t MaxNumDecodedChars() const;
 
 		void CharSize(uint32_t size);
 		void DistBase(int16_t base);
@@ -119,6 +128,12 @@ namespace KlayGE
 		void Compact();
 
 	private:
+		shared_ptr<std::vector<uint8_t> > DecodedDistanceData(int32_t index) const;
+		void ClearDecodedCache();
+
+	private:
+		static uint32_t const DEFAULT_NUM_DECODED_CHARS = 512;
+
 		uint32_t char_size_;
 		int16_t dist_base_;
 		int16_t dist_scale_;
@@ -128,6 +143,14 @@ namespace KlayGE
 		std::vector<uint8_t> distances_lzma_;
 		ResIdentifierPtr kfont_input_;
 		int64_t distances_lzma_start_;
+		mutable mutex input_mutex_;
+
+		typedef std::pair<shared_ptr<std::vector<uint8_t> >, std::list<int32_t>::iterator> DecodedCharType;
+		mutable unordered_map<int32_t, DecodedCharType> decoded_chars_;
+		// Most recently used first
+		mutable std::list<int32_t> decoded_lru_;
+		uint32_t max_num_decoded_;
+		mutable mutex decoded_mutex_;
 	};
 }
 
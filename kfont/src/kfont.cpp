@@ -127,6 +127,8 @@ namespace KlayGE
 	{
 		if (kfont_input)
 		{
+			this->ClearDecodedCache();
+
 			kfont_input_ = kfont_input;
 
 			kfont_header header;
@@ -355,27 +357,103 @@ namespace KlayGE
 
 	void KFont::GetDistanceData(uint8_t* p, uint32_t pitch, int32_t index) const
 	{
-		std::vector<uint8_t> decoded(char_size_ * char_size_);
+		shared_ptr<std::vector<uint8_t> > decoded = this->DecodedDistanceData(index);
+
+		uint8_t const * char_data = &(*decoded)[0];
+		for (uint32_t y = 0; y < char_size_; ++ y)
+		{
+			std::memcpy(p, char_data, char_size_);
+			p += pitch;
+			char_data += char_size_;
+		}
+	}
+
+	void KFont::PrefetchDistanceData(std::vector<int32_t> const & indices) const
+	{
+		for (size_t i = 0; i < indices.size(); ++ i)
+		{
+			this->DecodedDistanceData(indices[i]);
+		}
+	}
+
+	void KFont::MaxNumDecodedChars(uint32_t num)
+	{
+		lock_guard<mutex> lock(decoded_mutex_);
 
-		uint32_t size;
-		this->GetLZMADistanceData(nullptr, size, index);
+		max_num_decoded_ = num;
+		while (decoded_chars_.size() > max_num_decoded_)
+		{
+			decoded_chars_.erase(decoded_lru_.back());
+			decoded_lru_.pop_back();
+		}
+	}
 
-		std::vector<uint8_t> in_data(size);
-		this->GetLZMADistanceData(&in_data[0], size, index);
+	uint32_t KFont::MaxNumDecodedChars() const
+	{
+		lock_guard<mutex> lock(decoded_mutex_);
 
-		SizeT s_out_len = static_cast<SizeT>(decoded.size());
+		return max_num_decoded_;
+	}
+
+	shared_ptr<std::vector<uint8_t> > KFont::DecodedDistanceData(int32_t index) const
+	{
+		{
+			lock_guard<mutex> lock(decoded_mutex_);
+
+			KLAYGE_AUTO(iter, decoded_chars_.find(index));
+			if (iter != decoded_chars_.end())
+			{
+				decoded_lru_.splice(decoded_lru_.begin(), decoded_lru_, iter->second.second);
+				return iter->second.first;
+			}
+		}
+
+		std::vector<uint8_t> in_data;
+		{
+			// kfont_input_ is a single stream shared by all threads
+			lock_guard<mutex> lock(input_mutex_);
+
+			uint32_t size;
+			this->GetLZMADistanceData(nullptr, size, index);
+
+			in_data.resize(size);
+			this->GetLZMADistanceData(&in_data[0], size, index);
+		}
+
+		shared_ptr<std::vector<uint8_t> > decoded = MakeSharedPtr<std::vector<uint8_t> >(char_size_ * char_size_);
+
+		SizeT s_out_len = static_cast<SizeT>(decoded->size());
 
 		SizeT s_src_len = static_cast<SizeT>(in_data.size() - LZMA_PROPS_SIZE);
-		LZMALoader::Instance().LzmaUncompress(static_cast<Byte*>(&decoded[0]), &s_out_len, &in_data[LZMA_PROPS_SIZE], &s_src_len,
+		LZMALoader::Instance().LzmaUncompress(static_cast<Byte*>(&(*decoded)[0]), &s_out_len, &in_data[LZMA_PROPS_SIZE], &s_src_len,
 			&in_data[0], LZMA_PROPS_SIZE);
 
-		uint8_t const * char_data = &decoded[0];
-		for (uint32_t y = 0; y < char_size_; ++ y)
 		{
-			std::memcpy(p, char_data, char_size_);
-			p += pitch;
-			char_data += char_size_;
+			lock_guard<mutex> lock(decoded_mutex_);
+
+			// Another thread could have decoded the same char in the mean time
+			if ((max_num_decoded_ > 0) && (decoded_chars_.find(index) == decoded_chars_.end()))
+			{
+				if (decoded_chars_.size() >= max_num_decoded_)
+				{
+					decoded_chars_.erase(decoded_lru_.back());
+					decoded_lru_.pop_back();
+				}
+
+				decoded_lru_.push_front(index);
+				decoded_chars_.insert(std::make_pair(index, std::make_pair(decoded, decoded_lru_.begin())));
+			}
 		}
+
+		return decoded;
+	}
+
+	void KFont::ClearDecodedCache()
+	{
+		lock_guard<mutex> lock(decoded_mutex_);
+
+		decoded_chars_.clear();
+		decoded_lru_.clear();
 	}
 
 	void KFont::GetLZMADistanceData(uint8_t* p, uint32_t& size, int32_t index) const
@@ -492,5 +570,8 @@ namespace KlayGE
 		char_info_ = new_char_info;
 		distances_addr_ = new_distances_addr;
 		distances_lzma_ = new_distances_lzma;
+
+		// Char indices are changed
+		this->ClearDecodedCache();
 	}
 }